@@ -0,0 +1,65 @@
+/**
+ * @file bob/core/array_alias.h
+ * @date Tue Oct 20 10:02:31 2026 +0200
+ *
+ * @brief Thread-private references to the data of blitz++ arrays
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOB_CORE_ARRAY_ALIAS_H
+#define BOB_CORE_ARRAY_ALIAS_H
+
+#include <blitz/array.h>
+
+namespace bob {
+/**
+ * \ingroup libcore_api
+ * @{
+ *
+ */
+  namespace core { namespace array {
+
+    /**
+     * @brief Returns an array referring to the elements of a, with the same
+     * shape, strides and bases, but which does not share the memory block
+     * (and its reference count) of a.
+     *
+     * Creating a view (a slice, a sub-array or a copy of the Array object)
+     * of a blitz++ array updates the reference count of its memory block,
+     * which is not atomic. Hence, a worker thread should never create views
+     * of an array that other threads use: it should create its own alias
+     * with this function, which only reads a, and then slice the alias.
+     *
+     * @warning The alias does not keep the data alive: it should not outlive
+     * a, and a should not be resized while the alias is used.
+     */
+    template <typename T, int D>
+    blitz::Array<T,D> alias(const blitz::Array<T,D>& a)
+    {
+      blitz::GeneralArrayStorage<D> storage;
+      storage.ordering() = a.ordering();
+      storage.base() = a.base();
+      return blitz::Array<T,D>(const_cast<T*>(a.data()), a.shape(),
+          a.stride(), blitz::neverDeleteData, storage);
+    }
+
+  }}
+/**
+ * @}
+ */
+}
+
+#endif /* BOB_CORE_ARRAY_ALIAS_H */
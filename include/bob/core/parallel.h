@@ -0,0 +1,167 @@
+/**
+ * @file bob/core/parallel.h
+ * @date Mon Oct 19 16:40:12 2026 +0200
+ *
+ * @brief Helpers to split simple loops across a number of threads. The
+ * functions here are a generalization of the ones used by the visioner
+ * package, so they can be shared by all other C++ packages in bob.
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOB_CORE_PARALLEL_H
+#define BOB_CORE_PARALLEL_H
+
+#include <vector>
+#include <exception>
+#include <cstddef>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/shared_array.hpp>
+
+namespace bob {
+/**
+ * \ingroup libcore_api
+ * @{
+ *
+ */
+  namespace core {
+
+    /**
+     * Returns the number of threads that can run concurrently on this host.
+     * This is never smaller than 1.
+     */
+    size_t hardware_threads();
+
+    /**
+     * Splits the range [0, n_objects) into (at most) n_threads contiguous and
+     * balanced sub-ranges. The begin and end indices of each sub-range are
+     * appended to begins and ends. Empty sub-ranges are never generated, so
+     * the number of entries in begins/ends may be smaller than n_threads if
+     * there are less objects than threads.
+     */
+    void thread_split(size_t n_objects, std::vector<size_t>& begins,
+        std::vector<size_t>& ends, size_t n_threads);
+
+    namespace detail {
+
+      /**
+       * Runs a functor, capturing any exception it may raise so it can be
+       * re-thrown on the calling thread after all workers have joined.
+       */
+      template <typename TOp> struct guarded_op {
+        TOp op;
+        std::exception_ptr* error;
+
+        guarded_op(TOp op_, std::exception_ptr* error_):
+          op(op_), error(error_) {}
+
+        void operator()() {
+          try { op(); }
+          catch (...) { *error = std::current_exception(); }
+        }
+      };
+
+      template <typename TOp> guarded_op<TOp> guard(TOp op,
+          std::exception_ptr* error) {
+        return guarded_op<TOp>(op, error);
+      }
+
+    }
+
+    /**
+     * Splits a loop of the given size into contiguous blocks and runs each
+     * of them on a separate thread: op(begin, end). If n_threads is 0 or 1
+     * or if there is only a single block, op is called on the calling
+     * thread. The first exception raised by any of the workers is re-thrown
+     * after all threads have joined.
+     *
+     * @warning The reference counts of the blitz++ memory blocks are not
+     * atomic. op should therefore never create views (slices, sub-arrays,
+     * copies of the Array objects) of the arrays shared with the other
+     * threads, including the members of the object it is bound to, nor
+     * receive them by value. It should either use scalar indexing, or create
+     * a private alias of each shared array (see bob::core::array::alias()
+     * in bob/core/array_alias.h) and slice this alias.
+     */
+    template <typename TOp> void thread_loop(TOp op, size_t size,
+        size_t n_threads) {
+
+      std::vector<size_t> begins, ends;
+      thread_split(size, begins, ends, n_threads);
+
+      if (begins.size() <= 1) {
+        if (begins.size() == 1) op(begins[0], ends[0]);
+        return;
+      }
+
+      std::vector<std::exception_ptr> errors(begins.size());
+      boost::shared_array<boost::thread> threads(new boost::thread[begins.size()]);
+
+      for (size_t k=0; k<begins.size(); ++k) {
+        boost::thread t(detail::guard(boost::bind<void>(op, begins[k], ends[k]),
+              &errors[k]));
+        threads[k] = boost::move(t);
+      }
+
+      for (size_t k=0; k<begins.size(); ++k) threads[k].join();
+
+      for (size_t k=0; k<errors.size(); ++k)
+        if (errors[k]) std::rethrow_exception(errors[k]);
+    }
+
+    /**
+     * Same as thread_loop(), but the functor also receives the index of the
+     * block it is processing: op(thread_index, begin, end). This is useful
+     * to address per-thread buffers or partial accumulators. The number of
+     * blocks actually used is returned, so the caller knows how many
+     * per-thread results have to be merged. The same constraints as for
+     * thread_loop() apply to the blitz++ arrays used by op.
+     */
+    template <typename TOp> size_t thread_iloop(TOp op, size_t size,
+        size_t n_threads) {
+
+      std::vector<size_t> begins, ends;
+      thread_split(size, begins, ends, n_threads);
+
+      if (begins.size() <= 1) {
+        if (begins.size() == 1) op((size_t)0, begins[0], ends[0]);
+        return begins.size();
+      }
+
+      std::vector<std::exception_ptr> errors(begins.size());
+      boost::shared_array<boost::thread> threads(new boost::thread[begins.size()]);
+
+      for (size_t k=0; k<begins.size(); ++k) {
+        boost::thread t(detail::guard(boost::bind<void>(op, k, begins[k],
+                ends[k]), &errors[k]));
+        threads[k] = boost::move(t);
+      }
+
+      for (size_t k=0; k<begins.size(); ++k) threads[k].join();
+
+      for (size_t k=0; k<errors.size(); ++k)
+        if (errors[k]) std::rethrow_exception(errors[k]);
+
+      return begins.size();
+    }
+
+  }
+/**
+ * @}
+ */
+}
+
+#endif /* BOB_CORE_PARALLEL_H */
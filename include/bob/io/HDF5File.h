@@ -242,6 +242,31 @@ namespace bob { namespace io {
           return readArray<T,N>(path, 0);
       }
 
+      /**
+       * Reads a floating-point array from the file, which may have been
+       * stored either in single or in double precision, and converts it to
+       * the precision of the given array if needed. The array must have the
+       * right shape. Relative paths are accepted.
+       */
+      template <typename T, int N> void readFloatArray(const std::string& path,
+          blitz::Array<T,N>& value) {
+        const bob::core::array::ElementType stored =
+          describe(path)[0].type.element_type();
+        if (stored == bob::core::array::t_float32 &&
+            bob::core::array::getElementType<T>() != stored) {
+          blitz::Array<float,N> tmp(value.shape());
+          readArray(path, 0, tmp);
+          value = blitz::cast<T>(tmp);
+        }
+        else if (stored == bob::core::array::t_float64 &&
+            bob::core::array::getElementType<T>() != stored) {
+          blitz::Array<double,N> tmp(value.shape());
+          readArray(path, 0, tmp);
+          value = blitz::cast<T>(tmp);
+        }
+        else readArray(path, 0, value);
+      }
+
       /**
        * Modifies the value of a scalar inside the file. Relative paths are
        * accepted.
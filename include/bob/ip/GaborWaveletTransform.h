@@ -29,7 +29,11 @@
 #include "bob/io/HDF5File.h"
 #include "bob/sp/FFT2D.h"
 #include <vector>
+#include <list>
+#include <map>
 #include <utility>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 
 namespace bob {
 
@@ -69,6 +73,27 @@ namespace bob {
           blitz::Array<std::complex<double>,2>& transformed_frequency_domain_image
         ) const;
 
+        //! Gabor transforms the given image into a single precision image (in frequency domain)
+        void transform(
+          const blitz::Array<std::complex<double>,2>& frequency_domain_image,
+          blitz::Array<std::complex<float>,2>& transformed_frequency_domain_image
+        ) const;
+
+        //! Returns the number of (non-zero) pixels of the Gabor wavelet in frequency domain
+        unsigned numberOfPixels() const {return m_kernel_pixel.size();}
+
+        //! Returns the number of bytes used to store the Gabor wavelet
+        size_t memorySize() const {return sizeof(*this) + m_kernel_pixel.size() * sizeof(std::pair<blitz::TinyVector<unsigned,2>, double>);}
+
+        //! \brief Computes the (un-scaled) response of the Gabor wavelet at a single position (y,x) of the image.
+        //! The y_phases(u) and x_phases(v) must contain exp(2 pi i u y / height) and exp(2 pi i v x / width).
+        //! The result needs to be divided by height*width to be identical to the inverse FFT of the transformed image.
+        std::complex<double> response(
+          const blitz::Array<std::complex<double>,2>& frequency_domain_image,
+          const blitz::Array<std::complex<double>,1>& y_phases,
+          const blitz::Array<std::complex<double>,1>& x_phases
+        ) const;
+
       private:
         // the Gabor wavelet, stored as pairs of indices and values
         std::vector<std::pair<blitz::TinyVector<unsigned,2>, double> > m_kernel_pixel;
@@ -78,6 +103,70 @@ namespace bob {
     }; // class GaborKernel
 
 
+    class GaborWaveletTransform;
+
+    //! \brief This class is a cache of Gabor kernel banks (i.e., the Gabor wavelets of a GaborWaveletTransform for a given image resolution).
+    //! The banks are identified by the image resolution and the parameters of the Gabor wavelet family,
+    //! so that a cache can be shared by several GaborWaveletTransform objects, and it can be used from several threads.
+    //! When the memory used by the kernel banks exceeds the memory budget, the least recently used banks are removed from the cache.
+    class GaborKernelCache {
+
+      public:
+        typedef std::vector<GaborKernel> KernelBank;
+
+        //! Creates an empty cache with the given memory budget (in bytes)
+        GaborKernelCache(const size_t memory_budget = 256 * 1024 * 1024);
+
+        //! \brief Returns the kernel bank of the given Gabor wavelet transform for the given resolution.
+        //! The bank is generated and put into the cache, if it was not cached yet.
+        boost::shared_ptr<const KernelBank> get(
+          const bob::ip::GaborWaveletTransform& gwt,
+          const blitz::TinyVector<unsigned,2>& resolution
+        );
+
+        //! The memory budget of the cache (in bytes)
+        size_t memoryBudget() const;
+        //! Sets the memory budget (in bytes), removing the least recently used banks if required
+        void setMemoryBudget(const size_t memory_budget);
+        //! The memory used by the cached kernel banks (in bytes)
+        size_t memory() const;
+        //! The number of cached kernel banks
+        size_t size() const;
+
+        //! The number of requests that were served from the cache
+        size_t hits() const;
+        //! The number of requests for which the kernel bank had to be generated
+        size_t misses() const;
+        //! Resets the hit and miss counters
+        void resetCounters();
+
+        //! Removes all kernel banks from the cache
+        void clear();
+
+      private:
+        // the key of a kernel bank: the resolution and the parameters of the Gabor wavelet family
+        typedef std::vector<double> Key;
+        struct Entry {
+          boost::shared_ptr<const KernelBank> bank;
+          size_t memory;
+          std::list<Key>::iterator lru;
+        };
+
+        // removes the least recently used banks until the memory budget is met (the most recent bank is always kept)
+        void evict();
+
+        size_t m_memory_budget;
+        size_t m_memory;
+        size_t m_hits;
+        size_t m_misses;
+        // the keys, most recently used first
+        std::list<Key> m_lru;
+        std::map<Key, Entry> m_entries;
+        mutable boost::mutex m_mutex;
+
+    }; // class GaborKernelCache
+
+
     //! \brief The GaborWaveletTransform class computes a Gabor wavelet transform of the given image.
     //! It computes either the complete Gabor wavelet transformed image (short: trafo image) with
     //! number_of_scales * number_of_orientations layers, or a Gabor jet image that includes
@@ -114,7 +203,14 @@ namespace bob {
         void generateKernels(blitz::TinyVector<unsigned,2> resolution);
 
         //! Returns the Gabor kernel for the given index
-        const bob::ip::GaborKernel& getKernel(unsigned index) {if (index < m_gabor_kernels.size()) return m_gabor_kernels[index]; else throw bob::core::Exception();}
+        const bob::ip::GaborKernel& getKernel(unsigned index) {if (index < m_gabor_kernels->size()) return (*m_gabor_kernels)[index]; else throw bob::core::Exception();}
+
+        //! \brief Sets the cache that the kernels are taken from when the image resolution changes.
+        //! The cache might be shared with other Gabor wavelet transforms. Set an empty pointer to disable caching.
+        void setKernelCache(const boost::shared_ptr<bob::ip::GaborKernelCache>& kernel_cache) {m_kernel_cache = kernel_cache;}
+
+        //! Returns the kernel cache (might be empty)
+        const boost::shared_ptr<bob::ip::GaborKernelCache>& getKernelCache() const {return m_kernel_cache;}
 
         //! generates the frequency kernels as images
         blitz::Array<double,3> kernelImages() const;
@@ -133,10 +229,35 @@ namespace bob {
         double pow_of_k() const {return m_pow_of_k;}
         bool dc_free() const {return m_dc_free;}
 
-        //! performs Gabor wavelet transform and returns vector of complex images
+        //! \brief performs Gabor wavelet transform and returns vector of complex images
+        //! The inverse FFTs of the kernels are distributed over the given number of threads
+        void performGWT(
+          const blitz::Array<std::complex<double>,2>& gray_image,
+          blitz::Array<std::complex<double>,3>& trafo_image,
+          const size_t n_threads = 1
+        );
+
+        //! \brief performs Gabor wavelet transform of a real image and returns vector of complex images
+        //! The spectrum of the image is computed with a real-input FFT
+        void performGWT(
+          const blitz::Array<double,2>& gray_image,
+          blitz::Array<std::complex<double>,3>& trafo_image,
+          const size_t n_threads = 1
+        );
+
+        //! \brief performs Gabor wavelet transform and returns vector of complex images in single precision
+        //! The inverse FFTs are computed in single precision, which is faster and halves the memory
         void performGWT(
           const blitz::Array<std::complex<double>,2>& gray_image,
-          blitz::Array<std::complex<double>,3>& trafo_image
+          blitz::Array<std::complex<float>,3>& trafo_image,
+          const size_t n_threads = 1
+        );
+
+        //! \brief performs Gabor wavelet transform of a real image and returns vector of complex images in single precision
+        void performGWT(
+          const blitz::Array<double,2>& gray_image,
+          blitz::Array<std::complex<float>,3>& trafo_image,
+          const size_t n_threads = 1
         );
 
         //! \brief performs Gabor wavelet transform and creates 4D image
@@ -144,7 +265,17 @@ namespace bob {
         void computeJetImage(
           const blitz::Array<std::complex<double>,2>& gray_image,
           blitz::Array<double,4>& jet_image,
-          bool do_normalize = true
+          bool do_normalize = true,
+          const size_t n_threads = 1
+        );
+
+        //! \brief performs Gabor wavelet transform of a real image and creates 4D image
+        //! (absolute part and phase part)
+        void computeJetImage(
+          const blitz::Array<double,2>& gray_image,
+          blitz::Array<double,4>& jet_image,
+          bool do_normalize = true,
+          const size_t n_threads = 1
         );
 
         //! \brief performs Gabor wavelet transform and creates 3D image
@@ -152,6 +283,36 @@ namespace bob {
         void computeJetImage(
           const blitz::Array<std::complex<double>,2>& gray_image,
           blitz::Array<double,3>& jet_image,
+          bool do_normalize = true,
+          const size_t n_threads = 1
+        );
+
+        //! \brief performs Gabor wavelet transform of a real image and creates 3D image
+        //! (absolute parts of the responses only)
+        void computeJetImage(
+          const blitz::Array<double,2>& gray_image,
+          blitz::Array<double,3>& jet_image,
+          bool do_normalize = true,
+          const size_t n_threads = 1
+        );
+
+        //! \brief performs Gabor wavelet transform at the given positions only and creates 3D array
+        //! (one Gabor jet with absolute part and phase part for each of the (y,x) positions)
+        //! When only few positions are requested, the responses are evaluated directly from the
+        //! spectrum of the image, without computing the inverse FFT for each kernel
+        void computeJets(
+          const blitz::Array<std::complex<double>,2>& gray_image,
+          const blitz::Array<int,2>& positions,
+          blitz::Array<double,3>& jets,
+          bool do_normalize = true
+        );
+
+        //! \brief performs Gabor wavelet transform at the given positions only and creates 2D array
+        //! (absolute parts of the responses only, one Gabor jet for each of the (y,x) positions)
+        void computeJets(
+          const blitz::Array<std::complex<double>,2>& gray_image,
+          const blitz::Array<int,2>& positions,
+          blitz::Array<double,2>& jets,
           bool do_normalize = true
         );
 
@@ -165,12 +326,44 @@ namespace bob {
 
         void computeKernelFrequencies();
 
+        // generates the Gabor kernels for the given resolution
+        boost::shared_ptr<const std::vector<GaborKernel> > createKernels(const blitz::TinyVector<unsigned,2>& resolution) const;
+        friend class GaborKernelCache;
+
+        // computes the spectrum of the given image into m_frequency_image (generating the kernels, if required)
+        void computeSpectrum(const blitz::Array<std::complex<double>,2>& gray_image);
+        void computeSpectrum(const blitz::Array<double,2>& gray_image);
+
+        // allocates the per-thread buffers
+        void prepareBuffers(const size_t n_threads, const bool single_precision = false);
+
+        // computes the layers [begin, end) of the trafo image, using the buffers of the given thread
+        void transformLayers(blitz::Array<std::complex<double>,3>& trafo_image, const size_t thread, const size_t begin, const size_t end);
+        void transformLayersFloat(blitz::Array<std::complex<float>,3>& trafo_image, const size_t thread, const size_t begin, const size_t end);
+
+        // computes the layers [begin, end) of the jet image, using the buffers of the given thread
+        void jetLayers(blitz::Array<double,4>& jet_image, const size_t thread, const size_t begin, const size_t end);
+        void absJetLayers(blitz::Array<double,3>& jet_image, const size_t thread, const size_t begin, const size_t end);
+
+        // implementations of the public functions, once the spectrum is computed
+        void performGWT_(blitz::Array<std::complex<double>,3>& trafo_image, const size_t n_threads);
+        void performGWT_(blitz::Array<std::complex<float>,3>& trafo_image, const size_t n_threads);
+        void computeJetImage_(blitz::Array<double,4>& jet_image, bool do_normalize, const size_t n_threads);
+        void computeJetImage_(blitz::Array<double,3>& jet_image, bool do_normalize, const size_t n_threads);
+
+        // computes the complex responses of all kernels at the given positions into m_responses
+        void computeResponses(
+          const blitz::Array<std::complex<double>,2>& gray_image,
+          const blitz::Array<int,2>& positions
+        );
+
         double m_sigma;
         double m_pow_of_k;
         double m_k_max;
         double m_k_fac;
         bool m_dc_free;
-        std::vector<GaborKernel> m_gabor_kernels;
+        boost::shared_ptr<const std::vector<GaborKernel> > m_gabor_kernels;
+        boost::shared_ptr<bob::ip::GaborKernelCache> m_kernel_cache;
 
         std::vector<blitz::TinyVector<double,2> > m_kernel_frequencies;
 
@@ -179,6 +372,14 @@ namespace bob {
 
         blitz::Array<std::complex<double>,2> m_temp_array, m_frequency_image;
 
+        // per-thread buffers for the transformed spectra
+        std::vector<blitz::Array<std::complex<double>,2> > m_thread_buffers;
+        std::vector<blitz::Array<std::complex<float>,2> > m_thread_float_buffers;
+
+        // buffers for the sparse computation of Gabor jets
+        blitz::Array<std::complex<double>,2> m_responses;
+        blitz::Array<std::complex<double>,1> m_y_phases, m_x_phases;
+
         //! The number of scales (levels, frequencies) of this family
         unsigned m_number_of_scales;
         //! The number of directions (orientations) of this family
@@ -81,6 +81,13 @@ namespace bob { namespace machine {
       //! performs some checks before calling the forward_ method
       void forward (const blitz::Array<double,1>& input, blitz::Array<double,1>& output) const;
 
+      //! \brief computes the BIC probability scores for the given input difference vectors (one vector per row)
+      //! The projections into the subspaces are computed for blocks of vectors using matrix products, and the vectors can be split over several threads.
+      void forward_(const blitz::Array<double,2>& input, blitz::Array<double,1>& output, const size_t n_threads = 1) const;
+
+      //! performs some checks before calling the batched forward_ method
+      void forward (const blitz::Array<double,2>& input, blitz::Array<double,1>& output, const size_t n_threads = 1) const;
+
       //! sets the IEC vectors of the given class
       void setIEC(bool clazz, const blitz::Array<double,1>& mean, const blitz::Array<double,1>& variances, bool copy_data = false);
 
@@ -104,6 +111,9 @@ namespace bob { namespace machine {
       //! initializes internal data storages for the given class
       void initialize(bool clazz, int input_length, int projected_length);
 
+      //! computes the scores of the input vectors [begin, end), using the given (contiguous) projection matrices
+      void forwardRange(const blitz::Array<double,2>& input, const blitz::Array<double,2>& Phi_I, const blitz::Array<double,2>& Phi_E, blitz::Array<double,1>& output, const size_t begin, const size_t end) const;
+
       //! project data?
       bool m_project_data;
 
@@ -64,6 +64,12 @@ namespace bob { namespace machine {
       void forward(const blitz::Array<double,1>& input, double& output) const;
       void forward_(const blitz::Array<double,1>& input, double& output) const;
 
+      /// Output the log likelihood ratios of a set of samples (one per row),
+      /// using the batch log likelihood computation of both GMMs. The samples
+      /// can be split over n_threads threads
+      void forward(const blitz::Array<double,2>& input, blitz::Array<double,1>& output, const size_t n_threads = 1) const;
+      void forward_(const blitz::Array<double,2>& input, blitz::Array<double,1>& output, const size_t n_threads = 1) const;
+
       /// Get a pointer to the client or UBM GMMMachine
       GMMMachine* getGMMClient() const;
       GMMMachine* getGMMUBM() const;
@@ -239,20 +239,78 @@ class GMMMachine: public Machine<blitz::Array<double,1>, double>
      * @warning Dimension of the input is not checked
      */ 
     void forward_(const blitz::Array<double,1>& input, double& output) const;
+
+    /**
+     * Output the log likelihoods of a set of samples, given as the rows of
+     * the input (overrides Machine::forward). The Gaussian log likelihoods
+     * of blocks of samples are computed with two matrix products, and the
+     * samples can be split over n_threads threads.
+     * Dimensions of the parameters are checked
+     */
+    void forward(const blitz::Array<double,2>& input, blitz::Array<double,1>& output, const size_t n_threads = 1) const;
+
+    /**
+     * Output the log likelihoods of a set of samples, given as the rows of
+     * the input (overrides Machine::forward_). The Gaussian log likelihoods
+     * of blocks of samples are computed with two matrix products, and the
+     * samples can be split over n_threads threads.
+     * @warning Dimensions of the parameters are not checked
+     */
+    void forward_(const blitz::Array<double,2>& input, blitz::Array<double,1>& output, const size_t n_threads = 1) const;
+
+    /**
+     * Output the log likelihoods of a set of single precision samples, given
+     * as the rows of the input. The Gaussian log likelihoods are computed in
+     * single precision, which halves the memory traffic of the matrix
+     * products, and are combined in double precision. The samples can be
+     * split over n_threads threads.
+     * Dimensions of the parameters are checked
+     */
+    void forward(const blitz::Array<float,2>& input, blitz::Array<float,1>& output, const size_t n_threads = 1) const;
+
+    /**
+     * Output the log likelihoods of a set of single precision samples, given
+     * as the rows of the input (see above).
+     * @warning Dimensions of the parameters are not checked
+     */
+    void forward_(const blitz::Array<float,2>& input, blitz::Array<float,1>& output, const size_t n_threads = 1) const;
     
     /**
      * Accumulates the GMM statistics over a set of samples.
      * @see bool accStatistics(const blitz::Array<double,1> &x, GMMStats stats)
+     * The buffers are local to the call, such that several threads can 
+     * accumulate statistics concurrently (into different GMMStats).
+     * The samples can be split over n_threads threads, each accumulating 
+     * its own statistics, which are then added to stats.
      * Dimensions of the parameters are checked
      */
-    void accStatistics(const blitz::Array<double,2>& input, GMMStats &stats) const;
+    void accStatistics(const blitz::Array<double,2>& input, GMMStats &stats, const size_t n_threads = 1) const;
 
     /**
-     * Accumulates the GMM statistics over a set of samples.
+     * Accumulates the GMM statistics over a set of samples (thread-safe).
      * @see bool accStatistics(const blitz::Array<double,1> &x, GMMStats stats)
      * @warning Dimensions of the parameters are not checked
      */
-    void accStatistics_(const blitz::Array<double,2>& input, GMMStats &stats) const;
+    void accStatistics_(const blitz::Array<double,2>& input, GMMStats &stats, const size_t n_threads = 1) const;
+
+    /**
+     * Accumulates the GMM statistics over a set of single precision samples
+     * (one per row). The responsibilities and the statistics of blocks of
+     * samples are computed in single precision, with matrix products, and
+     * the statistics of each block are added to the given statistics in
+     * double precision. Hence, the rounding errors of the single precision
+     * sums are bounded by the size of a block, whatever the number of
+     * samples. The samples can be split over n_threads threads.
+     * Dimensions of the parameters are checked
+     */
+    void accStatistics(const blitz::Array<float,2>& input, GMMStats &stats, const size_t n_threads = 1) const;
+
+    /**
+     * Accumulates the GMM statistics over a set of single precision samples
+     * (see above).
+     * @warning Dimensions of the parameters are not checked
+     */
+    void accStatistics_(const blitz::Array<float,2>& input, GMMStats &stats, const size_t n_threads = 1) const;
 
     /**
      * Accumulate the GMM statistics for this sample.
@@ -287,12 +345,14 @@ class GMMMachine: public Machine<blitz::Array<double,1>, double>
     { return m_n_gaussians; }
 
     /**
-     * Save to a Configuration
+     * Save to a Configuration. If single_precision is set, the weights,
+     * means and variances are stored as float32 datasets.
      */
-    void save(bob::io::HDF5File& config) const;
+    void save(bob::io::HDF5File& config, const bool single_precision = false) const;
     
     /**
-     * Load from a Configuration
+     * Load from a Configuration (parameters stored either in single or in
+     * double precision)
      */
     void load(bob::io::HDF5File& config);
 
@@ -309,6 +369,44 @@ class GMMMachine: public Machine<blitz::Array<double,1>, double>
      * Copy another GMMMachine
      */
     void copy(const GMMMachine&);
+
+    /**
+     * Computes the terms of the weighted Gaussian log likelihoods of a batch
+     * of samples: the Gaussian precisions (scaled by -0.5), the means scaled
+     * by the precisions and the constant terms
+     */
+    void likelihoodTerms(blitz::Array<double,2>& precisions, blitz::Array<double,2>& scaled_means, blitz::Array<double,1>& constants) const;
+
+    /**
+     * Computes the log likelihoods of the samples [begin, end), given the
+     * terms returned by likelihoodTerms()
+     */
+    void forwardRange(const blitz::Array<double,2>& input, const blitz::Array<double,2>& precisions, const blitz::Array<double,2>& scaled_means, const blitz::Array<double,1>& constants, blitz::Array<double,1>& output, const size_t begin, const size_t end) const;
+
+    /**
+     * Computes the weighted Gaussian log likelihoods of a block of single
+     * precision samples, and returns the log likelihoods of the samples
+     */
+    void blockLikelihoods(const blitz::Array<float,2>& x, const blitz::Array<float,2>& precisions, const blitz::Array<float,2>& scaled_means, const blitz::Array<double,1>& constants, blitz::Array<float,2>& squares, blitz::Array<float,2>& likelihoods, blitz::Array<double,1>& log_likelihoods) const;
+
+    /**
+     * Computes the log likelihoods of the single precision samples
+     * [begin, end), given the (rounded) terms returned by likelihoodTerms()
+     */
+    void forwardRangeFloat(const blitz::Array<float,2>& input, const blitz::Array<float,2>& precisions, const blitz::Array<float,2>& scaled_means, const blitz::Array<double,1>& constants, blitz::Array<float,1>& output, const size_t begin, const size_t end) const;
+
+    /**
+     * Accumulates the statistics of the samples [begin, end) into stats
+     * (resp. stats[thread])
+     */
+    void accStatisticsRange(const blitz::Array<double,2>& input, GMMStats& stats, const size_t begin, const size_t end) const;
+    void accStatisticsShard(const blitz::Array<double,2>& input, std::vector<GMMStats>& stats, const size_t thread, const size_t begin, const size_t end) const;
+
+    /**
+     * Accumulates the statistics of the single precision samples
+     * [begin, end) into stats[thread]
+     */
+    void accStatisticsRangeFloat(const blitz::Array<float,2>& input, const blitz::Array<float,2>& precisions, const blitz::Array<float,2>& scaled_means, const blitz::Array<double,1>& constants, std::vector<GMMStats>& stats, const size_t thread, const size_t begin, const size_t end) const;
     
     /**
      * The number of Gaussian components
@@ -352,6 +450,14 @@ class GMMMachine: public Machine<blitz::Array<double,1>, double>
      */
     void accStatisticsInternal(const blitz::Array<double,1> &x, 
       GMMStats &stats, const double log_likelihood) const;
+
+    /**
+     * Same as above, with the given buffers instead of the cache members
+     */
+    void accStatisticsInternal(const blitz::Array<double,1> &x, 
+      GMMStats &stats, const double log_likelihood,
+      const blitz::Array<double,1>& log_weighted_gaussian_likelihoods,
+      blitz::Array<double,1>& P, blitz::Array<double,2>& Px) const;
     
 
     /// Some cache arrays to avoid re-allocation when computing log-likelihoods
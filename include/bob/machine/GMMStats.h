@@ -125,12 +125,14 @@ class GMMStats {
     blitz::Array<double,2> sumPxx;
 
     /**
-     * Save to a Configuration
+     * Save to a Configuration. If single_precision is set, the statistics
+     * are stored as float32 datasets, which halves their size on disk.
      */
-    void save(bob::io::HDF5File& config) const;
+    void save(bob::io::HDF5File& config, const bool single_precision = false) const;
     
     /**
-     * Load from a Configuration
+     * Load from a Configuration (statistics stored either in single or in
+     * double precision)
      */
     void load(bob::io::HDF5File& config);
     
@@ -0,0 +1,87 @@
+/**
+ * @file bob/machine/GaborGraphGallery.h
+ * @date Mon Oct 19 19:03:25 2026 +0200
+ *
+ * @brief Computes the similarities of many probe Gabor graphs against a
+ * gallery of Gabor graphs at once.
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOB_MACHINE_GABOR_GRAPH_GALLERY_H
+#define BOB_MACHINE_GABOR_GRAPH_GALLERY_H
+
+#include <blitz/array.h>
+#include "bob/machine/GaborJetSimilarities.h"
+
+namespace bob { namespace machine {
+
+  //! \brief This class stores a gallery of Gabor graphs (of the same topology) and computes the full similarity matrix of the gallery against a set of probe graphs.
+  //! The absolute values and the phases of the Gabor jets are stored once, in two separate contiguous arrays, such that the similarity loops run over contiguous memory.
+  //! For the SCALAR_PRODUCT similarity, all the similarities are computed with a single matrix product.
+  //! The similarity of a gallery graph and a probe graph is identical to the one returned by GaborGraphMachine::similarity().
+  class GaborGraphGallery {
+    public:
+      //! Creates an empty gallery, where graphs are compared with the given Gabor jet similarity function
+      GaborGraphGallery(const bob::machine::GaborJetSimilarity& jet_similarity_function);
+
+      //! Sets the gallery graphs, given as a 3D array (graphs x nodes x jets) of Gabor jets without phases.
+      //! This is only possible for the SCALAR_PRODUCT and CANBERRA similarity functions.
+      void setGraphs(const blitz::Array<double,3>& graph_jets);
+
+      //! Sets the gallery graphs, given as a 4D array (graphs x nodes x 2 x jets) of Gabor jets with phases.
+      //! The phases are only stored for disparity-like similarity functions.
+      void setGraphs(const blitz::Array<double,4>& graph_jets);
+
+      //! Returns the number of graphs in the gallery
+      int numberOfGraphs() const {return m_abs.extent(0);}
+
+      //! Returns the number of nodes of the graphs
+      int numberOfNodes() const {return m_abs.extent(1);}
+
+      //! Returns the length of the Gabor jets
+      int numberOfJets() const {return m_abs.extent(2);}
+
+      //! Computes the similarities of the gallery graphs and the given probe graphs (without phases), where similarities(g,p) is the similarity of the gallery graph g and the probe graph p.
+      //! The computation is split over the given number of threads.
+      void similarity(const blitz::Array<double,3>& probe_graph_jets, blitz::Array<double,2>& similarities, const size_t n_threads = 1) const;
+
+      //! Computes the similarities of the gallery graphs and the given probe graphs (with phases), where similarities(g,p) is the similarity of the gallery graph g and the probe graph p.
+      //! The computation is split over the given number of threads.
+      void similarity(const blitz::Array<double,4>& probe_graph_jets, blitz::Array<double,2>& similarities, const size_t n_threads = 1) const;
+
+    private:
+      // splits the given graphs into contiguous absolute values and phases
+      void split(const blitz::Array<double,4>& graph_jets, blitz::Array<double,3>& abs, blitz::Array<double,3>& phases) const;
+
+      // checks the dimensions of the probes and the output
+      void check(const blitz::Array<double,3>& probe_abs, const blitz::Array<double,2>& similarities) const;
+
+      // computes the similarities of the gallery graphs [begin, end) with all probes
+      void similarityRange(const blitz::Array<double,3>& probe_abs, const blitz::Array<double,3>& probe_phases, blitz::Array<double,2>& similarities, const size_t begin, const size_t end) const;
+
+      // the similarity function
+      bob::machine::GaborJetSimilarity m_similarity;
+
+      // absolute values of the gallery Gabor jets (graphs x nodes x jets)
+      blitz::Array<double,3> m_abs;
+
+      // phases of the gallery Gabor jets (graphs x nodes x jets); only used for disparity-like similarities
+      blitz::Array<double,3> m_phases;
+  };
+
+} }
+
+#endif // BOB_MACHINE_GABOR_GRAPH_GALLERY_H
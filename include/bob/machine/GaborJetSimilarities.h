@@ -30,6 +30,8 @@
 
 namespace bob { namespace machine {
 
+  class GaborGraphGallery;
+
   //! Class to compute Gabor jet similarities
   class GaborJetSimilarity{
     public:
@@ -58,6 +60,9 @@ namespace bob { namespace machine {
       //! returns the disparity vector estimated during the last call of similarity; only valid for disparity types
       blitz::TinyVector<double,2> disparity() const {return m_disparity;}
 
+      //! returns the type of this Gabor jet similarity function
+      SimilarityType type() const {return m_type;}
+
       //! \brief saves the parameters of this Gabor jet similarity to file
       void save(bob::io::HDF5File& file) const;
 
@@ -65,6 +70,8 @@ namespace bob { namespace machine {
       void load(bob::io::HDF5File& file);
 
     private:
+      friend class GaborGraphGallery;
+
       // members for all similarity functions
       SimilarityType m_type;
 
@@ -73,10 +80,13 @@ namespace bob { namespace machine {
 
       // initializes the internal memory to be used for disparity-like Gabor jet similarities
       void init();
+      // computes the disparity-like similarity of the given absolute values and phases of two Gabor jets;
+      // all intermediate values are written to the given buffers, so that this function is reentrant
+      double similarity(const double* abs1, const double* phase1, const double* abs2, const double* phase2, double* confidences, double* phase_differences, blitz::TinyVector<double,2>& disparity) const;
       // computes confidences from the given Gabor jets
-      void compute_confidences(const blitz::Array<double,2>& jet1, const blitz::Array<double,2>& jet2) const;
-      // computes the disparity using the m_confidences and m_phase_differences values
-      void compute_disparity() const;
+      void compute_confidences(const double* abs1, const double* phase1, const double* abs2, const double* phase2, double* confidences, double* phase_differences) const;
+      // computes the disparity using the given confidences and phase differences
+      void compute_disparity(const double* confidences, const double* phase_differences, blitz::TinyVector<double,2>& disparity) const;
 
       mutable blitz::TinyVector<double,2> m_disparity;
 
@@ -0,0 +1,206 @@
+/**
+ * @file bob/machine/GalleryIndex.h
+ * @date Mon Oct 19 18:12:47 2026 +0200
+ *
+ * @brief An index of enrolled model vectors, which answers identification
+ * queries (1:N search) with the exact k best scoring models of each probe.
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOB_MACHINE_GALLERYINDEX_H
+#define BOB_MACHINE_GALLERYINDEX_H
+
+#include <blitz/array.h>
+#include <vector>
+#include <map>
+#include <utility>
+#include <stdint.h>
+#include "bob/io/HDF5File.h"
+#include "bob/machine/LinearMachine.h"
+
+namespace bob { namespace machine {
+
+  /**
+   * A gallery of enrolled models, each of them represented by a vector
+   * (e.g. a GMM mean supervector, the projection of a sample by a
+   * LinearMachine or the concatenated jets of a Gabor graph) and by an
+   * integer identifier.
+   *
+   * Model and probe vectors are optionally projected with an affine
+   * transform (e.g. a whitening LinearMachine) and L2-normalized, before
+   * being compared with a dot product (which is the cosine similarity when
+   * the vectors are normalized). The model vectors are stored in single
+   * precision, in a contiguous matrix.
+   *
+   * Search queries are processed by batches of probes: the scores of a
+   * block of probes against a tile of the gallery are computed with a
+   * single matrix product (BLAS), and the k best scores of each probe are
+   * tracked with a heap. The gallery can be split across several threads.
+   */
+  class GalleryIndex {
+
+    public: //api
+
+      /**
+       * Builds an empty gallery for vectors of the given size. If normalize
+       * is set, the model and probe vectors are L2-normalized.
+       */
+      GalleryIndex(const size_t n_inputs=0, const bool normalize=true);
+
+      /**
+       * Builds an empty gallery, where the model and probe vectors are first
+       * projected with the given LinearMachine (e.g. a whitening or a PCA
+       * projection), before being optionally L2-normalized. The machine
+       * must have a linear activation.
+       */
+      GalleryIndex(const bob::machine::LinearMachine& projection,
+          const bool normalize=true);
+
+      /**
+       * Copies another gallery
+       */
+      GalleryIndex(const GalleryIndex& other);
+
+      /**
+       * Loads a gallery from an HDF5 file
+       */
+      GalleryIndex(bob::io::HDF5File& config);
+
+      virtual ~GalleryIndex();
+
+      /**
+       * Assigns from a different gallery
+       */
+      GalleryIndex& operator=(const GalleryIndex& other);
+
+      /**
+       * Loads/Saves the gallery from/to an HDF5 file. Only the models
+       * currently enrolled are saved.
+       */
+      void load(bob::io::HDF5File& config);
+      void save(bob::io::HDF5File& config) const;
+
+      /**
+       * Size of the vectors given to add() and search()
+       */
+      inline size_t getNInputs() const { return m_n_inputs; }
+
+      /**
+       * Size of the stored vectors, after the (optional) projection
+       */
+      inline size_t getDimension() const { return m_dimension; }
+
+      /**
+       * Number of enrolled models
+       */
+      inline size_t size() const { return m_ids.size(); }
+
+      /**
+       * Tells if the vectors are L2-normalized
+       */
+      inline bool getNormalize() const { return m_normalize; }
+
+      /**
+       * Tells if a model with the given identifier is enrolled
+       */
+      bool contains(const int64_t id) const;
+
+      /**
+       * Enrolls a model. If a model with the same identifier already
+       * exists, it is replaced.
+       */
+      void add(const int64_t id, const blitz::Array<double,1>& model);
+
+      /**
+       * Enrolls several models at once, one per row of models.
+       */
+      void add(const blitz::Array<int64_t,1>& ids,
+          const blitz::Array<double,2>& models);
+
+      /**
+       * Removes the model with the given identifier. Returns false if there
+       * is no such model.
+       */
+      bool remove(const int64_t id);
+
+      /**
+       * Removes all the models
+       */
+      void clear();
+
+      /**
+       * Reserves the memory for the given number of models
+       */
+      void reserve(const size_t n_models);
+
+      /**
+       * Returns the identifiers of the enrolled models, in storage order
+       */
+      const std::vector<int64_t>& getIds() const { return m_ids; }
+
+      /**
+       * Returns the stored (projected and normalized) vector of a model
+       */
+      blitz::Array<float,1> getModel(const int64_t id) const;
+
+      /**
+       * Searches the k best scoring models of each probe (one per row of
+       * probes). ids and scores are resized to n_probes x min(k, size()),
+       * and each of their rows is sorted by decreasing score (ties are
+       * broken by increasing identifier).
+       */
+      void search(const blitz::Array<double,2>& probes, const size_t k,
+          blitz::Array<int64_t,2>& ids, blitz::Array<double,2>& scores,
+          const size_t n_threads=1) const;
+
+    private: //methods
+
+      typedef std::pair<float,int64_t> entry_type;
+
+      /**
+       * Projects and normalizes the input vectors (one per row) into output
+       */
+      void preprocess(const blitz::Array<double,2>& input,
+          blitz::Array<float,2>& output) const;
+
+      /**
+       * Appends a preprocessed vector, or replaces the existing one
+       */
+      void insert(const int64_t id, const blitz::Array<float,1>& model);
+
+      /**
+       * Tracks the k best scores of all the probes against the models
+       * [begin, end), in heaps[t][p] for probe p.
+       */
+      void searchRange(const blitz::Array<float,2>& probes, const size_t k,
+          std::vector<std::vector<std::vector<entry_type> > >& heaps,
+          const size_t t, const size_t begin, const size_t end) const;
+
+    private: //representation
+
+      size_t m_n_inputs; ///< size of the input vectors
+      size_t m_dimension; ///< size of the stored vectors
+      bool m_normalize; ///< L2-normalization of the vectors
+      blitz::Array<double,2> m_weight; ///< projection (may be empty)
+      blitz::Array<double,1> m_bias; ///< projection bias
+      blitz::Array<float,2> m_models; ///< one model per row (capacity x dim)
+      std::vector<int64_t> m_ids; ///< identifier of each stored model
+      std::map<int64_t,size_t> m_rows; ///< row of each identifier
+  };
+
+}}
+
+#endif /* BOB_MACHINE_GALLERYINDEX_H */
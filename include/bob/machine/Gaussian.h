@@ -196,12 +196,27 @@ class Gaussian: public Machine<blitz::Array<double,1>, double>
     { output = logLikelihood_(x); }
 
     /**
-     * Saves to a Configuration
+     * Computes the log likelihoods of a set of samples (one per row)
+     * (see Machine::forward)
      */
-    void save(bob::io::HDF5File& config) const;
+    using Machine<blitz::Array<double,1>, double>::forward;
+    using Machine<blitz::Array<double,1>, double>::forward_;
+
+    /**
+     * The log likelihood computation does not use any internal buffer, so a
+     * set of samples can be split over several threads
+     */
+    bool isThreadSafe() const { return true; }
+
+    /**
+     * Saves to a Configuration. If single_precision is set, the mean and
+     * variance arrays are stored as float32 datasets.
+     */
+    void save(bob::io::HDF5File& config, const bool single_precision = false) const;
     
     /**
-     * Loads from a Configuration
+     * Loads from a Configuration (arrays stored either in single or in
+     * double precision)
      */
     void load(bob::io::HDF5File& config);
 
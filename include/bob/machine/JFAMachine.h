@@ -30,8 +30,12 @@
 #include "bob/machine/LinearScoring.h"
 
 #include <boost/shared_ptr.hpp>
+#include <vector>
 
 namespace bob { namespace machine {
+
+class JFAMachine;
+class ModelBank;
   
 /**
  * A JFA Base machine which contains U, V and D matrices
@@ -214,8 +218,72 @@ class JFABaseMachine
       */
     void setD(const blitz::Array<double,1>& d);
 
+    /**
+      * Updates the scoring state cached by this machine, which only depends
+      * on U and on the variances of the UBM: U^T.Sigma^-1 and the products
+      * U_{c}^T.Sigma_{c}^-1.U_{c} of each Gaussian component c.
+      * This is automatically done by the setters, load() and resize(), but
+      * should be called explicitly after the UBM is modified in place, or
+      * after U is modified through the reference returned by updateU().
+      */
+    void precompute();
+
+    /**
+      * Returns the cached U^T.Sigma^-1 matrix (ru x CD)
+      */
+    const blitz::Array<double,2>& getUtSigmaInv() const
+    { return m_cache_UtSigmaInv; }
+
+    /**
+      * Returns the cached U_{c}^T.Sigma_{c}^-1.U_{c} matrices (C x ru x ru)
+      */
+    const blitz::Array<double,3>& getUProd() const
+    { return m_cache_UProd; }
+
+    /**
+      * Computes the scores of several probes against several models sharing 
+      * this JFABaseMachine. The channel factors x of each probe are 
+      * estimated only once, and the scores are obtained through matrix
+      * products. scores should be of size (#models x #probes). The probes
+      * are split into blocks that are processed by n_threads threads.
+      * @warning The JFAMachines should all be attached to this machine
+      */
+    void forward(const std::vector<boost::shared_ptr<const bob::machine::JFAMachine> >& models,
+      const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& probes,
+      blitz::Array<double,2>& scores, const size_t n_threads=1) const;
+
+    /**
+      * Computes the scores of several probes against the models of a 
+      * ModelBank (with "y" and "z" fields), as above. The model offsets 
+      * are computed for all the models at once, with a matrix product.
+      */
+    void forward(const bob::machine::ModelBank& models,
+      const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& probes,
+      blitz::Array<double,2>& scores, const size_t n_threads=1) const;
+
 
   private:
+    /**
+      * Checks the dimensionality of the probes and of the scores
+      */
+    void checkProbes(const size_t n_models,
+      const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& probes,
+      const blitz::Array<double,2>& scores) const;
+
+    /**
+      * Recomputes the cached scoring state (from U and the UBM variances)
+      */
+    void updateCache();
+
+    /**
+      * Computes the channel compensated and normalised first order 
+      * statistics of the probes in the range [begin,end) and scores them 
+      * against the (precomputed) models
+      */
+    void forwardRange(const blitz::Array<double,2>& models,
+      const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& probes,
+      blitz::Array<double,2>& scores, size_t begin, size_t end) const;
+
     // UBM
     boost::shared_ptr<bob::machine::GMMMachine> m_ubm;
 
@@ -228,6 +296,10 @@ class JFABaseMachine
     blitz::Array<double,2> m_U;
     blitz::Array<double,2> m_V;
     blitz::Array<double,1> m_d; 
+
+    // Scoring state, which only depends on U and on the UBM
+    blitz::Array<double,2> m_cache_UtSigmaInv;
+    blitz::Array<double,3> m_cache_UProd;
 };
 
 
@@ -398,14 +470,6 @@ class JFAMachine
      * Resizes the arrays in cache
      */ 
     void resizeCache();
-    /**
-     * Put the mean and variance supervectors of the UBM in cache
-     */
-    void cacheSupervectors();
-    /**
-     * Computes U^T.Sigma^-1
-     */
-    void computeUtSigmaInv();
     /**
      * Computes (Id + U^T.Sigma^-1.U.N_{i,h}.U)^-1 = (Id + sum_{c=1..C} N_{i,h}.U_{c}^T.Sigma_{c}^-1.U_{c})^-1
      */
@@ -418,6 +482,14 @@ class JFAMachine
      * Estimates the value of x from the cache (Fn_x, U^T.Sigma^-1, etc.)
      */
     void updateX_fromCache();
+    /**
+     * Computes the (Vy + Dz) / Sigma model offset used for scoring
+     */
+    void computeModelOffset();
+    /**
+     * Computes the score from the cache (model offset, Fn_x and x)
+     */
+    double scoreFromCache(boost::shared_ptr<const bob::machine::GMMStats> gmm_stats);
 
 
     /**
@@ -445,16 +517,11 @@ class JFAMachine
     mutable blitz::Array<double,1> m_cache_Ux;
     mutable blitz::Array<double,1> m_cache_mVyDz;
 
-    mutable blitz::Array<double,1> m_cache_mean;
-    mutable blitz::Array<double,1> m_cache_sigma;
-    mutable blitz::Array<double,2> m_cache_UtSigmaInv;
     mutable blitz::Array<double,2> m_cache_IdPlusUSProdInv;
     mutable blitz::Array<double,1> m_cache_Fn_x;
 
     mutable blitz::Array<double,1> m_tmp_ru;
     mutable blitz::Array<double,2> m_tmp_ruru;
-    mutable blitz::Array<double,2> m_tmp_ruD;
-    mutable blitz::Array<double,2> m_tmp_ruCD;
 };
 
 
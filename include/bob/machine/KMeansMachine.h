@@ -109,6 +109,23 @@ class KMeansMachine: public Machine<blitz::Array<double,1>, double> {
      */
     void forward_(const blitz::Array<double,1>& input, double& output) const;
 
+    /**
+     * Output the minimum distances between the given samples (one per row)
+     * and one of the means (overrides Machine::forward). The distances of
+     * blocks of samples to all the means are computed with a matrix product,
+     * and the samples can be split over n_threads threads.
+     */
+    void forward(const blitz::Array<double,2>& input, blitz::Array<double,1>& output, const size_t n_threads = 1) const;
+
+    /**
+     * Output the minimum distances between the given samples (one per row)
+     * and one of the means (overrides Machine::forward_). The distances of
+     * blocks of samples to all the means are computed with a matrix product,
+     * and the samples can be split over n_threads threads.
+     * @warning Inputs are NOT checked
+     */
+    void forward_(const blitz::Array<double,2>& input, blitz::Array<double,1>& output, const size_t n_threads = 1) const;
+
 
     /**
      * Set the means
@@ -225,6 +242,12 @@ class KMeansMachine: public Machine<blitz::Array<double,1>, double> {
 
 
   private:
+    /**
+     * Computes the minimum distances of the samples [begin, end) to the
+     * means, given the squared norms of the means
+     */
+    void forwardRange(const blitz::Array<double,2>& input, const blitz::Array<double,1>& mean_norms, blitz::Array<double,1>& output, const size_t begin, const size_t end) const;
+
      /**
      * The number of means
      */
@@ -33,6 +33,7 @@
 #include <blitz/array.h>
 #include "bob/io/HDF5File.h"
 #include "bob/machine/Activation.h"
+#include "bob/machine/Machine.h"
 
 namespace bob { namespace machine {
 
@@ -40,7 +41,7 @@ namespace bob { namespace machine {
    * A linear classifier. See C. M. Bishop, "Pattern Recognition and Machine
    * Learning", chapter 4 for more details.
    */
-  class LinearMachine {
+  class LinearMachine: public Machine<blitz::Array<double,1>, blitz::Array<double,1> > {
 
     public: //api
 
@@ -127,6 +128,49 @@ namespace bob { namespace machine {
       void forward (const blitz::Array<double,1>& input,
           blitz::Array<double,1>& output) const;
 
+      /**
+       * Forwards a set of samples (arranged row-wise) through the machine in
+       * a single shot. The input scaling is folded into the weights and biases
+       * of the machine (once, after these were set), so that the projection
+       * of all samples requires a single matrix product (using the BLAS). If
+       * n_threads is larger than 1, the samples are split into contiguous
+       * blocks that are projected by separate threads (overrides
+       * Machine::forward_).
+       *
+       * The input and output are NOT checked for compatibility each time. It
+       * is your responsibility to do it.
+       */
+      void forward_ (const blitz::Array<double,2>& input,
+          blitz::Array<double,2>& output, size_t n_threads=1) const;
+
+      /**
+       * Forwards a set of samples (arranged row-wise) through the machine, as
+       * above. The input and output are checked for compatibility (overrides
+       * Machine::forward).
+       */
+      void forward (const blitz::Array<double,2>& input,
+          blitz::Array<double,2>& output, size_t n_threads=1) const;
+
+      /**
+       * Forwards a set of samples (arranged row-wise) through the machine, as
+       * above, but stores the results in single precision. Computations are
+       * still carried out in double precision, block by block, so that no
+       * temporary of the size of the output is ever allocated.
+       *
+       * The input and output are NOT checked for compatibility each time. It
+       * is your responsibility to do it.
+       */
+      void forward_ (const blitz::Array<double,2>& input,
+          blitz::Array<float,2>& output, size_t n_threads=1) const;
+
+      /**
+       * Forwards a set of samples (arranged row-wise) through the machine and
+       * stores the results in single precision. The input and output are
+       * checked for compatibility.
+       */
+      void forward (const blitz::Array<double,2>& input,
+          blitz::Array<float,2>& output, size_t n_threads=1) const;
+
       /**
        * Resizes the machine. If either the input or output increases in size,
        * the weights and other factors should be considered uninitialized. If
@@ -167,7 +211,7 @@ namespace bob { namespace machine {
       /**
        * Sets all input subtraction values to a specific value.
        */
-      inline void setInputSubtraction(double v) { m_input_sub = v; }
+      void setInputSubtraction(double v);
 
       /**
        * Returns the input division factor
@@ -188,13 +232,13 @@ namespace bob { namespace machine {
        * efficiency reasons.
        */
       inline blitz::Array<double, 1>& updateInputDivision()  
-      { return m_input_div; }
+      { m_folded_dirty = true; return m_input_div; }
 
 
       /**
        * Sets all input division values to a specific value.
        */
-      inline void setInputDivision(double v) { m_input_div = v; }
+      void setInputDivision(double v);
 
       /**
        * Returns the current weight representation. Each column should be
@@ -219,12 +263,12 @@ namespace bob { namespace machine {
        * efficiency reasons.
        */
       inline blitz::Array<double, 2>& updateWeights()  
-      { return m_weight; }
+      { m_folded_dirty = true; return m_weight; }
 
       /**
        * Sets all weights to a single specific value.
        */
-      inline void setWeights(double v) { m_weight = v; }
+      void setWeights(double v);
 
       /**
        * Returns the biases of this classifier.
@@ -242,7 +286,7 @@ namespace bob { namespace machine {
       /**
        * Sets all output bias values to a specific value.
        */
-      inline void setBiases(double v) { m_bias = v; }
+      void setBiases(double v);
 
       /**
        * Returns the currently set activation function
@@ -254,6 +298,36 @@ namespace bob { namespace machine {
        */
       void setActivation(Activation a);
 
+      /**
+       * Computes the weights and biases in which the input scaling is folded:
+       * W'(i,j) = W(i,j)/div(i) and b'(j) = b(j) - sum_i W'(i,j)*sub(i)
+       */
+      void fold(blitz::Array<double,2>& weight, blitz::Array<double,1>& bias)
+        const;
+
+    private: //methods
+
+      /**
+       * Updates the cached folded weights and biases, if the weights, biases
+       * or input normalization were changed since they were last folded
+       */
+      void updateFolded() const;
+
+      /**
+       * Projects the samples [begin, end) of input onto the folded weights
+       */
+      void forwardRange(const blitz::Array<double,2>& input,
+          blitz::Array<double,2>& output, const blitz::Array<double,2>& weight,
+          const blitz::Array<double,1>& bias, size_t begin, size_t end) const;
+
+      /**
+       * Projects the samples [begin, end) of input onto the folded weights,
+       * storing the results in single precision
+       */
+      void forwardRangeFloat(const blitz::Array<double,2>& input,
+          blitz::Array<float,2>& output, const blitz::Array<double,2>& weight,
+          const blitz::Array<double,1>& bias, size_t begin, size_t end) const;
+
     private: //representation
 
       typedef double (*actfun_t)(double); ///< activation function type
@@ -266,6 +340,10 @@ namespace bob { namespace machine {
       actfun_t m_actfun; ///< currently set activation function
 
       mutable blitz::Array<double, 1> m_buffer; ///< a buffer for speed
+
+      mutable blitz::Array<double, 2> m_folded_weight; ///< weights / input division
+      mutable blitz::Array<double, 1> m_folded_bias; ///< biases - folded subtraction
+      mutable bool m_folded_dirty; ///< folded values are outdated (setters)
   
   };
 
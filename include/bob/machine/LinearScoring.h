@@ -23,10 +23,14 @@
 #include <blitz/array.h>
 #include <boost/shared_ptr.hpp>
 #include <vector>
+#include <string>
 #include "bob/machine/GMMMachine.h"
+#include "bob/io/HDF5File.h"
 
 namespace bob { namespace machine {
 
+class ModelBank;
+
 /**
  * Compute a matrix of scores using linear scoring.
  *
@@ -39,19 +43,25 @@ namespace bob { namespace machine {
  * @param test_channelOffset  list of channel offset if any (for JFA/ISA for instance)
  * @param frame_length_normalisation   perform a normalisation by the number of feature vectors
  * @param[out] scores 2D matrix of scores, <tt>scores[m, s]</tt> is the score for model @c m against statistics @c s
+ * @param n_threads   number of threads the test statistics are split across
  * @warning the output scores matrix should have the correct size (number of models x number of test_stats)
+ *
+ * The model supervectors are normalized once, and the test statistics are
+ * then converted into supervectors by blocks, whose scores are computed 
+ * with a single matrix product (BLAS). Only a block of test supervectors 
+ * per thread is kept in memory at a time.
  */
 void linearScoring(const std::vector<blitz::Array<double,1> >& models,
                    const blitz::Array<double,1>& ubm_mean, const blitz::Array<double,1>& ubm_variance,
                    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
                    const std::vector<blitz::Array<double, 1> >& test_channelOffset,
                    const bool frame_length_normalisation,
-                   blitz::Array<double, 2>& scores);
+                   blitz::Array<double, 2>& scores, const size_t n_threads=1);
 void linearScoring(const std::vector<blitz::Array<double,1> >& models,
                    const blitz::Array<double,1>& ubm_mean, const blitz::Array<double,1>& ubm_variance,
                    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
                    const bool frame_length_normalisation,
-                   blitz::Array<double, 2>& scores);
+                   blitz::Array<double, 2>& scores, const size_t n_threads=1);
 
 /**
  * Compute a matrix of scores using linear scoring.
@@ -63,13 +73,14 @@ void linearScoring(const std::vector<blitz::Array<double,1> >& models,
  * @param test_stats  list of accumulate statistics for each test trial
  * @param frame_length_normalisation   perform a normalisation by the number of feature vectors
  * @param[out] scores 2D matrix of scores, <tt>scores[m, s]</tt> is the score for model @c m against statistics @c s
+ * @param n_threads   number of threads the test statistics are split across
  * @warning the output scores matrix should have the correct size (number of models x number of test_stats)
  */
 void linearScoring(const std::vector<boost::shared_ptr<const bob::machine::GMMMachine> >& models,
                    const bob::machine::GMMMachine& ubm,
                    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
                    const bool frame_length_normalisation,
-                   blitz::Array<double, 2>& scores);
+                   blitz::Array<double, 2>& scores, const size_t n_threads=1);
 /**
  * Compute a matrix of scores using linear scoring.
  *
@@ -81,6 +92,7 @@ void linearScoring(const std::vector<boost::shared_ptr<const bob::machine::GMMMa
  * @param test_channelOffset  list of channel offset if any (for JFA/ISA for instance)
  * @param frame_length_normalisation   perform a normalisation by the number of feature vectors
  * @param[out] scores 2D matrix of scores, <tt>scores[m, s]</tt> is the score for model @c m against statistics @c s
+ * @param n_threads   number of threads the test statistics are split across
  * @warning the output scores matrix should have the correct size (number of models x number of test_stats)
  */
 void linearScoring(const std::vector<boost::shared_ptr<const bob::machine::GMMMachine> >& models,
@@ -88,7 +100,69 @@ void linearScoring(const std::vector<boost::shared_ptr<const bob::machine::GMMMa
                    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
                    const std::vector<blitz::Array<double, 1> >& test_channelOffset,
                    const bool frame_length_normalisation,
-                   blitz::Array<double, 2>& scores);
+                   blitz::Array<double, 2>& scores, const size_t n_threads=1);
+
+/**
+ * Compute a matrix of scores using linear scoring, in single precision.
+ * The model and test supervectors are computed in double precision, but
+ * stored in single precision, and the scores are computed with single
+ * precision matrix products, which halves the memory traffic of the 
+ * scoring. Relative deviations from the double precision scores are of 
+ * the order of 1e-6.
+ *
+ * @param test_channelOffset  list of channel offset, or an empty list if none
+ */
+void linearScoring(const std::vector<blitz::Array<double,1> >& models,
+                   const blitz::Array<double,1>& ubm_mean, const blitz::Array<double,1>& ubm_variance,
+                   const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+                   const std::vector<blitz::Array<double, 1> >& test_channelOffset,
+                   const bool frame_length_normalisation,
+                   blitz::Array<float, 2>& scores, const size_t n_threads=1);
+void linearScoring(const std::vector<boost::shared_ptr<const bob::machine::GMMMachine> >& models,
+                   const bob::machine::GMMMachine& ubm,
+                   const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+                   const std::vector<blitz::Array<double, 1> >& test_channelOffset,
+                   const bool frame_length_normalisation,
+                   blitz::Array<float, 2>& scores, const size_t n_threads=1);
+
+/**
+ * Compute linear scores and stream them into an HDF5 file, instead of
+ * storing the full matrix of scores in memory. For each test statistics 
+ * @c s (in order), the 1D array of scores of all the models against @c s
+ * (i.e. the column <tt>scores[:, s]</tt> of the functions above) is 
+ * appended to the dataset at the given path.
+ *
+ * @param test_channelOffset  list of channel offset, or an empty list if none
+ */
+void linearScoring(const std::vector<blitz::Array<double,1> >& models,
+                   const blitz::Array<double,1>& ubm_mean, const blitz::Array<double,1>& ubm_variance,
+                   const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+                   const std::vector<blitz::Array<double, 1> >& test_channelOffset,
+                   const bool frame_length_normalisation,
+                   bob::io::HDF5File& file, const std::string& path,
+                   const size_t n_threads=1);
+void linearScoring(const std::vector<boost::shared_ptr<const bob::machine::GMMMachine> >& models,
+                   const bob::machine::GMMMachine& ubm,
+                   const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+                   const std::vector<blitz::Array<double, 1> >& test_channelOffset,
+                   const bool frame_length_normalisation,
+                   bob::io::HDF5File& file, const std::string& path,
+                   const size_t n_threads=1);
+
+/**
+ * Compute a matrix of scores using linear scoring, with the client models
+ * stored in a ModelBank (with a "mean" field). The mean supervectors are 
+ * read in place: neither copied nor normalized per model.
+ *
+ * @param test_channelOffset  list of channel offset, or an empty list if none
+ * @warning the output scores matrix should have the correct size (number of models x number of test_stats)
+ */
+void linearScoring(const bob::machine::ModelBank& models,
+                   const bob::machine::GMMMachine& ubm,
+                   const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+                   const std::vector<blitz::Array<double, 1> >& test_channelOffset,
+                   const bool frame_length_normalisation,
+                   blitz::Array<double, 2>& scores, const size_t n_threads=1);
 
 }}
 
@@ -28,6 +28,7 @@
 
 #include "bob/io/HDF5File.h"
 #include "bob/machine/Activation.h"
+#include "bob/machine/Machine.h"
 
 namespace bob { namespace machine {
 
@@ -45,7 +46,7 @@ namespace bob { namespace machine {
    * equivalent of a LinearMachine, with the advantage it can be trained by MLP
    * trainers.
    */
-  class MLP {
+  class MLP: public Machine<blitz::Array<double,1>, blitz::Array<double,1> > {
     
     public: //api
 
@@ -150,25 +151,29 @@ namespace bob { namespace machine {
        * Forwards data through the network, outputs the values of each output
        * neuron. This variant will take a number of inputs in one single input
        * matrix with inputs arranged row-wise (i.e., every row contains an
-       * individual input).
+       * individual input). Blocks of inputs are propagated through each layer
+       * with a single matrix product, and the inputs can be split over
+       * n_threads threads (overrides Machine::forward_).
        *
        * The input and output are NOT checked for compatibility each time. It
        * is your responsibility to do it.
        */
       void forward_ (const blitz::Array<double,2>& input,
-          blitz::Array<double,2>& output) const;
+          blitz::Array<double,2>& output, const size_t n_threads=1) const;
 
       /**
        * Forwards data through the network, outputs the values of each output
        * neuron. This variant will take a number of inputs in one single input
        * matrix with inputs arranged row-wise (i.e., every row contains an
-       * individual input).
+       * individual input). Blocks of inputs are propagated through each layer
+       * with a single matrix product, and the inputs can be split over
+       * n_threads threads (overrides Machine::forward).
        *
        * The input and output are checked for compatibility each time the
        * forward method is applied.
        */
       void forward (const blitz::Array<double,2>& input,
-          blitz::Array<double,2>& output) const;
+          blitz::Array<double,2>& output, const size_t n_threads=1) const;
 
       /**
        * Resizes the machine. This causes this MLP to be completely
@@ -330,6 +335,16 @@ namespace bob { namespace machine {
        */
       void randomize(double lower_bound=-0.1, double upper_bound=+0.1);
 
+    private: //helpers
+
+      /**
+       * Forwards the inputs [begin, end) through the network, block by block,
+       * using buffers that are local to the calling thread.
+       */
+      void forwardRange(const blitz::Array<double,2>& input,
+          blitz::Array<double,2>& output, const size_t begin,
+          const size_t end) const;
+
     private: //representation
 
       blitz::Array<double, 1> m_input_sub; ///< input subtraction
@@ -22,9 +22,46 @@
 #define BOB_MACHINE_MACHINE_H
 
 #include <cstring>
+#include <blitz/array.h>
+#include <boost/bind.hpp>
+#include "bob/core/array_alias.h"
+#include "bob/core/array_assert.h"
+#include "bob/core/parallel.h"
 
 namespace bob { namespace machine {
 
+namespace detail {
+
+  /**
+   * Describes how a set of inputs (or outputs) of a machine is stored in a
+   * single array, where the samples are stacked along the first dimension,
+   * and how a single sample is accessed in such an array.
+   */
+  template<class T> struct batch_traits;
+
+  template<> struct batch_traits<double> {
+    typedef blitz::Array<double,1> type;
+    typedef double& sample_type;
+    static double& sample(type& batch, const int i) { return batch(i); }
+    static double sample(const type& batch, const int i) { return batch(i); }
+  };
+
+  template<class T> struct batch_traits<blitz::Array<T,1> > {
+    typedef blitz::Array<T,2> type;
+    typedef blitz::Array<T,1> sample_type;
+    static blitz::Array<T,1> sample(const type& batch, const int i)
+    { return batch(i, blitz::Range::all()); }
+  };
+
+  template<class T> struct batch_traits<blitz::Array<T,2> > {
+    typedef blitz::Array<T,3> type;
+    typedef blitz::Array<T,2> sample_type;
+    static blitz::Array<T,2> sample(const type& batch, const int i)
+    { return batch(i, blitz::Range::all(), blitz::Range::all()); }
+  };
+
+}
+
 /**
  * Root class for all machines
  */
@@ -51,6 +88,82 @@ class Machine
      * @warning Inputs are NOT checked
      */
     virtual void forward_(const T_input& input, T_output& output) const = 0;
+
+    /**
+     * The type of a set of inputs, stacked along the first dimension
+     */
+    typedef typename detail::batch_traits<T_input>::type batch_input_type;
+
+    /**
+     * The type of a set of outputs, stacked along the first dimension
+     */
+    typedef typename detail::batch_traits<T_output>::type batch_output_type;
+
+    /**
+     * Tells if forward() and forward_() on a single sample can be called
+     * concurrently from several threads, i.e., if they do not use any
+     * (mutable) internal buffer. This trait is used by the default
+     * implementation of the batch forward() and forward_() to decide if the
+     * samples can be split over several threads.
+     */
+    virtual bool isThreadSafe() const { return false; }
+
+    /**
+     * Executes the machine on a set of inputs, and saves the output of
+     * input(i,...) in output(i,...). The default implementation loops over
+     * the samples, which are split over n_threads threads if the machine is
+     * thread-safe. Machines with a dedicated batch algorithm override it.
+     *
+     * @param input input data, one sample per row
+     * @param output values computed by the machine, one sample per row
+     * @param n_threads the number of threads to use
+     * @warning Inputs are checked
+     */
+    virtual void forward(const batch_input_type& input,
+        batch_output_type& output, const size_t n_threads = 1) const {
+      bob::core::array::assertSameDimensionLength(input.extent(0),
+          output.extent(0));
+      bob::core::thread_loop(boost::bind(&Machine<T_input,T_output>::forwardRange,
+            this, boost::cref(input), boost::ref(output), true, _1, _2),
+          input.extent(0), isThreadSafe() ? n_threads : 1);
+    }
+
+    /**
+     * Executes the machine on a set of inputs, and saves the output of
+     * input(i,...) in output(i,...). The default implementation loops over
+     * the samples, which are split over n_threads threads if the machine is
+     * thread-safe. Machines with a dedicated batch algorithm override it.
+     *
+     * @param input input data, one sample per row
+     * @param output values computed by the machine, one sample per row
+     * @param n_threads the number of threads to use
+     * @warning Inputs are NOT checked
+     */
+    virtual void forward_(const batch_input_type& input,
+        batch_output_type& output, const size_t n_threads = 1) const {
+      bob::core::thread_loop(boost::bind(&Machine<T_input,T_output>::forwardRange,
+            this, boost::cref(input), boost::ref(output), false, _1, _2),
+          input.extent(0), isThreadSafe() ? n_threads : 1);
+    }
+
+  private:
+
+    /**
+     * Executes the machine on the samples [begin, end) of the given set
+     */
+    void forwardRange(const batch_input_type& input, batch_output_type& output,
+        const bool check, const size_t begin, const size_t end) const {
+      // the samples are views of aliases private to this thread
+      const batch_input_type input_ = bob::core::array::alias(input);
+      batch_output_type output_ = bob::core::array::alias(output);
+      for (int i=(int)begin; i<(int)end; ++i) {
+        const T_input x = detail::batch_traits<T_input>::sample(input_, i);
+        typename detail::batch_traits<T_output>::sample_type y =
+          detail::batch_traits<T_output>::sample(output_, i);
+        if (check) forward(x, y);
+        else forward_(x, y);
+      }
+    }
 };
 
 }}
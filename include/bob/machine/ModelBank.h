@@ -0,0 +1,241 @@
+/**
+ * @file bob/machine/ModelBank.h
+ * @date Mon Oct 19 20:14:08 2026 +0200
+ *
+ * @brief A contiguous store of the parameters of many enrolled client
+ * models (GMM mean supervectors, JFA/ISV factors, PLDA enrolment data).
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOB_MACHINE_MODELBANK_H
+#define BOB_MACHINE_MODELBANK_H
+
+#include <blitz/array.h>
+#include <vector>
+#include <map>
+#include <string>
+#include <stdint.h>
+#include "bob/io/HDF5File.h"
+#include "bob/machine/GMMMachine.h"
+#include "bob/machine/JFAMachine.h"
+#include "bob/machine/PLDAMachine.h"
+
+namespace bob { namespace machine {
+
+  /**
+   * A bank of enrolled client models, each of them identified by an
+   * integer. The per-client parameters are stored in fields: each field is
+   * a contiguous matrix with one row per model, such that the parameters
+   * of all the models can be used at once in matrix products, and such that
+   * the bank is saved and loaded with a single dataset per field (instead
+   * of one HDF5 group per model).
+   *
+   * The layouts of the banks built from a base machine are:
+   *  - GMMMachine (UBM): "mean" (C.D), the mean supervectors
+   *  - JFABaseMachine: "y" (rv) and "z" (C.D), the speaker factors
+   *  - PLDABaseMachine: "weighted_sum" (F), "n_samples" (1),
+   *    "nh_sum_xit_beta_xi" (1) and "log_likelihood" (1)
+   *
+   * Such banks are scored with linearScoring(), JFABaseMachine::forward()
+   * and PLDABaseMachine::forward(), which read the fields in place.
+   */
+  class ModelBank {
+
+    public: //api
+
+      /**
+       * Builds an empty bank, without any field
+       */
+      ModelBank();
+
+      /**
+       * Builds an empty bank with the given fields and sizes
+       */
+      ModelBank(const std::vector<std::string>& names,
+          const std::vector<size_t>& sizes);
+
+      /**
+       * Builds an empty bank of GMM mean supervectors adapted from the given
+       * UBM
+       */
+      ModelBank(const bob::machine::GMMMachine& ubm);
+
+      /**
+       * Builds an empty bank of JFA (or ISV) speaker factors
+       */
+      ModelBank(const bob::machine::JFABaseMachine& base);
+
+      /**
+       * Builds an empty bank of PLDA enrolment data
+       */
+      ModelBank(const bob::machine::PLDABaseMachine& base);
+
+      /**
+       * Copies another bank
+       */
+      ModelBank(const ModelBank& other);
+
+      /**
+       * Loads a bank from an HDF5 file
+       */
+      ModelBank(bob::io::HDF5File& config);
+
+      virtual ~ModelBank();
+
+      /**
+       * Assigns from a different bank
+       */
+      ModelBank& operator=(const ModelBank& other);
+
+      /**
+       * Loads/Saves the bank from/to an HDF5 file. Each field is read (or
+       * written) at once, as a single 2D dataset.
+       */
+      void load(bob::io::HDF5File& config);
+      void save(bob::io::HDF5File& config) const;
+
+      /**
+       * Number of models
+       */
+      inline size_t size() const { return m_ids.size(); }
+
+      /**
+       * Names of the fields
+       */
+      inline const std::vector<std::string>& getFieldNames() const
+      { return m_names; }
+
+      /**
+       * Tells if the bank has a field with the given name
+       */
+      bool hasField(const std::string& name) const;
+
+      /**
+       * Size of the given field
+       */
+      size_t getFieldSize(const std::string& name) const;
+
+      /**
+       * Returns the given field of all the models, one per row (a
+       * contiguous view on the storage, which is not copied). The view
+       * shares the ownership of the storage, and hence stays valid if the
+       * bank grows (in which case it does not see the new models).
+       */
+      const blitz::Array<double,2> getField(const std::string& name) const;
+
+      /**
+       * Returns the given field of a model (a view on the storage)
+       */
+      const blitz::Array<double,1> getField(const std::string& name,
+          const int64_t id) const;
+
+      /**
+       * Tells if a model with the given identifier is stored
+       */
+      bool contains(const int64_t id) const;
+
+      /**
+       * Returns the row of the model with the given identifier
+       */
+      size_t getRow(const int64_t id) const;
+
+      /**
+       * Returns the identifiers of the models, in storage order
+       */
+      const std::vector<int64_t>& getIds() const { return m_ids; }
+
+      /**
+       * Adds a model with the given identifier, whose fields are all set to
+       * zero, and returns its row. If a model with the same identifier
+       * already exists, its row is returned and its fields are kept.
+       */
+      size_t add(const int64_t id);
+
+      /**
+       * Sets a field of the model with the given identifier, which is added
+       * if required
+       */
+      void set(const int64_t id, const std::string& name,
+          const blitz::Array<double,1>& value);
+
+      /**
+       * Sets a field of several models at once, one per row of values
+       */
+      void set(const blitz::Array<int64_t,1>& ids, const std::string& name,
+          const blitz::Array<double,2>& values);
+
+      /**
+       * Adds (or replaces) a GMM client model: its mean supervector is
+       * written in the "mean" field
+       */
+      void add(const int64_t id, const bob::machine::GMMMachine& model);
+
+      /**
+       * Adds (or replaces) a JFA client model: its factors are written in
+       * the "y" and "z" fields
+       */
+      void add(const int64_t id, const bob::machine::JFAMachine& model);
+
+      /**
+       * Adds (or replaces) an enrolled PLDA model
+       */
+      void add(const int64_t id, const bob::machine::PLDAMachine& model);
+
+      /**
+       * Removes the model with the given identifier. Returns false if there
+       * is no such model. The last model is moved into the freed row.
+       */
+      bool remove(const int64_t id);
+
+      /**
+       * Removes all the models
+       */
+      void clear();
+
+      /**
+       * Reserves the memory for the given number of models
+       */
+      void reserve(const size_t n_models);
+
+    private: //methods
+
+      /**
+       * Returns the index of the given field, or throws
+       */
+      size_t fieldIndex(const std::string& name) const;
+
+      /**
+       * Checks that the field has the given size, and returns its index
+       */
+      size_t checkField(const std::string& name, const size_t size) const;
+
+      /**
+       * Initializes the (empty) fields with the given names and sizes
+       */
+      void init(const std::vector<std::string>& names,
+          const std::vector<size_t>& sizes);
+
+    private: //representation
+
+      std::vector<std::string> m_names; ///< name of each field
+      std::vector<blitz::Array<double,2> > m_fields; ///< capacity x size
+      std::vector<int64_t> m_ids; ///< identifier of each stored model
+      std::map<int64_t,size_t> m_rows; ///< row of each identifier
+  };
+
+}}
+
+#endif /* BOB_MACHINE_MODELBANK_H */
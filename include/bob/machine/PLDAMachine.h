@@ -27,9 +27,15 @@
 #define BOB_MACHINE_PLDAMACHINE_H
 
 #include <blitz/array.h>
+#include <map>
+#include <vector>
+#include <boost/shared_ptr.hpp>
 #include "bob/io/HDF5File.h"
 
 namespace bob { namespace machine {
+
+  class PLDAMachine;
+  class ModelBank;
   
   /**
    * A PLDA Base machine which contains F, G and sigma matrices as well as mu.
@@ -236,6 +242,7 @@ namespace bob { namespace machine {
         * @warning an exception is thrown if gamma does not exists
         */
       blitz::Array<double,2>& getGamma(const size_t a);
+      const blitz::Array<double,2>& getGamma(const size_t a) const;
       /**
         * Gets the gamma matrix for a given a (number of samples)
         * gamma_a = (Id + a.F^T.beta.F)^-1
@@ -282,7 +289,7 @@ namespace bob { namespace machine {
         *   ( -D*log(2*pi) -log|sigma| +log|alpha| +log|gamma_a|)
         */
       double computeLogLikeConstTerm(const size_t a, 
-        const blitz::Array<double,2>& gamma_a);
+        const blitz::Array<double,2>& gamma_a) const;
       /**
         * Computes the log likelihood constant term for a given a 
         * (number of samples)
@@ -307,7 +314,7 @@ namespace bob { namespace machine {
         *   ( -D*log(2*pi) -log|sigma| +log|alpha| +log|gamma_a|)
         * @warning an exception is thrown if the value does not exists
         */
-      double getLogLikeConstTerm(const size_t a);
+      double getLogLikeConstTerm(const size_t a) const;
       /**
         * Gets the log likelihood constant term for a given a \
         * (number of samples)
@@ -316,13 +323,21 @@ namespace bob { namespace machine {
         * @warning The value is computed if it does not already exists
         */
       double getAddLogLikeConstTerm(const size_t a);
+      /**
+        * Precomputes gamma_a and the log likelihood constant term for all
+        * the numbers of samples a in [a_min, a_max]. Once these values are
+        * available, the scoring functions of the PLDAMachines attached to 
+        * this base machine only read them, and can hence be called 
+        * concurrently from several threads.
+        */
+      void precomputeLogLikeConstTerms(const size_t a_min, const size_t a_max);
 
       /**
         * Computes the gamma matrix for a given a (number of samples)
         * and put the result in res.
         * gamma_a = (Id + a.F^T.beta.F)^-1
         */
-      void computeGamma(const size_t a, blitz::Array<double,2> res);
+      void computeGamma(const size_t a, blitz::Array<double,2> res) const;
       /**
         * Tells if the gamma matrix for a given a (number of samples) exists
         * gamma_a = (Id + a.F^T.beta.F)^-1
@@ -334,6 +349,34 @@ namespace bob { namespace machine {
         */
       void clearMaps();
 
+      /**
+        * Computes the log likelihood ratio scores of several probe samples
+        * (one per row of probes) against several enrolled PLDAMachines 
+        * attached to this base machine. scores should be of size 
+        * (#models x #probes). The x-dependent quadratic terms that are
+        * common to the match and no-match hypotheses cancel out, so that
+        * the scores reduce to a few matrix products, which are computed 
+        * with the BLAS over blocks of probes split across n_threads threads.
+        * This function does not modify any of the machines. gamma_a and the
+        * log likelihood constant terms are looked up in this machine, then 
+        * in each PLDAMachine, and are computed on the fly (without being 
+        * stored) if they are missing.
+        * @warning The PLDAMachines should all be attached to this machine
+        */
+      void forward(const std::vector<boost::shared_ptr<const bob::machine::PLDAMachine> >& models,
+        const blitz::Array<double,2>& probes, blitz::Array<double,2>& scores,
+        const size_t n_threads=1) const;
+
+      /**
+        * Computes the log likelihood ratio scores of several probe samples
+        * against the models of a ModelBank (with the PLDA enrolment 
+        * fields), as above. gamma_a and the log likelihood constant terms 
+        * are looked up in this machine only.
+        */
+      void forward(const bob::machine::ModelBank& models,
+        const blitz::Array<double,2>& probes, blitz::Array<double,2>& scores,
+        const size_t n_threads=1) const;
+
     private:
       // F, G and sigma matrices, and mu vector
       // sigma is assumed to be diagonal, and only the diagonal is stored
@@ -365,7 +408,6 @@ namespace bob { namespace machine {
 
       // cache
       blitz::Array<double,2> m_cache_d_ng_1;
-      blitz::Array<double,2> m_cache_nf_nf_1;
       blitz::Array<double,2> m_cache_ng_ng_1;
 
       void initFGSigma();
@@ -378,6 +420,12 @@ namespace bob { namespace machine {
       void precomputeLogDetAlpha();
       void precomputeLogDetSigma();
       void precomputeLogLikeConstTerm(const size_t a);
+
+      void forwardRange(const blitz::Array<double,2>& W,
+        const blitz::Array<double,1>& c, const std::vector<size_t>& a_index,
+        const std::vector<blitz::Array<double,2> >& gamma_diff,
+        const blitz::Array<double,2>& probes, blitz::Array<double,2>& scores,
+        size_t begin, size_t end) const;
   };
 
 
@@ -482,7 +530,7 @@ namespace bob { namespace machine {
       /**
        * Gets the current weighted sum
        */
-      inline const blitz::Array<double, 1>& getWeightedSum()
+      inline const blitz::Array<double, 1>& getWeightedSum() const
       { return m_weighted_sum; }
       /**
         * Set the Weigted sum
@@ -526,6 +574,7 @@ namespace bob { namespace machine {
         * @warning an exception is thrown if gamma does not exists
         */
       blitz::Array<double,2>& getGamma(const size_t a);
+      const blitz::Array<double,2>& getGamma(const size_t a) const;
       /**
         * Gets the gamma matrix for a given a (number of samples)
         * gamma_a = (Id + a.F^T.beta.F)^-1
@@ -551,7 +600,7 @@ namespace bob { namespace machine {
         *   ( -D*log(2*pi) -log|sigma| +log|alpha| +log|gamma_a|)
         * @warning an exception is thrown if the value does not exists
         */
-      double getLogLikeConstTerm(const size_t a);
+      double getLogLikeConstTerm(const size_t a) const;
       /**
         * Gets the log likelihood constant term for a given a \
         * (number of samples)
@@ -570,12 +619,20 @@ namespace bob { namespace machine {
       /**
         * Compute the likelihood of the given sample and (optionnaly) 
         * the enrolled samples
+        * @warning gamma_a and the log likelihood constant term are added to
+        *   this machine if they are not yet available. Once they exist 
+        *   (e.g. after PLDABaseMachine::precomputeLogLikeConstTerms()), this
+        *   function does not modify the machine and is thread-safe.
         */
       double computeLikelihood(const blitz::Array<double,1>& sample,
         bool with_enrolled_samples=true);
       /**
         * Compute the likelihood of the given samples and (optionnaly) 
         * the enrolled samples
+        * @warning gamma_a and the log likelihood constant term are added to
+        *   this machine if they are not yet available. Once they exist 
+        *   (e.g. after PLDABaseMachine::precomputeLogLikeConstTerms()), this
+        *   function does not modify the machine and is thread-safe.
         */
       double computeLikelihood(const blitz::Array<double,2>& samples,
         bool with_enrolled_samples=true);
@@ -588,6 +645,19 @@ namespace bob { namespace machine {
 
 
     private:
+      /**
+        * Makes sure that gamma_a and the log likelihood constant term 
+        * exist for the given number of samples, either in the base machine
+        * or in this machine
+        */
+      void addLogLikeConstTerm(const size_t a);
+      /**
+        * Computes the likelihood of the given samples and (optionnaly) the
+        * enrolled samples, using the precomputed values only.
+        */
+      double computeLikelihood_(const blitz::Array<double,2>& samples,
+        bool with_enrolled_samples) const;
+
       /**
         * Base PLDA Machine containing the model (F, G and sigma)
         */
@@ -621,13 +691,6 @@ namespace bob { namespace machine {
       // loglike_constterm[a] = a/2 * 
       //    ( -D*log(2*pi) -log|sigma| +log|alpha| +log|gamma_a|)
       std::map<size_t, double> m_loglike_constterm;
-
-
-      // cache
-      blitz::Array<double,1> m_cache_d_1;
-      blitz::Array<double,1> m_cache_d_2;
-      blitz::Array<double,1> m_cache_nf_1;
-      blitz::Array<double,1> m_cache_nf_2;
   };
 
 
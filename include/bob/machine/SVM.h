@@ -360,6 +360,14 @@ namespace bob { namespace machine {
        */
       void save(bob::io::HDF5File& config) const;
 
+      /**
+       * Returns the underlying libsvm model. This is mostly useful to build
+       * alternative representations of this machine, such as the one used by
+       * BatchSupportVector.
+       */
+      inline boost::shared_ptr<const svm_model> getModel() const
+      { return m_model; }
+
     private: //not implemented
 
       SupportVector(const SupportVector& other);
@@ -383,6 +391,172 @@ namespace bob { namespace machine {
 
   };
 
+  /**
+   * A dense re-implementation of the libsvm prediction for a loaded
+   * SupportVector, to be used on many samples at once. The support vectors
+   * are unpacked into a contiguous matrix at construction time and samples
+   * are processed in blocks, using the BLAS for all the dot products:
+   *
+   * - LINEAR kernels: the support vectors are collapsed into a single weight
+   *   vector per decision function, in which the input scaling (subtraction
+   *   and division) of the original machine is folded. Prediction is then a
+   *   single matrix product per block of samples.
+   * - POLY, RBF and SIGMOID kernels: the dot products between the support
+   *   vectors and a block of samples are computed with a single matrix
+   *   product, then the kernel is applied element-wise and the decision
+   *   functions are evaluated with a second matrix product.
+   *
+   * The results are equivalent to the ones of the SupportVector, up to the
+   * floating point precision (summation order changes). PRECOMPUTED kernels
+   * are not supported.
+   *
+   * Once built, this object is not changed by any of the prediction methods
+   * and can be used by several threads at once. It keeps a snapshot of the
+   * machine, so later changes in the scaling parameters of the
+   * SupportVector are not reflected here.
+   */
+  class BatchSupportVector {
+
+    public: //api
+
+      /**
+       * Builds the dense representation of an existing SupportVector
+       * machine, including its current scaling parameters.
+       */
+      BatchSupportVector(const SupportVector& machine);
+
+      /**
+       * Virtual d'tor
+       */
+      virtual ~BatchSupportVector();
+
+      /**
+       * Tells the input size this machine expects
+       */
+      inline size_t inputSize() const { return m_input_size; }
+
+      /**
+       * Tells the number of classes the problem has.
+       */
+      inline size_t numberOfClasses() const { return m_labels.extent(0); }
+
+      /**
+       * The number of decision functions (and therefore of scores) for every
+       * sample. This is N*(N-1)/2 for N-class classification problems (one
+       * score per pair of classes, in the libsvm order) and 1 otherwise.
+       */
+      inline size_t numberOfScores() const { return m_rho.extent(0); }
+
+      /**
+       * Returns the class label (as stored inside the svm_model object) for a
+       * given class 'i'.
+       */
+      int classLabel(size_t i) const;
+
+      /**
+       * SVM type
+       */
+      inline SupportVector::svm_t machineType() const { return m_type; }
+
+      /**
+       * Kernel type
+       */
+      inline SupportVector::kernel_t kernelType() const { return m_kernel; }
+
+      /**
+       * Tells if this model supports probability output.
+       */
+      inline bool supportsProbability() const { return m_probability; }
+
+      /**
+       * Number of samples processed in a row by every thread. This bounds the
+       * size of the temporary kernel matrices (block size x number of support
+       * vectors).
+       */
+      inline size_t getBlockSize() const { return m_block_size; }
+
+      /**
+       * Sets the number of samples processed in a row by every thread.
+       */
+      void setBlockSize(size_t block_size);
+
+      /**
+       * Predicts the classes of all samples (arranged row-wise) in input. The
+       * labels array should have as many entries as there are rows in input.
+       * Computations are split over n_threads threads, on blocks of
+       * contiguous samples. If n_threads is 0 or 1, all computations run on
+       * the calling thread.
+       */
+      void predictClasses(const blitz::Array<double,2>& input,
+          blitz::Array<int,1>& labels, size_t n_threads=1) const;
+
+      /**
+       * Predicts the classes and scores of all samples (arranged row-wise) in
+       * input. The scores array should have as many rows as there are samples
+       * and numberOfScores() columns.
+       */
+      void predictClassesAndScores(const blitz::Array<double,2>& input,
+          blitz::Array<int,1>& labels, blitz::Array<double,2>& scores,
+          size_t n_threads=1) const;
+
+      /**
+       * Predicts the classes and the probabilities of each class for all
+       * samples (arranged row-wise) in input, but only if the model supports
+       * it. Otherwise, throws a run-time exception. The probabilities array
+       * should have as many rows as there are samples and numberOfClasses()
+       * columns.
+       */
+      void predictClassesAndProbabilities(const blitz::Array<double,2>& input,
+          blitz::Array<int,1>& labels, blitz::Array<double,2>& probabilities,
+          size_t n_threads=1) const;
+
+    private: //methods
+
+      /**
+       * Checks the input and the labels array
+       */
+      void checkInput(const blitz::Array<double,2>& input,
+          const blitz::Array<int,1>& labels) const;
+
+      /**
+       * Computes the decision values of the samples [begin, end) of input,
+       * block by block, and derives labels and optionally probabilities.
+       */
+      void predictRange(const blitz::Array<double,2>& input,
+          blitz::Array<int,1>& labels, blitz::Array<double,2>* scores,
+          blitz::Array<double,2>* probabilities, size_t begin,
+          size_t end) const;
+
+      /**
+       * Computes the decision values for a block of samples
+       */
+      void decisionValues(const blitz::Array<double,2>& input,
+          blitz::Array<double,2>& normalized, blitz::Array<double,2>& kernel,
+          blitz::Array<double,2>& values) const;
+
+    private: //representation
+
+      SupportVector::svm_t m_type; ///< SVM type
+      SupportVector::kernel_t m_kernel; ///< kernel type
+      int m_degree; ///< degree of the POLY kernel
+      double m_gamma; ///< gamma of the POLY, RBF and SIGMOID kernels
+      double m_coef0; ///< coefficient 0 of the POLY and SIGMOID kernels
+      size_t m_input_size; ///< number of inputs
+      size_t m_block_size; ///< samples processed at once by every thread
+      bool m_probability; ///< supports probability outputs
+      blitz::Array<int,1> m_labels; ///< class labels
+      blitz::Array<double,1> m_input_sub; ///< scaling: subtraction
+      blitz::Array<double,1> m_input_div; ///< scaling: division
+      blitz::Array<double,2> m_sv; ///< support vectors, one per row
+      blitz::Array<double,1> m_sv_norm2; ///< squared norms of the SVs (RBF)
+      blitz::Array<double,2> m_coef; ///< SV coefficients, one column per score
+      blitz::Array<double,2> m_weights; ///< LINEAR: collapsed (scaled) SVs
+      blitz::Array<double,1> m_rho; ///< decision function offsets
+      blitz::Array<double,1> m_prob_a; ///< pairwise probability information
+      blitz::Array<double,1> m_prob_b; ///< pairwise probability information
+
+  };
+
 }}
 
 #endif /* BOB_MACHINE_SVM_H */
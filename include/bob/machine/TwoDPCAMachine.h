@@ -97,6 +97,7 @@ namespace bob {
         /// Output the projected sample, x 
         /// (overrides Machine::forward)
         void forward(const blitz::Array<double,2>& input, blitz::Array<double,2>& output) const;
+        using Machine<blitz::Array<double,2>, blitz::Array<double,2> >::forward;
 
         /// Print the parameters of the GMM
         void print() const;
@@ -22,6 +22,8 @@
 #define BOB_MACHINE_ZTNORM_H
 
 #include <blitz/array.h>
+#include <string>
+#include "bob/io/HDF5File.h"
 
 namespace bob { namespace machine {
 
@@ -36,6 +38,7 @@ namespace bob { namespace machine {
    * @param rawscores_zprobes_vs_tmodels
    * @param mask_zprobes_vs_tmodels_istruetrial
    * @param[out] normalizedscores normalized scores
+   * @param n_threads number of threads used by each step (see below)
    * @warning The destination score array should have the correct size
    *          (Same size as rawscores_probes_vs_models)
    */
@@ -44,7 +47,8 @@ namespace bob { namespace machine {
               const blitz::Array<double, 2>& rawscores_probes_vs_tmodels,
               const blitz::Array<double, 2>& rawscores_zprobes_vs_tmodels,
               const blitz::Array<bool,   2>& mask_zprobes_vs_tmodels_istruetrial,
-              blitz::Array<double, 2>& normalizedscores);
+              blitz::Array<double, 2>& normalizedscores,
+              const size_t n_threads=1);
   
   /**
    * Normalise raw scores with ZT-Norm.
@@ -57,6 +61,7 @@ namespace bob { namespace machine {
    * @param rawscores_probes_vs_tmodels
    * @param rawscores_zprobes_vs_tmodels
    * @param[out] normalizedscores normalized scores
+   * @param n_threads number of threads used by each step (see below)
    * @warning The destination score array should have the correct size
    *          (Same size as rawscores_probes_vs_models)
    */
@@ -64,7 +69,92 @@ namespace bob { namespace machine {
               const blitz::Array<double, 2>& rawscores_zprobes_vs_models,
               const blitz::Array<double, 2>& rawscores_probes_vs_tmodels,
               const blitz::Array<double, 2>& rawscores_zprobes_vs_tmodels,
-              blitz::Array<double, 2>& normalizedscores);
+              blitz::Array<double, 2>& normalizedscores,
+              const size_t n_threads=1);
+
+  /**
+   * The functions below split ZT-Norm into the computation of the 
+   * statistics of the cohorts and their application to the raw scores. 
+   * This allows the statistics to be reused across several calls (e.g. when
+   * the probes are scored in several batches against the same models), and
+   * the raw scores to be normalized in place, without any full-size 
+   * temporary. Calling in order:
+   *   zNormStatistics(B, z_mean, z_std)
+   *   tNormCohortStatistics(D, mask, t_mean, t_std)
+   *   ztNormStatistics(C, t_mean, t_std, zt_mean, zt_std)
+   *   ztNormApply(A, z_mean, z_std, zt_mean, zt_std, scores)
+   * is equivalent to calling ztNorm(A, B, C, D, mask, scores).
+   * All these functions split their work across n_threads threads.
+   */
+
+  /**
+   * Computes the Z-Norm statistics, i.e. the mean and the (unbiased) 
+   * standard deviation of each row of rawscores_zprobes_vs_models. 
+   * Standard deviations close to zero are replaced by 1.
+   */
+  void zNormStatistics(const blitz::Array<double, 2>& rawscores_zprobes_vs_models,
+                       blitz::Array<double, 1>& mean,
+                       blitz::Array<double, 1>& stddev,
+                       const size_t n_threads=1);
+
+  /**
+   * Computes the statistics of the T-Norm cohort, i.e. the mean and the
+   * standard deviation of each row of rawscores_zprobes_vs_tmodels, 
+   * ignoring the true trials flagged in mask_zprobes_vs_tmodels_istruetrial.
+   * These statistics only depend on the cohorts, and can hence be reused
+   * for any set of probes and models.
+   */
+  void tNormCohortStatistics(const blitz::Array<double, 2>& rawscores_zprobes_vs_tmodels,
+                             const blitz::Array<bool,   2>& mask_zprobes_vs_tmodels_istruetrial,
+                             blitz::Array<double, 1>& mean,
+                             blitz::Array<double, 1>& stddev,
+                             const size_t n_threads=1);
+  void tNormCohortStatistics(const blitz::Array<double, 2>& rawscores_zprobes_vs_tmodels,
+                             blitz::Array<double, 1>& mean,
+                             blitz::Array<double, 1>& stddev,
+                             const size_t n_threads=1);
+
+  /**
+   * Computes the ZT-Norm statistics, i.e. the mean and the standard 
+   * deviation of each column of rawscores_probes_vs_tmodels, once these 
+   * scores have been Z-normalized with the statistics of the T-Norm cohort
+   * (see tNormCohortStatistics()).
+   */
+  void ztNormStatistics(const blitz::Array<double, 2>& rawscores_probes_vs_tmodels,
+                        const blitz::Array<double, 1>& cohort_mean,
+                        const blitz::Array<double, 1>& cohort_std,
+                        blitz::Array<double, 1>& mean,
+                        blitz::Array<double, 1>& stddev,
+                        const size_t n_threads=1);
+
+  /**
+   * Normalizes raw scores with precomputed Z-Norm statistics (one per row)
+   * and ZT-Norm statistics (one per column). The scores are processed in 
+   * cache-sized tiles. rawscores_probes_vs_models and normalizedscores 
+   * might be the same array, in which case the scores are normalized in 
+   * place.
+   */
+  void ztNormApply(const blitz::Array<double, 2>& rawscores_probes_vs_models,
+                   const blitz::Array<double, 1>& z_mean,
+                   const blitz::Array<double, 1>& z_std,
+                   const blitz::Array<double, 1>& zt_mean,
+                   const blitz::Array<double, 1>& zt_std,
+                   blitz::Array<double, 2>& normalizedscores,
+                   const size_t n_threads=1);
+
+  /**
+   * Same as above, but the normalized scores are streamed to the given 
+   * HDF5 file, instead of being stored in memory. Each row of normalized
+   * scores is appended as a new entry of the dataset at the given path.
+   * Only a block of rows is kept in memory at a time.
+   */
+  void ztNormApply(const blitz::Array<double, 2>& rawscores_probes_vs_models,
+                   const blitz::Array<double, 1>& z_mean,
+                   const blitz::Array<double, 1>& z_std,
+                   const blitz::Array<double, 1>& zt_mean,
+                   const blitz::Array<double, 1>& zt_std,
+                   bob::io::HDF5File& file, const std::string& path,
+                   const size_t n_threads=1);
 }
 }
 
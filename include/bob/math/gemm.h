@@ -0,0 +1,79 @@
+/**
+ * @file bob/math/gemm.h
+ * @date Mon Oct 19 16:52:31 2026 +0200
+ *
+ * @brief Matrix-matrix multiplication of 2D blitz arrays using the BLAS
+ * (sgemm and dgemm). Contrary to bob::math::prod(), which is based on blitz
+ * expression templates, these functions are meant to be used on large
+ * matrices, where the cache-aware BLAS implementation makes a difference.
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOB_MATH_GEMM_H
+#define BOB_MATH_GEMM_H
+
+#include <blitz/array.h>
+
+namespace bob {
+/**
+ * \ingroup libmath_api
+ * @{
+ *
+ */
+  namespace math {
+
+    /**
+     * @brief Computes C = alpha*op(A)*op(B) + beta*C, where op(X) is either
+     * X or X^T, depending on the value of transA and transB.
+     *
+     * Input arrays that are not C-style contiguous are copied before the call
+     * to the BLAS. If C is not C-style contiguous, the result is computed in
+     * a temporary array and copied back.
+     *
+     * @param A The A matrix (size MxK, or KxM if transA is set)
+     * @param B The B matrix (size KxN, or NxK if transB is set)
+     * @param C The resulting matrix (size MxN)
+     * @param transA Whether A should be transposed
+     * @param transB Whether B should be transposed
+     * @param alpha Scaling factor of the product
+     * @param beta Scaling factor of the previous content of C
+     */
+    void gemm(const blitz::Array<double,2>& A, const blitz::Array<double,2>& B,
+        blitz::Array<double,2>& C, bool transA=false, bool transB=false,
+        double alpha=1., double beta=0.);
+    void gemm(const blitz::Array<float,2>& A, const blitz::Array<float,2>& B,
+        blitz::Array<float,2>& C, bool transA=false, bool transB=false,
+        float alpha=1.f, float beta=0.f);
+
+    /**
+     * @brief Same as gemm() above, but does not check the dimensions of the
+     * input and output arrays. This is recommended only in scenarios where
+     * you have previously checked conformity and is focused only on speed.
+     */
+    void gemm_(const blitz::Array<double,2>& A, const blitz::Array<double,2>& B,
+        blitz::Array<double,2>& C, bool transA=false, bool transB=false,
+        double alpha=1., double beta=0.);
+    void gemm_(const blitz::Array<float,2>& A, const blitz::Array<float,2>& B,
+        blitz::Array<float,2>& C, bool transA=false, bool transB=false,
+        float alpha=1.f, float beta=0.f);
+
+  }
+/**
+ * @}
+ */
+}
+
+#endif /* BOB_MATH_GEMM_H */
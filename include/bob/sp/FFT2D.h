@@ -26,6 +26,7 @@
 
 #include <complex>
 #include <blitz/array.h>
+#include <boost/shared_ptr.hpp>
 
 namespace bob {
 /**
@@ -35,10 +36,18 @@ namespace bob {
  */
   namespace sp {
 
+    namespace detail {
+      // the FFTW plans for a given 2D shape (defined in FFT2D.cc)
+      class FFT2DPlans;
+    }
+
     /**
       * @brief This class implements a Discrete Fourier Transform based on the
       * FFTW library. It is used as a base class for FFT2D and 
       * IFFT2D classes.
+      * The FFTW plans are created once for the current shape and reused for
+      * all transforms of arrays of this shape. Transforms can be run
+      * concurrently from several threads on the same object.
       */
     class FFT2DAbstract
     {
@@ -85,7 +94,8 @@ namespace bob {
         virtual void operator()(blitz::Array<std::complex<double>,2>& src_dst) = 0;
 
         /**
-          * @brief Reset the FFT2D object for the given 2D shape
+          * @brief Reset the FFT2D object for the given 2D shape (and
+          * discards the FFTW plans of the previous shape)
           */
         void reset(const size_t height, const size_t width);
 
@@ -107,6 +117,7 @@ namespace bob {
           */
         size_t m_height;
         size_t m_width;
+        boost::shared_ptr<detail::FFT2DPlans> m_plans;
     };
 
 
@@ -157,6 +168,27 @@ namespace bob {
           * @brief process an array by applying the FFT inplace
           */
         virtual void operator()(blitz::Array<std::complex<double>,2>& src_dst);
+
+        /**
+          * @brief process a real array by applying the direct FFT
+          * This uses a real-input FFT, which is about twice as fast as the
+          * complex one. The full (Hermitian symmetric) spectrum is returned.
+          */
+        void operator()(const blitz::Array<double,2>& src,
+          blitz::Array<std::complex<double>,2>& dst);
+
+        /**
+          * @brief process an array by applying the direct FFT in single
+          * precision
+          */
+        void operator()(const blitz::Array<std::complex<float>,2>& src,
+          blitz::Array<std::complex<float>,2>& dst);
+
+        /**
+          * @brief process an array by applying the FFT inplace in single
+          * precision
+          */
+        void operator()(blitz::Array<std::complex<float>,2>& src_dst);
     };
 
 
@@ -207,6 +239,19 @@ namespace bob {
           * @brief process an array by applying the inverse FFT inplace
           */
         virtual void operator()(blitz::Array<std::complex<double>,2>& src_dst);
+
+        /**
+          * @brief process an array by applying the inverse FFT in single
+          * precision
+          */
+        void operator()(const blitz::Array<std::complex<float>,2>& src,
+          blitz::Array<std::complex<float>,2>& dst);
+
+        /**
+          * @brief process an array by applying the inverse FFT inplace in
+          * single precision
+          */
+        void operator()(blitz::Array<std::complex<float>,2>& src_dst);
     };
 
   }
@@ -0,0 +1,256 @@
+/**
+ * @file bob/trainer/BlockSampler.h
+ * @date Mon Oct 19 21:02:47 2026 +0200
+ *
+ * @brief Samplers that stream the training samples as fixed-size blocks of
+ * rows, such that EM trainers do not require the whole training set in
+ * memory.
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOB_TRAINER_BLOCKSAMPLER_H
+#define BOB_TRAINER_BLOCKSAMPLER_H
+
+#include <vector>
+#include <string>
+#include <exception>
+#include <blitz/array.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include "bob/io/HDF5File.h"
+
+namespace bob { namespace trainer {
+
+  /**
+   * A sampler streams a (possibly very large) set of samples of the same
+   * dimensionality, as consecutive blocks of (at most) getBlockSize() rows.
+   * Only two blocks are kept in memory: if read-ahead is enabled, the next
+   * block is read by a background thread while the current one is
+   * processed.
+   *
+   * Derived classes implement rewind(), fill() and readSample(), and must
+   * call join() in their destructor, before their resources are released.
+   */
+  class BlockSampler {
+
+    public: //api
+
+      /**
+       * D'tor virtualization
+       */
+      virtual ~BlockSampler();
+
+      /**
+       * Total number of samples
+       */
+      inline size_t size() const { return m_n_samples; }
+
+      /**
+       * Dimensionality of the samples
+       */
+      inline size_t getNInputs() const { return m_n_inputs; }
+
+      /**
+       * Maximum number of samples of a block
+       */
+      inline size_t getBlockSize() const { return m_block_size; }
+
+      /**
+       * Tells if the next block is read in the background
+       */
+      inline bool getReadAhead() const { return m_read_ahead; }
+
+      /**
+       * Restarts the stream from the first sample
+       */
+      void reset();
+
+      /**
+       * Gets the next block of samples (one per row), which is valid until
+       * the next call to next() or reset(). Returns false at the end of the
+       * stream.
+       */
+      bool next(blitz::Array<double,2>& block);
+
+      /**
+       * Reads the sample with the given index (random access, which is much
+       * slower than streaming the samples)
+       */
+      void sample(const size_t index, blitz::Array<double,1>& x);
+
+    protected: //api for derived classes
+
+      /**
+       * Builds a sampler streaming blocks of the given size
+       */
+      BlockSampler(const size_t block_size, const bool read_ahead);
+
+      /**
+       * Sets the number of samples and their dimensionality, and allocates
+       * the two blocks
+       */
+      void setShape(const size_t n_samples, const size_t n_inputs);
+
+      /**
+       * Moves the stream back to the first sample
+       */
+      virtual void rewind() = 0;
+
+      /**
+       * Reads the next samples of the stream into the rows of buffer, and
+       * returns the number of samples read (0 at the end of the stream)
+       */
+      virtual size_t fill(blitz::Array<double,2>& buffer) = 0;
+
+      /**
+       * Reads the sample with the given index
+       */
+      virtual void readSample(const size_t index, blitz::Array<double,1>& x) = 0;
+
+      /**
+       * Waits for the block being read in the background (if any), and
+       * re-throws the exception it may have raised
+       */
+      void join();
+
+    private: //methods
+
+      /**
+       * Reads the back block (run in the background)
+       */
+      void fillBack();
+
+      BlockSampler(const BlockSampler& other);
+      BlockSampler& operator=(const BlockSampler& other);
+
+    private: //representation
+
+      size_t m_block_size;
+      bool m_read_ahead;
+      size_t m_n_samples;
+      size_t m_n_inputs;
+      blitz::Array<double,2> m_blocks[2]; ///< front (returned) and back blocks
+      size_t m_front; ///< index of the front block
+      size_t m_back_rows; ///< number of samples in the back block
+      bool m_back_ready; ///< tells if the back block has been read
+      bool m_running; ///< tells if the back block is being read
+      boost::thread m_thread;
+      std::exception_ptr m_error;
+  };
+
+  /**
+   * Streams the rows of a 2D dataset stored in a list of HDF5 files (e.g.
+   * one file of features per recording). The dataset may either be a 2D
+   * array or a list of 1D arrays (appended one by one), in single or double
+   * precision. A single file is opened at a time.
+   */
+  class HDF5BlockSampler: public BlockSampler {
+
+    public: //api
+
+      /**
+       * Builds a sampler streaming the given dataset of the given files
+       */
+      HDF5BlockSampler(const std::vector<std::string>& filenames,
+          const std::string& dataset = "array", const size_t block_size = 4096,
+          const bool read_ahead = true);
+
+      virtual ~HDF5BlockSampler();
+
+      /**
+       * Names of the files
+       */
+      inline const std::vector<std::string>& getFilenames() const
+      { return m_filenames; }
+
+    protected: //api
+
+      virtual void rewind();
+      virtual size_t fill(blitz::Array<double,2>& buffer);
+      virtual void readSample(const size_t index, blitz::Array<double,1>& x);
+
+    private: //methods
+
+      /**
+       * Reads n rows of the given file, starting at row begin
+       */
+      void readRows(bob::io::HDF5File& file, const size_t f,
+          const size_t begin, const size_t n, blitz::Array<double,2> rows);
+
+    private: //representation
+
+      std::vector<std::string> m_filenames;
+      std::string m_dataset;
+      std::vector<size_t> m_offsets; ///< index of the first sample of each file
+      std::vector<bool> m_single_precision; ///< type of each dataset
+      size_t m_file; ///< current file
+      size_t m_row; ///< current row in the current file
+      boost::shared_ptr<bob::io::HDF5File> m_current; ///< current file
+  };
+
+  /**
+   * Streams the samples stored in a list of raw binary files, which are
+   * memory-mapped. Each file contains consecutive samples of n_inputs
+   * 32-bit (single precision) or 64-bit floats, in native byte order and
+   * without any header. A single file is mapped at a time.
+   */
+  class BinaryBlockSampler: public BlockSampler {
+
+    public: //api
+
+      /**
+       * Builds a sampler streaming the given files
+       */
+      BinaryBlockSampler(const std::vector<std::string>& filenames,
+          const size_t n_inputs, const bool single_precision = false,
+          const size_t block_size = 4096, const bool read_ahead = true);
+
+      virtual ~BinaryBlockSampler();
+
+      /**
+       * Names of the files
+       */
+      inline const std::vector<std::string>& getFilenames() const
+      { return m_filenames; }
+
+    protected: //api
+
+      virtual void rewind();
+      virtual size_t fill(blitz::Array<double,2>& buffer);
+      virtual void readSample(const size_t index, blitz::Array<double,1>& x);
+
+    private: //methods
+
+      /**
+       * Copies n samples of the given mapped file, starting at row begin
+       */
+      void copyRows(const boost::iostreams::mapped_file_source& file,
+          const size_t begin, const size_t n, blitz::Array<double,2> rows) const;
+
+    private: //representation
+
+      std::vector<std::string> m_filenames;
+      bool m_single_precision;
+      std::vector<size_t> m_offsets; ///< index of the first sample of each file
+      size_t m_file; ///< current file
+      size_t m_row; ///< current row in the current file
+      boost::iostreams::mapped_file_source m_current; ///< current file
+  };
+
+}}
+
+#endif /* BOB_TRAINER_BLOCKSAMPLER_H */
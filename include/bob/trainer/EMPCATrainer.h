@@ -29,6 +29,18 @@
 #include "bob/machine/LinearMachine.h"
 
 namespace bob { namespace trainer {
+
+  /**
+    * The sufficient statistics accumulated by the E-step of the 
+    * EMPCATrainer, over a set of samples t_i
+    */
+  struct EMPCAAccumulator
+  {
+    blitz::Array<double,2> tz; ///< sum{ (t_i - mu) E(z_i)^T } (n_features x d)
+    blitz::Array<double,2> zz; ///< sum{ E(z_i z_i^T) } (d x d)
+    double sumSqNorm; ///< sum{ ||t_i - mu||^2 }
+    size_t nSamples; ///< number of samples
+  };
   
   /**
     * Sets a linear machine to perform Expectation Maximization on a
@@ -49,9 +61,12 @@ namespace bob { namespace trainer {
     *  - mu is the mean of the data (dimension f)
     *  - epsilon is the noise of the data (dimension f)
     *      Gaussian with zero-mean and covariance matrix sigma^2 * Id
+    *
+    * The E-step only keeps the sums of the moments of the latent variables
+    * (EMPCAAccumulator), and is split across setNThreads() threads.
     */
-  class EMPCATrainer: public EMTrainer<bob::machine::LinearMachine, 
-                                          blitz::Array<double,2> > 
+  class EMPCATrainer: public ParallelEMTrainer<bob::machine::LinearMachine, 
+                                          EMPCAAccumulator> 
   {
     public: //api
       /**
@@ -82,6 +97,12 @@ namespace bob { namespace trainer {
         */
       virtual void initialization(bob::machine::LinearMachine& machine, 
         const blitz::Array<double,2>& ar);
+      /**
+        * Same as above, for samples streamed by a sampler (two passes are 
+        * made to compute the mean and the covariance of the data)
+        */
+      virtual void initialization(bob::machine::LinearMachine& machine, 
+        BlockSampler& sampler);
       /**
         * This methods performs some actions after the end of the E- and 
         * M-steps.
@@ -89,15 +110,6 @@ namespace bob { namespace trainer {
       virtual void finalization(bob::machine::LinearMachine& machine, 
         const blitz::Array<double,2>& ar);
       
-      /**
-        * Calculates and saves statistics across the dataset, and saves these 
-        * as m_z_{first,second}_order. 
-        * 
-        * The statistics will be used in the mStep() that follows.
-        */
-      virtual void eStep(bob::machine::LinearMachine& machine, 
-        const blitz::Array<double,2>& ar);
-
       /**
         * Performs a maximization step to update the parameters of the 
         */
@@ -131,11 +143,45 @@ namespace bob { namespace trainer {
         */
       inline double getSigma2() const { return m_sigma2; }
 
+      /**
+        * Saves (resp. loads) sigma2, which is required to resume a training
+        */
+      virtual void saveState(bob::io::HDF5File& file) const;
+      virtual void loadState(bob::machine::LinearMachine& machine, 
+        bob::io::HDF5File& file);
+
+    protected: //E-step
+      /**
+        * The statistics of the E-step are accumulated into m_acc
+        */
+      virtual EMPCAAccumulator& accumulator() { return m_acc; }
+
+      /**
+        * Resizes the given statistics to the machine, and sets them to zero
+        */
+      virtual void resetAccumulator(const bob::machine::LinearMachine& machine,
+        EMPCAAccumulator& acc) const;
+
+      /**
+        * Adds the statistics of other to acc
+        */
+      virtual void mergeAccumulator(EMPCAAccumulator& acc, 
+        const EMPCAAccumulator& other) const;
+
+      /**
+        * Accumulates the statistics of the samples [begin, end), given the 
+        * first and second order moments of their latent variables: 
+        *   E(z_i) = inv(M) * W^T * (t_i - mu)
+        *   E(z_i z_i^T) = sigma2 * inv(M) + E(z_i) * E(z_i)^T
+        */
+      virtual void eStepRange(const bob::machine::LinearMachine& machine,
+        const blitz::Array<double,2>& ar, EMPCAAccumulator& acc,
+        const size_t begin, const size_t end) const;
+
     private: //representation
       double m_dimensionality; /// Dimensionality of the new/projected data
       blitz::Array<double,2> m_S; /// Covariance of the training data (required only if we need to compute the log likelihood)
-      blitz::Array<double,2> m_z_first_order; /// Current mean of the z_{n} latent variable
-      blitz::Array<double,3> m_z_second_order; /// Current covariance of the z_{n} latent variable
+      EMPCAAccumulator m_acc; /// Statistics of the latent variables z_{n}, accumulated during the E-step
       blitz::Array<double,2> m_inW; /// The matrix product W^T.W
       blitz::Array<double,2> m_invM; /// The matrix inv(M), where M = W^T.W + sigma2*Id
       double m_sigma2; /// The variance sigma^2 of the noise epsilon of the probabilistic model
@@ -143,13 +189,9 @@ namespace bob { namespace trainer {
       int m_seed; /// The seed for the random initialization of W and sigma2
 
       // Cache
-      mutable blitz::Array<double,2> m_cache_dxf; /// Cache of size m_dimensionality x n_features
-      mutable blitz::Array<double,1> m_cache_d; /// Cache of size m_dimensionality
-      mutable blitz::Array<double,1> m_cache_f; /// Cache of size n_features
       mutable blitz::Array<double,2> m_cache_dxd_1; /// Cache of size m_dimensionality x m_dimensionality
       mutable blitz::Array<double,2> m_cache_dxd_2; /// Cache of size m_dimensionality x m_dimensionality
       mutable blitz::Array<double,2> m_cache_fxd_1; /// Cache of size n_features x m_dimensionality 
-      mutable blitz::Array<double,2> m_cache_fxd_2; /// Cache of size n_features x m_dimensionality 
       mutable blitz::Array<double,2> m_cache_fxf_1; /// Cache of size n_features x n_features
       mutable blitz::Array<double,2> m_cache_fxf_2; /// Cache of size n_features x n_features
 
@@ -157,12 +199,14 @@ namespace bob { namespace trainer {
       /**
         * Initializes/resizes the (array) members
         */
-      void initMembers(const blitz::Array<double,2>& ar);
+      void initMembers(const size_t n_features);
       /**
         * Computes the mean and the variance (if required) of the training data
         */
       void computeMeanVariance(bob::machine::LinearMachine& machine, 
         const blitz::Array<double,2>& ar);
+      void computeMeanVariance(bob::machine::LinearMachine& machine, 
+        BlockSampler& sampler);
       /**
         * Random initialization of W and sigma2
         * W is the projection matrix (from the LinearMachine)
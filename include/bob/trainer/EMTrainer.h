@@ -28,10 +28,69 @@
 #include "bob/trainer/Trainer.h"
 
 #include <limits>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <ctime>
+#include <stdexcept>
+#include <stdint.h>
+#include <blitz/array.h>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/format.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include "bob/core/array_alias.h"
 #include "bob/core/logging.h"
+#include "bob/core/parallel.h"
+#include "bob/io/HDF5File.h"
+#include "bob/trainer/BlockSampler.h"
 
 
 namespace bob { namespace trainer {
+
+  /**
+    * @brief The measurements of an iteration of an EM training, as given to
+    * the observer of an EMTrainer. Times are in seconds, the CPU times being
+    * those of the whole process (i.e. summed over all its threads).
+    */
+  struct EMIteration {
+    /**
+      * Number of completed iterations. It is 0 for the initial E-step (or, 
+      * when resuming, the number of iterations of the checkpoint), whose 
+      * M-step times are then 0.
+      */
+    size_t iteration;
+    double likelihood; ///< average output, NaN if not computed
+    double delta; ///< relative change of the average output, NaN if not computed
+    double e_step_wall;
+    double e_step_cpu;
+    double m_step_wall;
+    double m_step_cpu;
+  };
+
+  /**
+    * @brief Function called by an EMTrainer after each iteration
+    */
+  typedef boost::function<void (const EMIteration&)> EMObserver;
+
+  namespace detail {
+
+    /**
+      * Calls f, and measures its wall and (process) CPU times in seconds
+      */
+    inline void timed(const boost::function<void ()>& f, double& wall, 
+      double& cpu)
+    {
+      const boost::posix_time::ptime wall_start = 
+        boost::posix_time::microsec_clock::universal_time();
+      const std::clock_t cpu_start = std::clock();
+      f();
+      cpu = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+      wall = (boost::posix_time::microsec_clock::universal_time() - 
+          wall_start).total_microseconds() / 1e6;
+    }
+
+  }
   
   /**
     * @brief This class implements the general Expectation-maximization algorithm.
@@ -54,6 +113,9 @@ namespace bob { namespace trainer {
         m_compute_likelihood = other.m_compute_likelihood;
         m_convergence_threshold = other.m_convergence_threshold;
         m_max_iterations = other.m_max_iterations;
+        m_checkpoint = other.m_checkpoint;
+        m_checkpoint_every = other.m_checkpoint_every;
+        m_observer = other.m_observer;
       }
       return *this;
     }
@@ -90,52 +152,41 @@ namespace bob { namespace trainer {
       // Initialization
       initialization(machine, sampler);
       // Do the Expectation-Maximization algorithm
-      double average_output_previous = - std::numeric_limits<double>::max();
-      double average_output = - std::numeric_limits<double>::max();
-      
-      // - eStep
-      eStep(machine, sampler);
-   
-      // - iterates...
-      for(size_t iter=0; ; ++iter) {
-        
-        // - saves average output from last iteration
-        average_output_previous = average_output;
-       
-        // - mStep
-        mStep(machine, sampler);
-        
-        // - eStep
-        eStep(machine, sampler);
-   
-        // - Computes log likelihood if required
-        if(m_compute_likelihood) {
-          average_output = computeLikelihood(machine);
-        
-          bob::core::info << "# Iteration " << iter+1 << ": " 
-            << average_output_previous << " -> " 
-            << average_output << std::endl;
-        
-          // - Terminates if converged (and likelihood computation is set)
-          if(fabs((average_output_previous - average_output)/average_output_previous) <= m_convergence_threshold) {
-            bob::core::info << "# EM terminated: likelihood converged" << std::endl;
-            break;
-          }
-        }
-        else
-          bob::core::info << "# Iteration " << iter+1 << std::endl;
-        
-        // - Terminates if maximum number of iterations has been reached
-        if(m_max_iterations > 0 && iter+1 >= m_max_iterations) {
-          bob::core::info << "# EM terminated: maximum number of iterations reached." << std::endl;
-          break;
-        }
-      }
-
+      iterate(machine, 
+        boost::bind(&EMTrainer<T_machine, T_sampler>::eStep, this, 
+          boost::ref(machine), boost::cref(sampler)),
+        boost::bind(&EMTrainer<T_machine, T_sampler>::mStep, this, 
+          boost::ref(machine), boost::cref(sampler)),
+        0, - std::numeric_limits<double>::max());
       // Finalization
       finalization(machine, sampler);
     }
 
+    /**
+      * Resumes a training from a checkpoint (see setCheckpoint()). The 
+      * trainer is initialized with the sampler, and the machine and the 
+      * state of the trainer are then loaded from the checkpoint. The 
+      * training goes on until the maximum number of iterations (which 
+      * includes the iterations of the checkpoint) is reached, or until
+      * convergence.
+      */
+    virtual void resume(T_machine& machine, const T_sampler& sampler,
+      const std::string& checkpoint)
+    {
+      bob::core::info << "# EMTrainer (resumed from '" << checkpoint << "'):" << std::endl;
+      initialization(machine, sampler);
+      size_t iteration;
+      double average_output;
+      loadCheckpoint(machine, checkpoint, iteration, average_output);
+      iterate(machine, 
+        boost::bind(&EMTrainer<T_machine, T_sampler>::eStep, this, 
+          boost::ref(machine), boost::cref(sampler)),
+        boost::bind(&EMTrainer<T_machine, T_sampler>::mStep, this, 
+          boost::ref(machine), boost::cref(sampler)),
+        iteration, average_output);
+      finalization(machine, sampler);
+    }
+
     /**
       * This method is called before the EM algorithm 
       */
@@ -207,10 +258,67 @@ namespace bob { namespace trainer {
       return m_max_iterations;
     }
 
+    /**
+      * Sets the function called after the initial E-step and after each
+      * iteration (an empty function disables the notifications)
+      */
+    void setObserver(const EMObserver& observer) {
+      m_observer = observer;
+    }
+
+    /**
+      * Gets the function called after each iteration
+      */
+    const EMObserver& getObserver() const {
+      return m_observer;
+    }
+
+    /**
+      * Saves the machine and the state of the trainer into the given HDF5 
+      * file every 'every' iterations, such that the training may be resumed
+      * with resume(). The file is written atomically (i.e. it is first 
+      * written to filename.tmp, which is then renamed). An empty filename
+      * disables the checkpoints.
+      */
+    void setCheckpoint(const std::string& filename, const size_t every = 1) {
+      m_checkpoint = filename;
+      m_checkpoint_every = every;
+    }
+
+    /**
+      * Gets the file of the checkpoints
+      */
+    const std::string& getCheckpoint() const {
+      return m_checkpoint;
+    }
+
+    /**
+      * Gets the number of iterations between two checkpoints
+      */
+    size_t getCheckpointEvery() const {
+      return m_checkpoint_every;
+    }
+
+    /**
+      * Saves the state of the trainer, besides the machine, that is required
+      * to resume a training (e.g. parameters estimated by the M-step which 
+      * are not part of the machine). Nothing is saved by default.
+      */
+    virtual void saveState(bob::io::HDF5File& file) const {}
+
+    /**
+      * Restores the state saved by saveState(). It is called by resume(), 
+      * after initialization() and after the machine has been loaded.
+      */
+    virtual void loadState(T_machine& machine, bob::io::HDF5File& file) {}
+
   protected:
     bool m_compute_likelihood;
     double m_convergence_threshold;
     size_t m_max_iterations;
+    std::string m_checkpoint;
+    size_t m_checkpoint_every;
+    EMObserver m_observer;
 
     /**
       * Protected constructor to be called in the constructor of derived 
@@ -220,8 +328,352 @@ namespace bob { namespace trainer {
         size_t max_iterations = 10, bool compute_likelihood = true):
       m_compute_likelihood(compute_likelihood), 
       m_convergence_threshold(convergence_threshold), 
-      m_max_iterations(max_iterations) 
+      m_max_iterations(max_iterations),
+      m_checkpoint_every(0)
+    {
+    }
+
+    /**
+      * Runs the EM iterations, starting after first_iteration iterations
+      * (with the given average output), until convergence or until the 
+      * maximum number of iterations is reached. The observer is notified, 
+      * and the checkpoints are saved, along the way.
+      */
+    void iterate(T_machine& machine, const boost::function<void ()>& e_step,
+      const boost::function<void ()>& m_step, const size_t first_iteration,
+      double average_output)
+    {
+      double average_output_previous = average_output;
+      EMIteration it;
+      it.iteration = first_iteration;
+      it.likelihood = first_iteration > 0 ? average_output : 
+        std::numeric_limits<double>::quiet_NaN();
+      it.delta = std::numeric_limits<double>::quiet_NaN();
+      it.m_step_wall = it.m_step_cpu = 0.;
+      
+      // - eStep
+      detail::timed(e_step, it.e_step_wall, it.e_step_cpu);
+      if(m_observer) m_observer(it);
+   
+      // - iterates...
+      for(size_t iter=first_iteration; ; ++iter) {
+
+        // - Terminates if a resumed training has already reached the 
+        //   maximum number of iterations
+        if(m_max_iterations > 0 && iter >= m_max_iterations) {
+          bob::core::info << "# EM terminated: maximum number of iterations reached." << std::endl;
+          break;
+        }
+        
+        // - saves average output from last iteration
+        average_output_previous = average_output;
+       
+        // - mStep
+        detail::timed(m_step, it.m_step_wall, it.m_step_cpu);
+        
+        // - eStep
+        detail::timed(e_step, it.e_step_wall, it.e_step_cpu);
+   
+        it.iteration = iter+1;
+        bool converged = false;
+        // - Computes log likelihood if required
+        if(m_compute_likelihood) {
+          average_output = computeLikelihood(machine);
+        
+          bob::core::info << "# Iteration " << iter+1 << ": " 
+            << average_output_previous << " -> " 
+            << average_output << std::endl;
+        
+          it.likelihood = average_output;
+          it.delta = fabs((average_output_previous - average_output)/average_output_previous);
+          converged = it.delta <= m_convergence_threshold;
+        }
+        else
+          bob::core::info << "# Iteration " << iter+1 << std::endl;
+
+        if(m_observer) m_observer(it);
+        if(!m_checkpoint.empty() && m_checkpoint_every > 0 && 
+            (iter+1) % m_checkpoint_every == 0)
+          saveCheckpoint(machine, iter+1, average_output);
+        
+        // - Terminates if converged (and likelihood computation is set)
+        if(converged) {
+          bob::core::info << "# EM terminated: likelihood converged" << std::endl;
+          break;
+        }
+        
+        // - Terminates if maximum number of iterations has been reached
+        if(m_max_iterations > 0 && iter+1 >= m_max_iterations) {
+          bob::core::info << "# EM terminated: maximum number of iterations reached." << std::endl;
+          break;
+        }
+      }
+    }
+
+    /**
+      * Atomically saves the machine, the state of the trainer, the number 
+      * of iterations and the average output into the checkpoint file
+      */
+    void saveCheckpoint(const T_machine& machine, const size_t iteration,
+      const double average_output) const
+    {
+      const std::string tmp = m_checkpoint + ".tmp";
+      {
+        bob::io::HDF5File file(tmp, bob::io::HDF5File::trunc);
+        file.set("iteration", static_cast<int64_t>(iteration));
+        file.set("average_output", average_output);
+        file.createGroup("machine");
+        file.cd("machine");
+        machine.save(file);
+        file.cd("..");
+        file.createGroup("trainer");
+        file.cd("trainer");
+        saveState(file);
+        file.cd("..");
+      }
+      if(std::rename(tmp.c_str(), m_checkpoint.c_str()) != 0) {
+        boost::format m("cannot rename the checkpoint '%s' to '%s'");
+        m % tmp % m_checkpoint;
+        throw std::runtime_error(m.str());
+      }
+    }
+
+    /**
+      * Loads the machine and the state of the trainer from a checkpoint, 
+      * and returns its number of iterations and average output
+      */
+    void loadCheckpoint(T_machine& machine, const std::string& filename,
+      size_t& iteration, double& average_output)
+    {
+      bob::io::HDF5File file(filename, bob::io::HDF5File::in);
+      iteration = static_cast<size_t>(file.read<int64_t>("iteration"));
+      average_output = file.read<double>("average_output");
+      file.cd("machine");
+      machine.load(file);
+      file.cd("..");
+      file.cd("trainer");
+      loadState(machine, file);
+      file.cd("..");
+    }
+  };
+
+  /**
+    * @brief An EMTrainer whose E-step is data-parallel: the samples (one per
+    * row of the sampler) are split into contiguous shards, which are 
+    * processed by different threads, each of them accumulating the 
+    * sufficient statistics of its shard into a private accumulator. The
+    * accumulators are then merged (in the order of the shards) before the
+    * M-step.
+    * @details Derived classes declare the type of their accumulator, and
+    * implement accumulator(), resetAccumulator(), mergeAccumulator() and 
+    * eStepRange() instead of eStep(). eStepRange() is called concurrently,
+    * and should hence only read the machine and the trainer.
+    *
+    * Such trainers may also be trained out-of-core, from a BlockSampler: 
+    * each E-step then makes a single pass over the blocks of samples. The 
+    * M-step and the finalization, which only use the accumulated 
+    * statistics, are given an empty (0 x n_inputs) array.
+    */
+  template<class T_machine, class T_accumulator>
+  class ParallelEMTrainer: public EMTrainer<T_machine, blitz::Array<double,2> >
+  {
+  public:
+    virtual ~ParallelEMTrainer() {}
+
+    using EMTrainer<T_machine, blitz::Array<double,2> >::train;
+    using EMTrainer<T_machine, blitz::Array<double,2> >::resume;
+    using EMTrainer<T_machine, blitz::Array<double,2> >::initialization;
+
+    /**
+      * Trains the machine with the samples streamed by the sampler
+      */
+    virtual void train(T_machine& machine, BlockSampler& sampler)
+    {
+      bob::core::info << "# EMTrainer (" << sampler.size() << " streamed samples):" << std::endl;
+      const blitz::Array<double,2> none(0, sampler.getNInputs());
+
+      // Initialization
+      initialization(machine, sampler);
+      // Do the Expectation-Maximization algorithm
+      this->iterate(machine, streamedEStep(machine, sampler), 
+        streamedMStep(machine, none), 0, - std::numeric_limits<double>::max());
+      // Finalization
+      this->finalization(machine, none);
+    }
+
+    /**
+      * Resumes a training with the samples streamed by the sampler from a 
+      * checkpoint
+      */
+    virtual void resume(T_machine& machine, BlockSampler& sampler,
+      const std::string& checkpoint)
+    {
+      bob::core::info << "# EMTrainer (" << sampler.size() << " streamed samples, resumed from '" << checkpoint << "'):" << std::endl;
+      const blitz::Array<double,2> none(0, sampler.getNInputs());
+      initialization(machine, sampler);
+      size_t iteration;
+      double average_output;
+      this->loadCheckpoint(machine, checkpoint, iteration, average_output);
+      this->iterate(machine, streamedEStep(machine, sampler), 
+        streamedMStep(machine, none), iteration, average_output);
+      this->finalization(machine, none);
+    }
+
+    /**
+      * This method is called before the EM algorithm, when training from a
+      * sampler. By default, the array initialization() is called with an
+      * empty (0 x n_inputs) array.
+      */
+    virtual void initialization(T_machine& machine, BlockSampler& sampler)
+    {
+      initialization(machine, blitz::Array<double,2>(0, sampler.getNInputs()));
+    }
+
+    /**
+      * Accumulates the sufficient statistics of all the samples into 
+      * accumulator(), using getNThreads() threads
+      */
+    virtual void eStep(T_machine& machine, const blitz::Array<double,2>& data)
+    {
+      T_accumulator& acc = accumulator();
+      resetAccumulator(machine, acc);
+      if(m_n_threads <= 1) {
+        if(data.extent(0) > 0) 
+          eStepRange(machine, data, acc, 0, data.extent(0));
+      }
+      else {
+        std::vector<T_accumulator> partial(m_n_threads);
+        const size_t n_shards = bob::core::thread_iloop(boost::bind(
+              &ParallelEMTrainer<T_machine, T_accumulator>::eStepShard, this,
+              boost::cref(machine), boost::cref(data), boost::ref(partial), 
+              _1, _2, _3), data.extent(0), m_n_threads);
+        for(size_t k=0; k<n_shards; ++k) mergeAccumulator(acc, partial[k]);
+      }
+      eStepMerged(machine, data.extent(0));
+    }
+
+    /**
+      * Accumulates the sufficient statistics of all the samples of the 
+      * sampler into accumulator(), in a single pass over its blocks. Each 
+      * block is split across getNThreads() threads.
+      */
+    virtual void eStep(T_machine& machine, BlockSampler& sampler)
+    {
+      T_accumulator& acc = accumulator();
+      resetAccumulator(machine, acc);
+      std::vector<T_accumulator> partial(m_n_threads > 1 ? m_n_threads : 0);
+      size_t n_samples = 0;
+      blitz::Array<double,2> block;
+      sampler.reset();
+      while(sampler.next(block)) {
+        if(m_n_threads <= 1)
+          eStepRange(machine, block, acc, 0, block.extent(0));
+        else {
+          const size_t n_shards = bob::core::thread_iloop(boost::bind(
+                &ParallelEMTrainer<T_machine, T_accumulator>::eStepShard, this,
+                boost::cref(machine), boost::cref(block), boost::ref(partial), 
+                _1, _2, _3), block.extent(0), m_n_threads);
+          for(size_t k=0; k<n_shards; ++k) mergeAccumulator(acc, partial[k]);
+        }
+        n_samples += block.extent(0);
+      }
+      eStepMerged(machine, n_samples);
+    }
+
+    /**
+      * Sets the number of threads the E-step is split across
+      */
+    void setNThreads(const size_t n_threads) {
+      m_n_threads = n_threads;
+    }
+
+    /**
+      * Gets the number of threads the E-step is split across
+      */
+    size_t getNThreads() const {
+      return m_n_threads;
+    }
+
+  protected:
+    size_t m_n_threads;
+
+    /**
+      * Protected constructor to be called in the constructor of derived 
+      * classes
+      */
+    ParallelEMTrainer(double convergence_threshold = 0.001, 
+        size_t max_iterations = 10, bool compute_likelihood = true,
+        size_t n_threads = 1):
+      EMTrainer<T_machine, blitz::Array<double,2> >(convergence_threshold,
+        max_iterations, compute_likelihood),
+      m_n_threads(n_threads)
+    {
+    }
+
+    /**
+      * Returns the accumulator the E-step results are merged into
+      */
+    virtual T_accumulator& accumulator() = 0;
+
+    /**
+      * Resizes the given accumulator for the machine, and sets it to zero
+      */
+    virtual void resetAccumulator(const T_machine& machine, 
+      T_accumulator& acc) const = 0;
+
+    /**
+      * Adds the statistics of other to acc
+      */
+    virtual void mergeAccumulator(T_accumulator& acc, 
+      const T_accumulator& other) const = 0;
+
+    /**
+      * Accumulates the statistics of the samples [begin, end) into acc. 
+      * This is called concurrently on different shards.
+      */
+    virtual void eStepRange(const T_machine& machine, 
+      const blitz::Array<double,2>& data, T_accumulator& acc,
+      const size_t begin, const size_t end) const = 0;
+
+    /**
+      * Called once the accumulators of all the n_samples samples have been 
+      * merged (e.g. to normalize them by the number of samples)
+      */
+    virtual void eStepMerged(T_machine& machine, const size_t n_samples) {}
+
+  private:
+    typedef EMTrainer<T_machine, blitz::Array<double,2> > base_type;
+
+    /**
+      * The E-step (resp. M-step) of a training from a sampler
+      */
+    boost::function<void ()> streamedEStep(T_machine& machine, 
+      BlockSampler& sampler)
+    {
+      void (ParallelEMTrainer<T_machine, T_accumulator>::*e_step)(T_machine&, 
+        BlockSampler&) = &ParallelEMTrainer<T_machine, T_accumulator>::eStep;
+      return boost::bind(e_step, this, boost::ref(machine), 
+        boost::ref(sampler));
+    }
+
+    boost::function<void ()> streamedMStep(T_machine& machine, 
+      const blitz::Array<double,2>& none)
+    {
+      return boost::bind(&base_type::mStep, this, boost::ref(machine), 
+        boost::cref(none));
+    }
+
+    /**
+      * Processes a shard into its private accumulator
+      */
+    void eStepShard(const T_machine& machine, 
+      const blitz::Array<double,2>& data, std::vector<T_accumulator>& partial,
+      const size_t shard, const size_t begin, const size_t end) const
     {
+      resetAccumulator(machine, partial[shard]);
+      // eStepRange() slices a private alias of the shared data
+      eStepRange(machine, bob::core::array::alias(data), partial[shard], 
+          begin, end);
     }
   };
 
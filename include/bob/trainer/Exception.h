@@ -109,6 +109,21 @@ namespace bob { namespace trainer {
       mutable std::string m_message;
   };
 
+  /**
+   * Raised when the L-BFGS optimization of the Linear Logistic Regression
+   * fails.
+   */
+  class LLROptimizationFailure: public Exception {
+    public:
+      LLROptimizationFailure(const int code) throw();
+      virtual ~LLROptimizationFailure() throw();
+      virtual const char* what() const throw();
+
+    private:
+      int m_code;
+      mutable std::string m_message;
+  };
+
   /**
    * Raised when the K-means initialization fails.
    */
@@ -119,6 +134,20 @@ namespace bob { namespace trainer {
       virtual const char* what() const throw();
   };
 
+  /**
+   * Raised when a BlockSampler cannot be set up on the given files, or when
+   * a sample it does not contain is requested.
+   */
+  class BlockSamplerError: public Exception {
+    public:
+      BlockSamplerError(const std::string& reason) throw();
+      virtual ~BlockSamplerError() throw();
+      virtual const char* what() const throw();
+
+    private:
+      std::string m_reason;
+  };
+
 }}
 
 #endif /* BOB_TRAINER_EXCEPTION_H */
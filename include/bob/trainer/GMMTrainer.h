@@ -35,8 +35,10 @@ namespace trainer {
 /**
  * @brief This class implements the E-step of the expectation-maximisation algorithm for a GMM Machine.
  * @details See Section 9.2.2 of Bishop, "Pattern recognition and machine learning", 2006
+ * The E-step is split across setNThreads() threads, each of them 
+ * accumulating the GMMStats of a shard of the samples.
  */
-class GMMTrainer : public EMTrainer<bob::machine::GMMMachine, blitz::Array<double,2> > {
+class GMMTrainer : public ParallelEMTrainer<bob::machine::GMMMachine, bob::machine::GMMStats> {
   public:
 
     /**
@@ -50,22 +52,13 @@ class GMMTrainer : public EMTrainer<bob::machine::GMMMachine, blitz::Array<doubl
      */
     virtual ~GMMTrainer();
 
+    using ParallelEMTrainer<bob::machine::GMMMachine, bob::machine::GMMStats>::initialization;
+
     /**
      * Initialization before the EM steps
      */
     virtual void initialization(bob::machine::GMMMachine& gmm, const blitz::Array<double,2>& data);
     
-    /**
-     * Calculates and saves statistics across the dataset, 
-     * and saves these as m_ss. Calculates the average
-     * log likelihood of the observations given the GMM,
-     * and returns this in average_log_likelihood.
-     * 
-     * The statistics, m_ss, will be used in the mStep() that follows.
-     * Implements EMTrainer::eStep(double &)
-     */
-    virtual void eStep(bob::machine::GMMMachine& gmm, const blitz::Array<double,2>& data);
-
     /**
      * Computes the likelihood using current estimates of the latent variables
      */
@@ -87,6 +80,31 @@ class GMMTrainer : public EMTrainer<bob::machine::GMMMachine, blitz::Array<doubl
      
   protected:
 
+    /**
+     * The statistics of the E-step are accumulated into m_ss
+     */
+    virtual bob::machine::GMMStats& accumulator() { return m_ss; }
+
+    /**
+     * Resizes the given statistics to the GMM, and sets them to zero
+     */
+    virtual void resetAccumulator(const bob::machine::GMMMachine& gmm, 
+      bob::machine::GMMStats& stats) const;
+
+    /**
+     * Adds the statistics of other to stats
+     */
+    virtual void mergeAccumulator(bob::machine::GMMStats& stats, 
+      const bob::machine::GMMStats& other) const;
+
+    /**
+     * Accumulates the statistics of the samples [begin, end), as well as
+     * their log likelihood given the GMM
+     */
+    virtual void eStepRange(const bob::machine::GMMMachine& gmm, 
+      const blitz::Array<double,2>& data, bob::machine::GMMStats& stats,
+      const size_t begin, const size_t end) const;
+
     /**
      * These are the sufficient statistics, calculated during the
      * E-step and used during the M-step
@@ -29,7 +29,10 @@
 #include <string>
 #include "bob/core/array_copy.h"
 #include "bob/machine/JFAMachine.h"
+#include "bob/machine/ModelBank.h"
+#include "bob/trainer/JFATrainingStats.h"
 #include <boost/shared_ptr.hpp>
+#include <utility>
 
 #include "bob/core/logging.h"
 
@@ -113,6 +116,9 @@ void updateEigen(const blitz::Array<double,3> &A, const blitz::Array<double,2> &
     identifies segments spoken by same speakers. 
     The values are indices of rows in y and z matrices containing 
     corresponding speaker factors.
+  @param n_threads The number of threads the speakers are split across.
+    Each speaker is processed by a single thread, such that the result does
+    not depend on the number of threads.
   @warning Rows corresponding to the same speaker SHOULD be consecutive.
 */
 void estimateXandU(const blitz::Array<double,2> &F, const blitz::Array<double,2> &N,
@@ -120,7 +126,7 @@ void estimateXandU(const blitz::Array<double,2> &F, const blitz::Array<double,2>
   const blitz::Array<double,1> &d, const blitz::Array<double,2> &v, 
   const blitz::Array<double,2> &u, const blitz::Array<double,2> &z, 
   const blitz::Array<double,2> &y, blitz::Array<double,2> &x,
-  const blitz::Array<uint32_t,1> &spk_ids);
+  const blitz::Array<uint32_t,1> &spk_ids, const size_t n_threads=1);
 
 
 
@@ -129,14 +135,14 @@ void estimateYandV(const blitz::Array<double,2> &F, const blitz::Array<double,2>
   const blitz::Array<double,1> &d, const blitz::Array<double,2> &v, 
   const blitz::Array<double,2> &u, const blitz::Array<double,2> &z, 
   blitz::Array<double,2> &y, const blitz::Array<double,2> &x,
-  const blitz::Array<uint32_t,1> &spk_ids);
+  const blitz::Array<uint32_t,1> &spk_ids, const size_t n_threads=1);
 
 void estimateZandD(const blitz::Array<double,2> &F, const blitz::Array<double,2> &N,
   const blitz::Array<double,1> &m, const blitz::Array<double,1> &E, 
   const blitz::Array<double,1> &d, const blitz::Array<double,2> &v, 
   const blitz::Array<double,2> &u, blitz::Array<double,2> &z, 
   const blitz::Array<double,2> &y, const blitz::Array<double,2> &x,
-  const blitz::Array<uint32_t,1> &spk_ids);
+  const blitz::Array<uint32_t,1> &spk_ids, const size_t n_threads=1);
 } // close JFA namespace
 
 
@@ -160,17 +166,20 @@ class JFABaseTrainerBase
      * Initializes the number of identities
      */
     void initNid(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats);
+    void initNid(const JFATrainingStats& stats);
     void initNid(const size_t Nid);
     /**
      * Precomputes the sums of the zeroth order statistics over the sessions 
      * for each client
      */
     void precomputeSumStatisticsN(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats);
+    void precomputeSumStatisticsN(const JFATrainingStats& stats);
     /**
      * Precomputes the sums of the first order statistics over the sessions 
      * for each client
      */
     void precomputeSumStatisticsF(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats);
+    void precomputeSumStatisticsF(const JFATrainingStats& stats);
 
     /**
      * Set the x, y, z speaker factors
@@ -194,6 +203,7 @@ class JFABaseTrainerBase
       * Initializes X, Y and Z
       */
     virtual void initializeXYZ(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats);
+    virtual void initializeXYZ(const JFATrainingStats& stats);
 
     /**
      * Get the zeroth order statistics
@@ -239,6 +249,24 @@ class JFABaseTrainerBase
 
 
   protected:
+    /**
+     * Copies the statistics of the persons into a JFATrainingStats. The 
+     * training methods taking vectors of GMMStats convert them once with
+     * this function, and then call the JFATrainingStats version, which 
+     * should be called directly to save the memory and the conversion.
+     */
+    JFATrainingStats toTrainingStats(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats) const;
+
+    /**
+     * Returns the JFATrainingStats of the given persons. The per-iteration
+     * steps taking vectors of GMMStats (e.g. updateY()) always convert them
+     * (refresh), and the per-person and per-session methods reuse the
+     * statistics converted by the last step if they are given the same 
+     * GMMStats (compared by address), such that stepping through the
+     * persons does not copy the whole data set at each call.
+     */
+    const JFATrainingStats& cachedTrainingStats(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats, const bool refresh=false) const;
+
     bob::machine::JFABaseMachine& m_jfa_machine; // JFABaseMachine
     size_t m_Nid; // Number of identities 
 
@@ -253,6 +281,10 @@ class JFABaseTrainerBase
     blitz::Array<double,1> m_cache_ubm_mean;
     blitz::Array<double,1> m_cache_ubm_var;
 
+    // Last persons converted by cachedTrainingStats()
+    mutable std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > > m_cache_gmmstats;
+    mutable boost::shared_ptr<JFATrainingStats> m_cache_training_stats;
+
 
   private:
     /**
@@ -305,6 +337,7 @@ class JFABaseTrainer: public JFABaseTrainerBase
      * which occurs in the y estimation of the given person
      */
     void computeFn_y_i(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats, const size_t id);
+    void computeFn_y_i(const JFATrainingStats& stats, const size_t id);
     /**
      * Updates y_i (of the current person) and the accumulators to compute V 
      * with the cache values m_cache_IdPlusVprod_i, m_VtSigmaInv and 
@@ -315,11 +348,25 @@ class JFABaseTrainer: public JFABaseTrainerBase
      * Updates y and the accumulators to compute V 
      */
     void updateY(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats);
+    void updateY(const JFATrainingStats& stats);
     /**
-     * Updates V by using the accumulators m_cache_A1_x and m_cache_A2_x
+     * Updates V by using the accumulators m_cache_A1_y and m_cache_A2_y
      * V = A2 * A1^-1
+     * This is equivalent to accumulateV() followed by updateVFromAccumulators()
      */
     void updateV(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats);
+    void updateV(const JFATrainingStats& stats);
+    /**
+     * Computes the accumulators m_cache_A1_y and m_cache_A2_y of the given
+     * persons, using their current y
+     */
+    void accumulateV(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats);
+    void accumulateV(const JFATrainingStats& stats);
+    /**
+     * Updates V from the accumulators m_cache_A1_y and m_cache_A2_y, which
+     * may have been summed over several sets of persons
+     */
+    void updateVFromAccumulators();
 
 
     /**** X and U functions ****/
@@ -336,11 +383,13 @@ class JFABaseTrainer: public JFABaseTrainerBase
      * for the given person
      */
     void computeIdPlusUProd_ih(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats, const size_t id, const size_t h);
+    void computeIdPlusUProd_ih(const JFATrainingStats& stats, const size_t id, const size_t h);
     /**
      * Computes sum_{sessions h}(N_{i,h}*(o_{i,h} - m - D*z_{i} - U*x_{i,h}) 
      * which occurs in the y estimation of the given person
      */
     void computeFn_x_ih(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats, const size_t id, const size_t h);
+    void computeFn_x_ih(const JFATrainingStats& stats, const size_t id, const size_t h);
     /**
      * Updates x_ih (of the current person/session) and the accumulators to compute V 
      * with the cache values m_cache_IdPlusVprod_i, m_VtSigmaInv and 
@@ -351,11 +400,25 @@ class JFABaseTrainer: public JFABaseTrainerBase
      * Updates x and the accumulators to compute U
      */
     void updateX(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats);
+    void updateX(const JFATrainingStats& stats);
     /**
-     * Updates U by using the accumulators m_cache_A1_y and m_cache_A2_y
+     * Updates U by using the accumulators m_cache_A1_x and m_cache_A2_x
      * U = A2 * A1^-1
+     * This is equivalent to accumulateU() followed by updateUFromAccumulators()
      */
     void updateU(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats);
+    void updateU(const JFATrainingStats& stats);
+    /**
+     * Computes the accumulators m_cache_A1_x and m_cache_A2_x of the given
+     * persons, using their current x and z
+     */
+    void accumulateU(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats);
+    void accumulateU(const JFATrainingStats& stats);
+    /**
+     * Updates U from the accumulators m_cache_A1_x and m_cache_A2_x, which
+     * may have been summed over several sets of persons
+     */
+    void updateUFromAccumulators();
 
 
     /**** z and D functions ****/
@@ -377,6 +440,7 @@ class JFABaseTrainer: public JFABaseTrainerBase
      * which occurs in the y estimation of the given person
      */
     void computeFn_z_i(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats, const size_t id);
+    void computeFn_z_i(const JFATrainingStats& stats, const size_t id);
     /**
      * Updates z_i (of the current person) and the accumulators to compute D
      * with the cache values m_cache_IdPlusDProd_i, m_VtSigmaInv and 
@@ -387,73 +451,208 @@ class JFABaseTrainer: public JFABaseTrainerBase
      * Updates z and the accumulators to compute D
      */
     void updateZ(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats);
+    void updateZ(const JFATrainingStats& stats);
     /**
      * Updates D by using the accumulators m_cache_A1_z and m_cache_A2_z
      * V = A2 * A1^-1
+     * This is equivalent to accumulateD() followed by updateDFromAccumulators()
      */
     void updateD(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats);
+    void updateD(const JFATrainingStats& stats);
+    /**
+     * Computes the accumulators m_cache_A1_z and m_cache_A2_z of the given
+     * persons, using their current z
+     */
+    void accumulateD(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats);
+    void accumulateD(const JFATrainingStats& stats);
+    /**
+     * Updates D from the accumulators m_cache_A1_z and m_cache_A2_z, which
+     * may have been summed over several sets of persons
+     */
+    void updateDFromAccumulators();
+
+    /**
+     * Gets/Sets the accumulators of the U, V and D updates. They are summed
+     * over the persons, such that the accumulators of several disjoint sets
+     * of persons (e.g. processed by different processes) can be merged by
+     * addition before calling update*FromAccumulators().
+     */
+    const blitz::Array<double,3>& getAccUA1() const { return m_cache_A1_x; }
+    const blitz::Array<double,2>& getAccUA2() const { return m_cache_A2_x; }
+    const blitz::Array<double,3>& getAccVA1() const { return m_cache_A1_y; }
+    const blitz::Array<double,2>& getAccVA2() const { return m_cache_A2_y; }
+    const blitz::Array<double,1>& getAccDA1() const { return m_cache_A1_z; }
+    const blitz::Array<double,1>& getAccDA2() const { return m_cache_A2_z; }
+    void setAccUA1(const blitz::Array<double,3>& acc);
+    void setAccUA2(const blitz::Array<double,2>& acc);
+    void setAccVA1(const blitz::Array<double,3>& acc);
+    void setAccVA2(const blitz::Array<double,2>& acc);
+    void setAccDA1(const blitz::Array<double,1>& acc);
+    void setAccDA2(const blitz::Array<double,1>& acc);
 
 
 
 
+    /**
+     * Sets the number of threads the persons (and sessions) are split 
+     * across, when estimating the speaker factors and computing the 
+     * accumulators. The speaker factors do not depend on the number of 
+     * threads. The accumulators are summed in the order of the threads, and
+     * are hence identical for a given number of threads.
+     */
+    void setNThreads(const size_t n_threads);
+    /**
+     * Gets the number of threads the persons (and sessions) are split across
+     */
+    size_t getNThreads() const { return m_n_threads; }
+
     /**
       * Trains the Joint Factor Analysis by initializing U, V, and D randomly
       */
     void train(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats,
       const size_t n_iter); 
+    void train(const JFATrainingStats& stats,
+      const size_t n_iter); 
     /**
       * Trains the Joint Factor Analysis without initializing U, V and D
       */
     void trainNoInit(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats,
       const size_t n_iter); 
+    void trainNoInit(const JFATrainingStats& stats,
+      const size_t n_iter); 
 
     /**
       * Trains the Inter Session Variability model by initializing U randomly
       */
     void trainISV(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats,
       const size_t n_iter, const double relevance_factor); 
+    void trainISV(const JFATrainingStats& stats,
+      const size_t n_iter, const double relevance_factor); 
     /**
       * Trains the Inter Session Variability model without initializing U
       */
     void trainISVNoInit(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats,
       const size_t n_iter, const double relevance_factor); 
+    void trainISVNoInit(const JFATrainingStats& stats,
+      const size_t n_iter, const double relevance_factor); 
 
     /**
       * Initializes V=zero and D=srqt(var_UBM / rel_factor) for ISV
       */
     void initializeVD_ISV(const double relevance_factor);
 
+    /**
+      * Enrols several clients at once, as JFATrainer::enrol() would do for 
+      * each of them: their speaker factors y and z are estimated with 
+      * n_iter iterations, and are then available with getY() and getZ().
+      * All the clients are processed together, such that the terms which 
+      * only depend on U, V and D are computed once, and are split across 
+      * the threads.
+      */
+    void enrol(const JFATrainingStats& stats, const size_t n_iter);
+    /**
+      * Enrols several clients at once as above, and sets the speaker 
+      * factors of the given JFAMachines (one per client)
+      */
+    void enrol(const JFATrainingStats& stats, 
+      const std::vector<boost::shared_ptr<bob::machine::JFAMachine> >& models,
+      const size_t n_iter);
+    /**
+      * Enrols several clients at once as above, and writes their speaker 
+      * factors into the "y" and "z" fields of the bank, with the given 
+      * identifiers
+      */
+    void enrol(const JFATrainingStats& stats, const blitz::Array<int64_t,1>& ids,
+      bob::machine::ModelBank& bank, const size_t n_iter);
+
   private:
+    /**
+     * Buffers of the computations of a single person (or session), such that
+     * several persons can be processed at the same time by different 
+     * threads. The A1_* and A2_* arrays are the partial accumulators of the
+     * persons processed by the thread.
+     */
+    struct PersonCache {
+      blitz::Array<double,2> IdPlusVProd_i;
+      blitz::Array<double,1> Fn_y_i;
+      blitz::Array<double,2> IdPlusUProd_ih;
+      blitz::Array<double,1> Fn_x_ih;
+      blitz::Array<double,1> IdPlusDProd_i;
+      blitz::Array<double,1> Fn_z_i;
+      blitz::Array<double,3> A1_y;
+      blitz::Array<double,2> A2_y;
+      blitz::Array<double,3> A1_x;
+      blitz::Array<double,2> A2_x;
+      blitz::Array<double,1> A1_z;
+      blitz::Array<double,1> A2_z;
+
+      blitz::Array<double,2> tmp_rvrv;
+      blitz::Array<double,2> tmp_ruru;
+      blitz::Array<double,1> tmp_rv;
+      blitz::Array<double,1> tmp_ru;
+      blitz::Array<double,1> tmp_CD;
+      blitz::Array<double,1> tmp_CD_b;
+    };
+
+    /**
+     * Allocates the buffers of max(1, getNThreads()) threads
+     */
+    void initPersonCaches();
+
+    /**
+     * Per-person computations using the buffers of the given thread
+     */
+    void computeIdPlusVProd_i(const size_t id, PersonCache& cache) const;
+    void computeFn_y_i(const JFATrainingStats& stats, const size_t id, PersonCache& cache) const;
+    void updateY_i(const size_t id, PersonCache& cache);
+    void computeIdPlusUProd_ih(const JFATrainingStats& stats, const size_t id, const size_t h, PersonCache& cache) const;
+    void computeFn_x_ih(const JFATrainingStats& stats, const size_t id, const size_t h, PersonCache& cache) const;
+    void updateX_ih(blitz::Array<double,1>& x, PersonCache& cache);
+    void computeIdPlusDProd_i(const size_t id, PersonCache& cache) const;
+    void computeFn_z_i(const JFATrainingStats& stats, const size_t id, PersonCache& cache) const;
+    void updateZ_i(const size_t id, PersonCache& cache);
+
+    /**
+     * Processes the persons (or sessions) [begin, end) with the buffers of
+     * the k-th thread. The sessions of a person may be processed by several
+     * threads, hence, the views x_ih on the factors x_{i,h} of each session
+     * are created beforehand by the calling thread.
+     */
+    void updateYRange(const JFATrainingStats& stats, size_t k, size_t begin, size_t end);
+    void accumulateVRange(const JFATrainingStats& stats, size_t k, size_t begin, size_t end);
+    void updateXRange(const JFATrainingStats& stats, const std::vector<std::pair<size_t,size_t> >& sessions, std::vector<blitz::Array<double,1> >& x_ih, size_t k, size_t begin, size_t end);
+    void accumulateURange(const JFATrainingStats& stats, const std::vector<std::pair<size_t,size_t> >& sessions, const std::vector<blitz::Array<double,1> >& x_ih, size_t k, size_t begin, size_t end);
+    void updateZRange(const JFATrainingStats& stats, size_t k, size_t begin, size_t end);
+    void accumulateDRange(const JFATrainingStats& stats, size_t k, size_t begin, size_t end);
+    /**
+     * Updates the Gaussians [begin, end) of V (resp. U) from the 
+     * accumulators, with the buffers of the k-th thread
+     */
+    void updateVRange(blitz::Array<double,2>& V, size_t k, size_t begin, size_t end);
+    void updateURange(blitz::Array<double,2>& U, size_t k, size_t begin, size_t end);
+
+    size_t m_n_threads;
+
     // Cache/Precomputation
     blitz::Array<double,2> m_cache_VtSigmaInv; // Vt * diag(sigma)^-1
     blitz::Array<double,3> m_cache_VProd; // first dimension is the Gaussian id
-    blitz::Array<double,2> m_cache_IdPlusVProd_i;
-    blitz::Array<double,1> m_cache_Fn_y_i;
     blitz::Array<double,3> m_cache_A1_y;
     blitz::Array<double,2> m_cache_A2_y;
 
     blitz::Array<double,2> m_cache_UtSigmaInv; // Ut * diag(sigma)^-1
     blitz::Array<double,3> m_cache_UProd; // first dimension is the Gaussian id
-    blitz::Array<double,2> m_cache_IdPlusUProd_ih;
-    blitz::Array<double,1> m_cache_Fn_x_ih;
     blitz::Array<double,3> m_cache_A1_x;
     blitz::Array<double,2> m_cache_A2_x;
 
     blitz::Array<double,1> m_cache_DtSigmaInv; // Dt * diag(sigma)^-1
     blitz::Array<double,1> m_cache_DProd; // supervector length dimension
-    blitz::Array<double,1> m_cache_IdPlusDProd_i;
-    blitz::Array<double,1> m_cache_Fn_z_i;
     blitz::Array<double,1> m_cache_A1_z;
     blitz::Array<double,1> m_cache_A2_z;
 
-    mutable blitz::Array<double,2> m_tmp_rvrv;
+    std::vector<PersonCache> m_person_cache; // one per thread
+
     mutable blitz::Array<double,2> m_tmp_rvD;
-    mutable blitz::Array<double,2> m_tmp_ruru;
     mutable blitz::Array<double,2> m_tmp_ruD;
-    mutable blitz::Array<double,1> m_tmp_rv;
-    mutable blitz::Array<double,1> m_tmp_ru;
-    mutable blitz::Array<double,1> m_tmp_CD;
-    mutable blitz::Array<double,1> m_tmp_CD_b;
 };
 
 
@@ -0,0 +1,175 @@
+/**
+ * @file bob/trainer/JFATrainingStats.h
+ * @date Mon Oct 19 22:41:05 2026 +0200
+ *
+ * @brief Compact storage of the zeroth and first order statistics used to
+ * train JFA and ISV models
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOB_TRAINER_JFATRAININGSTATS_H
+#define BOB_TRAINER_JFATRAININGSTATS_H
+
+#include <vector>
+#include <string>
+#include <blitz/array.h>
+#include <boost/shared_ptr.hpp>
+#include "bob/machine/GMMStats.h"
+
+namespace bob { namespace trainer {
+
+  /**
+   * The statistics of the sessions of several persons, as used to train a
+   * JFABaseMachine. The statistics of all the sessions are stored
+   * contiguously, the sessions of each person being consecutive: N is a
+   * (sessions x C) matrix and F a (sessions x CD) matrix, and the sessions
+   * of the i-th person are the rows [getOffsets()[i], getOffsets()[i+1]).
+   *
+   * Compared to a set of GMMStats, the second order statistics (which are
+   * not used by the JFA and ISV trainers) are not kept, and F may be stored
+   * in single precision. The computations are still carried out in double
+   * precision.
+   */
+  class JFATrainingStats {
+
+    public:
+
+      /**
+       * Creates an empty set of statistics of GMMs with n_gaussians
+       * Gaussians of dimensionality n_inputs. If use_float is set, F is
+       * stored in single precision.
+       */
+      JFATrainingStats(const size_t n_gaussians, const size_t n_inputs,
+          const bool use_float=false);
+
+      /**
+       * Reserves the memory of n_sessions sessions (in total), such that
+       * the storage is not reallocated when persons are added
+       */
+      void reserve(const size_t n_sessions);
+
+      /**
+       * Removes all the persons
+       */
+      void clear();
+
+      /**
+       * Adds a person, given the statistics of its sessions
+       */
+      void addPerson(const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& sessions);
+
+      /**
+       * Adds a person, given the HDF5 files of the GMMStats of its sessions.
+       * Only N and F are read from the files.
+       */
+      void addPerson(const std::vector<std::string>& filenames);
+
+      /**
+       * Adds several persons, given the HDF5 files of the GMMStats of their
+       * sessions, in a single pass over the files. The storage is reserved
+       * beforehand.
+       */
+      void load(const std::vector<std::vector<std::string> >& filenames);
+
+      /**
+       * Number of Gaussians (C)
+       */
+      inline size_t getNGaussians() const { return m_n_gaussians; }
+
+      /**
+       * Dimensionality of the Gaussians (D)
+       */
+      inline size_t getNInputs() const { return m_n_inputs; }
+
+      /**
+       * Tells if F is stored in single precision
+       */
+      inline bool useFloat() const { return m_use_float; }
+
+      /**
+       * Number of persons
+       */
+      inline size_t getNPersons() const { return m_offsets.size() - 1; }
+
+      /**
+       * Total number of sessions
+       */
+      inline size_t getNSessions() const { return m_offsets.back(); }
+
+      /**
+       * Number of sessions of the given person
+       */
+      inline size_t getNSessions(const size_t person) const
+      { return m_offsets[person+1] - m_offsets[person]; }
+
+      /**
+       * Index of the first session of each person, followed by the total
+       * number of sessions
+       */
+      inline const std::vector<size_t>& getOffsets() const
+      { return m_offsets; }
+
+      /**
+       * The zeroth order statistics of all the sessions (sessions x C).
+       * The returned array refers to the storage, and is invalidated when
+       * persons are added.
+       */
+      const blitz::Array<double,2> getN() const;
+
+      /**
+       * The zeroth order statistics of a session (C). The returned array
+       * refers to the storage, and is invalidated when persons are added.
+       */
+      const blitz::Array<double,1> getN(const size_t session) const;
+
+      /**
+       * Copies the first order statistics of all the sessions
+       * (sessions x CD)
+       */
+      blitz::Array<double,2> getF() const;
+
+      /**
+       * Copies the first order statistics of a session (CD) into F
+       */
+      void getF(const size_t session, blitz::Array<double,1>& F) const;
+
+      /**
+       * Sums the zeroth (resp. first) order statistics of the sessions of a
+       * person
+       */
+      void sumN(const size_t person, blitz::Array<double,1>& N) const;
+      void sumF(const size_t person, blitz::Array<double,1>& F) const;
+
+    private:
+
+      /**
+       * Appends a session, and returns its index
+       */
+      size_t addSession();
+
+      size_t m_n_gaussians;
+      size_t m_n_inputs;
+      bool m_use_float;
+      std::vector<size_t> m_offsets; ///< first session of each person
+      std::vector<double> m_n; ///< sessions x C
+      std::vector<double> m_f; ///< sessions x CD (double precision)
+      std::vector<float> m_f_float; ///< sessions x CD (single precision)
+
+  };
+
+}}
+
+#endif /* BOB_TRAINER_JFATRAININGSTATS_H */
@@ -23,17 +23,45 @@
 
 #include "bob/machine/KMeansMachine.h"
 #include "bob/trainer/EMTrainer.h"
+#include <boost/function.hpp>
 
 namespace bob {
 namespace trainer {
 
+/**
+ * The statistics accumulated by the E-step of the KMeansTrainer, over a 
+ * set of samples
+ */
+struct KMeansAccumulator
+{
+  /**
+   * Zeroeth order statistics.
+   * The k'th value is the denominator of equation 9.4, 
+   * Bishop, "Pattern recognition and machine learning", 2006
+   */
+  blitz::Array<double,1> zeroethOrderStats;
+
+  /** 
+   * First order statistics.
+   * The k'th row is the numerator of equation 9.4, 
+   * Bishop, "Pattern recognition and machine learning", 2006
+   */
+  blitz::Array<double,2> firstOrderStats;
+
+  /**
+   * Sum of the distances of the samples to their closest mean
+   */
+  double sumMinDistance;
+};
+
 /**
  * Trains a KMeans machine.
  * @brief This class implements the expectation-maximisation algorithm for a k-means machine.
  * @details See Section 9.1 of Bishop, "Pattern recognition and machine learning", 2006
- *          It uses a random initialisation of the means followed by the expectation-maximization algorithm
+ *          It uses a random initialisation of the means followed by the expectation-maximization algorithm.
+ *          The E-step is split across setNThreads() threads.
  */
-class KMeansTrainer: public EMTrainer<bob::machine::KMeansMachine, blitz::Array<double,2> >
+class KMeansTrainer: public ParallelEMTrainer<bob::machine::KMeansMachine, KMeansAccumulator>
 {
   public: 
     /**
@@ -75,15 +103,13 @@ class KMeansTrainer: public EMTrainer<bob::machine::KMeansMachine, blitz::Array<
      */
     virtual void initialization(bob::machine::KMeansMachine& kMeansMachine,
       const blitz::Array<double,2>& sampler);
-    
+
     /**
-     * Accumulate across the dataset:
-     * - zeroeth and first order statistics
-     * - average distance from the closest mean 
-     * Implements EMTrainer::eStep(double &)
+     * Same as above, for samples streamed by a sampler (the selected 
+     * samples are read with random accesses)
      */
-    virtual void eStep(bob::machine::KMeansMachine& kmeans,
-      const blitz::Array<double,2>& data);
+    virtual void initialization(bob::machine::KMeansMachine& kMeansMachine,
+      BlockSampler& sampler);
     
     /**
      * Updates the mean based on the statistics from the E-step.
@@ -131,8 +157,8 @@ class KMeansTrainer: public EMTrainer<bob::machine::KMeansMachine, blitz::Array<
     /**
      * Returns the internal statistics. Useful to parallelize the E-step
      */
-    const blitz::Array<double,1>& getZeroethOrderStats() const { return m_zeroethOrderStats; }
-    const blitz::Array<double,2>& getFirstOrderStats() const { return m_firstOrderStats; }
+    const blitz::Array<double,1>& getZeroethOrderStats() const { return m_acc.zeroethOrderStats; }
+    const blitz::Array<double,2>& getFirstOrderStats() const { return m_acc.firstOrderStats; }
     double getAverageMinDistance() const { return m_average_min_distance; }
     /**
      * Sets the internal statistics. Useful to parallelize the E-step
@@ -160,18 +186,48 @@ class KMeansTrainer: public EMTrainer<bob::machine::KMeansMachine, blitz::Array<
     double m_average_min_distance;
 
     /**
-     * Zeroeth order statistics accumulator.
-     * The k'th value in m_zeroethOrderStats is the denominator of 
-     * equation 9.4, Bishop, "Pattern recognition and machine learning", 2006
+     * Statistics accumulated during the E-step
+     */
+    KMeansAccumulator m_acc;
+
+    /**
+     * Initialise the means with random samples, read by get_sample(index, x)
+     */
+    void initializeMeans(bob::machine::KMeansMachine& kmeans, 
+      const size_t n_data, 
+      const boost::function<void (size_t, blitz::Array<double,1>&)>& get_sample);
+
+    /**
+     * The statistics of the E-step are accumulated into m_acc
      */
-    blitz::Array<double,1> m_zeroethOrderStats;
+    virtual KMeansAccumulator& accumulator() { return m_acc; }
 
-    /** 
-     * First order statistics accumulator.
-     * The k'th row of m_firstOrderStats is the numerator of 
-     * equation 9.4, Bishop, "Pattern recognition and machine learning", 2006
+    /**
+     * Resizes the given statistics to the machine, and sets them to zero
+     */
+    virtual void resetAccumulator(const bob::machine::KMeansMachine& kmeans, 
+      KMeansAccumulator& acc) const;
+
+    /**
+     * Adds the statistics of other to acc
+     */
+    virtual void mergeAccumulator(KMeansAccumulator& acc, 
+      const KMeansAccumulator& other) const;
+
+    /**
+     * Accumulates across the samples [begin, end):
+     * - zeroeth and first order statistics
+     * - distance from the closest mean 
+     */
+    virtual void eStepRange(const bob::machine::KMeansMachine& kmeans, 
+      const blitz::Array<double,2>& data, KMeansAccumulator& acc,
+      const size_t begin, const size_t end) const;
+
+    /**
+     * Computes the average distance from the closest mean
      */
-    blitz::Array<double,2> m_firstOrderStats;
+    virtual void eStepMerged(bob::machine::KMeansMachine& kmeans, 
+      const size_t n_samples);
 };
 
 }
@@ -26,6 +26,7 @@
 
 #include "bob/machine/LinearMachine.h"
 #include "bob/trainer/Exception.h"
+#include "bob/trainer/BlockSampler.h"
 
 namespace bob { namespace trainer {
   
@@ -40,6 +41,14 @@ namespace bob { namespace trainer {
     *   T. Minka, Unpublished draft, 2003 (revision in 2007), 
     *   http://research.microsoft.com/en-us/um/people/minka/papers/logreg/
     *   2/ FoCal, http://www.dsp.sun.ac.za/~nbrummer/focal/
+    *
+    * The samples of the two classes are never copied: the likelihood and 
+    * its gradient are accumulated over blocks of samples, each of them 
+    * being split across getNThreads() threads. The samples may also be 
+    * streamed by two BlockSamplers, in which case two passes over the 
+    * samples are made per conjugate gradient iteration. Alternatively, the
+    * L-BFGS optimizer of bob::lbfgs may be used (one pass per evaluation of
+    * the likelihood and of its gradient).
     */
   class LLRTrainer 
   {
@@ -87,6 +96,8 @@ namespace bob { namespace trainer {
       double getPrior() const { return m_prior; }
       double getConvergenceThreshold() const { return m_convergence_threshold; }
       size_t getMaxIterations() const { return m_max_iterations; }
+      size_t getNThreads() const { return m_n_threads; }
+      bool getUseLBFGS() const { return m_use_lbfgs; }
 
       /**
         * Setters
@@ -98,6 +109,19 @@ namespace bob { namespace trainer {
       { m_convergence_threshold = convergence_threshold; }
       void setMaxIterations(const size_t max_iterations) 
       { m_max_iterations = max_iterations; }
+      /**
+        * Sets the number of threads each block of samples is split across
+        */
+      void setNThreads(const size_t n_threads)
+      { m_n_threads = n_threads; }
+      /**
+        * Uses the L-BFGS optimizer instead of the conjugate gradient one. 
+        * The optimization then stops when the norm of the gradient of the
+        * (normalized) negative log-likelihood is below 
+        * convergence_threshold * max(1, norm(w)).
+        */
+      void setUseLBFGS(const bool use_lbfgs)
+      { m_use_lbfgs = use_lbfgs; }
 
       /**
        * Trains the LinearMachine to perform Linear Logistic Regression
@@ -105,11 +129,20 @@ namespace bob { namespace trainer {
       virtual void train(bob::machine::LinearMachine& machine, 
           const blitz::Array<double,2>& data1, const blitz::Array<double,2>& data2) const;
 
+      /**
+       * Trains the LinearMachine to perform Linear Logistic Regression, 
+       * with the samples of the two classes streamed by two samplers
+       */
+      virtual void train(bob::machine::LinearMachine& machine, 
+          BlockSampler& sampler1, BlockSampler& sampler2) const;
+
     private: 
       // Attributes
       double m_prior;
       double m_convergence_threshold;
       size_t m_max_iterations;
+      size_t m_n_threads;
+      bool m_use_lbfgs;
   };
 
 }}
@@ -26,7 +26,10 @@
 
 #include "GMMTrainer.h"
 #include <limits>
+#include <vector>
+#include <stdint.h>
 #include "bob/core/Exception.h"
+#include "bob/machine/ModelBank.h"
 
 namespace bob {
 namespace trainer {
@@ -49,6 +52,8 @@ class MAP_GMMTrainer : public GMMTrainer {
      */
     virtual ~MAP_GMMTrainer();
 
+    using GMMTrainer::initialization;
+
     /**
      * Initialization
      */
@@ -76,6 +81,27 @@ class MAP_GMMTrainer : public GMMTrainer {
      */
     void setT3MAP(const double alpha) { m_T3_adaptation = true; m_T3_alpha = alpha; }
     void unsetT3MAP() { m_T3_adaptation = false; }
+
+    /**
+     * Enrols several clients at once, given their statistics computed with
+     * the prior GMM: each model is set to the prior GMM, and then adapted 
+     * with a single MAP update, as mStep() would do. The clients are split
+     * across n_threads threads. The models should have the dimensions of 
+     * the prior GMM.
+     */
+    void enrol(const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& stats,
+      const std::vector<boost::shared_ptr<bob::machine::GMMMachine> >& models,
+      const size_t n_threads=1) const;
+
+    /**
+     * Enrols several clients at once as above, the mean supervectors of the
+     * adapted models being written in the "mean" field of the bank, with the
+     * given identifiers. As a bank only stores the means, neither the
+     * weights nor the variances should be updated.
+     */
+    void enrol(const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& stats,
+      const blitz::Array<int64_t,1>& ids, bob::machine::ModelBank& bank,
+      const size_t n_threads=1) const;
     
   protected:
 
@@ -101,6 +127,28 @@ class MAP_GMMTrainer : public GMMTrainer {
     bool m_T3_adaptation;
 
   private:
+    /**
+     * Sets the weights, means and variances of gmm to the ones of the prior
+     */
+    void initializeFromPrior(bob::machine::GMMMachine& gmm) const;
+
+    /**
+     * Performs the MAP update of gmm from the statistics ss, using the given
+     * buffers (of length the number of Gaussians)
+     */
+    void adapt(const bob::machine::GMMStats& ss, bob::machine::GMMMachine& gmm,
+      blitz::Array<double,1>& alpha, blitz::Array<double,1>& ml_weights) const;
+
+    /**
+     * Enrols the clients [begin, end) into the models (resp. into the rows 
+     * of means)
+     */
+    void enrolRange(const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& stats,
+      const std::vector<boost::shared_ptr<bob::machine::GMMMachine> >& models,
+      size_t begin, size_t end) const;
+    void enrolMeansRange(const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& stats,
+      blitz::Array<double,2>& means, size_t begin, size_t end) const;
+
     /// cache to avoid re-allocation
     mutable blitz::Array<double,1> m_cache_alpha;
     mutable blitz::Array<double,1> m_cache_ml_weights;
@@ -46,6 +46,8 @@ class ML_GMMTrainer : public GMMTrainer {
      */
     virtual ~ML_GMMTrainer();
 
+    using GMMTrainer::initialization;
+
     /**
      * Initialisation before the EM steps
      */
@@ -27,8 +27,11 @@
 #include <blitz/array.h>
 #include <map>
 #include <vector>
+#include <stdint.h>
+#include <boost/shared_ptr.hpp>
 #include "bob/trainer/EMTrainer.h"
 #include "bob/machine/PLDAMachine.h"
+#include "bob/machine/ModelBank.h"
 
 namespace bob { namespace trainer {
   
@@ -166,6 +169,20 @@ namespace bob { namespace trainer {
         */
       inline bool getLimitedMemory() const { return m_limited_memory; }
 
+      /**
+        * Sets the number of threads the identities are split across, in the
+        * E-step and in the updates of F, G and sigma. The latent variables 
+        * do not depend on the number of threads. The partial sums of the 
+        * threads are added in the order of the threads, and are hence 
+        * identical for a given number of threads.
+        */
+      inline void setNThreads(const size_t n_threads) 
+      { m_n_threads = n_threads; }
+      /**
+        * Gets the number of threads the identities are split across
+        */
+      inline size_t getNThreads() const { return m_n_threads; }
+
 
       /**
         * Gets the z first order statistics (mostly for test purposes)
@@ -193,6 +210,7 @@ namespace bob { namespace trainer {
       double m_initG_ratio;
       int m_initSigma_method;
       double m_initSigma_ratio;
+      size_t m_n_threads;
 
       // Precomputed
 
@@ -219,6 +237,25 @@ namespace bob { namespace trainer {
       mutable blitz::Array<double,2> m_cache_D_nfng_1; // D=nb features, nfng=nf+ng
       mutable blitz::Array<double,2> m_cache_D_nfng_2; // D=nb features, nfng=nf+ng
 
+      /**
+        * Buffers of the computations of a single identity, such that several
+        * identities can be processed at the same time by different threads.
+        * sum_z_second_order, sum_xz and sum_sigma are the partial sums of the
+        * identities processed by the thread.
+        */
+      struct IdentityCache {
+        blitz::Array<double,1> nf_1;
+        blitz::Array<double,1> nf_2;
+        blitz::Array<double,1> ng_1;
+        blitz::Array<double,1> ng_2;
+        blitz::Array<double,1> D_1;
+        blitz::Array<double,1> D_2;
+        blitz::Array<double,2> sum_z_second_order; // sum_ij E{z_ij.z_ij^T}
+        blitz::Array<double,2> sum_xz; // sum_ij (x_ij-mu).E{z_ij}^T
+        blitz::Array<double,1> sum_sigma; // numerator of the sigma update
+      };
+      std::vector<IdentityCache> m_identity_cache; // one per thread
+
       // internal methods
       void computeMeanVariance(bob::machine::PLDABaseMachine& machine,
         const std::vector<blitz::Array<double,2> >& v_ar);
@@ -232,6 +269,7 @@ namespace bob { namespace trainer {
       void initSigma(bob::machine::PLDABaseMachine& machine, 
         const std::vector<blitz::Array<double,2> >& v_ar);
       void initRandomFGSigma(bob::machine::PLDABaseMachine& machine);
+      void initIdentityCaches(const size_t n_features);
 
       void checkTrainingData(const std::vector<blitz::Array<double,2> >& v_ar);
       void precomputeFromFGSigma(bob::machine::PLDABaseMachine& machine);
@@ -242,6 +280,21 @@ namespace bob { namespace trainer {
         const std::vector<blitz::Array<double,2> >& v_ar);
       void updateSigma(bob::machine::PLDABaseMachine& machine,
         const std::vector<blitz::Array<double,2> >& v_ar);
+
+      /**
+        * Computations of the identities [begin, end), using the buffers of 
+        * the k-th thread. The per sample count matrices (gamma_a, zeta_a and
+        * iota_a) should have been precomputed.
+        */
+      void eStepRange(const bob::machine::PLDABaseMachine& machine,
+        const std::vector<blitz::Array<double,2> >& v_ar, size_t k, 
+        size_t begin, size_t end);
+      void updateFGRange(const bob::machine::PLDABaseMachine& machine,
+        const std::vector<blitz::Array<double,2> >& v_ar, size_t k, 
+        size_t begin, size_t end);
+      void updateSigmaRange(const bob::machine::PLDABaseMachine& machine,
+        const std::vector<blitz::Array<double,2> >& v_ar, size_t k, 
+        size_t begin, size_t end);
   };
 
 
@@ -284,6 +337,33 @@ namespace bob { namespace trainer {
       mutable blitz::Array<double,1> m_cache_nf_1; // nf 
   };
 
+  namespace plda {
+
+    /**
+      * Enrols several clients at once, given their samples (one array per
+      * client, with one sample per row), as PLDATrainer::enrol() would do 
+      * for each of them. gamma_a and the log likelihood constant terms of 
+      * all the required numbers of samples are first added to the base 
+      * machine, such that the clients can then be split across n_threads 
+      * threads. The enrolment data is written into the given PLDAMachines 
+      * (one per client), which should be attached to base.
+      */
+    void enrol(bob::machine::PLDABaseMachine& base,
+      const std::vector<blitz::Array<double,2> >& clients,
+      const std::vector<boost::shared_ptr<bob::machine::PLDAMachine> >& models,
+      const size_t n_threads=1);
+
+    /**
+      * Enrols several clients at once as above, the enrolment data being
+      * written into the bank, with the given identifiers
+      */
+    void enrol(bob::machine::PLDABaseMachine& base,
+      const std::vector<blitz::Array<double,2> >& clients,
+      const blitz::Array<int64_t,1>& ids, bob::machine::ModelBank& bank,
+      const size_t n_threads=1);
+
+  }
+
 }}
 
 #endif /* BOB5SPRO_TRAINER_PLDA_TRAINER_H */
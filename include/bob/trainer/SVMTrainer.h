@@ -37,6 +37,11 @@ namespace bob { namespace trainer {
    * * Different weights for every label (-wi option in svm-train)
    *
    * Fell free to implement those and remove these remarks.
+   *
+   * Multi-class (C or nu) classification problems may be trained with 
+   * several threads: the k(k-1)/2 one-vs-one binary sub-problems, which 
+   * libsvm solves one after the other, are then split across the threads,
+   * and the resulting machine is identical to the one trained by libsvm.
    */
   class SVMTrainer {
 
@@ -127,9 +132,20 @@ namespace bob { namespace trainer {
       void setProbabilityEstimates(bool v) 
       { m_param.probability = v; }
 
+      /**
+       * Number of threads the one-vs-one sub-problems of a multi-class
+       * problem are split across. The kernel cache (getCacheSizeInMB()) is
+       * shared by the threads. Probability estimates, which rely on the
+       * (non re-entrant) random generator of the C library, are always
+       * trained with a single thread.
+       */
+      size_t getNThreads() const { return m_n_threads; }
+      void setNThreads(size_t v) { m_n_threads = v; }
+
     private: //representation
 
       svm_parameter m_param; ///< training parametrization for libsvm
+      size_t m_n_threads; ///< threads for the one-vs-one sub-problems
       
   };
 
@@ -0,0 +1,138 @@
+#!/usr/bin/env python
+# vim: set fileencoding=utf-8 :
+# Mon Oct 19 18:12:47 2026 +0200
+#
+# Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3 of the License.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Tests on the GalleryIndex
+"""
+
+import os, sys
+import unittest
+import tempfile
+import bob
+import numpy
+
+def normalize(x):
+  return x / numpy.sqrt((x**2).sum(axis=-1))[..., numpy.newaxis]
+
+def reference_search(models, ids, probes, k):
+  """Brute force search: scores all the models and sorts them"""
+  scores = numpy.dot(normalize(probes), normalize(models).T)
+  res_ids = []
+  res_scores = []
+  for s in scores:
+    order = sorted(range(len(ids)), key=lambda i: (-s[i], ids[i]))[:k]
+    res_ids.append(ids[order])
+    res_scores.append(s[order])
+  return numpy.array(res_ids), numpy.array(res_scores)
+
+class GalleryIndexTest(unittest.TestCase):
+  """Performs various GalleryIndex tests."""
+
+  def test01_search(self):
+    numpy.random.seed(5)
+    n_models = 3000; dim = 20; k = 7
+    models = numpy.random.randn(n_models, dim)
+    ids = numpy.array(range(n_models), 'int64') * 3 + 1
+    probes = numpy.random.randn(100, dim)
+
+    g = bob.machine.GalleryIndex(dim)
+    g.add(ids, models)
+    self.assertEqual(len(g), n_models)
+    self.assertTrue(4 in g)
+    self.assertFalse(5 in g)
+
+    ref_ids, ref_scores = reference_search(models, ids, probes, k)
+    for n_threads in (1, 3):
+      res_ids, res_scores = g.search(probes, k, n_threads)
+      self.assertTrue((res_ids == ref_ids).all())
+      self.assertTrue(numpy.allclose(res_scores, ref_scores, 1e-5, 1e-5))
+
+    # A single probe
+    res_ids, res_scores = g.search(probes[0], k)
+    self.assertTrue((res_ids == ref_ids[0]).all())
+
+    # More results than models
+    res_ids, res_scores = g.search(probes, n_models + 10, 2)
+    self.assertEqual(res_ids.shape, (100, n_models))
+
+  def test02_add_remove(self):
+    numpy.random.seed(6)
+    dim = 10
+    models = numpy.random.randn(50, dim)
+    g = bob.machine.GalleryIndex(dim)
+    for i in range(50):
+      g.add(i, models[i])
+    self.assertEqual(len(g), 50)
+
+    # Removes every other model
+    for i in range(0, 50, 2):
+      self.assertTrue(g.remove(i))
+    self.assertFalse(g.remove(0))
+    self.assertEqual(len(g), 25)
+    self.assertEqual(sorted(g.ids), list(range(1, 50, 2)))
+
+    ids = numpy.array(range(1, 50, 2), 'int64')
+    ref_ids, ref_scores = reference_search(models[1::2], ids, models, 3)
+    res_ids, res_scores = g.search(models, 3, 2)
+    self.assertTrue((res_ids == ref_ids).all())
+
+    # Replaces a model
+    g.add(1, models[0])
+    self.assertEqual(len(g), 25)
+    self.assertTrue(numpy.allclose(g.get_model(1), normalize(models[0]), 1e-6, 1e-6))
+
+  def test03_projection_io(self):
+    numpy.random.seed(7)
+    machine = bob.machine.LinearMachine(numpy.random.randn(12, 5))
+    machine.input_subtract = numpy.random.randn(12)
+    machine.biases = numpy.random.randn(5)
+    models = numpy.random.randn(40, 12)
+    ids = numpy.array(range(40), 'int64')
+    probes = numpy.random.randn(8, 12)
+
+    g = bob.machine.GalleryIndex(machine)
+    self.assertEqual(g.n_inputs, 12)
+    self.assertEqual(g.dimension, 5)
+    g.add(ids, models)
+
+    ref_ids, ref_scores = reference_search(machine(models), ids, machine(probes), 4)
+    res_ids, res_scores = g.search(probes, 4)
+    self.assertTrue((res_ids == ref_ids).all())
+    self.assertTrue(numpy.allclose(res_scores, ref_scores, 1e-5, 1e-5))
+
+    # Saves and reloads the gallery
+    g.remove(3)
+    filename = str(tempfile.mkstemp(".hdf5")[1])
+    g.save(bob.io.HDF5File(filename, 'w'))
+    g2 = bob.machine.GalleryIndex(bob.io.HDF5File(filename))
+    self.assertEqual(len(g2), 39)
+    self.assertFalse(3 in g2)
+    ids1, scores1 = g.search(probes, 4)
+    ids2, scores2 = g2.search(probes, 4)
+    self.assertTrue((ids1 == ids2).all())
+    self.assertTrue((scores1 == scores2).all())
+
+    # A file with a duplicated model id is rejected, and leaves the gallery
+    # it is loaded into untouched
+    dup_ids = numpy.array(g.ids, 'int64')
+    dup_ids[5] = dup_ids[2]
+    bob.io.HDF5File(filename, 'a').set('ids', dup_ids)
+    self.assertRaises(RuntimeError, g2.load, bob.io.HDF5File(filename))
+    os.unlink(filename)
+    self.assertEqual(len(g2), 39)
+    ids2, scores2 = g2.search(probes, 4)
+    self.assertTrue((ids1 == ids2).all())
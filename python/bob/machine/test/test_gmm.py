@@ -206,6 +206,16 @@ class GMMMachineTest(unittest.TestCase):
     self.assertTrue ( numpy.allclose(stats.sum_px, stats_ref.sum_px, atol=1e-10) )
     self.assertTrue( numpy.allclose(stats.sum_pxx, stats_ref.sum_pxx, atol=1e-10) )
 
+    # The samples split over several threads give the same statistics
+    for n_threads in (2, 3):
+      stats_threads = bob.machine.GMMStats(2, 2)
+      gmm.acc_statistics(arrayset, stats_threads, n_threads)
+      self.assertEqual(stats_threads.t, stats.t)
+      self.assertTrue( numpy.allclose(stats_threads.n, stats.n, atol=1e-10) )
+      self.assertTrue( numpy.allclose(stats_threads.sum_px, stats.sum_px, atol=1e-10) )
+      self.assertTrue( numpy.allclose(stats_threads.sum_pxx, stats.sum_pxx, atol=1e-10) )
+      self.assertTrue( abs(stats_threads.log_likelihood - stats.log_likelihood) < 1e-10 * abs(stats.log_likelihood) )
+
   def test04_GMMMachine(self):
     """Test a GMMMachine (log-likelihood computation)"""
     
@@ -219,3 +229,64 @@ class GMMMachineTest(unittest.TestCase):
     # implementation
     matlab_ll_ref = -2.361583051672024e+02
     self.assertTrue( abs(gmm(data) - matlab_ll_ref) < 1e-10)
+
+  def test05_GMMMachine(self):
+    """Test a GMMMachine (batch log-likelihood computation)"""
+
+    arrayset = bob.io.load(F("faithful.torch3_f64.hdf5"))
+    gmm = bob.machine.GMMMachine(2, 2)
+    gmm.weights   = numpy.array([0.4, 0.6], 'float64')
+    gmm.means     = numpy.array([[3, 70], [4, 72]], 'float64')
+    gmm.variances = numpy.array([[1, 10], [2, 5]], 'float64')
+    ubm = bob.machine.GMMMachine(1, 2)
+    ubm.means     = numpy.array([[3.5, 71]], 'float64')
+    ubm.variances = numpy.array([[2, 20]], 'float64')
+    llr = bob.machine.GMMLLRMachine(gmm, ubm)
+
+    for machine in (gmm, llr, ubm.get_gaussian(0)):
+      reference = numpy.array([machine(x) for x in arrayset])
+      for n_threads in (1, 3):
+        self.assertTrue( numpy.allclose(machine(arrayset, n_threads), reference, rtol=1e-10, atol=1e-10) )
+        self.assertTrue( numpy.allclose(machine.forward(arrayset, n_threads), reference, rtol=1e-10, atol=1e-10) )
+
+  def test06_GMMMachine(self):
+    """Test a GMMMachine in single precision (deviations from the double precision computations)"""
+
+    arrayset = bob.io.load(F("faithful.torch3_f64.hdf5"))
+    gmm = bob.machine.GMMMachine(2, 2)
+    gmm.weights   = numpy.array([0.4, 0.6], 'float64')
+    gmm.means     = numpy.array([[3, 70], [4, 72]], 'float64')
+    gmm.variances = numpy.array([[1, 10], [2, 5]], 'float64')
+    arrayset32 = arrayset.astype('float32')
+
+    # Log-likelihoods
+    reference = gmm(arrayset)
+    for n_threads in (1, 3):
+      scores = gmm(arrayset32, n_threads)
+      self.assertEqual(scores.dtype, numpy.float32)
+      deviation = (abs(scores - reference) / abs(reference)).max()
+      sys.stdout.write("single precision GMM log-likelihoods, max. relative deviation: %g\n" % deviation)
+      self.assertTrue(deviation < 1e-4)
+
+    # Statistics
+    stats_ref = bob.machine.GMMStats(2, 2)
+    gmm.acc_statistics(arrayset, stats_ref)
+    for n_threads in (1, 3):
+      stats = bob.machine.GMMStats(2, 2)
+      gmm.acc_statistics(arrayset32, stats, n_threads)
+      self.assertEqual(stats.t, stats_ref.t)
+      self.assertTrue( numpy.allclose(stats.n, stats_ref.n, rtol=1e-4, atol=1e-4) )
+      self.assertTrue( numpy.allclose(stats.sum_px, stats_ref.sum_px, rtol=1e-4, atol=1e-4) )
+      self.assertTrue( numpy.allclose(stats.sum_pxx, stats_ref.sum_pxx, rtol=1e-4, atol=1e-4) )
+      self.assertTrue( abs(stats.log_likelihood - stats_ref.log_likelihood) < 1e-4 * abs(stats_ref.log_likelihood) )
+
+    # Single precision storage
+    filename = str(tempfile.mkstemp(".hdf5")[1])
+    stats_ref.save(bob.io.HDF5File(filename, 'w'), True)
+    stats = bob.machine.GMMStats(bob.io.HDF5File(filename))
+    self.assertTrue( numpy.allclose(stats.sum_pxx, stats_ref.sum_pxx, rtol=1e-6, atol=1e-6) )
+    gmm.save(bob.io.HDF5File(filename, 'w'), True)
+    gmm2 = bob.machine.GMMMachine(bob.io.HDF5File(filename))
+    os.unlink(filename)
+    self.assertTrue( numpy.allclose(gmm2.variances, gmm.variances, rtol=1e-6, atol=1e-6) )
+    self.assertTrue( numpy.allclose(gmm2(arrayset), reference, rtol=1e-4, atol=1e-4) )
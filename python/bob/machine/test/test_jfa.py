@@ -202,3 +202,61 @@ class JFAMachineTest(unittest.TestCase):
 
     # Clean-up
     os.unlink(filename)
+
+  def test04_BatchForward(self):
+
+    # Creates a UBM
+    weights = numpy.array([0.4, 0.6], 'float64')
+    means = numpy.array([[1, 6, 2], [4, 3, 2]], 'float64')
+    variances = numpy.array([[1, 2, 1], [2, 1, 2]], 'float64') 
+    ubm = bob.machine.GMMMachine(2,3)
+    ubm.weights = weights
+    ubm.means = means
+    ubm.variances = variances
+
+    # Creates a JFABaseMachine
+    U = numpy.array([[1, 2], [3, 4], [5, 6], [7, 8], [9, 10], [11, 12]], 'float64')
+    V = numpy.array([[6, 5], [4, 3], [2, 1], [1, 2], [3, 4], [5, 6]], 'float64')
+    d = numpy.array([0, 1, 0, 1, 0, 1], 'float64')
+    base = bob.machine.JFABaseMachine(ubm,2,2)
+    base.u = U
+    base.v = V
+    base.d = d 
+
+    # Creates several JFAMachines and GMMStats
+    numpy.random.seed(0)
+    models = []
+    for i in range(5):
+      m = bob.machine.JFAMachine(base)
+      m.y = numpy.random.randn(2)
+      m.z = numpy.random.randn(6)
+      models.append(m)
+    probes = []
+    for i in range(70):
+      gs = bob.machine.GMMStats(2,3)
+      gs.t = i % 7
+      gs.n = numpy.random.rand(2)
+      gs.sum_px = numpy.random.randn(2,3)
+      gs.sum_pxx = numpy.random.rand(2,3)
+      probes.append(gs)
+
+    # Compares the batched scores with the ones of the JFAMachines
+    ref = numpy.ndarray((len(models), len(probes)), 'float64')
+    for i, m in enumerate(models):
+      for j, p in enumerate(probes):
+        ref[i,j] = m.forward(p)
+    for n_threads in (1, 3):
+      scores = base.forward(models, probes, n_threads=n_threads)
+      self.assertEqual( scores.shape, (len(models), len(probes)) )
+      self.assertTrue( numpy.allclose(scores, ref, 1e-10, 1e-10) )
+
+    # Checks that the cached state is invalidated when U is updated
+    base.u = U * 0.5
+    score = models[0].forward(probes[1])
+    scores = base.forward(models, probes)
+    self.assertTrue( abs(scores[0,1] - score) < 1e-10 )
+    self.assertFalse( abs(scores[0,1] - ref[0,1]) < 1e-10 )
+
+    # The models should be attached to the machine they are scored against
+    other = bob.machine.JFABaseMachine(base)
+    self.assertRaises(RuntimeError, other.forward, models, probes)
@@ -83,3 +83,18 @@ class KMeansMachineTest(unittest.TestCase):
 
     # Clean-up
     os.unlink(filename)
+
+  def test02_KMeansMachine(self):
+    """Test the batch distance computation of a KMeansMachine"""
+
+    numpy.random.seed(3)
+    km = bob.machine.KMeansMachine(5, 4)
+    km.means = numpy.random.randn(5, 4)
+    data = numpy.random.randn(600, 4)
+    data[0,:] = km.means[2,:]
+
+    reference = numpy.array([km(x) for x in data])
+    for n_threads in (1, 3):
+      distances = km.forward(data, n_threads)
+      self.assertTrue( numpy.allclose(distances, reference, rtol=1e-10, atol=1e-10) )
+    self.assertTrue( km(data)[0] >= 0 )
@@ -230,3 +230,31 @@ class MachineTest(unittest.TestCase):
     self.assertFalse( m1 == m6 )
     self.assertTrue( m1 != m6 )
 
+
+  def test05_Batch(self):
+
+    # Tests the batched projection against the row-by-row one
+    c = bob.io.HDF5File(MACHINE)
+    m = bob.machine.LinearMachine(c)
+
+    numpy.random.seed(7)
+    data = numpy.random.randn(1500, 3)
+    expected = numpy.vstack([m(k) for k in data])
+
+    for n_threads in (1, 4):
+      output = m(data, n_threads=n_threads)
+      self.assertTrue( (abs(output - expected) < 1e-10).all() )
+
+      # single precision output
+      output32 = numpy.ndarray((len(data), 2), 'float32')
+      m(data, output32, n_threads)
+      self.assertTrue( (abs(output32 - expected) < 1e-5).all() )
+
+    # changes to the scaling must be reflected in the batched projection
+    m.input_subtract = 0.25
+    m.input_divide = 3.
+    m.activation = bob.machine.Activation.LOG
+    expected = numpy.vstack([m(k) for k in data])
+    output = numpy.ndarray((len(data), 2), 'float64')
+    m(data, output, 3)
+    self.assertTrue( (abs(output - expected) < 1e-10).all() )
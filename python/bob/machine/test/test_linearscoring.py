@@ -21,6 +21,7 @@
 """
 
 import os, sys
+import tempfile
 import unittest
 import bob
 import numpy
@@ -105,3 +106,53 @@ class LinearScoringTest(unittest.TestCase):
     # 2/d/ With test_channelOffset, with frame-length normalisation
     scores = bob.machine.linear_scoring([model1.mean_supervector, model2.mean_supervector], ubm.mean_supervector, ubm.variance_supervector, [stats1, stats2, stats3], test_channeloffset, True)
     self.assertTrue((abs(scores - ref_scores_11) < 1e-7).all())
+
+  def test02_LinearScoringBlocks(self):
+    # Enough test statistics to span several blocks
+    C = 3; D = 4; n_models = 4; n_tests = 600
+    numpy.random.seed(2)
+    ubm_mean = numpy.random.randn(C*D)
+    ubm_variance = numpy.random.rand(C*D) + 0.5
+    models = [numpy.random.randn(C*D) for i in range(n_models)]
+    test_stats = []
+    offsets = []
+    for i in range(n_tests):
+      stats = bob.machine.GMMStats(C, D)
+      stats.n = numpy.random.rand(C) * 10
+      stats.sum_px = numpy.random.randn(C, D) * 10
+      stats.t = int(stats.n.sum())
+      test_stats.append(stats)
+      offsets.append(numpy.random.randn(C*D))
+
+    # Reference, computed as the original dense implementation
+    A = numpy.array([(m - ubm_mean) / ubm_variance for m in models])
+    B = numpy.array([s.sum_px.flatten() - numpy.repeat(s.n, D) * (ubm_mean + o)
+      for (s, o) in zip(test_stats, offsets)])
+    T = numpy.array([s.t for s in test_stats], 'float64')
+    B[T == 0] = 0
+    T[T == 0] = 1
+    ref_scores = numpy.dot(A, (B / T[:,numpy.newaxis]).T)
+
+    for n_threads in (1, 3):
+      scores = bob.machine.linear_scoring(models, ubm_mean, ubm_variance, test_stats, offsets, True, n_threads)
+      self.assertTrue(numpy.allclose(scores, ref_scores, 1e-10, 1e-10))
+
+    # Scores streamed to an HDF5 file
+    filename = str(tempfile.mkstemp(".hdf5")[1])
+    f = bob.io.HDF5File(filename, 'w')
+    bob.machine.linear_scoring(models, ubm_mean, ubm_variance, test_stats, offsets, True, f, 'scores', 2)
+    del f
+    rows = bob.io.HDF5File(filename).lread('scores')
+    self.assertEqual(len(rows), n_tests)
+    for s in range(n_tests):
+      self.assertTrue(numpy.allclose(rows[s], ref_scores[:,s], 1e-10, 1e-10))
+    os.unlink(filename)
+
+    # Single precision scores; the maximum relative deviation from the
+    # double precision scores is reported
+    for n_threads in (1, 3):
+      scores = bob.machine.linear_scoring_float32(models, ubm_mean, ubm_variance, test_stats, offsets, True, n_threads)
+      self.assertEqual(scores.dtype, numpy.float32)
+      deviation = (abs(scores - ref_scores) / abs(ref_scores).max()).max()
+      sys.stdout.write("single precision linear scoring, max. relative deviation: %g\n" % deviation)
+      self.assertTrue(deviation < 1e-5)
@@ -222,6 +222,10 @@ class MLPTest(unittest.TestCase):
     output = m(input)
     self.assertTrue ( (abs(output - target) < 1e-8).all() )
 
+    # the rows can also be split over several threads
+    output = m(input, 3)
+    self.assertTrue ( (abs(output - target) < 1e-8).all() )
+
   def test06_Randomization(self):
 
     # this test makes sure randomization is working as expected on MLPs
@@ -0,0 +1,161 @@
+#!/usr/bin/env python
+# vim: set fileencoding=utf-8 :
+# Mon Oct 19 20:14:08 2026 +0200
+#
+# Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3 of the License.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Tests on the ModelBank
+"""
+
+import os, sys
+import unittest
+import tempfile
+import bob
+import numpy
+
+def make_ubm():
+  ubm = bob.machine.GMMMachine(2, 3)
+  ubm.weights = numpy.array([0.4, 0.6], 'float64')
+  ubm.means = numpy.array([[1, 6, 2], [4, 3, 2]], 'float64')
+  ubm.variances = numpy.array([[1, 2, 1], [2, 1, 2]], 'float64')
+  return ubm
+
+def make_stats(n):
+  stats = []
+  for i in range(n):
+    gs = bob.machine.GMMStats(2, 3)
+    gs.t = i % 7 + 1
+    gs.n = numpy.random.rand(2)
+    gs.sum_px = numpy.random.randn(2, 3)
+    gs.sum_pxx = numpy.random.rand(2, 3)
+    stats.append(gs)
+  return stats
+
+class ModelBankTest(unittest.TestCase):
+  """Performs various ModelBank tests."""
+
+  def test01_fields(self):
+    numpy.random.seed(1)
+    b = bob.machine.ModelBank(['a', 'b'], [4, 1])
+    self.assertEqual(b.field_names, ('a', 'b'))
+    self.assertEqual(b.field_size('a'), 4)
+    self.assertFalse(b.has_field('c'))
+
+    values = numpy.random.randn(40, 4)
+    ids = numpy.array(range(40), 'int64') * 2
+    b.set(ids, 'a', values)
+    b.set(3, 'b', numpy.array([5.]))
+    self.assertEqual(len(b), 41)
+    self.assertTrue(4 in b)
+    self.assertFalse(5 in b)
+    self.assertTrue((b.get_field('a', 6) == values[3]).all())
+    self.assertTrue((b.get_field('b', 3) == 5.).all())
+    self.assertTrue((b.get_field('a', 3) == 0.).all())
+
+    # The last model is moved into the freed rows
+    self.assertTrue(b.remove(0))
+    self.assertFalse(b.remove(0))
+    self.assertEqual(len(b), 40)
+    self.assertEqual(b.row(3), 0)
+    self.assertTrue((b.get_field('a', 78) == values[39]).all())
+
+    # Saves and reloads the bank
+    filename = str(tempfile.mkstemp(".hdf5")[1])
+    b.save(bob.io.HDF5File(filename, 'w'))
+    b2 = bob.machine.ModelBank(bob.io.HDF5File(filename))
+    self.assertEqual(b2.field_names, b.field_names)
+    self.assertTrue((b2.ids == b.ids).all())
+    self.assertTrue((b2.get_field('a') == b.get_field('a')).all())
+    self.assertTrue((b2.get_field('b') == b.get_field('b')).all())
+
+    # A file with a duplicated model id is rejected
+    ids = b.ids.copy()
+    ids[5] = ids[2]
+    bob.io.HDF5File(filename, 'a').set('ids', ids)
+    self.assertRaises(RuntimeError, bob.machine.ModelBank, bob.io.HDF5File(filename))
+    # and leaves the bank it is loaded into untouched
+    self.assertRaises(RuntimeError, b2.load, bob.io.HDF5File(filename))
+    os.unlink(filename)
+    self.assertTrue((b2.ids == b.ids).all())
+    self.assertTrue((b2.get_field('a') == b.get_field('a')).all())
+
+  def test02_gmm(self):
+    numpy.random.seed(2)
+    ubm = make_ubm()
+    models = []
+    b = bob.machine.ModelBank(ubm)
+    for i in range(30):
+      m = bob.machine.GMMMachine(ubm)
+      m.means = ubm.means + numpy.random.randn(2, 3)
+      models.append(m)
+      b.add(i + 100, m)
+    self.assertEqual(b.field_names, ('mean',))
+    stats = make_stats(50)
+    offsets = [numpy.random.randn(6) * 0.1 for s in stats]
+
+    ref = bob.machine.linear_scoring(models, ubm, stats, [], True)
+    ref_offset = bob.machine.linear_scoring(models, ubm, stats, offsets, True)
+    for n_threads in (1, 3):
+      scores = bob.machine.linear_scoring(b, ubm, stats, [], True, n_threads)
+      self.assertTrue(numpy.allclose(scores, ref, 1e-8, 1e-8))
+      scores = bob.machine.linear_scoring(b, ubm, stats, offsets, True, n_threads)
+      self.assertTrue(numpy.allclose(scores, ref_offset, 1e-8, 1e-8))
+
+  def test03_jfa(self):
+    numpy.random.seed(3)
+    ubm = make_ubm()
+    base = bob.machine.JFABaseMachine(ubm, 2, 2)
+    base.u = numpy.random.randn(6, 2)
+    base.v = numpy.random.randn(6, 2)
+    base.d = numpy.random.rand(6)
+    models = []
+    b = bob.machine.ModelBank(base)
+    for i in range(10):
+      m = bob.machine.JFAMachine(base)
+      m.y = numpy.random.randn(2)
+      m.z = numpy.random.randn(6)
+      models.append(m)
+      b.add(i, m)
+    probes = make_stats(40)
+
+    ref = base.forward(models, probes)
+    for n_threads in (1, 3):
+      scores = base.forward(b, probes, n_threads)
+      self.assertTrue(numpy.allclose(scores, ref, 1e-10, 1e-10))
+
+  def test04_plda(self):
+    numpy.random.seed(4)
+    D = 5; nf = 2; ng = 3
+    mb = bob.machine.PLDABaseMachine(D, nf, ng)
+    mb.sigma = numpy.random.rand(D) + 0.5
+    mb.g = numpy.random.randn(D, ng)
+    mb.f = numpy.random.randn(D, nf)
+    mb.mu = numpy.random.randn(D)
+    models = []
+    b = bob.machine.ModelBank(mb)
+    for i, n_samples in enumerate((0, 1, 2, 2, 5)):
+      m = bob.machine.PLDAMachine(mb)
+      m.n_samples = n_samples
+      m.w_sum_xit_beta_xi = numpy.random.rand()
+      m.weighted_sum = numpy.random.randn(nf)
+      m.log_likelihood = -numpy.random.rand()
+      models.append(m)
+      b.add(i, m)
+    probes = numpy.random.randn(100, D)
+
+    ref = mb.forward(models, probes)
+    for n_threads in (1, 4):
+      scores = mb.forward(b, probes, n_threads)
+      self.assertTrue(numpy.allclose(scores, ref, 1e-8, 1e-8))
@@ -204,3 +204,66 @@ class PLDAMachineTest(unittest.TestCase):
 
     # Clean-up
     os.unlink(filename)
+
+  def test03_plda_batch_forward(self):
+    # Data used for performing the tests
+    # Features and subspaces dimensionality
+    D = 7
+    nf = 2
+    ng = 3
+    # Values for F, G and sigma
+    G=numpy.array([-1.1424, -0.5044, -0.1917,
+      -0.6249,  0.1021, -0.8658,
+      -1.1687,  1.1963,  0.1807,
+      0.3926,  0.1203,  1.2665,
+      1.3018, -1.0368, -0.2512,
+      -0.5936, -0.8571, -0.2046,
+      0.4364, -0.1699, -2.2015], 'float64').reshape(D,ng)
+    # F <-> PCA on G
+    F=numpy.array([-0.054222647972093, -0.000000000783146, 
+      0.596449127693018,  0.000000006265167, 
+      0.298224563846509,  0.000000003132583, 
+      0.447336845769764,  0.000000009397750, 
+      -0.108445295944185, -0.000000001566292, 
+      -0.501559493741856, -0.000000006265167, 
+      -0.298224563846509, -0.000000003132583], 'float64').reshape(D,nf)
+    sigma = numpy.ndarray(D, 'float64')
+    sigma.fill(0.01)
+    mu = numpy.array([0.1, -0.2, 0.3, 0., 0.05, -0.1, 0.2], 'float64')
+
+    # Defines base machine
+    mb = bob.machine.PLDABaseMachine(D,nf,ng)
+    mb.sigma = sigma
+    mb.g = G
+    mb.f = F
+    mb.mu = mu
+
+    # Defines several machines with different numbers of enrolled samples
+    numpy.random.seed(0)
+    models = []
+    for n_samples in (0, 1, 2, 2, 5):
+      m = bob.machine.PLDAMachine(mb)
+      m.n_samples = n_samples
+      m.w_sum_xit_beta_xi = numpy.random.rand()
+      m.weighted_sum = numpy.random.randn(nf)
+      m.log_likelihood = -numpy.random.rand()
+      models.append(m)
+    probes = numpy.random.randn(300, D)
+
+    # Precomputes the terms once; the batched scores should not add any
+    mb.precompute_log_like_const_terms(1, 6)
+    for a in range(1, 7):
+      self.assertTrue(mb.has_gamma(a))
+      self.assertTrue(mb.has_log_like_const_term(a))
+
+    # Compares with the scores of each PLDAMachine
+    ref = numpy.ndarray((len(models), probes.shape[0]), 'float64')
+    for i, m in enumerate(models):
+      for j in range(probes.shape[0]):
+        ref[i,j] = m.forward(probes[j,:])
+    for n_threads in (1, 4):
+      scores = mb.forward(models, probes, n_threads=n_threads)
+      self.assertEqual(scores.shape, ref.shape)
+      self.assertTrue(numpy.allclose(scores, ref, 1e-8, 1e-8))
+    for m in models:
+      self.assertFalse(m.has_gamma(m.n_samples+1))
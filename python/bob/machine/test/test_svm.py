@@ -271,3 +271,64 @@ class SvmTest(unittest.TestCase):
     self.assertEqual(pred_labels, real_labels)
     self.assertTrue( numpy.all(abs(numpy.vstack(pred_probs) -
       numpy.vstack(real_probs)) < 1e-6) )
+
+  def test07_batch_correctness(self):
+
+    #the batch engine should reproduce the per-sample libsvm predictions
+    for model, expected_file in ((HEART_MACHINE, HEART_EXPECTED),
+        (IRIS_MACHINE, IRIS_EXPECTED)):
+      machine = bob.machine.SupportVector(model)
+      labels, data = bob.machine.SVMFile(HEART_DATA if model == HEART_MACHINE
+          else IRIS_DATA).read_all()
+      data = numpy.vstack(data)
+
+      batch = bob.machine.BatchSupportVector(machine)
+      self.assertEqual(batch.labels, machine.labels)
+      self.assertEqual(batch.input_size, machine.shape[0])
+
+      expected_labels, expected_scores = machine.predict_classes_and_scores(data)
+      expected_scores = numpy.vstack(expected_scores)
+
+      for n_threads in (1, 3):
+        batch.block_size = 16 #forces several blocks per thread
+        pred_labels = batch.predict_classes(data, n_threads)
+        self.assertEqual(tuple(pred_labels), expected_labels)
+
+        pred_labels, pred_scores = batch.predict_classes_and_scores(data,
+            n_threads)
+        self.assertEqual(tuple(pred_labels), expected_labels)
+        self.assertTrue( numpy.all(abs(pred_scores - expected_scores) < 1e-8) )
+
+        all_labels, real_labels, real_probs = load_expected(expected_file)
+        pred_labels, pred_probs = batch.predict_classes_and_probabilities(data,
+            n_threads)
+        self.assertEqual(tuple(pred_labels), real_labels)
+        self.assertTrue( numpy.all(abs(pred_probs - numpy.vstack(real_probs))
+          < 1e-6) )
+
+  def test08_batch_kernels(self):
+
+    #checks the linear and polynomial specializations with the heart model,
+    #by re-interpreting its support vectors with other kernels
+    labels, data = bob.machine.SVMFile(HEART_DATA).read_all()
+    data = numpy.vstack(data)
+
+    original = open(HEART_MACHINE, 'rt').read()
+    for kernel in ('linear', 'polynomial\ndegree 3\ncoef0 0.5', 'sigmoid\ncoef0 0.5'):
+      tmp = tempname('.model')
+      f = open(tmp, 'wt')
+      f.write(original.replace('kernel_type rbf', 'kernel_type %s' % kernel))
+      f.close()
+      machine = bob.machine.SupportVector(tmp)
+      os.unlink(tmp)
+
+      #scaling should be taken into consideration (and folded for linear)
+      machine.input_subtract = 0.1
+      machine.input_divide = 2.0
+
+      batch = bob.machine.BatchSupportVector(machine)
+      expected_labels, expected_scores = machine.predict_classes_and_scores(data)
+      pred_labels, pred_scores = batch.predict_classes_and_scores(data, 2)
+      self.assertTrue( numpy.all(abs(pred_scores - numpy.vstack(expected_scores))
+        < 1e-8) )
+      self.assertEqual(tuple(pred_labels), expected_labels)
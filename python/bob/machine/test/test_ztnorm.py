@@ -21,6 +21,7 @@
 """
 
 import os, sys
+import tempfile
 import unittest
 import numpy
 import bob
@@ -76,3 +77,65 @@ class ZTNormTest(unittest.TestCase):
     scores = bob.machine.ztnorm(my_A, my_B, my_C, my_D)
     
     self.assertTrue((abs(scores - ref_scores) < 1e-7).all())
+
+    scores = bob.machine.ztnorm(my_A, my_B, my_C, my_D, n_threads=3)
+    self.assertTrue((abs(scores - ref_scores) < 1e-7).all())
+
+  def test03_ztnorm_statistics(self):
+    my_A = bob.io.load(F("ztnorm_eval_eval.mat"))
+    my_B = bob.io.load(F("ztnorm_znorm_eval.mat"))
+    my_C = bob.io.load(F("ztnorm_eval_tnorm.mat"))
+    my_D = bob.io.load(F("ztnorm_znorm_tnorm.mat"))
+    ref_scores = bob.io.load(F("ztnorm_result.mat"))
+
+    for n_threads in (1, 3):
+      # Step by step computation, reusing the statistics
+      (z_mean, z_std) = bob.machine.znorm_statistics(my_B, n_threads)
+      (t_mean, t_std) = bob.machine.tnorm_cohort_statistics(my_D, n_threads)
+      (zt_mean, zt_std) = bob.machine.ztnorm_statistics(my_C, t_mean, t_std,
+          n_threads)
+      scores = bob.machine.ztnorm_apply(my_A, z_mean, z_std, zt_mean, zt_std,
+          n_threads)
+      self.assertTrue((abs(scores - ref_scores) < 1e-7).all())
+
+      # In place
+      scores = my_A.copy()
+      bob.machine.ztnorm_apply_inplace(scores, z_mean, z_std, zt_mean, zt_std,
+          n_threads)
+      self.assertTrue((abs(scores - ref_scores) < 1e-7).all())
+
+    # With a mask of true trials
+    znorm_id = numpy.array(range(my_B.shape[1]), 'uint32')
+    tnorm_id = numpy.array(range(my_D.shape[0]), 'uint32') + 2
+    mask = sameValue(tnorm_id, znorm_id)
+    ref_scores = bob.machine.ztnorm(my_A, my_B, my_C, my_D, mask)
+    (z_mean, z_std) = bob.machine.znorm_statistics(my_B)
+    (t_mean, t_std) = bob.machine.tnorm_cohort_statistics(my_D, mask, 2)
+    (zt_mean, zt_std) = bob.machine.ztnorm_statistics(my_C, t_mean, t_std)
+    scores = bob.machine.ztnorm_apply(my_A, z_mean, z_std, zt_mean, zt_std)
+    self.assertTrue((abs(scores - ref_scores) < 1e-7).all())
+
+  def test04_ztnorm_hdf5(self):
+    my_A = bob.io.load(F("ztnorm_eval_eval.mat"))
+    my_B = bob.io.load(F("ztnorm_znorm_eval.mat"))
+    my_C = bob.io.load(F("ztnorm_eval_tnorm.mat"))
+    my_D = bob.io.load(F("ztnorm_znorm_tnorm.mat"))
+    ref_scores = bob.io.load(F("ztnorm_result.mat"))
+
+    (z_mean, z_std) = bob.machine.znorm_statistics(my_B)
+    (t_mean, t_std) = bob.machine.tnorm_cohort_statistics(my_D)
+    (zt_mean, zt_std) = bob.machine.ztnorm_statistics(my_C, t_mean, t_std)
+
+    filename = str(tempfile.mkstemp(".hdf5")[1])
+    f = bob.io.HDF5File(filename, 'w')
+    bob.machine.ztnorm_apply(my_A, z_mean, z_std, zt_mean, zt_std, f,
+        'scores', 2)
+    del f
+
+    f = bob.io.HDF5File(filename)
+    rows = f.lread('scores')
+    self.assertEqual(len(rows), my_A.shape[0])
+    for i in range(my_A.shape[0]):
+      self.assertTrue((abs(rows[i] - ref_scores[i,:]) < 1e-7).all())
+    del f
+    os.unlink(filename)
@@ -0,0 +1,334 @@
+#!/usr/bin/env python
+# vim: set fileencoding=utf-8 :
+# Mon Oct 19 21:48:12 2026 +0200
+#
+# Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3 of the License.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Multi-process EM training, through partial statistics files.
+
+The E-step of each EM iteration is split across several processes. Each of
+them processes a shard of the training data and writes its partial
+statistics (or accumulators) to an HDF5 file. The partial files are then
+merged in the order of their shard index, whatever the order in which they
+are given or were written, such that the result does not depend on the
+scheduling of the processes. The M-step finally computes the next model from
+the merged statistics. Processes only exchange files: they may run on a
+single machine or on several machines sharing a filesystem.
+
+The supported trainers are:
+
+* 'gmm': maximum likelihood GMM training (e.g. of a UBM). The data list
+  contains one HDF5 file of features (one sample per row) per line.
+* 'isv': training of the U matrix of a JFABaseMachine for Inter-Session
+  Variability modelling. Each line of the data list contains a client
+  identifier and an HDF5 file of GMMStats (one per session).
+* 'jfa': Joint Factor Analysis training, which successively estimates V, U
+  and D (the 'v', 'u' and 'd' steps), with the same data list as 'isv'. The
+  speaker factors are kept from one iteration to the next in a state file
+  per shard.
+
+Written files are first written to a temporary name and then renamed, such
+that incomplete files are never read.
+"""
+
+import os
+import numpy
+import bob
+
+TRAINERS = ('gmm', 'isv', 'jfa')
+JFA_STEPS = ('v', 'u', 'd')
+
+def read_list(filename):
+  """Reads the (whitespace separated) fields of each line of a text file.
+  Empty lines and lines starting with '#' are ignored."""
+
+  retval = []
+  for line in open(filename, 'rt'):
+    line = line.strip()
+    if not line or line.startswith('#'): continue
+    retval.append(line.split())
+  return retval
+
+def load_data_list(trainer, filename):
+  """Loads the list of training data of the given trainer.
+
+  For 'gmm', returns the list of feature files. For 'isv' and 'jfa', returns
+  the list of (client, [GMMStats files]) tuples, in the order in which the
+  clients first appear in the file."""
+
+  lines = read_list(filename)
+  if trainer == 'gmm':
+    for l in lines:
+      if len(l) != 1:
+        raise RuntimeError("'%s': expected a single file name per line, got '%s'" % (filename, ' '.join(l)))
+    return [l[0] for l in lines]
+
+  clients = []
+  files = {}
+  for l in lines:
+    if len(l) != 2:
+      raise RuntimeError("'%s': expected 'client file' lines, got '%s'" % (filename, ' '.join(l)))
+    if l[0] not in files:
+      clients.append(l[0])
+      files[l[0]] = []
+    files[l[0]].append(l[1])
+  return [(c, files[c]) for c in clients]
+
+def shard(items, index, n_shards):
+  """Returns the index-th of n_shards contiguous shards of the items, whose
+  sizes differ by at most one."""
+
+  if n_shards < 1 or index < 0 or index >= n_shards:
+    raise RuntimeError("there is no shard %d out of %d" % (index, n_shards))
+  n = len(items)
+  return items[(index * n) // n_shards : ((index + 1) * n) // n_shards]
+
+def load_machine(trainer, filename, ubm=None):
+  """Loads the machine trained by the given trainer. JFABaseMachine's do not
+  store their UBM, which should be given (as a GMMMachine or file name)."""
+
+  if trainer == 'gmm':
+    return bob.machine.GMMMachine(bob.io.HDF5File(filename))
+
+  if ubm is None:
+    raise RuntimeError("the UBM is required to load a JFABaseMachine")
+  if isinstance(ubm, str):
+    ubm = bob.machine.GMMMachine(bob.io.HDF5File(ubm))
+  machine = bob.machine.JFABaseMachine(bob.io.HDF5File(filename))
+  machine.ubm = ubm
+  return machine
+
+def _write(filename, writer):
+  """Calls writer with a new HDF5File, which is then moved to filename"""
+
+  tmpname = filename + '.tmp'
+  f = bob.io.HDF5File(tmpname, 'w')
+  writer(f)
+  del f
+  os.rename(tmpname, filename)
+
+def save_machine(machine, filename):
+  """Saves a machine"""
+
+  _write(filename, machine.save)
+
+def _save_state(jfa_trainer, step, filename):
+  """Saves the speaker factors of the shard of a JFA training"""
+
+  x, y, z = jfa_trainer.__X__, jfa_trainer.__Y__, jfa_trainer.__Z__
+  def writer(f):
+    f.set('step', step)
+    f.set('n_clients', len(y))
+    for i in range(len(y)):
+      f.set('x_%d' % i, x[i])
+      f.set('y_%d' % i, y[i])
+      f.set('z_%d' % i, z[i])
+  _write(filename, writer)
+
+def _load_state(jfa_trainer, stats, filename):
+  """Loads the speaker factors of the shard of a JFA training, and returns
+  the step that saved them. If there is no state file, the factors are set
+  to zero and None is returned."""
+
+  if filename is None or not os.path.exists(filename):
+    jfa_trainer.__initializeXYZ__(stats)
+    return None
+
+  f = bob.io.HDF5File(filename)
+  n_clients = f.read('n_clients')
+  if n_clients != len(stats):
+    raise RuntimeError("'%s' has the factors of %d clients, whereas the shard has %d clients" % (filename, n_clients, len(stats)))
+  x = [f.read('x_%d' % i) for i in range(n_clients)]
+  y = [f.read('y_%d' % i) for i in range(n_clients)]
+  z = [f.read('z_%d' % i) for i in range(n_clients)]
+  jfa_trainer.__setSpeakerFactors__(x, y, z)
+  return f.read('step')
+
+def e_step(trainer, machine, data, index, n_shards, output, iteration=0,
+    step=None, state=None, n_threads=1, block_size=4096):
+  """Runs the E-step on the index-th shard of the data, and writes the
+  partial statistics to the output file.
+
+  Keyword parameters:
+
+  trainer
+    One of 'gmm', 'isv' or 'jfa'
+
+  machine
+    The current GMMMachine ('gmm') or JFABaseMachine ('isv' and 'jfa')
+
+  data
+    The training data, as returned by load_data_list()
+
+  index, n_shards
+    The shard processed by this E-step, out of n_shards
+
+  output
+    The name of the partial statistics file
+
+  iteration
+    The iteration number, which is written to the partial file, such that
+    the partial files of different iterations are not merged
+
+  step
+    The step of a 'jfa' training ('v', 'u' or 'd')
+
+  state
+    The file of the speaker factors of the shard ('jfa' only)
+
+  n_threads
+    The number of threads of the E-step ('gmm' only)
+
+  block_size
+    The number of samples read at once ('gmm' only)
+  """
+
+  data = shard(data, index, n_shards)
+
+  if trainer == 'gmm':
+    t = bob.trainer.ML_GMMTrainer()
+    t.n_threads = n_threads
+    if data:
+      sampler = bob.trainer.HDF5BlockSampler(data, 'array', block_size)
+      t.initialization(machine, sampler)
+      t.e_step(machine, sampler)
+      stats = t.gmm_statistics
+    else:
+      stats = bob.machine.GMMStats(machine.dim_c, machine.dim_d)
+    def write_stats(f):
+      f.create_group('stats')
+      f.cd('stats')
+      stats.save(f)
+      f.cd('..')
+    acc = write_stats
+
+  else:
+    # The statistics are read once, into contiguous storage
+    stats = bob.trainer.JFATrainingStats(machine.dim_c, machine.dim_d)
+    stats.load([files for client, files in data])
+    t = bob.trainer.JFABaseTrainer(machine)
+    t.__initNid__(stats)
+    t.__precomputeSumStatisticsN__(stats)
+    t.__precomputeSumStatisticsF__(stats)
+
+    if trainer == 'isv':
+      step = 'u'
+      t.__initializeXYZ__(stats)
+      t.__updateX__(stats)
+      t.__updateZ__(stats)
+      t.__accumulateU__(stats)
+
+    else:
+      if step not in JFA_STEPS:
+        raise RuntimeError("the step of a JFA training should be one of %s" % (JFA_STEPS,))
+      previous = _load_state(t, stats, state)
+      # The factors estimated by the previous step are updated one last time
+      # with the final estimate of the previous matrix, as in the single
+      # process training
+      if previous == 'v' and step != 'v': t.__updateY__(stats)
+      if previous == 'u' and step == 'd': t.__updateX__(stats)
+      if step == 'v':
+        t.__updateY__(stats)
+        t.__accumulateV__(stats)
+      elif step == 'u':
+        t.__updateX__(stats)
+        t.__accumulateU__(stats)
+      else:
+        t.__updateZ__(stats)
+        t.__accumulateD__(stats)
+      if state is not None: _save_state(t, step, state)
+
+    a1 = getattr(t, 'acc_%s_a1' % step)
+    a2 = getattr(t, 'acc_%s_a2' % step)
+    def write_acc(f):
+      f.set('a1', a1)
+      f.set('a2', a2)
+    acc = write_acc
+
+  def writer(f):
+    f.set('trainer', trainer)
+    f.set('step', step or '')
+    f.set('iteration', iteration)
+    f.set('shard', index)
+    f.set('n_shards', n_shards)
+    acc(f)
+  _write(output, writer)
+
+def merge(filenames):
+  """Merges partial statistics files. The files are summed in the order of
+  their shard index, after checking that there is exactly one file per shard
+  and that all of them come from the same E-step.
+
+  Returns a tuple (trainer, step, iteration, statistics), where statistics
+  is a GMMStats ('gmm') or a tuple of accumulators ('isv' and 'jfa')."""
+
+  if not filenames:
+    raise RuntimeError("there are no partial statistics to merge")
+
+  partials = []
+  for filename in filenames:
+    f = bob.io.HDF5File(filename)
+    header = tuple(f.read(k) for k in ('trainer', 'step', 'iteration', 'n_shards'))
+    partials.append((f.read('shard'), filename, header, f))
+  partials.sort(key=lambda p: p[0])
+
+  trainer, step, iteration, n_shards = partials[0][2]
+  for index, filename, header, f in partials:
+    if header != partials[0][2]:
+      raise RuntimeError("'%s' (trainer '%s', step '%s', iteration %d, %d shards) does not come from the same E-step as '%s' (trainer '%s', step '%s', iteration %d, %d shards)" % ((filename,) + header + (partials[0][1],) + partials[0][2]))
+  indices = [p[0] for p in partials]
+  if indices != list(range(n_shards)):
+    raise RuntimeError("expected one partial file for each of the %d shards, got shards %s" % (n_shards, indices))
+
+  if trainer == 'gmm':
+    stats = None
+    for index, filename, header, f in partials:
+      f.cd('stats')
+      s = bob.machine.GMMStats(f)
+      if stats is None: stats = s
+      else: stats += s
+    return (trainer, step, iteration, stats)
+
+  a1 = None
+  for index, filename, header, f in partials:
+    if a1 is None:
+      a1 = f.read('a1')
+      a2 = f.read('a2')
+    else:
+      a1 += f.read('a1')
+      a2 += f.read('a2')
+  return (trainer, step, iteration, (a1, a2))
+
+def m_step(trainer, machine, step, stats, update='mvw'):
+  """Updates the machine from merged statistics (see merge()).
+
+  For 'gmm', update tells which of the means ('m'), variances ('v') and
+  weights ('w') are updated, and the average log-likelihood of the samples
+  (given the machine used by the E-step) is returned. None is returned for
+  the other trainers."""
+
+  if trainer == 'gmm':
+    t = bob.trainer.ML_GMMTrainer('m' in update, 'v' in update, 'w' in update)
+    empty = numpy.ndarray((0, machine.dim_d), 'float64')
+    t.initialization(machine, empty)
+    t.gmm_statistics = stats
+    t.m_step(machine, empty)
+    return t.compute_likelihood(machine)
+
+  t = bob.trainer.JFABaseTrainer(machine)
+  setattr(t, 'acc_%s_a1' % step, stats[0])
+  setattr(t, 'acc_%s_a2' % step, stats[1])
+  getattr(t, '__update%sFromAccumulators__' % step.upper())()
+  return None
@@ -0,0 +1,114 @@
+#!/usr/bin/env python
+# vim: set fileencoding=utf-8 :
+# Mon Oct 19 21:48:12 2026 +0200
+#
+# Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3 of the License.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""This script runs the E-step of an EM training on a shard of the training
+data, and writes the partial statistics to an HDF5 file. The partial files of
+all the shards are then merged by %(prog_mstep)s, which computes the next
+model."""
+
+__epilog__ = """
+Examples:
+
+  1. Accumulates the GMM statistics of the second of four shards of the
+     feature files listed in features.lst (one file per line):
+
+     $ %(prog)s --trainer=gmm --machine=ubm.hdf5 --data=features.lst --shard=1 --shards=4 --output=stats-1.hdf5
+
+  2. Accumulates the ISV statistics of the first of two shards of the
+     clients listed in stats.lst ('client gmm_stats_file' per line):
+
+     $ %(prog)s --trainer=isv --machine=isv.hdf5 --ubm=ubm.hdf5 --data=stats.lst --shard=0 --shards=2 --output=acc-0.hdf5
+
+  3. Runs a 'v' step of a JFA training, keeping the speaker factors of the
+     shard in state-0.hdf5:
+
+     $ %(prog)s --trainer=jfa --step=v --machine=jfa.hdf5 --ubm=ubm.hdf5 --data=stats.lst --shard=0 --shards=2 --state=state-0.hdf5 --output=acc-0.hdf5
+"""
+
+import os, sys
+
+def get_options(user_input):
+  """Parse the program options"""
+
+  from bob.trainer.distributed import TRAINERS, JFA_STEPS
+
+  usage = 'usage: %s [arguments]' % os.path.basename(sys.argv[0])
+
+  import argparse
+  parser = argparse.ArgumentParser(usage=usage,
+      description=(__doc__ % {'prog_mstep': 'bob_em_mstep.py'}),
+      epilog=(__epilog__ % {'prog': os.path.basename(sys.argv[0])}),
+      formatter_class=argparse.RawDescriptionHelpFormatter)
+
+  parser.add_argument('-t', '--trainer', dest='trainer', default='gmm',
+      choices=TRAINERS, help="The model to train (defaults to %(default)s)")
+  parser.add_argument('-m', '--machine', dest='machine', default=None,
+      help="The current model", metavar="FILE")
+  parser.add_argument('-u', '--ubm', dest='ubm', default=None,
+      help="The UBM of the JFABaseMachine (isv and jfa only)", metavar="FILE")
+  parser.add_argument('-d', '--data', dest='data', default=None,
+      help="The list of training files", metavar="FILE")
+  parser.add_argument('-s', '--shard', dest='shard', default=0, type=int,
+      help="The shard of the data processed by this E-step (defaults to %(default)s)", metavar="INT")
+  parser.add_argument('-n', '--shards', dest='shards', default=1, type=int,
+      help="The number of shards of the data (defaults to %(default)s)", metavar="INT")
+  parser.add_argument('-o', '--output', dest='output', default=None,
+      help="The file of partial statistics to write", metavar="FILE")
+  parser.add_argument('-i', '--iteration', dest='iteration', default=0, type=int,
+      help="The iteration number, which is checked when the partial files are merged (defaults to %(default)s)", metavar="INT")
+  parser.add_argument('-p', '--step', dest='step', default=None,
+      choices=JFA_STEPS, help="The step of the JFA training (jfa only)")
+  parser.add_argument('-S', '--state', dest='state', default=None,
+      help="The file keeping the speaker factors of the shard between the iterations (jfa only)", metavar="FILE")
+  parser.add_argument('-j', '--threads', dest='threads', default=1, type=int,
+      help="The number of threads of the E-step (gmm only, defaults to %(default)s)", metavar="INT")
+  parser.add_argument('-b', '--block-size', dest='block_size', default=4096, type=int,
+      help="The number of samples read at once (gmm only, defaults to %(default)s)", metavar="INT")
+
+  args = parser.parse_args(args=user_input)
+
+  if args.machine is None:
+    parser.error("you should give the current model with --machine")
+  if args.data is None:
+    parser.error("you should give the list of training files with --data")
+  if args.output is None:
+    parser.error("you should give the output file with --output")
+  if args.trainer != 'gmm' and args.ubm is None:
+    parser.error("you should give the UBM with --ubm")
+  if args.trainer == 'jfa' and args.step is None:
+    parser.error("you should give the step of the JFA training with --step")
+  if args.shards < 1 or args.shard < 0 or args.shard >= args.shards:
+    parser.error("the shard should lie between 0 and %d" % (args.shards - 1))
+
+  return args
+
+def main(user_input=None):
+
+  options = get_options(user_input)
+
+  from bob.trainer import distributed
+  machine = distributed.load_machine(options.trainer, options.machine, options.ubm)
+  data = distributed.load_data_list(options.trainer, options.data)
+  distributed.e_step(options.trainer, machine, data, options.shard,
+      options.shards, options.output, options.iteration, options.step,
+      options.state, options.threads, options.block_size)
+
+  return 0
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -0,0 +1,86 @@
+#!/usr/bin/env python
+# vim: set fileencoding=utf-8 :
+# Mon Oct 19 21:48:12 2026 +0200
+#
+# Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3 of the License.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""This script merges the partial statistics files written by the E-steps of
+all the shards of the training data, and runs the M-step to compute the next
+model. The files are merged in the order of their shard index, whatever the
+order in which they are given, such that the result is deterministic."""
+
+__epilog__ = """
+Examples:
+
+  1. Computes the next GMM from the statistics of four shards:
+
+     $ %(prog)s --machine=ubm.hdf5 --output=ubm-next.hdf5 stats-*.hdf5
+
+  2. Computes the next ISV model:
+
+     $ %(prog)s --machine=isv.hdf5 --ubm=ubm.hdf5 --output=isv-next.hdf5 acc-*.hdf5
+"""
+
+import os, sys
+
+def get_options(user_input):
+  """Parse the program options"""
+
+  usage = 'usage: %s [arguments] partial-file [partial-file...]' % os.path.basename(sys.argv[0])
+
+  import argparse
+  parser = argparse.ArgumentParser(usage=usage,
+      description=__doc__,
+      epilog=(__epilog__ % {'prog': os.path.basename(sys.argv[0])}),
+      formatter_class=argparse.RawDescriptionHelpFormatter)
+
+  parser.add_argument('partials', nargs='+', metavar="FILE",
+      help="The partial statistics files")
+  parser.add_argument('-m', '--machine', dest='machine', default=None,
+      help="The current model", metavar="FILE")
+  parser.add_argument('-u', '--ubm', dest='ubm', default=None,
+      help="The UBM of the JFABaseMachine (isv and jfa only)", metavar="FILE")
+  parser.add_argument('-o', '--output', dest='output', default=None,
+      help="The file of the next model", metavar="FILE")
+  parser.add_argument('-U', '--update', dest='update', default='mvw',
+      help="The GMM parameters to update: means (m), variances (v) and/or weights (w) (gmm only, defaults to %(default)s)", metavar="STR")
+
+  args = parser.parse_args(args=user_input)
+
+  if args.machine is None:
+    parser.error("you should give the current model with --machine")
+  if args.output is None:
+    parser.error("you should give the output file with --output")
+  if not args.update or args.update.strip('mvw'):
+    parser.error("the parameters to update should be a combination of 'm', 'v' and 'w'")
+
+  return args
+
+def main(user_input=None):
+
+  options = get_options(user_input)
+
+  from bob.trainer import distributed
+  trainer, step, iteration, stats = distributed.merge(options.partials)
+  machine = distributed.load_machine(trainer, options.machine, options.ubm)
+  likelihood = distributed.m_step(trainer, machine, step, stats, options.update)
+  distributed.save_machine(machine, options.output)
+  if likelihood is not None:
+    print("Iteration %d: average log-likelihood %.10g" % (iteration, likelihood))
+
+  return 0
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -0,0 +1,215 @@
+#!/usr/bin/env python
+# vim: set fileencoding=utf-8 :
+# Mon Oct 19 21:48:12 2026 +0200
+#
+# Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3 of the License.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""This script runs a multi-process EM training. At each iteration, one
+E-step process is started per shard of the training data (see
+bob_em_estep.py), and the partial statistics they write to the working
+directory are merged to compute the next model (see bob_em_mstep.py). The
+intermediate models are kept in the working directory."""
+
+__epilog__ = """
+Examples:
+
+  1. Trains a UBM with 10 iterations, splitting the E-step across 8 processes
+     of 2 threads each:
+
+     $ %(prog)s --trainer=gmm --machine=ubm-init.hdf5 --data=features.lst --shards=8 --threads=2 --iterations=10 --workdir=tmp --output=ubm.hdf5
+
+  2. Trains an ISV model with a relevance factor of 4, from an initial U:
+
+     $ %(prog)s --trainer=isv --machine=isv-init.hdf5 --ubm=ubm.hdf5 --relevance-factor=4 --data=stats.lst --shards=4 --iterations=10 --workdir=tmp --output=isv.hdf5
+
+  3. Trains a JFA model, with 10 iterations for each of V, U and D:
+
+     $ %(prog)s --trainer=jfa --machine=jfa-init.hdf5 --ubm=ubm.hdf5 --data=stats.lst --shards=4 --iterations=10 --workdir=tmp --output=jfa.hdf5
+
+  4. Resumes the training of example 1 after it was interrupted, from the
+     last intermediate model of the working directory:
+
+     $ %(prog)s --trainer=gmm --machine=ubm-init.hdf5 --data=features.lst --shards=8 --threads=2 --iterations=10 --workdir=tmp --output=ubm.hdf5 --resume
+"""
+
+import os, sys
+import shutil
+import subprocess
+
+def get_options(user_input):
+  """Parse the program options"""
+
+  from bob.trainer.distributed import TRAINERS
+
+  usage = 'usage: %s [arguments]' % os.path.basename(sys.argv[0])
+
+  import argparse
+  parser = argparse.ArgumentParser(usage=usage,
+      description=__doc__,
+      epilog=(__epilog__ % {'prog': os.path.basename(sys.argv[0])}),
+      formatter_class=argparse.RawDescriptionHelpFormatter)
+
+  parser.add_argument('-t', '--trainer', dest='trainer', default='gmm',
+      choices=TRAINERS, help="The model to train (defaults to %(default)s)")
+  parser.add_argument('-m', '--machine', dest='machine', default=None,
+      help="The initial model", metavar="FILE")
+  parser.add_argument('-u', '--ubm', dest='ubm', default=None,
+      help="The UBM of the JFABaseMachine (isv and jfa only)", metavar="FILE")
+  parser.add_argument('-d', '--data', dest='data', default=None,
+      help="The list of training files", metavar="FILE")
+  parser.add_argument('-o', '--output', dest='output', default=None,
+      help="The file of the trained model", metavar="FILE")
+  parser.add_argument('-w', '--workdir', dest='workdir', default=None,
+      help="The directory of the partial statistics and of the intermediate models, which should be shared by all the processes", metavar="DIR")
+  parser.add_argument('-n', '--shards', dest='shards', default=1, type=int,
+      help="The number of shards of the data, i.e. of E-step processes (defaults to %(default)s)", metavar="INT")
+  parser.add_argument('-J', '--jobs', dest='jobs', default=None, type=int,
+      help="The maximum number of E-step processes running at the same time (defaults to the number of shards)", metavar="INT")
+  parser.add_argument('-j', '--threads', dest='threads', default=1, type=int,
+      help="The number of threads of each E-step process (gmm only, defaults to %(default)s)", metavar="INT")
+  parser.add_argument('-i', '--iterations', dest='iterations', default=10, type=int,
+      help="The number of EM iterations (of each of the V, U and D steps for jfa, defaults to %(default)s)", metavar="INT")
+  parser.add_argument('-c', '--convergence-threshold', dest='threshold', default=0., type=float,
+      help="The training is stopped when the relative change of the average log-likelihood is below this threshold (gmm only, defaults to %(default)s, i.e. all the iterations are run)", metavar="FLOAT")
+  parser.add_argument('-U', '--update', dest='update', default='mvw',
+      help="The GMM parameters to update: means (m), variances (v) and/or weights (w) (gmm only, defaults to %(default)s)", metavar="STR")
+  parser.add_argument('-R', '--resume', dest='resume', default=False, action='store_true',
+      help="Resumes an interrupted training from the last intermediate model of the working directory (gmm and isv only)")
+  parser.add_argument('-r', '--relevance-factor', dest='relevance_factor', default=None, type=float,
+      help="If set, V and D are initialized for ISV with this relevance factor, i.e. V=0 and D=sqrt(var(UBM)/r) (isv only)", metavar="FLOAT")
+
+  args = parser.parse_args(args=user_input)
+
+  if args.machine is None:
+    parser.error("you should give the initial model with --machine")
+  if args.data is None:
+    parser.error("you should give the list of training files with --data")
+  if args.output is None:
+    parser.error("you should give the output file with --output")
+  if args.workdir is None:
+    parser.error("you should give the working directory with --workdir")
+  if args.trainer != 'gmm' and args.ubm is None:
+    parser.error("you should give the UBM with --ubm")
+  if args.shards < 1:
+    parser.error("there should be at least one shard")
+  if args.jobs is None:
+    args.jobs = args.shards
+  if args.jobs < 1:
+    parser.error("there should be at least one job")
+  if args.resume and args.trainer == 'jfa':
+    parser.error("a jfa training cannot be resumed, as the speaker factors are not kept")
+  if not args.update or args.update.strip('mvw'):
+    parser.error("the parameters to update should be a combination of 'm', 'v' and 'w'")
+
+  return args
+
+def run(commands, jobs):
+  """Runs the commands as separate processes, with at most jobs processes
+  running at the same time. Raises a RuntimeError if any of them fails."""
+
+  pending = list(commands)
+  running = []
+  failed = []
+  while pending or running:
+    while pending and len(running) < jobs:
+      command = pending.pop(0)
+      running.append((command, subprocess.Popen(command)))
+    command, process = running.pop(0)
+    if process.wait() != 0: failed.append(command)
+  if failed:
+    raise RuntimeError("%d E-step process(es) failed, e.g. '%s'" % (len(failed), ' '.join(failed[0])))
+
+def last_model(workdir, iterations):
+  """Returns the index and the file of the last intermediate model of the
+  working directory, or (-1, None) if there is none"""
+
+  for iteration in reversed(range(iterations)):
+    model = os.path.join(workdir, 'model-%03d.hdf5' % iteration)
+    if os.path.exists(model): return iteration, model
+  return -1, None
+
+def main(user_input=None):
+
+  options = get_options(user_input)
+
+  from bob.trainer import distributed
+
+  if not os.path.exists(options.workdir): os.makedirs(options.workdir)
+  W = lambda f: os.path.join(options.workdir, f)
+
+  # The speaker factors of a previous JFA training should not be reused
+  for s in range(options.shards):
+    if os.path.exists(W('state-%03d.hdf5' % s)): os.unlink(W('state-%03d.hdf5' % s))
+
+  model = options.machine
+  first, resumed = -1, None
+  if options.resume:
+    first, resumed = last_model(options.workdir, options.iterations)
+    if resumed is not None:
+      print("Resuming after iteration %d from '%s'" % (first, resumed))
+      model = resumed
+
+  if resumed is None and options.trainer == 'isv' and options.relevance_factor is not None:
+    import bob
+    machine = distributed.load_machine('isv', model, options.ubm)
+    bob.trainer.JFABaseTrainer(machine).__initializeVD_ISV__(options.relevance_factor)
+    model = W('model-init.hdf5')
+    distributed.save_machine(machine, model)
+
+  if options.trainer == 'jfa':
+    steps = [s for s in distributed.JFA_STEPS for i in range(options.iterations)]
+  else:
+    steps = [None] * options.iterations
+
+  previous = None
+  for iteration, step in enumerate(steps):
+    if iteration <= first: continue
+
+    partials = [W('partial-%03d-%03d.hdf5' % (iteration, s)) for s in range(options.shards)]
+    commands = []
+    for s in range(options.shards):
+      command = [sys.executable, '-m', 'bob.trainer.script.em_estep',
+          '--trainer=%s' % options.trainer, '--machine=%s' % model,
+          '--data=%s' % options.data, '--shard=%d' % s,
+          '--shards=%d' % options.shards, '--output=%s' % partials[s],
+          '--iteration=%d' % iteration, '--threads=%d' % options.threads]
+      if options.ubm is not None: command.append('--ubm=%s' % options.ubm)
+      if step is not None:
+        command.extend(['--step=%s' % step, '--state=%s' % W('state-%03d.hdf5' % s)])
+      commands.append(command)
+    run(commands, options.jobs)
+
+    trainer, step, it, stats = distributed.merge(partials)
+    machine = distributed.load_machine(trainer, model, options.ubm)
+    likelihood = distributed.m_step(trainer, machine, step, stats, options.update)
+    # save_machine() writes a temporary file and renames it, such that the
+    # last model of the working directory is always complete (see --resume)
+    model = W('model-%03d.hdf5' % iteration)
+    distributed.save_machine(machine, model)
+    for p in partials: os.unlink(p)
+
+    if likelihood is not None:
+      print("Iteration %d: average log-likelihood %.10g" % (iteration, likelihood))
+      if previous is not None and options.threshold > 0. and \
+          abs((previous - likelihood) / previous) < options.threshold:
+        break
+      previous = likelihood
+
+  shutil.copy(model, options.output)
+
+  return 0
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -101,3 +101,20 @@ class BICTrainerAndMachineTest(unittest.TestCase):
     self.assertAlmostEqual(machine(self.eval_data(0)), 0.)
     # while a positive vector should give a positive result
     self.assertTrue(machine(self.eval_data(1)) > 0.)
+
+  def test_batched(self):
+    """Tests that the batched BIC and IEC scores are identical to the single ones."""
+    numpy.random.seed(42)
+    intra_data = numpy.random.randn(50, 7)
+    extra_data = numpy.random.randn(60, 7) * 2. + 1.
+    test_data = numpy.random.randn(600, 7)
+
+    for trainer, machine in ((bob.trainer.BICTrainer(), bob.machine.BICMachine()), (bob.trainer.BICTrainer(3,4), bob.machine.BICMachine(True))):
+      trainer.train(machine, intra_data, extra_data)
+      reference = numpy.array([machine(x) for x in test_data])
+      for n_threads in (1, 3):
+        scores = machine(test_data, n_threads)
+        self.assertTrue(equals(scores, reference, 1e-10))
+        output = numpy.ndarray((600,), numpy.float64)
+        machine.forward(test_data, output, n_threads)
+        self.assertTrue(equals(output, reference, 1e-10))
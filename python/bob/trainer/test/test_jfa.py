@@ -29,6 +29,28 @@ import numpy
 def equals(x, y, epsilon):
   return (abs(x - y) < epsilon).all()
 
+def random_persons(seed, n_persons):
+  """Returns a UBM with 2 gaussians of dimension 3, random U, V (6x2) and D
+  (6) subspaces, and random GMMStats for n_persons persons of 1 to 3
+  sessions each"""
+  ubm = bob.machine.GMMMachine(2,3)
+  ubm.mean_supervector = numpy.array([0.1806, 0.0451, 0.7232, 0.3474, 0.6606, 0.3839])
+  ubm.variance_supervector = numpy.array([0.6273, 0.0216, 0.9106, 0.8006, 0.7458, 0.8131])
+  numpy.random.seed(seed)
+  u = numpy.random.uniform(0., 1., (6,2))
+  v = numpy.random.uniform(0., 1., (6,2))
+  d = numpy.random.uniform(0., 1., (6,))
+  persons = []
+  for i in range(n_persons):
+    person = []
+    for h in range(i % 3 + 1):
+      gs = bob.machine.GMMStats(2,3)
+      gs.n = numpy.random.uniform(0.1, 1., (2,))
+      gs.sum_px = numpy.random.uniform(0., 1., (2,3))
+      person.append(gs)
+    persons.append(person)
+  return ubm, u, v, d, persons
+
 class JFATrainerTest(unittest.TestCase):
   """Performs various JFA trainer tests."""
   
@@ -535,3 +557,184 @@ class JFATrainerTest(unittest.TestCase):
     gse = [gse1, gse2]
     jfatrainer.enrol(gse, 5)
     self.assertTrue( numpy.allclose(jfamachine.z, z_ref, eps) )
+
+  def test10_MultiThreaded(self):
+    # The speaker factors do not depend on the number of threads, and the
+    # trainings are identical for a given number of threads
+
+    F = numpy.array([0.3833, 0.6173, 0.5755, 0.5301, 0.2751, 0.2486, 0.4516,
+      0.2277, 0.8044, 0.9861, 0.0300, 0.5357, 0.0871, 0.8021, 0.9891, 0.0669,
+      0.9394, 0.0182, 0.6838, 0.7837, 0.5341, 0.8854, 0.8990,
+      0.6259]).reshape(4,6)
+    N = numpy.array([0.1379, 0.2178, 0.1821, 0.0418, 0.1069, 0.6164, 0.9397,
+      0.3545]).reshape(4,2)
+    m = numpy.array([0.1806, 0.0451, 0.7232, 0.3474, 0.6606, 0.3839])
+    E = numpy.array([0.6273, 0.0216, 0.9106, 0.8006, 0.7458, 0.8131])
+    d = numpy.array([0.4106, 0.9843, 0.9456, 0.6766, 0.9883, 0.7668])
+    v = numpy.array([0.3367, 0.6624, 0.2442, 0.2955, 0.6802, 0.5278, 0.4116,
+      0.6026, 0.7505, 0.5835, 0.5518, 0.5836]).reshape(2,6)
+    u = numpy.array([0.5118, 0.0826, 0.7196, 0.9962, 0.3545, 0.9713, 0.3464,
+      0.8865, 0.4547, 0.4134, 0.2177, 0.1257]).reshape(2,6)
+    z = numpy.array([0.3089, 0.7261, 0.7829, 0.6938, 0.0098, 0.8432, 0.9223,
+      0.7710, 0.0427, 0.3782, 0.7043, 0.7295]).reshape(2,6)
+    y = numpy.array([0.2243, 0.2691, 0.6730, 0.4775]).reshape(2,2)
+    x = numpy.array([0.9976, 0.1375, 0.8116, 0.3900, 0.4857, 0.9274, 0.8944,
+      0.9175]).reshape(4,2)
+    spk_ids = numpy.array([0,0,1,1], 'uint32')
+
+    x1 = numpy.ndarray((4,2), 'float64')
+    x2 = numpy.ndarray((4,2), 'float64')
+    bob.trainer.jfa_estimate_x_and_u(F,N,m,E,d,v,u,z,y,x1,spk_ids)
+    bob.trainer.jfa_estimate_x_and_u(F,N,m,E,d,v,u,z,y,x2,spk_ids,2)
+    self.assertTrue( (x1 == x2).all() )
+    y1 = numpy.ndarray((2,2), 'float64')
+    y2 = numpy.ndarray((2,2), 'float64')
+    bob.trainer.jfa_estimate_y_and_v(F,N,m,E,d,v,u,z,y1,x,spk_ids)
+    bob.trainer.jfa_estimate_y_and_v(F,N,m,E,d,v,u,z,y2,x,spk_ids,2)
+    self.assertTrue( (y1 == y2).all() )
+    z1 = numpy.ndarray((2,6), 'float64')
+    z2 = numpy.ndarray((2,6), 'float64')
+    bob.trainer.jfa_estimate_z_and_d(F,N,m,E,d,v,u,z1,y,x,spk_ids)
+    bob.trainer.jfa_estimate_z_and_d(F,N,m,E,d,v,u,z2,y,x,spk_ids,2)
+    self.assertTrue( (z1 == z2).all() )
+
+    # Trains ISV and JFA with several persons
+    ubm, u, v, d, vec = random_persons(1, 5)
+
+    def train_isv(n_threads):
+      jfam = bob.machine.JFABaseMachine(ubm,2)
+      jfam.u = u
+      jfat = bob.trainer.JFABaseTrainer(jfam)
+      jfat.n_threads = n_threads
+      jfat.train_isv_no_init(vec, 5, 4)
+      return jfam
+
+    def train_jfa(n_threads):
+      jfam = bob.machine.JFABaseMachine(ubm,2,2)
+      jfam.u = u
+      jfam.v = v
+      jfam.d = d
+      jfat = bob.trainer.JFABaseTrainer(jfam)
+      jfat.n_threads = n_threads
+      jfat.train_no_init(vec, 3)
+      return jfam
+
+    isv1 = train_isv(1)
+    jfa1 = train_jfa(1)
+    for n_threads in (2, 3, 8):
+      isv = train_isv(n_threads)
+      self.assertTrue( numpy.allclose(isv.u, isv1.u, 1e-10) )
+      self.assertTrue( numpy.allclose(isv.d, isv1.d, 1e-10) )
+      self.assertTrue( (isv.u == train_isv(n_threads).u).all() )
+      jfa = train_jfa(n_threads)
+      self.assertTrue( numpy.allclose(jfa.u, jfa1.u, 1e-10) )
+      self.assertTrue( numpy.allclose(jfa.v, jfa1.v, 1e-10) )
+      self.assertTrue( numpy.allclose(jfa.d, jfa1.d, 1e-10) )
+      self.assertTrue( (jfa.v == train_jfa(n_threads).v).all() )
+
+  def test11_TrainingStats(self):
+    # Trains ISV and JFA from the contiguous statistics
+    import tempfile, shutil
+    ubm, u, v, d, vec = random_persons(2, 4)
+
+    stats = bob.trainer.JFATrainingStats(2, 3)
+    for client in vec: stats.add_person(client)
+    self.assertEqual(len(stats), 4)
+    self.assertEqual(stats.n_sessions, 7)
+    self.assertEqual(stats.offsets, (0, 1, 3, 6, 7))
+    self.assertTrue( (stats.n[3] == vec[2][0].n).all() )
+    self.assertTrue( (stats.f[3] == vec[2][0].sum_px.flatten()).all() )
+    self.assertRaises(RuntimeError, stats.add_person, [bob.machine.GMMStats(3,3)])
+
+    def train(data, isv):
+      jfam = bob.machine.JFABaseMachine(ubm, 2) if isv else bob.machine.JFABaseMachine(ubm, 2, 2)
+      jfam.u = u
+      if not isv:
+        jfam.v = v
+        jfam.d = d
+      jfat = bob.trainer.JFABaseTrainer(jfam)
+      if isv: jfat.train_isv_no_init(data, 5, 4)
+      else: jfat.train_no_init(data, 3)
+      return jfam
+
+    for isv in (True, False):
+      ref = train(vec, isv)
+      jfam = train(stats, isv)
+      self.assertTrue( (jfam.u == ref.u).all() )
+      self.assertTrue( (jfam.v == ref.v).all() )
+      self.assertTrue( (jfam.d == ref.d).all() )
+
+    # Single precision storage of the first order statistics
+    stats_float = bob.trainer.JFATrainingStats(2, 3, True)
+    for client in vec: stats_float.add_person(client)
+    self.assertTrue(stats_float.use_float)
+    self.assertTrue( numpy.allclose(stats_float.f, stats.f, 1e-6, 1e-6) )
+    jfam = train(stats_float, False)
+    self.assertTrue( numpy.allclose(jfam.v, ref.v, 1e-4, 1e-4) )
+
+    # Loading from the HDF5 files of the GMMStats
+    workdir = tempfile.mkdtemp()
+    try:
+      files = []
+      for i, client in enumerate(vec):
+        files.append([])
+        for h, gs in enumerate(client):
+          filename = os.path.join(workdir, 'stats-%d-%d.hdf5' % (i, h))
+          gs.save(bob.io.HDF5File(filename, 'w'))
+          files[-1].append(filename)
+      loaded = bob.trainer.JFATrainingStats(2, 3)
+      loaded.load(files)
+      self.assertEqual(loaded.offsets, stats.offsets)
+      self.assertTrue( (loaded.n == stats.n).all() )
+      self.assertTrue( (loaded.f == stats.f).all() )
+      # A missing file does not leave a partial person
+      self.assertRaises(RuntimeError, loaded.add_person, [files[0][0], os.path.join(workdir, 'missing.hdf5')])
+      self.assertEqual(len(loaded), 4)
+      self.assertEqual(loaded.n_sessions, 7)
+    finally:
+      shutil.rmtree(workdir)
+
+  def test12_BatchEnrol(self):
+    # Enrols several clients at once, and compares to the enrolment of each
+    # of them with a JFATrainer
+    ubm, u, v, d, clients = random_persons(3, 5)
+    jfam = bob.machine.JFABaseMachine(ubm, 2, 2)
+    jfam.u = u
+    jfam.v = v
+    jfam.d = d
+
+    y_ref = []
+    z_ref = []
+    for client in clients:
+      machine = bob.machine.JFAMachine(jfam)
+      bob.trainer.JFATrainer(machine, bob.trainer.JFABaseTrainer(jfam)).enrol(client, 5)
+      y_ref.append(machine.y)
+      z_ref.append(machine.z)
+
+    stats = bob.trainer.JFATrainingStats(2, 3)
+    for client in clients: stats.add_person(client)
+    for n_threads in (1, 3):
+      jfat = bob.trainer.JFABaseTrainer(jfam)
+      jfat.n_threads = n_threads
+      jfat.enrol(stats, 5)
+      for i in range(len(clients)):
+        self.assertTrue( numpy.allclose(jfat.y[i], y_ref[i], 1e-10, 1e-10) )
+        self.assertTrue( numpy.allclose(jfat.z[i], z_ref[i], 1e-10, 1e-10) )
+
+      # The models should be attached to the base machine of the trainer
+      other = bob.machine.JFABaseMachine(jfam)
+      models = [bob.machine.JFAMachine(other) for client in clients]
+      self.assertRaises(RuntimeError, jfat.enrol, stats, models, 5)
+      models = [bob.machine.JFAMachine(jfam) for client in clients]
+      jfat.enrol(stats, models, 5)
+      for i, machine in enumerate(models):
+        self.assertTrue( numpy.allclose(machine.y, y_ref[i], 1e-10, 1e-10) )
+        self.assertTrue( numpy.allclose(machine.z, z_ref[i], 1e-10, 1e-10) )
+
+      bank = bob.machine.ModelBank(jfam)
+      ids = numpy.array([10, 11, 12, 13, 14], 'int64')
+      jfat.enrol(stats, ids, bank, 5)
+      self.assertEqual(len(bank), len(clients))
+      for i in range(len(clients)):
+        self.assertTrue( numpy.allclose(bank.get_field('y', ids[i]), y_ref[i], 1e-10, 1e-10) )
+        self.assertTrue( numpy.allclose(bank.get_field('z', ids[i]), z_ref[i], 1e-10, 1e-10) )
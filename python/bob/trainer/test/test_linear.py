@@ -189,3 +189,39 @@ class LinearTest(unittest.TestCase):
     T.m_step(m, ar)
     llh2 = T.compute_likelihood(m)
     self.assertTrue( abs(exp_llh2 - llh2) < 2e-4)
+
+  def test04_ppca_multithreaded(self):
+
+    # The sharded E-step of the Probabilistic PCA trainer gives the same
+    # likelihoods and machine as the serial one
+    ar=numpy.array([
+      [1, 2, 3],
+      [2, 4, 19],
+      [3, 6, 5],
+      [4, 8, 13],
+      [5, 1, 7],
+      ], dtype='float64')
+    w_init = numpy.array([1.62945, 0.270954, 1.81158, 1.67002, 0.253974,
+      1.93774], 'float64').reshape(3,2)
+
+    def two_iterations(n_threads):
+      T = bob.trainer.EMPCATrainer(2)
+      T.n_threads = n_threads
+      m = bob.machine.LinearMachine()
+      T.initialization(m, ar)
+      m.weights = w_init
+      T.sigma2 = 1.82675
+      llh = []
+      for i in range(2):
+        T.e_step(m, ar)
+        T.m_step(m, ar)
+        llh.append(T.compute_likelihood(m))
+      return m, T.sigma2, llh
+
+    m1, sigma2_1, llh1 = two_iterations(1)
+    for n_threads in (2, 3, 8):
+      m, sigma2, llh = two_iterations(n_threads)
+      self.assertTrue( numpy.allclose(m.weights, m1.weights, 1e-10, 1e-10) )
+      self.assertTrue( abs(sigma2 - sigma2_1) < 1e-10 )
+      for l, l1 in zip(llh, llh1):
+        self.assertTrue( abs(l - l1) < 1e-8 )
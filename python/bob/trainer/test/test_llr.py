@@ -21,6 +21,8 @@
 """
 
 import os, sys
+import shutil
+import tempfile
 import unittest
 import bob
 import random
@@ -89,3 +91,46 @@ class LLRTest(unittest.TestCase):
     self.assertTrue( (abs(machine2.biases - bias_ref) < 2e-4).all() )
     self.assertTrue( abs(machine2(feat1) - out1) < 2e-4 )
     self.assertTrue( abs(machine2(feat2) - out2) < 2e-4 )
+
+  def test02_llr_parallel_streamed(self):
+
+    # Overlapping classes, such that the optimum is finite
+    rng = numpy.random.RandomState(3)
+    ar1 = rng.normal(1., 1., (50, 3))
+    ar2 = rng.normal(0., 1., (70, 3))
+
+    T = bob.trainer.LLRTrainer(0.3, 1e-10, 1000)
+    ref = T.train(ar1, ar2)
+
+    # The samples split across several threads
+    T.n_threads = 3
+    self.assertEqual(T.n_threads, 3)
+    machine = T.train(ar1, ar2)
+    self.assertTrue( (abs(machine.weights - ref.weights) < 1e-8).all() )
+    self.assertTrue( (abs(machine.biases - ref.biases) < 1e-8).all() )
+
+    # The samples streamed by two samplers
+    workdir = tempfile.mkdtemp()
+    try:
+      files1 = [os.path.join(workdir, 'class1-%d.hdf5' % i) for i in range(2)]
+      files2 = [os.path.join(workdir, 'class2.hdf5')]
+      bob.io.save(ar1[:20], files1[0])
+      bob.io.save(ar1[20:], files1[1])
+      bob.io.save(ar2, files2[0])
+      sampler1 = bob.trainer.HDF5BlockSampler(files1, "array", 7)
+      sampler2 = bob.trainer.HDF5BlockSampler(files2, "array", 11)
+      machine = bob.machine.LinearMachine()
+      T.train(machine, sampler1, sampler2)
+      self.assertTrue( (abs(machine.weights - ref.weights) < 1e-8).all() )
+      self.assertTrue( (abs(machine.biases - ref.biases) < 1e-8).all() )
+
+      # L-BFGS converges to the same optimum
+      T.use_lbfgs = True
+      T.convergence_threshold = 1e-8
+      T.max_iterations = 0
+      machine = bob.machine.LinearMachine()
+      T.train(machine, sampler1, sampler2)
+      self.assertTrue( (abs(machine.weights - ref.weights) < 1e-4).all() )
+      self.assertTrue( (abs(machine.biases - ref.biases) < 1e-4).all() )
+    finally:
+      shutil.rmtree(workdir)
@@ -335,3 +335,69 @@ class PLDATrainerTest(unittest.TestCase):
     llr_ref = -4.43695386675
     llr = m.forward(x3)
     self.assertTrue(abs(llr - llr_ref) < 1e-10)
+
+  def test04_plda_batch_enrollment(self):
+    # Enrols several clients at once, and compares to the enrolment of each
+    # of them with a PLDATrainer
+    D = 7
+    nf = 2
+    ng = 3
+    numpy.random.seed(4)
+    mb = bob.machine.PLDABaseMachine(D,nf,ng)
+    mb.sigma = 0.01 * numpy.ones((D,), 'float64')
+    mb.g = numpy.random.normal(0., 1., (D,ng))
+    mb.f = numpy.random.normal(0., 1., (D,nf))
+    mb.mu = numpy.random.uniform(0., 1., (D,))
+    clients = [numpy.random.uniform(0., 1., (i % 3 + 1, D)) for i in range(5)]
+    probe = numpy.random.uniform(0., 1., (D,))
+
+    refs = []
+    for client in clients:
+      m = bob.machine.PLDAMachine(mb)
+      bob.trainer.PLDATrainer(m).enrol(client)
+      refs.append(m)
+
+    for n_threads in (1, 3):
+      models = [bob.machine.PLDAMachine(mb) for client in clients]
+      bob.trainer.plda_enrol(mb, clients, models, n_threads)
+      for m, ref in zip(models, refs):
+        self.assertEqual(m.n_samples, ref.n_samples)
+        self.assertTrue(numpy.allclose(m.weighted_sum, ref.weighted_sum, 1e-10, 1e-10))
+        self.assertTrue(abs(m.w_sum_xit_beta_xi - ref.w_sum_xit_beta_xi) < 1e-10)
+        self.assertTrue(abs(m.log_likelihood - ref.log_likelihood) < 1e-10)
+        self.assertTrue(abs(m.forward(probe) - ref.forward(probe)) < 1e-10)
+
+      bank = bob.machine.ModelBank(mb)
+      ids = numpy.array([3, 1, 4, 5, 9], 'int64')
+      bob.trainer.plda_enrol(mb, clients, ids, bank, n_threads)
+      for i, ref in enumerate(refs):
+        self.assertTrue(numpy.allclose(bank.get_field('weighted_sum', ids[i]), ref.weighted_sum, 1e-10, 1e-10))
+        self.assertTrue(abs(bank.get_field('log_likelihood', ids[i])[0] - ref.log_likelihood) < 1e-10)
+
+    # The models should be attached to the given base machine
+    other = bob.machine.PLDABaseMachine(mb)
+    self.assertRaises(RuntimeError, bob.trainer.plda_enrol, other, clients, [bob.machine.PLDAMachine(mb) for client in clients])
+
+  def test05_plda_EM_multithreaded(self):
+    # The training split across several threads gives the same results as
+    # the serial one (up to the order of the summations)
+    D = 7
+    nf = 2
+    ng = 3
+    numpy.random.seed(5)
+    data = [numpy.random.normal(0., 1., (i % 4 + 1, D)) for i in range(11)]
+
+    machines = []
+    for n_threads in (1, 4):
+      t = bob.trainer.PLDABaseTrainer(nf, ng)
+      t.seed = 7
+      t.max_iterations = 5
+      t.n_threads = n_threads
+      self.assertEqual(t.n_threads, n_threads)
+      m = bob.machine.PLDABaseMachine(D, nf, ng)
+      t.train(m, data)
+      machines.append((m, t.z_second_order_sum))
+    self.assertTrue(equals(machines[0][0].f, machines[1][0].f, 1e-10))
+    self.assertTrue(equals(machines[0][0].g, machines[1][0].g, 1e-10))
+    self.assertTrue(equals(machines[0][0].sigma, machines[1][0].sigma, 1e-10))
+    self.assertTrue(equals(machines[0][1], machines[1][1], 1e-8))
@@ -0,0 +1,170 @@
+#!/usr/bin/env python
+# vim: set fileencoding=utf-8 :
+# Mon Oct 19 21:02:47 2026 +0200
+#
+# Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3 of the License.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Tests on the block samplers and on the out-of-core EM training
+"""
+
+import os, sys
+import unittest
+import tempfile
+import bob
+import numpy
+import pkg_resources
+
+def F(f):
+  """Returns the test file on the "data" subdirectory"""
+  return pkg_resources.resource_filename(__name__, os.path.join('data', f))
+
+def loadGMM():
+  gmm = bob.machine.GMMMachine(2, 2)
+
+  gmm.weights = bob.io.load(F('gmm.init_weights.hdf5'))
+  gmm.means = bob.io.load(F('gmm.init_means.hdf5'))
+  gmm.variances = bob.io.load(F('gmm.init_variances.hdf5'))
+  gmm.variance_threshold = numpy.array([0.001, 0.001], 'float64')
+
+  return gmm
+
+def equals(x, y, epsilon):
+  return (abs(x - y) < epsilon).all()
+
+def split(ar):
+  """Splits the rows of ar in three parts of different sizes"""
+  return [ar[:100], ar[100:101], ar[101:]]
+
+def write_hdf5(ar):
+  """Writes the data as a 2D array, a float32 2D array and appended rows"""
+  parts = split(ar)
+  filenames = [str(tempfile.mkstemp(".hdf5")[1]) for p in parts]
+  bob.io.HDF5File(filenames[0], 'w').set('array', parts[0])
+  bob.io.HDF5File(filenames[1], 'w').set('array', parts[1].astype('float32'))
+  f = bob.io.HDF5File(filenames[2], 'w')
+  for row in parts[2]: f.append('array', row)
+  del f
+  return filenames
+
+def write_binary(ar, dtype):
+  """Writes the data as raw binary files"""
+  filenames = []
+  for p in split(ar):
+    filename = str(tempfile.mkstemp(".bin")[1])
+    p.astype(dtype).tofile(filename)
+    filenames.append(filename)
+  return filenames
+
+def read_all(sampler):
+  blocks = []
+  while True:
+    block = sampler.next()
+    if block is None: break
+    blocks.append(block)
+  return blocks
+
+class BlockSamplerTest(unittest.TestCase):
+  """Performs various tests on the block samplers."""
+
+  def test01_hdf5(self):
+
+    ar = bob.io.load(F("faithful.torch3_f64.hdf5"))
+    filenames = write_hdf5(ar)
+    ref = ar.copy()
+    ref[100] = ar[100].astype('float32')
+
+    for read_ahead in (False, True):
+      s = bob.trainer.HDF5BlockSampler(filenames, "array", 64, read_ahead)
+      self.assertEqual(len(s), ar.shape[0])
+      self.assertEqual(s.n_inputs, ar.shape[1])
+      self.assertEqual(s.block_size, 64)
+      self.assertEqual(s.filenames, tuple(filenames))
+      for loop in range(2):
+        blocks = read_all(s)
+        self.assertEqual(len(blocks), (ar.shape[0] + 63) // 64)
+        self.assertTrue((numpy.vstack(blocks) == ref).all())
+        self.assertTrue(s.next() is None)
+        s.reset()
+      for i in (0, 99, 100, 101, ar.shape[0]-1):
+        self.assertTrue((s.sample(i) == ref[i]).all())
+      self.assertRaises(RuntimeError, s.sample, ar.shape[0])
+
+    for filename in filenames: os.unlink(filename)
+
+  def test02_binary(self):
+
+    ar = bob.io.load(F("faithful.torch3_f64.hdf5"))
+    for single_precision, dtype in ((False, 'float64'), (True, 'float32')):
+      filenames = write_binary(ar, dtype)
+      ref = ar.astype(dtype).astype('float64')
+      s = bob.trainer.BinaryBlockSampler(filenames, ar.shape[1], single_precision, 50)
+      self.assertEqual(len(s), ar.shape[0])
+      blocks = read_all(s)
+      self.assertTrue((numpy.vstack(blocks) == ref).all())
+      self.assertTrue((s.sample(150) == ref[150]).all())
+      for filename in filenames: os.unlink(filename)
+
+    # The size of the files should be a multiple of the size of a sample
+    filenames = write_binary(ar, 'float64')
+    self.assertRaises(RuntimeError, bob.trainer.BinaryBlockSampler, filenames, 3)
+    for filename in filenames: os.unlink(filename)
+
+  def test03_train(self):
+
+    # The training on the streamed samples gives the same results as the
+    # training on the whole array (up to the order of the summations)
+    ar = bob.io.load(F("faithful.torch3_f64.hdf5"))
+    filenames = write_binary(ar, 'float64')
+
+    for n_threads in (1, 2):
+      s = bob.trainer.BinaryBlockSampler(filenames, ar.shape[1], False, 37)
+
+      gmm_ref = loadGMM()
+      trainer = bob.trainer.ML_GMMTrainer(True, True, True)
+      trainer.train(gmm_ref, ar)
+      gmm = loadGMM()
+      trainer = bob.trainer.ML_GMMTrainer(True, True, True)
+      trainer.n_threads = n_threads
+      trainer.train(gmm, s)
+      self.assertTrue(equals(gmm.means, gmm_ref.means, 1e-8))
+      self.assertTrue(equals(gmm.variances, gmm_ref.variances, 1e-8))
+      self.assertTrue(equals(gmm.weights, gmm_ref.weights, 1e-8))
+
+      kmeans_ref = bob.machine.KMeansMachine(2, 2)
+      trainer = bob.trainer.KMeansTrainer()
+      trainer.seed = 1337
+      trainer.train(kmeans_ref, ar)
+      kmeans = bob.machine.KMeansMachine(2, 2)
+      trainer = bob.trainer.KMeansTrainer()
+      trainer.seed = 1337
+      trainer.n_threads = n_threads
+      trainer.train(kmeans, s)
+      self.assertTrue(equals(kmeans.means, kmeans_ref.means, 1e-8))
+
+      # EM for PPCA, from the same (random) initialization
+      machines = []
+      for data in (ar, s):
+        T = bob.trainer.EMPCATrainer(1, 0., 3, False)
+        T.seed = 7
+        T.n_threads = n_threads
+        m = bob.machine.LinearMachine()
+        T.train(m, data)
+        machines.append((m, T.sigma2))
+      # (the EMPCATrainer stores the mean of the data in input_divide)
+      self.assertTrue(equals(machines[0][0].input_divide, machines[1][0].input_divide, 1e-8))
+      self.assertTrue(equals(machines[0][0].weights, machines[1][0].weights, 1e-8))
+      self.assertTrue(abs(machines[0][1] - machines[1][1]) < 1e-8)
+
+    for filename in filenames: os.unlink(filename)
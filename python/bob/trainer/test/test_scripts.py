@@ -0,0 +1,195 @@
+#!/usr/bin/env python
+# vim: set fileencoding=utf-8 :
+# Mon Oct 19 21:48:12 2026 +0200
+#
+# Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3 of the License.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Script tests for bob.trainer (multi-process EM training)
+"""
+
+import os
+import shutil
+import tempfile
+import unittest
+import bob
+import numpy
+import pkg_resources
+
+def F(f):
+  """Returns the test file on the "data" subdirectory"""
+  return pkg_resources.resource_filename(__name__, os.path.join('data', f))
+
+def loadGMM():
+  gmm = bob.machine.GMMMachine(2, 2)
+
+  gmm.weights = bob.io.load(F('gmm.init_weights.hdf5'))
+  gmm.means = bob.io.load(F('gmm.init_means.hdf5'))
+  gmm.variances = bob.io.load(F('gmm.init_variances.hdf5'))
+  gmm.variance_threshold = numpy.array([0.001, 0.001], 'float64')
+
+  return gmm
+
+def jfa_data():
+  """Returns the statistics and the UBM of the JFA trainer tests"""
+
+  F1 = numpy.array( [0.3833, 0.4516, 0.6173, 0.2277, 0.5755, 0.8044, 0.5301,
+    0.9861, 0.2751, 0.0300, 0.2486, 0.5357]).reshape((6,2))
+  F2 = numpy.array( [0.0871, 0.6838, 0.8021, 0.7837, 0.9891, 0.5341, 0.0669,
+    0.8854, 0.9394, 0.8990, 0.0182, 0.6259]).reshape((6,2))
+  N1 = numpy.array([0.1379, 0.1821, 0.2178, 0.0418]).reshape((2,2))
+  N2 = numpy.array([0.1069, 0.9397, 0.6164, 0.3545]).reshape((2,2))
+
+  vec = []
+  for N, F in ((N1, F1), (N2, F2)):
+    client = []
+    for h in range(2):
+      gs = bob.machine.GMMStats(2,3)
+      gs.n = N[:,h]
+      gs.sum_px = F[:,h].reshape(2,3)
+      client.append(gs)
+    vec.append(client)
+
+  ubm = bob.machine.GMMMachine(2,3)
+  ubm.mean_supervector = numpy.array([0.1806, 0.0451, 0.7232, 0.3474, 0.6606, 0.3839])
+  ubm.variance_supervector = numpy.array([0.6273, 0.0216, 0.9106, 0.8006, 0.7458, 0.8131])
+  return vec, ubm
+
+class DistributedEMTest(unittest.TestCase):
+  """Performs multi-process EM trainings, and compares them to the
+  single-process ones."""
+
+  def setUp(self):
+    self.workdir = tempfile.mkdtemp()
+
+  def tearDown(self):
+    shutil.rmtree(self.workdir)
+
+  def W(self, f):
+    return os.path.join(self.workdir, f)
+
+  def write_jfa_data(self):
+    vec, ubm = jfa_data()
+    ubm.save(bob.io.HDF5File(self.W('ubm.hdf5'), 'w'))
+    lst = open(self.W('stats.lst'), 'wt')
+    for i, client in enumerate(vec):
+      for h, gs in enumerate(client):
+        filename = self.W('stats-%d-%d.hdf5' % (i, h))
+        gs.save(bob.io.HDF5File(filename, 'w'))
+        lst.write('client%d %s\n' % (i, filename))
+    lst.close()
+    return vec, ubm
+
+  def test01_gmm(self):
+
+    ar = bob.io.load(F("faithful.torch3_f64.hdf5"))
+    lst = open(self.W('features.lst'), 'wt')
+    for i, part in enumerate((ar[:100], ar[100:101], ar[101:])):
+      bob.io.save(part, self.W('features-%d.hdf5' % i))
+      lst.write(self.W('features-%d.hdf5' % i) + '\n')
+    lst.close()
+    loadGMM().save(bob.io.HDF5File(self.W('init.hdf5'), 'w'))
+
+    gmm_ref = loadGMM()
+    trainer = bob.trainer.ML_GMMTrainer(True, True, True)
+    trainer.max_iterations = 4
+    trainer.convergence_threshold = 0.
+    trainer.train(gmm_ref, ar)
+
+    from bob.trainer.script.em_train import main
+    cmdline = '--trainer=gmm --machine=%s --data=%s --shards=3 --jobs=2 --iterations=4 --workdir=%s --output=%s' % (self.W('init.hdf5'), self.W('features.lst'), self.W('work'), self.W('gmm.hdf5'))
+    self.assertEqual(main(cmdline.split()), 0)
+    gmm = bob.machine.GMMMachine(bob.io.HDF5File(self.W('gmm.hdf5')))
+    self.assertTrue(numpy.allclose(gmm.means, gmm_ref.means, 1e-8, 1e-8))
+    self.assertTrue(numpy.allclose(gmm.variances, gmm_ref.variances, 1e-8, 1e-8))
+    self.assertTrue(numpy.allclose(gmm.weights, gmm_ref.weights, 1e-8, 1e-8))
+
+    # A single iteration with the E-step and M-step tools; the partial files
+    # are merged in shard order, whatever the order on the command line
+    from bob.trainer.script.em_estep import main as estep
+    from bob.trainer.script.em_mstep import main as mstep
+    for s in range(2):
+      cmdline = '--machine=%s --data=%s --shard=%d --shards=2 --output=%s' % (self.W('init.hdf5'), self.W('features.lst'), s, self.W('partial-%d.hdf5' % s))
+      self.assertEqual(estep(cmdline.split()), 0)
+    cmdline = '--machine=%s --output=%s %s %s' % (self.W('init.hdf5'), self.W('next.hdf5'), self.W('partial-1.hdf5'), self.W('partial-0.hdf5'))
+    self.assertEqual(mstep(cmdline.split()), 0)
+
+    gmm_ref = loadGMM()
+    trainer = bob.trainer.ML_GMMTrainer(True, True, True)
+    trainer.initialization(gmm_ref, ar)
+    trainer.e_step(gmm_ref, ar)
+    trainer.m_step(gmm_ref, ar)
+    gmm = bob.machine.GMMMachine(bob.io.HDF5File(self.W('next.hdf5')))
+    self.assertTrue(numpy.allclose(gmm.means, gmm_ref.means, 1e-8, 1e-8))
+
+    # Partial files of different shardings cannot be merged
+    cmdline = '--machine=%s --data=%s --shard=0 --shards=3 --output=%s' % (self.W('init.hdf5'), self.W('features.lst'), self.W('partial-0.hdf5'))
+    self.assertEqual(estep(cmdline.split()), 0)
+    cmdline = '--machine=%s --output=%s %s %s' % (self.W('init.hdf5'), self.W('next.hdf5'), self.W('partial-0.hdf5'), self.W('partial-1.hdf5'))
+    self.assertRaises(RuntimeError, mstep, cmdline.split())
+
+  def test02_isv(self):
+
+    vec, ubm = self.write_jfa_data()
+    u = numpy.array([0.5118, 0.3464, 0.0826, 0.8865, 0.7196, 0.4547, 0.9962,
+      0.4134, 0.3545, 0.2177, 0.9713, 0.1257]).reshape((6,2))
+    jfam = bob.machine.JFABaseMachine(ubm, 2)
+    jfam.u = u
+    jfam.save(bob.io.HDF5File(self.W('init.hdf5'), 'w'))
+
+    jfam_ref = bob.machine.JFABaseMachine(ubm, 2)
+    jfam_ref.u = u
+    bob.trainer.JFABaseTrainer(jfam_ref).train_isv_no_init(vec, 5, 4)
+
+    from bob.trainer.script.em_train import main
+    cmdline = '--trainer=isv --machine=%s --ubm=%s --relevance-factor=4 --data=%s --shards=2 --iterations=5 --workdir=%s --output=%s' % (self.W('init.hdf5'), self.W('ubm.hdf5'), self.W('stats.lst'), self.W('work'), self.W('isv.hdf5'))
+    self.assertEqual(main(cmdline.split()), 0)
+    jfam = bob.machine.JFABaseMachine(bob.io.HDF5File(self.W('isv.hdf5')))
+    self.assertTrue(numpy.allclose(jfam.u, jfam_ref.u, 1e-8, 1e-8))
+    self.assertTrue(numpy.allclose(jfam.d, jfam_ref.d, 1e-8, 1e-8))
+
+    # An interrupted training (here after 3 iterations) is resumed from the
+    # last intermediate model
+    cmdline = '--trainer=isv --machine=%s --ubm=%s --relevance-factor=4 --data=%s --shards=2 --iterations=3 --workdir=%s --output=%s' % (self.W('init.hdf5'), self.W('ubm.hdf5'), self.W('stats.lst'), self.W('resumed'), self.W('isv-3.hdf5'))
+    self.assertEqual(main(cmdline.split()), 0)
+    cmdline = '--trainer=isv --machine=%s --ubm=%s --relevance-factor=4 --data=%s --shards=2 --iterations=5 --workdir=%s --output=%s --resume' % (self.W('init.hdf5'), self.W('ubm.hdf5'), self.W('stats.lst'), self.W('resumed'), self.W('isv-5.hdf5'))
+    self.assertEqual(main(cmdline.split()), 0)
+    jfam = bob.machine.JFABaseMachine(bob.io.HDF5File(self.W('isv-5.hdf5')))
+    self.assertTrue(numpy.allclose(jfam.u, jfam_ref.u, 1e-8, 1e-8))
+    self.assertTrue(numpy.allclose(jfam.d, jfam_ref.d, 1e-8, 1e-8))
+
+  def test03_jfa(self):
+
+    vec, ubm = self.write_jfa_data()
+    d = numpy.array([0.4106, 0.9843, 0.9456, 0.6766, 0.9883, 0.7668])
+    v = numpy.array( [0.3367, 0.4116, 0.6624, 0.6026, 0.2442, 0.7505, 0.2955,
+      0.5835, 0.6802, 0.5518, 0.5278,0.5836]).reshape((6,2))
+    u = numpy.array( [0.5118, 0.3464, 0.0826, 0.8865, 0.7196, 0.4547, 0.9962,
+      0.4134, 0.3545, 0.2177, 0.9713, 0.1257]).reshape((6,2))
+    jfam = bob.machine.JFABaseMachine(ubm, 2, 2)
+    jfam.u = u
+    jfam.v = v
+    jfam.d = d
+    jfam.save(bob.io.HDF5File(self.W('init.hdf5'), 'w'))
+
+    jfam_ref = bob.machine.JFABaseMachine(jfam)
+    bob.trainer.JFABaseTrainer(jfam_ref).train_no_init(vec, 3)
+
+    from bob.trainer.script.em_train import main
+    cmdline = '--trainer=jfa --machine=%s --ubm=%s --data=%s --shards=2 --iterations=3 --workdir=%s --output=%s' % (self.W('init.hdf5'), self.W('ubm.hdf5'), self.W('stats.lst'), self.W('work'), self.W('jfa.hdf5'))
+    self.assertEqual(main(cmdline.split()), 0)
+    jfam = bob.machine.JFABaseMachine(bob.io.HDF5File(self.W('jfa.hdf5')))
+    self.assertTrue(numpy.allclose(jfam.v, jfam_ref.v, 1e-8, 1e-8))
+    self.assertTrue(numpy.allclose(jfam.u, jfam_ref.u, 1e-8, 1e-8))
+    self.assertTrue(numpy.allclose(jfam.d, jfam_ref.d, 1e-8, 1e-8))
@@ -144,3 +144,31 @@ class SvmTrainingTest(unittest.TestCase):
     curr_scores = numpy.array(curr_scores)
     prev_scores = numpy.array(prev_scores)
     #self.assertTrue( numpy.all(abs(curr_scores-prev_scores) < 1e-8) )
+
+  def test04_multiclass_training_threads(self):
+
+    # Four classes, whose one-vs-one sub-problems are split across threads
+    f = bob.machine.SVMFile(HEART_DATA)
+    labels, data = f.read_all()
+    classes = []
+    for positive in (True, False):
+      for first in (True, False):
+        classes.append(numpy.vstack([k for i,k in enumerate(data) if
+          (labels[i] > 0) == positive and (k[0] > 0) == first]))
+
+    trainer = bob.trainer.SVMTrainer()
+    self.assertEqual(trainer.n_threads, 1)
+    previous = trainer.train(classes)
+    trainer.n_threads = 4
+    machine = trainer.train(classes)
+    self.assertEqual(machine.shape, previous.shape)
+    self.assertEqual(machine.gamma, previous.gamma)
+    self.assertEqual(machine.labels, previous.labels)
+
+    curr_labels, curr_scores = machine.predict_classes_and_scores(data)
+    prev_labels, prev_scores = previous.predict_classes_and_scores(data)
+    self.assertEqual(curr_labels, prev_labels)
+
+    curr_scores = numpy.array(curr_scores)
+    prev_scores = numpy.array(prev_scores)
+    self.assertTrue( numpy.all(abs(curr_scores - prev_scores) < 1e-8) )
@@ -20,6 +20,8 @@
 """Test trainer package
 """
 import os, sys
+import shutil
+import tempfile
 import unittest
 import bob
 import random
@@ -402,3 +404,142 @@ class TrainerTest(unittest.TestCase):
     trainer.max_iterations = 1;
     trainer.train(machine, data) # After the initialization the means are still [0.,0.] (at the C++ level)
     self.assertFalse( numpy.isnan(machine.means).any())
+
+  def test11_parallel_estep(self):
+
+    # The E-step split across several threads gives the same results as the
+    # serial one (up to the order of the summations)
+    ar = bob.io.load(F("faithful.torch3_f64.hdf5"))
+
+    kmeans = []
+    for n_threads in (1, 4):
+      machine = bob.machine.KMeansMachine(2, 2)
+      trainer = bob.trainer.KMeansTrainer()
+      trainer.n_threads = n_threads
+      self.assertEqual(trainer.n_threads, n_threads)
+      trainer.train(machine, ar)
+      kmeans.append((machine.means, trainer.average_min_distance))
+    self.assertTrue(equals(kmeans[0][0], kmeans[1][0], 1e-10))
+    self.assertTrue(abs(kmeans[0][1] - kmeans[1][1]) < 1e-10)
+
+    gmms = []
+    for n_threads in (1, 4):
+      gmm = loadGMM()
+      trainer = bob.trainer.ML_GMMTrainer(True, True, True)
+      trainer.n_threads = n_threads
+      trainer.train(gmm, ar)
+      gmms.append(gmm)
+    self.assertTrue(equals(gmms[0].means, gmms[1].means, 1e-8))
+    self.assertTrue(equals(gmms[0].variances, gmms[1].variances, 1e-8))
+    self.assertTrue(equals(gmms[0].weights, gmms[1].weights, 1e-8))
+
+  def test12_gmm_MAP_batch_enrol(self):
+
+    # Adapts several clients at once, and compares to a single MAP iteration
+    # for each of them
+    ar = bob.io.load(F("faithful.torch3_f64.hdf5"))
+    clients = [ar[:50], ar[50:51], ar[51:150], ar[150:]]
+    prior = bob.machine.GMMMachine(bob.io.HDF5File(F("gmm_ML.hdf5")))
+    stats = []
+    for data in clients:
+      gs = bob.machine.GMMStats(prior.dim_c, prior.dim_d)
+      prior.acc_statistics(data, gs)
+      stats.append(gs)
+
+    for update in ((True, True, True), (True, False, False)):
+      trainer = bob.trainer.MAP_GMMTrainer(4., update[0], update[1], update[2])
+      trainer.set_prior_gmm(prior)
+      trainer.max_iterations = 1
+      refs = []
+      for data in clients:
+        gmm = bob.machine.GMMMachine(prior)
+        trainer.train(gmm, data)
+        refs.append(gmm)
+
+      for n_threads in (1, 3):
+        models = [bob.machine.GMMMachine(prior.dim_c, prior.dim_d) for data in clients]
+        trainer.enrol(stats, models, n_threads)
+        for gmm, ref in zip(models, refs):
+          self.assertTrue(equals(gmm.means, ref.means, 1e-10))
+          self.assertTrue(equals(gmm.variances, ref.variances, 1e-10))
+          self.assertTrue(equals(gmm.weights, ref.weights, 1e-10))
+
+    # Only the means can be stored in a bank (refs are the means-only models)
+    bank = bob.machine.ModelBank(prior)
+    ids = numpy.array([7, 8, 9, 10], 'int64')
+    trainer.enrol(stats, ids, bank, 2)
+    self.assertEqual(len(bank), len(clients))
+    for i in range(len(clients)):
+      self.assertTrue(equals(bank.get_field('mean', ids[i]), refs[i].mean_supervector, 1e-10))
+    trainer = bob.trainer.MAP_GMMTrainer(4., True, True, False)
+    trainer.set_prior_gmm(prior)
+    self.assertRaises(RuntimeError, trainer.enrol, stats, ids, bank)
+
+  def test13_checkpoint_resume(self):
+
+    # Trains a GMM for 6 iterations, and for 4 iterations followed by a
+    # training resumed from the checkpoint of the 4th iteration
+    ar = bob.io.load(F("faithful.torch3_f64.hdf5"))
+    workdir = tempfile.mkdtemp()
+    try:
+      checkpoint = os.path.join(workdir, 'checkpoint.hdf5')
+
+      iterations = []
+      gmm_ref = loadGMM()
+      trainer = bob.trainer.ML_GMMTrainer(True, True, True)
+      trainer.convergence_threshold = 0.
+      trainer.max_iterations = 6
+      trainer.set_observer(iterations.append)
+      trainer.train(gmm_ref, ar)
+      self.assertEqual([it.iteration for it in iterations], list(range(7)))
+      self.assertTrue(numpy.isnan(iterations[0].likelihood))
+      self.assertEqual(iterations[0].m_step_wall, 0.)
+      for it in iterations[1:]:
+        self.assertFalse(numpy.isnan(it.likelihood))
+        self.assertTrue(it.delta >= 0.)
+        self.assertTrue(it.e_step_wall >= 0. and it.m_step_cpu >= 0.)
+
+      gmm = loadGMM()
+      trainer = bob.trainer.ML_GMMTrainer(True, True, True)
+      trainer.convergence_threshold = 0.
+      trainer.max_iterations = 4
+      trainer.set_checkpoint(checkpoint, 2)
+      self.assertEqual(trainer.checkpoint, checkpoint)
+      self.assertEqual(trainer.checkpoint_every, 2)
+      trainer.train(gmm, ar)
+      self.assertTrue(os.path.exists(checkpoint))
+      self.assertFalse(os.path.exists(checkpoint + '.tmp'))
+
+      resumed = []
+      gmm = bob.machine.GMMMachine(2, 2)
+      trainer.set_checkpoint('')
+      trainer.set_observer(resumed.append)
+      trainer.max_iterations = 6
+      trainer.resume(gmm, ar, checkpoint)
+      self.assertEqual([it.iteration for it in resumed], [4, 5, 6])
+      self.assertTrue(abs(resumed[-1].likelihood - iterations[-1].likelihood) < 1e-10)
+      self.assertTrue(equals(gmm.means, gmm_ref.means, 1e-10))
+      self.assertTrue(equals(gmm.variances, gmm_ref.variances, 1e-10))
+      self.assertTrue(equals(gmm.weights, gmm_ref.weights, 1e-10))
+
+      # The state of an EMPCATrainer (sigma2) is saved along with the machine
+      data = numpy.random.RandomState(3).normal(0., 1., (40, 5))
+      T = bob.trainer.EMPCATrainer(2)
+      T.max_iterations = 5
+      T.convergence_threshold = 0.
+      m_ref = bob.machine.LinearMachine()
+      T.train(m_ref, data)
+      sigma2_ref = T.sigma2
+      T.max_iterations = 3
+      T.set_checkpoint(checkpoint)
+      m = bob.machine.LinearMachine()
+      T.train(m, data)
+      T.set_checkpoint('')
+      T.max_iterations = 5
+      m = bob.machine.LinearMachine()
+      T.resume(m, data, checkpoint)
+      self.assertTrue(equals(m.weights, m_ref.weights, 1e-10))
+      self.assertTrue(equals(m.input_subtract, m_ref.input_subtract, 1e-10))
+      self.assertTrue(abs(T.sigma2 - sigma2_ref) < 1e-10)
+    finally:
+      shutil.rmtree(workdir)
@@ -206,6 +206,9 @@ CONSOLE_SCRIPTS = [
   'bob_face_detect.py = bob.visioner.script.facebox:main',
   'bob_face_keypoints.py = bob.visioner.script.facepoints:main',
   'bob_visioner_trainer.py = bob.visioner.script.trainer:main',
+  'bob_em_estep.py = bob.trainer.script.em_estep:main',
+  'bob_em_mstep.py = bob.trainer.script.em_mstep:main',
+  'bob_em_train.py = bob.trainer.script.em_train:main',
   ]
 
 # built-in databases
@@ -0,0 +1,46 @@
+/**
+ * @file core/cxx/parallel.cc
+ * @date Mon Oct 19 16:40:12 2026 +0200
+ *
+ * @brief Implements the loop splitting helpers for multi-threading
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bob/core/parallel.h"
+
+size_t bob::core::hardware_threads() {
+  size_t n = boost::thread::hardware_concurrency();
+  return n ? n : 1;
+}
+
+void bob::core::thread_split(size_t n_objects, std::vector<size_t>& begins,
+    std::vector<size_t>& ends, size_t n_threads) {
+
+  if (n_threads == 0) n_threads = 1;
+  if (n_threads > n_objects) n_threads = n_objects;
+  if (n_threads == 0) return; //no objects to process
+
+  const size_t chunk = n_objects / n_threads;
+  const size_t rest = n_objects % n_threads;
+
+  size_t begin = 0;
+  for (size_t k=0; k<n_threads; ++k) {
+    size_t end = begin + chunk + ((k < rest) ? 1 : 0);
+    begins.push_back(begin);
+    ends.push_back(end);
+    begin = end;
+  }
+}
@@ -20,10 +20,17 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "bob/core/array_alias.h"
 #include "bob/core/array_assert.h"
+#include "bob/core/array_check.h"
 #include "bob/core/array_copy.h"
 #include "bob/ip/GaborWaveletTransform.h"
+#include "bob/ip/Exception.h"
+#include "bob/core/parallel.h"
+#include <boost/bind.hpp>
 #include <numeric>
+#include <algorithm>
+#include <cmath>
 #include <sstream>
 #include <fstream>
 
@@ -179,6 +186,53 @@ void bob::ip::GaborKernel::transform(
   }
 }
 
+/**
+ * Performs the convolution of the given image with this Gabor kernel, writing the result in single precision.
+ * Please note that both the inpus as well as the output image are in frequency domain.
+ * @param frequency_domain_image
+ * @param transformed_frequency_domain_image
+ */
+void bob::ip::GaborKernel::transform(
+  const blitz::Array<std::complex<double>,2>& frequency_domain_image,
+  blitz::Array<std::complex<float>,2>& transformed_frequency_domain_image
+) const
+{
+  // assert same size
+  bob::core::array::assertSameShape(frequency_domain_image, transformed_frequency_domain_image);
+  // clear resulting image first
+  transformed_frequency_domain_image = std::complex<float>(0);
+  // iterate through the kernel pixels and do the multiplication
+  std::vector<std::pair<blitz::TinyVector<unsigned,2>, double> >::const_iterator it = m_kernel_pixel.begin(), it_end = m_kernel_pixel.end();
+  for (; it < it_end; ++it){
+    const std::complex<double> value = frequency_domain_image(it->first) * it->second;
+    transformed_frequency_domain_image(it->first) = std::complex<float>(value.real(), value.imag());
+  }
+}
+
+/**
+ * Computes the response of this Gabor kernel at a single position of the image,
+ * i.e., the value of the inverse Fourier transform of the transformed image at this position (multiplied by the number of pixels).
+ * Only the non-zero pixels of the kernel are visited.
+ * @param frequency_domain_image  The image in frequency domain
+ * @param y_phases  The phase factors \f$ e^{2\pi i u y / h} \f$ of the position (y,x) for all rows u
+ * @param x_phases  The phase factors \f$ e^{2\pi i v x / w} \f$ of the position (y,x) for all columns v
+ * @return The complex response, which still needs to be divided by the number of pixels
+ */
+std::complex<double> bob::ip::GaborKernel::response(
+  const blitz::Array<std::complex<double>,2>& frequency_domain_image,
+  const blitz::Array<std::complex<double>,1>& y_phases,
+  const blitz::Array<std::complex<double>,1>& x_phases
+) const
+{
+  std::complex<double> result(0.);
+  // iterate through the kernel pixels and sum up their contributions
+  std::vector<std::pair<blitz::TinyVector<unsigned,2>, double> >::const_iterator it = m_kernel_pixel.begin(), it_end = m_kernel_pixel.end();
+  for (; it < it_end; ++it){
+    result += frequency_domain_image(it->first) * (it->second * y_phases(it->first[0]) * x_phases(it->first[1]));
+  }
+  return result;
+}
+
 /**
  * Generates and returns the image for the current kernel.
  * @return The kernel image in frequency domain.
@@ -194,6 +248,131 @@ blitz::Array<double,2> bob::ip::GaborKernel::kernelImage() const{
   return image;
 }
 
+/***********************************************************************************
+******************     GaborKernelCache           **********************************
+***********************************************************************************/
+/**
+ * Creates an empty cache of Gabor kernel banks
+ * @param memory_budget  The maximum number of bytes used by the cached kernel banks
+ */
+bob::ip::GaborKernelCache::GaborKernelCache(
+  const size_t memory_budget
+)
+: m_memory_budget(memory_budget),
+  m_memory(0),
+  m_hits(0),
+  m_misses(0)
+{
+}
+
+/**
+ * Returns the kernel bank for the given Gabor wavelet transform and the given resolution,
+ * generating it if it is not in the cache yet.
+ * The kernel bank is generated outside of the lock, so that other threads can still access the cache.
+ * @param gwt         The Gabor wavelet transform, which defines the parameters of the Gabor wavelets
+ * @param resolution  The image resolution
+ * @return The (shared) kernel bank
+ */
+boost::shared_ptr<const bob::ip::GaborKernelCache::KernelBank> bob::ip::GaborKernelCache::get(
+  const bob::ip::GaborWaveletTransform& gwt,
+  const blitz::TinyVector<unsigned,2>& resolution
+)
+{
+  // the key contains everything that influences the Gabor kernels
+  Key key(9);
+  key[0] = resolution[0]; key[1] = resolution[1];
+  key[2] = gwt.m_number_of_scales; key[3] = gwt.m_number_of_directions;
+  key[4] = gwt.m_sigma; key[5] = gwt.m_k_max; key[6] = gwt.m_k_fac;
+  key[7] = gwt.m_pow_of_k; key[8] = gwt.m_dc_free;
+
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    std::map<Key, Entry>::iterator it = m_entries.find(key);
+    if (it != m_entries.end()){
+      ++m_hits;
+      // move the key to the front of the LRU list
+      m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+      return it->second.bank;
+    }
+    ++m_misses;
+  }
+
+  // generate the kernels
+  boost::shared_ptr<const KernelBank> bank = gwt.createKernels(resolution);
+  size_t memory = sizeof(KernelBank);
+  for (KernelBank::const_iterator kit = bank->begin(); kit != bank->end(); ++kit)
+    memory += kit->memorySize();
+
+  boost::mutex::scoped_lock lock(m_mutex);
+  // another thread might have generated the same bank in the meantime
+  std::map<Key, Entry>::iterator it = m_entries.find(key);
+  if (it != m_entries.end()){
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    return it->second.bank;
+  }
+  m_lru.push_front(key);
+  Entry& entry = m_entries[key];
+  entry.bank = bank;
+  entry.memory = memory;
+  entry.lru = m_lru.begin();
+  m_memory += memory;
+  evict();
+  return bank;
+}
+
+void bob::ip::GaborKernelCache::evict(){
+  while (m_memory > m_memory_budget && m_lru.size() > 1){
+    std::map<Key, Entry>::iterator it = m_entries.find(m_lru.back());
+    m_memory -= it->second.memory;
+    m_entries.erase(it);
+    m_lru.pop_back();
+  }
+}
+
+size_t bob::ip::GaborKernelCache::memoryBudget() const{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_memory_budget;
+}
+
+void bob::ip::GaborKernelCache::setMemoryBudget(const size_t memory_budget){
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_memory_budget = memory_budget;
+  evict();
+}
+
+size_t bob::ip::GaborKernelCache::memory() const{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_memory;
+}
+
+size_t bob::ip::GaborKernelCache::size() const{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_entries.size();
+}
+
+size_t bob::ip::GaborKernelCache::hits() const{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_hits;
+}
+
+size_t bob::ip::GaborKernelCache::misses() const{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_misses;
+}
+
+void bob::ip::GaborKernelCache::resetCounters(){
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_hits = 0;
+  m_misses = 0;
+}
+
+void bob::ip::GaborKernelCache::clear(){
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_entries.clear();
+  m_lru.clear();
+  m_memory = 0;
+}
+
 /***********************************************************************************
 ******************     GaborWaveletTransform      **********************************
 ***********************************************************************************/
@@ -221,6 +400,7 @@ bob::ip::GaborWaveletTransform::GaborWaveletTransform(
   m_k_max(k_max),
   m_k_fac(k_fac),
   m_dc_free(dc_free),
+  m_gabor_kernels(new std::vector<bob::ip::GaborKernel>()),
   m_fft(0,0),
   m_ifft(0,0),
   m_number_of_scales(number_of_scales),
@@ -238,6 +418,8 @@ bob::ip::GaborWaveletTransform::GaborWaveletTransform(
   m_k_max(other.m_k_max),
   m_k_fac(other.m_k_fac),
   m_dc_free(other.m_dc_free),
+  m_gabor_kernels(new std::vector<bob::ip::GaborKernel>()),
+  m_kernel_cache(other.m_kernel_cache),
   m_fft(0,0),
   m_ifft(0,0),
   m_number_of_scales(other.m_number_of_scales),
@@ -257,6 +439,7 @@ bob::ip::GaborWaveletTransform::operator =
   m_k_max = other.m_k_max;
   m_k_fac = other.m_k_fac;
   m_dc_free = other.m_dc_free;
+  m_kernel_cache = other.m_kernel_cache;
   m_fft = bob::sp::FFT2D(0,0);
   m_ifft = bob::sp::IFFT2D(0,0);
   m_number_of_scales = other.m_number_of_scales;
@@ -343,13 +526,11 @@ void bob::ip::GaborWaveletTransform::generateKernels(
 )
 {
   if (resolution[1] != m_fft.getWidth() || resolution[0] != m_fft.getHeight()){
-    // new kernels need to be generated
-    m_gabor_kernels.clear();
-    m_gabor_kernels.reserve(m_kernel_frequencies.size());
-
-    for (unsigned j = 0; j < m_kernel_frequencies.size(); ++j){
-      m_gabor_kernels.push_back(bob::ip::GaborKernel(resolution, m_kernel_frequencies[j], m_sigma, m_pow_of_k, m_dc_free));
-    }
+    // new kernels need to be generated, or taken from the cache
+    if (m_kernel_cache)
+      m_gabor_kernels = m_kernel_cache->get(*this, resolution);
+    else
+      m_gabor_kernels = createKernels(resolution);
 
     // reset fft sizes
     m_fft.reset(resolution[0], resolution[1]);
@@ -359,28 +540,43 @@ void bob::ip::GaborWaveletTransform::generateKernels(
   }
 }
 
+/**
+ * Private function that generates the Gabor kernels for the given resolution.
+ * @param resolution  The resolution of the image to generate the kernels for
+ * @return The newly generated Gabor kernels
+ */
+boost::shared_ptr<const std::vector<bob::ip::GaborKernel> > bob::ip::GaborWaveletTransform::createKernels(
+  const blitz::TinyVector<unsigned,2>& resolution
+) const
+{
+  boost::shared_ptr<std::vector<bob::ip::GaborKernel> > kernels(new std::vector<bob::ip::GaborKernel>());
+  kernels->reserve(m_kernel_frequencies.size());
+  for (unsigned j = 0; j < m_kernel_frequencies.size(); ++j){
+    kernels->push_back(bob::ip::GaborKernel(resolution, m_kernel_frequencies[j], m_sigma, m_pow_of_k, m_dc_free));
+  }
+  return kernels;
+}
+
 /**
  * Generates and returns the images of the Gabor wavelet family in frequency domain.
  * @return  The Gabor wavelets (one per layer)
  */
 blitz::Array<double,3> bob::ip::GaborWaveletTransform::kernelImages() const{
   // generate array of desired size
-  blitz::Array<double,3> res(m_gabor_kernels.size(), m_temp_array.shape()[0], m_temp_array.shape()[1]);
+  blitz::Array<double,3> res(m_gabor_kernels->size(), m_temp_array.shape()[0], m_temp_array.shape()[1]);
   // fill in the wavelets
-  for (int j = m_gabor_kernels.size(); j--;){
-    res(j, blitz::Range::all(), blitz::Range::all()) = m_gabor_kernels[j].kernelImage();
+  for (int j = m_gabor_kernels->size(); j--;){
+    res(j, blitz::Range::all(), blitz::Range::all()) = (*m_gabor_kernels)[j].kernelImage();
   }
   return res;
 }
 
 /**
- * Computes the Gabor wavelet transformation for the given image (in spatial domain)
+ * Private function that computes the spectrum of the given complex image
  * @param gray_image  The source image in spatial domain
- * @param trafo_image The convolution result, in spatial domain
  */
-void bob::ip::GaborWaveletTransform::performGWT(
-  const blitz::Array<std::complex<double>,2>& gray_image,
-  blitz::Array<std::complex<double>,3>& trafo_image
+void bob::ip::GaborWaveletTransform::computeSpectrum(
+  const blitz::Array<std::complex<double>,2>& gray_image
 )
 {
   // first, check if we need to reset the kernels
@@ -388,18 +584,298 @@ void bob::ip::GaborWaveletTransform::performGWT(
 
   // perform Fourier transformation to image
   m_fft(gray_image, m_frequency_image);
+}
+
+/**
+ * Private function that computes the spectrum of the given real image, using a real-input FFT
+ * @param gray_image  The source image in spatial domain
+ */
+void bob::ip::GaborWaveletTransform::computeSpectrum(
+  const blitz::Array<double,2>& gray_image
+)
+{
+  // first, check if we need to reset the kernels
+  generateKernels(blitz::TinyVector<unsigned,2>(gray_image.extent(0),gray_image.extent(1)));
+
+  // perform Fourier transformation to image
+  if (bob::core::array::isCZeroBaseContiguous(gray_image))
+    m_fft(gray_image, m_frequency_image);
+  else
+    m_fft(bob::core::array::ccopy(gray_image), m_frequency_image);
+}
+
+/**
+ * Private function that allocates one buffer (of the size of the image) per thread
+ * @param n_threads        The number of threads
+ * @param single_precision Allocate buffers for single precision transforms?
+ */
+void bob::ip::GaborWaveletTransform::prepareBuffers(
+  const size_t n_threads,
+  const bool single_precision
+)
+{
+  const size_t n_buffers = std::max(n_threads, (size_t)1);
+  if (single_precision){
+    m_thread_float_buffers.resize(n_buffers);
+    for (size_t k = 0; k < n_buffers; ++k)
+      m_thread_float_buffers[k].resize(m_frequency_image.shape());
+  } else {
+    m_thread_buffers.resize(n_buffers);
+    for (size_t k = 0; k < n_buffers; ++k)
+      m_thread_buffers[k].resize(m_frequency_image.shape());
+  }
+}
+
+/**
+ * Private function that computes the layers [begin, end) of the trafo image
+ */
+void bob::ip::GaborWaveletTransform::transformLayers(
+  blitz::Array<std::complex<double>,3>& trafo_image,
+  const size_t thread,
+  const size_t begin,
+  const size_t end
+)
+{
+  blitz::Array<std::complex<double>,2>& buffer = m_thread_buffers[thread];
+  // the layers are views of an alias private to this thread
+  blitz::Array<std::complex<double>,3> trafo_image_ = bob::core::array::alias(trafo_image);
+  for (int j = begin; j < (int)end; ++j){
+    // apply the kernel to the spectrum
+    (*m_gabor_kernels)[j].transform(m_frequency_image, buffer);
+    // perform ifft directly into the trafo image layer
+    blitz::Array<std::complex<double>,2> layer(trafo_image_(j, blitz::Range::all(), blitz::Range::all()));
+    m_ifft(buffer, layer);
+  }
+}
+
+/**
+ * Private function that computes the layers [begin, end) of the trafo image in single precision
+ */
+void bob::ip::GaborWaveletTransform::transformLayersFloat(
+  blitz::Array<std::complex<float>,3>& trafo_image,
+  const size_t thread,
+  const size_t begin,
+  const size_t end
+)
+{
+  blitz::Array<std::complex<float>,2>& buffer = m_thread_float_buffers[thread];
+  // the layers are views of an alias private to this thread
+  blitz::Array<std::complex<float>,3> trafo_image_ = bob::core::array::alias(trafo_image);
+  for (int j = begin; j < (int)end; ++j){
+    // apply the kernel to the spectrum
+    (*m_gabor_kernels)[j].transform(m_frequency_image, buffer);
+    // perform ifft directly into the trafo image layer
+    blitz::Array<std::complex<float>,2> layer(trafo_image_(j, blitz::Range::all(), blitz::Range::all()));
+    m_ifft(buffer, layer);
+  }
+}
+
+/**
+ * Private function that computes the layers [begin, end) of the jet image (absolute values and phases)
+ */
+void bob::ip::GaborWaveletTransform::jetLayers(
+  blitz::Array<double,4>& jet_image,
+  const size_t thread,
+  const size_t begin,
+  const size_t end
+)
+{
+  blitz::Array<std::complex<double>,2>& buffer = m_thread_buffers[thread];
+  // the layers are views of an alias private to this thread
+  blitz::Array<double,4> jet_image_ = bob::core::array::alias(jet_image);
+  for (int j = begin; j < (int)end; ++j){
+    // apply the kernel to the spectrum
+    (*m_gabor_kernels)[j].transform(m_frequency_image, buffer);
+    // perform ifft of transformed image
+    m_ifft(buffer);
+    // convert into absolute and phase part
+    blitz::Array<double,2> abs_part(jet_image_(blitz::Range::all(), blitz::Range::all(), 0, j));
+    abs_part = blitz::abs(buffer);
+    blitz::Array<double,2> phase_part(jet_image_(blitz::Range::all(), blitz::Range::all(), 1, j));
+    phase_part = blitz::arg(buffer);
+  }
+}
+
+/**
+ * Private function that computes the layers [begin, end) of the jet image (absolute values only)
+ */
+void bob::ip::GaborWaveletTransform::absJetLayers(
+  blitz::Array<double,3>& jet_image,
+  const size_t thread,
+  const size_t begin,
+  const size_t end
+)
+{
+  blitz::Array<std::complex<double>,2>& buffer = m_thread_buffers[thread];
+  // the layers are views of an alias private to this thread
+  blitz::Array<double,3> jet_image_ = bob::core::array::alias(jet_image);
+  for (int j = begin; j < (int)end; ++j){
+    // apply the kernel to the spectrum
+    (*m_gabor_kernels)[j].transform(m_frequency_image, buffer);
+    // perform ifft of transformed image
+    m_ifft(buffer);
+    // convert into absolute part
+    blitz::Array<double,2> abs_part(jet_image_(blitz::Range::all(), blitz::Range::all(), j));
+    abs_part = blitz::abs(buffer);
+  }
+}
+
+/**
+ * Normalizes the Gabor jets in the rows [begin, end) of the given jet image
+ */
+static void normalizeJetRows(blitz::Array<double,4>& jet_image, const size_t begin, const size_t end){
+  // the jets are views of an alias private to this thread
+  blitz::Array<double,4> jet_image_ = bob::core::array::alias(jet_image);
+  for (int y = begin; y < (int)end; ++y){
+    for (int x = jet_image_.extent(1); x--;){
+      // normalize jet
+      blitz::Array<double,2> jet(jet_image_(y,x,blitz::Range::all(),blitz::Range::all()));
+      bob::ip::normalizeGaborJet(jet);
+    }
+  }
+}
+
+/**
+ * Normalizes the Gabor jets in the rows [begin, end) of the given jet image
+ */
+static void normalizeAbsJetRows(blitz::Array<double,3>& jet_image, const size_t begin, const size_t end){
+  // the jets are views of an alias private to this thread
+  blitz::Array<double,3> jet_image_ = bob::core::array::alias(jet_image);
+  for (int y = begin; y < (int)end; ++y){
+    for (int x = jet_image_.extent(1); x--;){
+      // normalize jet
+      blitz::Array<double,1> jet(jet_image_(y,x,blitz::Range::all()));
+      bob::ip::normalizeGaborJet(jet);
+    }
+  }
+}
+
+void bob::ip::GaborWaveletTransform::performGWT_(
+  blitz::Array<std::complex<double>,3>& trafo_image,
+  const size_t n_threads
+)
+{
+  // check that the shape is correct
+  bob::core::array::assertSameShape(trafo_image, blitz::shape(m_kernel_frequencies.size(), m_frequency_image.extent(0), m_frequency_image.extent(1)));
+  bob::core::array::assertCZeroBaseContiguous(trafo_image);
 
+  // now, let each kernel compute the transformation result
+  prepareBuffers(n_threads);
+  bob::core::thread_iloop(boost::bind(&bob::ip::GaborWaveletTransform::transformLayers, this, boost::ref(trafo_image), _1, _2, _3), m_gabor_kernels->size(), n_threads);
+}
+
+void bob::ip::GaborWaveletTransform::performGWT_(
+  blitz::Array<std::complex<float>,3>& trafo_image,
+  const size_t n_threads
+)
+{
+  // check that the shape is correct
+  bob::core::array::assertSameShape(trafo_image, blitz::shape(m_kernel_frequencies.size(), m_frequency_image.extent(0), m_frequency_image.extent(1)));
+  bob::core::array::assertCZeroBaseContiguous(trafo_image);
+
+  // now, let each kernel compute the transformation result
+  prepareBuffers(n_threads, true);
+  bob::core::thread_iloop(boost::bind(&bob::ip::GaborWaveletTransform::transformLayersFloat, this, boost::ref(trafo_image), _1, _2, _3), m_gabor_kernels->size(), n_threads);
+}
+
+void bob::ip::GaborWaveletTransform::computeJetImage_(
+  blitz::Array<double,4>& jet_image,
+  bool do_normalize,
+  const size_t n_threads
+)
+{
+  // check that the shape is correct
+  bob::core::array::assertSameShape(jet_image, blitz::shape(m_frequency_image.extent(0), m_frequency_image.extent(1), 2, m_kernel_frequencies.size()));
+
+  // now, let each kernel compute the transformation result
+  prepareBuffers(n_threads);
+  bob::core::thread_iloop(boost::bind(&bob::ip::GaborWaveletTransform::jetLayers, this, boost::ref(jet_image), _1, _2, _3), m_gabor_kernels->size(), n_threads);
+
+  if (do_normalize){
+    bob::core::thread_loop(boost::bind(&normalizeJetRows, boost::ref(jet_image), _1, _2), jet_image.extent(0), n_threads);
+  }
+}
+
+void bob::ip::GaborWaveletTransform::computeJetImage_(
+  blitz::Array<double,3>& jet_image,
+  bool do_normalize,
+  const size_t n_threads
+)
+{
   // check that the shape is correct
-  bob::core::array::assertSameShape(trafo_image, blitz::shape(m_kernel_frequencies.size(),gray_image.extent(0),gray_image.extent(1)));
+  bob::core::array::assertSameShape(jet_image, blitz::shape(m_frequency_image.extent(0), m_frequency_image.extent(1), m_kernel_frequencies.size()));
 
   // now, let each kernel compute the transformation result
-  for (unsigned j = 0; j < m_gabor_kernels.size(); ++j){
-    // get a reference to the current layer of the trafo image
-    m_gabor_kernels[j].transform(m_frequency_image, m_temp_array);
-    // perform ifft on the trafo image layer
-    blitz::Array<std::complex<double>,2> layer(trafo_image(j, blitz::Range::all(), blitz::Range::all()));
-    m_ifft(m_temp_array, layer);
-  } // for j
+  prepareBuffers(n_threads);
+  bob::core::thread_iloop(boost::bind(&bob::ip::GaborWaveletTransform::absJetLayers, this, boost::ref(jet_image), _1, _2, _3), m_gabor_kernels->size(), n_threads);
+
+  if (do_normalize){
+    bob::core::thread_loop(boost::bind(&normalizeAbsJetRows, boost::ref(jet_image), _1, _2), jet_image.extent(0), n_threads);
+  }
+}
+
+/**
+ * Computes the Gabor wavelet transformation for the given image (in spatial domain)
+ * @param gray_image  The source image in spatial domain
+ * @param trafo_image The convolution result, in spatial domain
+ * @param n_threads   The number of threads to distribute the kernels over
+ */
+void bob::ip::GaborWaveletTransform::performGWT(
+  const blitz::Array<std::complex<double>,2>& gray_image,
+  blitz::Array<std::complex<double>,3>& trafo_image,
+  const size_t n_threads
+)
+{
+  computeSpectrum(gray_image);
+  performGWT_(trafo_image, n_threads);
+}
+
+/**
+ * Computes the Gabor wavelet transformation for the given real image (in spatial domain)
+ * @param gray_image  The source image in spatial domain
+ * @param trafo_image The convolution result, in spatial domain
+ * @param n_threads   The number of threads to distribute the kernels over
+ */
+void bob::ip::GaborWaveletTransform::performGWT(
+  const blitz::Array<double,2>& gray_image,
+  blitz::Array<std::complex<double>,3>& trafo_image,
+  const size_t n_threads
+)
+{
+  computeSpectrum(gray_image);
+  performGWT_(trafo_image, n_threads);
+}
+
+/**
+ * Computes the Gabor wavelet transformation for the given image (in spatial domain) in single precision
+ * @param gray_image  The source image in spatial domain
+ * @param trafo_image The convolution result, in spatial domain
+ * @param n_threads   The number of threads to distribute the kernels over
+ */
+void bob::ip::GaborWaveletTransform::performGWT(
+  const blitz::Array<std::complex<double>,2>& gray_image,
+  blitz::Array<std::complex<float>,3>& trafo_image,
+  const size_t n_threads
+)
+{
+  computeSpectrum(gray_image);
+  performGWT_(trafo_image, n_threads);
+}
+
+/**
+ * Computes the Gabor wavelet transformation for the given real image (in spatial domain) in single precision
+ * @param gray_image  The source image in spatial domain
+ * @param trafo_image The convolution result, in spatial domain
+ * @param n_threads   The number of threads to distribute the kernels over
+ */
+void bob::ip::GaborWaveletTransform::performGWT(
+  const blitz::Array<double,2>& gray_image,
+  blitz::Array<std::complex<float>,3>& trafo_image,
+  const size_t n_threads
+)
+{
+  computeSpectrum(gray_image);
+  performGWT_(trafo_image, n_threads);
 }
 
 /**
@@ -407,87 +883,202 @@ void bob::ip::GaborWaveletTransform::performGWT(
  * @param gray_image  The source image in spatial domain
  * @param jet_image   The resulting Gabor jet image, including absolute values and phases for each pixel
  * @param do_normalize Shall the Gabor jets be normalized?
+ * @param n_threads   The number of threads to distribute the kernels over
  */
 void bob::ip::GaborWaveletTransform::computeJetImage(
   const blitz::Array<std::complex<double>,2>& gray_image,
   blitz::Array<double,4>& jet_image,
-  bool do_normalize
+  bool do_normalize,
+  const size_t n_threads
 )
 {
-  // first, check if we need to reset the kernels
-  generateKernels(blitz::TinyVector<unsigned,2>(gray_image.extent(0),gray_image.extent(1)));
+  computeSpectrum(gray_image);
+  computeJetImage_(jet_image, do_normalize, n_threads);
+}
 
-  // perform Fourier transformation to image
-  m_fft(gray_image, m_frequency_image);
+/**
+ * Computes the Gabor jets including absolute values and phases for the given real image (in spatial domain).
+ * @param gray_image  The source image in spatial domain
+ * @param jet_image   The resulting Gabor jet image, including absolute values and phases for each pixel
+ * @param do_normalize Shall the Gabor jets be normalized?
+ * @param n_threads   The number of threads to distribute the kernels over
+ */
+void bob::ip::GaborWaveletTransform::computeJetImage(
+  const blitz::Array<double,2>& gray_image,
+  blitz::Array<double,4>& jet_image,
+  bool do_normalize,
+  const size_t n_threads
+)
+{
+  computeSpectrum(gray_image);
+  computeJetImage_(jet_image, do_normalize, n_threads);
+}
 
-  // check that the shape is correct
-  bob::core::array::assertSameShape(jet_image, blitz::shape(gray_image.extent(0), gray_image.extent(1), 2, m_kernel_frequencies.size()));
+/**
+ * Computes the Gabor jets including absolute values only for the given image (in spatial domain).
+ * @param gray_image  The source image in spatial domain
+ * @param jet_image   The resulting Gabor jet image, including only absolute values for each pixel
+ * @param do_normalize Shall the Gabor jets be normalized?
+ * @param n_threads   The number of threads to distribute the kernels over
+ */
+void bob::ip::GaborWaveletTransform::computeJetImage(
+  const blitz::Array<std::complex<double>,2>& gray_image,
+  blitz::Array<double,3>& jet_image,
+  bool do_normalize,
+  const size_t n_threads
+)
+{
+  computeSpectrum(gray_image);
+  computeJetImage_(jet_image, do_normalize, n_threads);
+}
 
-  // now, let each kernel compute the transformation result
-  for (int j = 0; j < (int)m_gabor_kernels.size(); ++j){
-    // get a reference to the current layer of the trafo image
-    m_gabor_kernels[j].transform(m_frequency_image, m_temp_array);
-    // perform ifft of transformed image
-    m_ifft(m_temp_array);
-    // convert into absolute and phase part
-    blitz::Array<double,2> abs_part(jet_image(blitz::Range::all(), blitz::Range::all(), 0, j));
-    abs_part = blitz::abs(m_temp_array);
-    blitz::Array<double,2> phase_part(jet_image(blitz::Range::all(), blitz::Range::all(), 1, j));
-    phase_part = blitz::arg(m_temp_array);
-  } // for j
+/**
+ * Computes the Gabor jets including absolute values only for the given real image (in spatial domain).
+ * @param gray_image  The source image in spatial domain
+ * @param jet_image   The resulting Gabor jet image, including only absolute values for each pixel
+ * @param do_normalize Shall the Gabor jets be normalized?
+ * @param n_threads   The number of threads to distribute the kernels over
+ */
+void bob::ip::GaborWaveletTransform::computeJetImage(
+  const blitz::Array<double,2>& gray_image,
+  blitz::Array<double,3>& jet_image,
+  bool do_normalize,
+  const size_t n_threads
+)
+{
+  computeSpectrum(gray_image);
+  computeJetImage_(jet_image, do_normalize, n_threads);
+}
 
-  if (do_normalize){
-    // iterate the positions
-    for (int y = jet_image.extent(0); y--;){
-      for (int x = jet_image.extent(1); x--;){
-        // normalize jet
-        blitz::Array<double,2> jet(jet_image(y,x,blitz::Range::all(),blitz::Range::all()));
-        bob::ip::normalizeGaborJet(jet);
+/**
+ * Private function that computes the complex Gabor wavelet responses at the given positions only.
+ * Depending on the number of positions, the responses are either evaluated directly from the spectrum of the image,
+ * or the inverse FFT is computed for each kernel (when the positions are dense).
+ * Both ways lead to identical results.
+ * @param gray_image  The source image in spatial domain
+ * @param positions   The (y,x) positions to compute the responses at, one position per row
+ */
+void bob::ip::GaborWaveletTransform::computeResponses(
+  const blitz::Array<std::complex<double>,2>& gray_image,
+  const blitz::Array<int,2>& positions
+)
+{
+  const int height = gray_image.extent(0), width = gray_image.extent(1);
+  const int number_of_positions = positions.extent(0), number_of_kernels = m_kernel_frequencies.size();
+
+  // check the positions
+  bob::core::array::assertSameDimensionLength(positions.extent(1), 2);
+  for (int i = number_of_positions; i--;){
+    if (positions(i,0) < 0) throw bob::ip::ParamOutOfBoundaryError("positions(y)", false, positions(i,0), 0);
+    if (positions(i,0) >= height) throw bob::ip::ParamOutOfBoundaryError("positions(y)", true, positions(i,0), height-1);
+    if (positions(i,1) < 0) throw bob::ip::ParamOutOfBoundaryError("positions(x)", false, positions(i,1), 0);
+    if (positions(i,1) >= width) throw bob::ip::ParamOutOfBoundaryError("positions(x)", true, positions(i,1), width-1);
+  }
+
+  // compute the spectrum of the image
+  computeSpectrum(gray_image);
+
+  m_responses.resize(number_of_positions, number_of_kernels);
+
+  // compare the costs of the sparse evaluation (one complex multiplication per kernel pixel and position)
+  // with the costs of one inverse FFT per kernel
+  double sparse_costs = 0.;
+  for (int j = 0; j < number_of_kernels; ++j)
+    sparse_costs += (*m_gabor_kernels)[j].numberOfPixels();
+  sparse_costs *= number_of_positions;
+  const double dense_costs = (double)number_of_kernels * height * width * std::log((double)height * width) / std::log(2.);
+
+  if (sparse_costs < dense_costs){
+    // evaluate the responses directly from the spectrum
+    m_y_phases.resize(height);
+    m_x_phases.resize(width);
+    const double scale = 1. / ((double)height * width);
+    for (int i = 0; i < number_of_positions; ++i){
+      // compute the phase factors of the current position
+      const int y = positions(i,0), x = positions(i,1);
+      for (int u = 0; u < height; ++u)
+        m_y_phases(u) = std::polar(1., 2. * M_PI * ((u * y) % height) / height);
+      for (int v = 0; v < width; ++v)
+        m_x_phases(v) = std::polar(1., 2. * M_PI * ((v * x) % width) / width);
+      // let each kernel compute its response
+      for (int j = 0; j < number_of_kernels; ++j){
+        m_responses(i,j) = (*m_gabor_kernels)[j].response(m_frequency_image, m_y_phases, m_x_phases) * scale;
+      }
+    }
+  } else {
+    // compute the full transform for each kernel and sample the positions
+    for (int j = 0; j < number_of_kernels; ++j){
+      (*m_gabor_kernels)[j].transform(m_frequency_image, m_temp_array);
+      m_ifft(m_temp_array);
+      for (int i = 0; i < number_of_positions; ++i){
+        m_responses(i,j) = m_temp_array(positions(i,0), positions(i,1));
       }
     }
   }
 }
 
 /**
- * Computes the Gabor jets including absolute values only for the given image (in spatial domain).
+ * Computes the Gabor jets including absolute values and phases at the given positions of the image (in spatial domain).
+ * The jets are identical to the ones of the jet image computed by computeJetImage() at these positions.
  * @param gray_image  The source image in spatial domain
- * @param jet_image   The resulting Gabor jet image, including only absolute values for each pixel
+ * @param positions   The (y,x) positions to extract the Gabor jets at, one position per row
+ * @param jets        The resulting Gabor jets, including absolute values and phases for each position
  * @param do_normalize Shall the Gabor jets be normalized?
  */
-void bob::ip::GaborWaveletTransform::computeJetImage(
+void bob::ip::GaborWaveletTransform::computeJets(
   const blitz::Array<std::complex<double>,2>& gray_image,
-  blitz::Array<double,3>& jet_image,
+  const blitz::Array<int,2>& positions,
+  blitz::Array<double,3>& jets,
   bool do_normalize
 )
 {
-  // first, check if we need to reset the kernels
-  generateKernels(blitz::TinyVector<int,2>(gray_image.extent(0),gray_image.extent(1)));
+  // check that the shape is correct
+  bob::core::array::assertSameShape(jets, blitz::shape(positions.extent(0), 2, m_kernel_frequencies.size()));
 
-  // perform Fourier transformation to image
-  m_fft(gray_image, m_frequency_image);
+  computeResponses(gray_image, positions);
+
+  // convert into absolute and phase part
+  blitz::Range all = blitz::Range::all();
+  blitz::Array<double,2> abs_part(jets(all, 0, all));
+  abs_part = blitz::abs(m_responses);
+  blitz::Array<double,2> phase_part(jets(all, 1, all));
+  phase_part = blitz::arg(m_responses);
 
+  if (do_normalize){
+    for (int i = jets.extent(0); i--;){
+      blitz::Array<double,2> jet(jets(i, all, all));
+      bob::ip::normalizeGaborJet(jet);
+    }
+  }
+}
+
+/**
+ * Computes the Gabor jets including absolute values only at the given positions of the image (in spatial domain).
+ * The jets are identical to the ones of the jet image computed by computeJetImage() at these positions.
+ * @param gray_image  The source image in spatial domain
+ * @param positions   The (y,x) positions to extract the Gabor jets at, one position per row
+ * @param jets        The resulting Gabor jets, including only absolute values for each position
+ * @param do_normalize Shall the Gabor jets be normalized?
+ */
+void bob::ip::GaborWaveletTransform::computeJets(
+  const blitz::Array<std::complex<double>,2>& gray_image,
+  const blitz::Array<int,2>& positions,
+  blitz::Array<double,2>& jets,
+  bool do_normalize
+)
+{
   // check that the shape is correct
-  bob::core::array::assertSameShape(jet_image, blitz::shape(gray_image.extent(0), gray_image.extent(1), m_kernel_frequencies.size()));
+  bob::core::array::assertSameShape(jets, blitz::shape(positions.extent(0), m_kernel_frequencies.size()));
 
-  // now, let each kernel compute the transformation result
-  for (int j = 0; j < (int)m_gabor_kernels.size(); ++j){
-    // get a reference to the current layer of the trafo image
-    m_gabor_kernels[j].transform(m_frequency_image, m_temp_array);
-    // perform ifft of transformed image
-    m_ifft(m_temp_array);
-    // convert into absolute part
-    blitz::Array<double,2> abs_part(jet_image(blitz::Range::all(), blitz::Range::all(), j));
-    abs_part = blitz::abs(m_temp_array);
-  } // for j
+  computeResponses(gray_image, positions);
+
+  // convert into absolute part
+  jets = blitz::abs(m_responses);
 
   if (do_normalize){
-    // iterate the positions
-    for (int y = jet_image.extent(0); y--;){
-      for (int x = jet_image.extent(1); x--;){
-        // normalize jet
-        blitz::Array<double,1> jet(jet_image(y,x,blitz::Range::all()));
-        bob::ip::normalizeGaborJet(jet);
-      }
+    for (int i = jets.extent(0); i--;){
+      blitz::Array<double,1> jet(jets(i, blitz::Range::all()));
+      bob::ip::normalizeGaborJet(jet);
     }
   }
 }
@@ -512,6 +1103,9 @@ void bob::ip::GaborWaveletTransform::load(bob::io::HDF5File& file){
   m_number_of_directions = file.read<unsigned>("NumberOfDirections");
 
   computeKernelFrequencies();
+  // make sure that the kernels are regenerated with the new parameters
+  m_fft.reset(0,0);
+  m_ifft.reset(0,0);
 }
 
 /**
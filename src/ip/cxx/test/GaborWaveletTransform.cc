@@ -232,4 +232,102 @@ BOOST_AUTO_TEST_CASE( test_GWT_output )
 
 }
 
+BOOST_AUTO_TEST_CASE( test_GWT_real_threaded_float )
+{
+  // generate a deterministic image
+  blitz::Array<double,2> real_image(67, 54);
+  for (int y = real_image.extent(0); y--;)
+    for (int x = real_image.extent(1); x--;)
+      real_image(y,x) = 128. + 100. * std::sin(0.3 * y + 0.01 * x * x) * std::cos(0.17 * x - 0.05 * y);
+  blitz::Array<std::complex<double>,2> image = bob::core::cast<std::complex<double> >(real_image);
+
+  bob::ip::GaborWaveletTransform gwt;
+  blitz::Array<std::complex<double>, 3> reference(gwt.numberOfKernels(), image.extent(0), image.extent(1)), trafo_image(reference.shape());
+  gwt.performGWT(image, reference);
+
+  // the real-input FFT and several threads lead to the same result
+  for (int n_threads = 1; n_threads <= 3; n_threads += 2){
+    gwt.performGWT(real_image, trafo_image, n_threads);
+    test_close(trafo_image, reference, epsilon);
+  }
+
+  // single precision
+  blitz::Array<std::complex<float>, 3> float_image(reference.shape());
+  gwt.performGWT(real_image, float_image, 3);
+  blitz::Array<std::complex<double>, 3> float_result = bob::core::cast<std::complex<double> >(float_image);
+  test_close(float_result, reference, 1e-2);
+
+  // jet images
+  blitz::Array<double,4> reference_jets(image.extent(0), image.extent(1), 2, gwt.numberOfKernels()), jets(reference_jets.shape());
+  gwt.computeJetImage(image, reference_jets);
+  gwt.computeJetImage(real_image, jets, true, 3);
+  // only the absolute values are compared, since phases of tiny responses are unstable
+  blitz::Range all = blitz::Range::all();
+  blitz::Array<double,3> reference_abs = reference_jets(all, all, 0, all), jets_abs = jets(all, all, 0, all);
+  test_close(jets_abs, reference_abs, epsilon);
+
+  blitz::Array<double,3> abs_jets(image.extent(0), image.extent(1), gwt.numberOfKernels());
+  gwt.computeJetImage(real_image, abs_jets, true, 2);
+  test_close(abs_jets, reference_abs, epsilon);
+}
+
+BOOST_AUTO_TEST_CASE( test_GWT_kernel_cache )
+{
+  boost::shared_ptr<bob::ip::GaborKernelCache> cache(new bob::ip::GaborKernelCache());
+
+  // two transforms with the same parameters share the cache, a third one has different parameters
+  bob::ip::GaborWaveletTransform gwt1, gwt2, gwt3(3, 4), reference;
+  gwt1.setKernelCache(cache);
+  gwt2.setKernelCache(cache);
+  gwt3.setKernelCache(cache);
+
+  blitz::Array<double,2> image1(32, 40), image2(41, 29);
+  for (int y = image1.extent(0); y--;)
+    for (int x = image1.extent(1); x--;)
+      image1(y,x) = std::sin(0.4 * y) + std::cos(0.3 * x);
+  for (int y = image2.extent(0); y--;)
+    for (int x = image2.extent(1); x--;)
+      image2(y,x) = std::cos(0.2 * y * x);
+
+  blitz::Array<double,3> jets1(image1.extent(0), image1.extent(1), gwt1.numberOfKernels()), jets2(image2.extent(0), image2.extent(1), gwt1.numberOfKernels()), reference_jets;
+
+  // alternate the resolutions
+  for (int i = 0; i < 3; ++i){
+    gwt1.computeJetImage(image1, jets1);
+    gwt1.computeJetImage(image2, jets2);
+    gwt2.computeJetImage(image1, jets1);
+  }
+  // only the first request of each resolution is a miss
+  // (gwt2 does not request kernels again as long as the resolution does not change)
+  BOOST_CHECK_EQUAL(cache->misses(), 2u);
+  BOOST_CHECK_EQUAL(cache->hits(), 5u);
+  BOOST_CHECK_EQUAL(cache->size(), 2u);
+
+  // the cached kernels give the same results as newly generated ones
+  reference_jets.resize(jets2.shape());
+  reference.computeJetImage(image2, reference_jets);
+  gwt2.computeJetImage(image2, jets2);
+  test_close(jets2, reference_jets, epsilon);
+
+  // different parameters lead to different kernels
+  blitz::Array<double,3> jets3(image1.extent(0), image1.extent(1), gwt3.numberOfKernels());
+  gwt3.computeJetImage(image1, jets3);
+  BOOST_CHECK_EQUAL(cache->misses(), 3u);
+  BOOST_CHECK_EQUAL(cache->size(), 3u);
+
+  // reducing the memory budget removes the least recently used kernels, but keeps the most recent ones
+  cache->setMemoryBudget(0);
+  BOOST_CHECK_EQUAL(cache->size(), 1u);
+  BOOST_CHECK(cache->memory() > 0);
+  cache->resetCounters();
+  blitz::Array<double,3> jets4(image2.extent(0), image2.extent(1), gwt3.numberOfKernels());
+  gwt3.computeJetImage(image2, jets4);
+  BOOST_CHECK_EQUAL(cache->misses(), 1u);
+  BOOST_CHECK_EQUAL(cache->size(), 1u);
+
+  cache->clear();
+  BOOST_CHECK_EQUAL(cache->size(), 0u);
+  BOOST_CHECK_EQUAL(cache->memory(), 0u);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
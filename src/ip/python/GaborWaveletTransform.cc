@@ -23,6 +23,7 @@
 
 #include <boost/python.hpp>
 #include "bob/core/python/ndarray.h"
+#include "bob/core/python/gil.h"
 #include "bob/core/array_exception.h"
 #include "bob/core/array_type.h"
 
@@ -61,6 +62,38 @@ static inline const blitz::Array<std::complex<double>, 2> convert_image(bob::pyt
   }
 }
 
+template <class T> 
+static inline const blitz::Array<double,2> real_cast (bob::python::const_ndarray input){
+  blitz::Array<T,2> gray(input.type().shape[1],input.type().shape[2]);
+  bob::ip::rgb_to_gray(input.bz<T,3>(), gray);
+  return bob::core::cast<double>(gray);
+}
+
+// converts the given (non-complex) image into a real gray image
+static inline const blitz::Array<double, 2> convert_real_image(bob::python::const_ndarray input){
+  if (input.type().nd == 3){
+    // perform color type conversion
+    switch (input.type().dtype){
+      case bob::core::array::t_uint8: return real_cast<uint8_t>(input);
+      case bob::core::array::t_uint16: return real_cast<uint16_t>(input);
+      case bob::core::array::t_float64: return real_cast<double>(input);
+      default: throw bob::core::Exception();
+    }
+  } else {
+    switch (input.type().dtype){
+      case bob::core::array::t_uint8: return bob::core::cast<double>(input.bz<uint8_t,2>());
+      case bob::core::array::t_uint16: return bob::core::cast<double>(input.bz<uint16_t,2>());
+      case bob::core::array::t_float64: return input.bz<double,2>();
+      default: throw bob::core::Exception();
+    }
+  }
+}
+
+// real images are transformed with a real-input FFT
+static inline bool is_real_image(bob::python::const_ndarray input){
+  return input.type().dtype != bob::core::array::t_complex128;
+}
+
 static inline void transform (bob::ip::GaborKernel& kernel, blitz::Array<std::complex<double>,2>& input, blitz::Array<std::complex<double>,2>& output){
  // perform fft on input image
   bob::sp::FFT2D fft(input.extent(0), input.extent(1));
@@ -103,46 +136,91 @@ static blitz::Array<std::complex<double>,3> empty_trafo_image (bob::ip::GaborWav
   return blitz::Array<std::complex<double>,3>(gwt.numberOfKernels(), input_image.type().shape[index], input_image.type().shape[index+1]);
 }
 
-static void perform_gwt_1 (bob::ip::GaborWaveletTransform& gwt, bob::python::const_ndarray input_image, bob::python::ndarray output_trafo_image){
-  const blitz::Array<std::complex<double>,2>& image = convert_image(input_image);
-  blitz::Array<std::complex<double>,3> trafo_image = output_trafo_image.bz<std::complex<double>,3>();
-  gwt.performGWT(image, trafo_image);
+template <class T>
+static void perform_gwt_(bob::ip::GaborWaveletTransform& gwt, bob::python::const_ndarray input_image, blitz::Array<T,3>& trafo_image, const size_t n_threads){
+  if (is_real_image(input_image)){
+    const blitz::Array<double,2> image = convert_real_image(input_image);
+    bob::python::no_gil unlock;
+    gwt.performGWT(image, trafo_image, n_threads);
+  } else {
+    const blitz::Array<std::complex<double>,2> image = convert_image(input_image);
+    bob::python::no_gil unlock;
+    gwt.performGWT(image, trafo_image, n_threads);
+  }
 }
 
-static blitz::Array<std::complex<double>,3> perform_gwt_2 (bob::ip::GaborWaveletTransform& gwt, bob::python::const_ndarray input_image){
-  const blitz::Array<std::complex<double>,2>& image = convert_image(input_image);
-  blitz::Array<std::complex<double>,3> trafo_image(gwt.numberOfKernels(), image.shape()[0], image.shape()[1]);
-  gwt.performGWT(image, trafo_image);
+static void perform_gwt_1 (bob::ip::GaborWaveletTransform& gwt, bob::python::const_ndarray input_image, bob::python::ndarray output_trafo_image, const size_t n_threads){
+  if (output_trafo_image.type().dtype == bob::core::array::t_complex64){
+    // single precision transform
+    blitz::Array<std::complex<float>,3> trafo_image = output_trafo_image.bz<std::complex<float>,3>();
+    perform_gwt_(gwt, input_image, trafo_image, n_threads);
+  } else {
+    blitz::Array<std::complex<double>,3> trafo_image = output_trafo_image.bz<std::complex<double>,3>();
+    perform_gwt_(gwt, input_image, trafo_image, n_threads);
+  }
+}
+
+static blitz::Array<std::complex<double>,3> perform_gwt_2 (bob::ip::GaborWaveletTransform& gwt, bob::python::const_ndarray input_image, const size_t n_threads){
+  blitz::Array<std::complex<double>,3> trafo_image = empty_trafo_image(gwt, input_image);
+  perform_gwt_(gwt, input_image, trafo_image, n_threads);
   return trafo_image;
 }
 
 static bob::python::ndarray empty_jet_image(bob::ip::GaborWaveletTransform& gwt, bob::python::const_ndarray input_image, bool include_phases){
-  const blitz::Array<std::complex<double>,2>& image = convert_image(input_image);
+  int index = input_image.type().nd-2;
+  assert(index >= 0);
   if (include_phases)
-    return bob::python::ndarray (bob::core::array::t_float64, image.extent(0), image.extent(1), 2, (int)gwt.numberOfKernels());
+    return bob::python::ndarray (bob::core::array::t_float64, input_image.type().shape[index], input_image.type().shape[index+1], 2, (int)gwt.numberOfKernels());
   else
-    return bob::python::ndarray (bob::core::array::t_float64, image.extent(0), image.extent(1), (int)gwt.numberOfKernels());
+    return bob::python::ndarray (bob::core::array::t_float64, input_image.type().shape[index], input_image.type().shape[index+1], (int)gwt.numberOfKernels());
 }
 
-static void compute_jets_1(bob::ip::GaborWaveletTransform& gwt, bob::python::const_ndarray input_image, bob::python::ndarray output_jet_image, bool normalized){
-  const blitz::Array<std::complex<double>,2>& image = convert_image(input_image);
+template <int N>
+static void compute_jets_(bob::ip::GaborWaveletTransform& gwt, bob::python::const_ndarray input_image, blitz::Array<double,N>& jet_image, bool normalized, const size_t n_threads){
+  if (is_real_image(input_image)){
+    const blitz::Array<double,2> image = convert_real_image(input_image);
+    bob::python::no_gil unlock;
+    gwt.computeJetImage(image, jet_image, normalized, n_threads);
+  } else {
+    const blitz::Array<std::complex<double>,2> image = convert_image(input_image);
+    bob::python::no_gil unlock;
+    gwt.computeJetImage(image, jet_image, normalized, n_threads);
+  }
+}
 
+static void compute_jets_1(bob::ip::GaborWaveletTransform& gwt, bob::python::const_ndarray input_image, bob::python::ndarray output_jet_image, bool normalized, const size_t n_threads){
   if (output_jet_image.type().nd == 3){
     // compute jet image with absolute values only
     blitz::Array<double,3> jet_image = output_jet_image.bz<double,3>();
-    gwt.computeJetImage(image, jet_image, normalized);
+    compute_jets_(gwt, input_image, jet_image, normalized, n_threads);
   } else if (output_jet_image.type().nd == 4){
     blitz::Array<double,4> jet_image = output_jet_image.bz<double,4>();
-    gwt.computeJetImage(image, jet_image, normalized);
+    compute_jets_(gwt, input_image, jet_image, normalized, n_threads);
   } else throw bob::core::UnexpectedShapeError();
 }
 
-static bob::python::ndarray compute_jets_2(bob::ip::GaborWaveletTransform& gwt, bob::python::const_ndarray input_image, bool include_phases, bool normalized){
+static bob::python::ndarray compute_jets_2(bob::ip::GaborWaveletTransform& gwt, bob::python::const_ndarray input_image, bool include_phases, bool normalized, const size_t n_threads){
   bob::python::ndarray output_jet_image = empty_jet_image(gwt, input_image, include_phases);
-  compute_jets_1(gwt, input_image, output_jet_image, normalized);
+  compute_jets_1(gwt, input_image, output_jet_image, normalized, n_threads);
   return output_jet_image;
 }
 
+static bob::python::ndarray compute_jets_at(bob::ip::GaborWaveletTransform& gwt, bob::python::const_ndarray input_image, bob::python::const_ndarray input_positions, bool include_phases, bool normalized){
+  const blitz::Array<std::complex<double>,2>& image = convert_image(input_image);
+  const blitz::Array<int,2> positions = input_positions.bz<int,2>();
+  if (include_phases){
+    bob::python::ndarray output_jets(bob::core::array::t_float64, positions.extent(0), 2, (int)gwt.numberOfKernels());
+    blitz::Array<double,3> jets = output_jets.bz<double,3>();
+    gwt.computeJets(image, positions, jets, normalized);
+    return output_jets;
+  } else {
+    bob::python::ndarray output_jets(bob::core::array::t_float64, positions.extent(0), (int)gwt.numberOfKernels());
+    blitz::Array<double,2> jets = output_jets.bz<double,2>();
+    gwt.computeJets(image, positions, jets, normalized);
+    return output_jets;
+  }
+}
+
 
 static void normalize_gabor_jet(bob::python::ndarray gabor_jet){
   if (gabor_jet.type().nd == 1){
@@ -195,6 +273,63 @@ void bind_ip_gabor_wavelet_transform() {
   );
     
 
+  // bind the cache of Gabor kernel banks
+  boost::python::class_<bob::ip::GaborKernelCache, boost::shared_ptr<bob::ip::GaborKernelCache>, boost::noncopyable>(
+    "GaborKernelCache",
+    "This class caches the Gabor wavelets of Gabor wavelet transforms for several image resolutions, so that they do not need to be regenerated each time the image resolution changes. The cache can be shared by several GaborWaveletTransform objects (see GaborWaveletTransform.kernel_cache). When the memory used by the cached kernels exceeds the memory budget, the least recently used kernels are removed.",
+    boost::python::init<boost::python::optional<const size_t> >(
+      (boost::python::arg("memory_budget") = 256 * 1024 * 1024),
+      "Creates an empty cache with the given memory budget (in bytes)."
+    )
+  )
+
+  .add_property(
+    "memory_budget",
+    &bob::ip::GaborKernelCache::memoryBudget,
+    &bob::ip::GaborKernelCache::setMemoryBudget,
+    "The maximum memory (in bytes) used by the cached Gabor kernels."
+  )
+
+  .add_property(
+    "memory",
+    &bob::ip::GaborKernelCache::memory,
+    "The memory (in bytes) used by the cached Gabor kernels."
+  )
+
+  .add_property(
+    "hits",
+    &bob::ip::GaborKernelCache::hits,
+    "The number of requests that were served from the cache."
+  )
+
+  .add_property(
+    "misses",
+    &bob::ip::GaborKernelCache::misses,
+    "The number of requests for which the Gabor kernels had to be generated."
+  )
+
+  .def(
+    "__len__",
+    &bob::ip::GaborKernelCache::size,
+    (boost::python::arg("self")),
+    "The number of cached kernel banks (one per image resolution and Gabor wavelet family)."
+  )
+
+  .def(
+    "reset_counters",
+    &bob::ip::GaborKernelCache::resetCounters,
+    (boost::python::arg("self")),
+    "Resets the hit and miss counters."
+  )
+
+  .def(
+    "clear",
+    &bob::ip::GaborKernelCache::clear,
+    (boost::python::arg("self")),
+    "Removes all Gabor kernels from the cache."
+  );
+
+
   // declare GWT class
   boost::python::class_<bob::ip::GaborWaveletTransform, boost::shared_ptr<bob::ip::GaborWaveletTransform> >(
     "GaborWaveletTransform",
@@ -233,6 +368,13 @@ void bind_ip_gabor_wavelet_transform() {
     "Loads the parameterization of this Gabor wavelet transform from HDF5 file."
   )
 
+  .add_property(
+    "kernel_cache",
+    boost::python::make_function(&bob::ip::GaborWaveletTransform::getKernelCache, boost::python::return_value_policy<boost::python::copy_const_reference>()),
+    &bob::ip::GaborWaveletTransform::setKernelCache,
+    "The GaborKernelCache that the Gabor wavelets are taken from when the image resolution changes (None, if the wavelets are always regenerated). The same cache can be shared by several Gabor wavelet transforms."
+  )
+
   .add_property(
     "number_of_kernels",
     &bob::ip::GaborWaveletTransform::numberOfKernels,
@@ -261,29 +403,29 @@ void bind_ip_gabor_wavelet_transform() {
   .def(
     "perform_gwt",
     &perform_gwt_1,
-    (boost::python::arg("self"), boost::python::arg("input_image"), boost::python::arg("output_trafo_image")),
-    "Performs a Gabor wavelet transform and fills the given Gabor wavelet transformed image (output_trafo_image)"
+    (boost::python::arg("self"), boost::python::arg("input_image"), boost::python::arg("output_trafo_image"), boost::python::arg("n_threads")=1),
+    "Performs a Gabor wavelet transform and fills the given Gabor wavelet transformed image (output_trafo_image). If the output_trafo_image is of type complex64, the transform is computed in single precision. Real input images are transformed with a real-input FFT. The kernels can be distributed over several threads (set n_threads)."
   )
 
   .def(
     "perform_gwt",
     &perform_gwt_2,
-    (boost::python::arg("self"), boost::python::arg("input_image")),
-    "Performs a Gabor wavelet transform and returns a Gabor wavelet transformed image"
+    (boost::python::arg("self"), boost::python::arg("input_image"), boost::python::arg("n_threads")=1),
+    "Performs a Gabor wavelet transform and returns a Gabor wavelet transformed image. The kernels can be distributed over several threads (set n_threads)."
   )
 
   .def(
     "__call__",
     &perform_gwt_1,
-    (boost::python::arg("self"), boost::python::arg("input_image"), boost::python::arg("output_trafo_image")),
-    "Performs a Gabor wavelet transform and fills the given Gabor wavelet transformed image (output_trafo_image)"
+    (boost::python::arg("self"), boost::python::arg("input_image"), boost::python::arg("output_trafo_image"), boost::python::arg("n_threads")=1),
+    "Performs a Gabor wavelet transform and fills the given Gabor wavelet transformed image (output_trafo_image). If the output_trafo_image is of type complex64, the transform is computed in single precision. Real input images are transformed with a real-input FFT. The kernels can be distributed over several threads (set n_threads)."
    )
 
   .def(
     "__call__",
     &perform_gwt_2,
-    (boost::python::arg("self"), boost::python::arg("input_image")),
-    "Performs a Gabor wavelet transform and returns a Gabor wavelet transformed image"
+    (boost::python::arg("self"), boost::python::arg("input_image"), boost::python::arg("n_threads")=1),
+    "Performs a Gabor wavelet transform and returns a Gabor wavelet transformed image. The kernels can be distributed over several threads (set n_threads)."
   )
 
   .def(
@@ -296,15 +438,22 @@ void bind_ip_gabor_wavelet_transform() {
   .def(
     "compute_jets",
     &compute_jets_1,
-    (boost::python::arg("self"), boost::python::arg("input_image"), boost::python::arg("output_jet_image"), boost::python::arg("normalized")=true),
-    "Performs a Gabor wavelet transform and fills given image of Gabor jets. If the normalized parameter is set to True (the default), the absolute parts of the Gabor jets are normalized to unit Euclidean length."
+    (boost::python::arg("self"), boost::python::arg("input_image"), boost::python::arg("output_jet_image"), boost::python::arg("normalized")=true, boost::python::arg("n_threads")=1),
+    "Performs a Gabor wavelet transform and fills given image of Gabor jets. If the normalized parameter is set to True (the default), the absolute parts of the Gabor jets are normalized to unit Euclidean length. The kernels can be distributed over several threads (set n_threads)."
   )
 
   .def(
     "compute_jets",
     &compute_jets_2,
-    (boost::python::arg("self"), boost::python::arg("input_image"), boost::python::arg("include_phases")=true, boost::python::arg("normalized")=true),
-    "Performs a Gabor wavelet transform and returns the image of Gabor jets, with or without Gabor phases. If the normalized parameter is set to True (the default), the absolute parts of the Gabor jets are normalized to unit Euclidean length."
+    (boost::python::arg("self"), boost::python::arg("input_image"), boost::python::arg("include_phases")=true, boost::python::arg("normalized")=true, boost::python::arg("n_threads")=1),
+    "Performs a Gabor wavelet transform and returns the image of Gabor jets, with or without Gabor phases. If the normalized parameter is set to True (the default), the absolute parts of the Gabor jets are normalized to unit Euclidean length. The kernels can be distributed over several threads (set n_threads)."
+  )
+
+  .def(
+    "compute_jets_at",
+    &compute_jets_at,
+    (boost::python::arg("self"), boost::python::arg("input_image"), boost::python::arg("positions"), boost::python::arg("include_phases")=true, boost::python::arg("normalized")=true),
+    "Computes the Gabor jets only at the given positions, which is a 2D int32 array with one (y,x) position per row, and returns them as a 3D array (with phases) or 2D array (without phases). The resulting Gabor jets are identical to the ones of the jet image at these positions, but when only few positions are requested, they are computed much faster than the whole jet image."
   );
 
   boost::python::def(
@@ -29,7 +29,17 @@
 
 #include "bob/machine/BICMachine.h"
 #include "bob/math/linear.h"
+#include "bob/math/gemm.h"
+#include "bob/core/array_alias.h"
 #include "bob/core/array_assert.h"
+#include "bob/core/array_check.h"
+#include "bob/core/array_copy.h"
+#include "bob/core/parallel.h"
+#include <boost/bind.hpp>
+#include <algorithm>
+
+// Number of difference vectors that are projected with a single matrix product
+static const int BLOCK_SIZE = 256;
 
 static double sqr(const double& x){
   return x*x;
@@ -365,3 +375,121 @@ void bob::machine::BICMachine::forward(const blitz::Array<double,1>& input, blit
   forward_(input, output);
 }
 
+
+/**
+ * Computes the BIC or IEC scores for the input vectors [begin, end).
+ * In the BIC case, the difference vectors of a block are projected with a single matrix product for each class.
+ *
+ * @param  input  The vectors (of difference values), one per row
+ * @param  Phi_I  The (C-contiguous) intrapersonal projection matrix
+ * @param  Phi_E  The (C-contiguous) extrapersonal projection matrix
+ * @param  output The scores, one per input vector
+ * @param  begin  The first vector to compute the score for
+ * @param  end    The vector after the last one to compute the score for
+ */
+void bob::machine::BICMachine::forwardRange(
+    const blitz::Array<double,2>& input,
+    const blitz::Array<double,2>& Phi_I,
+    const blitz::Array<double,2>& Phi_E,
+    blitz::Array<double,1>& output,
+    const size_t begin,
+    const size_t end
+) const{
+  const int length = input.extent(1);
+  blitz::Range all = blitz::Range::all();
+
+  if (m_project_data){
+    const int kept_I = Phi_I.extent(1), kept_E = Phi_E.extent(1);
+    // the samples are views of an alias private to this thread
+    const blitz::Array<double,2> input_ = bob::core::array::alias(input);
+    // temporary storage of this thread
+    blitz::Array<double,2> diff_I(BLOCK_SIZE, length), diff_E(BLOCK_SIZE, length), proj_I(BLOCK_SIZE, kept_I), proj_E(BLOCK_SIZE, kept_E);
+
+    for (int b0 = begin; b0 < (int)end; b0 += BLOCK_SIZE){
+      const int n = std::min(BLOCK_SIZE, (int)end - b0);
+      blitz::Range rows(0, n-1);
+      blitz::Array<double,2> d_I = diff_I(rows, all), d_E = diff_E(rows, all), p_I = proj_I(rows, all), p_E = proj_E(rows, all);
+
+      // subtract means
+      for (int r = 0; r < n; ++r){
+        blitz::Array<double,1> x = input_(b0 + r, all);
+        d_I(r, all) = x - m_mu_I;
+        d_E(r, all) = x - m_mu_E;
+      }
+
+      // project all vectors of the block to intrapersonal and extrapersonal subspace
+      bob::math::gemm_(d_I, Phi_I, p_I);
+      bob::math::gemm_(d_E, Phi_E, p_E);
+
+      for (int r = 0; r < n; ++r){
+        // compute Mahalanobis distance
+        double res = 0., proj_norm_I = 0., proj_norm_E = 0.;
+        for (int i = 0; i < kept_E; ++i){
+          const double p = sqr(p_E(r,i));
+          res += p / m_lambda_E(i);
+          proj_norm_E += p;
+        }
+        for (int i = 0; i < kept_I; ++i){
+          const double p = sqr(p_I(r,i));
+          res -= p / m_lambda_I(i);
+          proj_norm_I += p;
+        }
+
+        // add the DFFS?
+        if (m_use_DFFS){
+          res += (sqr_norm(d_E(r, all)) - proj_norm_E) / m_rho_E
+              -  (sqr_norm(d_I(r, all)) - proj_norm_I) / m_rho_I;
+        }
+        output(b0 + r) = res / (kept_E + kept_I);
+      }
+    }
+  } else {
+    // forward without projection
+    for (int r = begin; r < (int)end; ++r){
+      double res = 0.;
+      for (int i = 0; i < length; ++i){
+        const double x = input(r, i);
+        res += sqr(x - m_mu_E(i)) / m_lambda_E(i)
+            -  sqr(x - m_mu_I(i)) / m_lambda_I(i);
+      }
+      output(r) = res / length;
+    }
+  }
+}
+
+/**
+ * Computes the BIC or IEC scores for the given input vectors.
+ * The scores are identical to the ones of the single-vector forward_ method.
+ * No sanity checks of input and output are performed.
+ *
+ * @param  input  The vectors (of difference values) to compute the BIC or IEC scores for, one vector per row.
+ * @param  output The array that will contain one score per input vector afterwards.
+ * @param  n_threads  The number of threads to split the input vectors over.
+ */
+void bob::machine::BICMachine::forward_(const blitz::Array<double,2>& input, blitz::Array<double,1>& output, const size_t n_threads) const{
+  // the projection matrices should be contiguous for the matrix products
+  blitz::Array<double,2> Phi_I = m_Phi_I, Phi_E = m_Phi_E;
+  if (m_project_data){
+    if (!bob::core::array::isCZeroBaseContiguous(Phi_I)) Phi_I.reference(bob::core::array::ccopy(m_Phi_I));
+    if (!bob::core::array::isCZeroBaseContiguous(Phi_E)) Phi_E.reference(bob::core::array::ccopy(m_Phi_E));
+  }
+
+  bob::core::thread_loop(boost::bind(&bob::machine::BICMachine::forwardRange, this, boost::cref(input), boost::cref(Phi_I), boost::cref(Phi_E), boost::ref(output), _1, _2), input.extent(0), n_threads);
+}
+
+/**
+ * Computes the BIC or IEC scores for the given input vectors.
+ * Sanity checks of input and output shape are performed.
+ *
+ * @param  input  The vectors (of difference values) to compute the BIC or IEC scores for, one vector per row.
+ * @param  output The array that will contain one score per input vector afterwards.
+ * @param  n_threads  The number of threads to split the input vectors over.
+ */
+void bob::machine::BICMachine::forward(const blitz::Array<double,2>& input, blitz::Array<double,1>& output, const size_t n_threads) const{
+  // perform some checks
+  bob::core::array::assertSameDimensionLength(input.extent(1), m_mu_E.extent(0));
+  bob::core::array::assertSameDimensionLength(output.extent(0), input.extent(0));
+
+  // call the actual method
+  forward_(input, output, n_threads);
+}
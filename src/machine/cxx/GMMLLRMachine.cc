@@ -19,6 +19,7 @@
  */
 #include "bob/machine/GMMLLRMachine.h"
 #include "bob/machine/Exception.h"
+#include "bob/core/array_assert.h"
 
 bob::machine::GMMLLRMachine::GMMLLRMachine(bob::io::HDF5File& config) {
   load(config);
@@ -107,6 +108,21 @@ void bob::machine::GMMLLRMachine::forward_(const blitz::Array<double,1>& input,
   output -= s_u;
 }
 
+void bob::machine::GMMLLRMachine::forward(const blitz::Array<double,2>& input, blitz::Array<double,1>& output, const size_t n_threads) const {
+  if (input.extent(1) != m_n_inputs) {
+    throw NInputsMismatch(m_n_inputs, input.extent(1));
+  }
+  bob::core::array::assertSameDimensionLength(input.extent(0), output.extent(0));
+  forward_(input, output, n_threads);
+}
+
+void bob::machine::GMMLLRMachine::forward_(const blitz::Array<double,2>& input, blitz::Array<double,1>& output, const size_t n_threads) const {
+  blitz::Array<double,1> s_u(output.extent(0));
+  m_gmm_client->forward_(input, output, n_threads);
+  m_gmm_ubm->forward_(input, s_u, n_threads);
+  output -= s_u;
+}
+
 bob::machine::GMMMachine* bob::machine::GMMLLRMachine::getGMMClient() const {
   return m_gmm_client;
 }
@@ -19,9 +19,17 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "bob/machine/GMMMachine.h"
+#include "bob/core/array_alias.h"
 #include "bob/core/array_assert.h"
+#include "bob/core/parallel.h"
 #include "bob/machine/Exception.h"
 #include "bob/math/log.h"
+#include "bob/math/gemm.h"
+#include <boost/bind.hpp>
+#include <algorithm>
+
+// Number of samples of which the log likelihoods are computed at once
+static const int BLOCK_SIZE = 256;
 
 bob::machine::GMMMachine::GMMMachine(): m_gaussians(0) {
   resize(0,0);
@@ -269,26 +277,264 @@ void bob::machine::GMMMachine::forward_(const blitz::Array<double,1>& input,
   output = logLikelihood(input);
 }
 
+void bob::machine::GMMMachine::forward(const blitz::Array<double,2>& input,
+    blitz::Array<double,1>& output, const size_t n_threads) const {
+  if(static_cast<size_t>(input.extent(1)) != m_n_inputs) {
+    throw NInputsMismatch(m_n_inputs, input.extent(1));
+  }
+  bob::core::array::assertZeroBase(input);
+  bob::core::array::assertZeroBase(output);
+  bob::core::array::assertSameDimensionLength(input.extent(0), output.extent(0));
+
+  forward_(input, output, n_threads);
+}
+
+void bob::machine::GMMMachine::likelihoodTerms(blitz::Array<double,2>& precisions,
+    blitz::Array<double,2>& scaled_means, blitz::Array<double,1>& constants) const {
+  // log(weight_i*p(x|gaussian_i)) = c_i + sum_d(x_d*mean_id/variance_id) - 0.5*sum_d(x_d^2/variance_id)
+  // where c_i = log(weight_i) - 0.5*(g_norm_i + sum_d(mean_id^2/variance_id))
+  precisions.resize(m_n_gaussians, m_n_inputs);
+  scaled_means.resize(m_n_gaussians, m_n_inputs);
+  constants.resize(m_n_gaussians);
+  blitz::Range a = blitz::Range::all();
+  for(size_t i=0; i<m_n_gaussians; ++i) {
+    const blitz::Array<double,1>& mean = m_gaussians[i]->getMean();
+    const blitz::Array<double,1>& variance = m_gaussians[i]->getVariance();
+    precisions(i,a) = -0.5 / variance;
+    scaled_means(i,a) = mean / variance;
+    const double g_norm = m_n_inputs * bob::math::Log::Log2Pi + blitz::sum(blitz::log(variance));
+    constants(i) = m_cache_log_weights(i) - 0.5 * (g_norm + blitz::sum(blitz::pow2(mean) / variance));
+  }
+}
+
+void bob::machine::GMMMachine::forward_(const blitz::Array<double,2>& input,
+    blitz::Array<double,1>& output, const size_t n_threads) const {
+  blitz::Array<double,2> precisions, scaled_means;
+  blitz::Array<double,1> constants;
+  likelihoodTerms(precisions, scaled_means, constants);
+
+  bob::core::thread_loop(boost::bind(&bob::machine::GMMMachine::forwardRange, this, boost::cref(input), boost::cref(precisions), boost::cref(scaled_means), boost::cref(constants), boost::ref(output), _1, _2), input.extent(0), n_threads);
+}
+
+void bob::machine::GMMMachine::forwardRange(const blitz::Array<double,2>& input,
+    const blitz::Array<double,2>& precisions, const blitz::Array<double,2>& scaled_means,
+    const blitz::Array<double,1>& constants, blitz::Array<double,1>& output,
+    const size_t begin, const size_t end) const {
+  const int n_gaussians = m_n_gaussians;
+  blitz::Range a = blitz::Range::all();
+  // the blocks are views of an alias private to this thread
+  const blitz::Array<double,2> input_ = bob::core::array::alias(input);
+  // buffers of this thread
+  blitz::Array<double,2> squares(BLOCK_SIZE, m_n_inputs);
+  blitz::Array<double,2> likelihoods(BLOCK_SIZE, m_n_gaussians);
+
+  for(int b=(int)begin; b<(int)end; b+=BLOCK_SIZE) {
+    const int n = std::min(BLOCK_SIZE, (int)end - b);
+    const blitz::Array<double,2> x = input_(blitz::Range(b, b+n-1), a);
+    blitz::Array<double,2> x2 = squares(blitz::Range(0, n-1), a);
+    blitz::Array<double,2> l = likelihoods(blitz::Range(0, n-1), a);
+    x2 = blitz::pow2(x);
+
+    // Gaussian log likelihoods of all samples of the block, without constants
+    bob::math::gemm_(x, scaled_means, l, false, true);
+    bob::math::gemm_(x2, precisions, l, false, true, 1., 1.);
+
+    for(int j=0; j<n; ++j) {
+      double log_likelihood = bob::math::Log::LogZero;
+      for(int i=0; i<n_gaussians; ++i)
+        log_likelihood = bob::math::Log::logAdd(log_likelihood, l(j,i) + constants(i));
+      output(b+j) = log_likelihood;
+    }
+  }
+}
+
+void bob::machine::GMMMachine::forward(const blitz::Array<float,2>& input,
+    blitz::Array<float,1>& output, const size_t n_threads) const {
+  if(static_cast<size_t>(input.extent(1)) != m_n_inputs) {
+    throw NInputsMismatch(m_n_inputs, input.extent(1));
+  }
+  bob::core::array::assertZeroBase(input);
+  bob::core::array::assertZeroBase(output);
+  bob::core::array::assertSameDimensionLength(input.extent(0), output.extent(0));
+
+  forward_(input, output, n_threads);
+}
+
+void bob::machine::GMMMachine::forward_(const blitz::Array<float,2>& input,
+    blitz::Array<float,1>& output, const size_t n_threads) const {
+  blitz::Array<double,2> precisions, scaled_means;
+  blitz::Array<double,1> constants;
+  likelihoodTerms(precisions, scaled_means, constants);
+  const blitz::Array<float,2> precisions_f(blitz::cast<float>(precisions));
+  const blitz::Array<float,2> scaled_means_f(blitz::cast<float>(scaled_means));
+
+  bob::core::thread_loop(boost::bind(&bob::machine::GMMMachine::forwardRangeFloat, this, boost::cref(input), boost::cref(precisions_f), boost::cref(scaled_means_f), boost::cref(constants), boost::ref(output), _1, _2), input.extent(0), n_threads);
+}
+
+void bob::machine::GMMMachine::blockLikelihoods(const blitz::Array<float,2>& x,
+    const blitz::Array<float,2>& precisions, const blitz::Array<float,2>& scaled_means,
+    const blitz::Array<double,1>& constants, blitz::Array<float,2>& squares,
+    blitz::Array<float,2>& likelihoods, blitz::Array<double,1>& log_likelihoods) const {
+  const int n_gaussians = m_n_gaussians;
+  squares = blitz::pow2(x);
+
+  // Gaussian log likelihoods of all samples of the block, without constants
+  bob::math::gemm_(x, scaled_means, likelihoods, false, true);
+  bob::math::gemm_(squares, precisions, likelihoods, false, true, 1.f, 1.f);
+
+  // the constants are added and the likelihoods combined in double precision
+  for(int j=0; j<x.extent(0); ++j) {
+    double log_likelihood = bob::math::Log::LogZero;
+    for(int i=0; i<n_gaussians; ++i) {
+      const double l = likelihoods(j,i) + constants(i);
+      likelihoods(j,i) = l;
+      log_likelihood = bob::math::Log::logAdd(log_likelihood, l);
+    }
+    log_likelihoods(j) = log_likelihood;
+  }
+}
+
+void bob::machine::GMMMachine::forwardRangeFloat(const blitz::Array<float,2>& input,
+    const blitz::Array<float,2>& precisions, const blitz::Array<float,2>& scaled_means,
+    const blitz::Array<double,1>& constants, blitz::Array<float,1>& output,
+    const size_t begin, const size_t end) const {
+  blitz::Range a = blitz::Range::all();
+  // the blocks are views of aliases private to this thread
+  const blitz::Array<float,2> input_ = bob::core::array::alias(input);
+  blitz::Array<float,1> output_ = bob::core::array::alias(output);
+  // buffers of this thread
+  blitz::Array<float,2> squares(BLOCK_SIZE, m_n_inputs);
+  blitz::Array<float,2> likelihoods(BLOCK_SIZE, m_n_gaussians);
+  blitz::Array<double,1> log_likelihoods(BLOCK_SIZE);
+
+  for(int b=(int)begin; b<(int)end; b+=BLOCK_SIZE) {
+    const int n = std::min(BLOCK_SIZE, (int)end - b);
+    const blitz::Range r(0, n-1);
+    const blitz::Array<float,2> x = input_(blitz::Range(b, b+n-1), a);
+    blitz::Array<float,2> x2 = squares(r, a);
+    blitz::Array<float,2> l = likelihoods(r, a);
+    blitz::Array<double,1> ll = log_likelihoods(r);
+    blockLikelihoods(x, precisions, scaled_means, constants, x2, l, ll);
+    output_(blitz::Range(b, b+n-1)) = blitz::cast<float>(ll);
+  }
+}
+
 void bob::machine::GMMMachine::accStatistics(const blitz::Array<double,2>& input,
-    bob::machine::GMMStats& stats) const {
+    bob::machine::GMMStats& stats, const size_t n_threads) const {
+  // check GMMStats size
+  bob::core::array::assertSameDimensionLength(stats.sumPx.extent(0), m_n_gaussians);
+  bob::core::array::assertSameDimensionLength(stats.sumPx.extent(1), m_n_inputs);
+  bob::core::array::assertSameDimensionLength(input.extent(1), m_n_inputs);
+
+  accStatistics_(input, stats, n_threads);
+}
+
+void bob::machine::GMMMachine::accStatistics_(const blitz::Array<double,2>& input,
+    bob::machine::GMMStats& stats, const size_t n_threads) const {
+  if(n_threads <= 1) {
+    accStatisticsRange(input, stats, 0, input.extent(0));
+    return;
+  }
+
+  // each thread accumulates its own statistics, which are merged at the end
+  std::vector<bob::machine::GMMStats> partial(n_threads, bob::machine::GMMStats(m_n_gaussians, m_n_inputs));
+  const size_t used = bob::core::thread_iloop(boost::bind(&bob::machine::GMMMachine::accStatisticsShard, this, boost::cref(input), boost::ref(partial), _1, _2, _3), input.extent(0), n_threads);
+
+  for(size_t k=0; k<used; ++k) stats += partial[k];
+}
+
+void bob::machine::GMMMachine::accStatisticsShard(const blitz::Array<double,2>& input,
+    std::vector<bob::machine::GMMStats>& stats, const size_t thread,
+    const size_t begin, const size_t end) const {
+  accStatisticsRange(input, stats[thread], begin, end);
+}
+
+void bob::machine::GMMMachine::accStatisticsRange(const blitz::Array<double,2>& input,
+    bob::machine::GMMStats& stats, const size_t begin, const size_t end) const {
+  // buffers of this call, which make it thread-safe
+  blitz::Array<double,1> log_weighted_gaussian_likelihoods(m_n_gaussians);
+  blitz::Array<double,1> P(m_n_gaussians);
+  blitz::Array<double,2> Px(m_n_gaussians, m_n_inputs);
+
+  // the samples are views of an alias private to this call
+  const blitz::Array<double,2> input_ = bob::core::array::alias(input);
+
   // iterate over data
   blitz::Range a = blitz::Range::all();
-  for(int i=0; i<input.extent(0); ++i) {
+  for(int i=(int)begin; i<(int)end; ++i) {
     // Get example
-    blitz::Array<double,1> x(input(i,a));
+    blitz::Array<double,1> x(input_(i, a));
     // Accumulate statistics
-    accStatistics(x,stats);
+    double log_likelihood = logLikelihood_(x, log_weighted_gaussian_likelihoods);
+    accStatisticsInternal(x, stats, log_likelihood, log_weighted_gaussian_likelihoods, P, Px);
   }
 }
 
-void bob::machine::GMMMachine::accStatistics_(const blitz::Array<double,2>& input, bob::machine::GMMStats& stats) const {
-  // iterate over data
+void bob::machine::GMMMachine::accStatistics(const blitz::Array<float,2>& input,
+    bob::machine::GMMStats& stats, const size_t n_threads) const {
+  if(static_cast<size_t>(input.extent(1)) != m_n_inputs) {
+    throw NInputsMismatch(m_n_inputs, input.extent(1));
+  }
+  bob::core::array::assertZeroBase(input);
+  bob::core::array::assertSameDimensionLength(stats.sumPx.extent(0), m_n_gaussians);
+  bob::core::array::assertSameDimensionLength(stats.sumPx.extent(1), m_n_inputs);
+
+  accStatistics_(input, stats, n_threads);
+}
+
+void bob::machine::GMMMachine::accStatistics_(const blitz::Array<float,2>& input,
+    bob::machine::GMMStats& stats, const size_t n_threads) const {
+  blitz::Array<double,2> precisions, scaled_means;
+  blitz::Array<double,1> constants;
+  likelihoodTerms(precisions, scaled_means, constants);
+  const blitz::Array<float,2> precisions_f(blitz::cast<float>(precisions));
+  const blitz::Array<float,2> scaled_means_f(blitz::cast<float>(scaled_means));
+
+  // each thread accumulates its own statistics, which are merged at the end
+  std::vector<bob::machine::GMMStats> partial(std::max(n_threads, (size_t)1), bob::machine::GMMStats(m_n_gaussians, m_n_inputs));
+  const size_t used = bob::core::thread_iloop(boost::bind(&bob::machine::GMMMachine::accStatisticsRangeFloat, this, boost::cref(input), boost::cref(precisions_f), boost::cref(scaled_means_f), boost::cref(constants), boost::ref(partial), _1, _2, _3), input.extent(0), n_threads);
+
+  for(size_t k=0; k<used; ++k) stats += partial[k];
+}
+
+void bob::machine::GMMMachine::accStatisticsRangeFloat(const blitz::Array<float,2>& input,
+    const blitz::Array<float,2>& precisions, const blitz::Array<float,2>& scaled_means,
+    const blitz::Array<double,1>& constants, std::vector<bob::machine::GMMStats>& stats,
+    const size_t thread, const size_t begin, const size_t end) const {
+  bob::machine::GMMStats& s = stats[thread];
   blitz::Range a = blitz::Range::all();
-  for(int i=0; i<input.extent(0); ++i) {
-    // Get example
-    blitz::Array<double,1> x(input(i, a));
-    // Accumulate statistics
-    accStatistics_(x,stats);
+  blitz::firstIndex i;
+  blitz::secondIndex j;
+  // the blocks are views of an alias private to this thread
+  const blitz::Array<float,2> input_ = bob::core::array::alias(input);
+  // buffers of this thread
+  blitz::Array<float,2> squares(BLOCK_SIZE, m_n_inputs);
+  blitz::Array<float,2> likelihoods(BLOCK_SIZE, m_n_gaussians);
+  blitz::Array<double,1> log_likelihoods(BLOCK_SIZE);
+  blitz::Array<float,2> sum_px(m_n_gaussians, m_n_inputs), sum_pxx(m_n_gaussians, m_n_inputs);
+
+  for(int b=(int)begin; b<(int)end; b+=BLOCK_SIZE) {
+    const int n = std::min(BLOCK_SIZE, (int)end - b);
+    const blitz::Range r(0, n-1);
+    const blitz::Array<float,2> x = input_(blitz::Range(b, b+n-1), a);
+    blitz::Array<float,2> x2 = squares(r, a);
+    blitz::Array<float,2> p = likelihoods(r, a);
+    blitz::Array<double,1> ll = log_likelihoods(r);
+    blockLikelihoods(x, precisions, scaled_means, constants, x2, p, ll);
+
+    // responsibilities
+    p = blitz::cast<float>(blitz::exp(p(i,j) - ll(i)));
+
+    // statistics of the block, added in double precision
+    bob::math::gemm_(p, x, sum_px, true, false);
+    bob::math::gemm_(p, x2, sum_pxx, true, false);
+    s.log_likelihood += blitz::sum(ll);
+    s.T += n;
+    for(int k=0; k<n; ++k)
+      for(size_t g=0; g<m_n_gaussians; ++g)
+        s.n(g) += p(k,g);
+    s.sumPx += blitz::cast<double>(sum_px);
+    s.sumPxx += blitz::cast<double>(sum_pxx);
   }
 }
 
@@ -316,9 +562,17 @@ void bob::machine::GMMMachine::accStatistics_(const blitz::Array<double, 1>& x,
 
 void bob::machine::GMMMachine::accStatisticsInternal(const blitz::Array<double, 1>& x,
   bob::machine::GMMStats& stats, const double log_likelihood) const 
+{
+  accStatisticsInternal(x, stats, log_likelihood, m_cache_log_weighted_gaussian_likelihoods, m_cache_P, m_cache_Px);
+}
+
+void bob::machine::GMMMachine::accStatisticsInternal(const blitz::Array<double, 1>& x,
+  bob::machine::GMMStats& stats, const double log_likelihood,
+  const blitz::Array<double,1>& log_weighted_gaussian_likelihoods,
+  blitz::Array<double,1>& P, blitz::Array<double,2>& Px) const 
 {
   // Calculate responsibilities
-  m_cache_P = blitz::exp(m_cache_log_weighted_gaussian_likelihoods - log_likelihood);
+  P = blitz::exp(log_weighted_gaussian_likelihoods - log_likelihood);
 
   // Accumulate statistics
   // - total likelihood
@@ -328,18 +582,18 @@ void bob::machine::GMMMachine::accStatisticsInternal(const blitz::Array<double,
   stats.T++;
 
   // - responsibilities
-  stats.n += m_cache_P;
+  stats.n += P;
 
   // - first order stats
   blitz::firstIndex i;
   blitz::secondIndex j;
   
-  m_cache_Px = m_cache_P(i) * x(j);
+  Px = P(i) * x(j);
   
-  stats.sumPx += m_cache_Px;
+  stats.sumPx += Px;
 
   // - second order stats
-  stats.sumPxx += (m_cache_Px(i,j) * x(j));
+  stats.sumPxx += (Px(i,j) * x(j));
 }
 
 
@@ -349,7 +603,7 @@ boost::shared_ptr<bob::machine::Gaussian> bob::machine::GMMMachine::getGaussian(
   return m_gaussians[i];
 }
 
-void bob::machine::GMMMachine::save(bob::io::HDF5File& config) const {
+void bob::machine::GMMMachine::save(bob::io::HDF5File& config, const bool single_precision) const {
   int64_t v = static_cast<int64_t>(m_n_gaussians);
   config.set("m_n_gaussians", v);
   v = static_cast<int64_t>(m_n_inputs);
@@ -361,11 +615,14 @@ void bob::machine::GMMMachine::save(bob::io::HDF5File& config) const {
    
     if (!config.hasGroup(oss.str())) config.createGroup(oss.str());
     config.cd(oss.str());
-    m_gaussians[i]->save(config);
+    m_gaussians[i]->save(config, single_precision);
     config.cd("..");
   }
 
-  config.setArray("m_weights", m_weights);
+  if (single_precision)
+    config.setArray("m_weights", blitz::Array<float,1>(blitz::cast<float>(m_weights)));
+  else
+    config.setArray("m_weights", m_weights);
 }
 
 void bob::machine::GMMMachine::load(bob::io::HDF5File& config) {
@@ -386,7 +643,7 @@ void bob::machine::GMMMachine::load(bob::io::HDF5File& config) {
   }
 
   m_weights.resize(m_n_gaussians);
-  config.readArray("m_weights", m_weights);
+  config.readFloatArray("m_weights", m_weights);
 
   // Initialise cache
   initCache();
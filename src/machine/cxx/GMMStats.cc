@@ -115,7 +115,7 @@ void bob::machine::GMMStats::init() {
   sumPxx = 0.0;
 }
 
-void bob::machine::GMMStats::save(bob::io::HDF5File& config) const {
+void bob::machine::GMMStats::save(bob::io::HDF5File& config, const bool single_precision) const {
   //please note we fix the output values to be of a precise type so they can be
   //retrieved at any platform with the exact same precision.
   // TODO: add versioning, replace int64_t by uint64_t and log_liklihood by log_likelihood
@@ -125,9 +125,16 @@ void bob::machine::GMMStats::save(bob::io::HDF5File& config) const {
   config.set("n_inputs", sumpx_shape_1);
   config.set("log_liklihood", log_likelihood); //double
   config.set("T", static_cast<int64_t>(T));
-  config.setArray("n", n); //Array1d
-  config.setArray("sumPx", sumPx); //Array2d
-  config.setArray("sumPxx", sumPxx); //Array2d
+  if (single_precision) {
+    config.setArray("n", blitz::Array<float,1>(blitz::cast<float>(n))); //Array1d
+    config.setArray("sumPx", blitz::Array<float,2>(blitz::cast<float>(sumPx))); //Array2d
+    config.setArray("sumPxx", blitz::Array<float,2>(blitz::cast<float>(sumPxx))); //Array2d
+  }
+  else {
+    config.setArray("n", n); //Array1d
+    config.setArray("sumPx", sumPx); //Array2d
+    config.setArray("sumPxx", sumPxx); //Array2d
+  }
 }
 
 void bob::machine::GMMStats::load(bob::io::HDF5File& config) {
@@ -142,9 +149,9 @@ void bob::machine::GMMStats::load(bob::io::HDF5File& config) {
   sumPxx.resize(n_gaussians, n_inputs);
   
   //load data
-  config.readArray("n", n);
-  config.readArray("sumPx", sumPx);
-  config.readArray("sumPxx", sumPxx);
+  config.readFloatArray("n", n);
+  config.readFloatArray("sumPx", sumPx);
+  config.readFloatArray("sumPxx", sumPxx);
 }
 
 namespace bob {
@@ -0,0 +1,156 @@
+/**
+ * @file machine/cxx/GaborGraphGallery.cc
+ * @date Mon Oct 19 19:03:25 2026 +0200
+ *
+ * @brief Implements the many-vs-many Gabor graph similarity computation
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bob/machine/GaborGraphGallery.h"
+#include "bob/core/Exception.h"
+#include "bob/core/array_alias.h"
+#include "bob/core/array_assert.h"
+#include "bob/core/array_check.h"
+#include "bob/core/array_copy.h"
+#include "bob/core/parallel.h"
+#include "bob/math/gemm.h"
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+
+// Number of probe graphs that are compared to a gallery graph in a row,
+// such that the probe jets stay in the cache
+static const int PROBE_BLOCK = 16;
+
+bob::machine::GaborGraphGallery::GaborGraphGallery(const bob::machine::GaborJetSimilarity& jet_similarity_function)
+:
+  m_similarity(jet_similarity_function)
+{
+}
+
+void bob::machine::GaborGraphGallery::setGraphs(const blitz::Array<double,3>& graph_jets){
+  if (m_similarity.type() >= GaborJetSimilarity::DISPARITY)
+    throw bob::core::NotImplementedError("Disparity similarity (and its derivatives) need Gabor jets including phases");
+  m_abs.reference(bob::core::array::ccopy(graph_jets));
+  m_phases.resize(0,0,0);
+}
+
+void bob::machine::GaborGraphGallery::setGraphs(const blitz::Array<double,4>& graph_jets){
+  split(graph_jets, m_abs, m_phases);
+}
+
+void bob::machine::GaborGraphGallery::split(const blitz::Array<double,4>& graph_jets, blitz::Array<double,3>& abs, blitz::Array<double,3>& phases) const{
+  bob::core::array::assertSameDimensionLength(graph_jets.extent(2), 2);
+  blitz::Range all = blitz::Range::all();
+  abs.resize(graph_jets.extent(0), graph_jets.extent(1), graph_jets.extent(3));
+  abs = graph_jets(all, all, 0, all);
+  if (m_similarity.type() >= GaborJetSimilarity::DISPARITY){
+    phases.resize(abs.shape());
+    phases = graph_jets(all, all, 1, all);
+  } else {
+    phases.resize(0,0,0);
+  }
+}
+
+void bob::machine::GaborGraphGallery::check(const blitz::Array<double,3>& probe_abs, const blitz::Array<double,2>& similarities) const{
+  bob::core::array::assertZeroBase(similarities);
+  bob::core::array::assertSameDimensionLength(probe_abs.extent(1), numberOfNodes());
+  bob::core::array::assertSameDimensionLength(probe_abs.extent(2), numberOfJets());
+  bob::core::array::assertSameDimensionLength(similarities.extent(0), numberOfGraphs());
+  bob::core::array::assertSameDimensionLength(similarities.extent(1), probe_abs.extent(0));
+  if (m_similarity.type() >= GaborJetSimilarity::DISPARITY)
+    bob::core::array::assertSameDimensionLength(numberOfJets(), m_similarity.m_gwt.numberOfKernels());
+}
+
+void bob::machine::GaborGraphGallery::similarity(const blitz::Array<double,3>& probe_graph_jets, blitz::Array<double,2>& similarities, const size_t n_threads) const{
+  if (m_similarity.type() >= GaborJetSimilarity::DISPARITY)
+    throw bob::core::NotImplementedError("Disparity similarity (and its derivatives) need Gabor jets including phases");
+
+  // the probe jets need to be contiguous
+  blitz::Array<double,3> probe_abs = probe_graph_jets;
+  if (!bob::core::array::isCZeroBaseContiguous(probe_abs))
+    probe_abs.reference(bob::core::array::ccopy(probe_graph_jets));
+  blitz::Array<double,3> probe_phases;
+  check(probe_abs, similarities);
+
+  bob::core::thread_loop(boost::bind(&bob::machine::GaborGraphGallery::similarityRange, this, boost::cref(probe_abs), boost::cref(probe_phases), boost::ref(similarities), _1, _2), numberOfGraphs(), n_threads);
+}
+
+void bob::machine::GaborGraphGallery::similarity(const blitz::Array<double,4>& probe_graph_jets, blitz::Array<double,2>& similarities, const size_t n_threads) const{
+  blitz::Array<double,3> probe_abs, probe_phases;
+  split(probe_graph_jets, probe_abs, probe_phases);
+  check(probe_abs, similarities);
+
+  bob::core::thread_loop(boost::bind(&bob::machine::GaborGraphGallery::similarityRange, this, boost::cref(probe_abs), boost::cref(probe_phases), boost::ref(similarities), _1, _2), numberOfGraphs(), n_threads);
+}
+
+void bob::machine::GaborGraphGallery::similarityRange(const blitz::Array<double,3>& probe_abs, const blitz::Array<double,3>& probe_phases, blitz::Array<double,2>& similarities, const size_t begin, const size_t end) const{
+  const int nodes = numberOfNodes(), jets = numberOfJets(), probes = probe_abs.extent(0);
+  const int size = nodes * jets;
+
+  switch (m_similarity.type()){
+    case GaborJetSimilarity::SCALAR_PRODUCT:{
+      // the average of the scalar products of the jets is the scalar product of the whole graphs, divided by the number of nodes
+      const blitz::Array<double,2> gallery(const_cast<double*>(m_abs.data()) + begin * size, blitz::shape((int)(end - begin), size), blitz::neverDeleteData);
+      const blitz::Array<double,2> probe(const_cast<double*>(probe_abs.data()), blitz::shape(probes, size), blitz::neverDeleteData);
+      blitz::Array<double,2> sim = bob::core::array::alias(similarities)(blitz::Range((int)begin, (int)end-1), blitz::Range::all());
+      bob::math::gemm_(gallery, probe, sim, false, true, 1. / nodes);
+      break;
+    }
+
+    case GaborJetSimilarity::CANBERRA:{
+      // the average of the Canberra similarities of the jets, computed in a single (vectorizable) loop over all jet entries
+      for (int p0 = 0; p0 < probes; p0 += PROBE_BLOCK){
+        const int p1 = std::min(p0 + PROBE_BLOCK, probes);
+        for (int g = begin; g < (int)end; ++g){
+          const double* a = m_abs.data() + g * size;
+          for (int p = p0; p < p1; ++p){
+            const double* b = probe_abs.data() + p * size;
+            double sum = 0.;
+            for (int k = 0; k < size; ++k){
+              sum += std::abs(a[k] - b[k]) / (a[k] + b[k]);
+            }
+            similarities(g,p) = (size - sum) / size;
+          }
+        }
+      }
+      break;
+    }
+
+    default:{
+      // disparity-like similarities, each thread with its own buffers
+      std::vector<double> confidences(jets), phase_differences(jets);
+      blitz::TinyVector<double,2> disparity;
+      for (int p0 = 0; p0 < probes; p0 += PROBE_BLOCK){
+        const int p1 = std::min(p0 + PROBE_BLOCK, probes);
+        for (int g = begin; g < (int)end; ++g){
+          const double* a = m_abs.data() + g * size;
+          const double* pa = m_phases.data() + g * size;
+          for (int p = p0; p < p1; ++p){
+            const double* b = probe_abs.data() + p * size;
+            const double* pb = probe_phases.data() + p * size;
+            double sum = 0.;
+            for (int n = 0; n < nodes; ++n){
+              sum += m_similarity.similarity(a + n * jets, pa + n * jets, b + n * jets, pb + n * jets, &confidences[0], &phase_differences[0], disparity);
+            }
+            similarities(g,p) = sum / nodes;
+          }
+        }
+      }
+    }
+  }
+}
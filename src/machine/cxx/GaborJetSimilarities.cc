@@ -87,11 +87,27 @@ double bob::machine::GaborJetSimilarity::operator()(const blitz::Array<double,2>
   bob::core::array::assertCZeroBaseContiguous(jet2);
   bob::core::array::assertSameShape(jet1,jet2);
 
+  // absolute values are stored in the first row, phases in the second row
+  const int size = jet1.extent(1);
+  return similarity(jet1.data(), jet1.data() + size, jet2.data(), jet2.data() + size, &m_confidences[0], &m_phase_differences[0], m_disparity);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////  Disparity estimation  /////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static double adjustPhase(double phase){
+  return phase - (2.*M_PI)*round(phase / (2.*M_PI));
+}
+
+double bob::machine::GaborJetSimilarity::similarity(const double* abs1, const double* phase1, const double* abs2, const double* phase2, double* confidences, double* phase_differences, blitz::TinyVector<double,2>& disparity) const{
+  const int size = m_gwt.numberOfKernels();
+
   // compute confidence vectors
-  compute_confidences(jet1, jet2);
+  compute_confidences(abs1, phase1, abs2, phase2, confidences, phase_differences);
 
   // now, compute the disparity
-  compute_disparity();
+  compute_disparity(confidences, phase_differences, disparity);
 
   const std::vector<blitz::TinyVector<double,2> >& kernels = m_gwt.kernelFrequencies();
 
@@ -99,8 +115,8 @@ double bob::machine::GaborJetSimilarity::operator()(const blitz::Array<double,2>
     case DISPARITY:{
       // compute the similarity using the estimated disparity
       double sum = 0.;
-      for (int j = m_confidences.size(); j--;){
-        sum += m_confidences[j] * cos(m_phase_differences[j] - m_disparity[0] * kernels[j][0] - m_disparity[1] * kernels[j][1]);
+      for (int j = size; j--;){
+        sum += confidences[j] * cos(phase_differences[j] - disparity[0] * kernels[j][0] - disparity[1] * kernels[j][1]);
       }
       return sum;
     } // DISPARITY
@@ -108,22 +124,22 @@ double bob::machine::GaborJetSimilarity::operator()(const blitz::Array<double,2>
     case PHASE_DIFF:{
       // compute the similarity using the estimated disparity
       double sum = 0.;
-      for (int j = m_phase_differences.size(); j--;){
-        sum += cos(m_phase_differences[j] - m_disparity[0] * kernels[j][0] - m_disparity[1] * kernels[j][1]);
+      for (int j = size; j--;){
+        sum += cos(phase_differences[j] - disparity[0] * kernels[j][0] - disparity[1] * kernels[j][1]);
       }
-      return sum / jet1.shape()[1];
+      return sum / size;
     } // PHASE_DIFF
 
     case PHASE_DIFF_PLUS_CANBERRA:{
       // compute the similarity using the estimated disparity
       double sum = 0.;
-      for (int j = m_phase_differences.size(); j--;){
+      for (int j = size; j--;){
         // add disparity term
-        sum += cos(m_phase_differences[j] - m_disparity[0] * kernels[j][0] - m_disparity[1] * kernels[j][1]);
+        sum += cos(phase_differences[j] - disparity[0] * kernels[j][0] - disparity[1] * kernels[j][1]);
         // add Canberra term
-        sum += 1. - std::abs(jet1(0,j) - jet2(0,j)) / (jet1(0,j) + jet2(0,j));
+        sum += 1. - std::abs(abs1[j] - abs2[j]) / (abs1[j] + abs2[j]);
       }
-      return sum / (2. * jet1.shape()[1]);
+      return sum / (2. * size);
     }
 
     default:
@@ -132,37 +148,29 @@ double bob::machine::GaborJetSimilarity::operator()(const blitz::Array<double,2>
   }
 }
 
-
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-////////////////  Disparity estimation  /////////////////////////////////////////////////////////////////////////
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-static double adjustPhase(double phase){
-  return phase - (2.*M_PI)*round(phase / (2.*M_PI));
-}
-
-void bob::machine::GaborJetSimilarity::compute_confidences(const blitz::Array<double,2>& jet1, const blitz::Array<double,2>& jet2) const{
+void bob::machine::GaborJetSimilarity::compute_confidences(const double* abs1, const double* phase1, const double* abs2, const double* phase2, double* confidences, double* phase_differences) const{
   // first, fill confidence and phase difference vectors
-  for (int j = m_confidences.size(); j--;){
-    m_confidences[j] = jet1(0,j) * jet2(0,j);
-    m_phase_differences[j] = adjustPhase(jet1(1,j) - jet2(1,j));
+  for (int j = m_gwt.numberOfKernels(); j--;){
+    confidences[j] = abs1[j] * abs2[j];
+    phase_differences[j] = adjustPhase(phase1[j] - phase2[j]);
   }
 }
 
-void bob::machine::GaborJetSimilarity::compute_disparity() const{
+void bob::machine::GaborJetSimilarity::compute_disparity(const double* confidences, const double* phase_differences, blitz::TinyVector<double,2>& disparity) const{
   // approximate the disparity from the phase differences
   double gamma_x_x = 0., gamma_x_y = 0., gamma_y_y = 0., phi_x = 0., phi_y = 0.;
   // initialize the disparity with 0
-  m_disparity = 0.;
+  disparity = 0.;
 
   const std::vector<blitz::TinyVector<double,2> >& kernels = m_gwt.kernelFrequencies();
   // iterate backwards through the vector to start with the lowest frequency wavelets
-  for (int j = m_confidences.size()-1, level = m_gwt.numberOfScales()-1; level >= 0; --level){
+  for (int j = m_gwt.numberOfKernels()-1, level = m_gwt.numberOfScales()-1; level >= 0; --level){
     for (int direction = m_gwt.numberOfDirections()-1; direction >= 0; --direction, --j){
       double
           kjx = kernels[j][1],
           kjy = kernels[j][0],
-          conf = m_confidences[j],
-          diff = m_phase_differences[j];
+          conf = confidences[j],
+          diff = phase_differences[j];
 
       // totalize gamma matrix
       gamma_x_x += kjx * kjx * conf;
@@ -171,7 +179,7 @@ void bob::machine::GaborJetSimilarity::compute_disparity() const{
 
       // totalize phi vector
       // estimate the number of cycles that we are off
-      double nL = round((diff - m_disparity[1] * kjx - m_disparity[0] * kjy) / (2.*M_PI));
+      double nL = round((diff - disparity[1] * kjx - disparity[0] * kjy) / (2.*M_PI));
       // totalize corrected phi vector elements
       phi_x += (diff - nL * 2. * M_PI) * conf * kjx;
       phi_y += (diff - nL * 2. * M_PI) * conf * kjy;
@@ -179,8 +187,8 @@ void bob::machine::GaborJetSimilarity::compute_disparity() const{
 
     // re-calculate disparity as d=\Gamma^{-1}\Phi of the (low frequency) wavelet scales that we used up to now
     double gamma_det = gamma_x_x * gamma_y_y - sqr(gamma_x_y);
-    m_disparity[1] = (gamma_y_y * phi_x - gamma_x_y * phi_y) / gamma_det;
-    m_disparity[0] = (gamma_x_x * phi_y - gamma_x_y * phi_x) / gamma_det;
+    disparity[1] = (gamma_y_y * phi_x - gamma_x_y * phi_y) / gamma_det;
+    disparity[0] = (gamma_x_x * phi_y - gamma_x_y * phi_x) / gamma_det;
 
   } // for level
 }
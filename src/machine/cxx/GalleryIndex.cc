@@ -0,0 +1,362 @@
+/**
+ * @file machine/cxx/GalleryIndex.cc
+ * @date Mon Oct 19 18:12:47 2026 +0200
+ *
+ * @brief Implements the GalleryIndex for 1:N search
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bob/machine/GalleryIndex.h"
+#include "bob/machine/Exception.h"
+#include "bob/math/gemm.h"
+#include "bob/core/array_alias.h"
+#include "bob/core/array_assert.h"
+#include "bob/core/array_copy.h"
+#include "bob/core/parallel.h"
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+namespace ca = bob::core::array;
+
+/**
+ * Number of models scored at once against a block of probes, and number of
+ * probes in such a block. The scores of a block are computed with a single
+ * matrix product, and then pushed into the heaps of the probes.
+ */
+static const int MODEL_TILE = 1024;
+static const int PROBE_BLOCK = 64;
+
+/**
+ * Initial number of rows of the model matrix
+ */
+static const size_t MIN_CAPACITY = 16;
+
+/**
+ * Order of the search results: decreasing scores, then increasing ids
+ */
+static bool better(const std::pair<float,int64_t>& a,
+    const std::pair<float,int64_t>& b) {
+  return a.first > b.first || (a.first == b.first && a.second < b.second);
+}
+
+bob::machine::GalleryIndex::GalleryIndex(const size_t n_inputs,
+    const bool normalize):
+  m_n_inputs(n_inputs),
+  m_dimension(n_inputs),
+  m_normalize(normalize),
+  m_models(0, n_inputs)
+{
+}
+
+bob::machine::GalleryIndex::GalleryIndex(
+    const bob::machine::LinearMachine& projection, const bool normalize):
+  m_n_inputs(projection.inputSize()),
+  m_dimension(projection.outputSize()),
+  m_normalize(normalize),
+  m_models(0, projection.outputSize())
+{
+  if (projection.getActivation() != bob::machine::LINEAR)
+    throw std::runtime_error("the projection of a GalleryIndex must have a linear activation");
+  projection.fold(m_weight, m_bias);
+}
+
+bob::machine::GalleryIndex::GalleryIndex(
+    const bob::machine::GalleryIndex& other):
+  m_n_inputs(other.m_n_inputs),
+  m_dimension(other.m_dimension),
+  m_normalize(other.m_normalize),
+  m_weight(ca::ccopy(other.m_weight)),
+  m_bias(ca::ccopy(other.m_bias)),
+  m_models(ca::ccopy(other.m_models)),
+  m_ids(other.m_ids),
+  m_rows(other.m_rows)
+{
+}
+
+bob::machine::GalleryIndex::GalleryIndex(bob::io::HDF5File& config)
+{
+  load(config);
+}
+
+bob::machine::GalleryIndex::~GalleryIndex() {}
+
+bob::machine::GalleryIndex& bob::machine::GalleryIndex::operator=
+(const bob::machine::GalleryIndex& other) {
+  if (this != &other)
+  {
+    m_n_inputs = other.m_n_inputs;
+    m_dimension = other.m_dimension;
+    m_normalize = other.m_normalize;
+    m_weight.reference(ca::ccopy(other.m_weight));
+    m_bias.reference(ca::ccopy(other.m_bias));
+    m_models.reference(ca::ccopy(other.m_models));
+    m_ids = other.m_ids;
+    m_rows = other.m_rows;
+  }
+  return *this;
+}
+
+void bob::machine::GalleryIndex::load(bob::io::HDF5File& config) {
+  // everything is read and checked first, so that a failed load leaves the
+  // index untouched
+  const size_t n_inputs = config.read<int64_t>("n_inputs");
+  const bool normalize = config.read<bool>("normalize");
+  blitz::Array<double,2> weight;
+  blitz::Array<double,1> bias;
+  size_t dimension = n_inputs;
+  if (config.read<bool>("has_projection")) {
+    weight.reference(config.readArray<double,2>("weights"));
+    bias.reference(config.readArray<double,1>("biases"));
+    dimension = weight.extent(1);
+  }
+  else {
+    weight.resize(0,0);
+    bias.resize(0);
+  }
+
+  const int64_t n_models = config.read<int64_t>("n_models");
+  blitz::Array<float,2> models;
+  std::vector<int64_t> ids;
+  std::map<int64_t,size_t> rows;
+  if (n_models > 0) {
+    models.reference(config.readArray<float,2>("models"));
+    blitz::Array<int64_t,1> ids_ = config.readArray<int64_t,1>("ids");
+    ca::assertSameDimensionLength(models.extent(0), n_models);
+    ca::assertSameDimensionLength(models.extent(1), dimension);
+    ca::assertSameDimensionLength(ids_.extent(0), n_models);
+    for (int64_t i=0; i<n_models; ++i) {
+      if (!rows.insert(std::make_pair(ids_(i), (size_t)i)).second)
+        throw std::runtime_error((boost::format("the model id %d is stored twice in the GalleryIndex file") % ids_(i)).str());
+      ids.push_back(ids_(i));
+    }
+  }
+  else models.resize(0, dimension);
+
+  m_n_inputs = n_inputs;
+  m_normalize = normalize;
+  m_dimension = dimension;
+  m_weight.reference(weight);
+  m_bias.reference(bias);
+  m_models.reference(models);
+  m_ids.swap(ids);
+  m_rows.swap(rows);
+}
+
+void bob::machine::GalleryIndex::save(bob::io::HDF5File& config) const {
+  config.set("n_inputs", static_cast<int64_t>(m_n_inputs));
+  config.set("normalize", m_normalize);
+  const bool has_projection = (m_weight.size() != 0);
+  config.set("has_projection", has_projection);
+  if (has_projection) {
+    config.setArray("weights", m_weight);
+    config.setArray("biases", m_bias);
+  }
+  config.set("n_models", static_cast<int64_t>(size()));
+  if (size() > 0) {
+    config.setArray("models", ca::ccopy(m_models(blitz::Range(0, size()-1),
+            blitz::Range::all())));
+    blitz::Array<int64_t,1> ids(size());
+    for (size_t i=0; i<size(); ++i) ids(i) = m_ids[i];
+    config.setArray("ids", ids);
+  }
+}
+
+bool bob::machine::GalleryIndex::contains(const int64_t id) const {
+  return m_rows.find(id) != m_rows.end();
+}
+
+void bob::machine::GalleryIndex::preprocess
+(const blitz::Array<double,2>& input, blitz::Array<float,2>& output) const {
+  blitz::Array<double,2> projected = input;
+  if (m_weight.size() != 0) {
+    projected.reference(blitz::Array<double,2>(input.extent(0), m_dimension));
+    bob::math::gemm(input, m_weight, projected);
+    blitz::firstIndex i;
+    blitz::secondIndex j;
+    projected = projected(i,j) + m_bias(j);
+  }
+
+  output.resize(input.extent(0), m_dimension);
+  for (int r=0; r<input.extent(0); ++r) {
+    blitz::Array<double,1> row = projected(r, blitz::Range::all());
+    blitz::Array<float,1> out = output(r, blitz::Range::all());
+    double norm = 1.;
+    if (m_normalize) {
+      norm = std::sqrt(blitz::sum(blitz::pow2(row)));
+      if (norm <= 0.) norm = 1.;
+    }
+    out = blitz::cast<float>(row / norm);
+  }
+}
+
+void bob::machine::GalleryIndex::reserve(const size_t n_models) {
+  if (n_models > (size_t)m_models.extent(0))
+    m_models.resizeAndPreserve(n_models, m_dimension);
+}
+
+void bob::machine::GalleryIndex::insert(const int64_t id,
+    const blitz::Array<float,1>& model) {
+  std::map<int64_t,size_t>::const_iterator it = m_rows.find(id);
+  if (it != m_rows.end()) {
+    m_models(it->second, blitz::Range::all()) = model;
+    return;
+  }
+  const size_t row = size();
+  if (row == (size_t)m_models.extent(0))
+    reserve(std::max(2*row, MIN_CAPACITY));
+  m_models(row, blitz::Range::all()) = model;
+  m_ids.push_back(id);
+  m_rows[id] = row;
+}
+
+void bob::machine::GalleryIndex::add(const int64_t id,
+    const blitz::Array<double,1>& model) {
+  if ((size_t)model.extent(0) != m_n_inputs)
+    throw bob::machine::NInputsMismatch(m_n_inputs, model.extent(0));
+  blitz::Array<double,2> input(1, m_n_inputs);
+  input(0, blitz::Range::all()) = model;
+  blitz::Array<float,2> output;
+  preprocess(input, output);
+  insert(id, output(0, blitz::Range::all()));
+}
+
+void bob::machine::GalleryIndex::add(const blitz::Array<int64_t,1>& ids,
+    const blitz::Array<double,2>& models) {
+  ca::assertZeroBase(models);
+  ca::assertSameDimensionLength(ids.extent(0), models.extent(0));
+  if ((size_t)models.extent(1) != m_n_inputs)
+    throw bob::machine::NInputsMismatch(m_n_inputs, models.extent(1));
+  blitz::Array<float,2> output;
+  preprocess(models, output);
+  reserve(size() + ids.extent(0));
+  for (int i=0; i<ids.extent(0); ++i)
+    insert(ids(i), output(i, blitz::Range::all()));
+}
+
+bool bob::machine::GalleryIndex::remove(const int64_t id) {
+  std::map<int64_t,size_t>::iterator it = m_rows.find(id);
+  if (it == m_rows.end()) return false;
+
+  // The last model is moved into the freed row, to keep the rows contiguous
+  const size_t row = it->second;
+  const size_t last = size() - 1;
+  if (row != last) {
+    m_models(row, blitz::Range::all()) = m_models(last, blitz::Range::all());
+    m_ids[row] = m_ids[last];
+    m_rows[m_ids[row]] = row;
+  }
+  m_ids.pop_back();
+  m_rows.erase(id);
+  return true;
+}
+
+void bob::machine::GalleryIndex::clear() {
+  m_ids.clear();
+  m_rows.clear();
+  m_models.resize(0, m_dimension);
+}
+
+blitz::Array<float,1> bob::machine::GalleryIndex::getModel
+(const int64_t id) const {
+  std::map<int64_t,size_t>::const_iterator it = m_rows.find(id);
+  if (it == m_rows.end())
+    throw std::runtime_error((boost::format("there is no model with id %d in the GalleryIndex") % id).str());
+  return ca::ccopy(m_models(it->second, blitz::Range::all()));
+}
+
+void bob::machine::GalleryIndex::searchRange
+(const blitz::Array<float,2>& probes, const size_t k,
+ std::vector<std::vector<std::vector<entry_type> > >& heaps,
+ const size_t t, const size_t begin, const size_t end) const {
+  std::vector<std::vector<entry_type> >& heaps_t = heaps[t];
+  heaps_t.resize(probes.extent(0));
+  const int n_probes = probes.extent(0);
+  blitz::Array<float,2> scores(std::min(PROBE_BLOCK, n_probes),
+      std::min(MODEL_TILE, (int)(end-begin)));
+  const blitz::Range all = blitz::Range::all();
+  // the tiles are views of aliases private to this thread
+  const blitz::Array<float,2> models_ = ca::alias(m_models);
+  const blitz::Array<float,2> probes_ = ca::alias(probes);
+
+  for (int m0=begin; m0<(int)end; m0+=MODEL_TILE) {
+    const int nm = std::min(MODEL_TILE, (int)end-m0);
+    const blitz::Array<float,2> models = models_(blitz::Range(m0, m0+nm-1), all);
+    for (int p0=0; p0<n_probes; p0+=PROBE_BLOCK) {
+      const int np = std::min(PROBE_BLOCK, n_probes-p0);
+      const blitz::Array<float,2> probes_b = probes_(blitz::Range(p0, p0+np-1), all);
+      blitz::Array<float,2> scores_b = scores(blitz::Range(0, np-1), blitz::Range(0, nm-1));
+      bob::math::gemm_(probes_b, models, scores_b, false, true);
+
+      for (int p=0; p<np; ++p) {
+        std::vector<entry_type>& heap = heaps_t[p0+p];
+        for (int m=0; m<nm; ++m) {
+          const entry_type e(scores_b(p,m), m_ids[m0+m]);
+          if (heap.size() < k) {
+            heap.push_back(e);
+            std::push_heap(heap.begin(), heap.end(), better);
+          }
+          else if (better(e, heap.front())) {
+            // the front of the heap is the worst of the k best scores
+            std::pop_heap(heap.begin(), heap.end(), better);
+            heap.back() = e;
+            std::push_heap(heap.begin(), heap.end(), better);
+          }
+        }
+      }
+    }
+  }
+}
+
+void bob::machine::GalleryIndex::search(const blitz::Array<double,2>& probes,
+    const size_t k, blitz::Array<int64_t,2>& ids,
+    blitz::Array<double,2>& scores, const size_t n_threads) const {
+  ca::assertZeroBase(probes);
+  if ((size_t)probes.extent(1) != m_n_inputs)
+    throw bob::machine::NInputsMismatch(m_n_inputs, probes.extent(1));
+
+  const int n_probes = probes.extent(0);
+  const size_t kk = std::min(k, size());
+  ids.resize(n_probes, kk);
+  scores.resize(n_probes, kk);
+  if (kk == 0 || n_probes == 0) return;
+
+  blitz::Array<float,2> probes_;
+  preprocess(probes, probes_);
+
+  // The gallery is split across the threads, each of them tracking the
+  // k best scores of all the probes against its part of the gallery
+  std::vector<std::vector<std::vector<entry_type> > > heaps(std::max(n_threads, (size_t)1));
+  const size_t n_blocks = bob::core::thread_iloop(
+      boost::bind(&bob::machine::GalleryIndex::searchRange, this,
+        boost::cref(probes_), kk, boost::ref(heaps), _1, _2, _3),
+      size(), n_threads);
+
+  // Merges the results of the threads
+  std::vector<entry_type> best;
+  for (int p=0; p<n_probes; ++p) {
+    best.clear();
+    for (size_t t=0; t<n_blocks; ++t)
+      best.insert(best.end(), heaps[t][p].begin(), heaps[t][p].end());
+    std::partial_sort(best.begin(), best.begin()+kk, best.end(), better);
+    for (size_t i=0; i<kk; ++i) {
+      ids(p,i) = best[i].second;
+      scores(p,i) = best[i].first;
+    }
+  }
+}
@@ -164,10 +164,17 @@ void bob::machine::Gaussian::preComputeConstants() {
   m_g_norm = m_n_log2pi + blitz::sum(blitz::log(m_variance));
 }
 
-void bob::machine::Gaussian::save(bob::io::HDF5File& config) const {
-  config.setArray("m_mean", m_mean);
-  config.setArray("m_variance", m_variance);
-  config.setArray("m_variance_thresholds", m_variance_thresholds);
+void bob::machine::Gaussian::save(bob::io::HDF5File& config, const bool single_precision) const {
+  if (single_precision) {
+    config.setArray("m_mean", blitz::Array<float,1>(blitz::cast<float>(m_mean)));
+    config.setArray("m_variance", blitz::Array<float,1>(blitz::cast<float>(m_variance)));
+    config.setArray("m_variance_thresholds", blitz::Array<float,1>(blitz::cast<float>(m_variance_thresholds)));
+  }
+  else {
+    config.setArray("m_mean", m_mean);
+    config.setArray("m_variance", m_variance);
+    config.setArray("m_variance_thresholds", m_variance_thresholds);
+  }
   config.set("g_norm", m_g_norm);
   int64_t v = static_cast<int64_t>(m_n_inputs);
   config.set("m_n_inputs", v);
@@ -181,12 +188,16 @@ void bob::machine::Gaussian::load(bob::io::HDF5File& config) {
   m_variance.resize(m_n_inputs);
   m_variance_thresholds.resize(m_n_inputs);
  
-  config.readArray("m_mean", m_mean);
-  config.readArray("m_variance", m_variance);
-  config.readArray("m_variance_thresholds", m_variance_thresholds);
+  config.readFloatArray("m_mean", m_mean);
+  config.readFloatArray("m_variance", m_variance);
+  config.readFloatArray("m_variance_thresholds", m_variance_thresholds);
 
   preComputeNLog2Pi();
-  m_g_norm = config.read<double>("g_norm");
+  // the normalization constant is recomputed from rounded variances
+  if (config.describe("m_variance")[0].type.element_type() == bob::core::array::t_float32)
+    preComputeConstants();
+  else
+    m_g_norm = config.read<double>("g_norm");
 }
 
 namespace bob{
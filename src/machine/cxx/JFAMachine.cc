@@ -20,13 +20,22 @@
 
 
 #include "bob/machine/JFAMachine.h"
+#include "bob/machine/ModelBank.h"
+#include "bob/core/array_alias.h"
 #include "bob/core/array_copy.h"
+#include "bob/core/array_assert.h"
 #include "bob/core/repmat.h"
+#include "bob/core/parallel.h"
 #include "bob/math/linear.h"
+#include "bob/math/gemm.h"
 #include "bob/math/inv.h"
 #include "bob/machine/Exception.h"
 #include "bob/machine/LinearScoring.h"
 #include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
 
 namespace mach = bob::machine;
 namespace core = bob::core;
@@ -46,6 +55,7 @@ mach::JFABaseMachine::JFABaseMachine(const boost::shared_ptr<bob::machine::GMMMa
   m_ubm(ubm), m_ru(ru), m_rv(rv),
   m_U(getDimCD(),ru), m_V(getDimCD(),rv), m_d(getDimCD())
 {
+  updateCache();
 }
 
 
@@ -53,10 +63,11 @@ mach::JFABaseMachine::JFABaseMachine(const mach::JFABaseMachine& other):
   m_ubm(other.m_ubm), m_ru(other.m_ru), m_rv(other.m_rv),
   m_U(ca::ccopy(other.m_U)), m_V(ca::ccopy(other.m_V)), m_d(ca::ccopy(other.m_d))
 {
+  updateCache();
 }
 
 mach::JFABaseMachine::JFABaseMachine(io::HDF5File& config):
-  m_ubm(boost::shared_ptr<mach::GMMMachine>()) 
+  m_ubm(boost::shared_ptr<mach::GMMMachine>())
 {
   load(config);
 }
@@ -72,6 +83,7 @@ mach::JFABaseMachine& mach::JFABaseMachine::operator=
   m_U.reference(ca::ccopy(other.m_U));
   m_V.reference(ca::ccopy(other.m_V));
   m_d.reference(ca::ccopy(other.m_d));
+  updateCache();
   return *this;
 }
 
@@ -89,6 +101,7 @@ void mach::JFABaseMachine::load(io::HDF5File& config) {
   m_d.reference(config.readArray<double,1>("d"));
   m_ru = static_cast<size_t>(m_U.extent(1));
   m_rv = static_cast<size_t>(m_V.extent(1));
+  updateCache();
 }
 
 void mach::JFABaseMachine::save(io::HDF5File& config) const {
@@ -102,6 +115,7 @@ void mach::JFABaseMachine::resize(const size_t ru, const size_t rv) {
   m_rv = rv;
   m_U.resizeAndPreserve(m_U.extent(0), ru);
   m_V.resizeAndPreserve(m_V.extent(0), rv);
+  updateCache();
 }
 
 void mach::JFABaseMachine::setUbm(const boost::shared_ptr<bob::machine::GMMMachine> ubm) {
@@ -109,6 +123,7 @@ void mach::JFABaseMachine::setUbm(const boost::shared_ptr<bob::machine::GMMMachi
   m_U.resizeAndPreserve(getDimCD(), m_ru);
   m_V.resizeAndPreserve(getDimCD(), m_rv);
   m_d.resizeAndPreserve(getDimCD());
+  updateCache();
 }
 
 void mach::JFABaseMachine::setU(const blitz::Array<double,2>& U) {
@@ -119,6 +134,7 @@ void mach::JFABaseMachine::setU(const blitz::Array<double,2>& U) {
     throw mach::NInputsMismatch(U.extent(1), m_U.extent(1));
   }
   m_U.reference(ca::ccopy(U));
+  updateCache();
 }
 
 void mach::JFABaseMachine::setV(const blitz::Array<double,2>& V) {
@@ -129,6 +145,7 @@ void mach::JFABaseMachine::setV(const blitz::Array<double,2>& V) {
     throw mach::NInputsMismatch(V.extent(1), m_V.extent(1));
   }
   m_V.reference(ca::ccopy(V));
+  updateCache();
 }
 
 void mach::JFABaseMachine::setD(const blitz::Array<double,1>& d) {
@@ -136,6 +153,195 @@ void mach::JFABaseMachine::setD(const blitz::Array<double,1>& d) {
     throw mach::NInputsMismatch(d.extent(0), m_d.extent(0));
   }
   m_d.reference(ca::ccopy(d));
+  updateCache();
+}
+
+void mach::JFABaseMachine::precompute() {
+  updateCache();
+}
+
+void mach::JFABaseMachine::updateCache() {
+  // Nothing to cache until the UBM is set (and matches U, after a load())
+  if(!m_ubm || m_U.extent(0) != (int)getDimCD()) return;
+  const int C = getDimC();
+  const int D = getDimD();
+  const blitz::Array<double,1>& sigma = m_ubm->getVarianceSupervector();
+
+  // U^T.Sigma^-1
+  blitz::firstIndex i;
+  blitz::secondIndex j;
+  m_cache_UtSigmaInv.resize(m_ru, getDimCD());
+  m_cache_UtSigmaInv = m_U(j,i) / sigma(j);
+
+  // U_{c}^T.Sigma_{c}^-1.U_{c} for each Gaussian component c
+  blitz::Range rall = blitz::Range::all();
+  m_cache_UProd.resize(C, m_ru, m_ru);
+  for(int c=0; c<C; ++c) {
+    blitz::Range rc(c*D,(c+1)*D-1);
+    blitz::Array<double,2> UtSigmaInv_c = m_cache_UtSigmaInv(rall,rc);
+    blitz::Array<double,2> U_c = m_U(rc,rall);
+    blitz::Array<double,2> UProd_c = m_cache_UProd(c,rall,rall);
+    math::prod(UtSigmaInv_c, U_c, UProd_c);
+  }
+}
+
+void mach::JFABaseMachine::forward(const std::vector<boost::shared_ptr<const mach::JFAMachine> >& models,
+  const std::vector<boost::shared_ptr<const mach::GMMStats> >& probes,
+  blitz::Array<double,2>& scores, const size_t n_threads) const
+{
+  checkProbes(models.size(), probes, scores);
+  const size_t CD = getDimCD();
+
+  // Model offsets (Vy + Dz) normalised by the UBM variances, one per row
+  const blitz::Array<double,1>& sigma = m_ubm->getVarianceSupervector();
+  blitz::Array<double,2> A(models.size(), CD);
+  blitz::Range rall = blitz::Range::all();
+  for(int m=0; m<(int)models.size(); ++m) {
+    if(models[m]->getJFABase().get() != this) {
+      boost::format e("model %d is not attached to the JFABaseMachine it is scored against");
+      e % m;
+      throw std::runtime_error(e.str());
+    }
+    if((size_t)models[m]->getY().extent(0) != m_rv || 
+        (size_t)models[m]->getZ().extent(0) != CD) {
+      boost::format e("model %d has factors y and z of size (%d,%d), whereas (%d,%d) was expected");
+      e % m % models[m]->getY().extent(0) % models[m]->getZ().extent(0) % m_rv % CD;
+      throw std::runtime_error(e.str());
+    }
+    blitz::Array<double,1> A_m = A(m,rall);
+    math::prod(m_V, models[m]->getY(), A_m);
+    A_m = (A_m + m_d*models[m]->getZ()) / sigma;
+  }
+
+  bob::core::thread_loop(boost::bind(&mach::JFABaseMachine::forwardRange, 
+        this, boost::cref(A), boost::cref(probes), boost::ref(scores), _1, _2),
+      probes.size(), n_threads);
+}
+
+void mach::JFABaseMachine::forward(const mach::ModelBank& models,
+  const std::vector<boost::shared_ptr<const mach::GMMStats> >& probes,
+  blitz::Array<double,2>& scores, const size_t n_threads) const
+{
+  checkProbes(models.size(), probes, scores);
+  const blitz::Array<double,2> Y = models.getField("y");
+  const blitz::Array<double,2> Z = models.getField("z");
+  ca::assertSameDimensionLength(Y.extent(1), m_rv);
+  ca::assertSameDimensionLength(Z.extent(1), getDimCD());
+
+  // Model offsets (Vy + Dz) normalised by the UBM variances, one per row
+  const blitz::Array<double,1>& sigma = m_ubm->getVarianceSupervector();
+  blitz::Array<double,2> A(models.size(), getDimCD());
+  if(models.size() > 0 && m_rv > 0) math::gemm_(Y, m_V, A, false, true);
+  else A = 0.;
+  blitz::firstIndex i;
+  blitz::secondIndex j;
+  A = (A(i,j) + m_d(j)*Z(i,j)) / sigma(j);
+
+  bob::core::thread_loop(boost::bind(&mach::JFABaseMachine::forwardRange, 
+        this, boost::cref(A), boost::cref(probes), boost::ref(scores), _1, _2),
+      probes.size(), n_threads);
+}
+
+void mach::JFABaseMachine::checkProbes(const size_t n_models,
+  const std::vector<boost::shared_ptr<const mach::GMMStats> >& probes,
+  const blitz::Array<double,2>& scores) const
+{
+  if(!m_ubm) throw mach::JFABaseNoUBMSet();
+  ca::assertZeroBase(scores);
+  ca::assertSameDimensionLength(scores.extent(0), n_models);
+  ca::assertSameDimensionLength(scores.extent(1), probes.size());
+
+  const size_t C = getDimC();
+  const size_t D = getDimD();
+  for(size_t t=0; t<probes.size(); ++t) {
+    if((size_t)probes[t]->sumPx.extent(0) != C || 
+        (size_t)probes[t]->sumPx.extent(1) != D) {
+      boost::format m("probe %d has statistics of size (%d,%d), whereas (%d,%d) was expected");
+      m % t % probes[t]->sumPx.extent(0) % probes[t]->sumPx.extent(1) % C % D;
+      throw std::runtime_error(m.str());
+    }
+  }
+}
+
+void mach::JFABaseMachine::forwardRange(const blitz::Array<double,2>& A,
+  const std::vector<boost::shared_ptr<const mach::GMMStats> >& probes,
+  blitz::Array<double,2>& scores, size_t begin, size_t end) const
+{
+  static const size_t BLOCK_SIZE = 64;
+  const int C = getDimC();
+  const int D = getDimD();
+  const int CD = getDimCD();
+  const int ru = m_ru;
+  blitz::Range rall = blitz::Range::all();
+
+  // Aliases private to this thread of the shared arrays that are sliced.
+  // The supervectors of the UBM were updated by the caller.
+  const blitz::Array<double,1> mean = ca::alias(m_ubm->getMeanSupervector());
+  const blitz::Array<double,3> UProd = ca::alias(m_cache_UProd);
+  blitz::Array<double,2> scores_ = ca::alias(scores);
+
+  // Per-thread buffers
+  const int max_block = std::min(BLOCK_SIZE, end-begin);
+  blitz::Array<double,2> Fn(max_block, CD);
+  blitz::Array<double,2> UtSigmaInvFn(Fn.extent(0), ru);
+  blitz::Array<double,2> X(Fn.extent(0), ru);
+  blitz::Array<double,2> Ux(Fn.extent(0), CD);
+  blitz::Array<double,2> L(ru, ru);
+  blitz::Array<double,2> Linv(ru, ru);
+
+  for(size_t b=begin; b<end; b+=BLOCK_SIZE) {
+    const int nb = std::min(BLOCK_SIZE, end-b);
+    blitz::Range rb(0, nb-1);
+    blitz::Array<double,2> Fn_b = Fn(rb,rall);
+    blitz::Array<double,2> UtSigmaInvFn_b = UtSigmaInvFn(rb,rall);
+    blitz::Array<double,2> X_b = X(rb,rall);
+    blitz::Array<double,2> Ux_b = Ux(rb,rall);
+
+    // Fn = F - N.m
+    for(int t=0; t<nb; ++t) {
+      const mach::GMMStats& stats = *probes[b+t];
+      const blitz::Array<double,2> sumPx = ca::alias(stats.sumPx);
+      for(int c=0; c<C; ++c) {
+        blitz::Range rc(c*D,(c+1)*D-1);
+        blitz::Array<double,1> Fn_tc = Fn_b(t,rc);
+        Fn_tc = sumPx(c,rall) - mean(rc)*stats.n(c);
+      }
+    }
+
+    // x = (Id + sum_{c} N_{c}.U_{c}^T.Sigma_{c}^-1.U_{c})^-1.U^T.Sigma^-1.Fn
+    math::gemm_(Fn_b, m_cache_UtSigmaInv, UtSigmaInvFn_b, false, true);
+    for(int t=0; t<nb; ++t) {
+      const mach::GMMStats& stats = *probes[b+t];
+      math::eye(L);
+      for(int c=0; c<C; ++c)
+        L += UProd(c,rall,rall) * stats.n(c);
+      math::inv(L, Linv);
+      blitz::Array<double,1> x_t = X_b(t,rall);
+      math::prod(Linv, UtSigmaInvFn_b(t,rall), x_t);
+    }
+
+    // Channel compensation: Fn - N.Ux, and frame length normalisation
+    math::gemm_(X_b, m_U, Ux_b, false, true);
+    for(int t=0; t<nb; ++t) {
+      const mach::GMMStats& stats = *probes[b+t];
+      for(int c=0; c<C; ++c) {
+        blitz::Range rc(c*D,(c+1)*D-1);
+        blitz::Array<double,1> Fn_tc = Fn_b(t,rc);
+        Fn_tc -= Ux_b(t,rc) * stats.n(c);
+      }
+      blitz::Array<double,1> Fn_t = Fn_b(t,rall);
+      const double sum_N = stats.T;
+      if(sum_N <= std::numeric_limits<double>::epsilon() && 
+          sum_N >= -std::numeric_limits<double>::epsilon())
+        Fn_t = 0;
+      else
+        Fn_t /= sum_N;
+    }
+
+    // Scores of all the models against this block of probes
+    blitz::Array<double,2> scores_b = scores_(rall, blitz::Range(b, b+nb-1));
+    math::gemm_(A, Fn_b, scores_b, false, true);
+  }
 }
 
 
@@ -223,15 +429,12 @@ void mach::JFAMachine::resize()
 
 void mach::JFAMachine::resizeCache()
 {
-  m_cache_mean.resize(getDimCD());
-  m_cache_sigma.resize(getDimCD());
-  m_cache_UtSigmaInv.resize(getDimRu(), getDimCD());
+  m_cache_Ux.resize(getDimCD());
+  m_cache_mVyDz.resize(getDimCD());
   m_cache_IdPlusUSProdInv.resize(getDimRu(),getDimRu());
   m_cache_Fn_x.resize(getDimCD());
 
   m_tmp_ru.resize(getDimRu());
-  m_tmp_ruD.resize(getDimRu(), getDimD());
-  m_tmp_ruCD.resize(getDimRu(), getDimCD());
   m_tmp_ruru.resize(getDimRu(), getDimRu());
 }
 
@@ -250,46 +453,17 @@ void mach::JFAMachine::setZ(const blitz::Array<double,1>& z) {
 }
 
 
-void mach::JFAMachine::cacheSupervectors()
-{ 
-  // Put supervectors in cache
-  m_jfa_base->getUbm()->getMeanSupervector(m_cache_mean);
-  m_jfa_base->getUbm()->getVarianceSupervector(m_cache_sigma);
-}
-
-void mach::JFAMachine::computeUtSigmaInv()
-{
-  const blitz::Array<double,2>& U = m_jfa_base->getU();
-  blitz::firstIndex i;
-  blitz::secondIndex j;
-  m_cache_UtSigmaInv = U(j,i) / m_cache_sigma(j); // Ut * diag(sigma)^-1
-}
-
 void mach::JFAMachine::computeIdPlusUSProdInv(boost::shared_ptr<const bob::machine::GMMStats> gmm_stats)
 {
   // Computes (Id + U^T.Sigma^-1.U.N_{i,h}.U)^-1 = (Id + sum_{c=1..C} N_{i,h}.U_{c}^T.Sigma_{c}^-1.U_{c})^-1
-  const blitz::Array<double,2>& U = m_jfa_base->getU();
-  // Blitz compatibility: ugly fix (const_cast, as old blitz version does not 
-  // provide a non-const version of transpose())
-  blitz::Array<double,2> Ut = const_cast<blitz::Array<double,2>&>(U).transpose(1,0);
-
-  blitz::firstIndex i;
-  blitz::secondIndex j;
+  // The U_{c}^T.Sigma_{c}^-1.U_{c} products are cached by the JFABaseMachine
+  const blitz::Array<double,3>& UProd = m_jfa_base->getUProd();
   blitz::Range rall = blitz::Range::all();
 
   math::eye(m_tmp_ruru); // m_tmp_ruru = Id
   // Loop and add N_{i,h}.U_{c}^T.Sigma_{c}^-1.U_{c} to m_tmp_ruru at each iteration
-  for(size_t c=0; c<getDimC(); ++c) {
-    blitz::Range rc(c*getDimD(),(c+1)*getDimD()-1);
-    blitz::Array<double,2> Ut_c = Ut(rall,rc);
-    blitz::Array<double,1> sigma_c = m_cache_sigma(rc);
-    m_tmp_ruD = Ut_c(i,j) / sigma_c(j); // U_{c}^T.Sigma_{c}^-1
-    blitz::Array<double,2> U_c = U(rc,rall);
-    // Use m_cache_IdPlusUSProdInv as an intermediate array
-    math::prod(m_tmp_ruD, U_c, m_cache_IdPlusUSProdInv); // U_{c}^T.Sigma_{c}^-1.U_{c}
-    // Finally, add N_{i,h}.U_{c}^T.Sigma_{c}^-1.U_{c} to m_tmp_ruru
-    m_tmp_ruru += m_cache_IdPlusUSProdInv * gmm_stats->n(c);
-  }
+  for(int c=0; c<(int)getDimC(); ++c)
+    m_tmp_ruru += UProd(c,rall,rall) * gmm_stats->n(c);
   // Computes the inverse
   math::inv(m_tmp_ruru, m_cache_IdPlusUSProdInv);
 }
@@ -297,91 +471,79 @@ void mach::JFAMachine::computeIdPlusUSProdInv(boost::shared_ptr<const bob::machi
 void mach::JFAMachine::computeFn_x(boost::shared_ptr<const bob::machine::GMMStats> gmm_stats)
 {
   // Compute Fn_x = sum_{sessions h}(N*(o - m) (Normalised first order statistics)
-  m_jfa_base->getUbm()->getMeanSupervector(m_cache_mean);
+  const blitz::Array<double,1>& mean = m_jfa_base->getUbm()->getMeanSupervector();
 
   blitz::Range rall = blitz::Range::all();
   for(size_t c=0; c<getDimC(); ++c) {
     blitz::Range rc(c*getDimD(),(c+1)*getDimD()-1);
     blitz::Array<double,1> Fn_x_c = m_cache_Fn_x(rc);
-    blitz::Array<double,1> mean_c = m_cache_mean(rc);
-    Fn_x_c = gmm_stats->sumPx(c,rall) - mean_c*gmm_stats->n(c);
+    Fn_x_c = gmm_stats->sumPx(c,rall) - mean(rc)*gmm_stats->n(c);
   }
 }
 
 void mach::JFAMachine::updateX_fromCache()
 {
-  // m_tmp_ru = m_cache_UtSigmaInv * m_cache_Fn_x = Ut*diag(sigma)^-1 * N*(o - m)
-  math::prod(m_cache_UtSigmaInv, m_cache_Fn_x, m_tmp_ru); 
-  // x = m_cache_IdPlusUSProdInv * m_cache_UtSigmaInv * m_cache_Fn_x 
+  // m_tmp_ru = UtSigmaInv * m_cache_Fn_x = Ut*diag(sigma)^-1 * N*(o - m)
+  math::prod(m_jfa_base->getUtSigmaInv(), m_cache_Fn_x, m_tmp_ru); 
+  // x = m_cache_IdPlusUSProdInv * UtSigmaInv * m_cache_Fn_x 
   math::prod(m_cache_IdPlusUSProdInv, m_tmp_ru, m_x);
 }
 
 void mach::JFAMachine::estimateX(boost::shared_ptr<const bob::machine::GMMStats> gmm_stats) 
 {
-  cacheSupervectors(); // Put supervector in cache
-  computeUtSigmaInv(); // Computes U^T.Sigma^-1
   computeIdPlusUSProdInv(gmm_stats); // Computes first term
   computeFn_x(gmm_stats); // Computes last term
   updateX_fromCache(); // Estimates the value of x using the current cache
 }
 
-void mach::JFAMachine::forward(boost::shared_ptr<const bob::machine::GMMStats> gmm_stats, double& score)
+double mach::JFAMachine::scoreFromCache(boost::shared_ptr<const bob::machine::GMMStats> gmm_stats)
 {
-  // Checks that a Base machine has been set
-  if(!m_jfa_base) throw bob::machine::JFAMachineNoJFABaseSet();
-
-  // Ux and GMMStats
-  estimateX(gmm_stats);
+  // Linear scoring of the model (m + Vy + Dz) against the channel 
+  // compensated statistics, with frame length normalisation:
+  // ((Vy + Dz) / Sigma) . (F - N.(m + Ux)) / T
+  // m_cache_Fn_x already contains F - N.m
+  const double sum_N = gmm_stats->T;
+  if(sum_N <= std::numeric_limits<double>::epsilon() && 
+      sum_N >= -std::numeric_limits<double>::epsilon())
+    return 0.;
 
-  std::vector<boost::shared_ptr<const mach::GMMStats> > stats;
-  stats.push_back(gmm_stats);
-  m_cache_Ux.resize(getDimCD());
   math::prod(m_jfa_base->getU(), m_x, m_cache_Ux);
-  std::vector<blitz::Array<double,1> > channelOffset;
-  channelOffset.push_back(m_cache_Ux);
+  for(size_t c=0; c<getDimC(); ++c) {
+    blitz::Range rc(c*getDimD(),(c+1)*getDimD()-1);
+    blitz::Array<double,1> Ux_c = m_cache_Ux(rc);
+    Ux_c *= gmm_stats->n(c);
+  }
+  return blitz::sum(m_cache_mVyDz * (m_cache_Fn_x - m_cache_Ux)) / sum_N;
+}
 
-  // m + Vy + Dz
-  m_cache_mVyDz.resize(getDimCD());
+void mach::JFAMachine::computeModelOffset()
+{
+  // (Vy + Dz) / Sigma
   math::prod(m_jfa_base->getV(), m_y, m_cache_mVyDz);
-  m_cache_mVyDz += m_jfa_base->getD()*m_z + m_jfa_base->getUbm()->getMeanSupervector();
-  std::vector<blitz::Array<double,1> > models;
-  models.push_back(m_cache_mVyDz);
+  m_cache_mVyDz = (m_cache_mVyDz + m_jfa_base->getD()*m_z) / 
+    m_jfa_base->getUbm()->getVarianceSupervector();
+}
 
-  // Linear scoring
-  blitz::Array<double,2> scores(1,1);
-  mach::linearScoring(models, 
-    m_jfa_base->getUbm()->getMeanSupervector(), m_jfa_base->getUbm()->getVarianceSupervector(),
-    stats, channelOffset, true, scores);
-  score = scores(0,0);
+void mach::JFAMachine::forward(boost::shared_ptr<const bob::machine::GMMStats> gmm_stats, double& score)
+{
+  // Checks that a Base machine has been set
+  if(!m_jfa_base) throw bob::machine::JFAMachineNoJFABaseSet();
+
+  computeModelOffset();
+  estimateX(gmm_stats);
+  score = scoreFromCache(gmm_stats);
 }
 
 void mach::JFAMachine::forward(const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& samples, blitz::Array<double,1>& score)
 {
   // Checks that a Base machine has been set
   if(!m_jfa_base) throw bob::machine::JFAMachineNoJFABaseSet();
+  ca::assertSameDimensionLength(score.extent(0), samples.size());
 
-  std::vector<blitz::Array<double,1> > channelOffset;
-  m_cache_Ux.resize(getDimCD());
+  computeModelOffset();
   for(size_t i=0; i<samples.size(); ++i)
   {
-    // Ux and GMMStats
     estimateX(samples[i]);
-    math::prod(m_jfa_base->getU(), m_x, m_cache_Ux);
-    channelOffset.push_back(ca::ccopy(m_cache_Ux));
+    score(i) = scoreFromCache(samples[i]);
   }
-
-  // m + Vy + Dz
-  m_cache_mVyDz.resize(getDimCD());
-  math::prod(m_jfa_base->getV(), m_y, m_cache_mVyDz);
-  m_cache_mVyDz += m_jfa_base->getD()*m_z + m_jfa_base->getUbm()->getMeanSupervector();
-  std::vector<blitz::Array<double,1> > models;
-  models.push_back(m_cache_mVyDz);
-
-  // Linear scoring
-  // TODO: try to avoid this 2D array allocation or put in cache
-  blitz::Array<double,2> scores(1,samples.size());
-  mach::linearScoring(models, 
-    m_jfa_base->getUbm()->getMeanSupervector(), m_jfa_base->getUbm()->getVarianceSupervector(),
-    samples, channelOffset, true, scores);
-  score = scores(0,blitz::Range::all());
 }
@@ -21,11 +21,19 @@
 
 #include "bob/machine/KMeansMachine.h"
 
+#include "bob/core/array_alias.h"
 #include "bob/core/array_assert.h"
 #include "bob/core/array_copy.h"
+#include "bob/core/parallel.h"
 #include "bob/machine/Exception.h"
+#include "bob/math/gemm.h"
+#include <boost/bind.hpp>
+#include <algorithm>
 #include <limits>
 
+// Number of samples of which the distances are computed at once
+static const int BLOCK_SIZE = 256;
+
 bob::machine::KMeansMachine::KMeansMachine(): 
   m_n_means(0), m_n_inputs(0), m_means(0,0),
   m_cache_means(0,0) 
@@ -120,7 +128,13 @@ void bob::machine::KMeansMachine::getMean(const size_t i, blitz::Array<double,1>
 double bob::machine::KMeansMachine::getDistanceFromMean(const blitz::Array<double,1> &x, 
   const size_t i) const 
 {
-  return blitz::sum(blitz::pow2(m_means(i,blitz::Range::all()) - x));
+  // scalar indexing, as this is called concurrently by the trainers
+  double distance = 0.;
+  for(int k=0; k<x.extent(0); ++k) {
+    const double d = m_means((int)i,k) - x(x.lbound(0)+k);
+    distance += d * d;
+  }
+  return distance;
 }
 
 void bob::machine::KMeansMachine::getClosestMean(const blitz::Array<double,1> &x, 
@@ -235,6 +249,51 @@ void bob::machine::KMeansMachine::forward_(const blitz::Array<double,1>& input,
   output = getMinDistance(input);
 }
 
+void bob::machine::KMeansMachine::forward(const blitz::Array<double,2>& input, blitz::Array<double,1>& output, const size_t n_threads) const 
+{
+  if(static_cast<size_t>(input.extent(1)) != m_n_inputs) {
+    throw NInputsMismatch(m_n_inputs, input.extent(1));
+  }
+  bob::core::array::assertZeroBase(input);
+  bob::core::array::assertZeroBase(output);
+  bob::core::array::assertSameDimensionLength(input.extent(0), output.extent(0));
+  forward_(input, output, n_threads);
+}
+
+void bob::machine::KMeansMachine::forward_(const blitz::Array<double,2>& input, blitz::Array<double,1>& output, const size_t n_threads) const 
+{
+  // |x - m|^2 = |x|^2 - 2 x.m + |m|^2
+  blitz::Array<double,1> mean_norms(m_n_means);
+  for(size_t i=0; i<m_n_means; ++i)
+    mean_norms(i) = blitz::sum(blitz::pow2(m_means(i, blitz::Range::all())));
+
+  bob::core::thread_loop(boost::bind(&bob::machine::KMeansMachine::forwardRange, this, boost::cref(input), boost::cref(mean_norms), boost::ref(output), _1, _2), input.extent(0), n_threads);
+}
+
+void bob::machine::KMeansMachine::forwardRange(const blitz::Array<double,2>& input, const blitz::Array<double,1>& mean_norms, blitz::Array<double,1>& output, const size_t begin, const size_t end) const 
+{
+  const int n_means = m_n_means;
+  blitz::Range a = blitz::Range::all();
+  // alias and buffer of this thread
+  const blitz::Array<double,2> input_ = bob::core::array::alias(input);
+  blitz::Array<double,2> products(BLOCK_SIZE, m_n_means);
+
+  for(int b=(int)begin; b<(int)end; b+=BLOCK_SIZE) {
+    const int n = std::min(BLOCK_SIZE, (int)end - b);
+    const blitz::Array<double,2> x = input_(blitz::Range(b, b+n-1), a);
+    blitz::Array<double,2> p = products(blitz::Range(0, n-1), a);
+    bob::math::gemm_(x, m_means, p, false, true, -2.);
+
+    for(int j=0; j<n; ++j) {
+      double min_distance = std::numeric_limits<double>::max();
+      for(int i=0; i<n_means; ++i)
+        min_distance = std::min(min_distance, mean_norms(i) + p(j,i));
+      // rounding errors may lead to (tiny) negative distances
+      output(b+j) = std::max(0., min_distance + blitz::sum(blitz::pow2(x(j,a))));
+    }
+  }
+}
+
 void bob::machine::KMeansMachine::resize(const size_t n_means, const size_t n_inputs) 
 {
   m_n_means = n_means;
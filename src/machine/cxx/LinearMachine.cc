@@ -22,10 +22,14 @@
 
 #include <cmath>
 
+#include "bob/core/array_alias.h"
 #include "bob/core/array_copy.h"
+#include "bob/core/array_assert.h"
+#include "bob/core/parallel.h"
 #include "bob/machine/LinearMachine.h"
 #include "bob/machine/Exception.h"
 #include "bob/math/linear.h"
+#include "bob/math/gemm.h"
 
 bob::machine::LinearMachine::LinearMachine(const blitz::Array<double,2>& weight)
   : m_input_sub(weight.extent(0)),
@@ -33,7 +37,8 @@ bob::machine::LinearMachine::LinearMachine(const blitz::Array<double,2>& weight)
     m_bias(weight.extent(1)),
     m_activation(bob::machine::LINEAR),
     m_actfun(linear),
-    m_buffer(weight.extent(0))
+    m_buffer(weight.extent(0)),
+    m_folded_dirty(true)
 {
   m_input_sub = 0.0;
   m_input_div = 1.0;
@@ -48,7 +53,10 @@ bob::machine::LinearMachine::LinearMachine():
   m_bias(0),
   m_activation(bob::machine::LINEAR),
   m_actfun(linear),
-  m_buffer(0)
+  m_buffer(0),
+  m_folded_weight(0, 0),
+  m_folded_bias(0),
+  m_folded_dirty(true)
 {
 }
 
@@ -59,7 +67,8 @@ bob::machine::LinearMachine::LinearMachine(size_t n_input, size_t n_output):
   m_bias(n_output),
   m_activation(bob::machine::LINEAR),
   m_actfun(linear),
-  m_buffer(n_input)
+  m_buffer(n_input),
+  m_folded_dirty(true)
 {
   m_input_sub = 0.0;
   m_input_div = 1.0;
@@ -68,17 +77,21 @@ bob::machine::LinearMachine::LinearMachine(size_t n_input, size_t n_output):
 }
 
 bob::machine::LinearMachine::LinearMachine(const bob::machine::LinearMachine& other):
+  Machine<blitz::Array<double,1>, blitz::Array<double,1> >(other),
   m_input_sub(bob::core::array::ccopy(other.m_input_sub)),
   m_input_div(bob::core::array::ccopy(other.m_input_div)),
   m_weight(bob::core::array::ccopy(other.m_weight)),
   m_bias(bob::core::array::ccopy(other.m_bias)),
   m_activation(other.m_activation),
   m_actfun(other.m_actfun),
-  m_buffer(m_input_sub.shape())
+  m_buffer(m_input_sub.shape()),
+  m_folded_dirty(true)
 {
 }
 
-bob::machine::LinearMachine::LinearMachine (bob::io::HDF5File& config) {
+bob::machine::LinearMachine::LinearMachine (bob::io::HDF5File& config):
+  m_folded_dirty(true)
+{
   load(config);
 }
 
@@ -95,6 +108,7 @@ bob::machine::LinearMachine& bob::machine::LinearMachine::operator=
     m_activation = other.m_activation;
     m_actfun = other.m_actfun;
     m_buffer.resize(m_input_sub.shape());
+    m_folded_dirty = true;
   }
   return *this;
 }
@@ -138,6 +152,8 @@ void bob::machine::LinearMachine::load (bob::io::HDF5File& config) {
   //reads the activation function
   uint32_t act = config.read<uint32_t>("activation");
   setActivation(static_cast<bob::machine::Activation>(act));
+
+  m_folded_dirty = true;
 }
 
 void bob::machine::LinearMachine::resize (size_t input, size_t output) {
@@ -146,6 +162,7 @@ void bob::machine::LinearMachine::resize (size_t input, size_t output) {
   m_buffer.resizeAndPreserve(input);
   m_weight.resizeAndPreserve(input, output);
   m_bias.resizeAndPreserve(output);
+  m_folded_dirty = true;
 }
 
 void bob::machine::LinearMachine::save (bob::io::HDF5File& config) const {
@@ -176,6 +193,118 @@ void bob::machine::LinearMachine::forward
   forward_(input, output);
 }
 
+void bob::machine::LinearMachine::fold(blitz::Array<double,2>& weight,
+    blitz::Array<double,1>& bias) const {
+  blitz::firstIndex i;
+  blitz::secondIndex j;
+  weight.resize(m_weight.shape());
+  weight = m_weight(i,j) / m_input_div(i);
+  bias.resize(m_bias.shape());
+  bias = m_bias - blitz::sum(weight(j,i) * m_input_sub(j), j);
+}
+
+void bob::machine::LinearMachine::updateFolded() const {
+  if (!m_folded_dirty) return;
+  fold(m_folded_weight, m_folded_bias);
+  m_folded_dirty = false;
+}
+
+/**
+ * Number of samples projected at once when the output is in single
+ * precision: bounds the size of the double precision buffer.
+ */
+static const int FLOAT_OUTPUT_BLOCK = 1024;
+
+void bob::machine::LinearMachine::forwardRange
+(const blitz::Array<double,2>& input, blitz::Array<double,2>& output,
+ const blitz::Array<double,2>& weight, const blitz::Array<double,1>& bias,
+ size_t begin, size_t end) const {
+  const blitz::Range rows(begin, end-1);
+  const blitz::Range all = blitz::Range::all();
+  // the rows are views of aliases private to this thread
+  blitz::Array<double,2> output_ = bob::core::array::alias(output)(rows, all);
+  bob::math::gemm_(bob::core::array::alias(input)(rows, all), weight, output_);
+  blitz::firstIndex i;
+  blitz::secondIndex j;
+  output_ = output_(i,j) + bias(j);
+  if (m_activation != bob::machine::LINEAR) {
+    for (int k=0; k<output_.extent(0); ++k)
+      for (int l=0; l<output_.extent(1); ++l)
+        output_(k,l) = m_actfun(output_(k,l));
+  }
+}
+
+void bob::machine::LinearMachine::forwardRangeFloat
+(const blitz::Array<double,2>& input, blitz::Array<float,2>& output,
+ const blitz::Array<double,2>& weight, const blitz::Array<double,1>& bias,
+ size_t begin, size_t end) const {
+  const blitz::Range all = blitz::Range::all();
+  // the blocks are views of aliases private to this thread
+  const blitz::Array<double,2> input_ = bob::core::array::alias(input);
+  blitz::Array<float,2> output_ = bob::core::array::alias(output);
+  const int block = std::min((int)(end-begin), FLOAT_OUTPUT_BLOCK);
+  blitz::Array<double,2> buffer(block, weight.extent(1));
+  for (int b=begin; b<(int)end; b+=block) {
+    const int n = std::min(block, (int)end-b);
+    blitz::Array<double,2> buffer_ = buffer(blitz::Range(0, n-1), all);
+    forwardRange(input_(blitz::Range(b, b+n-1), all), buffer_, weight, bias,
+        0, n);
+    output_(blitz::Range(b, b+n-1), all) = blitz::cast<float>(buffer_);
+  }
+}
+
+void bob::machine::LinearMachine::forward_
+(const blitz::Array<double,2>& input, blitz::Array<double,2>& output,
+ size_t n_threads) const {
+  updateFolded();
+  bob::core::thread_loop(boost::bind(&bob::machine::LinearMachine::forwardRange,
+        this, boost::cref(input), boost::ref(output),
+        boost::cref(m_folded_weight), boost::cref(m_folded_bias), _1, _2),
+      input.extent(0), n_threads);
+}
+
+void bob::machine::LinearMachine::forward_
+(const blitz::Array<double,2>& input, blitz::Array<float,2>& output,
+ size_t n_threads) const {
+  updateFolded();
+  bob::core::thread_loop(boost::bind(&bob::machine::LinearMachine::forwardRangeFloat,
+        this, boost::cref(input), boost::ref(output),
+        boost::cref(m_folded_weight), boost::cref(m_folded_bias), _1, _2),
+      input.extent(0), n_threads);
+}
+
+void bob::machine::LinearMachine::forward
+(const blitz::Array<double,2>& input, blitz::Array<double,2>& output,
+ size_t n_threads) const {
+  if (m_weight.extent(0) != input.extent(1)) //checks input
+    throw bob::machine::NInputsMismatch(m_weight.extent(0),
+        input.extent(1));
+  if (m_weight.extent(1) != output.extent(1)) //checks output
+    throw bob::machine::NOutputsMismatch(m_weight.extent(1),
+        output.extent(1));
+  bob::core::array::assertZeroBase(input);
+  bob::core::array::assertZeroBase(output);
+  bob::core::array::assertSameDimensionLength(input.extent(0),
+      output.extent(0));
+  forward_(input, output, n_threads);
+}
+
+void bob::machine::LinearMachine::forward
+(const blitz::Array<double,2>& input, blitz::Array<float,2>& output,
+ size_t n_threads) const {
+  if (m_weight.extent(0) != input.extent(1)) //checks input
+    throw bob::machine::NInputsMismatch(m_weight.extent(0),
+        input.extent(1));
+  if (m_weight.extent(1) != output.extent(1)) //checks output
+    throw bob::machine::NOutputsMismatch(m_weight.extent(1),
+        output.extent(1));
+  bob::core::array::assertZeroBase(input);
+  bob::core::array::assertZeroBase(output);
+  bob::core::array::assertSameDimensionLength(input.extent(0),
+      output.extent(0));
+  forward_(input, output, n_threads);
+}
+
 void bob::machine::LinearMachine::setWeights
 (const blitz::Array<double,2>& weight) {
   if (weight.extent(0) != m_input_sub.extent(0)) { //checks input
@@ -185,6 +314,12 @@ void bob::machine::LinearMachine::setWeights
     throw bob::machine::NOutputsMismatch(weight.extent(1), m_bias.extent(0));
   }
   m_weight.reference(bob::core::array::ccopy(weight));
+  m_folded_dirty = true;
+}
+
+void bob::machine::LinearMachine::setWeights(double v) {
+  m_weight = v;
+  m_folded_dirty = true;
 }
 
 void bob::machine::LinearMachine::setBiases
@@ -193,6 +328,12 @@ void bob::machine::LinearMachine::setBiases
     throw bob::machine::NOutputsMismatch(m_weight.extent(1), bias.extent(0));
   }
   m_bias.reference(bob::core::array::ccopy(bias));
+  m_folded_dirty = true;
+}
+
+void bob::machine::LinearMachine::setBiases(double v) {
+  m_bias = v;
+  m_folded_dirty = true;
 }
 
 void bob::machine::LinearMachine::setInputSubtraction
@@ -201,6 +342,12 @@ void bob::machine::LinearMachine::setInputSubtraction
     throw bob::machine::NInputsMismatch(m_weight.extent(0), v.extent(0));
   }
   m_input_sub.reference(bob::core::array::ccopy(v));
+  m_folded_dirty = true;
+}
+
+void bob::machine::LinearMachine::setInputSubtraction(double v) {
+  m_input_sub = v;
+  m_folded_dirty = true;
 }
 
 void bob::machine::LinearMachine::setInputDivision
@@ -209,6 +356,12 @@ void bob::machine::LinearMachine::setInputDivision
     throw bob::machine::NInputsMismatch(m_weight.extent(0), v.extent(0));
   }
   m_input_div.reference(bob::core::array::ccopy(v));
+  m_folded_dirty = true;
+}
+
+void bob::machine::LinearMachine::setInputDivision(double v) {
+  m_input_div = v;
+  m_folded_dirty = true;
 }
 
 void bob::machine::LinearMachine::setActivation (bob::machine::Activation a) {
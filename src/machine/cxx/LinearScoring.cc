@@ -18,7 +18,14 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "bob/machine/LinearScoring.h"
-#include "bob/math/linear.h"
+#include "bob/machine/ModelBank.h"
+#include "bob/math/gemm.h"
+#include "bob/core/array_alias.h"
+#include "bob/core/array_assert.h"
+#include "bob/core/parallel.h"
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <limits>
 
 namespace ca = bob::core::array;
 
@@ -27,65 +34,251 @@ namespace bob { namespace machine {
 
 namespace detail {
 
-  void linearScoring(const std::vector<blitz::Array<double,1> >& models,
-                     const blitz::Array<double,1>& ubm_mean,
-                     const blitz::Array<double,1>& ubm_variance,
-                     const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
-                     const std::vector<blitz::Array<double,1> >* test_channelOffset,
-                     const bool frame_length_normalisation,
-                     blitz::Array<double,2>& scores) 
-  {
-    int C = test_stats[0]->sumPx.extent(0);
-    int D = test_stats[0]->sumPx.extent(1);
-    int CD = C*D;
-    int Tt = test_stats.size();
-    int Tm = models.size();
-
-    // Check output size
-    ca::assertSameDimensionLength(scores.extent(0), models.size());
-    ca::assertSameDimensionLength(scores.extent(1), test_stats.size());
-
-    blitz::Array<double,2> A(Tm, CD);
-    blitz::Array<double,2> B(CD, Tt);
+  // Number of test statistics converted into supervectors at once. The 
+  // scores of a block are then computed with a single matrix product.
+  static const int BLOCK_SIZE = 256;
 
-    // 1) Compute A
-    for(int t=0; t<Tm; ++t) {
+  /**
+   * Normalizes the model mean supervectors once: A(m,:) = (m - mu) / sigma
+   */
+  static void normalizeModels(const std::vector<blitz::Array<double,1> >& models,
+                              const blitz::Array<double,1>& ubm_mean,
+                              const blitz::Array<double,1>& ubm_variance,
+                              blitz::Array<double,2>& A)
+  {
+    const int CD = ubm_mean.extent(0);
+    ca::assertSameDimensionLength(ubm_variance.extent(0), CD);
+    A.resize(models.size(), CD);
+    for(int t=0; t<(int)models.size(); ++t) {
+      ca::assertSameDimensionLength(models[t].extent(0), CD);
       blitz::Array<double, 1> tmp = A(t, blitz::Range::all());
       tmp = (models[t] - ubm_mean) / ubm_variance;
     }
+  }
 
-    // 2) Compute B
-    if(test_channelOffset == 0) {
-      for(int t=0; t<Tt; ++t) 
-        for(int s=0; s<CD; ++s)
-          B(s, t) = test_stats[t]->sumPx(s/D, s%D) - (ubm_mean(s) * test_stats[t]->n(s/D));
+  static void normalizeModels(const std::vector<boost::shared_ptr<const bob::machine::GMMMachine> >& models,
+                              const bob::machine::GMMMachine& ubm,
+                              blitz::Array<double,2>& A)
+  {
+    const blitz::Array<double,1>& ubm_mean = ubm.getMeanSupervector();
+    const blitz::Array<double,1>& ubm_variance = ubm.getVarianceSupervector();
+    A.resize(models.size(), ubm_mean.extent(0));
+    for(int t=0; t<(int)models.size(); ++t) {
+      // The mean supervector is directly written into A
+      blitz::Array<double, 1> tmp = A(t, blitz::Range::all());
+      models[t]->getMeanSupervector(tmp);
+      tmp = (tmp - ubm_mean) / ubm_variance;
     }
-    else {
-      ca::assertSameDimensionLength((*test_channelOffset).size(), Tt);
-      
-      for(int t=0; t<Tt; ++t) {
+  }
+
+  /**
+   * Checks the dimensionality of the test statistics and channel offsets
+   */
+  static void checkTests(const int CD,
+                         const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+                         const std::vector<blitz::Array<double,1> >* test_channelOffset)
+  {
+    for(size_t t=0; t<test_stats.size(); ++t)
+      ca::assertSameDimensionLength(test_stats[t]->sumPx.extent(0) * 
+        test_stats[t]->sumPx.extent(1), CD);
+    if(test_channelOffset != 0) {
+      ca::assertSameDimensionLength((*test_channelOffset).size(), test_stats.size());
+      for(size_t t=0; t<test_stats.size(); ++t)
         ca::assertSameDimensionLength((*test_channelOffset)[t].extent(0), CD);
-        for(int s=0; s<CD; ++s) 
-          B(s, t) = test_stats[t]->sumPx(s/D, s%D) - (test_stats[t]->n(s/D) * (ubm_mean(s) + (*test_channelOffset)[t](s)));
+    }
+  }
+
+  /**
+   * Converts the test statistics t into a centered (and optionally 
+   * normalized) supervector v_t
+   */
+  static void supervector(const bob::machine::GMMStats& stats,
+                          const blitz::Array<double,1>& ubm_mean,
+                          const blitz::Array<double,1>* offset,
+                          const bool frame_length_normalisation,
+                          blitz::Array<double,1>& v_t)
+  {
+    const int C = stats.sumPx.extent(0);
+    const int D = stats.sumPx.extent(1);
+    for(int c=0; c<C; ++c) {
+      const double n_c = stats.n(c);
+      if(offset == 0) {
+        for(int d=0; d<D; ++d)
+          v_t(c*D+d) = stats.sumPx(c,d) - n_c * ubm_mean(c*D+d);
+      }
+      else {
+        for(int d=0; d<D; ++d)
+          v_t(c*D+d) = stats.sumPx(c,d) - n_c * (ubm_mean(c*D+d) + (*offset)(c*D+d));
       }
     }
 
     // Apply the normalisation if needed
     if(frame_length_normalisation) {
-      for(int t=0; t<Tt; ++t) {
-        double sum_N = test_stats[t]->T;
-        blitz::Array<double, 1> v_t = B(blitz::Range::all(),t);
-
-        if (sum_N <= std::numeric_limits<double>::epsilon() && sum_N >= -std::numeric_limits<double>::epsilon())
-          v_t = 0;
-        else 
-          v_t /= sum_N;
+      const double sum_N = stats.T;
+      if (sum_N <= std::numeric_limits<double>::epsilon() && sum_N >= -std::numeric_limits<double>::epsilon())
+        v_t = 0;
+      else 
+        v_t /= sum_N;
+    }
+  }
+
+  /**
+   * Computes the scores of the test statistics first+begin to first+end-1, 
+   * and writes them in the columns begin to end-1 of scores. The test 
+   * statistics are converted into centered (and optionally normalized) 
+   * supervectors block by block, and the scores of a block are obtained 
+   * with a single matrix product against the normalized models A.
+   */
+  template <typename T>
+  static void scoreRange(const blitz::Array<T,2>& A,
+                         const blitz::Array<double,1>& ubm_mean,
+                         const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+                         const std::vector<blitz::Array<double,1> >* test_channelOffset,
+                         const bool frame_length_normalisation,
+                         blitz::Array<T,2>& scores, const size_t first,
+                         const size_t begin, const size_t end)
+  {
+    const int CD = A.extent(1);
+    const int max_block = std::min(BLOCK_SIZE, (int)(end-begin));
+    blitz::Array<double,1> v_t(CD);
+    blitz::Array<T,2> B(max_block, CD);
+    // the blocks of scores are views of an alias private to this thread
+    blitz::Array<T,2> scores_ = ca::alias(scores);
+
+    for(int b0=(int)begin; b0<(int)end; b0+=BLOCK_SIZE) {
+      const int nb = std::min(BLOCK_SIZE, (int)end-b0);
+
+      // 1) Centered supervectors of the block, one per row
+      for(int k=0; k<nb; ++k) {
+        const int t = (int)first + b0 + k;
+        supervector(*test_stats[t], ubm_mean, 
+          test_channelOffset == 0 ? 0 : &(*test_channelOffset)[t],
+          frame_length_normalisation, v_t);
+
+        // The supervector is computed in double precision, and only stored
+        // in the precision of the scores
+        B(k, blitz::Range::all()) = blitz::cast<T>(v_t);
+      }
+
+      // 2) Compute LLR of the block
+      const blitz::Array<T,2> B_b = B(blitz::Range(0,nb-1), blitz::Range::all());
+      blitz::Array<T,2> scores_b = scores_(blitz::Range::all(), blitz::Range(b0,b0+nb-1));
+      bob::math::gemm_(A, B_b, scores_b, false, true);
+    }
+  }
+
+  /**
+   * Same as scoreRange(), but with the raw model mean supervectors M of a
+   * ModelBank, which are not normalized (nor copied): as 
+   * (m - mu)/sigma . v = m . (v/sigma) - mu . (v/sigma), the test 
+   * supervectors are divided by the UBM variances instead, and the 
+   * projection of the UBM mean is subtracted from the scores.
+   */
+  static void bankScoreRange(const blitz::Array<double,2>& M,
+                             const blitz::Array<double,1>& ubm_mean,
+                             const blitz::Array<double,1>& ubm_variance,
+                             const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+                             const std::vector<blitz::Array<double,1> >* test_channelOffset,
+                             const bool frame_length_normalisation,
+                             blitz::Array<double,2>& scores,
+                             const size_t begin, const size_t end)
+  {
+    const int CD = M.extent(1);
+    const int max_block = std::min(BLOCK_SIZE, (int)(end-begin));
+    blitz::Array<double,1> v_t(CD);
+    blitz::Array<double,2> B(max_block, CD);
+    blitz::Array<double,1> mu_B(max_block);
+    // the blocks of scores are views of an alias private to this thread
+    blitz::Array<double,2> scores_ = ca::alias(scores);
+
+    for(int b0=(int)begin; b0<(int)end; b0+=BLOCK_SIZE) {
+      const int nb = std::min(BLOCK_SIZE, (int)end-b0);
+
+      for(int k=0; k<nb; ++k) {
+        const int t = b0 + k;
+        supervector(*test_stats[t], ubm_mean, 
+          test_channelOffset == 0 ? 0 : &(*test_channelOffset)[t],
+          frame_length_normalisation, v_t);
+        blitz::Array<double,1> B_k = B(k, blitz::Range::all());
+        B_k = v_t / ubm_variance;
+        mu_B(k) = blitz::sum(ubm_mean * B_k);
+      }
+
+      const blitz::Array<double,2> B_b = B(blitz::Range(0,nb-1), blitz::Range::all());
+      blitz::Array<double,2> scores_b = scores_(blitz::Range::all(), blitz::Range(b0,b0+nb-1));
+      bob::math::gemm_(M, B_b, scores_b, false, true);
+      for(int k=0; k<nb; ++k) {
+        blitz::Array<double,1> scores_bk = scores_b(blitz::Range::all(), k);
+        scores_bk -= mu_B(k);
       }
     }
+  }
+
+  template <typename T>
+  static void linearScoring(const blitz::Array<T,2>& A,
+                            const blitz::Array<double,1>& ubm_mean,
+                            const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+                            const std::vector<blitz::Array<double,1> >* test_channelOffset,
+                            const bool frame_length_normalisation,
+                            blitz::Array<T,2>& scores,
+                            const size_t n_threads)
+  {
+    // Check output size
+    ca::assertZeroBase(scores);
+    ca::assertSameDimensionLength(scores.extent(0), A.extent(0));
+    ca::assertSameDimensionLength(scores.extent(1), test_stats.size());
+    checkTests(A.extent(1), test_stats, test_channelOffset);
+
+    bob::core::thread_loop(boost::bind(&scoreRange<T>, boost::cref(A),
+          boost::cref(ubm_mean), boost::cref(test_stats), test_channelOffset,
+          frame_length_normalisation, boost::ref(scores), (size_t)0, _1, _2),
+        test_stats.size(), n_threads);
+  }
+
+  static void linearScoring(const blitz::Array<double,2>& A,
+                            const blitz::Array<double,1>& ubm_mean,
+                            const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+                            const std::vector<blitz::Array<double,1> >* test_channelOffset,
+                            const bool frame_length_normalisation,
+                            bob::io::HDF5File& file, const std::string& path,
+                            const size_t n_threads)
+  {
+    checkTests(A.extent(1), test_stats, test_channelOffset);
+
+    // The scores of one block per thread are computed at once, and then 
+    // sequentially appended to the file, as the latter is not thread-safe
+    const int n_tests = test_stats.size();
+    const int stream = BLOCK_SIZE * std::max((int)n_threads, 1);
+    blitz::Array<double,2> buffer(A.extent(0), std::min(stream, n_tests));
+    for(int t0=0; t0<n_tests; t0+=stream) {
+      const int nt = std::min(stream, n_tests-t0);
+      bob::core::thread_loop(boost::bind(&scoreRange<double>, boost::cref(A),
+            boost::cref(ubm_mean), boost::cref(test_stats), test_channelOffset,
+            frame_length_normalisation, boost::ref(buffer), (size_t)t0, _1, _2),
+          nt, n_threads);
+      for(int k=0; k<nt; ++k) {
+        blitz::Array<double,1> scores_t = buffer(blitz::Range::all(), k);
+        file.appendArray(path, scores_t);
+      }
+    }
+  }
 
-    // 3) Compute LLR
-    bob::math::prod(A, B, scores);
-  } 
+  /**
+   * Computes the scores in single precision: the normalized models are
+   * rounded once, and the test supervectors of each block are rounded
+   * before the (single precision) matrix product
+   */
+  static void linearScoring(const blitz::Array<double,2>& A,
+                            const blitz::Array<double,1>& ubm_mean,
+                            const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+                            const std::vector<blitz::Array<double,1> >* test_channelOffset,
+                            const bool frame_length_normalisation,
+                            blitz::Array<float,2>& scores,
+                            const size_t n_threads)
+  {
+    const blitz::Array<float,2> A_f(blitz::cast<float>(A));
+    linearScoring<float>(A_f, ubm_mean, test_stats, test_channelOffset, frame_length_normalisation, scores, n_threads);
+  }
 }
 
 
@@ -94,39 +287,33 @@ void linearScoring(const std::vector<blitz::Array<double,1> >& models,
                    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
                    const std::vector<blitz::Array<double,1> >& test_channelOffset,
                    const bool frame_length_normalisation,
-                   blitz::Array<double, 2>& scores)
+                   blitz::Array<double, 2>& scores, const size_t n_threads)
 {
-  detail::linearScoring(models, ubm_mean, ubm_variance, test_stats, &test_channelOffset, frame_length_normalisation, scores);
+  blitz::Array<double,2> A;
+  detail::normalizeModels(models, ubm_mean, ubm_variance, A);
+  detail::linearScoring(A, ubm_mean, test_stats, &test_channelOffset, frame_length_normalisation, scores, n_threads);
 }
 
 void linearScoring(const std::vector<blitz::Array<double,1> >& models,
                    const blitz::Array<double,1>& ubm_mean, const blitz::Array<double,1>& ubm_variance,
                    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
                    const bool frame_length_normalisation,
-                   blitz::Array<double, 2>& scores)
+                   blitz::Array<double, 2>& scores, const size_t n_threads)
 {
-  detail::linearScoring(models, ubm_mean, ubm_variance, test_stats, 0, frame_length_normalisation, scores);
+  blitz::Array<double,2> A;
+  detail::normalizeModels(models, ubm_mean, ubm_variance, A);
+  detail::linearScoring(A, ubm_mean, test_stats, 0, frame_length_normalisation, scores, n_threads);
 }
 
 void linearScoring(const std::vector<boost::shared_ptr<const bob::machine::GMMMachine> >& models,
                    const bob::machine::GMMMachine& ubm,
                    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
                    const bool frame_length_normalisation,
-                   blitz::Array<double, 2>& scores) 
+                   blitz::Array<double, 2>& scores, const size_t n_threads) 
 {
-  int C = test_stats[0]->sumPx.extent(0);
-  int D = test_stats[0]->sumPx.extent(1);
-  int CD = C*D;
-  std::vector<blitz::Array<double,1> > models_b;
-  // Allocate and get the mean supervector
-  for(size_t i=0; i<models.size(); ++i) {
-    blitz::Array<double,1> mod(CD);
-    models[i]->getMeanSupervector(mod);
-    models_b.push_back(mod);
-  }
-  const blitz::Array<double,1>& ubm_mean = ubm.getMeanSupervector();
-  const blitz::Array<double,1>& ubm_variance = ubm.getVarianceSupervector();
-  detail::linearScoring(models_b, ubm_mean, ubm_variance, test_stats, 0, frame_length_normalisation, scores);
+  blitz::Array<double,2> A;
+  detail::normalizeModels(models, ubm, A);
+  detail::linearScoring(A, ubm.getMeanSupervector(), test_stats, 0, frame_length_normalisation, scores, n_threads);
 }
 
 void linearScoring(const std::vector<boost::shared_ptr<const bob::machine::GMMMachine> >& models,
@@ -134,21 +321,93 @@ void linearScoring(const std::vector<boost::shared_ptr<const bob::machine::GMMMa
                    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
                    const std::vector<blitz::Array<double,1> >& test_channelOffset,
                    const bool frame_length_normalisation,
-                   blitz::Array<double, 2>& scores) 
+                   blitz::Array<double, 2>& scores, const size_t n_threads) 
+{
+  blitz::Array<double,2> A;
+  detail::normalizeModels(models, ubm, A);
+  detail::linearScoring(A, ubm.getMeanSupervector(), test_stats, &test_channelOffset, frame_length_normalisation, scores, n_threads);
+}
+
+void linearScoring(const std::vector<blitz::Array<double,1> >& models,
+                   const blitz::Array<double,1>& ubm_mean, const blitz::Array<double,1>& ubm_variance,
+                   const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+                   const std::vector<blitz::Array<double,1> >& test_channelOffset,
+                   const bool frame_length_normalisation,
+                   blitz::Array<float, 2>& scores, const size_t n_threads)
+{
+  blitz::Array<double,2> A;
+  detail::normalizeModels(models, ubm_mean, ubm_variance, A);
+  detail::linearScoring(A, ubm_mean, test_stats, 
+    test_channelOffset.empty() ? 0 : &test_channelOffset, 
+    frame_length_normalisation, scores, n_threads);
+}
+
+void linearScoring(const std::vector<boost::shared_ptr<const bob::machine::GMMMachine> >& models,
+                   const bob::machine::GMMMachine& ubm,
+                   const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+                   const std::vector<blitz::Array<double,1> >& test_channelOffset,
+                   const bool frame_length_normalisation,
+                   blitz::Array<float, 2>& scores, const size_t n_threads) 
+{
+  blitz::Array<double,2> A;
+  detail::normalizeModels(models, ubm, A);
+  detail::linearScoring(A, ubm.getMeanSupervector(), test_stats, 
+    test_channelOffset.empty() ? 0 : &test_channelOffset, 
+    frame_length_normalisation, scores, n_threads);
+}
+
+void linearScoring(const std::vector<blitz::Array<double,1> >& models,
+                   const blitz::Array<double,1>& ubm_mean, const blitz::Array<double,1>& ubm_variance,
+                   const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+                   const std::vector<blitz::Array<double,1> >& test_channelOffset,
+                   const bool frame_length_normalisation,
+                   bob::io::HDF5File& file, const std::string& path,
+                   const size_t n_threads)
+{
+  blitz::Array<double,2> A;
+  detail::normalizeModels(models, ubm_mean, ubm_variance, A);
+  detail::linearScoring(A, ubm_mean, test_stats, 
+    test_channelOffset.empty() ? 0 : &test_channelOffset, 
+    frame_length_normalisation, file, path, n_threads);
+}
+
+void linearScoring(const std::vector<boost::shared_ptr<const bob::machine::GMMMachine> >& models,
+                   const bob::machine::GMMMachine& ubm,
+                   const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+                   const std::vector<blitz::Array<double,1> >& test_channelOffset,
+                   const bool frame_length_normalisation,
+                   bob::io::HDF5File& file, const std::string& path,
+                   const size_t n_threads)
+{
+  blitz::Array<double,2> A;
+  detail::normalizeModels(models, ubm, A);
+  detail::linearScoring(A, ubm.getMeanSupervector(), test_stats, 
+    test_channelOffset.empty() ? 0 : &test_channelOffset, 
+    frame_length_normalisation, file, path, n_threads);
+}
+
+void linearScoring(const bob::machine::ModelBank& models,
+                   const bob::machine::GMMMachine& ubm,
+                   const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+                   const std::vector<blitz::Array<double,1> >& test_channelOffset,
+                   const bool frame_length_normalisation,
+                   blitz::Array<double, 2>& scores, const size_t n_threads) 
 {
-  int C = test_stats[0]->sumPx.extent(0);
-  int D = test_stats[0]->sumPx.extent(1);
-  int CD = C*D;
-  std::vector<blitz::Array<double,1> > models_b;
-  // Allocate and get the mean supervector
-  for(size_t i=0; i<models.size(); ++i) {
-    blitz::Array<double,1> mod(CD);
-    models[i]->getMeanSupervector(mod);
-    models_b.push_back(mod);
-  }
   const blitz::Array<double,1>& ubm_mean = ubm.getMeanSupervector();
   const blitz::Array<double,1>& ubm_variance = ubm.getVarianceSupervector();
-  detail::linearScoring(models_b, ubm_mean, ubm_variance, test_stats, &test_channelOffset, frame_length_normalisation, scores);
+  const blitz::Array<double,2> M = models.getField("mean");
+  ca::assertSameDimensionLength(M.extent(1), ubm_mean.extent(0));
+  ca::assertZeroBase(scores);
+  ca::assertSameDimensionLength(scores.extent(0), M.extent(0));
+  ca::assertSameDimensionLength(scores.extent(1), test_stats.size());
+  const std::vector<blitz::Array<double,1> >* offsets = 
+    test_channelOffset.empty() ? 0 : &test_channelOffset;
+  detail::checkTests(M.extent(1), test_stats, offsets);
+
+  bob::core::thread_loop(boost::bind(&detail::bankScoreRange, boost::cref(M),
+        boost::cref(ubm_mean), boost::cref(ubm_variance), boost::cref(test_stats),
+        offsets, frame_length_normalisation, boost::ref(scores), _1, _2),
+      test_stats.size(), n_threads);
 }
 
 }}
@@ -22,19 +22,27 @@
 
 #include <sys/time.h>
 #include <cmath>
+#include <algorithm>
 #include <boost/format.hpp>
+#include <boost/bind.hpp>
 
+#include "bob/core/array_alias.h"
 #include "bob/core/array_check.h"
 #include "bob/core/array_copy.h"
 #include "bob/core/array_assert.h"
+#include "bob/core/parallel.h"
 #include "bob/machine/MLP.h"
 #include "bob/machine/MLPException.h"
 #include "bob/math/linear.h"
+#include "bob/math/gemm.h"
 
 namespace mach = bob::machine;
 namespace math = bob::math;
 namespace array = bob::core::array;
 
+// Number of inputs that are propagated through the network at once
+static const int BLOCK_SIZE = 256;
+
 mach::MLP::MLP (size_t input, size_t output):
   m_input_sub(input),
   m_input_div(input),
@@ -95,6 +103,7 @@ mach::MLP::MLP (const std::vector<size_t>& shape):
 }
 
 mach::MLP::MLP (const mach::MLP& other):
+  mach::Machine<blitz::Array<double,1>, blitz::Array<double,1> >(other),
   m_input_sub(bob::core::array::ccopy(other.m_input_sub)),
   m_input_div(bob::core::array::ccopy(other.m_input_div)),
   m_weight(other.m_weight.size()),
@@ -215,19 +224,61 @@ void mach::MLP::forward (const blitz::Array<double,1>& input,
   forward_(input, output); 
 }
 
-void mach::MLP::forward_ (const blitz::Array<double,2>& input,
-    blitz::Array<double,2>& output) const {
+void mach::MLP::forwardRange (const blitz::Array<double,2>& input,
+    blitz::Array<double,2>& output, const size_t begin,
+    const size_t end) const {
 
   blitz::Range all = blitz::Range::all();
-  for (int i=0; i<input.extent(0); ++i) {
-    blitz::Array<double,1> inref(input(i,all));
-    blitz::Array<double,1> outref(output(i,all));
-    forward_(inref, outref);
+  blitz::firstIndex i;
+  blitz::secondIndex k;
+
+  //the blocks are views of aliases private to this thread
+  const blitz::Array<double,2> input_ = array::alias(input);
+  blitz::Array<double,2> output_ = array::alias(output);
+
+  //buffers of this thread: the (normalized) inputs and the hidden layers
+  std::vector<blitz::Array<double,2> > buffer(m_weight.size());
+  for (size_t j=0; j<m_weight.size(); ++j)
+    buffer[j].resize(BLOCK_SIZE, m_weight[j].extent(0));
+
+  for (int b=(int)begin; b<(int)end; b+=BLOCK_SIZE) {
+    const int n = std::min(BLOCK_SIZE, (int)end - b);
+    blitz::Range block(b, b+n-1), rows(0, n-1);
+    const blitz::Array<double,2> in = input_(block, all);
+    blitz::Array<double,2> x = buffer[0](rows, all);
+    x = (in(i,k) - m_input_sub(k)) / m_input_div(k);
+
+    //input -> hidden[0]; hidden[0] -> hidden[1], ..., hidden[N-2] -> hidden[N-1]
+    for (size_t j=1; j<m_weight.size(); ++j) {
+      blitz::Array<double,2> h = buffer[j](rows, all);
+      math::gemm_(x, m_weight[j-1], h);
+      const blitz::Array<double,1>& bias = m_bias[j-1]; //opt. access
+      for (int r=0; r<n; ++r)
+        for (int c=0; c<h.extent(1); ++c)
+          h(r,c) = m_actfun(h(r,c) + bias(c));
+      x.reference(h);
+    }
+
+    //hidden[N-1] -> output
+    blitz::Array<double,2> y = output_(block, all);
+    math::gemm_(x, m_weight.back(), y);
+    const blitz::Array<double,1>& last_bias = m_bias.back(); //opt. access
+    for (int r=0; r<n; ++r)
+      for (int c=0; c<y.extent(1); ++c)
+        y(r,c) = m_actfun(y(r,c) + last_bias(c));
   }
 }
 
+void mach::MLP::forward_ (const blitz::Array<double,2>& input,
+    blitz::Array<double,2>& output, const size_t n_threads) const {
+
+  bob::core::thread_loop(boost::bind(&mach::MLP::forwardRange, this,
+        boost::cref(input), boost::ref(output), _1, _2), input.extent(0),
+      n_threads);
+}
+
 void mach::MLP::forward (const blitz::Array<double,2>& input,
-    blitz::Array<double,2>& output) const {
+    blitz::Array<double,2>& output, const size_t n_threads) const {
 
   //checks input
   if (m_weight.front().extent(0) != input.extent(1)) //checks input
@@ -238,7 +289,7 @@ void mach::MLP::forward (const blitz::Array<double,2>& input,
         output.extent(1));
   //checks output
   array::assertSameDimensionLength(input.extent(0), output.extent(0));
-  forward_(input, output); 
+  forward_(input, output, n_threads); 
 }
 
 void mach::MLP::resize (size_t input, size_t output) {
@@ -0,0 +1,327 @@
+/**
+ * @file machine/cxx/ModelBank.cc
+ * @date Mon Oct 19 20:14:08 2026 +0200
+ *
+ * @brief Implements the ModelBank
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bob/machine/ModelBank.h"
+#include "bob/core/array_assert.h"
+#include "bob/core/array_copy.h"
+#include <boost/format.hpp>
+#include <algorithm>
+#include <stdexcept>
+
+namespace ca = bob::core::array;
+
+/**
+ * Initial number of rows of the fields
+ */
+static const size_t MIN_CAPACITY = 16;
+
+bob::machine::ModelBank::ModelBank()
+{
+}
+
+bob::machine::ModelBank::ModelBank(const std::vector<std::string>& names,
+    const std::vector<size_t>& sizes)
+{
+  init(names, sizes);
+}
+
+bob::machine::ModelBank::ModelBank(const bob::machine::GMMMachine& ubm)
+{
+  std::vector<std::string> names(1, "mean");
+  std::vector<size_t> sizes(1, ubm.getNGaussians() * ubm.getNInputs());
+  init(names, sizes);
+}
+
+bob::machine::ModelBank::ModelBank(const bob::machine::JFABaseMachine& base)
+{
+  std::vector<std::string> names;
+  std::vector<size_t> sizes;
+  names.push_back("y"); sizes.push_back(base.getDimRv());
+  names.push_back("z"); sizes.push_back(base.getDimCD());
+  init(names, sizes);
+}
+
+bob::machine::ModelBank::ModelBank(const bob::machine::PLDABaseMachine& base)
+{
+  std::vector<std::string> names;
+  std::vector<size_t> sizes;
+  names.push_back("weighted_sum"); sizes.push_back(base.getDimF());
+  names.push_back("n_samples"); sizes.push_back(1);
+  names.push_back("nh_sum_xit_beta_xi"); sizes.push_back(1);
+  names.push_back("log_likelihood"); sizes.push_back(1);
+  init(names, sizes);
+}
+
+bob::machine::ModelBank::ModelBank(const bob::machine::ModelBank& other):
+  m_names(other.m_names),
+  m_ids(other.m_ids),
+  m_rows(other.m_rows)
+{
+  for (size_t f=0; f<other.m_fields.size(); ++f)
+    m_fields.push_back(ca::ccopy(other.m_fields[f]));
+}
+
+bob::machine::ModelBank::ModelBank(bob::io::HDF5File& config)
+{
+  load(config);
+}
+
+bob::machine::ModelBank::~ModelBank() {}
+
+bob::machine::ModelBank& bob::machine::ModelBank::operator=
+(const bob::machine::ModelBank& other) {
+  if (this != &other)
+  {
+    m_names = other.m_names;
+    m_fields.clear();
+    for (size_t f=0; f<other.m_fields.size(); ++f)
+      m_fields.push_back(ca::ccopy(other.m_fields[f]));
+    m_ids = other.m_ids;
+    m_rows = other.m_rows;
+  }
+  return *this;
+}
+
+void bob::machine::ModelBank::init(const std::vector<std::string>& names,
+    const std::vector<size_t>& sizes) {
+  ca::assertSameDimensionLength(names.size(), sizes.size());
+  m_names = names;
+  m_fields.clear();
+  for (size_t f=0; f<sizes.size(); ++f) {
+    for (size_t g=0; g<f; ++g)
+      if (names[g] == names[f])
+        throw std::runtime_error((boost::format("the field '%s' of the ModelBank is defined twice") % names[f]).str());
+    m_fields.push_back(blitz::Array<double,2>(0, sizes[f]));
+  }
+  m_ids.clear();
+  m_rows.clear();
+}
+
+void bob::machine::ModelBank::load(bob::io::HDF5File& config) {
+  const int64_t n_fields = config.read<int64_t>("n_fields");
+  const int64_t n_models = config.read<int64_t>("n_models");
+  std::vector<std::string> names;
+  std::vector<size_t> sizes;
+  for (int64_t f=0; f<n_fields; ++f) {
+    names.push_back(config.read<std::string>((boost::format("field_name_%d") % f).str()));
+    sizes.push_back(config.read<int64_t>((boost::format("field_size_%d") % f).str()));
+  }
+
+  for (int64_t f=0; f<n_fields; ++f)
+    for (int64_t g=0; g<f; ++g)
+      if (names[g] == names[f])
+        throw std::runtime_error((boost::format("the field '%s' of the ModelBank is defined twice") % names[f]).str());
+
+  // Everything is read and checked before the bank is modified, so that a
+  // failed load leaves it untouched. Duplicated identifiers are rejected,
+  // as set() and get() only reach the first row of such an identifier
+  std::vector<int64_t> id_list;
+  std::map<int64_t,size_t> rows;
+  if (n_models > 0) {
+    blitz::Array<int64_t,1> ids = config.readArray<int64_t,1>("ids");
+    ca::assertSameDimensionLength(ids.extent(0), n_models);
+    id_list.reserve(n_models);
+    for (int64_t i=0; i<n_models; ++i) {
+      if (!rows.insert(std::make_pair(ids(i), (size_t)i)).second)
+        throw std::runtime_error((boost::format("the model id %d is stored twice in the ModelBank file") % ids(i)).str());
+      id_list.push_back(ids(i));
+    }
+  }
+
+  std::vector<blitz::Array<double,2> > fields;
+  for (int64_t f=0; f<n_fields; ++f) {
+    if (n_models > 0) {
+      // A single (bulk) read per field
+      fields.push_back(config.readArray<double,2>((boost::format("field_%d") % f).str()));
+      ca::assertSameDimensionLength(fields[f].extent(0), n_models);
+      ca::assertSameDimensionLength(fields[f].extent(1), sizes[f]);
+    }
+    else fields.push_back(blitz::Array<double,2>(0, sizes[f]));
+  }
+
+  m_names.swap(names);
+  m_fields.swap(fields);
+  m_ids.swap(id_list);
+  m_rows.swap(rows);
+}
+
+void bob::machine::ModelBank::save(bob::io::HDF5File& config) const {
+  config.set("n_fields", static_cast<int64_t>(m_names.size()));
+  config.set("n_models", static_cast<int64_t>(size()));
+  for (size_t f=0; f<m_names.size(); ++f) {
+    config.set((boost::format("field_name_%d") % f).str(), m_names[f]);
+    config.set((boost::format("field_size_%d") % f).str(),
+        static_cast<int64_t>(m_fields[f].extent(1)));
+    if (size() > 0)
+      config.setArray((boost::format("field_%d") % f).str(),
+          getField(m_names[f]));
+  }
+  if (size() > 0) {
+    blitz::Array<int64_t,1> ids(size());
+    for (size_t i=0; i<size(); ++i) ids(i) = m_ids[i];
+    config.setArray("ids", ids);
+  }
+}
+
+bool bob::machine::ModelBank::hasField(const std::string& name) const {
+  return std::find(m_names.begin(), m_names.end(), name) != m_names.end();
+}
+
+size_t bob::machine::ModelBank::fieldIndex(const std::string& name) const {
+  std::vector<std::string>::const_iterator it =
+    std::find(m_names.begin(), m_names.end(), name);
+  if (it == m_names.end())
+    throw std::runtime_error((boost::format("the ModelBank has no field '%s'") % name).str());
+  return it - m_names.begin();
+}
+
+size_t bob::machine::ModelBank::checkField(const std::string& name,
+    const size_t size) const {
+  const size_t f = fieldIndex(name);
+  if ((size_t)m_fields[f].extent(1) != size) {
+    boost::format m("the field '%s' of the ModelBank has size %d, whereas %d was expected");
+    m % name % m_fields[f].extent(1) % size;
+    throw std::runtime_error(m.str());
+  }
+  return f;
+}
+
+size_t bob::machine::ModelBank::getFieldSize(const std::string& name) const {
+  return m_fields[fieldIndex(name)].extent(1);
+}
+
+const blitz::Array<double,2> bob::machine::ModelBank::getField
+(const std::string& name) const {
+  const blitz::Array<double,2>& field = m_fields[fieldIndex(name)];
+  if (size() == 0) return blitz::Array<double,2>(0, field.extent(1));
+  // The first rows of a contiguous (row-major) array are contiguous
+  return field(blitz::Range(0, (int)size()-1), blitz::Range::all());
+}
+
+const blitz::Array<double,1> bob::machine::ModelBank::getField
+(const std::string& name, const int64_t id) const {
+  return m_fields[fieldIndex(name)](getRow(id), blitz::Range::all());
+}
+
+bool bob::machine::ModelBank::contains(const int64_t id) const {
+  return m_rows.find(id) != m_rows.end();
+}
+
+size_t bob::machine::ModelBank::getRow(const int64_t id) const {
+  std::map<int64_t,size_t>::const_iterator it = m_rows.find(id);
+  if (it == m_rows.end())
+    throw std::runtime_error((boost::format("there is no model with id %d in the ModelBank") % id).str());
+  return it->second;
+}
+
+void bob::machine::ModelBank::reserve(const size_t n_models) {
+  for (size_t f=0; f<m_fields.size(); ++f)
+    if (n_models > (size_t)m_fields[f].extent(0))
+      m_fields[f].resizeAndPreserve(n_models, m_fields[f].extent(1));
+}
+
+size_t bob::machine::ModelBank::add(const int64_t id) {
+  std::map<int64_t,size_t>::const_iterator it = m_rows.find(id);
+  if (it != m_rows.end()) return it->second;
+
+  const size_t row = size();
+  if (m_fields.size() > 0 && row == (size_t)m_fields[0].extent(0))
+    reserve(std::max(2*row, MIN_CAPACITY));
+  for (size_t f=0; f<m_fields.size(); ++f)
+    m_fields[f](row, blitz::Range::all()) = 0.;
+  m_ids.push_back(id);
+  m_rows[id] = row;
+  return row;
+}
+
+void bob::machine::ModelBank::set(const int64_t id, const std::string& name,
+    const blitz::Array<double,1>& value) {
+  const size_t f = checkField(name, value.extent(0));
+  const size_t row = add(id);
+  m_fields[f](row, blitz::Range::all()) = value;
+}
+
+void bob::machine::ModelBank::set(const blitz::Array<int64_t,1>& ids,
+    const std::string& name, const blitz::Array<double,2>& values) {
+  ca::assertSameDimensionLength(ids.extent(0), values.extent(0));
+  const size_t f = checkField(name, values.extent(1));
+  reserve(size() + ids.extent(0));
+  for (int i=0; i<ids.extent(0); ++i) {
+    const size_t row = add(ids(i));
+    m_fields[f](row, blitz::Range::all()) = values(i + values.lbound(0), blitz::Range::all());
+  }
+}
+
+void bob::machine::ModelBank::add(const int64_t id,
+    const bob::machine::GMMMachine& model) {
+  const size_t f = checkField("mean", model.getNGaussians() * model.getNInputs());
+  const size_t row = add(id);
+  // The mean supervector is directly written into the bank
+  blitz::Array<double,1> mean = m_fields[f](row, blitz::Range::all());
+  model.getMeanSupervector(mean);
+}
+
+void bob::machine::ModelBank::add(const int64_t id,
+    const bob::machine::JFAMachine& model) {
+  const size_t fy = checkField("y", model.getY().extent(0));
+  const size_t fz = checkField("z", model.getZ().extent(0));
+  const size_t row = add(id);
+  m_fields[fy](row, blitz::Range::all()) = model.getY();
+  m_fields[fz](row, blitz::Range::all()) = model.getZ();
+}
+
+void bob::machine::ModelBank::add(const int64_t id,
+    const bob::machine::PLDAMachine& model) {
+  const size_t fw = checkField("weighted_sum", model.getWeightedSum().extent(0));
+  const size_t fn = checkField("n_samples", 1);
+  const size_t fs = checkField("nh_sum_xit_beta_xi", 1);
+  const size_t fl = checkField("log_likelihood", 1);
+  const size_t row = add(id);
+  m_fields[fw](row, blitz::Range::all()) = model.getWeightedSum();
+  m_fields[fn](row, 0) = model.getNSamples();
+  m_fields[fs](row, 0) = model.getWSumXitBetaXi();
+  m_fields[fl](row, 0) = model.getLogLikelihood();
+}
+
+bool bob::machine::ModelBank::remove(const int64_t id) {
+  std::map<int64_t,size_t>::iterator it = m_rows.find(id);
+  if (it == m_rows.end()) return false;
+
+  // The last model is moved into the freed row, to keep the rows contiguous
+  const size_t row = it->second;
+  const size_t last = size() - 1;
+  if (row != last) {
+    for (size_t f=0; f<m_fields.size(); ++f)
+      m_fields[f](row, blitz::Range::all()) = m_fields[f](last, blitz::Range::all());
+    m_ids[row] = m_ids[last];
+    m_rows[m_ids[row]] = row;
+  }
+  m_ids.pop_back();
+  m_rows.erase(id);
+  return true;
+}
+
+void bob::machine::ModelBank::clear() {
+  m_ids.clear();
+  m_rows.clear();
+  for (size_t f=0; f<m_fields.size(); ++f)
+    m_fields[f].resize(0, m_fields[f].extent(1));
+}
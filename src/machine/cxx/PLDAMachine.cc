@@ -20,16 +20,23 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "bob/core/array_alias.h"
 #include "bob/core/array_assert.h"
 #include "bob/core/array_copy.h"
+#include "bob/core/parallel.h"
 #include "bob/machine/Exception.h"
 #include "bob/machine/PLDAMachine.h"
+#include "bob/machine/ModelBank.h"
 #include "bob/math/linear.h"
+#include "bob/math/gemm.h"
 #include "bob/math/det.h"
 #include "bob/math/inv.h"
 
 #include <cmath>
+#include <stdexcept>
 #include <boost/lexical_cast.hpp>
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
 #include <string>
 
 #include "bob/core/logging.h"
@@ -42,7 +49,7 @@ mach::PLDABaseMachine::PLDABaseMachine():
   m_isigma(0), m_alpha(0,0), m_beta(0,0), m_gamma(),
   m_Ft_beta(0,0), m_Gt_isigma(0,0),
   m_logdet_alpha(0), m_logdet_sigma(0), m_loglike_constterm(),
-  m_cache_d_ng_1(0,0), m_cache_nf_nf_1(0,0), m_cache_ng_ng_1(0,0)
+  m_cache_d_ng_1(0,0), m_cache_ng_ng_1(0,0)
 {
 }
 
@@ -52,7 +59,7 @@ mach::PLDABaseMachine::PLDABaseMachine(const size_t d, const size_t nf,
   m_isigma(d), m_alpha(ng,ng), m_beta(d,d), m_gamma(),
   m_Ft_beta(nf,d), m_Gt_isigma(ng,d),
   m_logdet_alpha(0), m_logdet_sigma(0), m_loglike_constterm(),
-  m_cache_d_ng_1(d,ng), m_cache_nf_nf_1(nf,nf), m_cache_ng_ng_1(ng,ng)
+  m_cache_d_ng_1(d,ng), m_cache_ng_ng_1(ng,ng)
 {
   initFGSigma();
 }
@@ -73,7 +80,6 @@ mach::PLDABaseMachine::PLDABaseMachine(const mach::PLDABaseMachine& other):
   m_logdet_sigma(other.m_logdet_sigma),
   m_loglike_constterm(other.m_loglike_constterm),
   m_cache_d_ng_1(tca::ccopy(other.m_cache_d_ng_1)), 
-  m_cache_nf_nf_1(tca::ccopy(other.m_cache_nf_nf_1)), 
   m_cache_ng_ng_1(tca::ccopy(other.m_cache_ng_ng_1))
 {
   tca::ccopy(other.m_gamma, m_gamma);
@@ -103,7 +109,6 @@ mach::PLDABaseMachine& mach::PLDABaseMachine::operator=
   m_logdet_sigma = other.m_logdet_sigma;
   m_loglike_constterm = other.m_loglike_constterm;
   m_cache_d_ng_1.reference(tca::ccopy(other.m_cache_d_ng_1));
-  m_cache_nf_nf_1.reference(tca::ccopy(other.m_cache_nf_nf_1));
   m_cache_ng_ng_1.reference(tca::ccopy(other.m_cache_ng_ng_1));
   return *this;
 }
@@ -139,7 +144,6 @@ void mach::PLDABaseMachine::load(bob::io::HDF5File& config) {
   m_logdet_alpha = config.read<double>("logdet_alpha");
   m_logdet_sigma = config.read<double>("logdet_sigma");
   m_cache_d_ng_1.resize(d,ng);
-  m_cache_nf_nf_1.resize(nf,nf);
   m_cache_ng_ng_1.resize(ng,ng);
 }
 
@@ -188,7 +192,6 @@ void mach::PLDABaseMachine::resize(const size_t d, const size_t nf,
   m_gamma.clear();
   m_isigma.resize(d);
   m_cache_d_ng_1.resize(d,ng);
-  m_cache_nf_nf_1.resize(nf,nf);
   m_cache_ng_ng_1.resize(ng,ng);
   m_loglike_constterm.clear();
   initFGSigma();
@@ -230,6 +233,14 @@ blitz::Array<double,2>& mach::PLDABaseMachine::getGamma(const size_t a)
   return m_gamma[a];
 }
 
+const blitz::Array<double,2>& mach::PLDABaseMachine::getGamma(const size_t a) const
+{
+  std::map<size_t, blitz::Array<double,2> >::const_iterator it = m_gamma.find(a);
+  // TODO: specialized exception
+  if(it == m_gamma.end()) throw bob::machine::Exception();
+  return it->second;
+}
+
 blitz::Array<double,2>& mach::PLDABaseMachine::getAddGamma(const size_t a)
 {
   if(!hasGamma(a)) precomputeGamma(a);
@@ -314,21 +325,24 @@ void mach::PLDABaseMachine::precomputeFtBeta() {
 }
 
 void mach::PLDABaseMachine::computeGamma(const size_t a, 
-  blitz::Array<double,2> res)
+  blitz::Array<double,2> res) const
 {
   // gamma = (Id + a.F^T.beta.F)^-1
 
   // Checks destination size
-  tca::assertSameShape(res, m_cache_nf_nf_1);
-  // m_cache_nf_nf_1 = F^T.beta.F
-  bob::math::prod(m_Ft_beta, m_F, m_cache_nf_nf_1);
-   // m_cache_nf_nf_1 = a.F^T.beta.F
-  m_cache_nf_nf_1 *= static_cast<double>(a);
-  // m_cache_nf_nf_1 = Id + a.F^T.beta.F
-  for(int i=0; i<m_cache_nf_nf_1.extent(0); ++i) m_cache_nf_nf_1(i,i) += 1;
+  tca::assertSameDimensionLength(res.extent(0), getDimF());
+  tca::assertSameDimensionLength(res.extent(1), getDimF());
+  // A local buffer is used, as this function might be called concurrently
+  blitz::Array<double,2> tmp(getDimF(), getDimF());
+  // tmp = F^T.beta.F
+  bob::math::prod(m_Ft_beta, m_F, tmp);
+   // tmp = a.F^T.beta.F
+  tmp *= static_cast<double>(a);
+  // tmp = Id + a.F^T.beta.F
+  for(int i=0; i<tmp.extent(0); ++i) tmp(i,i) += 1;
 
   // res = (Id + a.F^T.beta.F)^-1
-  bob::math::inv(m_cache_nf_nf_1, res);
+  bob::math::inv(tmp, res);
 }
 
 void mach::PLDABaseMachine::precomputeLogDetAlpha()
@@ -342,7 +356,7 @@ void mach::PLDABaseMachine::precomputeLogDetSigma()
 }
 
 double mach::PLDABaseMachine::computeLogLikeConstTerm(const size_t a,
-  const blitz::Array<double,2>& gamma_a)
+  const blitz::Array<double,2>& gamma_a) const
 {
   // loglike_constterm[a] = a/2 * 
   //  ( -D*log(2*pi) -log|sigma| +log|alpha| +log|gamma_a|)
@@ -365,11 +379,12 @@ void mach::PLDABaseMachine::precomputeLogLikeConstTerm(const size_t a)
   m_loglike_constterm[a] = val;
 }
 
-double mach::PLDABaseMachine::getLogLikeConstTerm(const size_t a)
+double mach::PLDABaseMachine::getLogLikeConstTerm(const size_t a) const
 {
+  std::map<size_t, double>::const_iterator it = m_loglike_constterm.find(a);
   // TODO: specialized exception
-  if(!hasLogLikeConstTerm(a)) throw bob::machine::Exception();
-  return m_loglike_constterm[a];
+  if(it == m_loglike_constterm.end()) throw bob::machine::Exception();
+  return it->second;
 }
 
 double mach::PLDABaseMachine::getAddLogLikeConstTerm(const size_t a)
@@ -378,27 +393,237 @@ double mach::PLDABaseMachine::getAddLogLikeConstTerm(const size_t a)
   return m_loglike_constterm[a];
 }
 
+void mach::PLDABaseMachine::precomputeLogLikeConstTerms(const size_t a_min,
+  const size_t a_max)
+{
+  for(size_t a=a_min; a<=a_max; ++a) getAddLogLikeConstTerm(a);
+}
+
 void mach::PLDABaseMachine::clearMaps()
 {
   m_gamma.clear();
   m_loglike_constterm.clear();
 }
 
+/**
+ * Looks for gamma_a and the log likelihood constant term in the base
+ * machine, then in the given PLDAMachine (if any), and computes them 
+ * otherwise. Nothing is modified, so that this can be used concurrently.
+ */
+static void lookupLogLikeConstTerm(const mach::PLDABaseMachine& base,
+  const mach::PLDAMachine* model, const size_t a,
+  blitz::Array<double,2>& gamma_a, double& constterm)
+{
+  if(base.hasGamma(a) && base.hasLogLikeConstTerm(a)) {
+    gamma_a.reference(base.getGamma(a));
+    constterm = base.getLogLikeConstTerm(a);
+  }
+  else if(model && model->hasGamma(a) && model->hasLogLikeConstTerm(a)) {
+    gamma_a.reference(model->getGamma(a));
+    constterm = model->getLogLikeConstTerm(a);
+  }
+  else {
+    gamma_a.resize(base.getDimF(), base.getDimF());
+    base.computeGamma(a, gamma_a);
+    constterm = base.computeLogLikeConstTerm(a, gamma_a);
+  }
+}
+
+/**
+ * Computes the scoring terms w_m and c_m of a model, and the index of its
+ * 1/2.(gamma_a - gamma_1) matrix in gamma_diff, which is added if required
+ */
+static void prepareModel(const mach::PLDABaseMachine& base,
+  const mach::PLDAMachine* model, const size_t n_samples,
+  const blitz::Array<double,1>& weighted_sum, const double wsum_xit_beta_xi,
+  const double log_likelihood, const blitz::Array<double,2>& gamma_1,
+  const double constterm_1, blitz::Array<double,1>& W_m, double& c_m,
+  size_t& a_index_m, std::map<size_t, size_t>& a_indices,
+  std::vector<blitz::Array<double,2> >& gamma_diff)
+{
+  const size_t a = n_samples + 1;
+  blitz::Array<double,2> gamma_a;
+  double constterm_a;
+  lookupLogLikeConstTerm(base, model, a, gamma_a, constterm_a);
+
+  std::map<size_t, size_t>::const_iterator it = a_indices.find(a);
+  if(it == a_indices.end()) {
+    a_index_m = gamma_diff.size();
+    a_indices[a] = gamma_diff.size();
+    blitz::Array<double,2> diff(gamma_a.shape());
+    diff = (gamma_a - gamma_1) / 2.;
+    gamma_diff.push_back(diff);
+  }
+  else a_index_m = it->second;
+
+  if(n_samples > 0) {
+    bob::math::prod(gamma_a, weighted_sum, W_m);
+    c_m = blitz::sum(W_m * weighted_sum) / 2.;
+  }
+  else {
+    W_m = 0.;
+    c_m = 0.;
+  }
+  c_m += constterm_a - constterm_1 + wsum_xit_beta_xi - log_likelihood;
+}
+
+void mach::PLDABaseMachine::forward(const std::vector<boost::shared_ptr<const mach::PLDAMachine> >& models,
+  const blitz::Array<double,2>& probes, blitz::Array<double,2>& scores,
+  const size_t n_threads) const
+{
+  tca::assertZeroBase(probes);
+  tca::assertZeroBase(scores);
+  tca::assertSameDimensionLength(probes.extent(1), getDimD());
+  tca::assertSameDimensionLength(scores.extent(0), models.size());
+  tca::assertSameDimensionLength(scores.extent(1), probes.extent(0));
+
+  // The log likelihood ratio of a probe x (with u = F^T.beta.(x-mu)) 
+  // against a model enrolled with n samples and a = n+1 is:
+  //   K(a) - K(1) + A - L + 1/2.(ws+u)^T.gamma_a.(ws+u) - 1/2.u^T.gamma_1.u
+  // where K is the log likelihood constant term, A the nh_sum_xit_beta_xi 
+  // term, L the log likelihood of the enrolled samples and ws the weighted
+  // sum of the model. It is split into:
+  //   c_m = K(a) - K(1) + A - L + 1/2.ws^T.gamma_a.ws (model dependent)
+  //   w_m^T.u with w_m = gamma_a.ws (computed with a matrix product)
+  //   1/2.u^T.(gamma_a - gamma_1).u (only depends on a)
+  const int nf = getDimF();
+  blitz::Array<double,2> gamma_1;
+  double constterm_1;
+  lookupLogLikeConstTerm(*this, 0, 1, gamma_1, constterm_1);
+
+  blitz::Array<double,2> W(models.size(), nf);
+  blitz::Array<double,1> c(models.size());
+  std::vector<size_t> a_index(models.size());
+  std::map<size_t, size_t> a_indices;
+  std::vector<blitz::Array<double,2> > gamma_diff;
+  blitz::Range rall = blitz::Range::all();
+  for(int m=0; m<(int)models.size(); ++m) {
+    const mach::PLDAMachine& model = *models[m];
+    if(model.getPLDABase().get() != this) {
+      boost::format e("model %d is not attached to the PLDABaseMachine it is scored against");
+      e % m;
+      throw std::runtime_error(e.str());
+    }
+    tca::assertSameDimensionLength(model.getWeightedSum().extent(0), nf);
+    blitz::Array<double,1> W_m = W(m,rall);
+    prepareModel(*this, &model, model.getNSamples(), model.getWeightedSum(),
+      model.getWSumXitBetaXi(), model.getLogLikelihood(), gamma_1,
+      constterm_1, W_m, c(m), a_index[m], a_indices, gamma_diff);
+  }
+
+  bob::core::thread_loop(boost::bind(&mach::PLDABaseMachine::forwardRange,
+        this, boost::cref(W), boost::cref(c), boost::cref(a_index),
+        boost::cref(gamma_diff), boost::cref(probes), boost::ref(scores),
+        _1, _2), probes.extent(0), n_threads);
+}
+
+void mach::PLDABaseMachine::forward(const mach::ModelBank& models,
+  const blitz::Array<double,2>& probes, blitz::Array<double,2>& scores,
+  const size_t n_threads) const
+{
+  tca::assertZeroBase(probes);
+  tca::assertZeroBase(scores);
+  tca::assertSameDimensionLength(probes.extent(1), getDimD());
+  tca::assertSameDimensionLength(scores.extent(0), models.size());
+  tca::assertSameDimensionLength(scores.extent(1), probes.extent(0));
+
+  const int nf = getDimF();
+  const blitz::Array<double,2> weighted_sums = models.getField("weighted_sum");
+  const blitz::Array<double,2> n_samples = models.getField("n_samples");
+  const blitz::Array<double,2> wsum_xit_beta_xi = models.getField("nh_sum_xit_beta_xi");
+  const blitz::Array<double,2> log_likelihoods = models.getField("log_likelihood");
+  tca::assertSameDimensionLength(weighted_sums.extent(1), nf);
+
+  blitz::Array<double,2> gamma_1;
+  double constterm_1;
+  lookupLogLikeConstTerm(*this, 0, 1, gamma_1, constterm_1);
+
+  blitz::Array<double,2> W(models.size(), nf);
+  blitz::Array<double,1> c(models.size());
+  std::vector<size_t> a_index(models.size());
+  std::map<size_t, size_t> a_indices;
+  std::vector<blitz::Array<double,2> > gamma_diff;
+  blitz::Range rall = blitz::Range::all();
+  for(int m=0; m<(int)models.size(); ++m) {
+    const blitz::Array<double,1> ws_m = weighted_sums(m,rall);
+    blitz::Array<double,1> W_m = W(m,rall);
+    prepareModel(*this, 0, (size_t)n_samples(m,0), ws_m, 
+      wsum_xit_beta_xi(m,0), log_likelihoods(m,0), gamma_1, constterm_1, 
+      W_m, c(m), a_index[m], a_indices, gamma_diff);
+  }
+
+  bob::core::thread_loop(boost::bind(&mach::PLDABaseMachine::forwardRange,
+        this, boost::cref(W), boost::cref(c), boost::cref(a_index),
+        boost::cref(gamma_diff), boost::cref(probes), boost::ref(scores),
+        _1, _2), probes.extent(0), n_threads);
+}
+
+void mach::PLDABaseMachine::forwardRange(const blitz::Array<double,2>& W,
+  const blitz::Array<double,1>& c, const std::vector<size_t>& a_index,
+  const std::vector<blitz::Array<double,2> >& gamma_diff,
+  const blitz::Array<double,2>& probes, blitz::Array<double,2>& scores,
+  size_t begin, size_t end) const
+{
+  static const size_t BLOCK_SIZE = 256;
+  const int nf = getDimF();
+  const int n_a = gamma_diff.size();
+  blitz::firstIndex i;
+  blitz::secondIndex j;
+  blitz::Range rall = blitz::Range::all();
+
+  // Per-thread buffers
+  const int max_block = std::min(BLOCK_SIZE, end-begin);
+  blitz::Array<double,2> X(max_block, getDimD());
+  blitz::Array<double,2> U(max_block, nf);
+  blitz::Array<double,2> GU(max_block, nf);
+  blitz::Array<double,2> Q(n_a, max_block);
+  // the blocks are views of aliases private to this thread
+  const blitz::Array<double,2> probes_ = tca::alias(probes);
+  blitz::Array<double,2> scores_ = tca::alias(scores);
+
+  for(size_t b=begin; b<end; b+=BLOCK_SIZE) {
+    const int nb = std::min(BLOCK_SIZE, end-b);
+    blitz::Range rb(0, nb-1);
+    blitz::Array<double,2> X_b = X(rb,rall);
+    blitz::Array<double,2> U_b = U(rb,rall);
+    blitz::Array<double,2> GU_b = GU(rb,rall);
+    blitz::Array<double,2> Q_b = Q(rall,rb);
+
+    // u = F^T.beta.(x-mu)
+    blitz::Array<double,2> probes_b = probes_(blitz::Range(b, b+nb-1), rall);
+    X_b = probes_b(i,j) - m_mu(j);
+    bob::math::gemm_(X_b, m_Ft_beta, U_b, false, true);
+
+    // 1/2.u^T.(gamma_a - gamma_1).u for each distinct a
+    for(int k=0; k<n_a; ++k) {
+      bob::math::gemm_(U_b, gamma_diff[k], GU_b, false, false);
+      for(int t=0; t<nb; ++t) 
+        Q_b(k,t) = blitz::sum(GU_b(t,rall) * U_b(t,rall));
+    }
+
+    // Scores: c_m + w_m^T.u + 1/2.u^T.(gamma_a - gamma_1).u
+    blitz::Array<double,2> scores_b = scores_(rall, blitz::Range(b, b+nb-1));
+    bob::math::gemm_(W, U_b, scores_b, false, true);
+    for(int m=0; m<scores_b.extent(0); ++m) {
+      blitz::Array<double,1> scores_bm = scores_b(m,rall);
+      blitz::Array<double,1> Q_bm = Q_b((int)a_index[m],rall);
+      scores_bm += c(m) + Q_bm;
+    }
+  }
+}
+
 
 mach::PLDAMachine::PLDAMachine():
   m_plda_base(boost::shared_ptr<bob::machine::PLDABaseMachine>()),
   m_n_samples(0), m_nh_sum_xit_beta_xi(0), m_weighted_sum(0), 
-  m_loglikelihood(0), m_gamma(), m_loglike_constterm(),
-  m_cache_d_1(0), m_cache_d_2(0), m_cache_nf_1(0), m_cache_nf_2(0)
+  m_loglikelihood(0), m_gamma(), m_loglike_constterm()
 {
 }
 
 mach::PLDAMachine::PLDAMachine(const boost::shared_ptr<bob::machine::PLDABaseMachine> plda_base): 
   m_plda_base(plda_base),
   m_n_samples(0), m_nh_sum_xit_beta_xi(0), m_weighted_sum(plda_base->getDimF()),
-  m_loglikelihood(0), m_gamma(), m_loglike_constterm(),
-  m_cache_d_1(plda_base->getDimD()), m_cache_d_2(plda_base->getDimD()),
-  m_cache_nf_1(plda_base->getDimF()), m_cache_nf_2(plda_base->getDimF())
+  m_loglikelihood(0), m_gamma(), m_loglike_constterm()
 {
 }
 
@@ -409,11 +634,7 @@ mach::PLDAMachine::PLDAMachine(const mach::PLDAMachine& other):
   m_nh_sum_xit_beta_xi(other.m_nh_sum_xit_beta_xi), 
   m_weighted_sum(tca::ccopy(other.m_weighted_sum)),
   m_loglikelihood(other.m_loglikelihood), m_gamma(), 
-  m_loglike_constterm(other.m_loglike_constterm),
-  m_cache_d_1(tca::ccopy(other.m_cache_d_1)),
-  m_cache_d_2(tca::ccopy(other.m_cache_d_2)),
-  m_cache_nf_1(tca::ccopy(other.m_cache_nf_1)),
-  m_cache_nf_2(tca::ccopy(other.m_cache_nf_2))
+  m_loglike_constterm(other.m_loglike_constterm)
 {
   tca::ccopy(other.m_gamma, m_gamma);
 }
@@ -436,10 +657,6 @@ mach::PLDAMachine& mach::PLDAMachine::operator=
   m_loglikelihood = other.m_loglikelihood;
   tca::ccopy(other.m_gamma, m_gamma);
   m_loglike_constterm = other.m_loglike_constterm;
-  m_cache_d_1.reference(tca::ccopy(other.m_cache_d_1));
-  m_cache_d_2.reference(tca::ccopy(other.m_cache_d_2));
-  m_cache_nf_1.reference(tca::ccopy(other.m_cache_nf_1));
-  m_cache_nf_2.reference(tca::ccopy(other.m_cache_nf_2));
   return *this;
 }
 
@@ -495,19 +712,11 @@ void mach::PLDAMachine::resize(const size_t d, const size_t nf,
   m_weighted_sum.resizeAndPreserve(nf);
   m_gamma.clear();
   m_loglike_constterm.clear();
-  m_cache_d_1.resize(d);
-  m_cache_d_2.resize(d);
-  m_cache_nf_1.resize(nf);
-  m_cache_nf_2.resize(nf);
 }
 
 void mach::PLDAMachine::setPLDABase(const boost::shared_ptr<bob::machine::PLDABaseMachine> plda_base) {
   m_plda_base = plda_base; 
   m_weighted_sum.resizeAndPreserve(getDimF());
-  m_cache_d_1.resize(getDimD());
-  m_cache_d_2.resize(getDimD());
-  m_cache_nf_1.resize(getDimF());
-  m_cache_nf_2.resize(getDimF());
 //  resize(getDimD(), getDimF(), getDimG());
 }
 
@@ -528,6 +737,17 @@ blitz::Array<double,2>& mach::PLDAMachine::getGamma(const size_t a)
   return m_gamma[a];
 }
 
+const blitz::Array<double,2>& mach::PLDAMachine::getGamma(const size_t a) const
+{
+  // Checks in both base machine and this machine
+  const mach::PLDABaseMachine& base = *m_plda_base;
+  if(base.hasGamma(a)) return base.getGamma(a);
+  std::map<size_t, blitz::Array<double,2> >::const_iterator it = m_gamma.find(a);
+  // TODO: specialized exception
+  if(it == m_gamma.end()) throw bob::machine::Exception();
+  return it->second;
+}
+
 blitz::Array<double,2>& mach::PLDAMachine::getAddGamma(const size_t a)
 {
   if(m_plda_base->hasGamma(a)) return m_plda_base->getGamma(a);
@@ -539,13 +759,15 @@ blitz::Array<double,2>& mach::PLDAMachine::getAddGamma(const size_t a)
   return m_gamma[a];
 }
 
-double mach::PLDAMachine::getLogLikeConstTerm(const size_t a)
+double mach::PLDAMachine::getLogLikeConstTerm(const size_t a) const
 {
   // Checks in both base machine and this machine
-  if(m_plda_base->hasLogLikeConstTerm(a)) return m_plda_base->getLogLikeConstTerm(a);
+  const mach::PLDABaseMachine& base = *m_plda_base;
+  if(base.hasLogLikeConstTerm(a)) return base.getLogLikeConstTerm(a);
+  std::map<size_t, double>::const_iterator it = m_loglike_constterm.find(a);
   // TODO: specialized exception
-  else if(!hasLogLikeConstTerm(a)) throw bob::machine::Exception();
-  return m_loglike_constterm[a];
+  if(it == m_loglike_constterm.end()) throw bob::machine::Exception();
+  return it->second;
 }
 
 double mach::PLDAMachine::getAddLogLikeConstTerm(const size_t a)
@@ -558,49 +780,35 @@ double mach::PLDAMachine::getAddLogLikeConstTerm(const size_t a)
   return m_loglike_constterm[a];
 }
 
+void mach::PLDAMachine::addLogLikeConstTerm(const size_t a)
+{
+  // Only adds the values if they are not available yet, so that this 
+  // machine is not modified when everything has been precomputed
+  if((m_plda_base->hasGamma(a) || hasGamma(a)) &&
+      (m_plda_base->hasLogLikeConstTerm(a) || hasLogLikeConstTerm(a)))
+    return;
+  getAddGamma(a);
+  getAddLogLikeConstTerm(a);
+}
+
 double mach::PLDAMachine::computeLikelihood(const blitz::Array<double,1>& sample,
   bool enrol)
 {
-   int n_samples = 1 + (enrol?m_n_samples:0);
-  // 1/2/ Constant term of the log likelihood:
-  //      1/ First term of the likelihood: -Nsamples*D/2*log(2*PI)
-  //      2/ Second term of the likelihood: -1/2*log(det(SIGMA+A.A^T))
-  //        Efficient way: -Nsamples/2*log(det(sigma))-Nsamples/2*log(det(I+G^T.sigma^-1.G))
-  //       -1/2*log(det(I+aF^T.(sigma^-1-sigma^-1*G*(I+G^T.sigma^-1.G)*G^T*sigma^-1).F))
-  // TODO: check samples dimensionality
-  double log_likelihood = getAddLogLikeConstTerm(static_cast<size_t>(n_samples));
-
-  // 3/ Third term of the likelihood: -1/2*X^T*(SIGMA+A.A^T)^-1*X
-  //    Efficient way: -1/2*sum_i(xi^T.sigma^-1.xi - xi^T.sigma^-1*G*(I+G^T.sigma^-1.G)^-1*G^T*sigma^-1.xi
-  //      -1/2*sumWeighted^T*(I+aF^T.(sigma^-1-sigma^-1*G*(I+G^T.sigma^-1.G)^-1*G^T*sigma^-1).F)^-1*sumWeighted
-  //      where sumWeighted = sum_i(F^T*(sigma^-1-sigma^-1*G*(I+G^T.sigma^-1.G)^-1*G^T*sigma^-1)*xi)
-  const blitz::Array<double,2>& beta = getPLDABase()->getBeta();
-  const blitz::Array<double,2>& Ft_beta = getPLDABase()->getFtBeta();
-  const blitz::Array<double,1>& mu = getPLDABase()->getMu();
-  double terma = (enrol?m_nh_sum_xit_beta_xi:0.);
-  // sumWeighted
-  if(enrol && m_n_samples > 0) m_cache_nf_1 = m_weighted_sum;
-  else m_cache_nf_1 = 0;
-  
-  // terma += -1 / 2. * (xi^t*beta*xi)
-  m_cache_d_1 = sample - mu;
-  bob::math::prod(beta, m_cache_d_1, m_cache_d_2);
-  terma += -1 / 2. * (blitz::sum(m_cache_d_1*m_cache_d_2));
-    
-  // sumWeighted
-  bob::math::prod(Ft_beta, m_cache_d_1, m_cache_nf_2);
-  m_cache_nf_1 += m_cache_nf_2;
-
-  blitz::Array<double,2> gamma_a = getAddGamma(n_samples);
-  bob::math::prod(gamma_a, m_cache_nf_1, m_cache_nf_2);
-  double termb = 1 / 2. * (blitz::sum(m_cache_nf_1*m_cache_nf_2));
-  
-  log_likelihood += terma + termb;
-  return log_likelihood; 
+  addLogLikeConstTerm(1 + (enrol?m_n_samples:0));
+  blitz::Array<double,2> samples(1, sample.extent(0));
+  samples(0,blitz::Range::all()) = sample;
+  return computeLikelihood_(samples, enrol);
 }
 
 double mach::PLDAMachine::computeLikelihood(const blitz::Array<double,2>& samples,
   bool enrol)
+{
+  addLogLikeConstTerm(samples.extent(0) + (enrol?m_n_samples:0));
+  return computeLikelihood_(samples, enrol);
+}
+
+double mach::PLDAMachine::computeLikelihood_(const blitz::Array<double,2>& samples,
+  bool enrol) const
 {
   int n_samples = samples.extent(0) + (enrol?m_n_samples:0);
   // 1/2/ Constant term of the log likelihood:
@@ -609,7 +817,7 @@ double mach::PLDAMachine::computeLikelihood(const blitz::Array<double,2>& sample
   //        Efficient way: -Nsamples/2*log(det(sigma))-Nsamples/2*log(det(I+G^T.sigma^-1.G))
   //       -1/2*log(det(I+aF^T.(sigma^-1-sigma^-1*G*(I+G^T.sigma^-1.G)*G^T*sigma^-1).F))
   // TODO: check samples dimensionality
-  double log_likelihood = getAddLogLikeConstTerm(static_cast<size_t>(n_samples));
+  double log_likelihood = getLogLikeConstTerm(static_cast<size_t>(n_samples));
 
   // 3/ Third term of the likelihood: -1/2*X^T*(SIGMA+A.A^T)^-1*X
   //    Efficient way: -1/2*sum_i(xi^T.sigma^-1.xi - xi^T.sigma^-1*G*(I+G^T.sigma^-1.G)^-1*G^T*sigma^-1.xi
@@ -619,25 +827,30 @@ double mach::PLDAMachine::computeLikelihood(const blitz::Array<double,2>& sample
   const blitz::Array<double,2>& Ft_beta = getPLDABase()->getFtBeta();
   const blitz::Array<double,1>& mu = getPLDABase()->getMu();
   double terma = (enrol?m_nh_sum_xit_beta_xi:0.);
+  // Local buffers, as this function might be called concurrently
+  blitz::Array<double,1> tmp_d_1(getDimD());
+  blitz::Array<double,1> tmp_d_2(getDimD());
+  blitz::Array<double,1> tmp_nf_1(getDimF());
+  blitz::Array<double,1> tmp_nf_2(getDimF());
   // sumWeighted
-  if(enrol && m_n_samples > 0) m_cache_nf_1 = m_weighted_sum;
-  else m_cache_nf_1 = 0;
+  if(enrol && m_n_samples > 0) tmp_nf_1 = m_weighted_sum;
+  else tmp_nf_1 = 0;
   for(int k=0; k<samples.extent(0); ++k) 
   {
     blitz::Array<double,1> samp = samples(k,blitz::Range::all());
-    m_cache_d_1 = samp - mu;
+    tmp_d_1 = samp - mu;
     // terma += -1 / 2. * (xi^t*beta*xi)
-    bob::math::prod(beta, m_cache_d_1, m_cache_d_2);
-    terma += -1 / 2. * (blitz::sum(m_cache_d_1*m_cache_d_2));
+    bob::math::prod(beta, tmp_d_1, tmp_d_2);
+    terma += -1 / 2. * (blitz::sum(tmp_d_1*tmp_d_2));
     
     // sumWeighted
-    bob::math::prod(Ft_beta, m_cache_d_1, m_cache_nf_2);
-    m_cache_nf_1 += m_cache_nf_2;
+    bob::math::prod(Ft_beta, tmp_d_1, tmp_nf_2);
+    tmp_nf_1 += tmp_nf_2;
   }
 
-  blitz::Array<double,2> gamma_a = getAddGamma(n_samples);
-  bob::math::prod(gamma_a, m_cache_nf_1, m_cache_nf_2);
-  double termb = 1 / 2. * (blitz::sum(m_cache_nf_1*m_cache_nf_2));
+  const blitz::Array<double,2>& gamma_a = getGamma(n_samples);
+  bob::math::prod(gamma_a, tmp_nf_1, tmp_nf_2);
+  double termb = 1 / 2. * (blitz::sum(tmp_nf_1*tmp_nf_2));
   
   log_likelihood += terma + termb;
   return log_likelihood;
@@ -27,8 +27,13 @@
 #include <boost/filesystem.hpp>
 #include "bob/machine/SVM.h"
 #include "bob/machine/MLPException.h"
+#include "bob/core/array_alias.h"
 #include "bob/core/array_check.h"
+#include "bob/core/array_assert.h"
+#include "bob/core/array_copy.h"
 #include "bob/core/logging.h"
+#include "bob/core/parallel.h"
+#include "bob/math/gemm.h"
 #include <cstdio>
 #include <cstdlib>
 #include <fstream>
@@ -450,3 +455,400 @@ void mach::SupportVector::save(bob::io::HDF5File& config) const {
   uint64_t version = LIBSVM_VERSION;
   config.setAttribute(".", "version", version);
 }
+
+/**
+ * Integer power, the same way libsvm computes it for polynomial kernels.
+ */
+static inline double powi(double base, int times) {
+  double tmp = base, retval = 1.0;
+  for (int t=times; t>0; t/=2) {
+    if (t%2 == 1) retval *= tmp;
+    tmp = tmp * tmp;
+  }
+  return retval;
+}
+
+/**
+ * Pairwise coupling of probabilities, as in libsvm (method 2 of Wu, Lin and
+ * Weng, "Probability Estimates for Multi-class Classification by Pairwise
+ * Coupling", JMLR 5:975-1005, 2004). Q and Qp are working buffers.
+ */
+static void multiclass_probability(const blitz::Array<double,2>& r,
+    blitz::Array<double,1>& p, blitz::Array<double,2>& Q,
+    blitz::Array<double,1>& Qp) {
+
+  const int k = p.extent(0);
+  const int max_iter = std::max(100, k);
+  const double eps = 0.005/k;
+
+  for (int t=0; t<k; ++t) {
+    p(t) = 1.0/k;
+    Q(t,t) = 0;
+    for (int j=0; j<t; ++j) {
+      Q(t,t) += r(j,t)*r(j,t);
+      Q(t,j) = Q(j,t);
+    }
+    for (int j=t+1; j<k; ++j) {
+      Q(t,t) += r(j,t)*r(j,t);
+      Q(t,j) = -r(j,t)*r(t,j);
+    }
+  }
+
+  for (int iter=0; iter<max_iter; ++iter) {
+    // stopping condition, recalculate QP,pQP for numerical accuracy
+    double pQp = 0;
+    for (int t=0; t<k; ++t) {
+      Qp(t) = 0;
+      for (int j=0; j<k; ++j) Qp(t) += Q(t,j)*p(j);
+      pQp += p(t)*Qp(t);
+    }
+    double max_error = 0;
+    for (int t=0; t<k; ++t) {
+      double error = std::fabs(Qp(t)-pQp);
+      if (error > max_error) max_error = error;
+    }
+    if (max_error < eps) break;
+
+    for (int t=0; t<k; ++t) {
+      double diff = (-Qp(t)+pQp)/Q(t,t);
+      p(t) += diff;
+      pQp = (pQp+diff*(diff*Q(t,t)+2*Qp(t)))/(1+diff)/(1+diff);
+      for (int j=0; j<k; ++j) {
+        Qp(j) = (Qp(j)+diff*Q(t,j))/(1+diff);
+        p(j) /= (1+diff);
+      }
+    }
+  }
+}
+
+/**
+ * Sigmoid mapping of decision values into probabilities, as in libsvm.
+ */
+static inline double sigmoid_predict(double value, double A, double B) {
+  double fApB = value*A+B;
+  // 1-p used later; avoid catastrophic cancellation
+  if (fApB >= 0) return std::exp(-fApB)/(1.0+std::exp(-fApB));
+  else return 1.0/(1+std::exp(fApB));
+}
+
+static inline bool is_classifier(mach::SupportVector::svm_t type) {
+  return type == mach::SupportVector::C_SVC || 
+    type == mach::SupportVector::NU_SVC;
+}
+
+mach::BatchSupportVector::BatchSupportVector
+(const mach::SupportVector& machine):
+  m_type(machine.machineType()),
+  m_kernel(machine.kernelType()),
+  m_degree(machine.polynomialDegree()),
+  m_gamma(machine.gamma()),
+  m_coef0(machine.coefficient0()),
+  m_input_size(machine.inputSize()),
+  m_block_size(256),
+  m_probability(false),
+  m_input_sub(array::ccopy(machine.getInputSubtraction())),
+  m_input_div(array::ccopy(machine.getInputDivision()))
+{
+  if (m_kernel == mach::SupportVector::PRECOMPUTED) {
+    throw std::runtime_error("batch prediction is not supported for SVMs with precomputed kernels");
+  }
+
+  boost::shared_ptr<const svm_model> model = machine.getModel();
+  const int n_sv = model->l;
+
+  // Unpacks the (sparse) support vectors into a dense matrix
+  m_sv.resize(n_sv, m_input_size);
+  m_sv = 0.;
+  for (int k=0; k<n_sv; ++k) {
+    for (const svm_node* node = model->SV[k]; node->index != -1; ++node) {
+      if (node->index < 1) continue;
+      m_sv(k, node->index-1) = node->value;
+    }
+  }
+
+  // Re-arranges the coefficients so that every decision function is a
+  // linear combination of the kernel values of all support vectors
+  if (is_classifier(m_type)) {
+    const int n_classes = model->nr_class;
+    const int n_scores = n_classes*(n_classes-1)/2;
+    m_labels.resize(n_classes);
+    for (int i=0; i<n_classes; ++i) m_labels(i) = model->label[i];
+
+    std::vector<int> start(n_classes, 0);
+    for (int i=1; i<n_classes; ++i) start[i] = start[i-1] + model->nSV[i-1];
+
+    m_coef.resize(n_sv, n_scores);
+    m_coef = 0.;
+    m_rho.resize(n_scores);
+    int p = 0;
+    for (int i=0; i<n_classes; ++i) {
+      for (int j=i+1; j<n_classes; ++j) {
+        for (int k=0; k<model->nSV[i]; ++k)
+          m_coef(start[i]+k, p) = model->sv_coef[j-1][start[i]+k];
+        for (int k=0; k<model->nSV[j]; ++k)
+          m_coef(start[j]+k, p) = model->sv_coef[i][start[j]+k];
+        m_rho(p) = model->rho[p];
+        ++p;
+      }
+    }
+
+    if (model->probA && model->probB) {
+      m_probability = true;
+      m_prob_a.resize(n_scores);
+      m_prob_b.resize(n_scores);
+      for (int k=0; k<n_scores; ++k) {
+        m_prob_a(k) = model->probA[k];
+        m_prob_b(k) = model->probB[k];
+      }
+    }
+  }
+  else { //ONE_CLASS, EPSILON_SVR or NU_SVR: a single decision function
+    m_coef.resize(n_sv, 1);
+    for (int k=0; k<n_sv; ++k) m_coef(k,0) = model->sv_coef[0][k];
+    m_rho.resize(1);
+    m_rho(0) = model->rho[0];
+  }
+
+  if (m_kernel == mach::SupportVector::LINEAR) {
+    // Collapses all support vectors into one weight vector per decision
+    // function and folds the input scaling in: w^T (x-s)/d = (w/d)^T x -
+    // (w/d)^T s
+    m_weights.resize(m_input_size, m_rho.extent(0));
+    bob::math::gemm(m_sv, m_coef, m_weights, true, false);
+    blitz::firstIndex i;
+    blitz::secondIndex j;
+    m_weights = m_weights(i,j) / m_input_div(i);
+    for (int p=0; p<m_rho.extent(0); ++p) {
+      m_rho(p) += blitz::sum(m_weights(blitz::Range::all(), p) * m_input_sub);
+    }
+    // The support vectors are no longer needed
+    m_sv.resize(0, 0);
+    m_coef.resize(0, 0);
+  }
+  else if (m_kernel == mach::SupportVector::RBF) {
+    m_sv_norm2.resize(n_sv);
+    blitz::firstIndex i;
+    blitz::secondIndex j;
+    m_sv_norm2 = blitz::sum(blitz::pow2(m_sv(i,j)), j);
+  }
+}
+
+mach::BatchSupportVector::~BatchSupportVector() { }
+
+int mach::BatchSupportVector::classLabel(size_t i) const {
+  if (i >= numberOfClasses()) {
+    boost::format s("request for label of class %d in SVM with %d classes is not legal");
+    s % (int)i % (int)numberOfClasses();
+    throw std::invalid_argument(s.str());
+  }
+  return m_labels(i);
+}
+
+void mach::BatchSupportVector::setBlockSize(size_t block_size) {
+  if (block_size == 0) {
+    throw std::invalid_argument("the block size for batch SVM prediction should be greater than zero");
+  }
+  m_block_size = block_size;
+}
+
+void mach::BatchSupportVector::checkInput
+(const blitz::Array<double,2>& input, const blitz::Array<int,1>& labels) const {
+
+  array::assertZeroBase(input);
+  array::assertZeroBase(labels);
+
+  if ((size_t)input.extent(1) != inputSize()) {
+    boost::format s("input for this SVM should have %d components, but you provided an array with %d columns instead");
+    s % inputSize() % input.extent(1);
+    throw std::invalid_argument(s.str());
+  }
+
+  if (labels.extent(0) != input.extent(0)) {
+    boost::format s("output labels array should have %d entries (one per input sample), but you provided an array with %d elements instead");
+    s % input.extent(0) % labels.extent(0);
+    throw std::invalid_argument(s.str());
+  }
+}
+
+void mach::BatchSupportVector::decisionValues
+(const blitz::Array<double,2>& input, blitz::Array<double,2>& normalized,
+ blitz::Array<double,2>& kernel, blitz::Array<double,2>& values) const {
+
+  blitz::firstIndex i;
+  blitz::secondIndex j;
+
+  if (m_kernel == mach::SupportVector::LINEAR) {
+    // scaling is folded in the weights and offsets
+    bob::math::gemm_(input, m_weights, values);
+    values = values(i,j) - m_rho(j);
+    return;
+  }
+
+  normalized = (input(i,j) - m_input_sub(j)) / m_input_div(j);
+  bob::math::gemm_(normalized, m_sv, kernel, false, true);
+
+  const int n_samples = kernel.extent(0);
+  const int n_sv = kernel.extent(1);
+  switch (m_kernel) {
+    case mach::SupportVector::POLY:
+      for (int s=0; s<n_samples; ++s)
+        for (int k=0; k<n_sv; ++k)
+          kernel(s,k) = powi(m_gamma*kernel(s,k) + m_coef0, m_degree);
+      break;
+    case mach::SupportVector::RBF:
+      for (int s=0; s<n_samples; ++s) {
+        double norm2 = blitz::sum(blitz::pow2(normalized(s, blitz::Range::all())));
+        for (int k=0; k<n_sv; ++k) {
+          double d2 = norm2 + m_sv_norm2(k) - 2*kernel(s,k);
+          kernel(s,k) = std::exp(-m_gamma * ((d2 > 0.) ? d2 : 0.));
+        }
+      }
+      break;
+    case mach::SupportVector::SIGMOID:
+      for (int s=0; s<n_samples; ++s)
+        for (int k=0; k<n_sv; ++k)
+          kernel(s,k) = std::tanh(m_gamma*kernel(s,k) + m_coef0);
+      break;
+    default:
+      break;
+  }
+
+  bob::math::gemm_(kernel, m_coef, values);
+  values = values(i,j) - m_rho(j);
+}
+
+void mach::BatchSupportVector::predictRange
+(const blitz::Array<double,2>& input, blitz::Array<int,1>& labels,
+ blitz::Array<double,2>* scores, blitz::Array<double,2>* probabilities,
+ size_t begin, size_t end) const {
+
+  const int n_scores = numberOfScores();
+  const int n_classes = numberOfClasses();
+  const int block = std::min(m_block_size, end-begin);
+  const blitz::Range all = blitz::Range::all();
+
+  // the blocks and rows are views of aliases private to this thread
+  const blitz::Array<double,2> input_ = array::alias(input);
+  blitz::Array<double,2> scores_, probabilities_;
+  if (scores) scores_.reference(array::alias(*scores));
+  if (probabilities) probabilities_.reference(array::alias(*probabilities));
+
+  // per-thread working buffers
+  blitz::Array<double,2> normalized, kernel;
+  if (m_kernel != mach::SupportVector::LINEAR) {
+    normalized.resize(block, m_input_size);
+    kernel.resize(block, m_sv.extent(0));
+  }
+  blitz::Array<double,2> values(block, n_scores);
+  std::vector<int> votes(n_classes);
+  blitz::Array<double,2> pairwise, Q;
+  blitz::Array<double,1> Qp, probs;
+  if (probabilities) {
+    pairwise.resize(n_classes, n_classes);
+    Q.resize(n_classes, n_classes);
+    Qp.resize(n_classes);
+  }
+
+  for (int b=begin; b<(int)end; b+=block) {
+    const int n = std::min(block, (int)end-b);
+    const blitz::Range rows(0, n-1);
+    blitz::Array<double,2> values_b = values(rows, all);
+    blitz::Array<double,2> normalized_b, kernel_b;
+    if (m_kernel != mach::SupportVector::LINEAR) {
+      normalized_b.reference(normalized(rows, all));
+      kernel_b.reference(kernel(rows, all));
+    }
+    decisionValues(input_(blitz::Range(b, b+n-1), all), normalized_b, kernel_b,
+        values_b);
+
+    if (scores) scores_(blitz::Range(b, b+n-1), all) = values_b;
+
+    for (int s=0; s<n; ++s) {
+      const int row = b+s;
+
+      if (probabilities) { //pairwise coupling, as in svm_predict_probability
+        const double min_prob = 1e-7;
+        int p = 0;
+        for (int i=0; i<n_classes; ++i) {
+          for (int j=i+1; j<n_classes; ++j) {
+            pairwise(i,j) = std::min(std::max(sigmoid_predict(values_b(s,p),
+                    m_prob_a(p), m_prob_b(p)), min_prob), 1-min_prob);
+            pairwise(j,i) = 1-pairwise(i,j);
+            ++p;
+          }
+        }
+        probs.reference(probabilities_(row, all));
+        if (n_classes == 2) {
+          probs(0) = pairwise(0,1);
+          probs(1) = pairwise(1,0);
+        }
+        else multiclass_probability(pairwise, probs, Q, Qp);
+
+        int max_idx = 0;
+        for (int i=1; i<n_classes; ++i) if (probs(i) > probs(max_idx)) max_idx = i;
+        labels(row) = m_labels(max_idx);
+      }
+
+      else if (is_classifier(m_type)) { //one-against-one voting
+        std::fill(votes.begin(), votes.end(), 0);
+        int p = 0;
+        for (int i=0; i<n_classes; ++i) {
+          for (int j=i+1; j<n_classes; ++j) {
+            if (values_b(s,p) > 0) ++votes[i];
+            else ++votes[j];
+            ++p;
+          }
+        }
+        int max_idx = 0;
+        for (int i=1; i<n_classes; ++i) if (votes[i] > votes[max_idx]) max_idx = i;
+        labels(row) = m_labels(max_idx);
+      }
+
+      else if (m_type == mach::SupportVector::ONE_CLASS) {
+        labels(row) = (values_b(s,0) > 0) ? 1 : -1;
+      }
+
+      else { //regression
+        labels(row) = round(values_b(s,0));
+      }
+    }
+  }
+}
+
+void mach::BatchSupportVector::predictClasses
+(const blitz::Array<double,2>& input, blitz::Array<int,1>& labels,
+ size_t n_threads) const {
+  checkInput(input, labels);
+  bob::core::thread_loop(boost::bind(&mach::BatchSupportVector::predictRange,
+        this, boost::cref(input), boost::ref(labels),
+        (blitz::Array<double,2>*)0, (blitz::Array<double,2>*)0, _1, _2),
+      input.extent(0), n_threads);
+}
+
+void mach::BatchSupportVector::predictClassesAndScores
+(const blitz::Array<double,2>& input, blitz::Array<int,1>& labels,
+ blitz::Array<double,2>& scores, size_t n_threads) const {
+  checkInput(input, labels);
+  array::assertZeroBase(scores);
+  const blitz::TinyVector<int,2> shape(input.extent(0), numberOfScores());
+  array::assertSameShape(scores, shape);
+  bob::core::thread_loop(boost::bind(&mach::BatchSupportVector::predictRange,
+        this, boost::cref(input), boost::ref(labels), &scores,
+        (blitz::Array<double,2>*)0, _1, _2), input.extent(0), n_threads);
+}
+
+void mach::BatchSupportVector::predictClassesAndProbabilities
+(const blitz::Array<double,2>& input, blitz::Array<int,1>& labels,
+ blitz::Array<double,2>& probabilities, size_t n_threads) const {
+  if (!supportsProbability()) {
+    throw std::runtime_error("this SVM does not support probabilities");
+  }
+  checkInput(input, labels);
+  array::assertZeroBase(probabilities);
+  const blitz::TinyVector<int,2> shape(input.extent(0), numberOfClasses());
+  array::assertSameShape(probabilities, shape);
+  bob::core::thread_loop(boost::bind(&mach::BatchSupportVector::predictRange,
+        this, boost::cref(input), boost::ref(labels),
+        (blitz::Array<double,2>*)0, &probabilities, _1, _2),
+      input.extent(0), n_threads);
+}
@@ -20,18 +20,194 @@
 
 #include "bob/machine/ZTNorm.h"
 #include "bob/core/array_assert.h"
+#include "bob/core/parallel.h"
+#include <boost/bind.hpp>
+#include <algorithm>
 #include <limits>
+#include <cmath>
+
+namespace ca = bob::core::array;
 
 namespace bob { 
 namespace machine {
 
 namespace detail {
+
+  // Constant to check if the std is close to 0. 
+  static const double eps = std::numeric_limits<double>::min();
+
+  // Number of columns processed at once when normalizing the scores, such 
+  // that the corresponding ZT-Norm statistics stay in the L1 cache
+  static const int TILE_COLS = 1024;
+
+  // Number of rows kept in memory when streaming scores to a file
+  static const int STREAM_ROWS = 256;
+
+  /**
+   * Mean and (unbiased) standard deviation of the rows [begin,end) of X
+   */
+  static void rowStatistics(const blitz::Array<double, 2>& X,
+                            blitz::Array<double, 1>& mean,
+                            blitz::Array<double, 1>& stddev,
+                            size_t begin, size_t end)
+  {
+    const int n = X.extent(1);
+    for(int i = (int)begin; i < (int)end; ++i) {
+      double sum = 0;
+      for(int j = 0; j < n; ++j) sum += X(i, j);
+      const double m = sum / n;
+      double s = 0;
+      if(n > 1) {
+        double sumsq = 0;
+        for(int j = 0; j < n; ++j) sumsq += (X(i, j) - m) * (X(i, j) - m);
+        s = sqrt(sumsq / (n - 1));
+      }
+      // 1 single value -> std = 0
+      mean(i) = m;
+      stddev(i) = (s <= eps) ? 1. : s;
+    }
+  }
+
+  /**
+   * Mean and standard deviation of the rows [begin,end) of D, only 
+   * considering the impostor scores
+   */
+  static void cohortStatistics(const blitz::Array<double, 2>& D,
+                               const blitz::Array<bool, 2>* mask,
+                               blitz::Array<double, 1>& mean,
+                               blitz::Array<double, 1>& stddev,
+                               size_t begin, size_t end)
+  {
+    const int size_znorm = D.extent(1);
+    for(int i = (int)begin; i < (int)end; ++i) {
+      double sum = 0;
+      double sumsq = 0;
+      double count = 0;
+      for(int j = 0; j < size_znorm; ++j) {
+        // The second part is never executed if mask==NULL
+        bool keep = (mask == NULL) || !(*mask)(i, j);
+        double value = keep * D(i, j);
+        sum += value;
+        sumsq += value*value;
+        count += keep;
+      }
+
+      double m = sum / count;
+      double s = 0;
+      if(count > 1)
+        s = sqrt((sumsq - count * m * m) / (count -1));
+      // 1 single value -> std = 0
+      mean(i) = m;
+      stddev(i) = (s <= eps) ? 1. : s;
+    }
+  }
+
+  /**
+   * Mean and standard deviation of the columns [begin,end) of C, once 
+   * Z-normalized with the statistics of the T-Norm cohort. C is processed 
+   * row by row to keep memory accesses contiguous.
+   */
+  static void columnStatistics(const blitz::Array<double, 2>& C,
+                               const blitz::Array<double, 1>& cohort_mean,
+                               const blitz::Array<double, 1>& cohort_std,
+                               blitz::Array<double, 1>& mean,
+                               blitz::Array<double, 1>& stddev,
+                               size_t begin, size_t end)
+  {
+    const int size_tnorm = C.extent(0);
+    const int jb = begin;
+    const int je = end;
+    for(int j = jb; j < je; ++j) mean(j) = 0;
+    for(int i = 0; i < size_tnorm; ++i) {
+      const double m = cohort_mean(i);
+      const double s = cohort_std(i);
+      for(int j = jb; j < je; ++j) mean(j) += (C(i, j) - m) / s;
+    }
+    for(int j = jb; j < je; ++j) mean(j) /= size_tnorm;
+
+    if(size_tnorm > 1) {
+      for(int j = jb; j < je; ++j) stddev(j) = 0;
+      for(int i = 0; i < size_tnorm; ++i) {
+        const double m = cohort_mean(i);
+        const double s = cohort_std(i);
+        for(int j = jb; j < je; ++j) {
+          const double v = (C(i, j) - m) / s - mean(j);
+          stddev(j) += v * v;
+        }
+      }
+      for(int j = jb; j < je; ++j) stddev(j) = sqrt(stddev(j) / (size_tnorm - 1));
+    }
+    else // 1 single value -> std = 0
+      for(int j = jb; j < je; ++j) stddev(j) = 0;
+    for(int j = jb; j < je; ++j) if(stddev(j) <= eps) stddev(j) = 1.;
+  }
+
+  /**
+   * Normalizes the rows [begin,end) of A into scores, tile by tile
+   */
+  static void applyNorm(const blitz::Array<double, 2>& A,
+                        const blitz::Array<double, 1>& z_mean,
+                        const blitz::Array<double, 1>& z_std,
+                        const blitz::Array<double, 1>& zt_mean,
+                        const blitz::Array<double, 1>& zt_std,
+                        blitz::Array<double, 2>& scores,
+                        size_t begin, size_t end)
+  {
+    const int n_cols = A.extent(1);
+    for(int j0 = 0; j0 < n_cols; j0 += TILE_COLS) {
+      const int j1 = std::min(j0 + TILE_COLS, n_cols);
+      for(int i = (int)begin; i < (int)end; ++i) {
+        const double m = z_mean(i);
+        const double s = z_std(i);
+        for(int j = j0; j < j1; ++j)
+          scores(i, j) = ((A(i, j) - m) / s - zt_mean(j)) / zt_std(j);
+      }
+    }
+  }
+
+  static void checkApply(const blitz::Array<double, 2>& A,
+                         const blitz::Array<double, 1>& z_mean,
+                         const blitz::Array<double, 1>& z_std,
+                         const blitz::Array<double, 1>& zt_mean,
+                         const blitz::Array<double, 1>& zt_std)
+  {
+    ca::assertZeroBase(A);
+    ca::assertZeroBase(z_mean);
+    ca::assertZeroBase(z_std);
+    ca::assertZeroBase(zt_mean);
+    ca::assertZeroBase(zt_std);
+    ca::assertSameDimensionLength(z_mean.extent(0), A.extent(0));
+    ca::assertSameDimensionLength(z_std.extent(0), A.extent(0));
+    ca::assertSameDimensionLength(zt_mean.extent(0), A.extent(1));
+    ca::assertSameDimensionLength(zt_std.extent(0), A.extent(1));
+  }
+
+  static void tNormCohortStatistics(const blitz::Array<double, 2>& D,
+                                    const blitz::Array<bool, 2>* mask,
+                                    blitz::Array<double, 1>& mean,
+                                    blitz::Array<double, 1>& stddev,
+                                    const size_t n_threads)
+  {
+    ca::assertZeroBase(D);
+    ca::assertZeroBase(mean);
+    ca::assertZeroBase(stddev);
+    if (mask) {
+      ca::assertZeroBase(*mask);
+      ca::assertSameShape(*mask, D);
+    }
+    ca::assertSameDimensionLength(mean.extent(0), D.extent(0));
+    ca::assertSameDimensionLength(stddev.extent(0), D.extent(0));
+    bob::core::thread_loop(boost::bind(&cohortStatistics, boost::cref(D), mask,
+          boost::ref(mean), boost::ref(stddev), _1, _2), D.extent(0), n_threads);
+  }
+
   void ztNorm(const blitz::Array<double, 2>& rawscores_probes_vs_models,
               const blitz::Array<double, 2>& rawscores_zprobes_vs_models,
               const blitz::Array<double, 2>& rawscores_probes_vs_tmodels,
               const blitz::Array<double, 2>& rawscores_zprobes_vs_tmodels,
               const blitz::Array<bool, 2>*  mask_zprobes_vs_tmodels_istruetrial,
-              blitz::Array<double, 2>& scores)
+              blitz::Array<double, 2>& scores,
+              const size_t n_threads)
   {
     // Rename variables
     const blitz::Array<double, 2>& A = rawscores_probes_vs_models;
@@ -66,75 +242,24 @@ namespace detail {
     bob::core::array::assertSameDimensionLength(scores.extent(0), size_eval);
     bob::core::array::assertSameDimensionLength(scores.extent(1), size_enrol);
 
-    // Declare needed IndexPlaceholder
-    blitz::firstIndex i;
-    blitz::secondIndex j;
-
-    // Constant to check if the std is close to 0. 
-    const double eps = std::numeric_limits<double>::min();
-    
-    // Znorm  -->      zA  = (A - mean(B) ) / std(B)    [znorm on oringinal scores]
-    // mean(B)
-    blitz::Array<double, 1> mean_B(blitz::mean(B, j));
-    // std(B)
-    blitz::Array<double, 2> B2n(B.shape());
-    B2n = blitz::pow2(B(i, j) - mean_B(i));
-    blitz::Array<double, 1> std_B(B.extent(0));
-    if(size_znorm>1)
-      std_B = blitz::sqrt(blitz::sum(B2n, j) / (size_znorm - 1));
-    else // 1 single value -> std = 0
-      std_B = 0; 
-    std_B = blitz::where( std_B <= eps, 1., std_B);
-
-    // zA
-    blitz::Array<double, 2> zA(A.shape());
-    zA = (A(i, j) - mean_B(i)) / std_B(i);
+    // Znorm statistics: mean(B) and std(B)
+    blitz::Array<double, 1> mean_B(size_eval);
+    blitz::Array<double, 1> std_B(size_eval);
+    zNormStatistics(B, mean_B, std_B, n_threads);
 
+    // mean_Dimp and std_Dimp = D only with impostors
     blitz::Array<double, 1> mean_Dimp(size_tnorm);
     blitz::Array<double, 1> std_Dimp(size_tnorm);
-
-    // Compute mean_Dimp and std_Dimp = D only with impostors
-    for(int i = 0; i < size_tnorm; ++i) {
-      double sum = 0;
-      double sumsq = 0;
-      double count = 0;
-      for(int j = 0; j < size_znorm; ++j) {
-        bool keep;
-        // The second part is never executed if mask_zprobes_vs_tmodels_istruetrial==NULL
-        keep = (mask_zprobes_vs_tmodels_istruetrial == NULL) || !(*mask_zprobes_vs_tmodels_istruetrial)(i, j); //tnorm_models_spk_ids(i) != znorm_tests_spk_ids(j);
-        
-        double value = keep * D(i, j);
-        sum += value;
-        sumsq += value*value;
-        count += keep;
-      }
-
-      double mean = sum / count;
-      mean_Dimp(i) = mean;
-      if(count > 1)
-        std_Dimp(i) = sqrt((sumsq - count * mean * mean) / (count -1));
-      else // 1 single value -> std = 0
-        std_Dimp(i) = 0;
-    }
-    std_Dimp = blitz::where( std_Dimp <= eps, 1., std_Dimp);
+    tNormCohortStatistics(D, mask_zprobes_vs_tmodels_istruetrial, mean_Dimp,
+        std_Dimp, n_threads);
 
     // zC  = (C - mean(D)) / std(D)     [znorm the tnorm scores]
-    blitz::Array<double, 2> zC(size_tnorm, size_enrol);
-    zC = (C(i, j) - mean_Dimp(i)) / std_Dimp(i);
-
     blitz::Array<double, 1> mean_zC(size_enrol);
     blitz::Array<double, 1> std_zC(size_enrol);
-    
-    // ztA = (zA - mean(zC)) / std(zC)  [ztnorm on eval scores]
-    mean_zC = blitz::mean(zC(j, i), j);
-    if(size_tnorm > 1)
-      std_zC = sqrt(blitz::sum(pow(zC(j, i) - mean_zC(i), 2) , j) / (size_tnorm - 1));
-    else // 1 single value -> std = 0
-      std_zC = 0;
-    std_zC = blitz::where( std_zC <= eps, 1., std_zC);
+    ztNormStatistics(C, mean_Dimp, std_Dimp, mean_zC, std_zC, n_threads);
 
-    // Normalised scores
-    scores = (zA(i, j) - mean_zC(j)) /  std_zC(j);
+    // ztA = (zA - mean(zC)) / std(zC)  [ztnorm on eval scores]
+    ztNormApply(A, mean_B, std_B, mean_zC, std_zC, scores, n_threads);
   }
 }
 
@@ -144,20 +269,129 @@ void ztNorm(const blitz::Array<double, 2>& rawscores_probes_vs_models,
             const blitz::Array<double, 2>& rawscores_probes_vs_tmodels,
             const blitz::Array<double, 2>& rawscores_zprobes_vs_tmodels,
             const blitz::Array<bool,   2>& mask_zprobes_vs_tmodels_istruetrial,
-            blitz::Array<double, 2>& scores)
+            blitz::Array<double, 2>& scores,
+            const size_t n_threads)
 {
   detail::ztNorm(rawscores_probes_vs_models, rawscores_zprobes_vs_models, rawscores_probes_vs_tmodels,
-                 rawscores_zprobes_vs_tmodels, &mask_zprobes_vs_tmodels_istruetrial, scores);
+                 rawscores_zprobes_vs_tmodels, &mask_zprobes_vs_tmodels_istruetrial, scores, n_threads);
 }
 
 void ztNorm(const blitz::Array<double, 2>& rawscores_probes_vs_models,
             const blitz::Array<double, 2>& rawscores_zprobes_vs_models,
             const blitz::Array<double, 2>& rawscores_probes_vs_tmodels,
             const blitz::Array<double, 2>& rawscores_zprobes_vs_tmodels,
-            blitz::Array<double, 2>& scores)
+            blitz::Array<double, 2>& scores,
+            const size_t n_threads)
 {
   detail::ztNorm(rawscores_probes_vs_models, rawscores_zprobes_vs_models, rawscores_probes_vs_tmodels,
-                 rawscores_zprobes_vs_tmodels, NULL, scores);
+                 rawscores_zprobes_vs_tmodels, NULL, scores, n_threads);
+}
+
+void zNormStatistics(const blitz::Array<double, 2>& rawscores_zprobes_vs_models,
+                     blitz::Array<double, 1>& mean,
+                     blitz::Array<double, 1>& stddev,
+                     const size_t n_threads)
+{
+  const blitz::Array<double, 2>& B = rawscores_zprobes_vs_models;
+  ca::assertZeroBase(B);
+  ca::assertZeroBase(mean);
+  ca::assertZeroBase(stddev);
+  ca::assertSameDimensionLength(mean.extent(0), B.extent(0));
+  ca::assertSameDimensionLength(stddev.extent(0), B.extent(0));
+  bob::core::thread_loop(boost::bind(&detail::rowStatistics, boost::cref(B),
+        boost::ref(mean), boost::ref(stddev), _1, _2), B.extent(0), n_threads);
+}
+
+void tNormCohortStatistics(const blitz::Array<double, 2>& rawscores_zprobes_vs_tmodels,
+                           const blitz::Array<bool,   2>& mask_zprobes_vs_tmodels_istruetrial,
+                           blitz::Array<double, 1>& mean,
+                           blitz::Array<double, 1>& stddev,
+                           const size_t n_threads)
+{
+  detail::tNormCohortStatistics(rawscores_zprobes_vs_tmodels,
+      &mask_zprobes_vs_tmodels_istruetrial, mean, stddev, n_threads);
+}
+
+void tNormCohortStatistics(const blitz::Array<double, 2>& rawscores_zprobes_vs_tmodels,
+                           blitz::Array<double, 1>& mean,
+                           blitz::Array<double, 1>& stddev,
+                           const size_t n_threads)
+{
+  detail::tNormCohortStatistics(rawscores_zprobes_vs_tmodels, NULL, mean, stddev,
+      n_threads);
+}
+
+void ztNormStatistics(const blitz::Array<double, 2>& rawscores_probes_vs_tmodels,
+                      const blitz::Array<double, 1>& cohort_mean,
+                      const blitz::Array<double, 1>& cohort_std,
+                      blitz::Array<double, 1>& mean,
+                      blitz::Array<double, 1>& stddev,
+                      const size_t n_threads)
+{
+  const blitz::Array<double, 2>& C = rawscores_probes_vs_tmodels;
+  ca::assertZeroBase(C);
+  ca::assertZeroBase(cohort_mean);
+  ca::assertZeroBase(cohort_std);
+  ca::assertZeroBase(mean);
+  ca::assertZeroBase(stddev);
+  ca::assertSameDimensionLength(cohort_mean.extent(0), C.extent(0));
+  ca::assertSameDimensionLength(cohort_std.extent(0), C.extent(0));
+  ca::assertSameDimensionLength(mean.extent(0), C.extent(1));
+  ca::assertSameDimensionLength(stddev.extent(0), C.extent(1));
+  // Each thread processes a range of columns
+  bob::core::thread_loop(boost::bind(&detail::columnStatistics, boost::cref(C),
+        boost::cref(cohort_mean), boost::cref(cohort_std), boost::ref(mean),
+        boost::ref(stddev), _1, _2), C.extent(1), n_threads);
+}
+
+void ztNormApply(const blitz::Array<double, 2>& rawscores_probes_vs_models,
+                 const blitz::Array<double, 1>& z_mean,
+                 const blitz::Array<double, 1>& z_std,
+                 const blitz::Array<double, 1>& zt_mean,
+                 const blitz::Array<double, 1>& zt_std,
+                 blitz::Array<double, 2>& scores,
+                 const size_t n_threads)
+{
+  const blitz::Array<double, 2>& A = rawscores_probes_vs_models;
+  detail::checkApply(A, z_mean, z_std, zt_mean, zt_std);
+  ca::assertZeroBase(scores);
+  ca::assertSameShape(scores, A);
+  // Each thread processes a range of rows
+  bob::core::thread_loop(boost::bind(&detail::applyNorm, boost::cref(A),
+        boost::cref(z_mean), boost::cref(z_std), boost::cref(zt_mean), 
+        boost::cref(zt_std), boost::ref(scores), _1, _2), A.extent(0), 
+      n_threads);
+}
+
+void ztNormApply(const blitz::Array<double, 2>& rawscores_probes_vs_models,
+                 const blitz::Array<double, 1>& z_mean,
+                 const blitz::Array<double, 1>& z_std,
+                 const blitz::Array<double, 1>& zt_mean,
+                 const blitz::Array<double, 1>& zt_std,
+                 bob::io::HDF5File& file, const std::string& path,
+                 const size_t n_threads)
+{
+  const blitz::Array<double, 2>& A = rawscores_probes_vs_models;
+  detail::checkApply(A, z_mean, z_std, zt_mean, zt_std);
+
+  const int n_rows = A.extent(0);
+  blitz::Array<double, 2> buffer(std::min(detail::STREAM_ROWS, n_rows), 
+      A.extent(1));
+  blitz::Range rall = blitz::Range::all();
+  for(int r0 = 0; r0 < n_rows; r0 += detail::STREAM_ROWS) {
+    const int nb = std::min(detail::STREAM_ROWS, n_rows - r0);
+    blitz::Range rb(r0, r0 + nb - 1);
+    const blitz::Array<double, 2> A_b = A(rb, rall);
+    const blitz::Array<double, 1> z_mean_b = z_mean(rb);
+    const blitz::Array<double, 1> z_std_b = z_std(rb);
+    blitz::Array<double, 2> buffer_b = buffer(blitz::Range(0, nb - 1), rall);
+    ztNormApply(A_b, z_mean_b, z_std_b, zt_mean, zt_std, buffer_b, n_threads);
+    // Writes are sequential, as the HDF5 file is not thread-safe
+    for(int t = 0; t < nb; ++t) {
+      blitz::Array<double, 1> row = buffer_b(t, rall);
+      file.appendArray(path, row);
+    }
+  }
 }
 
 
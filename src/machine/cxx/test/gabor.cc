@@ -24,12 +24,14 @@
 #define BOOST_TEST_MODULE machine-GaborGraph Tests
 #define BOOST_TEST_MAIN
 
+#include <cmath>
 #include <boost/test/unit_test.hpp>
 #include <boost/filesystem.hpp>
 #include <blitz/array.h>
 
 #include "bob/machine/GaborGraphMachine.h"
 #include "bob/machine/GaborJetSimilarities.h"
+#include "bob/machine/GaborGraphGallery.h"
 #include "bob/machine/Exception.h"
 
 #include "bob/core/Exception.h"
@@ -111,6 +113,30 @@ BOOST_AUTO_TEST_CASE( test_gabor_graph_machine )
   test_close(graph, graph_jets);
 #endif // GENERATE_NEW_REFERENCE_FILES
 
+  // extract the graph directly from the image, computing the Gabor jets at the node positions only
+  blitz::Array<double,3> sparse_graph(machine.numberOfNodes(), 2, gwt.numberOfKernels());
+  machine.extract(gwt, image, sparse_graph);
+  for (int n = graph.extent(0); n--;)
+    for (int j = graph.extent(2); j--;){
+      BOOST_CHECK_SMALL(sparse_graph(n,0,j) - graph(n,0,j), 1e-6);
+      // phases are compared modulo 2 pi
+      BOOST_CHECK_SMALL(std::sin((sparse_graph(n,1,j) - graph(n,1,j)) / 2.), 1e-6);
+    }
+
+  // the same with absolute values only, and with dense node positions, for which the full transform is used
+  bob::machine::GaborGraphMachine dense_machine(first, last, blitz::TinyVector<int,2>(2,2));
+  blitz::Array<double,3> abs_jet_image(image.shape()[0], image.shape()[1], gwt.numberOfKernels());
+  gwt.computeJetImage(image, abs_jet_image, true);
+  for (int m = 2; m--;){
+    const bob::machine::GaborGraphMachine& current = m ? machine : dense_machine;
+    blitz::Array<double,2> abs_graph(current.numberOfNodes(), gwt.numberOfKernels()), abs_sparse_graph(current.numberOfNodes(), gwt.numberOfKernels());
+    current.extract(abs_jet_image, abs_graph);
+    current.extract(gwt, image, abs_sparse_graph);
+    for (int n = abs_graph.extent(0); n--;)
+      for (int j = abs_graph.extent(1); j--;)
+        BOOST_CHECK_SMALL(abs_sparse_graph(n,j) - abs_graph(n,j), 1e-6);
+  }
+
 
   // compute similarities of the graph to itself and check that they are unity
   std::vector<boost::shared_ptr<bob::machine::GaborJetSimilarity> > sim_fcts;
@@ -125,3 +151,64 @@ BOOST_AUTO_TEST_CASE( test_gabor_graph_machine )
     BOOST_CHECK_CLOSE(similarity, 1., epsilon);
   }
 }
+
+
+// generates deterministic Gabor graphs (with phases) for testing purposes
+static void generate_graphs(blitz::Array<double,4>& graphs, double seed){
+  for (int g = graphs.extent(0); g--;)
+    for (int n = graphs.extent(1); n--;)
+      for (int j = graphs.extent(3); j--;){
+        graphs(g,n,0,j) = 0.55 + 0.45 * sin(seed + 1.3 * g + 0.7 * n + 0.11 * j);
+        graphs(g,n,1,j) = M_PI * sin(2. * seed + 0.9 * g - 0.3 * n + 0.53 * j);
+      }
+}
+
+BOOST_AUTO_TEST_CASE( test_gabor_graph_gallery )
+{
+  bob::ip::GaborWaveletTransform gwt;
+  const int nodes = 5, jets = gwt.numberOfKernels();
+  blitz::Array<double,4> gallery(7, nodes, 2, jets), probes(9, nodes, 2, jets);
+  generate_graphs(gallery, 0.2);
+  generate_graphs(probes, 1.7);
+
+  blitz::Range all = blitz::Range::all();
+  bob::machine::GaborGraphMachine machine;
+  bob::machine::GaborJetSimilarity::SimilarityType types[] = {
+    bob::machine::GaborJetSimilarity::SCALAR_PRODUCT,
+    bob::machine::GaborJetSimilarity::CANBERRA,
+    bob::machine::GaborJetSimilarity::DISPARITY,
+    bob::machine::GaborJetSimilarity::PHASE_DIFF,
+    bob::machine::GaborJetSimilarity::PHASE_DIFF_PLUS_CANBERRA
+  };
+
+  for (int t = 0; t < 5; ++t){
+    bob::machine::GaborJetSimilarity sim(types[t], gwt);
+    bob::machine::GaborGraphGallery engine(sim);
+    engine.setGraphs(gallery);
+    BOOST_CHECK_EQUAL(engine.numberOfGraphs(), 7);
+
+    for (size_t n_threads = 1; n_threads <= 3; n_threads += 2){
+      blitz::Array<double,2> similarities(7, 9);
+      engine.similarity(probes, similarities, n_threads);
+      for (int g = 0; g < 7; ++g)
+        for (int p = 0; p < 9; ++p){
+          blitz::Array<double,3> model = gallery(g,all,all,all), probe = probes(p,all,all,all);
+          double reference = machine.similarity(model, probe, sim);
+          BOOST_CHECK_SMALL(similarities(g,p) - reference, epsilon);
+        }
+    }
+  }
+
+  // graphs without phases
+  bob::machine::GaborJetSimilarity sim(bob::machine::GaborJetSimilarity::CANBERRA);
+  bob::machine::GaborGraphGallery engine(sim);
+  blitz::Array<double,3> gallery_abs = gallery(all,all,0,all), probes_abs = probes(all,all,0,all);
+  engine.setGraphs(gallery_abs);
+  blitz::Array<double,2> similarities(7, 9);
+  engine.similarity(probes_abs, similarities, 2);
+  for (int g = 0; g < 7; ++g)
+    for (int p = 0; p < 9; ++p){
+      blitz::Array<double,2> model = gallery_abs(g,all,all), probe = probes_abs(p,all,all);
+      BOOST_CHECK_SMALL(similarities(g,p) - machine.similarity(model, probe, sim), epsilon);
+    }
+}
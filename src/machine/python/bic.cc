@@ -23,22 +23,44 @@
 #include "bob/machine/BICMachine.h"
 #include "bob/io/HDF5File.h"
 #include "bob/core/python/exception.h"
+#include "bob/core/python/gil.h"
 
 
-static void bic_forward_(const bob::machine::BICMachine& machine, bob::python::const_ndarray input, bob::python::ndarray output){
+static void bic_forward_(const bob::machine::BICMachine& machine, bob::python::const_ndarray input, bob::python::ndarray output, const size_t n_threads){
   blitz::Array<double,1> o = output.bz<double,1>();
-  machine.forward_(input.bz<double,1>(), o);
+  if (input.type().nd == 2){
+    const blitz::Array<double,2> i = input.bz<double,2>();
+    bob::python::no_gil unlock;
+    machine.forward_(i, o, n_threads);
+  } else {
+    machine.forward_(input.bz<double,1>(), o);
+  }
 }
 
-static void bic_forward(const bob::machine::BICMachine& machine, bob::python::const_ndarray input, bob::python::ndarray output){
+static void bic_forward(const bob::machine::BICMachine& machine, bob::python::const_ndarray input, bob::python::ndarray output, const size_t n_threads){
   blitz::Array<double,1> o = output.bz<double,1>();
-  machine.forward(input.bz<double,1>(), o);
+  if (input.type().nd == 2){
+    const blitz::Array<double,2> i = input.bz<double,2>();
+    bob::python::no_gil unlock;
+    machine.forward(i, o, n_threads);
+  } else {
+    machine.forward(input.bz<double,1>(), o);
+  }
 }
 
-static double bic_call(const bob::machine::BICMachine& machine, bob::python::const_ndarray input){
+static boost::python::object bic_call(const bob::machine::BICMachine& machine, bob::python::const_ndarray input, const size_t n_threads){
+  if (input.type().nd == 2){
+    const blitz::Array<double,2> i = input.bz<double,2>();
+    blitz::Array<double,1> o(i.extent(0));
+    {
+      bob::python::no_gil unlock;
+      machine.forward(i, o, n_threads);
+    }
+    return boost::python::object(o);
+  }
   blitz::Array<double,1> o(1);
   machine.forward(input.bz<double,1>(), o);
-  return o(0);
+  return boost::python::object(o(0));
 }
 
 void bind_machine_bic(){
@@ -105,10 +127,12 @@ void bind_machine_bic(){
       (
           boost::python::arg("self"),
           boost::python::arg("input"),
-          boost::python::arg("output")
+          boost::python::arg("output"),
+          boost::python::arg("n_threads") = 1
       ),
       "Computes the BIC or IEC score for the given input vector, which results of a comparison of two (facial) images. "
       "The score itself is the log-likelihood score of the given input vector belonging to the intrapersonal class. "
+      "If the input is a 2D array of difference vectors (one per row), the output must have one entry per vector; these vectors are projected block-wise with matrix products and can be split over several threads (set n_threads). "
       "No sanity checks of input and output are performed."
     )
 
@@ -117,10 +141,12 @@ void bind_machine_bic(){
       &bic_call,
       (
           boost::python::arg("self"),
-          boost::python::arg("input")
+          boost::python::arg("input"),
+          boost::python::arg("n_threads") = 1
       ),
       "Computes the BIC or IEC score for the given input vector, which results of a comparison of two (facial) images. "
       "The resulting value is returned as a single float value. "
+      "If the input is a 2D array of difference vectors (one per row), a 1D array of scores is returned; these vectors are projected block-wise with matrix products and can be split over several threads (set n_threads). "
       "The score itself is the log-likelihood score of the given input vector belonging to the intrapersonal class. "
       "No sanity checks of input and output are performed."
     )
@@ -131,10 +157,12 @@ void bind_machine_bic(){
       (
           boost::python::arg("self"),
           boost::python::arg("input"),
-          boost::python::arg("output")
+          boost::python::arg("output"),
+          boost::python::arg("n_threads") = 1
       ),
       "Computes the BIC or IEC score for the given input vector, which results of a comparison of two (facial) images. "
       "The score itself is the log-likelihood score of the given input vector belonging to the intrapersonal class. "
+      "If the input is a 2D array of difference vectors (one per row), the output must have one entry per vector; these vectors are projected block-wise with matrix products and can be split over several threads (set n_threads). "
       "No sanity checks of input and output are performed."
     )
 
@@ -144,10 +172,12 @@ void bind_machine_bic(){
       (
           boost::python::arg("self"),
           boost::python::arg("input"),
-          boost::python::arg("output")
+          boost::python::arg("output"),
+          boost::python::arg("n_threads") = 1
       ),
       "Computes the BIC or IEC score for the given input vector, which results of a comparison of two (facial) images. "
       "The score itself is the log-likelihood score of the given input vector belonging to the intrapersonal class. "
+      "If the input is a 2D array of difference vectors (one per row), the output must have one entry per vector; these vectors are projected block-wise with matrix products and can be split over several threads (set n_threads). "
       "Sanity checks of input and output shape are performed."
     )
 
@@ -23,11 +23,14 @@
 
 #include <boost/python.hpp>
 #include "bob/core/python/ndarray.h"
+#include "bob/core/python/gil.h"
 
 #include "bob/ip/GaborWaveletTransform.h"
 #include "bob/machine/GaborGraphMachine.h"
 #include "bob/machine/GaborJetSimilarities.h"
+#include "bob/machine/GaborGraphGallery.h"
 #include "bob/core/array_exception.h"
+#include "bob/core/cast.h"
 
 
 static void bob_extract(bob::machine::GaborGraphMachine& self, bob::python::const_ndarray input_jet_image, bob::python::ndarray output_graph){
@@ -58,6 +61,31 @@ static bob::python::ndarray bob_extract2(bob::machine::GaborGraphMachine& self,
   } else throw bob::core::UnexpectedShapeError();
 }
 
+static blitz::Array<std::complex<double>,2> bob_convert_image(bob::python::const_ndarray input_image){
+  switch (input_image.type().dtype){
+    case bob::core::array::t_uint8: return bob::core::cast<std::complex<double> >(input_image.bz<uint8_t,2>());
+    case bob::core::array::t_uint16: return bob::core::cast<std::complex<double> >(input_image.bz<uint16_t,2>());
+    case bob::core::array::t_float64: return bob::core::cast<std::complex<double> >(input_image.bz<double,2>());
+    case bob::core::array::t_complex128: return input_image.bz<std::complex<double>,2>();
+    default: PYTHON_ERROR(TypeError, "cannot extract Gabor graphs from images of type '%s'", input_image.type().str().c_str());
+  }
+}
+
+static bob::python::ndarray bob_extract3(bob::machine::GaborGraphMachine& self, bob::ip::GaborWaveletTransform& gwt, bob::python::const_ndarray input_image, bool include_phases, bool normalized){
+  const blitz::Array<std::complex<double>,2> image = bob_convert_image(input_image);
+  if (include_phases){
+    bob::python::ndarray output_graph(bob::core::array::t_float64, self.numberOfNodes(), 2, (int)gwt.numberOfKernels());
+    blitz::Array<double,3> graph = output_graph.bz<double,3>();
+    self.extract(gwt, image, graph, normalized);
+    return output_graph;
+  } else {
+    bob::python::ndarray output_graph(bob::core::array::t_float64, self.numberOfNodes(), (int)gwt.numberOfKernels());
+    blitz::Array<double,2> graph = output_graph.bz<double,2>();
+    self.extract(gwt, image, graph, normalized);
+    return output_graph;
+  }
+}
+
 static void bob_average(bob::machine::GaborGraphMachine& self, bob::python::const_ndarray many_graph_jets, bob::python::ndarray averaged_graph_jets){
   const blitz::Array<double,4> graph_set = many_graph_jets.bz<double,4>();
   blitz::Array<double,3> graph = averaged_graph_jets.bz<double,3>();
@@ -118,6 +146,45 @@ static double bob_jet_sim(const bob::machine::GaborJetSimilarity& self, bob::pyt
   }
 }
 
+static void bob_set_graphs(bob::machine::GaborGraphGallery& self, bob::python::const_ndarray graph_jets){
+  switch (graph_jets.type().nd){
+    case 3:{
+      const blitz::Array<double,3> graphs = graph_jets.bz<double,3>();
+      self.setGraphs(graphs);
+      break;
+    }
+    case 4:{
+      const blitz::Array<double,4> graphs = graph_jets.bz<double,4>();
+      self.setGraphs(graphs);
+      break;
+    }
+    default:
+      throw bob::core::UnexpectedShapeError();
+  }
+}
+
+static bob::python::ndarray bob_gallery_similarity(const bob::machine::GaborGraphGallery& self, bob::python::const_ndarray probe_graph_jets, const size_t n_threads){
+  bob::python::ndarray output(bob::core::array::t_float64, (size_t)self.numberOfGraphs(), (size_t)probe_graph_jets.type().shape[0]);
+  blitz::Array<double,2> similarities = output.bz<double,2>();
+  switch (probe_graph_jets.type().nd){
+    case 3:{
+      const blitz::Array<double,3> probes = probe_graph_jets.bz<double,3>();
+      bob::python::no_gil unlock;
+      self.similarity(probes, similarities, n_threads);
+      break;
+    }
+    case 4:{
+      const blitz::Array<double,4> probes = probe_graph_jets.bz<double,4>();
+      bob::python::no_gil unlock;
+      self.similarity(probes, similarities, n_threads);
+      break;
+    }
+    default:
+      throw bob::core::UnexpectedShapeError();
+  }
+  return output;
+}
+
 void bind_machine_gabor(){
   /////////////////////////////////////////////////////////////////////////////////////////
   //////////////// Gabor jet similarities
@@ -247,6 +314,13 @@ void bind_machine_gabor(){
       "Extracts and returns the Gabor jets at the desired locations from the given Gabor jet image"
     )
 
+    .def(
+      "extract",
+      &bob_extract3,
+      (boost::python::arg("self"), boost::python::arg("gwt"), boost::python::arg("image"), boost::python::arg("include_phases")=true, boost::python::arg("normalized")=true),
+      "Extracts and returns the Gabor jets at the desired locations directly from the given (gray) image, using the given Gabor wavelet transform. The Gabor wavelet transform is computed at the node positions only, which is much faster than computing the whole jet image first. The Gabor jets are identical to the ones extracted from the jet image."
+    )
+
     .def(
       "average",
       &bob_average,
@@ -261,4 +335,44 @@ void bind_machine_gabor(){
       "Computes the similarity between the given probe graph and the gallery, which might be a single graph or a collection of graphs"
   );
 
+  /////////////////////////////////////////////////////////////////////////////////////////
+  //////////////// Gabor graph gallery
+  boost::python::class_<bob::machine::GaborGraphGallery, boost::shared_ptr<bob::machine::GaborGraphGallery> >(
+      "GaborGraphGallery",
+      "This class stores a gallery of Gabor graphs and computes the similarities of all gallery graphs with many probe graphs at once. The similarities are identical to the ones computed by GaborGraphMachine.similarity() for single graphs.",
+      boost::python::no_init
+    )
+
+    .def(
+      boost::python::init<const bob::machine::GaborJetSimilarity&>(
+        (boost::python::arg("self"), boost::python::arg("jet_similarity_function")),
+        "Generates an empty gallery, whose graphs are compared with the given Gabor jet similarity function."
+      )
+    )
+
+    .add_property(
+      "number_of_graphs",
+      &bob::machine::GaborGraphGallery::numberOfGraphs,
+      "The number of graphs in the gallery."
+    )
+
+    .add_property(
+      "number_of_nodes",
+      &bob::machine::GaborGraphGallery::numberOfNodes,
+      "The number of nodes of the gallery graphs."
+    )
+
+    .def(
+      "set_graphs",
+      &bob_set_graphs,
+      (boost::python::arg("self"), boost::python::arg("graph_jets")),
+      "Sets the gallery graphs, given as a 3D array (graphs x nodes x jets) of Gabor jets without phases, or as a 4D array (graphs x nodes x 2 x jets) of Gabor jets with phases."
+    )
+
+    .def(
+      "similarity",
+      &bob_gallery_similarity,
+      (boost::python::arg("self"), boost::python::arg("probe_graph_jets"), boost::python::arg("n_threads") = 1),
+      "Computes and returns the similarities of all gallery graphs (rows) with the given probe graphs (columns), which are given in the same layout as the gallery graphs. The gallery can be split across several threads."
+  );
 }
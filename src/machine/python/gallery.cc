@@ -0,0 +1,111 @@
+/**
+ * @file machine/python/gallery.cc
+ * @date Mon Oct 19 18:12:47 2026 +0200
+ *
+ * @brief Python bindings to the GalleryIndex
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bob/core/python/ndarray.h"
+#include "bob/core/python/gil.h"
+#include "bob/machine/GalleryIndex.h"
+
+using namespace boost::python;
+namespace bp = bob::python;
+namespace ca = bob::core::array;
+namespace mach = bob::machine;
+namespace io = bob::io;
+
+static void add(mach::GalleryIndex& g, object ids, bp::const_ndarray models) {
+  const ca::typeinfo& info = models.type();
+
+  if (info.dtype != ca::t_float64)
+    PYTHON_ERROR(TypeError, "cannot add models of type '%s'", info.str().c_str());
+
+  switch(info.nd) {
+    case 1:
+      g.add(extract<int64_t>(ids)(), models.bz<double,1>());
+      break;
+    case 2:
+      {
+        blitz::Array<int64_t,1> ids_ = extract<blitz::Array<int64_t,1> >(ids);
+        const blitz::Array<double,2> models_ = models.bz<double,2>();
+        bob::python::no_gil unlock;
+        g.add(ids_, models_);
+      }
+      break;
+    default:
+      PYTHON_ERROR(TypeError, "cannot add models of type '%s'", info.str().c_str());
+  }
+}
+
+static object search(const mach::GalleryIndex& g, bp::const_ndarray probes,
+    const size_t k, const size_t n_threads) {
+  const ca::typeinfo& info = probes.type();
+
+  if (info.dtype != ca::t_float64 || (info.nd != 1 && info.nd != 2))
+    PYTHON_ERROR(TypeError, "cannot search probes of type '%s'", info.str().c_str());
+
+  blitz::Array<double,2> probes_;
+  if (info.nd == 1) {
+    probes_.resize(1, info.shape[0]);
+    probes_(0, blitz::Range::all()) = probes.bz<double,1>();
+  }
+  else probes_.reference(probes.bz<double,2>());
+
+  blitz::Array<int64_t,2> ids;
+  blitz::Array<double,2> scores;
+  {
+    bob::python::no_gil unlock;
+    g.search(probes_, k, ids, scores, n_threads);
+  }
+
+  if (info.nd == 1) {
+    blitz::Array<int64_t,1> ids_ = ids(0, blitz::Range::all());
+    blitz::Array<double,1> scores_ = scores(0, blitz::Range::all());
+    return make_tuple(ids_, scores_);
+  }
+  return make_tuple(ids, scores);
+}
+
+static blitz::Array<int64_t,1> get_ids(const mach::GalleryIndex& g) {
+  const std::vector<int64_t>& ids = g.getIds();
+  blitz::Array<int64_t,1> res(ids.size());
+  for (size_t i=0; i<ids.size(); ++i) res(i) = ids[i];
+  return res;
+}
+
+void bind_machine_gallery() {
+  class_<mach::GalleryIndex, boost::shared_ptr<mach::GalleryIndex> >("GalleryIndex", "A gallery of enrolled models for identification (1:N search). Each model is represented by a vector (e.g. a GMM mean supervector, the projection of a sample by a LinearMachine or the concatenated jets of a Gabor graph) and an integer identifier.\n\nModel and probe vectors are optionally projected with a LinearMachine (e.g. a whitening) and L2-normalized, before being compared with a dot product. The model vectors are stored in single precision, in a contiguous matrix. Search queries return the exact k best scoring models of each probe.", init<optional<const size_t, const bool> >((arg("n_inputs")=0, arg("normalize")=true), "Builds an empty gallery for vectors of the given size. If normalize is set, the model and probe vectors are L2-normalized."))
+    .def(init<const mach::LinearMachine&, optional<const bool> >((arg("projection"), arg("normalize")=true), "Builds an empty gallery, where the model and probe vectors are first projected with the given LinearMachine, which must have a linear activation, before being optionally L2-normalized."))
+    .def(init<io::HDF5File&>((arg("config")), "Loads a gallery from a configuration file."))
+    .def(init<const mach::GalleryIndex&>((arg("other")), "Copies another gallery."))
+    .def("load", &mach::GalleryIndex::load, (arg("self"), arg("config")), "Loads the gallery from a configuration file.")
+    .def("save", &mach::GalleryIndex::save, (arg("self"), arg("config")), "Saves the gallery to a configuration file.")
+    .add_property("n_inputs", &mach::GalleryIndex::getNInputs, "Size of the model and probe vectors")
+    .add_property("dimension", &mach::GalleryIndex::getDimension, "Size of the stored vectors, after the (optional) projection")
+    .add_property("normalize", &mach::GalleryIndex::getNormalize, "Tells if the vectors are L2-normalized")
+    .add_property("ids", &get_ids, "The identifiers of the enrolled models, in storage order")
+    .def("__len__", &mach::GalleryIndex::size, (arg("self")), "Number of enrolled models")
+    .def("__contains__", &mach::GalleryIndex::contains, (arg("self"), arg("id")), "Tells if a model with the given identifier is enrolled")
+    .def("add", &add, (arg("self"), arg("ids"), arg("models")), "Enrolls a model (if models is a 1D array and ids an integer) or several models at once (if models is a 2D array with one model per row, and ids a 1D int64 array). Existing models with the same identifiers are replaced.")
+    .def("remove", &mach::GalleryIndex::remove, (arg("self"), arg("id")), "Removes the model with the given identifier. Returns False if there is no such model.")
+    .def("clear", &mach::GalleryIndex::clear, (arg("self")), "Removes all the models.")
+    .def("reserve", &mach::GalleryIndex::reserve, (arg("self"), arg("n_models")), "Reserves the memory for the given number of models.")
+    .def("get_model", &mach::GalleryIndex::getModel, (arg("self"), arg("id")), "Returns the stored (projected and normalized) vector of a model, in single precision.")
+    .def("search", &search, (arg("self"), arg("probes"), arg("k"), arg("n_threads")=1), "Searches the k best scoring models of each probe (a 1D array, or a 2D array with one probe per row), and returns a tuple (ids, scores). Results are sorted by decreasing score, and ties broken by increasing identifier. The gallery can be split across several threads (set n_threads).")
+    ;
+}
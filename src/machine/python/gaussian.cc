@@ -111,7 +111,7 @@ void bind_machine_gaussian()
     .def("resize", &mach::Gaussian::resize, "Set the input dimensionality, reset the mean to zero and the variance to one.")
     .def("log_likelihood", &py_logLikelihood, "Output the log likelihood of the sample, x. The input size is checked.")
     .def("log_likelihood_", &py_logLikelihood_, "Output the log likelihood of the sample, x. The input size is NOT checked.")
-    .def("save", &mach::Gaussian::save, "Save to a Configuration")
+    .def("save", &mach::Gaussian::save, (arg("self"), arg("config"), arg("single_precision")=false), "Save to a Configuration. If single_precision is set, the mean and variance arrays are stored as float32 datasets.")
     .def("load", &mach::Gaussian::load, "Load from a Configuration")
     .def(self_ns::str(self_ns::self))
   ;
@@ -25,6 +25,7 @@
 #include <blitz/array.h>
 
 #include "bob/core/python/ndarray.h"
+#include "bob/core/python/gil.h"
 
 using namespace boost::python;
 namespace io = bob::io;
@@ -205,12 +206,81 @@ static double py_gmmmachine_loglikelihoodB_(const mach::GMMMachine& machine, bp:
   return machine.logLikelihood_(x.bz<double,1>());
 }
 
-static void py_gmmmachine_accStatistics(const mach::GMMMachine& machine, bp::const_ndarray x, mach::GMMStats& gs) {
-  machine.accStatistics(x.bz<double,1>(), gs);
+static void py_gmmmachine_accStatistics(const mach::GMMMachine& machine,
+    bp::const_ndarray x, mach::GMMStats& gs, const size_t n_threads, const bool check) {
+  const ca::typeinfo& info = x.type();
+  if (info.nd == 1 && info.dtype == ca::t_float64) {
+    if (check) machine.accStatistics(x.bz<double,1>(), gs);
+    else machine.accStatistics_(x.bz<double,1>(), gs);
+  }
+  else if (info.nd == 2 && info.dtype == ca::t_float64) {
+    const blitz::Array<double,2> x_ = x.bz<double,2>();
+    bob::python::no_gil unlock;
+    if (check) machine.accStatistics(x_, gs, n_threads);
+    else machine.accStatistics_(x_, gs, n_threads);
+  }
+  else if (info.nd == 2 && info.dtype == ca::t_float32) {
+    const blitz::Array<float,2> x_ = x.bz<float,2>();
+    bob::python::no_gil unlock;
+    if (check) machine.accStatistics(x_, gs, n_threads);
+    else machine.accStatistics_(x_, gs, n_threads);
+  }
+  else
+    PYTHON_ERROR(TypeError, "cannot accumulate statistics of arrays of type '%s'", info.str().c_str());
+}
+
+static void py_gmmmachine_accStatisticsChecked(const mach::GMMMachine& machine,
+    bp::const_ndarray x, mach::GMMStats& gs, const size_t n_threads) {
+  py_gmmmachine_accStatistics(machine, x, gs, n_threads, true);
+}
+
+static void py_gmmmachine_accStatisticsUnchecked(const mach::GMMMachine& machine,
+    bp::const_ndarray x, mach::GMMStats& gs, const size_t n_threads) {
+  py_gmmmachine_accStatistics(machine, x, gs, n_threads, false);
+}
+
+static object py_gmmmachine_forward(const mach::GMMMachine& machine,
+    bp::const_ndarray input, const size_t n_threads, const bool check) {
+  const ca::typeinfo& info = input.type();
+  if (info.nd == 1 && info.dtype == ca::t_float64) {
+    double output;
+    if (check) machine.forward(input.bz<double,1>(), output);
+    else machine.forward_(input.bz<double,1>(), output);
+    return object(output);
+  }
+  else if (info.nd == 2 && info.dtype == ca::t_float64) {
+    bp::ndarray output(ca::t_float64, info.shape[0]);
+    const blitz::Array<double,2> input_ = input.bz<double,2>();
+    blitz::Array<double,1> output_ = output.bz<double,1>();
+    {
+      bob::python::no_gil unlock;
+      if (check) machine.forward(input_, output_, n_threads);
+      else machine.forward_(input_, output_, n_threads);
+    }
+    return output.self();
+  }
+  else if (info.nd == 2 && info.dtype == ca::t_float32) {
+    bp::ndarray output(ca::t_float32, info.shape[0]);
+    const blitz::Array<float,2> input_ = input.bz<float,2>();
+    blitz::Array<float,1> output_ = output.bz<float,1>();
+    {
+      bob::python::no_gil unlock;
+      if (check) machine.forward(input_, output_, n_threads);
+      else machine.forward_(input_, output_, n_threads);
+    }
+    return output.self();
+  }
+  PYTHON_ERROR(TypeError, "cannot forward arrays of type '%s'", info.str().c_str());
+}
+
+static object py_gmmmachine_forwardChecked(const mach::GMMMachine& machine,
+    bp::const_ndarray input, const size_t n_threads) {
+  return py_gmmmachine_forward(machine, input, n_threads, true);
 }
 
-static void py_gmmmachine_accStatistics_(const mach::GMMMachine& machine, bp::const_ndarray x, mach::GMMStats& gs) {
-  machine.accStatistics_(x.bz<double,1>(), gs);
+static object py_gmmmachine_forwardUnchecked(const mach::GMMMachine& machine,
+    bp::const_ndarray input, const size_t n_threads) {
+  return py_gmmmachine_forward(machine, input, n_threads, false);
 }
 
 void bind_machine_gmm() 
@@ -236,7 +306,7 @@ void bind_machine_gmm()
     .def("resize", &mach::GMMStats::resize, args("n_gaussians", "n_inputs"),
          " Allocates space for the statistics and resets to zero.")
     .def("init", &mach::GMMStats::init, "Resets statistics to zero.")
-    .def("save", &mach::GMMStats::save, "Save to a Configuration")
+    .def("save", &mach::GMMStats::save, (arg("self"), arg("config"), arg("single_precision")=false), "Save to a Configuration. If single_precision is set, the statistics are stored as float32 datasets.")
     .def("load", &mach::GMMStats::load, "Load from a Configuration")
     .def(self_ns::str(self_ns::self))
     .def(self_ns::self += self_ns::self)
@@ -280,18 +350,28 @@ void bind_machine_gmm()
          " Output the log likelihood of the sample, x, i.e. log(p(x|GMM)). Inputs are checked.")
     .def("log_likelihood_", &py_gmmmachine_loglikelihoodB_, args("self", "x"),
          " Output the log likelihood of the sample, x, i.e. log(p(x|GMM)). Inputs are checked.")
-    .def("acc_statistics", &py_gmmmachine_accStatistics, args("self", "x", "stats"),
-         "Accumulate the GMM statistics for this sample. Inputs are checked.")
-    .def("acc_statistics_", &py_gmmmachine_accStatistics_, args("self", "x", "stats"),
-         "Accumulate the GMM statistics for this sample. Inputs are NOT checked.")
-    .def("acc_statistics",
-         (void (mach::GMMMachine::*)(const blitz::Array<double,2>&, mach::GMMStats&) const)&mach::GMMMachine::accStatistics,
-         args("sampler", "stats"), "Accumulates the GMM statistics over a set of samples. Inputs are checked.")
-    .def("acc_statistics_",
-         (void (mach::GMMMachine::*)(const blitz::Array<double,2>&, mach::GMMStats&) const)&mach::GMMMachine::accStatistics_,
-         args("sampler", "stats"), "Accumulates the GMM statistics over a set of samples. Inputs are NOT checked.")
+    .def("acc_statistics", &py_gmmmachine_accStatisticsChecked, (arg("self"), arg("x"), arg("stats"), arg("n_threads")=1),
+         "Accumulate the GMM statistics for this sample (a 1D array), or over a set of samples (a 2D array, one sample per row). "
+         "The samples of a 2D array can be split over several threads (set n_threads). "
+         "If the samples are given as a float32 2D array, the statistics of blocks of samples are computed in single precision, and accumulated in double precision. Inputs are checked.")
+    .def("acc_statistics_", &py_gmmmachine_accStatisticsUnchecked, (arg("self"), arg("x"), arg("stats"), arg("n_threads")=1),
+         "Accumulate the GMM statistics for this sample (a 1D array), or over a set of samples (a 2D array, one sample per row). "
+         "The samples of a 2D array can be split over several threads (set n_threads). "
+         "If the samples are given as a float32 2D array, the statistics of blocks of samples are computed in single precision, and accumulated in double precision. Inputs are NOT checked.")
+    .def("__call__", &py_gmmmachine_forwardUnchecked, (arg("self"), arg("input"), arg("n_threads")=1),
+         "Output the log likelihood of the given sample (a 1D array), or the log likelihoods of a set of samples (a 2D array, one sample per row). "
+         "The log likelihoods of a float32 2D array are computed in single precision, and returned as a float32 array. "
+         "The samples of a 2D array can be split over several threads (set n_threads). Inputs are NOT checked.")
+    .def("forward", &py_gmmmachine_forwardChecked, (arg("self"), arg("input"), arg("n_threads")=1),
+         "Output the log likelihood of the given sample (a 1D array), or the log likelihoods of a set of samples (a 2D array, one sample per row). "
+         "The log likelihoods of a float32 2D array are computed in single precision, and returned as a float32 array. "
+         "The samples of a 2D array can be split over several threads (set n_threads). Inputs are checked.")
+    .def("forward_", &py_gmmmachine_forwardUnchecked, (arg("self"), arg("input"), arg("n_threads")=1),
+         "Output the log likelihood of the given sample (a 1D array), or the log likelihoods of a set of samples (a 2D array, one sample per row). "
+         "The log likelihoods of a float32 2D array are computed in single precision, and returned as a float32 array. "
+         "The samples of a 2D array can be split over several threads (set n_threads). Inputs are NOT checked.")
     .def("load", &mach::GMMMachine::load, "Load from a Configuration")
-    .def("save", &mach::GMMMachine::save, "Save to a Configuration")
+    .def("save", &mach::GMMMachine::save, (arg("self"), arg("config"), arg("single_precision")=false), "Save to a Configuration. If single_precision is set, the weights, means and variances are stored as float32 datasets.")
     .def(self_ns::str(self_ns::self))
   ;
 
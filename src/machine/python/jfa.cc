@@ -23,8 +23,10 @@
 #include <boost/python.hpp>
 #include <boost/shared_ptr.hpp>
 #include "bob/core/python/ndarray.h"
+#include "bob/core/python/gil.h"
 #include "bob/machine/JFAMachine.h"
 #include "bob/machine/GMMMachine.h"
+#include "bob/machine/ModelBank.h"
 
 using namespace boost::python;
 namespace mach = bob::machine;
@@ -147,6 +149,48 @@ static double jfa_forward_sample(mach::JFAMachine& m,
   return score;
 }
 
+static object jfabase_forward(const mach::JFABaseMachine& m, list models,
+    list probes, const size_t n_threads)
+{
+  // Extracts the vectors of JFAMachine and GMMStats from the python lists
+  std::vector<boost::shared_ptr<const mach::JFAMachine> > models_;
+  for(int i=0; i<len(models); ++i) {
+    boost::shared_ptr<mach::JFAMachine> model = extract<boost::shared_ptr<mach::JFAMachine> >(models[i]);
+    models_.push_back(model);
+  }
+  std::vector<boost::shared_ptr<const mach::GMMStats> > probes_;
+  for(int i=0; i<len(probes); ++i) {
+    boost::shared_ptr<mach::GMMStats> probe = extract<boost::shared_ptr<mach::GMMStats> >(probes[i]);
+    probes_.push_back(probe);
+  }
+
+  tp::ndarray scores(ca::t_float64, models_.size(), probes_.size());
+  blitz::Array<double,2> scores_ = scores.bz<double,2>();
+  {
+    bob::python::no_gil unlock;
+    m.forward(models_, probes_, scores_, n_threads);
+  }
+  return scores.self();
+}
+
+static object jfabase_forward_bank(const mach::JFABaseMachine& m,
+    const mach::ModelBank& models, list probes, const size_t n_threads)
+{
+  std::vector<boost::shared_ptr<const mach::GMMStats> > probes_;
+  for(int i=0; i<len(probes); ++i) {
+    boost::shared_ptr<mach::GMMStats> probe = extract<boost::shared_ptr<mach::GMMStats> >(probes[i]);
+    probes_.push_back(probe);
+  }
+
+  tp::ndarray scores(ca::t_float64, models.size(), probes_.size());
+  blitz::Array<double,2> scores_ = scores.bz<double,2>();
+  {
+    bob::python::no_gil unlock;
+    m.forward(models, probes_, scores_, n_threads);
+  }
+  return scores.self();
+}
+
 void bind_machine_jfa() 
 {
   class_<mach::JFABaseMachine, boost::shared_ptr<mach::JFABaseMachine> >("JFABaseMachine", "A JFABaseMachine", init<boost::shared_ptr<mach::GMMMachine>, optional<const size_t, const size_t> >((arg("ubm"), arg("ru")=1, arg("rv")=1), "Builds a new JFABaseMachine. A JFABaseMachine can be seen as a container for U, V and D when performing Joint Factor Analysis (JFA)."))
@@ -156,6 +200,9 @@ void bind_machine_jfa()
     .def("load", &mach::JFABaseMachine::load, (arg("self"), arg("config")), "Loads the configuration parameters from a configuration file.")
     .def("save", &mach::JFABaseMachine::save, (arg("self"), arg("config")), "Saves the configuration parameters to a configuration file.")
     .def("resize", &mach::JFABaseMachine::resize, "Reset the dimensionality of the subspaces U and V.")
+    .def("precompute", &mach::JFABaseMachine::precompute, (arg("self")), "Updates the scoring state cached by this machine (U^T.Sigma^-1 and the per-component U_c^T.Sigma_c^-1.U_c products). This is done automatically when U, V, d or the UBM are set, but should be called after the UBM is modified in place.")
+    .def("forward", &jfabase_forward, (arg("self"), arg("models"), arg("probes"), arg("n_threads")=1), "Scores a list of GMMStats probes against a list of JFAMachine models attached to this machine, and returns a 2D array of scores of size (#models, #probes). The channel factors of each probe are estimated only once, and the probes are split across n_threads threads.")
+    .def("forward", &jfabase_forward_bank, (arg("self"), arg("models"), arg("probes"), arg("n_threads")=1), "Scores a list of GMMStats probes against the models of a ModelBank with 'y' and 'z' fields, and returns a 2D array of scores of size (len(models), #probes).")
     .add_property("ubm", &mach::JFABaseMachine::getUbm, &mach::JFABaseMachine::setUbm)
     .add_property("u", &py_getU, &py_setU)
     .add_property("v", &py_getV, &py_setV)
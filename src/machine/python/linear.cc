@@ -21,6 +21,7 @@
  */
 
 #include "bob/core/python/ndarray.h"
+#include "bob/core/python/gil.h"
 #include "bob/machine/LinearMachine.h"
 
 using namespace boost::python;
@@ -29,7 +30,8 @@ namespace ca = bob::core::array;
 namespace mach = bob::machine;
 namespace io = bob::io;
 
-static object forward(const mach::LinearMachine& m, bp::const_ndarray input) {
+static object forward(const mach::LinearMachine& m, bp::const_ndarray input,
+    size_t n_threads) {
   const ca::typeinfo& info = input.type();
 
   if (info.dtype != ca::t_float64)
@@ -46,13 +48,11 @@ static object forward(const mach::LinearMachine& m, bp::const_ndarray input) {
     case 2:
       {
         bp::ndarray output(ca::t_float64, info.shape[0], m.outputSize());
-        blitz::Array<double,2> input_ = input.bz<double,2>();
+        const blitz::Array<double,2> input_ = input.bz<double,2>();
         blitz::Array<double,2> output_ = output.bz<double,2>();
-        blitz::Range all = blitz::Range::all();
-        for (size_t k=0; k<info.shape[0]; ++k) {
-          blitz::Array<double,1> i_ = input_(k,all);
-          blitz::Array<double,1> o_ = output_(k,all);
-          m.forward(i_, o_);
+        {
+          bob::python::no_gil unlock;
+          m.forward(input_, output_, n_threads);
         }
         return output.self();
       }
@@ -62,7 +62,7 @@ static object forward(const mach::LinearMachine& m, bp::const_ndarray input) {
 }
 
 static void forward2(const mach::LinearMachine& m, bp::const_ndarray input,
-    bp::ndarray output) {
+    bp::ndarray output, size_t n_threads) {
   const ca::typeinfo& info = input.type();
 
   if (info.dtype != ca::t_float64)
@@ -77,13 +77,24 @@ static void forward2(const mach::LinearMachine& m, bp::const_ndarray input,
       break;
     case 2:
       {
-        blitz::Array<double,2> input_ = input.bz<double,2>();
-        blitz::Array<double,2> output_ = output.bz<double,2>();
-        blitz::Range all = blitz::Range::all();
-        for (size_t k=0; k<info.shape[0]; ++k) {
-          blitz::Array<double,1> i_ = input_(k,all);
-          blitz::Array<double,1> o_ = output_(k,all);
-          m.forward(i_, o_);
+        const blitz::Array<double,2> input_ = input.bz<double,2>();
+        switch(output.type().dtype) {
+          case ca::t_float64:
+            {
+              blitz::Array<double,2> output_ = output.bz<double,2>();
+              bob::python::no_gil unlock;
+              m.forward(input_, output_, n_threads);
+            }
+            break;
+          case ca::t_float32:
+            {
+              blitz::Array<float,2> output_ = output.bz<float,2>();
+              bob::python::no_gil unlock;
+              m.forward(input_, output_, n_threads);
+            }
+            break;
+          default:
+            PYTHON_ERROR(TypeError, "cannot forward into output arrays of type '%s'", output.type().str().c_str());
         }
       }
       break;
@@ -183,9 +194,9 @@ void bind_machine_linear() {
     .add_property("activation", &mach::LinearMachine::getActivation, &mach::LinearMachine::setActivation, "The activation function - by default, the identity function. The output provided by the activation function is passed, unchanged, to the user.")
     .add_property("shape", &get_shape, &set_shape, "A tuple that represents the size of the input vector followed by the size of the output vector in the format ``(input, output)``.")
     .def("resize", &mach::LinearMachine::resize, (arg("self"), arg("input"), arg("output")), "Resizes the machine. If either the input or output increases in size, the weights and other factors should be considered uninitialized. If the size is preserved or reduced, already initialized values will not be changed.\n\nTip: Use this method to force data compression. All will work out given most relevant factors to be preserved are organized on the top of the weight matrix. In this way, reducing the system size will supress less relevant projections.")
-    .def("__call__", &forward2, (arg("self"), arg("input"), arg("output")), "Projects the input to the weights and biases and saves results on the output")
-    .def("forward", &forward2, (arg("self"), arg("input"), arg("output")), "Projects the input to the weights and biases and saves results on the output")
-    .def("__call__", &forward, (arg("self"), arg("input")), "Projects the input to the weights and biases and returns the output. This method implies in copying out the output data and is, therefore, less efficient as its counterpart that sets the output given as parameter. If you have to do a tight loop, consider using that variant instead of this one.")
-    .def("forward", &forward, (arg("self"), arg("input")), "Projects the input to the weights and biases and returns the output. This method implies in copying out the output data and is, therefore, less efficient as its counterpart that sets the output given as parameter. If you have to do a tight loop, consider using that variant instead of this one.")
+    .def("__call__", &forward2, (arg("self"), arg("input"), arg("output"), arg("n_threads")=1), "Projects the input to the weights and biases and saves results on the output. If the input is a 2D array, all its rows are projected at once, using a single matrix product in which the input subtraction and division are folded. In this case, the output can be either a float64 or a float32 2D array and the computations can be split over several threads, by setting n_threads.")
+    .def("forward", &forward2, (arg("self"), arg("input"), arg("output"), arg("n_threads")=1), "Projects the input to the weights and biases and saves results on the output. If the input is a 2D array, all its rows are projected at once, using a single matrix product in which the input subtraction and division are folded. In this case, the output can be either a float64 or a float32 2D array and the computations can be split over several threads, by setting n_threads.")
+    .def("__call__", &forward, (arg("self"), arg("input"), arg("n_threads")=1), "Projects the input to the weights and biases and returns the output. This method implies in copying out the output data and is, therefore, less efficient as its counterpart that sets the output given as parameter. If you have to do a tight loop, consider using that variant instead of this one. 2D inputs are projected at once, possibly over several threads (set n_threads).")
+    .def("forward", &forward, (arg("self"), arg("input"), arg("n_threads")=1), "Projects the input to the weights and biases and returns the output. This method implies in copying out the output data and is, therefore, less efficient as its counterpart that sets the output given as parameter. If you have to do a tight loop, consider using that variant instead of this one. 2D inputs are projected at once, possibly over several threads (set n_threads).")
     ;
 }
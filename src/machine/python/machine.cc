@@ -23,31 +23,64 @@
 #include "bob/machine/Machine.h"
 
 #include "bob/core/python/ndarray.h"
+#include "bob/core/python/gil.h"
 
 using namespace boost::python;
 namespace mach = bob::machine;
 namespace bp = bob::python;
+namespace ca = bob::core::array;
 
-static double forward(const mach::Machine<blitz::Array<double,1>, double>& m,
-    bp::const_ndarray input) {
-  double output;
-  m.forward(input.bz<double,1>(), output);
-  return output;
+typedef mach::Machine<blitz::Array<double,1>, double> MachineDouble;
+
+static object forward(const MachineDouble& m, bp::const_ndarray input,
+    const size_t n_threads, const bool check) {
+  const ca::typeinfo& info = input.type();
+
+  if (info.dtype != ca::t_float64)
+    PYTHON_ERROR(TypeError, "cannot forward arrays of type '%s'", info.str().c_str());
+
+  switch(info.nd) {
+    case 1:
+      {
+        double output;
+        if (check) m.forward(input.bz<double,1>(), output);
+        else m.forward_(input.bz<double,1>(), output);
+        return object(output);
+      }
+    case 2:
+      {
+        bp::ndarray output(ca::t_float64, info.shape[0]);
+        const blitz::Array<double,2> input_ = input.bz<double,2>();
+        blitz::Array<double,1> output_ = output.bz<double,1>();
+        {
+          bob::python::no_gil unlock;
+          if (check) m.forward(input_, output_, n_threads);
+          else m.forward_(input_, output_, n_threads);
+        }
+        return output.self();
+      }
+    default:
+      PYTHON_ERROR(TypeError, "cannot forward arrays of type '%s'", info.str().c_str());
+  }
+}
+
+static object forward_checked(const MachineDouble& m, bp::const_ndarray input,
+    const size_t n_threads) {
+  return forward(m, input, n_threads, true);
 }
 
-static double forward_(const mach::Machine<blitz::Array<double,1>, double>& m,
-    bp::const_ndarray input) {
-  double output;
-  m.forward_(input.bz<double,1>(), output);
-  return output;
+static object forward_unchecked(const MachineDouble& m,
+    bp::const_ndarray input, const size_t n_threads) {
+  return forward(m, input, n_threads, false);
 }
 
 void bind_machine_base() 
 {
-  class_<mach::Machine<blitz::Array<double,1>, double>, boost::noncopyable>("MachineDoubleBase", 
+  class_<MachineDouble, boost::noncopyable>("MachineDoubleBase", 
       "Root class for all Machine<blitz::Array<double,1>, double>", no_init)
-    .def("__call__", &forward_, (arg("self"), arg("input")), "Executes the machine on the given 1D numpy array of float64, and returns the output. NO CHECK is performed.")
-    .def("forward", &forward, (arg("self"), arg("input")), "Executes the machine on the given 1D numpy array of float64, and returns the output.")
-    .def("forward_", &forward_, (arg("self"), arg("input")), "Executes the machine on the given 1D numpy array of float64, and returns the output. NO CHECK is performed.")
+    .add_property("is_thread_safe", &MachineDouble::isThreadSafe, "Tells if the samples of a 2D input can be processed by several threads, when the machine does not have a dedicated batch algorithm.")
+    .def("__call__", &forward_unchecked, (arg("self"), arg("input"), arg("n_threads")=1), "Executes the machine on the given 1D numpy array of float64, and returns the output. If the input is a 2D array, the machine is executed on each of its rows, and a 1D array of outputs is returned; the rows can be split over several threads (set n_threads). NO CHECK is performed.")
+    .def("forward", &forward_checked, (arg("self"), arg("input"), arg("n_threads")=1), "Executes the machine on the given 1D numpy array of float64, and returns the output. If the input is a 2D array, the machine is executed on each of its rows, and a 1D array of outputs is returned; the rows can be split over several threads (set n_threads).")
+    .def("forward_", &forward_unchecked, (arg("self"), arg("input"), arg("n_threads")=1), "Executes the machine on the given 1D numpy array of float64, and returns the output. If the input is a 2D array, the machine is executed on each of its rows, and a 1D array of outputs is returned; the rows can be split over several threads (set n_threads). NO CHECK is performed.")
   ;
 }
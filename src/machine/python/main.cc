@@ -34,6 +34,8 @@ void bind_machine_activation();
 void bind_machine_linear();
 void bind_machine_mlp();
 void bind_machine_linear_scoring();
+void bind_machine_gallery();
+void bind_machine_modelbank();
 void bind_machine_ztnorm();
 void bind_machine_jfa();
 void bind_machine_plda();
@@ -58,6 +60,8 @@ BOOST_PYTHON_MODULE(_machine)
   bind_machine_linear();
   bind_machine_mlp();
   bind_machine_linear_scoring();
+  bind_machine_gallery();
+  bind_machine_modelbank();
   bind_machine_ztnorm();
   bind_machine_jfa();
   bind_machine_plda();
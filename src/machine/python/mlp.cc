@@ -21,6 +21,7 @@
  */
 
 #include "bob/core/python/ndarray.h"
+#include "bob/core/python/gil.h"
 #include <boost/make_shared.hpp>
 #include <boost/python/stl_iterator.hpp>
 #include "bob/machine/MLP.h"
@@ -46,7 +47,8 @@ static void set_shape(mach::MLP& m, object shape) {
   m.resize(vshape);
 }
 
-static object forward1(const mach::MLP& m, tp::const_ndarray input) {
+static object forward1(const mach::MLP& m, tp::const_ndarray input,
+    const size_t n_threads) {
 
   const ca::typeinfo& info = input.type();
 
@@ -65,8 +67,12 @@ static object forward1(const mach::MLP& m, tp::const_ndarray input) {
     case 2:
       {
         tp::ndarray output(ca::t_float64, input.type().shape[0],m.outputSize());
+        const blitz::Array<double,2> input_ = input.bz<double,2>();
         blitz::Array<double,2> output_ = output.bz<double,2>();
-        m.forward(input.bz<double,2>(), output_);
+        {
+          bob::python::no_gil unlock;
+          m.forward(input_, output_, n_threads);
+        }
         return output.self();
       }
       break;
@@ -76,7 +82,7 @@ static object forward1(const mach::MLP& m, tp::const_ndarray input) {
 }
 
 static void forward2(const mach::MLP& m, tp::const_ndarray input,
-    tp::ndarray output) {
+    tp::ndarray output, const size_t n_threads) {
   const ca::typeinfo& info = input.type();
 
   if (info.dtype != ca::t_float64)
@@ -91,8 +97,10 @@ static void forward2(const mach::MLP& m, tp::const_ndarray input,
       break;
     case 2:
       {
+        const blitz::Array<double,2> input_ = input.bz<double,2>();
         blitz::Array<double,2> output_ = output.bz<double,2>();
-        m.forward(input.bz<double,2>(), output_);
+        bob::python::no_gil unlock;
+        m.forward(input_, output_, n_threads);
       }
       break;
     default:
@@ -101,7 +109,7 @@ static void forward2(const mach::MLP& m, tp::const_ndarray input,
 }
 
 static void forward2_(const mach::MLP& m, tp::const_ndarray input,
-    tp::ndarray output) {
+    tp::ndarray output, const size_t n_threads) {
   const ca::typeinfo& info = input.type();
 
   if (info.dtype != ca::t_float64)
@@ -116,8 +124,10 @@ static void forward2_(const mach::MLP& m, tp::const_ndarray input,
       break;
     case 2:
       {
+        const blitz::Array<double,2> input_ = input.bz<double,2>();
         blitz::Array<double,2> output_ = output.bz<double,2>();
-        m.forward_(input.bz<double,2>(), output_);
+        bob::python::no_gil unlock;
+        m.forward_(input_, output_, n_threads);
       }
       break;
     default:
@@ -246,11 +256,11 @@ void bind_machine_mlp() {
     .add_property("biases", &get_bias, &set_bias, "A set of biases for each layer in the MLP. This is represented by a standard tuple containing the biases as 1D numpy.ndarray's of double-precision floating-point elements. Each of the ndarrays has the number of elements equals to the number of neurons in the respective layer. Note that, by definition, the input layer is not subject to biasing. If you need biasing on the input layer, use the input_subtract and input_divide attributes of this MLP.")
     .add_property("activation", &mach::MLP::getActivation, &mach::MLP::setActivation, "The activation function - by default, the hyperbolic tangent function. The output provided by the activation function is passed, unchanged, to the user.")
     .add_property("shape", &get_shape, &set_shape, "A tuple that represents the size of the input vector followed by the number of neurons in each hidden layer of the MLP and, finally, terminated by the size of the output vector in the format ``(input, hidden0, hidden1, ..., hiddenN, output)``. If you set this attribute, the network is automatically resized and should be considered uninitialized.")
-    .def("__call__", &forward2, (arg("self"), arg("input"), arg("output")), "Projects the input to the weights and biases and saves results on the output. You can either pass an input with 1 or 2 dimensions. If 2D, it is the same as running the 1D case many times considering as input to be every row in the input matrix.")
-    .def("forward", &forward2, (arg("self"), arg("input"), arg("output")), "Projects the input to the weights and biases and saves results on the output. You can either pass an input with 1 or 2 dimensions. If 2D, it is the same as running the 1D case many times considering as input to be every row in the input matrix.")
-    .def("forward_", &forward2_, (arg("self"), arg("input"), arg("output")), "Projects the input to the weights and biases and saves results on the output. You can either pass an input with 1 or 2 dimensions. If 2D, it is the same as running the 1D case many times considering as input to be every row in the input matrix.")
-    .def("__call__", &forward1, (arg("self"), arg("input")), "Projects the input to the weights and biases and returns the output. This method implies in copying out the output data and is, therefore, less efficient as its counterpart that sets the output given as parameter. If you have to do a tight loop, consider using that variant instead of this one. You can either pass an input with 1 or 2 dimensions. If 2D, it is the same as running the 1D case many times considering as input to be every row in the input matrix.")
-    .def("forward", &forward1, (arg("self"), arg("input")), "Projects the input to the weights and biases and returns the output. This method implies in copying out the output data and is, therefore, less efficient as its counterpart that sets the output given as parameter. If you have to do a tight loop, consider using that variant instead of this one. You can either pass an input with 1 or 2 dimensions. If 2D, it is the same as running the 1D case many times considering as input to be every row in the input matrix.")
+    .def("__call__", &forward2, (arg("self"), arg("input"), arg("output"), arg("n_threads")=1), "Projects the input to the weights and biases and saves results on the output. You can either pass an input with 1 or 2 dimensions. If 2D, it is the same as running the 1D case many times considering as input to be every row in the input matrix, but the rows are propagated through the network block by block, possibly over several threads (set n_threads).")
+    .def("forward", &forward2, (arg("self"), arg("input"), arg("output"), arg("n_threads")=1), "Projects the input to the weights and biases and saves results on the output. You can either pass an input with 1 or 2 dimensions. If 2D, it is the same as running the 1D case many times considering as input to be every row in the input matrix, but the rows are propagated through the network block by block, possibly over several threads (set n_threads).")
+    .def("forward_", &forward2_, (arg("self"), arg("input"), arg("output"), arg("n_threads")=1), "Projects the input to the weights and biases and saves results on the output. You can either pass an input with 1 or 2 dimensions. If 2D, it is the same as running the 1D case many times considering as input to be every row in the input matrix, but the rows are propagated through the network block by block, possibly over several threads (set n_threads).")
+    .def("__call__", &forward1, (arg("self"), arg("input"), arg("n_threads")=1), "Projects the input to the weights and biases and returns the output. This method implies in copying out the output data and is, therefore, less efficient as its counterpart that sets the output given as parameter. If you have to do a tight loop, consider using that variant instead of this one. You can either pass an input with 1 or 2 dimensions. If 2D, it is the same as running the 1D case many times considering as input to be every row in the input matrix, but the rows are propagated through the network block by block, possibly over several threads (set n_threads).")
+    .def("forward", &forward1, (arg("self"), arg("input"), arg("n_threads")=1), "Projects the input to the weights and biases and returns the output. This method implies in copying out the output data and is, therefore, less efficient as its counterpart that sets the output given as parameter. If you have to do a tight loop, consider using that variant instead of this one. You can either pass an input with 1 or 2 dimensions. If 2D, it is the same as running the 1D case many times considering as input to be every row in the input matrix, but the rows are propagated through the network block by block, possibly over several threads (set n_threads).")
     .def("randomize", &random0, (arg("self")), "Sets all weights and biases of this MLP, with random values between [-0.1, 0.1) as advised in textbooks.\n\nValues are drawn using boost::uniform_real class. The seed is picked using a time-based algorithm. Different calls spaced of at least 1 microsecond (machine clock) will be seeded differently. Values are taken from the range [lower_bound, upper_bound) according to the boost::random documentation.")
     .def("randomize", &random1, (arg("self"), arg("lower_bound"), arg("upper_bound")), "Sets all weights and biases of this MLP, with random values between [lower_bound, upper_bound).\n\nValues are drawn using boost::uniform_real class. The seed is picked using a time-based algorithm. Different calls spaced of at least 1 microsecond (machine clock) will be seeded differently. Values are taken from the range [lower_bound, upper_bound) according to the boost::random documentation.")
     .def("randomize", &random2, (arg("self"), arg("rng")), "Sets all weights and biases of this MLP, with random values between [-0.1, 0.1) as advised in textbooks.\n\nValues are drawn using boost::uniform_real class. You should pass the generator in this variant. You can seed it the way it pleases you. Values are taken from the range [lower_bound, upper_bound) according to the boost::random documentation.")
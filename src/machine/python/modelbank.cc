@@ -0,0 +1,117 @@
+/**
+ * @file machine/python/modelbank.cc
+ * @date Mon Oct 19 20:14:08 2026 +0200
+ *
+ * @brief Python bindings to the ModelBank
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bob/core/python/ndarray.h"
+#include "bob/core/array_copy.h"
+#include "bob/machine/ModelBank.h"
+
+using namespace boost::python;
+namespace bp = bob::python;
+namespace ca = bob::core::array;
+namespace mach = bob::machine;
+namespace io = bob::io;
+
+static boost::shared_ptr<mach::ModelBank> init_fields(object names,
+    object sizes) {
+  std::vector<std::string> names_;
+  std::vector<size_t> sizes_;
+  stl_input_iterator<std::string> nit(names), nend;
+  names_.assign(nit, nend);
+  stl_input_iterator<size_t> sit(sizes), send;
+  sizes_.assign(sit, send);
+  return boost::shared_ptr<mach::ModelBank>(new mach::ModelBank(names_, sizes_));
+}
+
+static void set(mach::ModelBank& b, object ids, const std::string& name,
+    bp::const_ndarray values) {
+  const ca::typeinfo& info = values.type();
+
+  if (info.dtype != ca::t_float64)
+    PYTHON_ERROR(TypeError, "cannot set a field with values of type '%s'", info.str().c_str());
+
+  switch(info.nd) {
+    case 1:
+      b.set(extract<int64_t>(ids)(), name, values.bz<double,1>());
+      break;
+    case 2:
+      {
+        blitz::Array<int64_t,1> ids_ = extract<blitz::Array<int64_t,1> >(ids);
+        b.set(ids_, name, values.bz<double,2>());
+      }
+      break;
+    default:
+      PYTHON_ERROR(TypeError, "cannot set a field with values of type '%s'", info.str().c_str());
+  }
+}
+
+static blitz::Array<double,2> get_field(const mach::ModelBank& b,
+    const std::string& name) {
+  return ca::ccopy(b.getField(name));
+}
+
+static blitz::Array<double,1> get_model_field(const mach::ModelBank& b,
+    const std::string& name, const int64_t id) {
+  return ca::ccopy(b.getField(name, id));
+}
+
+static blitz::Array<int64_t,1> get_ids(const mach::ModelBank& b) {
+  const std::vector<int64_t>& ids = b.getIds();
+  blitz::Array<int64_t,1> res(ids.size());
+  for (size_t i=0; i<ids.size(); ++i) res(i) = ids[i];
+  return res;
+}
+
+static tuple get_field_names(const mach::ModelBank& b) {
+  list res;
+  for (size_t f=0; f<b.getFieldNames().size(); ++f)
+    res.append(b.getFieldNames()[f]);
+  return tuple(res);
+}
+
+void bind_machine_modelbank() {
+  class_<mach::ModelBank, boost::shared_ptr<mach::ModelBank> >("ModelBank", "A bank of enrolled client models, each of them identified by an integer. The per-client parameters are stored in fields: each field is a contiguous matrix with one row per model, such that all the models are scored at once, and such that the bank is saved and loaded with a single dataset per field (instead of one HDF5 group per model).\n\nThe layouts of the banks built from a base machine are:\n\n* GMMMachine (UBM): 'mean' (C.D), the mean supervectors\n* JFABaseMachine: 'y' (rv) and 'z' (C.D), the speaker factors\n* PLDABaseMachine: 'weighted_sum' (F), 'n_samples', 'nh_sum_xit_beta_xi' and 'log_likelihood' (1 each)\n\nSuch banks can be given to linear_scoring(), JFABaseMachine.forward() and PLDABaseMachine.forward().", init<>("Builds an empty bank, without any field."))
+    .def("__init__", make_constructor(&init_fields, default_call_policies(), (arg("names"), arg("sizes"))), "Builds an empty bank with the given field names and sizes.")
+    .def(init<const mach::GMMMachine&>((arg("ubm")), "Builds an empty bank of GMM mean supervectors adapted from the given UBM."))
+    .def(init<const mach::JFABaseMachine&>((arg("base")), "Builds an empty bank of JFA (or ISV) speaker factors."))
+    .def(init<const mach::PLDABaseMachine&>((arg("base")), "Builds an empty bank of PLDA enrolment data."))
+    .def(init<io::HDF5File&>((arg("config")), "Loads a bank from a configuration file."))
+    .def(init<const mach::ModelBank&>((arg("other")), "Copies another bank."))
+    .def("load", &mach::ModelBank::load, (arg("self"), arg("config")), "Loads the bank from a configuration file, with a single read per field.")
+    .def("save", &mach::ModelBank::save, (arg("self"), arg("config")), "Saves the bank to a configuration file, with a single dataset per field.")
+    .add_property("field_names", &get_field_names, "The names of the fields")
+    .add_property("ids", &get_ids, "The identifiers of the models, in storage order")
+    .def("has_field", &mach::ModelBank::hasField, (arg("self"), arg("name")), "Tells if the bank has a field with the given name")
+    .def("field_size", &mach::ModelBank::getFieldSize, (arg("self"), arg("name")), "Returns the size of the given field")
+    .def("get_field", &get_field, (arg("self"), arg("name")), "Returns (a copy of) the given field of all the models, one per row.")
+    .def("get_field", &get_model_field, (arg("self"), arg("name"), arg("id")), "Returns (a copy of) the given field of the model with the given identifier.")
+    .def("__len__", &mach::ModelBank::size, (arg("self")), "Number of models")
+    .def("__contains__", &mach::ModelBank::contains, (arg("self"), arg("id")), "Tells if a model with the given identifier is stored")
+    .def("row", &mach::ModelBank::getRow, (arg("self"), arg("id")), "Returns the row of the model with the given identifier")
+    .def("add", (size_t (mach::ModelBank::*)(const int64_t))&mach::ModelBank::add, (arg("self"), arg("id")), "Adds a model with the given identifier, whose fields are all set to zero, and returns its row. If the model already exists, its row is returned and its fields are kept.")
+    .def("add", (void (mach::ModelBank::*)(const int64_t, const mach::GMMMachine&))&mach::ModelBank::add, (arg("self"), arg("id"), arg("model")), "Adds (or replaces) a GMM client model, whose mean supervector is written in the 'mean' field.")
+    .def("add", (void (mach::ModelBank::*)(const int64_t, const mach::JFAMachine&))&mach::ModelBank::add, (arg("self"), arg("id"), arg("model")), "Adds (or replaces) a JFA client model, whose factors are written in the 'y' and 'z' fields.")
+    .def("add", (void (mach::ModelBank::*)(const int64_t, const mach::PLDAMachine&))&mach::ModelBank::add, (arg("self"), arg("id"), arg("model")), "Adds (or replaces) an enrolled PLDA model.")
+    .def("set", &set, (arg("self"), arg("ids"), arg("name"), arg("values")), "Sets a field of a model (if values is a 1D array and ids an integer) or of several models at once (if values is a 2D array with one model per row, and ids a 1D int64 array). Missing models are added.")
+    .def("remove", &mach::ModelBank::remove, (arg("self"), arg("id")), "Removes the model with the given identifier. Returns False if there is no such model.")
+    .def("clear", &mach::ModelBank::clear, (arg("self")), "Removes all the models.")
+    .def("reserve", &mach::ModelBank::reserve, (arg("self"), arg("n_models")), "Reserves the memory for the given number of models.")
+    ;
+}
@@ -23,7 +23,9 @@
 #include "bob/core/python/ndarray.h"
 #include <boost/shared_ptr.hpp>
 #include "bob/core/python/exception.h"
+#include "bob/core/python/gil.h"
 #include "bob/machine/PLDAMachine.h"
+#include "bob/machine/ModelBank.h"
 
 using namespace boost::python;
 namespace mach = bob::machine;
@@ -84,6 +86,50 @@ static object plda_getAddGamma(mach::PLDAMachine& m, const size_t a) {
   return object(res);
 }
 
+static object pldabase_forward(const mach::PLDABaseMachine& m, list models,
+    tp::const_ndarray probes, const size_t n_threads)
+{
+  const ca::typeinfo& info = probes.type();
+  if(info.dtype != ca::t_float64 || info.nd != 2)
+    PYTHON_ERROR(TypeError, "PLDA forwarding does not accept type '%s'",
+        info.str().c_str());
+
+  // Extracts the vector of PLDAMachine from the python list
+  std::vector<boost::shared_ptr<const mach::PLDAMachine> > models_;
+  for(int i=0; i<len(models); ++i) {
+    boost::shared_ptr<mach::PLDAMachine> model = extract<boost::shared_ptr<mach::PLDAMachine> >(models[i]);
+    models_.push_back(model);
+  }
+
+  const blitz::Array<double,2> probes_ = probes.bz<double,2>();
+  tp::ndarray scores(ca::t_float64, models_.size(), (size_t)probes_.extent(0));
+  blitz::Array<double,2> scores_ = scores.bz<double,2>();
+  {
+    bob::python::no_gil unlock;
+    m.forward(models_, probes_, scores_, n_threads);
+  }
+  return scores.self();
+}
+
+static object pldabase_forward_bank(const mach::PLDABaseMachine& m,
+    const mach::ModelBank& models, tp::const_ndarray probes,
+    const size_t n_threads)
+{
+  const ca::typeinfo& info = probes.type();
+  if(info.dtype != ca::t_float64 || info.nd != 2)
+    PYTHON_ERROR(TypeError, "PLDA forwarding does not accept type '%s'",
+        info.str().c_str());
+
+  const blitz::Array<double,2> probes_ = probes.bz<double,2>();
+  tp::ndarray scores(ca::t_float64, models.size(), (size_t)probes_.extent(0));
+  blitz::Array<double,2> scores_ = scores.bz<double,2>();
+  {
+    bob::python::no_gil unlock;
+    m.forward(models, probes_, scores_, n_threads);
+  }
+  return scores.self();
+}
+
 BOOST_PYTHON_FUNCTION_OVERLOADS(computeLikelihood1_overloads, computeLikelihood1, 2, 3)
 BOOST_PYTHON_FUNCTION_OVERLOADS(computeLikelihood2_overloads, computeLikelihood2, 2, 3)
 
@@ -110,8 +156,11 @@ void bind_machine_plda() {
     .def("compute_gamma", &mach::PLDABaseMachine::computeGamma, (arg("self"), arg("a"), arg("gamma")), "Computes the gamma matrix for the given number of samples. (gamma = inverse(I+a.F^T.beta.F), please check the documentation/source code for more details.")
     .def("get_add_gamma", &pldabase_getAddGamma, (arg("self"), arg("a")), "Computes the gamma matrix for the given number of samples. (gamma = inverse(I+a.F^T.beta.F), please check the documentation/source code for more details.")
     .def("has_log_like_const_term", &mach::PLDABaseMachine::hasLogLikeConstTerm, (arg("self"), arg("a")), "Tells if the log likelihood constant term for the given number of samples has already been computed.")
-    .def("compute_log_like_const_term", (double (mach::PLDABaseMachine::*)(const size_t, const blitz::Array<double,2>&))&mach::PLDABaseMachine::computeLogLikeConstTerm, (arg("self"), arg("a"), arg("gamma")), "Computes the log likelihood constant term for the given number of samples.")
+    .def("compute_log_like_const_term", (double (mach::PLDABaseMachine::*)(const size_t, const blitz::Array<double,2>&) const)&mach::PLDABaseMachine::computeLogLikeConstTerm, (arg("self"), arg("a"), arg("gamma")), "Computes the log likelihood constant term for the given number of samples.")
     .def("get_add_log_like_const_term", &mach::PLDABaseMachine::getAddLogLikeConstTerm, (arg("self"), arg("a")), "Computes the log likelihood constant term for the given number of samples, and adds it to the machine (as well as gamma), if it does not already exist.")
+    .def("precompute_log_like_const_terms", &mach::PLDABaseMachine::precomputeLogLikeConstTerms, (arg("self"), arg("a_min"), arg("a_max")), "Precomputes gamma and the log likelihood constant term for all the numbers of samples in [a_min, a_max]. Once this is done, scoring with the PLDAMachines attached to this machine does not modify them anymore.")
+    .def("forward", &pldabase_forward, (arg("self"), arg("models"), arg("probes"), arg("n_threads")=1), "Computes the log likelihood ratio scores of the probe samples (one per row of the 2D array probes) against a list of PLDAMachine models attached to this machine. A 2D array of size (#models, #probes) is returned. The probes are split across n_threads threads.")
+    .def("forward", &pldabase_forward_bank, (arg("self"), arg("models"), arg("probes"), arg("n_threads")=1), "Computes the log likelihood ratio scores of the probe samples (one per row of the 2D array probes) against the models of a ModelBank with the PLDA enrolment fields. A 2D array of size (len(models), #probes) is returned.")
     .add_property("dim_d", &mach::PLDABaseMachine::getDimD)
     .add_property("dim_f", &mach::PLDABaseMachine::getDimF)
     .add_property("dim_g", &mach::PLDABaseMachine::getDimG)
@@ -21,6 +21,7 @@
  */
 
 #include "bob/core/python/ndarray.h"
+#include "bob/core/python/gil.h"
 #include "bob/machine/SVM.h"
 
 using namespace boost::python;
@@ -228,6 +229,52 @@ static void set_input_div(mach::SupportVector& m, object o) {
   }
 }
 
+static object batch_predict_classes(const mach::BatchSupportVector& m,
+    tp::const_ndarray input, size_t n_threads) {
+  const blitz::Array<double,2> i_ = input.bz<double,2>();
+  tp::ndarray labels(ca::t_int32, i_.extent(0));
+  blitz::Array<int,1> labels_ = labels.bz<int,1>();
+  {
+    bob::python::no_gil unlock;
+    m.predictClasses(i_, labels_, n_threads);
+  }
+  return labels.self();
+}
+
+static tuple batch_predict_classes_and_scores(const mach::BatchSupportVector& m,
+    tp::const_ndarray input, size_t n_threads) {
+  const blitz::Array<double,2> i_ = input.bz<double,2>();
+  tp::ndarray labels(ca::t_int32, i_.extent(0));
+  blitz::Array<int,1> labels_ = labels.bz<int,1>();
+  tp::ndarray scores(ca::t_float64, (size_t)i_.extent(0), m.numberOfScores());
+  blitz::Array<double,2> scores_ = scores.bz<double,2>();
+  {
+    bob::python::no_gil unlock;
+    m.predictClassesAndScores(i_, labels_, scores_, n_threads);
+  }
+  return make_tuple(labels.self(), scores.self());
+}
+
+static tuple batch_predict_classes_and_probs(const mach::BatchSupportVector& m,
+    tp::const_ndarray input, size_t n_threads) {
+  const blitz::Array<double,2> i_ = input.bz<double,2>();
+  tp::ndarray labels(ca::t_int32, i_.extent(0));
+  blitz::Array<int,1> labels_ = labels.bz<int,1>();
+  tp::ndarray probs(ca::t_float64, (size_t)i_.extent(0), m.numberOfClasses());
+  blitz::Array<double,2> probs_ = probs.bz<double,2>();
+  {
+    bob::python::no_gil unlock;
+    m.predictClassesAndProbabilities(i_, labels_, probs_, n_threads);
+  }
+  return make_tuple(labels.self(), probs.self());
+}
+
+static tuple batch_labels(const mach::BatchSupportVector& m) {
+  list retval;
+  for (size_t k=0; k<m.numberOfClasses(); ++k) retval.append(m.classLabel(k));
+  return tuple(retval);
+}
+
 void bind_machine_svm() {
 
   class_<mach::SVMFile, boost::shared_ptr<mach::SVMFile>, boost::noncopyable>("SVMFile", "Loads a given libsvm data file. The data file format, as defined on the library README is like this:\n\n  <label> <index1>:<value1> <index2>:<value2> ...\n  .\n  .\n  .\n\nThe labels are integer values, so are the indexes, starting from '1' (and not from zero as a C-programmer would expect. The values are floating point.\n\nZero values are suppressed - libsvm uses a sparse format.\n\nThis class is made available to you so you can input original libsvm files and convert them to another representation better supported. You cannot, from this object, save data or extend the current set.", init<const char*>((arg("filename")), "Intializes an SVM file with the path to an existing file. The file is scanned entirely so to compute the sample size."))
@@ -288,4 +335,19 @@ void bind_machine_svm() {
     .def("save", (void (mach::SupportVector::*)(const std::string&) const)&mach::SupportVector::save, (arg("self"), arg("filename")), "Saves the currently loaded model to an output file. Overwrites the file, if necessary")
     .def("save", (void (mach::SupportVector::*)(bob::io::HDF5File&) const)&mach::SupportVector::save, (arg("self"), arg("config")), "Saves the whole machine into a configuration file. This allows for a single instruction parameter loading, which includes both the model and the scaling parameters.")
     ;
+
+  class_<mach::BatchSupportVector, boost::shared_ptr<mach::BatchSupportVector>, boost::noncopyable>("BatchSupportVector", "A dense re-implementation of the libsvm prediction of a SupportVector, to be used on many samples at once. The support vectors are unpacked into a contiguous matrix and samples are processed in blocks, using the BLAS for all the dot products. For linear kernels, the support vectors are collapsed into a single weight vector per decision function, in which the input scaling is folded. For polynomial, RBF and sigmoid kernels, the dot products between the support vectors and a block of samples are computed with a single matrix product before applying the kernel. Precomputed kernels are not supported. Samples can be split over several threads. Results are equivalent to the ones of the SupportVector up to the floating point precision.", no_init)
+    .def(init<const mach::SupportVector&>((arg("machine")), "Builds the dense representation of an existing SupportVector machine, including its current scaling parameters. Later changes in the scaling parameters of the SupportVector machine are not reflected in this object."))
+    .add_property("labels", &batch_labels, "The labels this machine will output.")
+    .add_property("svm_type", &mach::BatchSupportVector::machineType, "The type of SVM machine contained")
+    .add_property("kernel_type", &mach::BatchSupportVector::kernelType, "The type of kernel used by the support vectors in this machine")
+    .add_property("probability", &mach::BatchSupportVector::supportsProbability, "true if this machine supports probability outputs")
+    .add_property("input_size", &mach::BatchSupportVector::inputSize, "The number of inputs this machine expects")
+    .add_property("n_scores", &mach::BatchSupportVector::numberOfScores, "The number of scores (decision values) output for every sample. This is N*(N-1)/2 for N-class classification problems and 1 otherwise.")
+    .add_property("block_size", &mach::BatchSupportVector::getBlockSize, &mach::BatchSupportVector::setBlockSize, "The number of samples processed in a row by every thread. This bounds the size of the temporary kernel matrices.")
+    .def("predict_classes", &batch_predict_classes, (arg("self"), arg("input"), arg("n_threads")=1), "Returns the predicted classes of all samples in the 2D input array (samples arranged row-wise) as a 1D int32 numpy array. Computations are split over the given number of threads.")
+    .def("__call__", &batch_predict_classes, (arg("self"), arg("input"), arg("n_threads")=1), "Returns the predicted classes of all samples in the 2D input array (samples arranged row-wise) as a 1D int32 numpy array. Computations are split over the given number of threads.")
+    .def("predict_classes_and_scores", &batch_predict_classes_and_scores, (arg("self"), arg("input"), arg("n_threads")=1), "Returns the predicted classes and the scores of all samples in the 2D input array (samples arranged row-wise) as a tuple containing a 1D int32 and a 2D float64 numpy array, in this order. Computations are split over the given number of threads.")
+    .def("predict_classes_and_probabilities", &batch_predict_classes_and_probs, (arg("self"), arg("input"), arg("n_threads")=1), "Returns the predicted classes and the probabilities of each class for all samples in the 2D input array (samples arranged row-wise) as a tuple containing a 1D int32 and a 2D float64 numpy array, in this order. The current machine has to support probabilities, otherwise an exception is raised. Computations are split over the given number of threads.")
+    ;
 }
@@ -21,6 +21,7 @@
  */
 
 #include "bob/core/python/ndarray.h"
+#include "bob/core/python/gil.h"
 
 #include <boost/python.hpp>
 #include "bob/machine/ZTNorm.h"
@@ -34,7 +35,8 @@ static object ztnorm1(
     tp::const_ndarray rawscores_zprobes_vs_models,
     tp::const_ndarray rawscores_probes_vs_tmodels,
     tp::const_ndarray rawscores_zprobes_vs_tmodels,
-    tp::const_ndarray mask_zprobes_vs_tmodels_istruetrial) 
+    tp::const_ndarray mask_zprobes_vs_tmodels_istruetrial,
+    const size_t n_threads) 
 {
   const blitz::Array<double,2> rawscores_probes_vs_models_ = 
     rawscores_probes_vs_models.bz<double,2>();
@@ -51,12 +53,15 @@ static object ztnorm1(
   tp::ndarray ret(ca::t_float64, rawscores_probes_vs_models_.extent(0), rawscores_probes_vs_models_.extent(1));
   blitz::Array<double, 2> ret_ = ret.bz<double,2>();
 
-  bob::machine::ztNorm(rawscores_probes_vs_models_,
+  {
+    bob::python::no_gil unlock;
+    bob::machine::ztNorm(rawscores_probes_vs_models_,
                          rawscores_zprobes_vs_models_,
                          rawscores_probes_vs_tmodels_,
                          rawscores_zprobes_vs_tmodels_,
                          mask_zprobes_vs_tmodels_istruetrial_,
-                         ret_);
+                         ret_, n_threads);
+  }
 
   return ret.self();
 }
@@ -65,7 +70,8 @@ static object ztnorm2(
     tp::const_ndarray rawscores_probes_vs_models,
     tp::const_ndarray rawscores_zprobes_vs_models,
     tp::const_ndarray rawscores_probes_vs_tmodels,
-    tp::const_ndarray rawscores_zprobes_vs_tmodels) 
+    tp::const_ndarray rawscores_zprobes_vs_tmodels,
+    const size_t n_threads) 
 {
   const blitz::Array<double,2> rawscores_probes_vs_models_ = 
     rawscores_probes_vs_models.bz<double,2>();
@@ -80,33 +86,182 @@ static object ztnorm2(
   tp::ndarray ret(ca::t_float64, rawscores_probes_vs_models_.extent(0), rawscores_probes_vs_models_.extent(1));
   blitz::Array<double, 2> ret_ = ret.bz<double,2>();
 
-  bob::machine::ztNorm(rawscores_probes_vs_models_,
+  {
+    bob::python::no_gil unlock;
+    bob::machine::ztNorm(rawscores_probes_vs_models_,
                          rawscores_zprobes_vs_models_,
                          rawscores_probes_vs_tmodels_,
                          rawscores_zprobes_vs_tmodels_,
-                         ret_);
+                         ret_, n_threads);
+  }
 
   return ret.self();
 }
 
+static object znorm_statistics(tp::const_ndarray rawscores_zprobes_vs_models,
+    const size_t n_threads)
+{
+  const blitz::Array<double,2> B = rawscores_zprobes_vs_models.bz<double,2>();
+  tp::ndarray mean(ca::t_float64, B.extent(0));
+  tp::ndarray stddev(ca::t_float64, B.extent(0));
+  blitz::Array<double,1> mean_ = mean.bz<double,1>();
+  blitz::Array<double,1> std_ = stddev.bz<double,1>();
+  {
+    bob::python::no_gil unlock;
+    bob::machine::zNormStatistics(B, mean_, std_, n_threads);
+  }
+  return make_tuple(mean.self(), stddev.self());
+}
+
+static object tnorm_cohort_statistics1(
+    tp::const_ndarray rawscores_zprobes_vs_tmodels,
+    tp::const_ndarray mask_zprobes_vs_tmodels_istruetrial,
+    const size_t n_threads)
+{
+  const blitz::Array<double,2> D = rawscores_zprobes_vs_tmodels.bz<double,2>();
+  const blitz::Array<bool,2> mask = mask_zprobes_vs_tmodels_istruetrial.bz<bool,2>();
+  tp::ndarray mean(ca::t_float64, D.extent(0));
+  tp::ndarray stddev(ca::t_float64, D.extent(0));
+  blitz::Array<double,1> mean_ = mean.bz<double,1>();
+  blitz::Array<double,1> std_ = stddev.bz<double,1>();
+  {
+    bob::python::no_gil unlock;
+    bob::machine::tNormCohortStatistics(D, mask, mean_, std_, n_threads);
+  }
+  return make_tuple(mean.self(), stddev.self());
+}
+
+static object tnorm_cohort_statistics2(
+    tp::const_ndarray rawscores_zprobes_vs_tmodels, const size_t n_threads)
+{
+  const blitz::Array<double,2> D = rawscores_zprobes_vs_tmodels.bz<double,2>();
+  tp::ndarray mean(ca::t_float64, D.extent(0));
+  tp::ndarray stddev(ca::t_float64, D.extent(0));
+  blitz::Array<double,1> mean_ = mean.bz<double,1>();
+  blitz::Array<double,1> std_ = stddev.bz<double,1>();
+  {
+    bob::python::no_gil unlock;
+    bob::machine::tNormCohortStatistics(D, mean_, std_, n_threads);
+  }
+  return make_tuple(mean.self(), stddev.self());
+}
+
+static object ztnorm_statistics(tp::const_ndarray rawscores_probes_vs_tmodels,
+    tp::const_ndarray cohort_mean, tp::const_ndarray cohort_std,
+    const size_t n_threads)
+{
+  const blitz::Array<double,2> C = rawscores_probes_vs_tmodels.bz<double,2>();
+  tp::ndarray mean(ca::t_float64, C.extent(1));
+  tp::ndarray stddev(ca::t_float64, C.extent(1));
+  blitz::Array<double,1> mean_ = mean.bz<double,1>();
+  blitz::Array<double,1> std_ = stddev.bz<double,1>();
+  {
+    bob::python::no_gil unlock;
+    bob::machine::ztNormStatistics(C, cohort_mean.bz<double,1>(),
+        cohort_std.bz<double,1>(), mean_, std_, n_threads);
+  }
+  return make_tuple(mean.self(), stddev.self());
+}
+
+static object ztnorm_apply(tp::const_ndarray rawscores_probes_vs_models,
+    tp::const_ndarray z_mean, tp::const_ndarray z_std,
+    tp::const_ndarray zt_mean, tp::const_ndarray zt_std,
+    const size_t n_threads)
+{
+  const blitz::Array<double,2> A = rawscores_probes_vs_models.bz<double,2>();
+  tp::ndarray ret(ca::t_float64, A.extent(0), A.extent(1));
+  blitz::Array<double,2> ret_ = ret.bz<double,2>();
+  {
+    bob::python::no_gil unlock;
+    bob::machine::ztNormApply(A, z_mean.bz<double,1>(), z_std.bz<double,1>(),
+        zt_mean.bz<double,1>(), zt_std.bz<double,1>(), ret_, n_threads);
+  }
+  return ret.self();
+}
+
+static void ztnorm_apply_inplace(tp::ndarray scores,
+    tp::const_ndarray z_mean, tp::const_ndarray z_std,
+    tp::const_ndarray zt_mean, tp::const_ndarray zt_std,
+    const size_t n_threads)
+{
+  blitz::Array<double,2> scores_ = scores.bz<double,2>();
+  bob::python::no_gil unlock;
+  bob::machine::ztNormApply(scores_, z_mean.bz<double,1>(), 
+      z_std.bz<double,1>(), zt_mean.bz<double,1>(), zt_std.bz<double,1>(),
+      scores_, n_threads);
+}
+
+static void ztnorm_apply_hdf5(tp::const_ndarray rawscores_probes_vs_models,
+    tp::const_ndarray z_mean, tp::const_ndarray z_std,
+    tp::const_ndarray zt_mean, tp::const_ndarray zt_std,
+    bob::io::HDF5File& file, const std::string& path, const size_t n_threads)
+{
+  bob::machine::ztNormApply(rawscores_probes_vs_models.bz<double,2>(),
+      z_mean.bz<double,1>(), z_std.bz<double,1>(), zt_mean.bz<double,1>(),
+      zt_std.bz<double,1>(), file, path, n_threads);
+}
+
 void bind_machine_ztnorm() 
 {
   def("ztnorm",
       ztnorm1,
-      args("rawscores_probes_vs_models",
-           "rawscores_zprobes_vs_models",
-           "rawscores_probes_vs_tmodels",
-           "rawscores_zprobes_vs_tmodels",
-           "mask_zprobes_vs_tmodels_istruetrial"),
-      "Normalise raw scores with ZT-Norm"
+      (arg("rawscores_probes_vs_models"),
+       arg("rawscores_zprobes_vs_models"),
+       arg("rawscores_probes_vs_tmodels"),
+       arg("rawscores_zprobes_vs_tmodels"),
+       arg("mask_zprobes_vs_tmodels_istruetrial"),
+       arg("n_threads")=1),
+      "Normalise raw scores with ZT-Norm. The statistics and the normalisation are split across n_threads threads."
      );
   
   def("ztnorm",
       ztnorm2,
-      args("rawscores_probes_vs_models",
-           "rawscores_zprobes_vs_models",
-           "rawscores_probes_vs_tmodels",
-           "rawscores_zprobes_vs_tmodels"),
-      "Normalise raw scores with ZT-Norm. Assume that znorm and tnorm have no common subject id."
+      (arg("rawscores_probes_vs_models"),
+       arg("rawscores_zprobes_vs_models"),
+       arg("rawscores_probes_vs_tmodels"),
+       arg("rawscores_zprobes_vs_tmodels"),
+       arg("n_threads")=1),
+      "Normalise raw scores with ZT-Norm. Assume that znorm and tnorm have no common subject id. The statistics and the normalisation are split across n_threads threads."
+     );
+
+  def("znorm_statistics", znorm_statistics,
+      (arg("rawscores_zprobes_vs_models"), arg("n_threads")=1),
+      "Computes the Z-Norm statistics (mean and standard deviation of each row of rawscores_zprobes_vs_models), and returns them as a tuple."
+     );
+
+  def("tnorm_cohort_statistics", tnorm_cohort_statistics1,
+      (arg("rawscores_zprobes_vs_tmodels"), 
+       arg("mask_zprobes_vs_tmodels_istruetrial"), arg("n_threads")=1),
+      "Computes the statistics of the T-Norm cohort (mean and standard deviation of the impostor scores of each row of rawscores_zprobes_vs_tmodels), and returns them as a tuple. These statistics only depend on the cohorts and can be reused."
+     );
+
+  def("tnorm_cohort_statistics", tnorm_cohort_statistics2,
+      (arg("rawscores_zprobes_vs_tmodels"), arg("n_threads")=1),
+      "Computes the statistics of the T-Norm cohort (mean and standard deviation of each row of rawscores_zprobes_vs_tmodels), and returns them as a tuple. Assume that znorm and tnorm have no common subject id."
+     );
+
+  def("ztnorm_statistics", ztnorm_statistics,
+      (arg("rawscores_probes_vs_tmodels"), arg("cohort_mean"), 
+       arg("cohort_std"), arg("n_threads")=1),
+      "Computes the ZT-Norm statistics (mean and standard deviation of each column of rawscores_probes_vs_tmodels, once Z-normalized with the statistics of the T-Norm cohort), and returns them as a tuple."
+     );
+
+  def("ztnorm_apply", ztnorm_apply,
+      (arg("rawscores_probes_vs_models"), arg("z_mean"), arg("z_std"),
+       arg("zt_mean"), arg("zt_std"), arg("n_threads")=1),
+      "Normalises raw scores with precomputed Z-Norm and ZT-Norm statistics, and returns the normalised scores."
+     );
+
+  def("ztnorm_apply", ztnorm_apply_hdf5,
+      (arg("rawscores_probes_vs_models"), arg("z_mean"), arg("z_std"),
+       arg("zt_mean"), arg("zt_std"), arg("file"), arg("path"), 
+       arg("n_threads")=1),
+      "Normalises raw scores with precomputed Z-Norm and ZT-Norm statistics, and appends each row of normalised scores to the dataset at the given path of the HDF5 file."
+     );
+
+  def("ztnorm_apply_inplace", ztnorm_apply_inplace,
+      (arg("scores"), arg("z_mean"), arg("z_std"), arg("zt_mean"), 
+       arg("zt_std"), arg("n_threads")=1),
+      "Normalises raw scores in place with precomputed Z-Norm and ZT-Norm statistics."
      );
 }
@@ -0,0 +1,157 @@
+/**
+ * @file math/cxx/gemm.cc
+ * @date Mon Oct 19 16:52:31 2026 +0200
+ *
+ * @brief Matrix-matrix multiplication using the BLAS
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bob/math/gemm.h"
+#include "bob/core/array_assert.h"
+#include "bob/core/array_alias.h"
+#include "bob/core/array_copy.h"
+
+namespace math = bob::math;
+namespace ca = bob::core::array;
+
+// Declaration of the external BLAS functions
+// General matrix-matrix multiplication (sgemm and dgemm)
+extern "C" void sgemm_(const char* transa, const char* transb, const int* m,
+  const int* n, const int* k, const float* alpha, const float* A,
+  const int* lda, const float* B, const int* ldb, const float* beta,
+  float* C, const int* ldc);
+extern "C" void dgemm_(const char* transa, const char* transb, const int* m,
+  const int* n, const int* k, const double* alpha, const double* A,
+  const int* lda, const double* B, const int* ldb, const double* beta,
+  double* C, const int* ldc);
+
+static inline void blas_gemm(const char* ta, const char* tb, const int* m,
+    const int* n, const int* k, const double* alpha, const double* A,
+    const int* lda, const double* B, const int* ldb, const double* beta,
+    double* C, const int* ldc) {
+  dgemm_(ta, tb, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+static inline void blas_gemm(const char* ta, const char* tb, const int* m,
+    const int* n, const int* k, const float* alpha, const float* A,
+    const int* lda, const float* B, const int* ldb, const float* beta,
+    float* C, const int* ldc) {
+  sgemm_(ta, tb, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+/**
+ * Tells if a (zero-based) 2D array can be passed directly to the BLAS: rows
+ * have to be stored contiguously and in ascending order. Rows themselves may
+ * be apart from each other (this is the case of column slices).
+ */
+template <typename T> static bool is_blas_compatible(const blitz::Array<T,2>& a) {
+  return a.isRankStoredAscending(0) && a.isRankStoredAscending(1) &&
+    (a.extent(1) <= 1 || a.stride(1) == 1) &&
+    (a.extent(0) <= 1 || a.stride(0) >= a.extent(1));
+}
+
+/**
+ * Leading dimension of a BLAS compatible array
+ */
+template <typename T> static int leading_dimension(const blitz::Array<T,2>& a) {
+  int ld = (a.extent(0) <= 1) ? a.extent(1) : a.stride(0);
+  return (ld < 1) ? 1 : ld;
+}
+
+template <typename T> static void gemm_impl(const blitz::Array<T,2>& A,
+    const blitz::Array<T,2>& B, blitz::Array<T,2>& C, bool transA,
+    bool transB, T alpha, T beta) {
+
+  const int M = C.extent(0);
+  const int N = C.extent(1);
+  const int K = transA ? A.extent(0) : A.extent(1);
+
+  if (M == 0 || N == 0) return;
+  if (K == 0) {
+    if (beta == 0) C = 0;
+    else C *= beta;
+    return;
+  }
+
+  // Makes sure the arrays can be passed to the BLAS. The arrays are aliased
+  // rather than referenced, such that the same (shared) operands can be
+  // multiplied by several threads at once.
+  blitz::Array<T,2> A_blas = ca::alias(A);
+  if (!is_blas_compatible(A)) A_blas.reference(ca::ccopy(A));
+  blitz::Array<T,2> B_blas = ca::alias(B);
+  if (!is_blas_compatible(B)) B_blas.reference(ca::ccopy(B));
+  const bool C_direct_use = is_blas_compatible(C);
+  blitz::Array<T,2> C_blas = ca::alias(C);
+  if (!C_direct_use) C_blas.reference(ca::ccopy(C));
+
+  // The BLAS uses column-major order. A row-major matrix is seen by the BLAS
+  // as its own transpose. Hence, we compute C^T = op(B)^T * op(A)^T.
+  const char ta = transA ? 'T' : 'N';
+  const char tb = transB ? 'T' : 'N';
+  const int lda = leading_dimension(A_blas);
+  const int ldb = leading_dimension(B_blas);
+  const int ldc = leading_dimension(C_blas);
+  blas_gemm(&tb, &ta, &N, &M, &K, &alpha, B_blas.data(), &ldb, A_blas.data(),
+      &lda, &beta, C_blas.data(), &ldc);
+
+  // Copy back content to C if required
+  if (!C_direct_use) C = C_blas;
+}
+
+template <typename T> static void gemm_check(const blitz::Array<T,2>& A,
+    const blitz::Array<T,2>& B, const blitz::Array<T,2>& C, bool transA,
+    bool transB) {
+  ca::assertZeroBase(A);
+  ca::assertZeroBase(B);
+  ca::assertZeroBase(C);
+  const int M = transA ? A.extent(1) : A.extent(0);
+  const int K = transA ? A.extent(0) : A.extent(1);
+  const int KB = transB ? B.extent(1) : B.extent(0);
+  const int N = transB ? B.extent(0) : B.extent(1);
+  ca::assertSameDimensionLength(K, KB);
+  ca::assertSameDimensionLength(M, C.extent(0));
+  ca::assertSameDimensionLength(N, C.extent(1));
+}
+
+void math::gemm(const blitz::Array<double,2>& A,
+    const blitz::Array<double,2>& B, blitz::Array<double,2>& C,
+    bool transA, bool transB, double alpha, double beta)
+{
+  gemm_check(A, B, C, transA, transB);
+  gemm_impl(A, B, C, transA, transB, alpha, beta);
+}
+
+void math::gemm(const blitz::Array<float,2>& A,
+    const blitz::Array<float,2>& B, blitz::Array<float,2>& C,
+    bool transA, bool transB, float alpha, float beta)
+{
+  gemm_check(A, B, C, transA, transB);
+  gemm_impl(A, B, C, transA, transB, alpha, beta);
+}
+
+void math::gemm_(const blitz::Array<double,2>& A,
+    const blitz::Array<double,2>& B, blitz::Array<double,2>& C,
+    bool transA, bool transB, double alpha, double beta)
+{
+  gemm_impl(A, B, C, transA, transB, alpha, beta);
+}
+
+void math::gemm_(const blitz::Array<float,2>& A,
+    const blitz::Array<float,2>& B, blitz::Array<float,2>& C,
+    bool transA, bool transB, float alpha, float beta)
+{
+  gemm_impl(A, B, C, transA, transB, alpha, beta);
+}
@@ -25,6 +25,7 @@
 #define BOOST_TEST_MAIN
 #include <boost/test/unit_test.hpp>
 #include "bob/math/linear.h"
+#include "bob/math/gemm.h"
 
 
 struct T {
@@ -169,4 +170,32 @@ BOOST_AUTO_TEST_CASE( test_diag )
   checkBlitzClose( Asol_diag_44, sol, eps);
 }
 
+BOOST_AUTO_TEST_CASE( test_matrix_matrix_gemm )
+{
+  blitz::Array<double,2> sol(2,3);
+  bob::math::gemm( A_24, A_43, sol);
+  checkBlitzClose( A_23, sol, eps);
+
+  // transposed variants: (A_43^T)^T * (A_24^T)^T
+  blitz::Array<double,2> A_42 = A_24.transpose(1,0);
+  blitz::Array<double,2> A_34 = A_43.transpose(1,0);
+  sol = 0.;
+  bob::math::gemm( A_42, A_34, sol, true, true);
+  checkBlitzClose( A_23, sol, eps);
+
+  // accumulation into the output
+  bob::math::gemm( A_24, A_43, sol, false, false, 1., 1.);
+  blitz::Array<double,2> A_23_twice(2,3);
+  A_23_twice = 2. * A_23;
+  checkBlitzClose( A_23_twice, sol, eps);
+
+  // single precision
+  blitz::Array<float,2> A_24f(2,4), A_43f(4,3), solf(2,3), A_23f(2,3);
+  A_24f = blitz::cast<float>(A_24);
+  A_43f = blitz::cast<float>(A_43);
+  A_23f = blitz::cast<float>(A_23);
+  bob::math::gemm( A_24f, A_43f, solf);
+  checkBlitzClose( A_23f, solf, eps);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -23,6 +23,7 @@
 
 #include "bob/sp/DCT1D.h"
 #include "bob/core/array_assert.h"
+#include "fftw_planner.h"
 #include <fftw3.h>
 
 bob::sp::DCT1DAbstract::DCT1DAbstract( const size_t length):
@@ -143,9 +144,15 @@ void bob::sp::DCT1D::operator()(const blitz::Array<double,1>& src,
   fftw_plan p;
   // FFTW_ESTIMATE -> The planner is computed quickly but may not be optimized 
   // for large arrays
-  p = fftw_plan_r2r_1d(src.extent(0), src_, dst_, FFTW_REDFT10, FFTW_ESTIMATE);
+  {
+    boost::mutex::scoped_lock lock(bob::sp::detail::fftw_planner_mutex);
+    p = fftw_plan_r2r_1d(src.extent(0), src_, dst_, FFTW_REDFT10, FFTW_ESTIMATE);
+  }
   fftw_execute(p);
-  fftw_destroy_plan(p);
+  {
+    boost::mutex::scoped_lock lock(bob::sp::detail::fftw_planner_mutex);
+    fftw_destroy_plan(p);
+  }
 
   // Normalize
   dst(0) *= m_sqrt_1byl/2.;
@@ -217,8 +224,14 @@ void bob::sp::IDCT1D::operator()(const blitz::Array<double,1>& src,
   fftw_plan p;
   // FFTW_ESTIMATE -> The planner is computed quickly but may not be optimized 
   // for large arrays
-  p = fftw_plan_r2r_1d(src.extent(0), dst_, dst_, FFTW_REDFT01, FFTW_ESTIMATE);
+  {
+    boost::mutex::scoped_lock lock(bob::sp::detail::fftw_planner_mutex);
+    p = fftw_plan_r2r_1d(src.extent(0), dst_, dst_, FFTW_REDFT01, FFTW_ESTIMATE);
+  }
   fftw_execute(p);
-  fftw_destroy_plan(p);
+  {
+    boost::mutex::scoped_lock lock(bob::sp::detail::fftw_planner_mutex);
+    fftw_destroy_plan(p);
+  }
 }
 
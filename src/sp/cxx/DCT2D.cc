@@ -23,6 +23,7 @@
 
 #include "bob/sp/DCT2D.h"
 #include "bob/core/array_assert.h"
+#include "fftw_planner.h"
 #include <fftw3.h>
 
 
@@ -150,9 +151,15 @@ void bob::sp::DCT2D::operator()(const blitz::Array<double,2>& src,
   fftw_plan p;
   // FFTW_ESTIMATE -> The planner is computed quickly but may not be optimized 
   // for large arrays
-  p = fftw_plan_r2r_2d(src.extent(0), src.extent(1), src_, dst_, FFTW_REDFT10, FFTW_REDFT10, FFTW_ESTIMATE);
+  {
+    boost::mutex::scoped_lock lock(bob::sp::detail::fftw_planner_mutex);
+    p = fftw_plan_r2r_2d(src.extent(0), src.extent(1), src_, dst_, FFTW_REDFT10, FFTW_REDFT10, FFTW_ESTIMATE);
+  }
   fftw_execute(p);
-  fftw_destroy_plan(p);
+  {
+    boost::mutex::scoped_lock lock(bob::sp::detail::fftw_planner_mutex);
+    fftw_destroy_plan(p);
+  }
 
   // Rescale the result
   for(int i=0; i<(int)m_height; ++i)
@@ -219,9 +226,15 @@ void bob::sp::IDCT2D::operator()(const blitz::Array<double,2>& src,
   fftw_plan p;
   // FFTW_ESTIMATE -> The planner is computed quickly but may not be optimized 
   // for large arrays
-  p = fftw_plan_r2r_2d(src.extent(0), src.extent(1), dst_, dst_, FFTW_REDFT01, FFTW_REDFT01, FFTW_ESTIMATE);
+  {
+    boost::mutex::scoped_lock lock(bob::sp::detail::fftw_planner_mutex);
+    p = fftw_plan_r2r_2d(src.extent(0), src.extent(1), dst_, dst_, FFTW_REDFT01, FFTW_REDFT01, FFTW_ESTIMATE);
+  }
   fftw_execute(p);
-  fftw_destroy_plan(p);
+  {
+    boost::mutex::scoped_lock lock(bob::sp::detail::fftw_planner_mutex);
+    fftw_destroy_plan(p);
+  }
   
   // Rescale the result by the size of the input 
   // (as this is not performed by FFTPACK)
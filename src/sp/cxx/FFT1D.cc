@@ -23,6 +23,7 @@
 
 #include "bob/sp/FFT1D.h"
 #include "bob/core/array_assert.h"
+#include "fftw_planner.h"
 #include <fftw3.h>
 
 
@@ -123,9 +124,15 @@ void bob::sp::FFT1D::operator()(const blitz::Array<std::complex<double>,1>& src,
   fftw_plan p;
   // FFTW_ESTIMATE -> The planner is computed quickly but may not be optimized 
   // for large arrays
-  p = fftw_plan_dft_1d(src.extent(0), src_, dst_, FFTW_FORWARD, FFTW_ESTIMATE);
+  {
+    boost::mutex::scoped_lock lock(bob::sp::detail::fftw_planner_mutex);
+    p = fftw_plan_dft_1d(src.extent(0), src_, dst_, FFTW_FORWARD, FFTW_ESTIMATE);
+  }
   fftw_execute(p);
-  fftw_destroy_plan(p);
+  {
+    boost::mutex::scoped_lock lock(bob::sp::detail::fftw_planner_mutex);
+    fftw_destroy_plan(p);
+  }
 }
 
 
@@ -179,9 +186,15 @@ void bob::sp::IFFT1D::operator()(const blitz::Array<std::complex<double>,1>& src
   fftw_plan p;
   // FFTW_ESTIMATE -> The planner is computed quickly but may not be optimized 
   // for large arrays
-  p = fftw_plan_dft_1d(src.extent(0), src_, dst_, FFTW_BACKWARD, FFTW_ESTIMATE);
+  {
+    boost::mutex::scoped_lock lock(bob::sp::detail::fftw_planner_mutex);
+    p = fftw_plan_dft_1d(src.extent(0), src_, dst_, FFTW_BACKWARD, FFTW_ESTIMATE);
+  }
   fftw_execute(p); /* repeat as needed */
-  fftw_destroy_plan(p);
+  {
+    boost::mutex::scoped_lock lock(bob::sp::detail::fftw_planner_mutex);
+    fftw_destroy_plan(p);
+  }
 
   // Rescale as FFTW is not doing it
   dst /= static_cast<double>(m_length);
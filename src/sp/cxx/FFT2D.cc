@@ -23,19 +23,139 @@
 
 #include "bob/sp/FFT2D.h"
 #include "bob/core/array_assert.h"
+#include "fftw_planner.h"
 #include <fftw3.h>
 
 
+// The FFTW planner is not thread-safe (only the execution of plans is),
+// hence, plans are created and destroyed under this lock, which is shared
+// with the other FFT and DCT classes
+boost::mutex bob::sp::detail::fftw_planner_mutex;
+
+namespace bob { namespace sp { namespace detail {
+
+  /**
+    * @brief The FFTW plans for a given 2D shape. The plans are created on
+    * first use and can be executed concurrently on new arrays.
+    */
+  class FFT2DPlans {
+    public:
+      FFT2DPlans(const size_t height, const size_t width);
+      ~FFT2DPlans();
+
+      int height() const { return m_height; }
+      int width() const { return m_width; }
+
+      // complex to complex plans (FFTW_FORWARD or FFTW_BACKWARD)
+      fftw_plan c2c(const int sign, const bool in_place);
+      fftwf_plan c2cf(const int sign, const bool in_place);
+      // real to complex plan, writing the half spectrum into an array of the full size
+      fftw_plan r2c();
+
+    private:
+      int m_height;
+      int m_width;
+      fftw_plan m_c2c[2][2];
+      fftwf_plan m_c2cf[2][2];
+      fftw_plan m_r2c;
+  };
+
+} } }
+
+bob::sp::detail::FFT2DPlans::FFT2DPlans(const size_t height, const size_t width):
+  m_height(height), m_width(width), m_r2c(0)
+{
+  for (int i = 0; i < 2; ++i)
+    for (int j = 0; j < 2; ++j){
+      m_c2c[i][j] = 0;
+      m_c2cf[i][j] = 0;
+    }
+}
+
+bob::sp::detail::FFT2DPlans::~FFT2DPlans()
+{
+  boost::mutex::scoped_lock lock(bob::sp::detail::fftw_planner_mutex);
+  for (int i = 0; i < 2; ++i)
+    for (int j = 0; j < 2; ++j){
+      if (m_c2c[i][j]) fftw_destroy_plan(m_c2c[i][j]);
+      if (m_c2cf[i][j]) fftwf_destroy_plan(m_c2cf[i][j]);
+    }
+  if (m_r2c) fftw_destroy_plan(m_r2c);
+}
+
+// Note: FFTW_ESTIMATE does not touch the arrays while planning and
+// FFTW_UNALIGNED allows to execute the plans on arrays of any alignment.
+fftw_plan bob::sp::detail::FFT2DPlans::c2c(const int sign, const bool in_place)
+{
+  boost::mutex::scoped_lock lock(bob::sp::detail::fftw_planner_mutex);
+  fftw_plan& p = m_c2c[sign == FFTW_FORWARD ? 0 : 1][in_place ? 1 : 0];
+  if (!p) {
+    const size_t n = (size_t)m_height * m_width;
+    fftw_complex* in = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * n);
+    fftw_complex* out = in_place ? in : (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * n);
+    p = fftw_plan_dft_2d(m_height, m_width, in, out, sign, FFTW_ESTIMATE | FFTW_UNALIGNED);
+    if (!in_place) fftw_free(out);
+    fftw_free(in);
+  }
+  return p;
+}
+
+fftwf_plan bob::sp::detail::FFT2DPlans::c2cf(const int sign, const bool in_place)
+{
+  boost::mutex::scoped_lock lock(bob::sp::detail::fftw_planner_mutex);
+  fftwf_plan& p = m_c2cf[sign == FFTW_FORWARD ? 0 : 1][in_place ? 1 : 0];
+  if (!p) {
+    const size_t n = (size_t)m_height * m_width;
+    fftwf_complex* in = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * n);
+    fftwf_complex* out = in_place ? in : (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * n);
+    p = fftwf_plan_dft_2d(m_height, m_width, in, out, sign, FFTW_ESTIMATE | FFTW_UNALIGNED);
+    if (!in_place) fftwf_free(out);
+    fftwf_free(in);
+  }
+  return p;
+}
+
+fftw_plan bob::sp::detail::FFT2DPlans::r2c()
+{
+  boost::mutex::scoped_lock lock(bob::sp::detail::fftw_planner_mutex);
+  if (!m_r2c) {
+    const size_t n = (size_t)m_height * m_width;
+    double* in = (double*)fftw_malloc(sizeof(double) * n);
+    fftw_complex* out = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * n);
+    // the output rows have the full width, of which only the first width/2+1 columns are written
+    int shape[2] = {m_height, m_width};
+    m_r2c = fftw_plan_many_dft_r2c(2, shape, 1, in, 0, 1, 0, out, shape, 1, 0, FFTW_ESTIMATE | FFTW_UNALIGNED);
+    fftw_free(out);
+    fftw_free(in);
+  }
+  return m_r2c;
+}
+
+/**
+  * Returns the plans of this object if they fit the given shape, or
+  * temporary plans otherwise
+  */
+static boost::shared_ptr<bob::sp::detail::FFT2DPlans> get_plans(
+  const boost::shared_ptr<bob::sp::detail::FFT2DPlans>& plans,
+  const int height, const int width)
+{
+  if (plans && plans->height() == height && plans->width() == width)
+    return plans;
+  return boost::shared_ptr<bob::sp::detail::FFT2DPlans>(new bob::sp::detail::FFT2DPlans(height, width));
+}
+
+
 bob::sp::FFT2DAbstract::FFT2DAbstract( const size_t height, const size_t width):
-  m_height(height), m_width(width)
+  m_height(height), m_width(width),
+  m_plans(new bob::sp::detail::FFT2DPlans(height, width))
 {
 }
 
 bob::sp::FFT2DAbstract::FFT2DAbstract( const bob::sp::FFT2DAbstract& other):
-  m_height(other.m_height), m_width(other.m_width)
+  m_height(other.m_height), m_width(other.m_width),
+  m_plans(new bob::sp::detail::FFT2DPlans(other.m_height, other.m_width))
 {
 }
-
 bob::sp::FFT2DAbstract::~FFT2DAbstract()
 {
 }
@@ -64,6 +184,8 @@ void bob::sp::FFT2DAbstract::reset(const size_t height, const size_t width)
   // Update the height and width
   m_height = height;
   m_width = width;
+  // The plans of the previous shape are destroyed when they are not used anymore
+  m_plans.reset(new bob::sp::detail::FFT2DPlans(height, width));
 }
 
 
@@ -113,13 +235,10 @@ void bob::sp::FFT2D::operator()(const blitz::Array<std::complex<double>,2>& src,
   // Reinterpret cast to fftw format
   fftw_complex* src_ = reinterpret_cast<fftw_complex*>(const_cast<std::complex<double>* >(src.data()));
   fftw_complex* dst_ = reinterpret_cast<fftw_complex*>(dst.data());
-  
-  fftw_plan p;
-  // FFTW_ESTIMATE -> The planner is computed quickly but may not be optimized 
-  // for large arrays
-  p = fftw_plan_dft_2d(src.extent(0), src.extent(1), src_, dst_, FFTW_FORWARD, FFTW_ESTIMATE);
-  fftw_execute(p);
-  fftw_destroy_plan(p);
+
+  // Execute the (cached) plan on the given arrays
+  boost::shared_ptr<bob::sp::detail::FFT2DPlans> plans = get_plans(m_plans, src.extent(0), src.extent(1));
+  fftw_execute_dft(plans->c2c(FFTW_FORWARD, src_ == dst_), src_, dst_);
 }
 
 
@@ -131,12 +250,66 @@ void bob::sp::FFT2D::operator()(blitz::Array<std::complex<double>,2>& src_dst)
   // Reinterpret cast to fftw format
   fftw_complex* src_dst_ = reinterpret_cast<fftw_complex*>(src_dst.data());
 
-  fftw_plan p;
-  // FFTW_ESTIMATE -> The planner is computed quickly but may not be optimized
-  // for large arrays
-  p = fftw_plan_dft_2d(src_dst.extent(0), src_dst.extent(1), src_dst_, src_dst_, FFTW_FORWARD, FFTW_ESTIMATE);
-  fftw_execute(p);
-  fftw_destroy_plan(p);
+  // Execute the (cached) plan on the given array
+  boost::shared_ptr<bob::sp::detail::FFT2DPlans> plans = get_plans(m_plans, src_dst.extent(0), src_dst.extent(1));
+  fftw_execute_dft(plans->c2c(FFTW_FORWARD, true), src_dst_, src_dst_);
+}
+
+void bob::sp::FFT2D::operator()(const blitz::Array<double,2>& src,
+  blitz::Array<std::complex<double>,2>& dst)
+{
+  // check input
+  bob::core::array::assertCZeroBaseContiguous(src);
+
+  // Check output
+  bob::core::array::assertCZeroBaseContiguous(dst);
+  bob::core::array::assertSameShape( dst, src);
+
+  const int height = src.extent(0), width = src.extent(1);
+
+  // Compute the first width/2+1 columns of the spectrum
+  boost::shared_ptr<bob::sp::detail::FFT2DPlans> plans = get_plans(m_plans, height, width);
+  fftw_execute_dft_r2c(plans->r2c(), const_cast<double*>(src.data()), reinterpret_cast<fftw_complex*>(dst.data()));
+
+  // Fill the remaining columns using the Hermitian symmetry of the spectrum
+  // of a real signal: F(u,v) = conj(F(-u,-v))
+  for (int u = 0; u < height; ++u) {
+    const int u_ = (height - u) % height;
+    for (int v = width/2 + 1; v < width; ++v)
+      dst(u,v) = std::conj(dst(u_, width - v));
+  }
+}
+
+void bob::sp::FFT2D::operator()(const blitz::Array<std::complex<float>,2>& src,
+  blitz::Array<std::complex<float>,2>& dst)
+{
+  // check input
+  bob::core::array::assertCZeroBaseContiguous(src);
+
+  // Check output
+  bob::core::array::assertCZeroBaseContiguous(dst);
+  bob::core::array::assertSameShape( dst, src);
+
+  // Reinterpret cast to fftw format
+  fftwf_complex* src_ = reinterpret_cast<fftwf_complex*>(const_cast<std::complex<float>* >(src.data()));
+  fftwf_complex* dst_ = reinterpret_cast<fftwf_complex*>(dst.data());
+
+  // Execute the (cached) plan on the given arrays
+  boost::shared_ptr<bob::sp::detail::FFT2DPlans> plans = get_plans(m_plans, src.extent(0), src.extent(1));
+  fftwf_execute_dft(plans->c2cf(FFTW_FORWARD, src_ == dst_), src_, dst_);
+}
+
+void bob::sp::FFT2D::operator()(blitz::Array<std::complex<float>,2>& src_dst)
+{
+  // check data
+  bob::core::array::assertCZeroBaseContiguous(src_dst);
+
+  // Reinterpret cast to fftw format
+  fftwf_complex* src_dst_ = reinterpret_cast<fftwf_complex*>(src_dst.data());
+
+  // Execute the (cached) plan on the given array
+  boost::shared_ptr<bob::sp::detail::FFT2DPlans> plans = get_plans(m_plans, src_dst.extent(0), src_dst.extent(1));
+  fftwf_execute_dft(plans->c2cf(FFTW_FORWARD, true), src_dst_, src_dst_);
 }
 
 
@@ -186,17 +359,14 @@ void bob::sp::IFFT2D::operator()(const blitz::Array<std::complex<double>,2>& src
   // Reinterpret cast to fftw format
   fftw_complex* src_ = reinterpret_cast<fftw_complex*>(const_cast<std::complex<double>* >(src.data()));
   fftw_complex* dst_ = reinterpret_cast<fftw_complex*>(dst.data());
-  
-  fftw_plan p;
-  // FFTW_ESTIMATE -> The planner is computed quickly but may not be optimized 
-  // for large arrays
-  p = fftw_plan_dft_2d(src.extent(0), src.extent(1), src_, dst_, FFTW_BACKWARD, FFTW_ESTIMATE);
-  fftw_execute(p);
-  fftw_destroy_plan(p);
+
+  // Execute the (cached) plan on the given arrays
+  boost::shared_ptr<bob::sp::detail::FFT2DPlans> plans = get_plans(m_plans, src.extent(0), src.extent(1));
+  fftw_execute_dft(plans->c2c(FFTW_BACKWARD, src_ == dst_), src_, dst_);
 
   // Rescale the result by the size of the input 
   // (as this is not performed by FFTW)
-  dst /= static_cast<double>(m_width*m_height);
+  dst /= static_cast<double>(src.extent(0) * src.extent(1));
 }
 
 void bob::sp::IFFT2D::operator()(blitz::Array<std::complex<double>,2>& src_dst)
@@ -207,14 +377,51 @@ void bob::sp::IFFT2D::operator()(blitz::Array<std::complex<double>,2>& src_dst)
   // Reinterpret cast to fftw format
   fftw_complex* src_dst_ = reinterpret_cast<fftw_complex*>(src_dst.data());
 
-  fftw_plan p;
-  // FFTW_ESTIMATE -> The planner is computed quickly but may not be optimized
-  // for large arrays
-  p = fftw_plan_dft_2d(src_dst.extent(0), src_dst.extent(1), src_dst_, src_dst_, FFTW_BACKWARD, FFTW_ESTIMATE);
-  fftw_execute(p);
-  fftw_destroy_plan(p);
+  // Execute the (cached) plan on the given array
+  boost::shared_ptr<bob::sp::detail::FFT2DPlans> plans = get_plans(m_plans, src_dst.extent(0), src_dst.extent(1));
+  fftw_execute_dft(plans->c2c(FFTW_BACKWARD, true), src_dst_, src_dst_);
+
+  // Rescale the result by the size of the input
+  // (as this is not performed by FFTW)
+  src_dst /= static_cast<double>(src_dst.extent(0) * src_dst.extent(1));
+}
+
+void bob::sp::IFFT2D::operator()(const blitz::Array<std::complex<float>,2>& src,
+  blitz::Array<std::complex<float>,2>& dst)
+{
+  // check input
+  bob::core::array::assertCZeroBaseContiguous(src);
+
+  // Check output
+  bob::core::array::assertCZeroBaseContiguous(dst);
+  bob::core::array::assertSameShape( dst, src);
+
+  // Reinterpret cast to fftw format
+  fftwf_complex* src_ = reinterpret_cast<fftwf_complex*>(const_cast<std::complex<float>* >(src.data()));
+  fftwf_complex* dst_ = reinterpret_cast<fftwf_complex*>(dst.data());
+
+  // Execute the (cached) plan on the given arrays
+  boost::shared_ptr<bob::sp::detail::FFT2DPlans> plans = get_plans(m_plans, src.extent(0), src.extent(1));
+  fftwf_execute_dft(plans->c2cf(FFTW_BACKWARD, src_ == dst_), src_, dst_);
+
+  // Rescale the result by the size of the input
+  // (as this is not performed by FFTW)
+  dst /= static_cast<float>(src.extent(0) * src.extent(1));
+}
+
+void bob::sp::IFFT2D::operator()(blitz::Array<std::complex<float>,2>& src_dst)
+{
+  // check data
+  bob::core::array::assertCZeroBaseContiguous(src_dst);
+
+  // Reinterpret cast to fftw format
+  fftwf_complex* src_dst_ = reinterpret_cast<fftwf_complex*>(src_dst.data());
+
+  // Execute the (cached) plan on the given array
+  boost::shared_ptr<bob::sp::detail::FFT2DPlans> plans = get_plans(m_plans, src_dst.extent(0), src_dst.extent(1));
+  fftwf_execute_dft(plans->c2cf(FFTW_BACKWARD, true), src_dst_, src_dst_);
 
   // Rescale the result by the size of the input
   // (as this is not performed by FFTW)
-  src_dst /= static_cast<double>(m_width*m_height);
+  src_dst /= static_cast<float>(src_dst.extent(0) * src_dst.extent(1));
 }
@@ -0,0 +1,38 @@
+/**
+ * @file sp/cxx/fftw_planner.h
+ * @date Mon Oct 19 17:41:06 2026 +0200
+ *
+ * @brief The lock shared by all the FFTW-based transforms of this package
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOB_SP_FFTW_PLANNER_H
+#define BOB_SP_FFTW_PLANNER_H
+
+#include <boost/thread/mutex.hpp>
+
+namespace bob { namespace sp { namespace detail {
+
+  /**
+    * The FFTW planner is not thread-safe (only the execution of plans is),
+    * hence, all the plans of the FFT and DCT classes are created and
+    * destroyed under this lock (defined in FFT2D.cc)
+    */
+  extern boost::mutex fftw_planner_mutex;
+
+}}}
+
+#endif /* BOB_SP_FFTW_PLANNER_H */
@@ -211,6 +211,49 @@ void test_fft2Dinplace( const blitz::Array<std::complex<double>,2> t, double eps
       BOOST_CHECK_SMALL( abs(t_fft(i,j)-t(i,j)), eps);
 }
 
+void test_fft2Dreal( const blitz::Array<std::complex<double>,2> t, double eps)
+{
+  // process using the complex FFT
+  blitz::Array<std::complex<double>,2> t_fft(t.extent(0), t.extent(1)),
+    t_rfft(t.extent(0), t.extent(1));
+  bob::sp::FFT2D fft(t.extent(0), t.extent(1));
+  fft(t, t_fft);
+
+  // process the real part using the real-input FFT, and compare
+  blitz::Array<double,2> t_real(t.extent(0), t.extent(1));
+  t_real = blitz::real(t);
+  fft(t_real, t_rfft);
+  for(int i=0; i < t_fft.extent(0); ++i)
+    for(int j=0; j < t_fft.extent(1); ++j)
+      BOOST_CHECK_SMALL( abs(t_rfft(i,j)-t_fft(i,j)), eps);
+}
+
+void test_fft2Dfloat( const blitz::Array<std::complex<double>,2> t, double eps)
+{
+  // process using FFT and inverse FFT in single precision
+  blitz::Array<std::complex<float>,2> t_float(t.extent(0), t.extent(1)),
+    t_fft(t.extent(0), t.extent(1)), t_fft_ifft(t.extent(0), t.extent(1));
+  for(int i=0; i < t.extent(0); ++i)
+    for(int j=0; j < t.extent(1); ++j)
+      t_float(i,j) = std::complex<float>(t(i,j).real(), t(i,j).imag());
+  bob::sp::FFT2D fft(t.extent(0), t.extent(1));
+  fft(t_float, t_fft);
+  bob::sp::IFFT2D ifft(t.extent(0), t.extent(1));
+  ifft(t_fft, t_fft_ifft);
+
+  // Compare to original
+  for(int i=0; i < t.extent(0); ++i)
+    for(int j=0; j < t.extent(1); ++j)
+      BOOST_CHECK_SMALL( abs(std::complex<double>(t_fft_ifft(i,j))-t(i,j)), eps);
+
+  // the same in place
+  fft(t_float);
+  ifft(t_float);
+  for(int i=0; i < t.extent(0); ++i)
+    for(int j=0; j < t.extent(1); ++j)
+      BOOST_CHECK_SMALL( abs(std::complex<double>(t_float(i,j))-t(i,j)), eps);
+}
+
 void test_fftshift( const blitz::Array<std::complex<double>,1> t, double eps) 
 {
   // process using fftshift
@@ -368,6 +411,8 @@ BOOST_AUTO_TEST_CASE( test_fft2D_1x1to8x8_set )
       // call the test function
       test_fft2D( t, eps);
       test_fft2Dinplace( t, eps);
+      test_fft2Dreal( t, eps);
+      test_fft2Dfloat( t, eps);
     }
 }
 
@@ -389,6 +434,8 @@ BOOST_AUTO_TEST_CASE( test_fft2D_range1x1to64x64_random )
     // call the test function
     test_fft2D( t, eps);
     test_fft2Dinplace( t, eps);
+    test_fft2Dreal( t, eps);
+    test_fft2Dfloat( t, eps);
   }
 }
 
@@ -0,0 +1,319 @@
+/**
+ * @file trainer/cxx/BlockSampler.cc
+ * @date Mon Oct 19 21:02:47 2026 +0200
+ *
+ * @brief Implements the samplers streaming blocks of samples
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bob/trainer/BlockSampler.h"
+#include "bob/trainer/Exception.h"
+#include "bob/io/Exception.h"
+#include "bob/core/array_assert.h"
+#include "bob/core/array_type.h"
+#include <boost/format.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <stdint.h>
+
+namespace ca = bob::core::array;
+
+bob::trainer::BlockSampler::BlockSampler(const size_t block_size,
+    const bool read_ahead):
+  m_block_size(block_size), m_read_ahead(read_ahead),
+  m_n_samples(0), m_n_inputs(0), m_front(0), m_back_rows(0),
+  m_back_ready(false), m_running(false)
+{
+  if (block_size == 0)
+    throw bob::trainer::BlockSamplerError("the block size of a sampler should be at least 1");
+}
+
+bob::trainer::BlockSampler::~BlockSampler()
+{
+  // A block still being read would be dropped anyway
+  if (m_running) m_thread.join();
+}
+
+void bob::trainer::BlockSampler::setShape(const size_t n_samples,
+    const size_t n_inputs) {
+  m_n_samples = n_samples;
+  m_n_inputs = n_inputs;
+  const size_t rows = std::min(m_block_size, std::max(n_samples, (size_t)1));
+  m_blocks[0].resize(rows, n_inputs);
+  m_blocks[1].resize(rows, n_inputs);
+}
+
+void bob::trainer::BlockSampler::join() {
+  if (!m_running) return;
+  m_thread.join();
+  m_running = false;
+  if (m_error) {
+    std::exception_ptr error = m_error;
+    m_error = std::exception_ptr();
+    m_back_ready = false;
+    std::rethrow_exception(error);
+  }
+}
+
+void bob::trainer::BlockSampler::fillBack() {
+  try {
+    m_back_rows = fill(m_blocks[1-m_front]);
+    m_back_ready = true;
+  }
+  catch (...) {
+    m_error = std::current_exception();
+  }
+}
+
+void bob::trainer::BlockSampler::reset() {
+  join();
+  rewind();
+  m_back_ready = false;
+}
+
+bool bob::trainer::BlockSampler::next(blitz::Array<double,2>& block) {
+  // waits for the block read in the background, or reads it now
+  join();
+  if (!m_back_ready) {
+    m_back_rows = fill(m_blocks[1-m_front]);
+    m_back_ready = true;
+  }
+  if (m_back_rows == 0) return false;
+
+  // the back block becomes the front one...
+  m_front = 1 - m_front;
+  m_back_ready = false;
+  block.reference(m_blocks[m_front](blitz::Range(0, (int)m_back_rows-1),
+        blitz::Range::all()));
+
+  // ... and the previous front block is refilled while it is processed
+  if (m_read_ahead) {
+    boost::thread t(boost::bind(&bob::trainer::BlockSampler::fillBack, this));
+    m_thread.swap(t);
+    m_running = true;
+  }
+  return true;
+}
+
+void bob::trainer::BlockSampler::sample(const size_t index,
+    blitz::Array<double,1>& x) {
+  if (index >= m_n_samples) {
+    boost::format m("the sample index %d is out of range (the sampler has %d samples)");
+    m % index % m_n_samples;
+    throw bob::trainer::BlockSamplerError(m.str());
+  }
+  ca::assertSameDimensionLength(x.extent(0), m_n_inputs);
+  // the files are not accessed concurrently
+  join();
+  readSample(index, x);
+}
+
+/**
+ * Returns the file that contains the given sample, given the index of the
+ * first sample of each file
+ */
+static size_t find_file(const std::vector<size_t>& offsets, const size_t index) {
+  return std::upper_bound(offsets.begin(), offsets.end(), index) - offsets.begin() - 1;
+}
+
+bob::trainer::HDF5BlockSampler::HDF5BlockSampler(
+    const std::vector<std::string>& filenames, const std::string& dataset,
+    const size_t block_size, const bool read_ahead):
+  BlockSampler(block_size, read_ahead),
+  m_filenames(filenames), m_dataset(dataset),
+  m_file(0), m_row(0)
+{
+  // Reads the shape and type of the dataset of each file
+  size_t n_samples = 0, n_inputs = 0;
+  m_offsets.push_back(0);
+  for (size_t f=0; f<filenames.size(); ++f) {
+    bob::io::HDF5File file(filenames[f], bob::io::HDF5File::in);
+    const bob::io::HDF5Descriptor& d = file.describe(dataset)[0];
+    const ca::ElementType type = d.type.element_type();
+    if (type != ca::t_float32 && type != ca::t_float64) {
+      boost::format m("the dataset '%s' of '%s' has type '%s', whereas float32 or float64 was expected");
+      m % dataset % filenames[f] % ca::stringize(type);
+      throw bob::trainer::BlockSamplerError(m.str());
+    }
+    const size_t dim = d.type.shape()[0];
+    if (f == 0) n_inputs = dim;
+    else if (dim != n_inputs) {
+      throw bob::io::DimensionError(dim, n_inputs);
+    }
+    m_single_precision.push_back(type == ca::t_float32);
+    n_samples += d.size;
+    m_offsets.push_back(n_samples);
+  }
+  setShape(n_samples, n_inputs);
+}
+
+bob::trainer::HDF5BlockSampler::~HDF5BlockSampler()
+{
+  try { join(); } catch (...) {}
+}
+
+void bob::trainer::HDF5BlockSampler::rewind() {
+  m_current.reset();
+  m_file = 0;
+  m_row = 0;
+}
+
+void bob::trainer::HDF5BlockSampler::readRows(bob::io::HDF5File& file,
+    const size_t f, const size_t begin, const size_t n,
+    blitz::Array<double,2> rows) {
+  const size_t n_rows = m_offsets[f+1] - m_offsets[f];
+  blitz::Range all = blitz::Range::all();
+  if (begin == 0 && n == n_rows) {
+    // the whole dataset is read at once
+    if (m_single_precision[f]) {
+      blitz::Array<float,2> tmp(rows.shape());
+      file.readArray(m_dataset, 0, tmp);
+      rows = blitz::cast<double>(tmp);
+    }
+    else file.readArray(m_dataset, 0, rows);
+  }
+  else if (m_single_precision[f]) {
+    blitz::Array<float,1> tmp(rows.extent(1));
+    for (size_t i=0; i<n; ++i) {
+      file.readArray(m_dataset, begin + i, tmp);
+      rows((int)i, all) = blitz::cast<double>(tmp);
+    }
+  }
+  else {
+    for (size_t i=0; i<n; ++i) {
+      blitz::Array<double,1> row = rows((int)i, all);
+      file.readArray(m_dataset, begin + i, row);
+    }
+  }
+}
+
+size_t bob::trainer::HDF5BlockSampler::fill(blitz::Array<double,2>& buffer) {
+  size_t rows = 0;
+  const size_t capacity = buffer.extent(0);
+  while (rows < capacity && m_file < m_filenames.size()) {
+    const size_t n_rows = m_offsets[m_file+1] - m_offsets[m_file];
+    if (m_row == n_rows) {
+      // next file
+      m_current.reset();
+      ++m_file;
+      m_row = 0;
+      continue;
+    }
+    if (!m_current)
+      m_current.reset(new bob::io::HDF5File(m_filenames[m_file], bob::io::HDF5File::in));
+    const size_t n = std::min(n_rows - m_row, capacity - rows);
+    readRows(*m_current, m_file, m_row, n,
+        buffer(blitz::Range((int)rows, (int)(rows+n)-1), blitz::Range::all()));
+    rows += n;
+    m_row += n;
+  }
+  return rows;
+}
+
+void bob::trainer::HDF5BlockSampler::readSample(const size_t index,
+    blitz::Array<double,1>& x) {
+  const size_t f = find_file(m_offsets, index);
+  bob::io::HDF5File file(m_filenames[f], bob::io::HDF5File::in);
+  blitz::Array<double,2> row(1, getNInputs());
+  readRows(file, f, index - m_offsets[f], 1, row);
+  x = row(0, blitz::Range::all());
+}
+
+bob::trainer::BinaryBlockSampler::BinaryBlockSampler(
+    const std::vector<std::string>& filenames, const size_t n_inputs,
+    const bool single_precision, const size_t block_size,
+    const bool read_ahead):
+  BlockSampler(block_size, read_ahead),
+  m_filenames(filenames), m_single_precision(single_precision),
+  m_file(0), m_row(0)
+{
+  // Reads the number of samples of each file
+  const size_t row_size = n_inputs * (single_precision ? sizeof(float) : sizeof(double));
+  if (row_size == 0)
+    throw bob::trainer::BlockSamplerError("the samples of a BinaryBlockSampler should have at least one dimension");
+  size_t n_samples = 0;
+  m_offsets.push_back(0);
+  for (size_t f=0; f<filenames.size(); ++f) {
+    boost::iostreams::mapped_file_source file(filenames[f]);
+    if (file.size() % row_size != 0) {
+      boost::format m("the size of '%s' (%d bytes) is not a multiple of the size of a sample (%d bytes)");
+      m % filenames[f] % file.size() % row_size;
+      throw bob::trainer::BlockSamplerError(m.str());
+    }
+    n_samples += file.size() / row_size;
+    m_offsets.push_back(n_samples);
+  }
+  setShape(n_samples, n_inputs);
+}
+
+bob::trainer::BinaryBlockSampler::~BinaryBlockSampler()
+{
+  try { join(); } catch (...) {}
+}
+
+void bob::trainer::BinaryBlockSampler::rewind() {
+  if (m_current.is_open()) m_current.close();
+  m_file = 0;
+  m_row = 0;
+}
+
+void bob::trainer::BinaryBlockSampler::copyRows(
+    const boost::iostreams::mapped_file_source& file, const size_t begin,
+    const size_t n, blitz::Array<double,2> rows) const {
+  const int n_inputs = getNInputs();
+  blitz::Range all = blitz::Range::all();
+  if (m_single_precision) {
+    const float* data = reinterpret_cast<const float*>(file.data()) + begin * n_inputs;
+    rows = blitz::cast<double>(blitz::Array<float,2>(const_cast<float*>(data),
+          blitz::shape((int)n, n_inputs), blitz::neverDeleteData));
+  }
+  else {
+    const double* data = reinterpret_cast<const double*>(file.data()) + begin * n_inputs;
+    rows = blitz::Array<double,2>(const_cast<double*>(data),
+        blitz::shape((int)n, n_inputs), blitz::neverDeleteData);
+  }
+}
+
+size_t bob::trainer::BinaryBlockSampler::fill(blitz::Array<double,2>& buffer) {
+  size_t rows = 0;
+  const size_t capacity = buffer.extent(0);
+  while (rows < capacity && m_file < m_filenames.size()) {
+    const size_t n_rows = m_offsets[m_file+1] - m_offsets[m_file];
+    if (m_row == n_rows) {
+      // next file
+      if (m_current.is_open()) m_current.close();
+      ++m_file;
+      m_row = 0;
+      continue;
+    }
+    if (!m_current.is_open()) m_current.open(m_filenames[m_file]);
+    const size_t n = std::min(n_rows - m_row, capacity - rows);
+    copyRows(m_current, m_row, n,
+        buffer(blitz::Range((int)rows, (int)(rows+n)-1), blitz::Range::all()));
+    rows += n;
+    m_row += n;
+  }
+  return rows;
+}
+
+void bob::trainer::BinaryBlockSampler::readSample(const size_t index,
+    blitz::Array<double,1>& x) {
+  const size_t f = find_file(m_offsets, index);
+  boost::iostreams::mapped_file_source file(m_filenames[f]);
+  blitz::Array<double,2> row(1, getNInputs());
+  copyRows(file, index - m_offsets[f], 1, row);
+  x = row(0, blitz::Range::all());
+}
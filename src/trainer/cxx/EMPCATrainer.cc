@@ -25,6 +25,7 @@
 
 #include "bob/trainer/EMPCATrainer.h"
 #include "bob/io/Exception.h"
+#include "bob/core/array_alias.h"
 #include "bob/core/array_copy.h"
 #include "bob/core/array_type.h"
 #include "bob/math/linear.h"
@@ -34,41 +35,38 @@
 
 bob::trainer::EMPCATrainer::EMPCATrainer(int dimensionality, 
     double convergence_threshold, int max_iterations, bool compute_likelihood):
-  EMTrainer<bob::machine::LinearMachine, blitz::Array<double,2> >(convergence_threshold, 
+  ParallelEMTrainer<bob::machine::LinearMachine, bob::trainer::EMPCAAccumulator>(convergence_threshold, 
   max_iterations, compute_likelihood), 
   m_dimensionality(dimensionality), m_S(0,0),
-  m_z_first_order(0,dimensionality), 
-  m_z_second_order(0,dimensionality,dimensionality),
   m_inW(dimensionality,dimensionality), m_invM(dimensionality,dimensionality),
   m_sigma2(0), m_f_log2pi(0), m_seed(-1),
-  m_cache_dxf(0,0), m_cache_d(0), m_cache_f(0),
   m_cache_dxd_1(0,0), m_cache_dxd_2(0,0),
-  m_cache_fxd_1(0,0), m_cache_fxd_2(0,0),
+  m_cache_fxd_1(0,0),
   m_cache_fxf_1(0,0), m_cache_fxf_2(0,0)
 {
+  m_acc.sumSqNorm = 0.;
+  m_acc.nSamples = 0;
 }
 
 bob::trainer::EMPCATrainer::EMPCATrainer(const bob::trainer::EMPCATrainer& other):
-  EMTrainer<bob::machine::LinearMachine, blitz::Array<double,2> >(other.m_convergence_threshold, 
-    other.m_max_iterations, other.m_compute_likelihood),
+  ParallelEMTrainer<bob::machine::LinearMachine, bob::trainer::EMPCAAccumulator>(other.m_convergence_threshold, 
+    other.m_max_iterations, other.m_compute_likelihood, other.m_n_threads),
   m_dimensionality(other.m_dimensionality), 
   m_S(bob::core::array::ccopy(other.m_S)),
-  m_z_first_order(bob::core::array::ccopy(other.m_z_first_order)), 
-  m_z_second_order(bob::core::array::ccopy(other.m_z_second_order)), 
   m_inW(bob::core::array::ccopy(other.m_inW)),
   m_invM(bob::core::array::ccopy(other.m_invM)),
   m_sigma2(other.m_sigma2), m_f_log2pi(other.m_f_log2pi),
   m_seed(other.m_seed),
-  m_cache_dxf(bob::core::array::ccopy(other.m_cache_dxf)),
-  m_cache_d(bob::core::array::ccopy(other.m_cache_d)),
-  m_cache_f(bob::core::array::ccopy(other.m_cache_f)),
   m_cache_dxd_1(bob::core::array::ccopy(other.m_cache_dxd_1)),
   m_cache_dxd_2(bob::core::array::ccopy(other.m_cache_dxd_2)),
   m_cache_fxd_1(bob::core::array::ccopy(other.m_cache_fxd_1)),
-  m_cache_fxd_2(bob::core::array::ccopy(other.m_cache_fxd_2)),
   m_cache_fxf_1(bob::core::array::ccopy(other.m_cache_fxf_1)),
   m_cache_fxf_2(bob::core::array::ccopy(other.m_cache_fxf_2))
 {
+  m_acc.tz.reference(bob::core::array::ccopy(other.m_acc.tz));
+  m_acc.zz.reference(bob::core::array::ccopy(other.m_acc.zz));
+  m_acc.sumSqNorm = other.m_acc.sumSqNorm;
+  m_acc.nSamples = other.m_acc.nSamples;
 }
 
 bob::trainer::EMPCATrainer::~EMPCATrainer() {}
@@ -81,22 +79,21 @@ bob::trainer::EMPCATrainer& bob::trainer::EMPCATrainer::operator=
     m_convergence_threshold = other.m_convergence_threshold;
     m_max_iterations = other.m_max_iterations;
     m_compute_likelihood = other.m_compute_likelihood;
+    m_n_threads = other.m_n_threads;
     m_dimensionality = other.m_dimensionality;
     m_S = bob::core::array::ccopy(other.m_S);
-    m_z_first_order = bob::core::array::ccopy(other.m_z_first_order);
-    m_z_second_order = bob::core::array::ccopy(other.m_z_second_order);
+    m_acc.tz.reference(bob::core::array::ccopy(other.m_acc.tz));
+    m_acc.zz.reference(bob::core::array::ccopy(other.m_acc.zz));
+    m_acc.sumSqNorm = other.m_acc.sumSqNorm;
+    m_acc.nSamples = other.m_acc.nSamples;
     m_inW = bob::core::array::ccopy(other.m_inW);
     m_invM = bob::core::array::ccopy(other.m_invM);
     m_sigma2 = other.m_sigma2;
     m_f_log2pi = other.m_f_log2pi;
     m_seed = other.m_seed;
-    m_cache_dxf = bob::core::array::ccopy(other.m_cache_dxf);
-    m_cache_d = bob::core::array::ccopy(other.m_cache_d);
-    m_cache_f = bob::core::array::ccopy(other.m_cache_f);
     m_cache_dxd_1 = bob::core::array::ccopy(other.m_cache_dxd_1);
     m_cache_dxd_2 = bob::core::array::ccopy(other.m_cache_dxd_2);
     m_cache_fxd_1 = bob::core::array::ccopy(other.m_cache_fxd_1);
-    m_cache_fxd_2 = bob::core::array::ccopy(other.m_cache_fxd_2);
     m_cache_fxf_1 = bob::core::array::ccopy(other.m_cache_fxf_1);
     m_cache_fxf_2 = bob::core::array::ccopy(other.m_cache_fxf_2);
   }
@@ -113,7 +110,7 @@ void bob::trainer::EMPCATrainer::initialization(bob::machine::LinearMachine& mac
   machine.resize(n_features, m_dimensionality); 
 
   // reinitializes array members
-  initMembers(ar);
+  initMembers(n_features);
 
   // computes the mean and the covariance if required
   computeMeanVariance(machine, ar);
@@ -127,37 +124,67 @@ void bob::trainer::EMPCATrainer::initialization(bob::machine::LinearMachine& mac
   computeInvM();
 }
 
+void bob::trainer::EMPCATrainer::initialization(bob::machine::LinearMachine& machine,
+  bob::trainer::BlockSampler& sampler) 
+{
+  // Gets dimension
+  size_t n_features = sampler.getNInputs();
+
+  // resizes the LinearMachine
+  machine.resize(n_features, m_dimensionality); 
+
+  // reinitializes array members
+  initMembers(n_features);
+
+  // computes the mean and the covariance if required
+  computeMeanVariance(machine, sampler);
+
+  // Random initialization of W and sigma2
+  initRandomWSigma2(machine);
+
+  // Computes the product m_inW = W^T.W
+  computeWtW(machine);
+  // Computes inverse(M), where M = Wt * W + sigma2 * Id
+  computeInvM();
+}
+
 void bob::trainer::EMPCATrainer::finalization(bob::machine::LinearMachine& machine,
   const blitz::Array<double,2>& ar) 
 {
 }
 
-void bob::trainer::EMPCATrainer::initMembers(const blitz::Array<double,2>& ar) 
+void bob::trainer::EMPCATrainer::saveState(bob::io::HDF5File& file) const
 {
-  // Gets dimensions
-  size_t n_samples = ar.extent(0);
-  size_t n_features = ar.extent(1);
+  file.set("sigma2", m_sigma2);
+}
+
+void bob::trainer::EMPCATrainer::loadState(bob::machine::LinearMachine& machine,
+  bob::io::HDF5File& file)
+{
+  m_sigma2 = file.read<double>("sigma2");
+  // W has been loaded with the machine
+  computeWtW(machine);
+  computeInvM();
+}
 
+void bob::trainer::EMPCATrainer::initMembers(const size_t n_features) 
+{
   // Covariance matrix S is only required to compute the log likelihood
   if(m_compute_likelihood)
     m_S.resize(n_features,n_features);
   else
     m_S.resize(0,0);
-  m_z_first_order.resize(n_samples, m_dimensionality);  
-  m_z_second_order.resize(n_samples, m_dimensionality, m_dimensionality);  
+  m_acc.tz.resize(n_features, m_dimensionality);
+  m_acc.zz.resize(m_dimensionality, m_dimensionality);
   m_inW.resize(m_dimensionality,m_dimensionality);
   m_invM.resize(m_dimensionality,m_dimensionality);
   m_sigma2 = 0.;
   m_f_log2pi = n_features * log(2*M_PI);
 
   // Cache
-  m_cache_dxf.resize(m_dimensionality,n_features);
-  m_cache_d.resize(m_dimensionality);
-  m_cache_f.resize(n_features);
   m_cache_dxd_1.resize(m_dimensionality,m_dimensionality);
   m_cache_dxd_2.resize(m_dimensionality,m_dimensionality);
   m_cache_fxd_1.resize(n_features,m_dimensionality);
-  m_cache_fxd_2.resize(n_features,m_dimensionality);
   // The following large cache matrices are only required to compute the 
   // log likelihood.
   if(m_compute_likelihood) 
@@ -200,6 +227,42 @@ void bob::trainer::EMPCATrainer::computeMeanVariance(bob::machine::LinearMachine
   }
 }
 
+void bob::trainer::EMPCATrainer::computeMeanVariance(bob::machine::LinearMachine& machine, 
+  bob::trainer::BlockSampler& sampler) 
+{
+  size_t n_samples = sampler.size();
+  blitz::Array<double,1> mu = machine.updateInputDivision();
+  blitz::Array<double,2> block;
+
+  // 1/ computes the mean and updates mu
+  mu = 0.;
+  sampler.reset();
+  while(sampler.next(block))
+    for (int i=0; i<block.extent(0); ++i)
+      mu += block(i,blitz::Range::all());
+  mu /= static_cast<double>(n_samples);
+
+  // 2/ computes the scatter around the mean, in a second pass
+  if(m_compute_likelihood) 
+  {
+    blitz::firstIndex i;
+    blitz::secondIndex j;
+    blitz::Array<double,2> centered;
+    m_S = 0.;
+    sampler.reset();
+    while(sampler.next(block))
+    {
+      centered.resize(block.shape());
+      centered = block(i,j) - mu(j);
+      // m_S += centered^T * centered
+      bob::math::prod(centered.transpose(1,0), centered, m_cache_fxf_1);
+      m_S += m_cache_fxf_1;
+    }
+    // divides scatter by N-1
+    m_S /= static_cast<double>(n_samples-1);
+  }
+}
+
 void bob::trainer::EMPCATrainer::initRandomWSigma2(bob::machine::LinearMachine& machine) 
 {
   // Initializes the random number generator
@@ -237,37 +300,68 @@ void bob::trainer::EMPCATrainer::computeInvM()
  
 
 
-void bob::trainer::EMPCATrainer::eStep(bob::machine::LinearMachine& machine, const blitz::Array<double,2>& ar) 
+void bob::trainer::EMPCATrainer::resetAccumulator(const bob::machine::LinearMachine& machine,
+  bob::trainer::EMPCAAccumulator& acc) const
+{
+  acc.tz.resize(machine.inputSize(), m_dimensionality);
+  acc.zz.resize(m_dimensionality, m_dimensionality);
+  acc.tz = 0.;
+  acc.zz = 0.;
+  acc.sumSqNorm = 0.;
+  acc.nSamples = 0;
+}
+
+void bob::trainer::EMPCATrainer::mergeAccumulator(bob::trainer::EMPCAAccumulator& acc,
+  const bob::trainer::EMPCAAccumulator& other) const
+{
+  acc.tz += other.tz;
+  acc.zz += other.zz;
+  acc.sumSqNorm += other.sumSqNorm;
+  acc.nSamples += other.nSamples;
+}
+
+void bob::trainer::EMPCATrainer::eStepRange(const bob::machine::LinearMachine& machine, 
+  const blitz::Array<double,2>& ar, bob::trainer::EMPCAAccumulator& acc,
+  const size_t begin, const size_t end) const
 {  
   // Gets mu and W from the machine
   const blitz::Array<double,1>& mu = machine.getInputDivision();
-  blitz::Array<double,2> W = machine.updateWeights();
-  const blitz::Array<double,2> Wt = W.transpose(1,0); // W^T
+  const blitz::Array<double,2>& W = machine.getWeights();
+  // W^T, as a view of an alias private to this shard
+  const blitz::Array<double,2> Wt = bob::core::array::alias(W).transpose(1,0);
+
+  // Buffers of this shard (this method is called concurrently)
+  const int n_features = mu.extent(0);
+  blitz::Array<double,1> f(n_features);
+  blitz::Array<double,1> z_first_order(m_dimensionality);
+  blitz::Array<double,2> z_second_order(m_dimensionality, m_dimensionality);
+  blitz::Array<double,2> fxd(n_features, m_dimensionality);
+  // dxf = inv(M) * W^T
+  blitz::Array<double,2> dxf(m_dimensionality, n_features);
+  bob::math::prod(m_invM, Wt, dxf);
 
   // Computes the statistics
   blitz::Range a = blitz::Range::all();
-  for(int i=0; i<ar.extent(0); ++i)
+  for(int i=(int)begin; i<(int)end; ++i)
   {
-    /// 1/ First order statistics: z_first_order_i = inv(M) * W^T * (t - mu)
-    // m_cache_f = t (sample) - mu (normalized sample)
-    m_cache_f = ar(i,a) - mu;
-    // m_cache_dxf = inv(M) * W^T
-    bob::math::prod(m_invM, Wt, m_cache_dxf);
-    blitz::Array<double,1> z_first_order_i = m_z_first_order(i,blitz::Range::all());
-    // z_first_order_i = inv(M) * W^T * (t - mu)
-    bob::math::prod(m_cache_dxf, m_cache_f, z_first_order_i);
+    // f = t (sample) - mu (normalized sample)
+    f = ar(i,a) - mu;
+    acc.sumSqNorm += blitz::sum(blitz::pow2(f));
+
+    /// 1/ First order statistics: z_first_order = inv(M) * W^T * (t - mu)
+    bob::math::prod(dxf, f, z_first_order);
+    // tz += (t - mu) * z_first_order^T
+    bob::math::prod(f, z_first_order, fxd); // outer product
+    acc.tz += fxd;
 
     /// 2/ Second order statistics: 
-    ///     z_second_order_i = sigma2 * inv(M) + z_first_order_i * z_first_order_i^T
-    blitz::Array<double,2> z_second_order_i = m_z_second_order(i,blitz::Range::all(),blitz::Range::all());
-    // m_cache_dxd = z_first_order_i * z_first_order_i^T
-    bob::math::prod(z_first_order_i, z_first_order_i, m_cache_dxd_1); // outer product
-    // z_second_order_i = sigma2 * inv(M)
-    z_second_order_i = m_invM;
-    z_second_order_i *= m_sigma2;
-    // z_second_order_i = sigma2 * inv(M) + z_first_order_i * z_first_order_i^T
-    z_second_order_i += m_cache_dxd_1;
+    ///     z_second_order = sigma2 * inv(M) + z_first_order * z_first_order^T
+    bob::math::prod(z_first_order, z_first_order, z_second_order); // outer product
+    acc.zz += z_second_order;
   }
+  // sigma2 * inv(M) is the same for all the samples
+  acc.zz += static_cast<double>(end - begin) * m_sigma2 * m_invM;
+  acc.nSamples += end - begin;
 }
 
 void bob::trainer::EMPCATrainer::mStep(bob::machine::LinearMachine& machine, const blitz::Array<double,2>& ar) 
@@ -283,72 +377,34 @@ void bob::trainer::EMPCATrainer::mStep(bob::machine::LinearMachine& machine, con
 }
 
 void bob::trainer::EMPCATrainer::updateW(bob::machine::LinearMachine& machine, const blitz::Array<double,2>& ar) {
-  // Get the mean mu and the projection matrix W
-  const blitz::Array<double,1>& mu = machine.getInputDivision();
+  // Get the projection matrix W
   blitz::Array<double,2>& W = machine.updateWeights();
   const blitz::Array<double,2> Wt = W.transpose(1,0); // W^T
 
   // Compute W = sum{ (t_{i} - mu) z_first_order_i^T} * inv( sum{z_second_order_i} )
-  m_cache_fxd_1 = 0.;
-  m_cache_dxd_1 = 0.;
-  blitz::Range a = blitz::Range::all();
-  for(int i=0; i<ar.extent(0); ++i)
-  {
-    // m_cache_f = t (sample) - mu (normalized sample)
-    m_cache_f = ar(i,a) - mu;
-    // first order statistics of sample i
-    blitz::Array<double,1> z_first_order_i = m_z_first_order(i,blitz::Range::all());
-    // m_cache_fxd_2 = (t - mu)*z_first_order_i
-    bob::math::prod(m_cache_f, z_first_order_i, m_cache_fxd_2);
-    m_cache_fxd_1 += m_cache_fxd_2;
-
-    // second order statistics of sample i
-    blitz::Array<double,2> z_second_order_i = m_z_second_order(i,blitz::Range::all(),blitz::Range::all());
-    m_cache_dxd_1 += z_second_order_i;
-  }
-
   // m_cache_dxd_2 = inv( sum(E(x_i.x_i^T)) )
-  bob::math::inv(m_cache_dxd_1, m_cache_dxd_2);
+  bob::math::inv(m_acc.zz, m_cache_dxd_2);
   // New estimates of W
-  bob::math::prod(m_cache_fxd_1, m_cache_dxd_2, W);
+  bob::math::prod(m_acc.tz, m_cache_dxd_2, W);
   // Updates W'*W as well
   bob::math::prod(Wt, W, m_inW);
 }
 
 void bob::trainer::EMPCATrainer::updateSigma2(bob::machine::LinearMachine& machine, const blitz::Array<double,2>& ar) {
-  // Get the mean mu and the projection matrix W
-  const blitz::Array<double,1>& mu = machine.getInputDivision();
-  blitz::Array<double,2>& W = machine.updateWeights();
-  const blitz::Array<double,2> Wt = W.transpose(1,0); // W^T
-
-  m_sigma2 = 0.;
-  blitz::Range a = blitz::Range::all();
-  for(int i=0; i<ar.extent(0); ++i)
-  {
-    // a. sigma2 += || t - mu ||^2
-    // m_cache_f = t (sample) - mu (normalized sample)
-    m_cache_f = ar(i,a) - mu;
-    // sigma2 += || t - mu ||^2
-    m_sigma2 += blitz::sum(blitz::pow2(m_cache_f));
-
-    // b. sigma2 -= 2*E(x_i)^T*W^T*(t - mu)
-    // m_cache_d = W^T*(t - mu)
-    bob::math::prod(Wt, m_cache_f, m_cache_d);
-    // first order of i
-    blitz::Array<double,1> z_first_order_i = m_z_first_order(i,blitz::Range::all());
-    // sigma2 -= 2*E(x_i)^T*W^T*(t - mu)
-    m_sigma2 -= 2*bob::math::dot(z_first_order_i, m_cache_d);
-
-    // c. sigma2 += trace( E(x_i.x_i^T)*W^T*W )
-    // second order of i
-    blitz::Array<double,2> z_second_order_i = m_z_second_order(i,blitz::Range::all(),blitz::Range::all());
-    // m_cache_dxd_1 = E(x_i.x_i^T)*W^T*W
-    bob::math::prod(z_second_order_i, m_inW, m_cache_dxd_1);
-    // sigma2 += trace( E(x_i.x_i^T)*W^T*W )
-    m_sigma2 += bob::math::trace(m_cache_dxd_1);
-  }
+  // Get the projection matrix W
+  const blitz::Array<double,2>& W = machine.getWeights();
+
+  // a. sigma2 = sum{ || t_i - mu ||^2 }
+  m_sigma2 = m_acc.sumSqNorm;
+  // b. sigma2 -= 2 * sum{ E(x_i)^T*W^T*(t_i - mu) } 
+  //            = 2 * sum_jk{ W(j,k) * sum_i{ (t_i - mu)_j E(x_i)_k } }
+  m_sigma2 -= 2 * blitz::sum(W * m_acc.tz);
+  // c. sigma2 += sum{ trace( E(x_i.x_i^T)*W^T*W ) }
+  //            = trace( sum{ E(x_i.x_i^T) }*W^T*W )
+  bob::math::prod(m_acc.zz, m_inW, m_cache_dxd_1);
+  m_sigma2 += bob::math::trace(m_cache_dxd_1);
   // Normalization factor
-  m_sigma2 /= (static_cast<double>(ar.extent(0)) * mu.extent(0));
+  m_sigma2 /= (static_cast<double>(m_acc.nSamples) * W.extent(0));
 }
 
 double bob::trainer::EMPCATrainer::computeLikelihood(bob::machine::LinearMachine& machine)
@@ -401,7 +457,7 @@ double bob::trainer::EMPCATrainer::computeLikelihood(bob::machine::LinearMachine
 
   // 4/ Use previous values to compute the log likelihood:
   // Log likelihood =  - N/2*{ d*ln(2*PI) + ln |detC| + tr(C^-1.S) }
-  double llh = - static_cast<double>(m_z_first_order.extent(0)) / 2. * 
+  double llh = - static_cast<double>(m_acc.nSamples) / 2. * 
     ( m_f_log2pi + log(fabs(detC)) + bob::math::trace(m_cache_fxf_2) ); 
 
   return llh;
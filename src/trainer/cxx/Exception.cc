@@ -129,6 +129,25 @@ const char* bob::trainer::LLRPriorNotInRange::what() const throw() {
   }
 }
 
+bob::trainer::LLROptimizationFailure::LLROptimizationFailure(const int code) throw() :
+  m_code(code)
+{
+}
+
+bob::trainer::LLROptimizationFailure::~LLROptimizationFailure() throw() { }
+
+const char* bob::trainer::LLROptimizationFailure::what() const throw() {
+  try {
+    boost::format message("The L-BFGS optimization of the Linear Logistic Regression failed (code '%d').");
+    message % m_code;
+    m_message = message.str();
+    return m_message.c_str();
+  } catch (...) {
+    static const char* emergency = "bob::trainer::LLROptimizationFailure: cannot format, exception raised";
+    return emergency;
+  }
+}
+
 bob::trainer::KMeansInitializationFailure::KMeansInitializationFailure() throw() {
 }
 
@@ -139,3 +158,15 @@ const char* bob::trainer::KMeansInitializationFailure::what() const throw() {
  static const char* what_string = "bob::trainer::KMeansInitializationFailure: this usually happens when many samples are identical, as the initial means should all be different.";
  return what_string;
 }
+
+bob::trainer::BlockSamplerError::BlockSamplerError(const std::string& reason) throw() :
+  m_reason(reason)
+{
+}
+
+bob::trainer::BlockSamplerError::~BlockSamplerError() throw() {
+}
+
+const char* bob::trainer::BlockSamplerError::what() const throw() {
+  return m_reason.c_str();
+}
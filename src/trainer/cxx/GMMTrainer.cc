@@ -26,7 +26,7 @@ namespace io = bob::io;
 
 train::GMMTrainer::GMMTrainer(bool update_means, bool update_variances, bool update_weights, 
     double mean_var_update_responsibilities_threshold):
-  EMTrainer<mach::GMMMachine, blitz::Array<double,2> >(), update_means(update_means), update_variances(update_variances), 
+  ParallelEMTrainer<mach::GMMMachine, mach::GMMStats>(), update_means(update_means), update_variances(update_variances), 
   update_weights(update_weights), m_mean_var_update_responsibilities_threshold(mean_var_update_responsibilities_threshold) {
 
 }
@@ -40,10 +40,22 @@ void train::GMMTrainer::initialization(mach::GMMMachine& gmm, const blitz::Array
   m_ss.resize(gmm.getNGaussians(),gmm.getNInputs());
 }
 
-void train::GMMTrainer::eStep(mach::GMMMachine& gmm, const blitz::Array<double,2>& data) {
-  m_ss.init();
-  // Calculate the sufficient statistics and save in m_ss
-  gmm.accStatistics(data, m_ss);
+void train::GMMTrainer::resetAccumulator(const mach::GMMMachine& gmm, 
+  mach::GMMStats& stats) const {
+  stats.resize(gmm.getNGaussians(), gmm.getNInputs());
+  stats.init();
+}
+
+void train::GMMTrainer::mergeAccumulator(mach::GMMStats& stats, 
+  const mach::GMMStats& other) const {
+  stats += other;
+}
+
+void train::GMMTrainer::eStepRange(const mach::GMMMachine& gmm, 
+  const blitz::Array<double,2>& data, mach::GMMStats& stats,
+  const size_t begin, const size_t end) const {
+  // Calculate the sufficient statistics of the shard
+  gmm.accStatistics(data(blitz::Range((int)begin, (int)end-1), blitz::Range::all()), stats);
 }
 
 double train::GMMTrainer::computeLikelihood(mach::GMMMachine& gmm) {
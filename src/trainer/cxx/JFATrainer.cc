@@ -21,12 +21,18 @@
  */
 
 #include "bob/trainer/JFATrainer.h"
+#include "bob/trainer/Exception.h"
 #include "bob/math/inv.h"
 #include "bob/math/linear.h"
+#include "bob/core/array_alias.h"
+#include "bob/core/array_assert.h"
 #include "bob/core/array_check.h"
 #include "bob/core/Exception.h"
 #include "bob/core/repmat.h"
+#include "bob/core/parallel.h"
+#include "bob/io/Exception.h"
 #include <algorithm>
+#include <set>
 #include <random/normal.h>
 
 
@@ -74,12 +80,328 @@ void bob::trainer::jfa::updateEigen(const blitz::Array<double,3> &A,
   }
 }
 
+namespace {
+
+  /**
+   * Determines the speakers of spk_ids, in order of appearance, as well as
+   * the first and last training segments of each of them. The segments of 
+   * a speaker are assumed to be consecutive: if a speaker appears again 
+   * later on, only its first block of segments is used, once.
+   */
+  void speakerSegments(const blitz::Array<uint32_t,1>& spk_ids, 
+    std::vector<uint32_t>& ids, std::vector<int>& starts, 
+    std::vector<int>& ends)
+  {
+    std::set<uint32_t> seen;
+    const int T = spk_ids.extent(0);
+    int start = 0;
+    while(start < T)
+    {
+      const uint32_t cur_elem = spk_ids(start);
+      int end = start;
+      while(end+1 < T && spk_ids(end+1) == cur_elem)
+        ++end;
+      if(seen.insert(cur_elem).second)
+      {
+        ids.push_back(cur_elem);
+        starts.push_back(start);
+        ends.push_back(end);
+      }
+      start = end+1;
+    }
+  }
+
+  /**
+   * Estimates the channel factors x of the speakers [begin, end)
+   */
+  struct estimateXRange {
+    const blitz::Array<double,2> &F, &N;
+    const blitz::Array<double,1> &m, &E, &d;
+    const blitz::Array<double,2> &v, &u, &z, &y;
+    blitz::Array<double,2> &x;
+    const blitz::Array<double,3> &uEuT;
+    const std::vector<uint32_t> &ids;
+    const std::vector<int> &starts, &ends;
+
+    estimateXRange(const blitz::Array<double,2> &F_, const blitz::Array<double,2> &N_,
+      const blitz::Array<double,1> &m_, const blitz::Array<double,1> &E_,
+      const blitz::Array<double,1> &d_, const blitz::Array<double,2> &v_,
+      const blitz::Array<double,2> &u_, const blitz::Array<double,2> &z_,
+      const blitz::Array<double,2> &y_, blitz::Array<double,2> &x_,
+      const blitz::Array<double,3> &uEuT_, const std::vector<uint32_t> &ids_,
+      const std::vector<int> &starts_, const std::vector<int> &ends_):
+      F(F_), N(N_), m(m_), E(E_), d(d_), v(v_), u(u_), z(z_), y(y_), x(x_),
+      uEuT(uEuT_), ids(ids_), starts(starts_), ends(ends_) {}
+
+    void operator()(size_t begin, size_t end) const
+    {
+      // the rows are views of aliases private to this thread
+      const blitz::Array<double,2> F_ = core::array::alias(F);
+      const blitz::Array<double,2> N_ = core::array::alias(N);
+      const blitz::Array<double,2> u_ = core::array::alias(u);
+      const blitz::Array<double,2> z_ = core::array::alias(z);
+      const blitz::Array<double,2> y_ = core::array::alias(y);
+      blitz::Array<double,2> x_ = core::array::alias(x);
+      const blitz::Array<double,3> uEuT_ = core::array::alias(uEuT);
+
+      int C = N.extent(1);
+      int CD = F.extent(1);
+      int ru = u.extent(0);
+
+      // Allocate working arrays
+      blitz::Array<double,1> spk_shift(CD);
+      blitz::Array<double,1> tmp2(CD);
+      blitz::Array<double,1> tmp3(ru);
+      blitz::Array<double,1> Fh(CD);
+      blitz::Array<double,2> L(ru, ru);
+      blitz::Array<double,2> Linv(ru, ru);
+
+      for(size_t s=begin; s<end; ++s)
+      {
+        // a/ Speaker sessions
+        uint32_t cur_elem = ids[s];
+
+        // b/ Compute speaker shift
+        spk_shift = m;
+        blitz::Array<double,1> y_ii = y_(cur_elem,blitz::Range::all());
+        math::prod(y_ii, v, tmp2);
+        spk_shift += tmp2;
+        blitz::Array<double,1> z_ii = z_(cur_elem,blitz::Range::all());
+        spk_shift += z_ii * d;
+       
+        // c/ Loop over speaker session
+        for(int jj=starts[s]; jj<=ends[s]; ++jj)
+        {
+          blitz::Array<double,1> Nhint = N_(jj, blitz::Range::all());
+          core::repelem(Nhint, tmp2);  
+          Fh = F_(jj, blitz::Range::all()) - tmp2 * spk_shift;
+          
+          // L=Identity
+          L = 0.;
+          for(int k=0; k<ru; ++k)
+            L(k,k) = 1.;
+        
+          for(int c=0; c<C; ++c)
+          {
+            blitz::Array<double,2> uEuT_c = uEuT_(c, blitz::Range::all(), blitz::Range::all());
+            L += uEuT_c * N_(jj,c);
+          }
+
+          // inverse L
+          math::inv(L, Linv);
+
+          // update x
+          blitz::Array<double,1> x_jj = x_(jj,blitz::Range::all());
+          Fh /= E;
+          blitz::Array<double,2> uu = u_(blitz::Range::all(), blitz::Range::all());
+          blitz::Array<double,2> u_t = uu.transpose(1,0);
+          math::prod(Fh, u_t, tmp3);
+          math::prod(tmp3, Linv, x_jj);
+        }
+      }
+    }
+  };
+
+  /**
+   * Estimates the speaker factors y of the speakers [begin, end)
+   */
+  struct estimateYRange {
+    const blitz::Array<double,2> &F, &N;
+    const blitz::Array<double,1> &m, &E, &d;
+    const blitz::Array<double,2> &v, &u, &z;
+    blitz::Array<double,2> &y;
+    const blitz::Array<double,2> &x;
+    const blitz::Array<double,3> &vEvT;
+    const std::vector<uint32_t> &ids;
+    const std::vector<int> &starts, &ends;
+
+    estimateYRange(const blitz::Array<double,2> &F_, const blitz::Array<double,2> &N_,
+      const blitz::Array<double,1> &m_, const blitz::Array<double,1> &E_,
+      const blitz::Array<double,1> &d_, const blitz::Array<double,2> &v_,
+      const blitz::Array<double,2> &u_, const blitz::Array<double,2> &z_,
+      blitz::Array<double,2> &y_, const blitz::Array<double,2> &x_,
+      const blitz::Array<double,3> &vEvT_, const std::vector<uint32_t> &ids_,
+      const std::vector<int> &starts_, const std::vector<int> &ends_):
+      F(F_), N(N_), m(m_), E(E_), d(d_), v(v_), u(u_), z(z_), y(y_), x(x_),
+      vEvT(vEvT_), ids(ids_), starts(starts_), ends(ends_) {}
+
+    void operator()(size_t begin, size_t end) const
+    {
+      // the rows are views of aliases private to this thread
+      const blitz::Array<double,2> F_ = core::array::alias(F);
+      const blitz::Array<double,2> N_ = core::array::alias(N);
+      const blitz::Array<double,2> v_ = core::array::alias(v);
+      const blitz::Array<double,2> z_ = core::array::alias(z);
+      blitz::Array<double,2> y_ = core::array::alias(y);
+      const blitz::Array<double,2> x_ = core::array::alias(x);
+      const blitz::Array<double,3> vEvT_ = core::array::alias(vEvT);
+
+      int C = N.extent(1);
+      int CD = F.extent(1);
+      int rv = v.extent(0);
+
+      // Allocate working arrays
+      blitz::Array<double,1> Fs(CD);
+      blitz::Array<double,1> Nss(C);
+      blitz::Array<double,1> Ns(CD);
+      blitz::Array<double,1> tmp2(CD);
+      blitz::Array<double,2> L(rv, rv);
+      blitz::Array<double,2> Linv(rv, rv);
+      blitz::Array<double,1> tmp3(rv);
+      blitz::Array<double,1> tmp4(CD);
+
+      for(size_t s=begin; s<end; ++s)
+      {
+        // Speaker sessions
+        uint32_t cur_elem = ids[s];
+        int cur_start_ind = starts[s];
+        int cur_end_ind = ends[s];
+
+        // Extract speaker sessions
+        blitz::Array<double,2> Fs_sessions = F_(blitz::Range(cur_start_ind,cur_end_ind), blitz::Range::all());
+        blitz::Array<double,2> Nss_sessions = N_(blitz::Range(cur_start_ind,cur_end_ind), blitz::Range::all());
+
+        blitz::firstIndex i;
+        blitz::secondIndex j;
+        Fs = blitz::sum(Fs_sessions(j,i), j);
+        Nss = blitz::sum(Nss_sessions(j,i), j);
+        core::repelem(Nss, Ns);
+
+        blitz::Array<double,1> z_ii = z_(cur_elem,blitz::Range::all());
+        Fs -= ((m + z_ii * d) * Ns);
+
+        // Loop over speaker session
+        for(int jj=cur_start_ind; jj<=cur_end_ind; ++jj)
+        {
+          // update x
+          blitz::Array<double,1> x_jj = x_(jj,blitz::Range::all());
+          math::prod(x_jj, u, tmp2);
+          blitz::Array<double,1> N_jj = N_(jj,blitz::Range::all());
+          core::repelem(N_jj, tmp4);
+          Fs -= tmp2 * tmp4;
+        }
+
+        // L=Identity
+        L = 0.;
+        for(int k=0; k<rv; ++k)
+          L(k,k) = 1.;
+
+        for(int c=0; c<C; ++c)
+        {
+          blitz::Array<double,2> vEvT_c = vEvT_(c, blitz::Range::all(), blitz::Range::all());
+          L += vEvT_c * Nss(c);
+        }
+
+        // inverse L
+        math::inv(L, Linv);
+
+        // update y
+        blitz::Array<double,1> y_ii = y_(cur_elem,blitz::Range::all());
+        Fs /= E;
+        blitz::Array<double,2> vv = v_(blitz::Range::all(), blitz::Range::all());
+        blitz::Array<double,2> v_t = vv.transpose(1,0);
+        math::prod(Fs, v_t, tmp3);
+        math::prod(tmp3, Linv, y_ii);
+      }
+    }
+  };
+
+  /**
+   * Estimates the speaker factors z of the speakers [begin, end)
+   */
+  struct estimateZRange {
+    const blitz::Array<double,2> &F, &N;
+    const blitz::Array<double,1> &m, &E, &d;
+    const blitz::Array<double,2> &v, &u;
+    blitz::Array<double,2> &z;
+    const blitz::Array<double,2> &y, &x;
+    const std::vector<uint32_t> &ids;
+    const std::vector<int> &starts, &ends;
+
+    estimateZRange(const blitz::Array<double,2> &F_, const blitz::Array<double,2> &N_,
+      const blitz::Array<double,1> &m_, const blitz::Array<double,1> &E_,
+      const blitz::Array<double,1> &d_, const blitz::Array<double,2> &v_,
+      const blitz::Array<double,2> &u_, blitz::Array<double,2> &z_,
+      const blitz::Array<double,2> &y_, const blitz::Array<double,2> &x_,
+      const std::vector<uint32_t> &ids_, const std::vector<int> &starts_, 
+      const std::vector<int> &ends_):
+      F(F_), N(N_), m(m_), E(E_), d(d_), v(v_), u(u_), z(z_), y(y_), x(x_),
+      ids(ids_), starts(starts_), ends(ends_) {}
+
+    void operator()(size_t begin, size_t end) const
+    {
+      // the rows are views of aliases private to this thread
+      const blitz::Array<double,2> F_ = core::array::alias(F);
+      const blitz::Array<double,2> N_ = core::array::alias(N);
+      blitz::Array<double,2> z_ = core::array::alias(z);
+      const blitz::Array<double,2> y_ = core::array::alias(y);
+      const blitz::Array<double,2> x_ = core::array::alias(x);
+
+      int C = N.extent(1);
+      int CD = F.extent(1);
+
+      // Allocate arrays
+      blitz::Array<double,1> shift(CD);
+      blitz::Array<double,1> tmp1(CD);
+      blitz::Array<double,1> Fs(CD);
+      blitz::Array<double,1> Nss(C);
+      blitz::Array<double,1> Ns(CD);
+      blitz::Array<double,1> L(CD);
+
+      for(size_t s=begin; s<end; ++s)
+      {
+        // Speaker sessions
+        uint32_t cur_elem = ids[s];
+        int cur_start_ind = starts[s];
+        int cur_end_ind = ends[s];
+
+        // Extract speaker sessions
+        blitz::Array<double,2> Fs_sessions = F_(blitz::Range(cur_start_ind,cur_end_ind), blitz::Range::all());
+        blitz::Array<double,2> Nss_sessions = N_(blitz::Range(cur_start_ind,cur_end_ind), blitz::Range::all());
+
+        blitz::firstIndex i;
+        blitz::secondIndex j;
+        Fs = blitz::sum(Fs_sessions(j,i), j);
+        Nss = blitz::sum(Nss_sessions(j,i), j);
+        core::repelem(Nss, Ns);
+
+        // Compute shift
+        shift = m;
+        blitz::Array<double,1> y_ii = y_(cur_elem,blitz::Range::all());
+        math::prod(y_ii, v, tmp1);
+        shift += tmp1;
+        Fs -= shift * Ns;
+
+        // Loop over speaker session
+        for(int jj=cur_start_ind; jj<=cur_end_ind; ++jj)
+        {
+          // update x
+          blitz::Array<double,1> x_jj = x_(jj,blitz::Range::all());
+          math::prod(x_jj, u, shift);
+          blitz::Array<double,1> N_jj = N_(jj,blitz::Range::all());
+          core::repelem(N_jj, tmp1);
+          Fs -= shift * tmp1;
+        }
+
+        L = 1.;
+        L += Ns / E * blitz::pow2(d);
+
+        // Update z   
+        // z(ii,:) = Fs ./ E .* d ./L;
+        blitz::Array<double,1> z_ii = z_(cur_elem,blitz::Range::all());
+        z_ii = Fs / E * d / L;
+      }
+    }
+  };
+
+}
+
 void bob::trainer::jfa::estimateXandU(const blitz::Array<double,2> &F, const blitz::Array<double,2> &N,
   const blitz::Array<double,1> &m, const blitz::Array<double,1> &E,
   const blitz::Array<double,1> &d, const blitz::Array<double,2> &v,
   const blitz::Array<double,2> &u, const blitz::Array<double,2> &z,
   const blitz::Array<double,2> &y, blitz::Array<double,2> &x,
-  const blitz::Array<uint32_t,1> &spk_ids)
+  const blitz::Array<uint32_t,1> &spk_ids, const size_t n_threads)
 {
   // 1/ Check inputs
   // Number of Gaussians
@@ -133,92 +455,15 @@ void bob::trainer::jfa::estimateXandU(const blitz::Array<double,2> &F, const bli
     math::prod(tmp1, u_transposed, uEuT_c);
   }
 
-  // 3/ Determine the vector of speaker ids
+  // 3/ Determine the speakers and their sessions
   //    Assume that samples from the same speaker are consecutive
   std::vector<uint32_t> ids;
-  uint32_t last_elem=0;
-  for(int ind=0; ind<T; ++ind)
-  {
-    if(ids.empty())
-    {
-      ids.push_back(spk_ids(ind));
-      last_elem=spk_ids(ind);
-    }
-    else if(last_elem!=spk_ids(ind))
-    {
-      ids.push_back(spk_ids(ind));
-      last_elem=spk_ids(ind);
-    }
-  }
-
-  // 4/ Main computation
-  // Allocate working arrays
-  blitz::Array<double,1> spk_shift(CD);
-  blitz::Array<double,1> tmp2(CD);
-  blitz::Array<double,1> tmp3(ru);
-  blitz::Array<double,1> Fh(CD);
-  blitz::Array<double,2> L(ru, ru);
-  blitz::Array<double,2> Linv(ru, ru);
-
-  std::vector<uint32_t>::iterator it;
-  int cur_start_ind=0;
-  int cur_end_ind;
-  for(it=ids.begin(); it<ids.end(); ++it)
-  {
-    // a/ Determine speaker sessions
-    uint32_t cur_elem=*it;
-    cur_start_ind = 0;
-    while(spk_ids(cur_start_ind) != cur_elem)
-      ++cur_start_ind;
-    cur_end_ind = cur_start_ind;
-    for(int ind=cur_start_ind+1; ind<T; ++ind)
-    {
-      cur_end_ind = ind;
-      if(spk_ids(ind)!=cur_elem)
-      {
-        cur_end_ind = ind-1;
-        break;
-      }
-    }
-
-    // b/ Compute speaker shift
-    spk_shift = m;
-    blitz::Array<double,1> y_ii = y(cur_elem,blitz::Range::all());
-    math::prod(y_ii, v, tmp2);
-    spk_shift += tmp2;
-    blitz::Array<double,1> z_ii = z(cur_elem,blitz::Range::all());
-    spk_shift += z_ii * d;
-   
-    // c/ Loop over speaker session
-    for(int jj=cur_start_ind; jj<=cur_end_ind; ++jj)
-    {
-      blitz::Array<double,1> Nhint = N(jj, blitz::Range::all());
-      core::repelem(Nhint, tmp2);  
-      Fh = F(jj, blitz::Range::all()) - tmp2 * spk_shift;
-      
-      // L=Identity
-      L = 0.;
-      for(int k=0; k<ru; ++k)
-        L(k,k) = 1.;
-    
-      for(int c=0; c<C; ++c)
-      {
-        blitz::Array<double,2> uEuT_c = uEuT(c, blitz::Range::all(), blitz::Range::all());
-        L += uEuT_c * N(jj,c);
-      }
-
-      // inverse L
-      math::inv(L, Linv);
+  std::vector<int> starts, ends;
+  speakerSegments(spk_ids, ids, starts, ends);
 
-      // update x
-      blitz::Array<double,1> x_jj = x(jj,blitz::Range::all());
-      Fh /= E;
-      blitz::Array<double,2> uu = u(blitz::Range::all(), blitz::Range::all());
-      blitz::Array<double,2> u_t = uu.transpose(1,0);
-      math::prod(Fh, u_t, tmp3);
-      math::prod(tmp3, Linv, x_jj);
-    }
-  }
+  // 4/ Main computation, the speakers being split across the threads
+  core::thread_loop(estimateXRange(F, N, m, E, d, v, u, z, y, x, uEuT, ids,
+      starts, ends), ids.size(), n_threads);
 }
 
 
@@ -227,7 +472,7 @@ void bob::trainer::jfa::estimateYandV(const blitz::Array<double,2> &F, const bli
   const blitz::Array<double,1> &d, const blitz::Array<double,2> &v, 
   const blitz::Array<double,2> &u, const blitz::Array<double,2> &z, 
   blitz::Array<double,2> &y, const blitz::Array<double,2> &x, 
-  const blitz::Array<uint32_t,1> &spk_ids)
+  const blitz::Array<uint32_t,1> &spk_ids, const size_t n_threads)
 {
   // 1/ Check inputs
   // Number of Gaussians
@@ -277,100 +522,14 @@ void bob::trainer::jfa::estimateYandV(const blitz::Array<double,2> &F, const bli
     math::prod(tmp1, v_transposed, vEvT_c);
   }
 
-  // Determine a vector of speaker ids
+  // Determine the speakers and their sessions
   std::vector<uint32_t> ids;
-  uint32_t last_elem=0;
-  for(int ind=0; ind<spk_ids.extent(0); ++ind)
-  {
-    if(ids.empty())
-    {
-      ids.push_back(spk_ids(ind));
-      last_elem=spk_ids(ind);
-    }
-    else if(last_elem!=spk_ids(ind))
-    {
-      ids.push_back(spk_ids(ind));
-      last_elem=spk_ids(ind);
-    }
-  }
-
-  // Allocate working arrays
-  blitz::Array<double,1> Fs(CD);
-  blitz::Array<double,1> Nss(C);
-  blitz::Array<double,1> Ns(CD);
-  blitz::Array<double,1> tmp2(CD);
-  blitz::Array<double,2> L(rv, rv);
-  blitz::Array<double,2> Linv(rv, rv);
-  blitz::Array<double,1> tmp3(rv);
-  blitz::Array<double,1> tmp4(CD);
-
-  std::vector<uint32_t>::iterator it;
-  int cur_start_ind=0;
-  int cur_end_ind;
-  for(it=ids.begin(); it<ids.end(); ++it)
-  {
-    // Determine speaker sessions
-    uint32_t cur_elem=*it;
-    cur_start_ind=0;
-    while(spk_ids(cur_start_ind) != cur_elem)
-      ++cur_start_ind;
-    cur_end_ind = cur_start_ind;
-    for(int ind=cur_start_ind+1; ind<spk_ids.extent(0); ++ind)
-    {
-      cur_end_ind = ind;
-      if(spk_ids(ind)!=cur_elem)
-      {
-        cur_end_ind = ind-1;
-        break;
-      }
-    }
-
-    // Extract speaker sessions
-    blitz::Array<double,2> Fs_sessions = F(blitz::Range(cur_start_ind,cur_end_ind), blitz::Range::all());
-    blitz::Array<double,2> Nss_sessions = N(blitz::Range(cur_start_ind,cur_end_ind), blitz::Range::all());
-
-    blitz::firstIndex i;
-    blitz::secondIndex j;
-    Fs = blitz::sum(Fs_sessions(j,i), j);
-    Nss = blitz::sum(Nss_sessions(j,i), j);
-    core::repelem(Nss, Ns);
-
-    blitz::Array<double,1> z_ii = z(cur_elem,blitz::Range::all());
-    Fs -= ((m + z_ii * d) * Ns);
-
-    // Loop over speaker session
-    for(int jj=cur_start_ind; jj<=cur_end_ind; ++jj)
-    {
-      // update x
-      blitz::Array<double,1> x_jj = x(jj,blitz::Range::all());
-      math::prod(x_jj, u, tmp2);
-      blitz::Array<double,1> N_jj = N(jj,blitz::Range::all());
-      core::repelem(N_jj, tmp4);
-      Fs -= tmp2 * tmp4;
-    }
-
-    // L=Identity
-    L = 0.;
-    for(int k=0; k<rv; ++k)
-      L(k,k) = 1.;
+  std::vector<int> starts, ends;
+  speakerSegments(spk_ids, ids, starts, ends);
 
-    for(int c=0; c<C; ++c)
-    {
-      blitz::Array<double,2> vEvT_c = vEvT(c, blitz::Range::all(), blitz::Range::all());
-      L += vEvT_c * Nss(c);
-    }
-
-    // inverse L
-    math::inv(L, Linv);
-
-    // update y
-    blitz::Array<double,1> y_ii = y(cur_elem,blitz::Range::all());
-    Fs /= E;
-    blitz::Array<double,2> vv = v(blitz::Range::all(), blitz::Range::all());
-    blitz::Array<double,2> v_t = vv.transpose(1,0);
-    math::prod(Fs, v_t, tmp3);
-    math::prod(tmp3, Linv, y_ii);
-  }    
+  // The speakers are split across the threads
+  core::thread_loop(estimateYRange(F, N, m, E, d, v, u, z, y, x, vEvT, ids,
+      starts, ends), ids.size(), n_threads);
 }
 
 
@@ -381,7 +540,7 @@ void bob::trainer::jfa::estimateZandD(const blitz::Array<double,2> &F, const bli
   const blitz::Array<double,1> &d, const blitz::Array<double,2> &v, 
   const blitz::Array<double,2> &u, blitz::Array<double,2> &z, 
   const blitz::Array<double,2> &y, const blitz::Array<double,2> &x, 
-  const blitz::Array<uint32_t,1> &spk_ids)
+  const blitz::Array<uint32_t,1> &spk_ids, const size_t n_threads)
 {
   // 1/ Check inputs
   // Number of Gaussians
@@ -414,88 +573,14 @@ void bob::trainer::jfa::estimateZandD(const blitz::Array<double,2> &F, const bli
   if(y.extent(0) != Nspk)
     throw core::Exception();
 
-  // Determine a vector of speaker ids
+  // Determine the speakers and their sessions
   std::vector<uint32_t> ids;
-  uint32_t last_elem=0;
-  for(int ind=0; ind<T; ++ind)
-  {
-    if(ids.empty())
-    {
-      ids.push_back(spk_ids(ind));
-      last_elem=spk_ids(ind);
-    }
-    else if(last_elem!=spk_ids(ind))
-    {
-      ids.push_back(spk_ids(ind));
-      last_elem=spk_ids(ind);
-    }
-  }
-
-  // Allocate arrays
-  blitz::Array<double,1> shift(CD);
-  blitz::Array<double,1> tmp1(CD);
-  blitz::Array<double,1> Fs(CD);
-  blitz::Array<double,1> Nss(C);
-  blitz::Array<double,1> Ns(CD);
-  blitz::Array<double,1> L(CD);
-
-  std::vector<uint32_t>::iterator it;
-  int cur_start_ind=0;
-  int cur_end_ind;
-  for(it=ids.begin(); it<ids.end(); ++it)
-  {
-    // Determine speaker sessions
-    uint32_t cur_elem=*it;
-    cur_start_ind=0;
-    while(spk_ids(cur_start_ind) != cur_elem)
-      ++cur_start_ind;
-    cur_end_ind = cur_start_ind;
-    for(int ind=cur_start_ind+1; ind<T; ++ind)
-    {
-      cur_end_ind = ind;
-      if(spk_ids(ind)!=cur_elem)
-      {
-        cur_end_ind = ind-1;
-        break;
-      }
-    }
-
-    // Extract speaker sessions
-    blitz::Array<double,2> Fs_sessions = F(blitz::Range(cur_start_ind,cur_end_ind), blitz::Range::all());
-    blitz::Array<double,2> Nss_sessions = N(blitz::Range(cur_start_ind,cur_end_ind), blitz::Range::all());
-
-    blitz::firstIndex i;
-    blitz::secondIndex j;
-    Fs = blitz::sum(Fs_sessions(j,i), j);
-    Nss = blitz::sum(Nss_sessions(j,i), j);
-    core::repelem(Nss, Ns);
-
-    // Compute shift
-    shift = m;
-    blitz::Array<double,1> y_ii = y(cur_elem,blitz::Range::all());
-    math::prod(y_ii, v, tmp1);
-    shift += tmp1;
-    Fs -= shift * Ns;
-
-    // Loop over speaker session
-    for(int jj=cur_start_ind; jj<=cur_end_ind; ++jj)
-    {
-      // update x
-      blitz::Array<double,1> x_jj = x(jj,blitz::Range::all());
-      math::prod(x_jj, u, shift);
-      blitz::Array<double,1> N_jj = N(jj,blitz::Range::all());
-      core::repelem(N_jj, tmp1);
-      Fs -= shift * tmp1;
-    }
-
-    L = 1.;
-    L += Ns / E * blitz::pow2(d);
+  std::vector<int> starts, ends;
+  speakerSegments(spk_ids, ids, starts, ends);
 
-    // Update z   
-    // z(ii,:) = Fs ./ E .* d ./L;
-    blitz::Array<double,1> z_ii = z(cur_elem,blitz::Range::all());
-    z_ii = Fs / E * d / L;
-  }
+  // The speakers are split across the threads
+  core::thread_loop(estimateZRange(F, N, m, E, d, v, u, z, y, x, ids, starts,
+      ends), ids.size(), n_threads);
 }
 
 
@@ -521,38 +606,77 @@ void train::JFABaseTrainerBase::initNid(const std::vector<std::vector<boost::sha
   m_Nid = stats.size();
 }
 
+void train::JFABaseTrainerBase::initNid(const train::JFATrainingStats& stats)
+{
+  // Number of people
+  m_Nid = stats.getNPersons();
+}
+
 void train::JFABaseTrainerBase::initNid(const size_t Nid)
 {
   // Number of people
   m_Nid = Nid;
 }
 
+train::JFATrainingStats train::JFABaseTrainerBase::toTrainingStats(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats) const
+{
+  train::JFATrainingStats training_stats(m_jfa_machine.getDimC(), m_jfa_machine.getDimD());
+  size_t n_sessions = 0;
+  for(size_t id=0; id<stats.size(); ++id)
+    n_sessions += stats[id].size();
+  training_stats.reserve(n_sessions);
+  for(size_t id=0; id<stats.size(); ++id)
+    training_stats.addPerson(stats[id]);
+  return training_stats;
+}
+
+const train::JFATrainingStats& train::JFABaseTrainerBase::cachedTrainingStats(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats, const bool refresh) const
+{
+  bool same = !refresh && m_cache_training_stats &&
+    m_cache_training_stats->getNGaussians() == m_jfa_machine.getDimC() &&
+    m_cache_training_stats->getNInputs() == m_jfa_machine.getDimD() &&
+    m_cache_gmmstats.size() == stats.size();
+  for(size_t id=0; same && id<stats.size(); ++id) {
+    same = m_cache_gmmstats[id].size() == stats[id].size();
+    for(size_t h=0; same && h<stats[id].size(); ++h)
+      same = m_cache_gmmstats[id][h] == stats[id][h];
+  }
+  if(!same) {
+    // Releases the previous copy before building the new one
+    m_cache_training_stats.reset();
+    m_cache_gmmstats.clear();
+    m_cache_training_stats.reset(new train::JFATrainingStats(toTrainingStats(stats)));
+    m_cache_gmmstats = stats;
+  }
+  return *m_cache_training_stats;
+}
+
 void train::JFABaseTrainerBase::precomputeSumStatisticsN(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats)
+{
+  precomputeSumStatisticsN(cachedTrainingStats(stats, true));
+}
+
+void train::JFABaseTrainerBase::precomputeSumStatisticsN(const train::JFATrainingStats& stats)
 {
   m_Nacc.clear();
   blitz::Array<double,1> Nsum(m_jfa_machine.getDimC());
-  for(size_t id=0; id<stats.size(); ++id) {
-    Nsum = 0.;
-    for(size_t s=0; s<stats[id].size(); ++s) {
-      Nsum += stats[id][s]->n;
-    }
+  for(size_t id=0; id<stats.getNPersons(); ++id) {
+    stats.sumN(id, Nsum);
     m_Nacc.push_back(core::array::ccopy(Nsum));
   }
 }
 
 void train::JFABaseTrainerBase::precomputeSumStatisticsF(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats)
+{
+  precomputeSumStatisticsF(cachedTrainingStats(stats, true));
+}
+
+void train::JFABaseTrainerBase::precomputeSumStatisticsF(const train::JFATrainingStats& stats)
 {
   m_Facc.clear();
-  boost::shared_ptr<mach::GMMMachine> ubm(m_jfa_machine.getUbm());
   blitz::Array<double,1> Fsum(m_jfa_machine.getDimCD());
-  for(size_t id=0; id<stats.size(); ++id) {
-    Fsum = 0.;
-    for(size_t s=0; s<stats[id].size(); ++s) {
-      for(size_t g=0; g<ubm->getNGaussians(); ++g) {
-        blitz::Array<double,1> Fsum_g = Fsum(blitz::Range(g*ubm->getNInputs(),(g+1)*ubm->getNInputs()-1));
-        Fsum_g += stats[id][s]->sumPx(g,blitz::Range::all());
-      }
-    }
+  for(size_t id=0; id<stats.getNPersons(); ++id) {
+    stats.sumF(id, Fsum);
     m_Facc.push_back(core::array::ccopy(Fsum));
   }
 }
@@ -609,6 +733,7 @@ void train::JFABaseTrainerBase::initializeRandomU()
 {
   blitz::Array<double,2> U = m_jfa_machine.updateU();
   initializeRandom(U);
+  m_jfa_machine.precompute();
 }
 
 void train::JFABaseTrainerBase::initializeRandomV()
@@ -631,6 +756,11 @@ void train::JFABaseTrainerBase::initializeUVD()
 }
 
 void train::JFABaseTrainerBase::initializeXYZ(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& vec)
+{
+  initializeXYZ(cachedTrainingStats(vec, true));
+}
+
+void train::JFABaseTrainerBase::initializeXYZ(const train::JFATrainingStats& stats)
 {
   std::vector<blitz::Array<double,1> > z;
   std::vector<blitz::Array<double,1> > y;
@@ -642,11 +772,11 @@ void train::JFABaseTrainerBase::initializeXYZ(const std::vector<std::vector<boos
   y0 = 0;
   blitz::Array<double,2> x0(m_jfa_machine.getDimRu(),0);
   x0 = 0;
-  for(size_t i=0; i<vec.size(); ++i)
+  for(size_t i=0; i<stats.getNPersons(); ++i)
   {
     z.push_back(core::array::ccopy(z0));
     y.push_back(core::array::ccopy(y0));
-    x0.resize(m_jfa_machine.getDimRu(),vec[i].size());
+    x0.resize(m_jfa_machine.getDimRu(),stats.getNSessions(i));
     x0 = 0;
     x.push_back(core::array::ccopy(x0));
   }
@@ -657,14 +787,11 @@ void train::JFABaseTrainerBase::initializeXYZ(const std::vector<std::vector<boos
 
 train::JFABaseTrainer::JFABaseTrainer(mach::JFABaseMachine& m): 
   JFABaseTrainerBase(m),
-  m_cache_VtSigmaInv(0), m_cache_VProd(0), m_cache_IdPlusVProd_i(0), 
-  m_cache_Fn_y_i(0), m_cache_A1_y(0), m_cache_A2_y(0),
-  m_cache_UtSigmaInv(0), m_cache_UProd(0), m_cache_IdPlusUProd_ih(0),
-  m_cache_Fn_x_ih(0), m_cache_A1_x(0), m_cache_A2_x(0),
-  m_cache_DtSigmaInv(0), m_cache_DProd(0), m_cache_IdPlusDProd_i(0),
-  m_cache_Fn_z_i(0), m_cache_A1_z(0), m_cache_A2_z(0),
-  m_tmp_rvrv(0), m_tmp_rvD(0), m_tmp_ruru(0), m_tmp_ruD(0),
-  m_tmp_rv(0), m_tmp_ru(0), m_tmp_CD(0), m_tmp_CD_b(0)
+  m_n_threads(1),
+  m_cache_VtSigmaInv(0), m_cache_VProd(0), m_cache_A1_y(0), m_cache_A2_y(0),
+  m_cache_UtSigmaInv(0), m_cache_UProd(0), m_cache_A1_x(0), m_cache_A2_x(0),
+  m_cache_DtSigmaInv(0), m_cache_DProd(0), m_cache_A1_z(0), m_cache_A2_z(0),
+  m_tmp_rvD(0), m_tmp_ruD(0)
 {
   initCache();
 }
@@ -674,36 +801,63 @@ void train::JFABaseTrainer::initCache()
   // U
   m_cache_UtSigmaInv.resize(m_jfa_machine.getDimRu(), m_jfa_machine.getDimCD());
   m_cache_UProd.resize(m_jfa_machine.getDimC(),m_jfa_machine.getDimRu(),m_jfa_machine.getDimRu());
-  m_cache_IdPlusUProd_ih.resize(m_jfa_machine.getDimRu(),m_jfa_machine.getDimRu());
-  m_cache_Fn_x_ih.resize(m_jfa_machine.getDimCD());
   m_cache_A1_x.resize(m_jfa_machine.getDimC(),m_jfa_machine.getDimRu(),m_jfa_machine.getDimRu());
   m_cache_A2_x.resize(m_jfa_machine.getDimCD(),m_jfa_machine.getDimRu());
   // V
   m_cache_VtSigmaInv.resize(m_jfa_machine.getDimRv(), m_jfa_machine.getDimCD());
   m_cache_VProd.resize(m_jfa_machine.getDimC(),m_jfa_machine.getDimRv(),m_jfa_machine.getDimRv());
-  m_cache_IdPlusVProd_i.resize(m_jfa_machine.getDimRv(),m_jfa_machine.getDimRv());
-  m_cache_Fn_y_i.resize(m_jfa_machine.getDimCD());
   m_cache_A1_y.resize(m_jfa_machine.getDimC(),m_jfa_machine.getDimRv(),m_jfa_machine.getDimRv());
   m_cache_A2_y.resize(m_jfa_machine.getDimCD(),m_jfa_machine.getDimRv());
   // D
   m_cache_DtSigmaInv.resize(m_jfa_machine.getDimCD());
   m_cache_DProd.resize(m_jfa_machine.getDimCD());
-  m_cache_IdPlusDProd_i.resize(m_jfa_machine.getDimCD());
-  m_cache_Fn_z_i.resize(m_jfa_machine.getDimCD());
   m_cache_A1_z.resize(m_jfa_machine.getDimCD());
   m_cache_A2_z.resize(m_jfa_machine.getDimCD());
 
   // tmp
-  m_tmp_CD.resize(m_jfa_machine.getDimCD());
-  m_tmp_CD_b.resize(m_jfa_machine.getDimCD());
-
-  m_tmp_ru.resize(m_jfa_machine.getDimRu());
   m_tmp_ruD.resize(m_jfa_machine.getDimRu(),m_jfa_machine.getDimD());
-  m_tmp_ruru.resize(m_jfa_machine.getDimRu(),m_jfa_machine.getDimRu());
-
-  m_tmp_rv.resize(m_jfa_machine.getDimRv());
   m_tmp_rvD.resize(m_jfa_machine.getDimRv(),m_jfa_machine.getDimD());
-  m_tmp_rvrv.resize(m_jfa_machine.getDimRv(), m_jfa_machine.getDimRv());
+
+  // Per-thread buffers
+  m_person_cache.clear();
+  initPersonCaches();
+}
+
+void train::JFABaseTrainer::initPersonCaches()
+{
+  const size_t n_caches = std::max(m_n_threads, (size_t)1);
+  const size_t C = m_jfa_machine.getDimC();
+  const size_t CD = m_jfa_machine.getDimCD();
+  const size_t ru = m_jfa_machine.getDimRu();
+  const size_t rv = m_jfa_machine.getDimRv();
+  for(size_t k=m_person_cache.size(); k<n_caches; ++k) {
+    PersonCache cache;
+    cache.IdPlusVProd_i.resize(rv, rv);
+    cache.Fn_y_i.resize(CD);
+    cache.IdPlusUProd_ih.resize(ru, ru);
+    cache.Fn_x_ih.resize(CD);
+    cache.IdPlusDProd_i.resize(CD);
+    cache.Fn_z_i.resize(CD);
+    cache.A1_y.resize(C, rv, rv);
+    cache.A2_y.resize(CD, rv);
+    cache.A1_x.resize(C, ru, ru);
+    cache.A2_x.resize(CD, ru);
+    cache.A1_z.resize(CD);
+    cache.A2_z.resize(CD);
+    cache.tmp_rvrv.resize(rv, rv);
+    cache.tmp_ruru.resize(ru, ru);
+    cache.tmp_rv.resize(rv);
+    cache.tmp_ru.resize(ru);
+    cache.tmp_CD.resize(CD);
+    cache.tmp_CD_b.resize(CD);
+    m_person_cache.push_back(cache);
+  }
+}
+
+void train::JFABaseTrainer::setNThreads(const size_t n_threads)
+{
+  m_n_threads = n_threads;
+  initPersonCaches();
 }
 
 void train::JFABaseTrainer::computeVtSigmaInv()
@@ -736,96 +890,177 @@ void train::JFABaseTrainer::computeVProd()
 }
 
 void train::JFABaseTrainer::computeIdPlusVProd_i(const size_t id) 
+{
+  computeIdPlusVProd_i(id, m_person_cache[0]);
+}
+
+void train::JFABaseTrainer::computeIdPlusVProd_i(const size_t id, PersonCache& cache) const
 {
   const blitz::Array<double,1>& Ni = m_Nacc[id];
-  math::eye(m_tmp_rvrv); // m_tmp_rvrv = I
+  // called concurrently: m_cache_VProd is sliced through a private alias
+  const blitz::Array<double,3> VProd = core::array::alias(m_cache_VProd);
+  math::eye(cache.tmp_rvrv); // tmp_rvrv = I
   for(size_t c=0; c<m_jfa_machine.getDimC(); ++c) {
-    blitz::Array<double,2> VProd_c = m_cache_VProd(c,blitz::Range::all(),blitz::Range::all());
-    m_tmp_rvrv += VProd_c * Ni(c);
+    const blitz::Array<double,2> VProd_c = VProd((int)c,blitz::Range::all(),blitz::Range::all());
+    cache.tmp_rvrv += VProd_c * Ni(c);
   }
-  math::inv(m_tmp_rvrv, m_cache_IdPlusVProd_i); // m_cache_IdPlusVProd_i = ( I+Vt*diag(sigma)^-1*Ni*V)^-1
+  math::inv(cache.tmp_rvrv, cache.IdPlusVProd_i); // IdPlusVProd_i = ( I+Vt*diag(sigma)^-1*Ni*V)^-1
 }
 
 void train::JFABaseTrainer::computeFn_y_i(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats, const size_t id)
+{
+  computeFn_y_i(cachedTrainingStats(stats), id, m_person_cache[0]);
+}
+
+void train::JFABaseTrainer::computeFn_y_i(const train::JFATrainingStats& stats, const size_t id)
+{
+  computeFn_y_i(stats, id, m_person_cache[0]);
+}
+
+void train::JFABaseTrainer::computeFn_y_i(const train::JFATrainingStats& stats, const size_t id, PersonCache& cache) const
 {
   // Compute Fn_yi = sum_{sessions h}(N_{i,h}*(o_{i,h} - m - D*z_{i} - U*x_{i,h}) (Normalised first order statistics)
   const blitz::Array<double,1>& Fi = m_Facc[id];
   const blitz::Array<double,1>& m = m_cache_ubm_mean;
   const blitz::Array<double,1>& d = m_jfa_machine.getD();
   const blitz::Array<double,1>& z = m_z[id];
-  core::repelem(m_Nacc[id], m_tmp_CD);
-  m_cache_Fn_y_i = Fi - m_tmp_CD * (m + d * z); // Fn_yi = sum_{sessions h}(N_{i,h}*(o_{i,h} - m - D*z_{i}) 
+  core::repelem(m_Nacc[id], cache.tmp_CD);
+  cache.Fn_y_i = Fi - cache.tmp_CD * (m + d * z); // Fn_yi = sum_{sessions h}(N_{i,h}*(o_{i,h} - m - D*z_{i}) 
   const blitz::Array<double,2>& X = m_x[id];
   const blitz::Array<double,2>& U = m_jfa_machine.getU();
   for(int h=0; h<X.extent(1); ++h) // Loops over the sessions
   {
     blitz::Array<double,1> Xh = X(blitz::Range::all(), h); // Xh = x_{i,h} (length: ru)
-    math::prod(U, Xh, m_tmp_CD_b); // m_tmp_CD_b = U*x_{i,h}
-    const blitz::Array<double,1>& Nih = stats[id][h]->n;
-    core::repelem(Nih, m_tmp_CD);
-    m_cache_Fn_y_i -= m_tmp_CD * m_tmp_CD_b; // N_{i,h} * U * x_{i,h}
+    math::prod(U, Xh, cache.tmp_CD_b); // tmp_CD_b = U*x_{i,h}
+    const blitz::Array<double,1> Nih = stats.getN(stats.getOffsets()[id]+h);
+    core::repelem(Nih, cache.tmp_CD);
+    cache.Fn_y_i -= cache.tmp_CD * cache.tmp_CD_b; // N_{i,h} * U * x_{i,h}
   }
   // Fn_yi = sum_{sessions h}(N_{i,h}*(o_{i,h} - m - D*z_{i} - U*x_{i,h})
 }
 
 void train::JFABaseTrainer::updateY_i(const size_t id)
+{
+  updateY_i(id, m_person_cache[0]);
+}
+
+void train::JFABaseTrainer::updateY_i(const size_t id, PersonCache& cache)
 {
   // Computes yi = Ayi * Cvs * Fn_yi
   blitz::Array<double,1>& y = m_y[id];
-  // m_tmp_rv = m_cache_VtSigmaInv * m_cache_Fn_y_i = Vt*diag(sigma)^-1 * sum_{sessions h}(N_{i,h}*(o_{i,h} - m - D*z_{i} - U*x_{i,h})
-  math::prod(m_cache_VtSigmaInv, m_cache_Fn_y_i, m_tmp_rv); 
-  math::prod(m_cache_IdPlusVProd_i, m_tmp_rv, y);
+  // tmp_rv = m_cache_VtSigmaInv * Fn_y_i = Vt*diag(sigma)^-1 * sum_{sessions h}(N_{i,h}*(o_{i,h} - m - D*z_{i} - U*x_{i,h})
+  math::prod(m_cache_VtSigmaInv, cache.Fn_y_i, cache.tmp_rv); 
+  math::prod(cache.IdPlusVProd_i, cache.tmp_rv, y);
+}
+
+void train::JFABaseTrainer::updateYRange(const train::JFATrainingStats& stats, size_t k, size_t begin, size_t end)
+{
+  PersonCache& cache = m_person_cache[k];
+  for(size_t id=begin; id<end; ++id) {
+    computeIdPlusVProd_i(id, cache);
+    computeFn_y_i(stats, id, cache);
+    updateY_i(id, cache);
+  }
 }
 
 void train::JFABaseTrainer::updateY(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats)
+{
+  updateY(cachedTrainingStats(stats, true));
+}
+
+void train::JFABaseTrainer::updateY(const train::JFATrainingStats& stats)
 {
   // Precomputation
   computeVtSigmaInv();
   computeVProd();
-  // Loops over all people
-  for(size_t id=0; id<m_Nacc.size(); ++id) {
-    computeIdPlusVProd_i(id);
-    computeFn_y_i(stats, id);
-    updateY_i(id);
-  }
+  // Loops over all people, split across the threads
+  core::thread_iloop(boost::bind(&train::JFABaseTrainer::updateYRange, this,
+        boost::cref(stats), _1, _2, _3), m_Nacc.size(), m_n_threads);
 }
 
 void train::JFABaseTrainer::updateV(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats)
+{
+  updateV(cachedTrainingStats(stats, true));
+}
+
+void train::JFABaseTrainer::updateV(const train::JFATrainingStats& stats)
 {  
-  // Initializes the cache accumulator
-  m_cache_A1_y = 0.;
-  m_cache_A2_y = 0.;
-  // Loops over all people
+  accumulateV(stats);
+  updateVFromAccumulators();
+}
+
+void train::JFABaseTrainer::accumulateVRange(const train::JFATrainingStats& stats, size_t k, size_t begin, size_t end)
+{
+  PersonCache& cache = m_person_cache[k];
+  // Initializes the partial accumulators
+  cache.A1_y = 0.;
+  cache.A2_y = 0.;
   blitz::firstIndex i;
   blitz::secondIndex j;
-  for(size_t id=0; id<m_Nacc.size(); ++id) {
-    computeIdPlusVProd_i(id);
-    computeFn_y_i(stats, id);
+  for(size_t id=begin; id<end; ++id) {
+    computeIdPlusVProd_i(id, cache);
+    computeFn_y_i(stats, id, cache);
 
     // Needs to return values to be accumulated for estimating V
     const blitz::Array<double,1>& y = m_y[id];
-    m_tmp_rvrv = m_cache_IdPlusVProd_i;
-    m_tmp_rvrv += y(i) * y(j); 
+    cache.tmp_rvrv = cache.IdPlusVProd_i;
+    cache.tmp_rvrv += y(i) * y(j); 
     for(size_t c=0; c<m_jfa_machine.getDimC(); ++c)
     {
-      blitz::Array<double,2> A1_y_c = m_cache_A1_y(c,blitz::Range::all(),blitz::Range::all());
-      A1_y_c += m_tmp_rvrv * m_Nacc[id](c);
+      blitz::Array<double,2> A1_y_c = cache.A1_y(c,blitz::Range::all(),blitz::Range::all());
+      A1_y_c += cache.tmp_rvrv * m_Nacc[id](c);
     }
-    m_cache_A2_y += m_cache_Fn_y_i(i) * y(j);
+    cache.A2_y += cache.Fn_y_i(i) * y(j);
+  }
+}
+
+void train::JFABaseTrainer::accumulateV(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats)
+{
+  accumulateV(cachedTrainingStats(stats, true));
+}
+
+void train::JFABaseTrainer::accumulateV(const train::JFATrainingStats& stats)
+{  
+  // Initializes the cache accumulator
+  m_cache_A1_y = 0.;
+  m_cache_A2_y = 0.;
+  // Loops over all people, split across the threads, and merges the partial
+  // accumulators in the order of the threads
+  const size_t n_blocks = core::thread_iloop(boost::bind(
+        &train::JFABaseTrainer::accumulateVRange, this, boost::cref(stats), 
+        _1, _2, _3), m_Nacc.size(), m_n_threads);
+  for(size_t k=0; k<n_blocks; ++k) {
+    m_cache_A1_y += m_person_cache[k].A1_y;
+    m_cache_A2_y += m_person_cache[k].A2_y;
   }
- 
+}
+
+void train::JFABaseTrainer::updateVRange(blitz::Array<double,2>& V, size_t k, size_t begin, size_t end)
+{
   const size_t dim = m_jfa_machine.getDimD();
-  blitz::Array<double,2>& V = m_jfa_machine.updateV();
-  for(size_t c=0; c<m_jfa_machine.getDimC(); ++c)
+  PersonCache& cache = m_person_cache[k];
+  // the blocks are views of aliases private to this thread
+  const blitz::Array<double,3> A1_ = core::array::alias(m_cache_A1_y);
+  const blitz::Array<double,2> A2_ = core::array::alias(m_cache_A2_y);
+  blitz::Array<double,2> V_ = core::array::alias(V);
+  for(size_t c=begin; c<end; ++c)
   {
-    const blitz::Array<double,2> A1 = m_cache_A1_y(c,blitz::Range::all(),blitz::Range::all());
-    math::inv(A1, m_tmp_rvrv);
-    const blitz::Array<double,2> A2 = m_cache_A2_y(blitz::Range(c*dim,(c+1)*dim-1), blitz::Range::all());
-    blitz::Array<double,2> V_c = V(blitz::Range(c*dim,(c+1)*dim-1), blitz::Range::all());
-    math::prod(A2, m_tmp_rvrv, V_c);
+    const blitz::Array<double,2> A1 = A1_((int)c,blitz::Range::all(),blitz::Range::all());
+    math::inv(A1, cache.tmp_rvrv);
+    const blitz::Array<double,2> A2 = A2_(blitz::Range(c*dim,(c+1)*dim-1), blitz::Range::all());
+    blitz::Array<double,2> V_c = V_(blitz::Range(c*dim,(c+1)*dim-1), blitz::Range::all());
+    math::prod(A2, cache.tmp_rvrv, V_c);
   }
 }
 
+void train::JFABaseTrainer::updateVFromAccumulators()
+{
+  blitz::Array<double,2>& V = m_jfa_machine.updateV();
+  // Loops over the Gaussians, split across the threads
+  core::thread_iloop(boost::bind(&train::JFABaseTrainer::updateVRange, this,
+        boost::ref(V), _1, _2, _3), m_jfa_machine.getDimC(), m_n_threads);
+}
+
 
 void train::JFABaseTrainer::computeUtSigmaInv()
 {
@@ -856,103 +1091,211 @@ void train::JFABaseTrainer::computeUProd()
   }
 }
 
-void train::JFABaseTrainer::computeIdPlusUProd_ih(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats, const size_t id, const size_t h) 
+void train::JFABaseTrainer::computeIdPlusUProd_ih(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats, const size_t id, const size_t h)
+{
+  computeIdPlusUProd_ih(cachedTrainingStats(stats), id, h, m_person_cache[0]);
+}
+
+void train::JFABaseTrainer::computeIdPlusUProd_ih(const train::JFATrainingStats& stats, const size_t id, const size_t h)
 {
-  const blitz::Array<double,1>& Nih = stats[id][h]->n;
-  math::eye(m_tmp_ruru); // m_tmp_ruru = I
+  computeIdPlusUProd_ih(stats, id, h, m_person_cache[0]);
+}
+
+void train::JFABaseTrainer::computeIdPlusUProd_ih(const train::JFATrainingStats& stats, const size_t id, const size_t h, PersonCache& cache) const
+{
+  const blitz::Array<double,1> Nih = stats.getN(stats.getOffsets()[id]+h);
+  // called concurrently: m_cache_UProd is sliced through a private alias
+  const blitz::Array<double,3> UProd = core::array::alias(m_cache_UProd);
+  math::eye(cache.tmp_ruru); // tmp_ruru = I
   for(size_t c=0; c<m_jfa_machine.getDimC(); ++c) {
-    blitz::Array<double,2> UProd_c = m_cache_UProd(c,blitz::Range::all(),blitz::Range::all());
-    m_tmp_ruru += UProd_c * Nih(c);
+    const blitz::Array<double,2> UProd_c = UProd((int)c,blitz::Range::all(),blitz::Range::all());
+    cache.tmp_ruru += UProd_c * Nih(c);
   }
-  math::inv(m_tmp_ruru, m_cache_IdPlusUProd_ih); // m_cache_IdPlusUProd_ih = ( I+Ut*diag(sigma)^-1*Ni*U)^-1
+  math::inv(cache.tmp_ruru, cache.IdPlusUProd_ih); // IdPlusUProd_ih = ( I+Ut*diag(sigma)^-1*Ni*U)^-1
 }
 
 void train::JFABaseTrainer::computeFn_x_ih(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats, const size_t id, const size_t h)
+{
+  computeFn_x_ih(cachedTrainingStats(stats), id, h, m_person_cache[0]);
+}
+
+void train::JFABaseTrainer::computeFn_x_ih(const train::JFATrainingStats& stats, const size_t id, const size_t h)
+{
+  computeFn_x_ih(stats, id, h, m_person_cache[0]);
+}
+
+void train::JFABaseTrainer::computeFn_x_ih(const train::JFATrainingStats& stats, const size_t id, const size_t h, PersonCache& cache) const
 {
   // Compute Fn_x_ih = sum_{sessions h}(N_{i,h}*(o_{i,h} - m - D*z_{i} - V*y_{i}) (Normalised first order statistics)
-  const blitz::Array<double,2>& Fih = stats[id][h]->sumPx;
+  const size_t session = stats.getOffsets()[id]+h;
   const blitz::Array<double,1>& m = m_cache_ubm_mean;
   const blitz::Array<double,1>& d = m_jfa_machine.getD();
   const blitz::Array<double,1>& z = m_z[id];
-  const blitz::Array<double,1>& Nih = stats[id][h]->n;
-  core::repelem(Nih, m_tmp_CD); 
-  for(size_t c=0; c<m_jfa_machine.getDimC(); ++c) {
-    blitz::Array<double,1> Fn_x_ih_c = m_cache_Fn_x_ih(blitz::Range(c*m_jfa_machine.getDimD(),(c+1)*m_jfa_machine.getDimD()-1));
-    Fn_x_ih_c = Fih(c,blitz::Range::all());
-  } 
-  m_cache_Fn_x_ih -= m_tmp_CD * (m + d * z); // Fn_x_ih = N_{i,h}*(o_{i,h} - m - D*z_{i}) 
+  const blitz::Array<double,1> Nih = stats.getN(session);
+  core::repelem(Nih, cache.tmp_CD); 
+  stats.getF(session, cache.Fn_x_ih); // Fn_x_ih = o_{i,h}
+  cache.Fn_x_ih -= cache.tmp_CD * (m + d * z); // Fn_x_ih = N_{i,h}*(o_{i,h} - m - D*z_{i}) 
 
   const blitz::Array<double,1>& y = m_y[id];
   const blitz::Array<double,2>& V = m_jfa_machine.getV();
-  math::prod(V, y, m_tmp_CD_b);
-  m_cache_Fn_x_ih -= m_tmp_CD * m_tmp_CD_b;
+  math::prod(V, y, cache.tmp_CD_b);
+  cache.Fn_x_ih -= cache.tmp_CD * cache.tmp_CD_b;
   // Fn_x_ih = N_{i,h}*(o_{i,h} - m - D*z_{i} - V*y_{i})
 }
 
 void train::JFABaseTrainer::updateX_ih(const size_t id, const size_t h)
 {
-  // Computes xih = Axih * Cus * Fn_x_ih
   blitz::Array<double,1> x = m_x[id](blitz::Range::all(), h);
-  // m_tmp_ru = m_cache_UtSigmaInv * m_cache_Fn_x_ih = Ut*diag(sigma)^-1 * N_{i,h}*(o_{i,h} - m - D*z_{i} - V*y_{i})
-  math::prod(m_cache_UtSigmaInv, m_cache_Fn_x_ih, m_tmp_ru); 
-  math::prod(m_cache_IdPlusUProd_ih, m_tmp_ru, x);
+  updateX_ih(x, m_person_cache[0]);
+}
+
+void train::JFABaseTrainer::updateX_ih(blitz::Array<double,1>& x, PersonCache& cache)
+{
+  // Computes xih = Axih * Cus * Fn_x_ih
+  // tmp_ru = m_cache_UtSigmaInv * Fn_x_ih = Ut*diag(sigma)^-1 * N_{i,h}*(o_{i,h} - m - D*z_{i} - V*y_{i})
+  math::prod(m_cache_UtSigmaInv, cache.Fn_x_ih, cache.tmp_ru); 
+  math::prod(cache.IdPlusUProd_ih, cache.tmp_ru, x);
+}
+
+/**
+ * Lists the (person, session) pairs of the statistics, such that the 
+ * sessions of all the persons can be split across the threads, together
+ * with the view x_{i,h} of each session. The views are created here, as 
+ * slicing x[id] from several threads would race on its reference count.
+ */
+static void listSessions(std::vector<blitz::Array<double,2> >& x,
+  std::vector<std::pair<size_t,size_t> >& sessions,
+  std::vector<blitz::Array<double,1> >& x_ih)
+{
+  for(size_t id=0; id<x.size(); ++id)
+    for(int h=0; h<x[id].extent(1); ++h) {
+      sessions.push_back(std::make_pair(id, (size_t)h));
+      x_ih.push_back(x[id](blitz::Range::all(), h));
+    }
+}
+
+void train::JFABaseTrainer::updateXRange(const train::JFATrainingStats& stats, const std::vector<std::pair<size_t,size_t> >& sessions, std::vector<blitz::Array<double,1> >& x_ih, size_t k, size_t begin, size_t end)
+{
+  PersonCache& cache = m_person_cache[k];
+  for(size_t s=begin; s<end; ++s) {
+    const size_t id = sessions[s].first;
+    const size_t h = sessions[s].second;
+    computeIdPlusUProd_ih(stats, id, h, cache);
+    computeFn_x_ih(stats, id, h, cache);
+    updateX_ih(x_ih[s], cache);
+  }
 }
 
 void train::JFABaseTrainer::updateX(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats)
+{
+  updateX(cachedTrainingStats(stats, true));
+}
+
+void train::JFABaseTrainer::updateX(const train::JFATrainingStats& stats)
 {
   // Precomputation
   computeUtSigmaInv();
   computeUProd();
-  // Loops over all people
-  for(size_t id=0; id<stats.size(); ++id) {
-    int n_session_i = m_x[id].extent(1);
-    for(int s=0; s<n_session_i; ++s) {
-      computeIdPlusUProd_ih(stats, id, s);
-      computeFn_x_ih(stats, id, s);
-      updateX_ih(id, s);
+  // Loops over all the sessions of all people, split across the threads
+  std::vector<std::pair<size_t,size_t> > sessions;
+  std::vector<blitz::Array<double,1> > x_ih;
+  listSessions(m_x, sessions, x_ih);
+  core::thread_iloop(boost::bind(&train::JFABaseTrainer::updateXRange, this,
+        boost::cref(stats), boost::cref(sessions), boost::ref(x_ih), _1, _2,
+        _3), sessions.size(), m_n_threads);
+}
+
+void train::JFABaseTrainer::updateU(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats)
+{
+  updateU(cachedTrainingStats(stats, true));
+}
+
+void train::JFABaseTrainer::updateU(const train::JFATrainingStats& stats)
+{
+  accumulateU(stats);
+  updateUFromAccumulators();
+}
+
+void train::JFABaseTrainer::accumulateURange(const train::JFATrainingStats& stats, const std::vector<std::pair<size_t,size_t> >& sessions, const std::vector<blitz::Array<double,1> >& x_ih, size_t k, size_t begin, size_t end)
+{
+  PersonCache& cache = m_person_cache[k];
+  // Initializes the partial accumulators
+  cache.A1_x = 0.;
+  cache.A2_x = 0.;
+  blitz::firstIndex i;
+  blitz::secondIndex j; 
+  for(size_t s=begin; s<end; ++s) {
+    const size_t id = sessions[s].first;
+    const size_t h = sessions[s].second;
+    computeIdPlusUProd_ih(stats, id, h, cache);
+    computeFn_x_ih(stats, id, h, cache);
+
+    // Needs to return values to be accumulated for estimating U
+    const blitz::Array<double,1>& x = x_ih[s];
+    const blitz::Array<double,1> Nih = stats.getN(stats.getOffsets()[id]+h);
+    cache.tmp_ruru = cache.IdPlusUProd_ih;
+    cache.tmp_ruru += x(i) * x(j); 
+    for(int c=0; c<static_cast<int>(m_jfa_machine.getDimC()); ++c)
+    {
+      blitz::Array<double,2> A1_x_c = cache.A1_x(c,blitz::Range::all(),blitz::Range::all());
+      A1_x_c += cache.tmp_ruru * Nih(c);
     }
+    cache.A2_x += cache.Fn_x_ih(i) * x(j);
   }
 }
 
-void train::JFABaseTrainer::updateU(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats)
+void train::JFABaseTrainer::accumulateU(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats)
+{
+  accumulateU(cachedTrainingStats(stats, true));
+}
+
+void train::JFABaseTrainer::accumulateU(const train::JFATrainingStats& stats)
 {
   // Initializes the cache accumulator
   m_cache_A1_x = 0.;
   m_cache_A2_x = 0.;
-  // Loops over all people
-  blitz::firstIndex i;
-  blitz::secondIndex j; 
-  for(size_t id=0; id<stats.size(); ++id) {
-    int n_session_i = m_x[id].extent(1);
-    for(int h=0; h<n_session_i; ++h) {
-      computeIdPlusUProd_ih(stats, id, h);
-      computeFn_x_ih(stats,id, h);
-
-      // Needs to return values to be accumulated for estimating U
-      blitz::Array<double,1> x = m_x[id](blitz::Range::all(), h);
-      m_tmp_ruru = m_cache_IdPlusUProd_ih;
-      m_tmp_ruru += x(i) * x(j); 
-      for(int c=0; c<static_cast<int>(m_jfa_machine.getDimC()); ++c)
-      {
-        blitz::Array<double,2> A1_x_c = m_cache_A1_x(c,blitz::Range::all(),blitz::Range::all());
-        A1_x_c += m_tmp_ruru * stats[id][h]->n(c);
-      }
-      m_cache_A2_x += m_cache_Fn_x_ih(i) * x(j);
-    }
+  // Loops over all the sessions of all people, split across the threads, and
+  // merges the partial accumulators in the order of the threads
+  std::vector<std::pair<size_t,size_t> > sessions;
+  std::vector<blitz::Array<double,1> > x_ih;
+  listSessions(m_x, sessions, x_ih);
+  const size_t n_blocks = core::thread_iloop(boost::bind(
+        &train::JFABaseTrainer::accumulateURange, this, boost::cref(stats), 
+        boost::cref(sessions), boost::cref(x_ih), _1, _2, _3), sessions.size(),
+      m_n_threads);
+  for(size_t k=0; k<n_blocks; ++k) {
+    m_cache_A1_x += m_person_cache[k].A1_x;
+    m_cache_A2_x += m_person_cache[k].A2_x;
   }
+}
 
+void train::JFABaseTrainer::updateURange(blitz::Array<double,2>& U, size_t k, size_t begin, size_t end)
+{
   const size_t dim = m_jfa_machine.getDimD();
-  for(size_t c=0; c<m_jfa_machine.getDimC(); ++c)
+  PersonCache& cache = m_person_cache[k];
+  // the blocks are views of aliases private to this thread
+  const blitz::Array<double,3> A1_ = core::array::alias(m_cache_A1_x);
+  const blitz::Array<double,2> A2_ = core::array::alias(m_cache_A2_x);
+  blitz::Array<double,2> U_ = core::array::alias(U);
+  for(size_t c=begin; c<end; ++c)
   {
-    const blitz::Array<double,2> A1 = m_cache_A1_x(c,blitz::Range::all(),blitz::Range::all());
-    math::inv(A1, m_tmp_ruru);
-    const blitz::Array<double,2> A2 = m_cache_A2_x(blitz::Range(c*dim,(c+1)*dim-1),blitz::Range::all());
-    blitz::Array<double,2>& U = m_jfa_machine.updateU();
-    blitz::Array<double,2> U_c = U(blitz::Range(c*dim,(c+1)*dim-1),blitz::Range::all());
-    math::prod(A2, m_tmp_ruru, U_c);
+    const blitz::Array<double,2> A1 = A1_((int)c,blitz::Range::all(),blitz::Range::all());
+    math::inv(A1, cache.tmp_ruru);
+    const blitz::Array<double,2> A2 = A2_(blitz::Range(c*dim,(c+1)*dim-1),blitz::Range::all());
+    blitz::Array<double,2> U_c = U_(blitz::Range(c*dim,(c+1)*dim-1),blitz::Range::all());
+    math::prod(A2, cache.tmp_ruru, U_c);
   }
 }
 
+void train::JFABaseTrainer::updateUFromAccumulators()
+{
+  blitz::Array<double,2>& U = m_jfa_machine.updateU();
+  // Loops over the Gaussians, split across the threads
+  core::thread_iloop(boost::bind(&train::JFABaseTrainer::updateURange, this,
+        boost::ref(U), _1, _2, _3), m_jfa_machine.getDimC(), m_n_threads);
+  m_jfa_machine.precompute();
+}
+
 void train::JFABaseTrainer::computeDtSigmaInv()
 {
   const blitz::Array<double,1>& d = m_jfa_machine.getD();
@@ -968,85 +1311,192 @@ void train::JFABaseTrainer::computeDProd()
 }
 
 void train::JFABaseTrainer::computeIdPlusDProd_i(const size_t id)
+{
+  computeIdPlusDProd_i(id, m_person_cache[0]);
+}
+
+void train::JFABaseTrainer::computeIdPlusDProd_i(const size_t id, PersonCache& cache) const
 {
   const blitz::Array<double,1>& Ni = m_Nacc[id];
-  core::repelem(Ni, m_tmp_CD); // m_tmp_CD = Ni 'repmat'
-  m_cache_IdPlusDProd_i = 1.; // m_cache_IdPlusDProd_i = Id
-  m_cache_IdPlusDProd_i += m_cache_DProd * m_tmp_CD; // m_cache_IdPlusDProd_i = I+Dt*diag(sigma)^-1*Ni*D
-  m_cache_IdPlusDProd_i = 1 / m_cache_IdPlusDProd_i; // m_cache_IdPlusVProd_i = (I+Dt*diag(sigma)^-1*Ni*D)^-1
+  core::repelem(Ni, cache.tmp_CD); // tmp_CD = Ni 'repmat'
+  cache.IdPlusDProd_i = 1.; // IdPlusDProd_i = Id
+  cache.IdPlusDProd_i += m_cache_DProd * cache.tmp_CD; // IdPlusDProd_i = I+Dt*diag(sigma)^-1*Ni*D
+  cache.IdPlusDProd_i = 1 / cache.IdPlusDProd_i; // IdPlusDProd_i = (I+Dt*diag(sigma)^-1*Ni*D)^-1
 }
 
 void train::JFABaseTrainer::computeFn_z_i(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats, const size_t id)
+{
+  computeFn_z_i(cachedTrainingStats(stats), id, m_person_cache[0]);
+}
+
+void train::JFABaseTrainer::computeFn_z_i(const train::JFATrainingStats& stats, const size_t id)
+{
+  computeFn_z_i(stats, id, m_person_cache[0]);
+}
+
+void train::JFABaseTrainer::computeFn_z_i(const train::JFATrainingStats& stats, const size_t id, PersonCache& cache) const
 {
   // Compute Fn_z_i = sum_{sessions h}(N_{i,h}*(o_{i,h} - m - V*y_{i} - U*x_{i,h}) (Normalised first order statistics)
   const blitz::Array<double,1>& Fi = m_Facc[id];
   const blitz::Array<double,1>& m = m_cache_ubm_mean;
   const blitz::Array<double,2>& V = m_jfa_machine.getV();
   const blitz::Array<double,1>& y = m_y[id];
-  core::repelem(m_Nacc[id], m_tmp_CD);
-  math::prod(V, y, m_tmp_CD_b); // m_tmp_CD_b = V * y
-  m_cache_Fn_z_i = Fi - m_tmp_CD * (m + m_tmp_CD_b); // Fn_yi = sum_{sessions h}(N_{i,h}*(o_{i,h} - m - V*y_{i}) 
+  core::repelem(m_Nacc[id], cache.tmp_CD);
+  math::prod(V, y, cache.tmp_CD_b); // tmp_CD_b = V * y
+  cache.Fn_z_i = Fi - cache.tmp_CD * (m + cache.tmp_CD_b); // Fn_yi = sum_{sessions h}(N_{i,h}*(o_{i,h} - m - V*y_{i}) 
 
   const blitz::Array<double,2>& X = m_x[id];
   const blitz::Array<double,2>& U = m_jfa_machine.getU();
   for(int h=0; h<X.extent(1); ++h) // Loops over the sessions
   {
-    const blitz::Array<double,1>& Nh = stats[id][h]->n; // Nh = N_{i,h} (length: C)
-    core::repelem(Nh, m_tmp_CD);
+    const blitz::Array<double,1> Nh = stats.getN(stats.getOffsets()[id]+h); // Nh = N_{i,h} (length: C)
+    core::repelem(Nh, cache.tmp_CD);
     blitz::Array<double,1> Xh = X(blitz::Range::all(), h); // Xh = x_{i,h} (length: ru)
-    math::prod(U, Xh, m_tmp_CD_b);
-    m_cache_Fn_z_i -= m_tmp_CD * m_tmp_CD_b;
+    math::prod(U, Xh, cache.tmp_CD_b);
+    cache.Fn_z_i -= cache.tmp_CD * cache.tmp_CD_b;
   }
   // Fn_z_i = sum_{sessions h}(N_{i,h}*(o_{i,h} - m - V*y_{i} - U*x_{i,h})
 }
 
 void train::JFABaseTrainer::updateZ_i(const size_t id)
+{
+  updateZ_i(id, m_person_cache[0]);
+}
+
+void train::JFABaseTrainer::updateZ_i(const size_t id, PersonCache& cache)
 {
   // Computes zi = Azi * D^T.Sigma^-1 * Fn_zi
   blitz::Array<double,1>& z = m_z[id];
-  // m_tmp_CD = m_cache_DtSigmaInv * m_cache_Fn_z_i = Dt*diag(sigma)^-1 * sum_{sessions h}(N_{i,h}*(o_{i,h} - m - V*y_{i} - U*x_{i,h})
-  z = m_cache_IdPlusDProd_i * m_cache_DtSigmaInv * m_cache_Fn_z_i; 
+  // m_cache_DtSigmaInv * Fn_z_i = Dt*diag(sigma)^-1 * sum_{sessions h}(N_{i,h}*(o_{i,h} - m - V*y_{i} - U*x_{i,h})
+  z = cache.IdPlusDProd_i * m_cache_DtSigmaInv * cache.Fn_z_i; 
+}
+
+void train::JFABaseTrainer::updateZRange(const train::JFATrainingStats& stats, size_t k, size_t begin, size_t end)
+{
+  PersonCache& cache = m_person_cache[k];
+  for(size_t id=begin; id<end; ++id) {
+    computeIdPlusDProd_i(id, cache);
+    computeFn_z_i(stats, id, cache);
+    updateZ_i(id, cache);
+  }
 }
 
 void train::JFABaseTrainer::updateZ(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats)
+{
+  updateZ(cachedTrainingStats(stats, true));
+}
+
+void train::JFABaseTrainer::updateZ(const train::JFATrainingStats& stats)
 {
   // Precomputation
   computeDtSigmaInv();
   computeDProd();
-  // Loops over all people
-  for(size_t id=0; id<m_Nacc.size(); ++id) {
-    computeIdPlusDProd_i(id);
-    computeFn_z_i(stats, id);
-    updateZ_i(id);
-  }
+  // Loops over all people, split across the threads
+  core::thread_iloop(boost::bind(&train::JFABaseTrainer::updateZRange, this,
+        boost::cref(stats), _1, _2, _3), m_Nacc.size(), m_n_threads);
 }
 
 void train::JFABaseTrainer::updateD(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats)
 {
-  // Initializes the cache accumulator
-  m_cache_A1_z = 0.;
-  m_cache_A2_z = 0.;
-  // Loops over all people
-  blitz::firstIndex i;
-  blitz::secondIndex j; 
-  for(size_t id=0; id<m_Nacc.size(); ++id) {
-    computeIdPlusDProd_i(id);
-    computeFn_z_i(stats, id);
+  updateD(cachedTrainingStats(stats, true));
+}
+
+void train::JFABaseTrainer::updateD(const train::JFATrainingStats& stats)
+{
+  accumulateD(stats);
+  updateDFromAccumulators();
+}
+
+void train::JFABaseTrainer::accumulateDRange(const train::JFATrainingStats& stats, size_t k, size_t begin, size_t end)
+{
+  PersonCache& cache = m_person_cache[k];
+  // Initializes the partial accumulators
+  cache.A1_z = 0.;
+  cache.A2_z = 0.;
+  for(size_t id=begin; id<end; ++id) {
+    computeIdPlusDProd_i(id, cache);
+    computeFn_z_i(stats, id, cache);
 
     // Needs to return values to be accumulated for estimating D
     blitz::Array<double,1> z = m_z[id];
-    core::repelem(m_Nacc[id], m_tmp_CD);
-    m_cache_A1_z += (m_cache_IdPlusDProd_i + z * z) * m_tmp_CD;
-    m_cache_A2_z += m_cache_Fn_z_i * z;
+    core::repelem(m_Nacc[id], cache.tmp_CD);
+    cache.A1_z += (cache.IdPlusDProd_i + z * z) * cache.tmp_CD;
+    cache.A2_z += cache.Fn_z_i * z;
   } 
+}
+
+void train::JFABaseTrainer::accumulateD(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& stats)
+{
+  accumulateD(cachedTrainingStats(stats, true));
+}
+
+void train::JFABaseTrainer::accumulateD(const train::JFATrainingStats& stats)
+{
+  // Initializes the cache accumulator
+  m_cache_A1_z = 0.;
+  m_cache_A2_z = 0.;
+  // Loops over all people, split across the threads, and merges the partial
+  // accumulators in the order of the threads
+  const size_t n_blocks = core::thread_iloop(boost::bind(
+        &train::JFABaseTrainer::accumulateDRange, this, boost::cref(stats), 
+        _1, _2, _3), m_Nacc.size(), m_n_threads);
+  for(size_t k=0; k<n_blocks; ++k) {
+    m_cache_A1_z += m_person_cache[k].A1_z;
+    m_cache_A2_z += m_person_cache[k].A2_z;
+  }
+}
 
+void train::JFABaseTrainer::updateDFromAccumulators()
+{
   blitz::Array<double,1>& d = m_jfa_machine.updateD();
   d = m_cache_A2_z / m_cache_A1_z;
 }
 
+void train::JFABaseTrainer::setAccUA1(const blitz::Array<double,3>& acc)
+{
+  core::array::assertSameShape(acc, m_cache_A1_x);
+  m_cache_A1_x = acc;
+}
+
+void train::JFABaseTrainer::setAccUA2(const blitz::Array<double,2>& acc)
+{
+  core::array::assertSameShape(acc, m_cache_A2_x);
+  m_cache_A2_x = acc;
+}
+
+void train::JFABaseTrainer::setAccVA1(const blitz::Array<double,3>& acc)
+{
+  core::array::assertSameShape(acc, m_cache_A1_y);
+  m_cache_A1_y = acc;
+}
+
+void train::JFABaseTrainer::setAccVA2(const blitz::Array<double,2>& acc)
+{
+  core::array::assertSameShape(acc, m_cache_A2_y);
+  m_cache_A2_y = acc;
+}
+
+void train::JFABaseTrainer::setAccDA1(const blitz::Array<double,1>& acc)
+{
+  core::array::assertSameShape(acc, m_cache_A1_z);
+  m_cache_A1_z = acc;
+}
+
+void train::JFABaseTrainer::setAccDA2(const blitz::Array<double,1>& acc)
+{
+  core::array::assertSameShape(acc, m_cache_A2_z);
+  m_cache_A2_z = acc;
+}
+
 
 void train::JFABaseTrainer::train(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& vec,
   const size_t n_iter)
+{
+  train(toTrainingStats(vec), n_iter);
+}
+
+void train::JFABaseTrainer::train(const train::JFATrainingStats& vec,
+  const size_t n_iter)
 {
   initNid(vec);
   precomputeSumStatisticsN(vec);
@@ -1073,6 +1523,12 @@ void train::JFABaseTrainer::train(const std::vector<std::vector<boost::shared_pt
 
 void train::JFABaseTrainer::trainNoInit(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& vec,
   const size_t n_iter)
+{
+  trainNoInit(toTrainingStats(vec), n_iter);
+}
+
+void train::JFABaseTrainer::trainNoInit(const train::JFATrainingStats& vec,
+  const size_t n_iter)
 {
   initNid(vec);
   precomputeSumStatisticsN(vec);
@@ -1110,6 +1566,12 @@ void train::JFABaseTrainer::initializeVD_ISV(const double relevance_factor)
 
 void train::JFABaseTrainer::trainISV(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& vec,
   const size_t n_iter, const double relevance_factor)
+{
+  trainISV(toTrainingStats(vec), n_iter, relevance_factor);
+}
+
+void train::JFABaseTrainer::trainISV(const train::JFATrainingStats& vec,
+  const size_t n_iter, const double relevance_factor)
 {
   initNid(vec);
   precomputeSumStatisticsN(vec);
@@ -1128,6 +1590,12 @@ void train::JFABaseTrainer::trainISV(const std::vector<std::vector<boost::shared
 
 void train::JFABaseTrainer::trainISVNoInit(const std::vector<std::vector<boost::shared_ptr<const bob::machine::GMMStats> > >& vec,
   const size_t n_iter, const double relevance_factor)
+{
+  trainISVNoInit(toTrainingStats(vec), n_iter, relevance_factor);
+}
+
+void train::JFABaseTrainer::trainISVNoInit(const train::JFATrainingStats& vec,
+  const size_t n_iter, const double relevance_factor)
 {
   initNid(vec);
   precomputeSumStatisticsN(vec);
@@ -1144,6 +1612,62 @@ void train::JFABaseTrainer::trainISVNoInit(const std::vector<std::vector<boost::
 }
 
 
+void train::JFABaseTrainer::enrol(const train::JFATrainingStats& stats, 
+  const size_t n_iter)
+{
+  initNid(stats);
+  precomputeSumStatisticsN(stats);
+  precomputeSumStatisticsF(stats);
+
+  initializeXYZ(stats);
+
+  for(size_t i=0; i<n_iter; ++i) {
+    updateY(stats);
+    updateX(stats);
+    updateZ(stats);
+  }
+}
+
+void train::JFABaseTrainer::enrol(const train::JFATrainingStats& stats, 
+  const std::vector<boost::shared_ptr<mach::JFAMachine> >& models,
+  const size_t n_iter)
+{
+  core::array::assertSameDimensionLength(stats.getNPersons(), models.size());
+  for(size_t i=0; i<models.size(); ++i) {
+    // The models should be attached to the JFABaseMachine of this trainer
+    if(models[i]->getJFABase().get() != &m_jfa_machine)
+      throw train::IncompatibleMachine();
+    if(models[i]->getDimRv() != m_jfa_machine.getDimRv())
+      throw bob::io::DimensionError(models[i]->getDimRv(), m_jfa_machine.getDimRv());
+    if(models[i]->getDimCD() != m_jfa_machine.getDimCD())
+      throw bob::io::DimensionError(models[i]->getDimCD(), m_jfa_machine.getDimCD());
+  }
+
+  enrol(stats, n_iter);
+  for(size_t i=0; i<models.size(); ++i) {
+    models[i]->setY(m_y[i]);
+    models[i]->setZ(m_z[i]);
+  }
+}
+
+void train::JFABaseTrainer::enrol(const train::JFATrainingStats& stats, 
+  const blitz::Array<int64_t,1>& ids, mach::ModelBank& bank, 
+  const size_t n_iter)
+{
+  core::array::assertSameDimensionLength(stats.getNPersons(), ids.extent(0));
+
+  enrol(stats, n_iter);
+  // The factors are written into the bank at once
+  blitz::Array<double,2> y(m_Nid, m_jfa_machine.getDimRv());
+  blitz::Array<double,2> z(m_Nid, m_jfa_machine.getDimCD());
+  for(size_t i=0; i<m_Nid; ++i) {
+    y((int)i, blitz::Range::all()) = m_y[i];
+    z((int)i, blitz::Range::all()) = m_z[i];
+  }
+  bank.set(ids, "y", y);
+  bank.set(ids, "z", z);
+}
+
 
 train::JFATrainer::JFATrainer(mach::JFAMachine& jfa_machine, train::JFABaseTrainer& base_trainer): 
   m_jfa_machine(jfa_machine),
@@ -1154,19 +1678,9 @@ train::JFATrainer::JFATrainer(mach::JFAMachine& jfa_machine, train::JFABaseTrain
 void train::JFATrainer::enrol(const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& vec,
   const size_t n_iter)
 {
-  std::vector< std::vector<boost::shared_ptr<const mach::GMMStats> > > vvec;
-  vvec.push_back(vec);
-  m_base_trainer.initNid(1);
-  m_base_trainer.precomputeSumStatisticsN(vvec);
-  m_base_trainer.precomputeSumStatisticsF(vvec);
-
-  m_base_trainer.initializeXYZ(vvec);
-  
-  for(size_t i=0; i<n_iter; ++i) {
-    m_base_trainer.updateY(vvec);
-    m_base_trainer.updateX(vvec);
-    m_base_trainer.updateZ(vvec);
-  }
+  train::JFATrainingStats vvec(m_jfa_machine.getDimC(), m_jfa_machine.getDimD());
+  vvec.addPerson(vec);
+  m_base_trainer.enrol(vvec, n_iter);
 
   const blitz::Array<double,1> y(m_base_trainer.getY()[0]);
   const blitz::Array<double,1> z(m_base_trainer.getZ()[0]);
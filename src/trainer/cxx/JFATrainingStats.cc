@@ -0,0 +1,201 @@
+/**
+ * @file trainer/cxx/JFATrainingStats.cc
+ * @date Mon Oct 19 22:41:05 2026 +0200
+ *
+ * @brief Implements the compact storage of the JFA training statistics
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bob/trainer/JFATrainingStats.h"
+#include "bob/io/HDF5File.h"
+#include "bob/io/Exception.h"
+#include "bob/core/Exception.h"
+#include <algorithm>
+#include <stdint.h>
+
+bob::trainer::JFATrainingStats::JFATrainingStats(const size_t n_gaussians,
+    const size_t n_inputs, const bool use_float):
+  m_n_gaussians(n_gaussians), m_n_inputs(n_inputs), m_use_float(use_float),
+  m_offsets(1, 0)
+{
+  if (n_gaussians == 0)
+    throw bob::core::InvalidArgumentException("n_gaussians", n_gaussians);
+  if (n_inputs == 0)
+    throw bob::core::InvalidArgumentException("n_inputs", n_inputs);
+}
+
+void bob::trainer::JFATrainingStats::reserve(const size_t n_sessions) {
+  const size_t CD = m_n_gaussians * m_n_inputs;
+  m_n.reserve(n_sessions * m_n_gaussians);
+  if (m_use_float) m_f_float.reserve(n_sessions * CD);
+  else m_f.reserve(n_sessions * CD);
+}
+
+void bob::trainer::JFATrainingStats::clear() {
+  m_offsets.assign(1, 0);
+  m_n.clear();
+  m_f.clear();
+  m_f_float.clear();
+}
+
+size_t bob::trainer::JFATrainingStats::addSession() {
+  const size_t session = m_n.size() / m_n_gaussians;
+  m_n.resize(m_n.size() + m_n_gaussians);
+  if (m_use_float) m_f_float.resize(m_f_float.size() + m_n_gaussians * m_n_inputs);
+  else m_f.resize(m_f.size() + m_n_gaussians * m_n_inputs);
+  return session;
+}
+
+void bob::trainer::JFATrainingStats::addPerson
+(const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& sessions) {
+  for (size_t h=0; h<sessions.size(); ++h) {
+    if (sessions[h]->n.extent(0) != (int)m_n_gaussians)
+      throw bob::io::DimensionError(sessions[h]->n.extent(0), m_n_gaussians);
+    if (sessions[h]->sumPx.extent(0) != (int)m_n_gaussians)
+      throw bob::io::DimensionError(sessions[h]->sumPx.extent(0), m_n_gaussians);
+    if (sessions[h]->sumPx.extent(1) != (int)m_n_inputs)
+      throw bob::io::DimensionError(sessions[h]->sumPx.extent(1), m_n_inputs);
+  }
+
+  const size_t C = m_n_gaussians;
+  const size_t CD = m_n_gaussians * m_n_inputs;
+  for (size_t h=0; h<sessions.size(); ++h) {
+    const size_t s = addSession();
+    std::copy(sessions[h]->n.begin(), sessions[h]->n.end(), m_n.begin() + s*C);
+    // sumPx is C x D, and is stored as a row of length CD
+    if (m_use_float) {
+      blitz::Array<float,2> F(&m_f_float[s*CD], blitz::shape(C, m_n_inputs),
+          blitz::neverDeleteData);
+      F = blitz::cast<float>(sessions[h]->sumPx);
+    }
+    else {
+      blitz::Array<double,2> F(&m_f[s*CD], blitz::shape(C, m_n_inputs),
+          blitz::neverDeleteData);
+      F = sessions[h]->sumPx;
+    }
+  }
+  m_offsets.push_back(m_offsets.back() + sessions.size());
+}
+
+void bob::trainer::JFATrainingStats::addPerson
+(const std::vector<std::string>& filenames) {
+  const size_t C = m_n_gaussians;
+  const size_t CD = m_n_gaussians * m_n_inputs;
+  const size_t n_sessions = getNSessions();
+  try {
+    for (size_t h=0; h<filenames.size(); ++h) {
+      bob::io::HDF5File file(filenames[h], bob::io::HDF5File::in);
+      const int64_t n_gaussians = file.read<int64_t>("n_gaussians");
+      const int64_t n_inputs = file.read<int64_t>("n_inputs");
+      if (n_gaussians != (int64_t)m_n_gaussians)
+        throw bob::io::DimensionError(n_gaussians, m_n_gaussians);
+      if (n_inputs != (int64_t)m_n_inputs)
+        throw bob::io::DimensionError(n_inputs, m_n_inputs);
+
+      // The statistics are read in place, sumPxx being skipped
+      const size_t s = addSession();
+      blitz::Array<double,1> N(&m_n[s*C], blitz::shape(C), blitz::neverDeleteData);
+      file.readFloatArray("n", N);
+      if (m_use_float) {
+        blitz::Array<float,2> F(&m_f_float[s*CD], blitz::shape(C, m_n_inputs),
+            blitz::neverDeleteData);
+        file.readFloatArray("sumPx", F);
+      }
+      else {
+        blitz::Array<double,2> F(&m_f[s*CD], blitz::shape(C, m_n_inputs),
+            blitz::neverDeleteData);
+        file.readFloatArray("sumPx", F);
+      }
+    }
+  }
+  catch (...) {
+    // Drops the sessions of the incomplete person
+    m_n.resize(n_sessions * C);
+    if (m_use_float) m_f_float.resize(n_sessions * CD);
+    else m_f.resize(n_sessions * CD);
+    throw;
+  }
+  m_offsets.push_back(m_offsets.back() + filenames.size());
+}
+
+void bob::trainer::JFATrainingStats::load
+(const std::vector<std::vector<std::string> >& filenames) {
+  size_t n_sessions = getNSessions();
+  for (size_t i=0; i<filenames.size(); ++i) n_sessions += filenames[i].size();
+  reserve(n_sessions);
+  for (size_t i=0; i<filenames.size(); ++i) addPerson(filenames[i]);
+}
+
+const blitz::Array<double,2> bob::trainer::JFATrainingStats::getN() const {
+  if (m_n.empty()) return blitz::Array<double,2>(0, m_n_gaussians);
+  return blitz::Array<double,2>(const_cast<double*>(&m_n[0]),
+      blitz::shape(getNSessions(), m_n_gaussians), blitz::neverDeleteData);
+}
+
+const blitz::Array<double,1> bob::trainer::JFATrainingStats::getN
+(const size_t session) const {
+  return blitz::Array<double,1>(const_cast<double*>(&m_n[session*m_n_gaussians]),
+      blitz::shape(m_n_gaussians), blitz::neverDeleteData);
+}
+
+blitz::Array<double,2> bob::trainer::JFATrainingStats::getF() const {
+  const size_t CD = m_n_gaussians * m_n_inputs;
+  blitz::Array<double,2> F(getNSessions(), CD);
+  for (size_t s=0; s<getNSessions(); ++s) {
+    blitz::Array<double,1> F_s = F(s, blitz::Range::all());
+    getF(s, F_s);
+  }
+  return F;
+}
+
+void bob::trainer::JFATrainingStats::getF(const size_t session,
+    blitz::Array<double,1>& F) const {
+  const size_t CD = m_n_gaussians * m_n_inputs;
+  if (m_use_float) {
+    const float* f = &m_f_float[session*CD];
+    for (size_t k=0; k<CD; ++k) F((int)k) = f[k];
+  }
+  else {
+    const double* f = &m_f[session*CD];
+    for (size_t k=0; k<CD; ++k) F((int)k) = f[k];
+  }
+}
+
+void bob::trainer::JFATrainingStats::sumN(const size_t person,
+    blitz::Array<double,1>& N) const {
+  const size_t C = m_n_gaussians;
+  N = 0.;
+  for (size_t s=m_offsets[person]; s<m_offsets[person+1]; ++s) {
+    const double* n = &m_n[s*C];
+    for (size_t c=0; c<C; ++c) N((int)c) += n[c];
+  }
+}
+
+void bob::trainer::JFATrainingStats::sumF(const size_t person,
+    blitz::Array<double,1>& F) const {
+  const size_t CD = m_n_gaussians * m_n_inputs;
+  F = 0.;
+  for (size_t s=m_offsets[person]; s<m_offsets[person+1]; ++s) {
+    if (m_use_float) {
+      const float* f = &m_f_float[s*CD];
+      for (size_t k=0; k<CD; ++k) F((int)k) += f[k];
+    }
+    else {
+      const double* f = &m_f[s*CD];
+      for (size_t k=0; k<CD; ++k) F((int)k) += f[k];
+    }
+  }
+}
@@ -23,25 +23,28 @@
 #include "bob/core/array_copy.h"
 #include "bob/trainer/Exception.h"
 #include <boost/random.hpp>
+#include <boost/bind.hpp>
 
 bob::trainer::KMeansTrainer::KMeansTrainer(double convergence_threshold,
     size_t max_iterations, bool compute_likelihood, bool check_no_duplicate):
-  bob::trainer::EMTrainer<bob::machine::KMeansMachine, blitz::Array<double,2> >(
+  bob::trainer::ParallelEMTrainer<bob::machine::KMeansMachine, bob::trainer::KMeansAccumulator>(
     convergence_threshold, max_iterations, compute_likelihood), 
   m_check_no_duplicate(check_no_duplicate),
-  m_seed(-1), m_average_min_distance(0),
-  m_zeroethOrderStats(0), m_firstOrderStats(0,0)
+  m_seed(-1), m_average_min_distance(0)
 {
+  m_acc.sumMinDistance = 0;
 }
 
 bob::trainer::KMeansTrainer::KMeansTrainer(const bob::trainer::KMeansTrainer& other):
-  bob::trainer::EMTrainer<bob::machine::KMeansMachine, blitz::Array<double,2> >(
-    other.m_convergence_threshold, other.m_max_iterations, other.m_compute_likelihood), 
+  bob::trainer::ParallelEMTrainer<bob::machine::KMeansMachine, bob::trainer::KMeansAccumulator>(
+    other.m_convergence_threshold, other.m_max_iterations, other.m_compute_likelihood,
+    other.m_n_threads), 
   m_check_no_duplicate(other.m_check_no_duplicate),
-  m_seed(other.m_seed), m_average_min_distance(other.m_average_min_distance),
-  m_zeroethOrderStats(bob::core::array::ccopy(other.m_zeroethOrderStats)), 
-  m_firstOrderStats(bob::core::array::ccopy(other.m_firstOrderStats))
+  m_seed(other.m_seed), m_average_min_distance(other.m_average_min_distance)
 {
+  m_acc.zeroethOrderStats.reference(bob::core::array::ccopy(other.m_acc.zeroethOrderStats));
+  m_acc.firstOrderStats.reference(bob::core::array::ccopy(other.m_acc.firstOrderStats));
+  m_acc.sumMinDistance = other.m_acc.sumMinDistance;
 }
  
 bob::trainer::KMeansTrainer& bob::trainer::KMeansTrainer::operator=
@@ -50,11 +53,13 @@ bob::trainer::KMeansTrainer& bob::trainer::KMeansTrainer::operator=
   if(this != &other)
   {
     EMTrainer<bob::machine::KMeansMachine, blitz::Array<double,2> >::operator=(other);
+    m_n_threads = other.m_n_threads;
     m_check_no_duplicate = other.m_check_no_duplicate;
     m_seed = other.m_seed;
     m_average_min_distance = other.m_average_min_distance;
-    m_zeroethOrderStats.reference(bob::core::array::ccopy(other.m_zeroethOrderStats));
-    m_firstOrderStats.reference(bob::core::array::ccopy(other.m_firstOrderStats));
+    m_acc.zeroethOrderStats.reference(bob::core::array::ccopy(other.m_acc.zeroethOrderStats));
+    m_acc.firstOrderStats.reference(bob::core::array::ccopy(other.m_acc.firstOrderStats));
+    m_acc.sumMinDistance = other.m_acc.sumMinDistance;
   }
   return *this;
 }
@@ -63,21 +68,44 @@ bool bob::trainer::KMeansTrainer::operator==(const bob::trainer::KMeansTrainer&
   return EMTrainer<bob::machine::KMeansMachine, blitz::Array<double,2> >::operator==(b) &&
          m_check_no_duplicate == b.m_check_no_duplicate &&
          m_seed == b.m_seed && m_average_min_distance == b.m_average_min_distance &&
-         bob::core::array::hasSameShape(m_zeroethOrderStats, b.m_zeroethOrderStats) &&
-         bob::core::array::hasSameShape(m_firstOrderStats, b.m_firstOrderStats) &&
-         blitz::all(m_zeroethOrderStats == b.m_zeroethOrderStats) &&
-         blitz::all(m_firstOrderStats == b.m_firstOrderStats);
+         bob::core::array::hasSameShape(m_acc.zeroethOrderStats, b.m_acc.zeroethOrderStats) &&
+         bob::core::array::hasSameShape(m_acc.firstOrderStats, b.m_acc.firstOrderStats) &&
+         blitz::all(m_acc.zeroethOrderStats == b.m_acc.zeroethOrderStats) &&
+         blitz::all(m_acc.firstOrderStats == b.m_acc.firstOrderStats);
 }
 
 bool bob::trainer::KMeansTrainer::operator!=(const bob::trainer::KMeansTrainer& b) const {
   return !(this->operator==(b));
 }
  
+/**
+ * Copies the given row of the data
+ */
+static void copy_row(const blitz::Array<double,2>& ar, const size_t index,
+  blitz::Array<double,1>& x)
+{
+  x = ar((int)index, blitz::Range::all());
+}
+
 void bob::trainer::KMeansTrainer::initialization(bob::machine::KMeansMachine& kmeans,
   const blitz::Array<double,2>& ar) 
+{
+  initializeMeans(kmeans, ar.extent(0), boost::bind(&copy_row, boost::cref(ar), _1, _2));
+}
+
+void bob::trainer::KMeansTrainer::initialization(bob::machine::KMeansMachine& kmeans,
+  bob::trainer::BlockSampler& sampler) 
+{
+  // The (few) selected samples are read with random accesses
+  initializeMeans(kmeans, sampler.size(), 
+    boost::bind(&bob::trainer::BlockSampler::sample, boost::ref(sampler), _1, _2));
+}
+
+void bob::trainer::KMeansTrainer::initializeMeans(bob::machine::KMeansMachine& kmeans,
+  const size_t n_data, 
+  const boost::function<void (size_t, blitz::Array<double,1>&)>& get_sample)
 {
   // split data into as many chunks as there are means
-  size_t n_data = ar.extent(0);
   unsigned int n_chunk = n_data / kmeans.getNMeans();
   size_t n_max_trials = (size_t)n_chunk * 5;
   blitz::Array<double,1> cur_mean;
@@ -88,7 +116,7 @@ void bob::trainer::KMeansTrainer::initialization(bob::machine::KMeansMachine& km
   if(m_seed != -1) rng.seed((uint32_t)m_seed);
   
   // assign the i'th mean to a random example within the i'th chunk
-  blitz::Range a = blitz::Range::all();
+  blitz::Array<double,1> mean(kmeans.getNInputs());
   for(size_t i=0; i<kmeans.getNMeans(); ++i) 
   {
     boost::uniform_int<> range(i*n_chunk, (i+1)*n_chunk-1);
@@ -98,7 +126,7 @@ void bob::trainer::KMeansTrainer::initialization(bob::machine::KMeansMachine& km
     unsigned int index = die();
 
     // get the example at that index
-    blitz::Array<double, 1> mean = ar(index,a);
+    get_sample(index, mean);
 
     if(m_check_no_duplicate)
     {
@@ -119,7 +147,7 @@ void bob::trainer::KMeansTrainer::initialization(bob::machine::KMeansMachine& km
         else
         {
           index = die();
-          mean = ar(index,a);
+          get_sample(index, mean);
           ++count;
         }
       }
@@ -133,19 +161,35 @@ void bob::trainer::KMeansTrainer::initialization(bob::machine::KMeansMachine& km
   }
 
   // Resize the accumulator
-  m_zeroethOrderStats.resize(kmeans.getNMeans());
-  m_firstOrderStats.resize(kmeans.getNMeans(), kmeans.getNInputs());
+  m_acc.zeroethOrderStats.resize(kmeans.getNMeans());
+  m_acc.firstOrderStats.resize(kmeans.getNMeans(), kmeans.getNInputs());
+}
+
+void bob::trainer::KMeansTrainer::resetAccumulator(const bob::machine::KMeansMachine& kmeans,
+  bob::trainer::KMeansAccumulator& acc) const
+{
+  acc.zeroethOrderStats.resize(kmeans.getNMeans());
+  acc.firstOrderStats.resize(kmeans.getNMeans(), kmeans.getNInputs());
+  acc.zeroethOrderStats = 0;
+  acc.firstOrderStats = 0;
+  acc.sumMinDistance = 0;
 }
 
-void bob::trainer::KMeansTrainer::eStep(bob::machine::KMeansMachine& kmeans, 
-  const blitz::Array<double,2>& ar)
+void bob::trainer::KMeansTrainer::mergeAccumulator(bob::trainer::KMeansAccumulator& acc,
+  const bob::trainer::KMeansAccumulator& other) const
 {
-  // initialise the accumulators
-  resetAccumulators(kmeans);
+  acc.zeroethOrderStats += other.zeroethOrderStats;
+  acc.firstOrderStats += other.firstOrderStats;
+  acc.sumMinDistance += other.sumMinDistance;
+}
 
+void bob::trainer::KMeansTrainer::eStepRange(const bob::machine::KMeansMachine& kmeans, 
+  const blitz::Array<double,2>& ar, bob::trainer::KMeansAccumulator& acc,
+  const size_t begin, const size_t end) const
+{
   // iterate over data samples
   blitz::Range a = blitz::Range::all();
-  for(int i=0; i<ar.extent(0); ++i) {
+  for(int i=(int)begin; i<(int)end; ++i) {
     // get example
     blitz::Array<double, 1> x(ar(i,a));
 
@@ -155,11 +199,16 @@ void bob::trainer::KMeansTrainer::eStep(bob::machine::KMeansMachine& kmeans,
     kmeans.getClosestMean(x,closest_mean,min_distance);
 
     // accumulate the stats
-    m_average_min_distance += min_distance;
-    ++m_zeroethOrderStats(closest_mean);
-    m_firstOrderStats(closest_mean,blitz::Range::all()) += x;
+    acc.sumMinDistance += min_distance;
+    ++acc.zeroethOrderStats(closest_mean);
+    acc.firstOrderStats(closest_mean,blitz::Range::all()) += x;
   }
-  m_average_min_distance /= static_cast<double>(ar.extent(0));
+}
+
+void bob::trainer::KMeansTrainer::eStepMerged(bob::machine::KMeansMachine& kmeans, 
+  const size_t n_samples)
+{
+  m_average_min_distance = m_acc.sumMinDistance / static_cast<double>(n_samples);
 }
 
 void bob::trainer::KMeansTrainer::mStep(bob::machine::KMeansMachine& kmeans, 
@@ -169,7 +218,7 @@ void bob::trainer::KMeansTrainer::mStep(bob::machine::KMeansMachine& kmeans,
   for(size_t i=0; i<kmeans.getNMeans(); ++i)
   {
     means(i,blitz::Range::all()) = 
-      m_firstOrderStats(i,blitz::Range::all()) / m_zeroethOrderStats(i);
+      m_acc.firstOrderStats(i,blitz::Range::all()) / m_acc.zeroethOrderStats(i);
   }
 }
 
@@ -186,8 +235,7 @@ void bob::trainer::KMeansTrainer::finalization(bob::machine::KMeansMachine& kmea
 bool bob::trainer::KMeansTrainer::resetAccumulators(bob::machine::KMeansMachine& kmeans)
 {
   m_average_min_distance = 0;
-  m_zeroethOrderStats = 0;
-  m_firstOrderStats = 0;
+  resetAccumulator(kmeans, m_acc);
   return true;
 }
 
@@ -197,13 +245,13 @@ void bob::trainer::KMeansTrainer::setSeed(int seed) {
 
 void bob::trainer::KMeansTrainer::setZeroethOrderStats(const blitz::Array<double,1>& zeroethOrderStats)
 {
-  bob::core::array::assertSameShape(m_zeroethOrderStats, zeroethOrderStats);
-  m_zeroethOrderStats = zeroethOrderStats;
+  bob::core::array::assertSameShape(m_acc.zeroethOrderStats, zeroethOrderStats);
+  m_acc.zeroethOrderStats = zeroethOrderStats;
 }
 
 void bob::trainer::KMeansTrainer::setFirstOrderStats(const blitz::Array<double,2>& firstOrderStats)
 {
-  bob::core::array::assertSameShape(m_firstOrderStats, firstOrderStats);
-  m_firstOrderStats = firstOrderStats;
+  bob::core::array::assertSameShape(m_acc.firstOrderStats, firstOrderStats);
+  m_acc.firstOrderStats = firstOrderStats;
 }
 
@@ -23,13 +23,17 @@
 #include "bob/math/linear.h"
 
 #include "bob/core/logging.h"
+#include "bob/core/parallel.h"
+#include "bob/lbfgs/lbfgs.h"
 
 #include <limits>
+#include <vector>
+#include <boost/bind.hpp>
 
 bob::trainer::LLRTrainer::LLRTrainer(const double prior, 
   const double convergence_threshold, const size_t max_iterations):
     m_prior(prior), m_convergence_threshold(convergence_threshold), 
-    m_max_iterations(max_iterations)
+    m_max_iterations(max_iterations), m_n_threads(1), m_use_lbfgs(false)
 {
   if(prior<=0. || prior>=1.) 
     throw bob::trainer::LLRPriorNotInRange(prior);
@@ -38,7 +42,9 @@ bob::trainer::LLRTrainer::LLRTrainer(const double prior,
 bob::trainer::LLRTrainer::LLRTrainer(const bob::trainer::LLRTrainer& other):
   m_prior(other.m_prior),
   m_convergence_threshold(other.m_convergence_threshold), 
-  m_max_iterations(other.m_max_iterations)
+  m_max_iterations(other.m_max_iterations),
+  m_n_threads(other.m_n_threads),
+  m_use_lbfgs(other.m_use_lbfgs)
 {
 }
 
@@ -52,6 +58,8 @@ bob::trainer::LLRTrainer& bob::trainer::LLRTrainer::operator=
     m_prior = other.m_prior;
     m_convergence_threshold = other.m_convergence_threshold;
     m_max_iterations = other.m_max_iterations;
+    m_n_threads = other.m_n_threads;
+    m_use_lbfgs = other.m_use_lbfgs;
   }
   return *this;
 }
@@ -61,7 +69,9 @@ bob::trainer::LLRTrainer::operator==(const bob::trainer::LLRTrainer& b) const
 {
   return (this->m_prior == b.m_prior &&
           this->m_convergence_threshold == b.m_convergence_threshold &&
-          this->m_max_iterations == b.m_max_iterations);
+          this->m_max_iterations == b.m_max_iterations &&
+          this->m_n_threads == b.m_n_threads &&
+          this->m_use_lbfgs == b.m_use_lbfgs);
 }
 
 bool 
@@ -70,133 +80,345 @@ bob::trainer::LLRTrainer::operator!=(const bob::trainer::LLRTrainer& b) const
   return !(this->operator==(b));
 }
 
-void bob::trainer::LLRTrainer::train(bob::machine::LinearMachine& machine, 
-  const blitz::Array<double,2>& ar1, const blitz::Array<double,2>& ar2) const 
-{
-  // Checks for arraysets data type and shape once
-  if(ar1.extent(1) != ar2.extent(1)) 
-    throw bob::io::DimensionError(ar1.extent(1), ar2.extent(1));
 
-  // Data is checked now and conforms, just proceed w/o any further checks.
-  size_t n_samples1 = ar1.extent(0);
-  size_t n_samples2 = ar2.extent(0);
-  size_t n_samples = n_samples1 + n_samples2;
-  size_t n_features = ar1.extent(1);
+namespace {
 
-  // Defines useful ranges  
-  blitz::Range rall = blitz::Range::all();
-  blitz::Range rd = blitz::Range(0,n_features-1);
-  blitz::Range r1 = blitz::Range(0,n_samples1-1);
-  blitz::Range r2 = blitz::Range(n_samples1,n_samples-1);
-
-  // Creates a large blitz::Array containing the samples
-  // x = |ar1 -ar2|, of size (n_features+1,n_samples1+n_samples2)
-  //     |1.  -1. |
-  blitz::Array<double,2> x(n_features+1, n_samples);
-  x(n_features,r1) = 1.;
-  x(n_features,r2) = -1.;
-  for(size_t i=0; i<n_samples1; ++i)
-    x(rd,i) = ar1(i,rall);
-  for(size_t i=0; i<n_samples2; ++i)
-    x(rd,i+n_samples1) = -ar2(i,rall);
-
-  // Ratio between the two classes and weights vector
-  double prop = (double)n_samples1 / (double)n_samples;
-  blitz::Array<double,1> weights(n_samples);
-  weights(r1) = m_prior / prop;
-  weights(r2) = (1.-m_prior) / (1.-prop);
-  
-  // Initializes offset vector
-  blitz::Array<double,1> offset(n_samples);
-  const double logit = log(m_prior/(1.-m_prior));
-  offset(r1) = logit;
-  offset(r2) = -logit;
-
-  // Initializes gradient and w vectors
-  blitz::Array<double,1> g_old(n_features+1);
-  blitz::Array<double,1> w_old(n_features+1);
-  blitz::Array<double,1> g(n_features+1);
-  blitz::Array<double,1> w(n_features+1);
-  g_old = 0.;
-  w_old = 0.;
-  g = 0.;
-  w = 0.;
+  /**
+   * The samples of one of the two classes, given either as a 2D array or
+   * streamed by a BlockSampler
+   */
+  struct LLRClass {
+    const blitz::Array<double,2>* array;
+    bob::trainer::BlockSampler* sampler;
+    size_t n_samples;
+    double sign; ///< y_i: +1 for the first class, -1 for the second one
+    double weight; ///< prior/proportion of the class
+  };
+
+  /**
+   * Sums over a range of samples
+   */
+  struct LLRSums {
+    blitz::Array<double,1> g; ///< gradient of the log-likelihood
+    double f; ///< negative log-likelihood
+    double uhu; ///< u^T H u
+  };
 
-  // Initialize working arrays
-  blitz::Array<double,1> s1(n_samples);
-  blitz::Array<double,1> u(n_features+1);
-  blitz::Array<double,1> tmp_n(n_samples);
-  blitz::Array<double,1> tmp_d(n_features+1);
-
-  // Iterates...
-  blitz::firstIndex i;
-  blitz::secondIndex j;
-  static const double ten_epsilon = 10*std::numeric_limits<double>::epsilon();
-  for(size_t iter=0; ; ++iter) 
+  /**
+   * The weighted log-likelihood of the samples and its derivatives, for the
+   * weights w = [w_d, bias]. With t_i = w_d^T x_i + bias + logit and 
+   * z_i = y_i t_i, the (weighted) log-likelihood is 
+   *   L(w) = - sum_i weight_i log(1 + exp(-z_i))
+   * Samples are never copied: the sums are accumulated over the blocks of
+   * samples, each block being split across several threads.
+   */
+  class LLRProblem {
+
+    public:
+
+      LLRProblem(const LLRClass& class1, const LLRClass& class2, 
+          const size_t n_features, const double logit, const size_t n_threads):
+        m_n_features(n_features), m_logit(logit), 
+        m_n_threads(n_threads > 0 ? n_threads : 1), m_partial(m_n_threads),
+        m_compute_f(false)
+      {
+        m_classes[0] = class1;
+        m_classes[1] = class2;
+        m_sums.g.resize(n_features+1);
+        for(size_t k=0; k<m_n_threads; ++k) m_partial[k].g.resize(n_features+1);
+      }
+
+      size_t getNSamples() const 
+      { return m_classes[0].n_samples + m_classes[1].n_samples; }
+
+      /**
+       * Computes the gradient g of L(w) and, if required, f = -L(w)
+       */
+      void gradient(const blitz::Array<double,1>& w, 
+          blitz::Array<double,1>& g, double& f, const bool compute_f)
+      {
+        m_w.reference(w);
+        m_compute_f = compute_f;
+        accumulate(true);
+        g = m_sums.g;
+        f = m_sums.f;
+      }
+
+      /**
+       * Computes u^T H u, where H is the Hessian of -L(w)
+       */
+      double curvature(const blitz::Array<double,1>& w, 
+          const blitz::Array<double,1>& u)
+      {
+        m_w.reference(w);
+        m_u.reference(u);
+        accumulate(false);
+        return m_sums.uhu;
+      }
+
+    private:
+
+      void reset(LLRSums& s) const {
+        s.g = 0.;
+        s.f = 0.;
+        s.uhu = 0.;
+      }
+
+      void merge(LLRSums& s, const LLRSums& other) const {
+        s.g += other.g;
+        s.f += other.f;
+        s.uhu += other.uhu;
+      }
+
+      /**
+       * Makes a pass over the samples of both classes
+       */
+      void accumulate(const bool gradient) {
+        reset(m_sums);
+        for(size_t c=0; c<2; ++c) {
+          const LLRClass& cl = m_classes[c];
+          if(cl.array) 
+            accumulateBlock(gradient, cl, *cl.array);
+          else {
+            blitz::Array<double,2> block;
+            cl.sampler->reset();
+            while(cl.sampler->next(block)) accumulateBlock(gradient, cl, block);
+          }
+        }
+      }
+
+      /**
+       * Splits a block of samples across the threads, and merges the sums
+       * of the threads (in order)
+       */
+      void accumulateBlock(const bool gradient, const LLRClass& cl, 
+          const blitz::Array<double,2>& x) {
+        if(x.extent(0) == 0) return;
+        if(m_n_threads <= 1) {
+          reset(m_partial[0]);
+          range(gradient, cl, x, 0, 0, x.extent(0));
+          merge(m_sums, m_partial[0]);
+        }
+        else {
+          const size_t n_blocks = bob::core::thread_iloop(boost::bind(
+                &LLRProblem::rangeThread, this, gradient, boost::cref(cl), 
+                boost::cref(x), _1, _2, _3), x.extent(0), m_n_threads);
+          for(size_t k=0; k<n_blocks; ++k) merge(m_sums, m_partial[k]);
+        }
+      }
+
+      void rangeThread(const bool gradient, const LLRClass& cl, 
+          const blitz::Array<double,2>& x, const size_t k, const size_t begin,
+          const size_t end) {
+        reset(m_partial[k]);
+        range(gradient, cl, x, k, begin, end);
+      }
+
+      /**
+       * Accumulates the sums of the samples [begin, end) of x into 
+       * m_partial[k]
+       */
+      void range(const bool gradient, const LLRClass& cl, 
+          const blitz::Array<double,2>& x, const size_t k, const size_t begin,
+          const size_t end) {
+        LLRSums& s = m_partial[k];
+        const int D = static_cast<int>(m_n_features);
+        for(int i=static_cast<int>(begin); i<static_cast<int>(end); ++i) {
+          double t = m_w(D) + m_logit;
+          for(int d=0; d<D; ++d) t += m_w(d) * x(i,d);
+          const double z = cl.sign * t;
+          // s1 = 1 / (1 + exp(z_i)) = 1 - sigmoid(z_i)
+          const double s1 = 1. / (1. + exp(z));
+          if(gradient) {
+            const double coef = cl.weight * s1 * cl.sign;
+            for(int d=0; d<D; ++d) s.g(d) += coef * x(i,d);
+            s.g(D) += coef;
+            // log(1 + exp(-z)), computed in a numerically stable way
+            if(m_compute_f)
+              s.f += cl.weight * (z > 0. ? log1p(exp(-z)) : -z + log1p(exp(z)));
+          }
+          else {
+            double ux = m_u(D);
+            for(int d=0; d<D; ++d) ux += m_u(d) * x(i,d);
+            s.uhu += cl.weight * s1 * (1. - s1) * ux * ux;
+          }
+        }
+      }
+
+      LLRClass m_classes[2];
+      size_t m_n_features;
+      double m_logit;
+      size_t m_n_threads;
+      std::vector<LLRSums> m_partial; ///< sums of each thread
+      LLRSums m_sums;
+      bool m_compute_f;
+      blitz::Array<double,1> m_w;
+      blitz::Array<double,1> m_u;
+  };
+
+  /**
+   * Maximizes the log-likelihood with the conjugate gradient algorithm
+   */
+  void trainCG(LLRProblem& problem, blitz::Array<double,1>& w,
+      const double convergence_threshold, const size_t max_iterations) 
   {
-    // 1. Computes the non-weighted version of the likelihood
-    // s1 = sum_{i=1}^{n}(1./(1.+exp(-y_i (w^T x_i + logit))
-    //   where - the x blitz::Array contains -y_i x_i values
-    //         - the offset blitz::Array contains -y_i logit values
-    s1 = 1. / (1. + blitz::exp(blitz::sum(w(j)*x(j,i), j) + offset));
-    // 2. Likelihood weighted by the prior/proportion
-    tmp_n = s1 * weights;
-    // 3. Gradient g of this weighted likelihood wrt. the weight vector w
-    bob::math::prod(x, tmp_n, g);
-
-    // 4. Conjugate gradient step
-    if(iter == 0) 
-      u = g;
-    else
+    const size_t n = w.extent(0);
+    // Initializes gradient and w vectors
+    blitz::Array<double,1> g_old(n);
+    blitz::Array<double,1> w_old(n);
+    blitz::Array<double,1> g(n);
+    g_old = 0.;
+    w_old = 0.;
+    g = 0.;
+    w = 0.;
+
+    // Initialize working arrays
+    blitz::Array<double,1> u(n);
+    blitz::Array<double,1> tmp_d(n);
+    double f;
+
+    // Iterates...
+    static const double ten_epsilon = 10*std::numeric_limits<double>::epsilon();
+    for(size_t iter=0; ; ++iter) 
     {
-      tmp_d = (g-g_old);
-      double den = blitz::sum(u * tmp_d);
-      if(den == 0) 
-        u = 0.;
+      // 1. Gradient g of the weighted likelihood wrt. the weight vector w
+      problem.gradient(w, g, f, false);
+
+      // 2. Conjugate gradient step
+      if(iter == 0) 
+        u = g;
       else
       {
-        // Hestenes-Stiefel formula: Heuristic to set the scale factor beta
-        //   (chosen as it works well in practice)
-        // beta = g^t(g-g_old) / (u_old^T (g - g_old))
-        double beta = blitz::sum(tmp_d * g) / den;
-        u = g - beta * u;
+        tmp_d = (g-g_old);
+        double den = blitz::sum(u * tmp_d);
+        if(den == 0) 
+          u = 0.;
+        else
+        {
+          // Hestenes-Stiefel formula: Heuristic to set the scale factor beta
+          //   (chosen as it works well in practice)
+          // beta = g^t(g-g_old) / (u_old^T (g - g_old))
+          double beta = blitz::sum(tmp_d * g) / den;
+          u = g - beta * u;
+        }
       }
-    }
 
-    // 5. Line search along the direction u
-    // a. Compute ux
-    bob::math::prod(u,x,tmp_n);
-    // b. Compute u^T H u 
-    //      = sum_{i} weights(i) sigmoid(w^T x_i) [1-sigmoid(w^T x_i)] (u^T x_i)
-    double uhu = blitz::sum(blitz::pow2(tmp_n) * weights * s1 * (1.-s1));
-    // Terminates if uhu is close to zero
-    if(fabs(uhu) < ten_epsilon)
-    {
-      bob::core::info << "# LLR Training terminated: convergence after " << iter << " iterations (u^T H u == 0)." << std::endl;
-      break;
-    }
-    // c. Compute w = w_old - (g^T u)/(u^T H u) u
-    w = w + blitz::sum(u*g) / uhu * u;
-    
-    // Terminates if convergence has been reached
-    if(blitz::max(blitz::fabs(w-w_old)) <= m_convergence_threshold) 
-    {
-      bob::core::info << "# LLR Training terminated: convergence after " << iter << " iterations." << std::endl;
-      break;
-    }
-    // Terminates if maximum number of iterations has been reached
-    if(m_max_iterations > 0 && iter+1 >= m_max_iterations) 
-    {
-      bob::core::info << "# EM terminated: maximum number of iterations (" << m_max_iterations << ") reached." << std::endl;
-      break;
+      // 3. Line search along the direction u
+      // a. Compute u^T H u 
+      //      = sum_{i} weights(i) sigmoid(w^T x_i) [1-sigmoid(w^T x_i)] (u^T x_i)
+      double uhu = problem.curvature(w, u);
+      // Terminates if uhu is close to zero
+      if(fabs(uhu) < ten_epsilon)
+      {
+        bob::core::info << "# LLR Training terminated: convergence after " << iter << " iterations (u^T H u == 0)." << std::endl;
+        break;
+      }
+      // b. Compute w = w_old - (g^T u)/(u^T H u) u
+      w = w + blitz::sum(u*g) / uhu * u;
+      
+      // Terminates if convergence has been reached
+      if(blitz::max(blitz::fabs(w-w_old)) <= convergence_threshold) 
+      {
+        bob::core::info << "# LLR Training terminated: convergence after " << iter << " iterations." << std::endl;
+        break;
+      }
+      // Terminates if maximum number of iterations has been reached
+      if(max_iterations > 0 && iter+1 >= max_iterations) 
+      {
+        bob::core::info << "# EM terminated: maximum number of iterations (" << max_iterations << ") reached." << std::endl;
+        break;
+      }
+
+      // Backup previous values
+      g_old = g;
+      w_old = w;
     }
+  }
 
-    // Backup previous values
-    g_old = g;
-    w_old = w;
+  /**
+   * Evaluates the normalized negative log-likelihood -L(w)/n and its 
+   * gradient for libLBFGS
+   */
+  lbfgsfloatval_t llrEvaluate(void* instance, const lbfgsfloatval_t* x,
+      lbfgsfloatval_t* g, const int n, const lbfgsfloatval_t)
+  {
+    LLRProblem& problem = *static_cast<LLRProblem*>(instance);
+    const blitz::Array<double,1> w(const_cast<double*>(x), blitz::shape(n),
+        blitz::neverDeleteData);
+    blitz::Array<double,1> g_(g, blitz::shape(n), blitz::neverDeleteData);
+    double f;
+    problem.gradient(w, g_, f, true);
+    const double n_samples = static_cast<double>(problem.getNSamples());
+    g_ /= -n_samples;
+    return f / n_samples;
   }
 
+  /**
+   * Minimizes the negative log-likelihood with L-BFGS
+   */
+  void trainLBFGS(LLRProblem& problem, blitz::Array<double,1>& w,
+      const double convergence_threshold, const size_t max_iterations) 
+  {
+    const int n = w.extent(0);
+    lbfgs_parameter_t param;
+    lbfgs_parameter_init(&param);
+    param.epsilon = convergence_threshold;
+    param.max_iterations = static_cast<int>(max_iterations);
+
+    lbfgsfloatval_t* x = lbfgs_malloc(n);
+    std::fill(x, x + n, 0.);
+    lbfgsfloatval_t fx = 0.;
+    const int ret = lbfgs(n, x, &fx, llrEvaluate, NULL, &problem, &param);
+    for(int i=0; i<n; ++i) w(i) = x[i];
+    lbfgs_free(x);
+
+    if(ret == LBFGS_SUCCESS || ret == LBFGS_ALREADY_MINIMIZED)
+      bob::core::info << "# LLR Training terminated: L-BFGS converged (average negative log-likelihood " << fx << ")." << std::endl;
+    else if(ret == LBFGSERR_MAXIMUMITERATION)
+      bob::core::info << "# LLR Training terminated: maximum number of iterations (" << max_iterations << ") reached." << std::endl;
+    else if(ret == LBFGSERR_ROUNDING_ERROR || ret == LBFGSERR_MINIMUMSTEP ||
+        ret == LBFGSERR_MAXIMUMLINESEARCH)
+      // The line search cannot make any further progress (e.g. the 
+      // likelihood is flat at the machine precision)
+      bob::core::info << "# LLR Training terminated: no further progress of the L-BFGS line search (code " << ret << ")." << std::endl;
+    else {
+      throw bob::trainer::LLROptimizationFailure(ret);
+    }
+  }
+
+}
+
+/**
+ * Trains the machine given the samples of the two classes
+ */
+static void llrTrain(bob::machine::LinearMachine& machine, LLRClass& c1,
+    LLRClass& c2, const size_t n_features, const double prior,
+    const double convergence_threshold, const size_t max_iterations,
+    const size_t n_threads, const bool use_lbfgs)
+{
+  if(c1.n_samples == 0 || c2.n_samples == 0)
+    throw bob::trainer::EmptyTrainingSet();
+
+  // Ratio between the two classes and weights
+  const double n_samples = static_cast<double>(c1.n_samples + c2.n_samples);
+  const double prop = static_cast<double>(c1.n_samples) / n_samples;
+  c1.sign = 1.;
+  c1.weight = prior / prop;
+  c2.sign = -1.;
+  c2.weight = (1.-prior) / (1.-prop);
+  const double logit = log(prior/(1.-prior));
+
+  LLRProblem problem(c1, c2, n_features, logit, n_threads);
+  blitz::Array<double,1> w(n_features+1);
+  w = 0.;
+  if(use_lbfgs) 
+    trainLBFGS(problem, w, convergence_threshold, max_iterations);
+  else
+    trainCG(problem, w, convergence_threshold, max_iterations);
+
   // Updates the LinearMachine
+  blitz::Range rall = blitz::Range::all();
+  blitz::Range rd = blitz::Range(0,n_features-1);
   machine.resize(n_features, 1);
   machine.setInputSubtraction(0.); // No subtraction
   machine.setInputDivision(1.); // No division
@@ -205,3 +427,27 @@ void bob::trainer::LLRTrainer::train(bob::machine::LinearMachine& machine,
   machine.setBiases(w(n_features)); // Bias: D+1 value
 }
 
+void bob::trainer::LLRTrainer::train(bob::machine::LinearMachine& machine, 
+  const blitz::Array<double,2>& ar1, const blitz::Array<double,2>& ar2) const 
+{
+  // Checks for arraysets data type and shape once
+  if(ar1.extent(1) != ar2.extent(1)) 
+    throw bob::io::DimensionError(ar1.extent(1), ar2.extent(1));
+
+  LLRClass c1 = {&ar1, 0, static_cast<size_t>(ar1.extent(0)), 1., 1.};
+  LLRClass c2 = {&ar2, 0, static_cast<size_t>(ar2.extent(0)), -1., 1.};
+  llrTrain(machine, c1, c2, ar1.extent(1), m_prior, m_convergence_threshold,
+      m_max_iterations, m_n_threads, m_use_lbfgs);
+}
+
+void bob::trainer::LLRTrainer::train(bob::machine::LinearMachine& machine, 
+  bob::trainer::BlockSampler& sampler1, bob::trainer::BlockSampler& sampler2) const 
+{
+  if(sampler1.getNInputs() != sampler2.getNInputs()) 
+    throw bob::io::DimensionError(sampler1.getNInputs(), sampler2.getNInputs());
+
+  LLRClass c1 = {0, &sampler1, sampler1.size(), 1., 1.};
+  LLRClass c2 = {0, &sampler2, sampler2.size(), -1., 1.};
+  llrTrain(machine, c1, c2, sampler1.getNInputs(), m_prior, 
+      m_convergence_threshold, m_max_iterations, m_n_threads, m_use_lbfgs);
+}
@@ -19,6 +19,10 @@
  */
 #include "bob/trainer/MAP_GMMTrainer.h"
 #include "bob/trainer/Exception.h"
+#include "bob/core/array_assert.h"
+#include "bob/core/parallel.h"
+#include "bob/io/Exception.h"
+#include <boost/bind.hpp>
 
 namespace train = bob::trainer;
 namespace mach = bob::machine;
@@ -41,13 +45,7 @@ void train::MAP_GMMTrainer::initialization(mach::GMMMachine& gmm, const blitz::A
 
   size_t n_gaussians = gmm.getNGaussians();
   // TODO: check size?
-  gmm.setWeights(m_prior_gmm->getWeights());
-  for(size_t i=0; i<n_gaussians; ++i)
-  {
-    gmm.getGaussian(i)->updateMean() = m_prior_gmm->getGaussian(i)->getMean();
-    gmm.getGaussian(i)->updateVariance() = m_prior_gmm->getGaussian(i)->getVariance();
-    gmm.getGaussian(i)->applyVarianceThresholds();
-  }
+  initializeFromPrior(gmm);
   // Initializes cache
   m_cache_alpha.resize(n_gaussians);
   m_cache_ml_weights.resize(n_gaussians);
@@ -59,37 +57,54 @@ bool train::MAP_GMMTrainer::setPriorGMM(boost::shared_ptr<bob::machine::GMMMachi
   return true;
 }
 
+void train::MAP_GMMTrainer::initializeFromPrior(mach::GMMMachine& gmm) const {
+  size_t n_gaussians = gmm.getNGaussians();
+  gmm.setWeights(m_prior_gmm->getWeights());
+  for(size_t i=0; i<n_gaussians; ++i)
+  {
+    gmm.getGaussian(i)->updateMean() = m_prior_gmm->getGaussian(i)->getMean();
+    gmm.getGaussian(i)->updateVariance() = m_prior_gmm->getGaussian(i)->getVariance();
+    gmm.getGaussian(i)->applyVarianceThresholds();
+  }
+}
+
 void train::MAP_GMMTrainer::mStep(mach::GMMMachine& gmm, const blitz::Array<double,2>& data) {
-  // Read options and variables
-  double n_gaussians = gmm.getNGaussians();
-  
   // Check that the prior GMM has been specified
   if (!m_prior_gmm) {
     throw NoPriorGMM();
   }
 
+  adapt(m_ss, gmm, m_cache_alpha, m_cache_ml_weights);
+}
+
+void train::MAP_GMMTrainer::adapt(const mach::GMMStats& ss, 
+    mach::GMMMachine& gmm, blitz::Array<double,1>& alpha, 
+    blitz::Array<double,1>& ml_weights) const {
+  // Read options and variables
+  double n_gaussians = gmm.getNGaussians();
+
   blitz::firstIndex i;
   blitz::secondIndex j;
 
   // Calculate the "data-dependent adaptation coefficient", alpha_i
-  // TODO: check if required // m_cache_alpha.resize(n_gaussians);
+  // TODO: check if required // alpha.resize(n_gaussians);
   if( m_T3_adaptation )
-    m_cache_alpha = m_T3_alpha;
+    alpha = m_T3_alpha;
   else
-    m_cache_alpha = m_ss.n(i) / (m_ss.n(i) + relevance_factor);
+    alpha = ss.n(i) / (ss.n(i) + relevance_factor);
 
   // - Update weights if requested
   //   Equation 11 of Reynolds et al., "Speaker Verification Using Adapted Gaussian Mixture Models", Digital Signal Processing, 2000
   if (update_weights) {
     // Calculate the maximum likelihood weights
-    m_cache_ml_weights = m_ss.n / static_cast<double>(m_ss.T); //cast req. for linux/32-bits & osx
+    ml_weights = ss.n / static_cast<double>(ss.T); //cast req. for linux/32-bits & osx
 
     // Get the prior weights
     const blitz::Array<double,1>& prior_weights = m_prior_gmm->getWeights();
     blitz::Array<double,1>& new_weights = gmm.updateWeights();
 
     // Calculate the new weights
-    new_weights = m_cache_alpha * m_cache_ml_weights + (1-m_cache_alpha) * prior_weights;
+    new_weights = alpha * ml_weights + (1-alpha) * prior_weights;
 
     // Apply the scale factor, gamma, to ensure the new weights sum to unity 
     double gamma = blitz::sum(new_weights);
@@ -107,12 +122,12 @@ void train::MAP_GMMTrainer::mStep(mach::GMMMachine& gmm, const blitz::Array<doub
     for(size_t i=0; i<n_gaussians; ++i) {
       const blitz::Array<double,1>& prior_means = m_prior_gmm->getGaussian(i)->getMean();
       blitz::Array<double,1>& means = gmm.getGaussian(i)->updateMean();
-      if(m_ss.n(i) < m_mean_var_update_responsibilities_threshold) {
+      if(ss.n(i) < m_mean_var_update_responsibilities_threshold) {
         means = prior_means;
       }
       else {
         // Use the maximum likelihood means
-        means = m_cache_alpha(i) * (m_ss.sumPx(i,blitz::Range::all()) / m_ss.n(i)) + (1-m_cache_alpha(i)) * prior_means;
+        means = alpha(i) * (ss.sumPx(i,blitz::Range::all()) / ss.n(i)) + (1-alpha(i)) * prior_means;
       }
     }
   }
@@ -126,13 +141,99 @@ void train::MAP_GMMTrainer::mStep(mach::GMMMachine& gmm, const blitz::Array<doub
       blitz::Array<double,1>& means = gmm.getGaussian(i)->updateMean();
       const blitz::Array<double,1>& prior_variances = m_prior_gmm->getGaussian(i)->getVariance();
       blitz::Array<double,1>& variances = gmm.getGaussian(i)->updateVariance();
-      if(m_ss.n(i) < m_mean_var_update_responsibilities_threshold) {
+      if(ss.n(i) < m_mean_var_update_responsibilities_threshold) {
         variances = (prior_variances + prior_means) - blitz::pow2(means);
       }
       else {
-        variances = m_cache_alpha(i) * m_ss.sumPxx(i,blitz::Range::all()) / m_ss.n(i) + (1-m_cache_alpha(i)) * (prior_variances + prior_means) - blitz::pow2(means);
+        variances = alpha(i) * ss.sumPxx(i,blitz::Range::all()) / ss.n(i) + (1-alpha(i)) * (prior_variances + prior_means) - blitz::pow2(means);
       }
       gmm.getGaussian(i)->applyVarianceThresholds();
     }
   }
 }
+
+void train::MAP_GMMTrainer::enrolRange(const std::vector<boost::shared_ptr<const mach::GMMStats> >& stats,
+    const std::vector<boost::shared_ptr<mach::GMMMachine> >& models,
+    size_t begin, size_t end) const {
+  const size_t n_gaussians = m_prior_gmm->getNGaussians();
+  blitz::Array<double,1> alpha(n_gaussians);
+  blitz::Array<double,1> ml_weights(n_gaussians);
+  for(size_t k=begin; k<end; ++k) {
+    initializeFromPrior(*models[k]);
+    adapt(*stats[k], *models[k], alpha, ml_weights);
+  }
+}
+
+void train::MAP_GMMTrainer::enrolMeansRange(const std::vector<boost::shared_ptr<const mach::GMMStats> >& stats,
+    blitz::Array<double,2>& means, size_t begin, size_t end) const {
+  const size_t n_gaussians = m_prior_gmm->getNGaussians();
+  blitz::Array<double,1> alpha(n_gaussians);
+  blitz::Array<double,1> ml_weights(n_gaussians);
+  // A single model of this thread is adapted to each of its clients
+  mach::GMMMachine gmm(*m_prior_gmm);
+  blitz::Array<double,1> mean(means.extent(1));
+  for(size_t k=begin; k<end; ++k) {
+    initializeFromPrior(gmm);
+    adapt(*stats[k], gmm, alpha, ml_weights);
+    gmm.getMeanSupervector(mean);
+    // means is shared by the threads: it is only written element-wise, 
+    // without creating any view on it
+    for(int j=0; j<mean.extent(0); ++j) means((int)k, j) = mean(j);
+  }
+}
+
+/**
+ * Checks that the statistics have the dimensions of the prior GMM
+ */
+static void checkStats(const std::vector<boost::shared_ptr<const mach::GMMStats> >& stats,
+    const mach::GMMMachine& prior) {
+  for(size_t k=0; k<stats.size(); ++k) {
+    if(stats[k]->sumPx.extent(0) != (int)prior.getNGaussians())
+      throw io::DimensionError(stats[k]->sumPx.extent(0), prior.getNGaussians());
+    if(stats[k]->sumPx.extent(1) != (int)prior.getNInputs())
+      throw io::DimensionError(stats[k]->sumPx.extent(1), prior.getNInputs());
+  }
+}
+
+void train::MAP_GMMTrainer::enrol(const std::vector<boost::shared_ptr<const mach::GMMStats> >& stats,
+    const std::vector<boost::shared_ptr<mach::GMMMachine> >& models,
+    const size_t n_threads) const {
+  if (!m_prior_gmm) {
+    throw NoPriorGMM();
+  }
+  bob::core::array::assertSameDimensionLength(stats.size(), models.size());
+  checkStats(stats, *m_prior_gmm);
+  for(size_t k=0; k<models.size(); ++k) {
+    if(models[k]->getNGaussians() != m_prior_gmm->getNGaussians())
+      throw io::DimensionError(models[k]->getNGaussians(), m_prior_gmm->getNGaussians());
+    if(models[k]->getNInputs() != m_prior_gmm->getNInputs())
+      throw io::DimensionError(models[k]->getNInputs(), m_prior_gmm->getNInputs());
+  }
+
+  // The clients are split across the threads
+  bob::core::thread_loop(boost::bind(&train::MAP_GMMTrainer::enrolRange, this,
+        boost::cref(stats), boost::cref(models), _1, _2), stats.size(), n_threads);
+}
+
+void train::MAP_GMMTrainer::enrol(const std::vector<boost::shared_ptr<const mach::GMMStats> >& stats,
+    const blitz::Array<int64_t,1>& ids, mach::ModelBank& bank,
+    const size_t n_threads) const {
+  if (!m_prior_gmm) {
+    throw NoPriorGMM();
+  }
+  // Only the means of the adapted models can be stored in a ModelBank: the
+  // weights and variances should not be updated
+  if (update_weights || update_variances) {
+    throw IncompatibleMachine();
+  }
+  bob::core::array::assertSameDimensionLength(stats.size(), ids.extent(0));
+  checkStats(stats, *m_prior_gmm);
+
+  // The clients are split across the threads, and their means are then 
+  // copied into the bank at once
+  blitz::Array<double,2> means(stats.size(), 
+      m_prior_gmm->getNGaussians() * m_prior_gmm->getNInputs());
+  bob::core::thread_loop(boost::bind(&train::MAP_GMMTrainer::enrolMeansRange, this,
+        boost::cref(stats), boost::ref(means), _1, _2), stats.size(), n_threads);
+  bank.set(ids, "mean", means);
+}
@@ -26,11 +26,15 @@
 #include <limits>
 
 #include "bob/trainer/PLDATrainer.h"
+#include "bob/core/array_alias.h"
 #include "bob/core/array_copy.h"
 #include "bob/math/linear.h"
 #include "bob/math/inv.h"
 #include "bob/math/svd.h"
 #include "bob/trainer/Exception.h"
+#include "bob/core/array_assert.h"
+#include "bob/core/parallel.h"
+#include <boost/bind.hpp>
 
 
 namespace tca = bob::core::array;
@@ -48,7 +52,7 @@ train::PLDABaseTrainer::PLDABaseTrainer(int nf, int ng,
   m_seed(-1), 
   m_initF_method(0), m_initF_ratio(1.),
   m_initG_method(0), m_initG_ratio(1.),
-  m_initSigma_method(0), m_initSigma_ratio(1.),
+  m_initSigma_method(0), m_initSigma_ratio(1.), m_n_threads(1),
   m_n_samples_per_id(0), m_n_samples_in_training(), m_B(0,0),
   m_Ft_isigma_G(0,0), m_eta(0,0), m_zeta(), m_iota(),
   m_cache_nf_1(0), m_cache_nf_2(0), m_cache_ng_1(0),
@@ -69,6 +73,7 @@ train::PLDABaseTrainer::PLDABaseTrainer(const train::PLDABaseTrainer& other):
   m_initF_method(other.m_initF_method), m_initF_ratio(other.m_initF_ratio),
   m_initG_method(other.m_initG_method), m_initG_ratio(other.m_initG_ratio),
   m_initSigma_method(other.m_initSigma_method), m_initSigma_ratio(other.m_initSigma_ratio),
+  m_n_threads(other.m_n_threads),
   m_n_samples_per_id(other.m_n_samples_per_id),
   m_n_samples_in_training(other.m_n_samples_in_training), 
   m_B(tca::ccopy(other.m_B)), 
@@ -109,6 +114,7 @@ train::PLDABaseTrainer& train::PLDABaseTrainer::operator=
   m_initG_ratio = other.m_initG_ratio;
   m_initSigma_method = other.m_initSigma_method;
   m_initSigma_ratio = other.m_initSigma_ratio;
+  m_n_threads = other.m_n_threads;
   m_n_samples_per_id = other.m_n_samples_per_id;
   m_n_samples_in_training = other.m_n_samples_in_training;
   m_B = tca::ccopy(other.m_B); 
@@ -123,6 +129,8 @@ train::PLDABaseTrainer& train::PLDABaseTrainer::operator=
   m_cache_nfng_nfng = tca::ccopy(other.m_cache_nfng_nfng);
   m_cache_D_nfng_1 = tca::ccopy(other.m_cache_D_nfng_1);
   m_cache_D_nfng_2 = tca::ccopy(other.m_cache_D_nfng_2);
+  // The per-thread buffers are reallocated when required
+  m_identity_cache.clear();
   return *this;
 }
 
@@ -220,6 +228,8 @@ void train::PLDABaseTrainer::initMembers(const std::vector<blitz::Array<double,2
   m_cache_nfng_nfng.resize(m_nf+m_ng,m_nf+m_ng);
   m_cache_D_nfng_1.resize(n_features,m_nf+m_ng);
   m_cache_D_nfng_2.resize(n_features,m_nf+m_ng);
+  m_identity_cache.clear();
+  initIdentityCaches(n_features);
 }
 
 void train::PLDABaseTrainer::computeMeanVariance(mach::PLDABaseMachine& machine, 
@@ -492,11 +502,48 @@ void train::PLDABaseTrainer::initRandomFGSigma(mach::PLDABaseMachine& machine)
 }
 
 
+void train::PLDABaseTrainer::initIdentityCaches(const size_t n_features)
+{
+  const size_t n_caches = std::max(m_n_threads, (size_t)1);
+  for(size_t k=m_identity_cache.size(); k<n_caches; ++k) {
+    IdentityCache cache;
+    cache.nf_1.resize(m_nf);
+    cache.nf_2.resize(m_nf);
+    cache.ng_1.resize(m_ng);
+    cache.ng_2.resize(m_ng);
+    cache.D_1.resize(n_features);
+    cache.D_2.resize(n_features);
+    cache.sum_z_second_order.resize(m_nf+m_ng, m_nf+m_ng);
+    cache.sum_xz.resize(n_features, m_nf+m_ng);
+    cache.sum_sigma.resize(n_features);
+    m_identity_cache.push_back(cache);
+  }
+}
+
 void train::PLDABaseTrainer::eStep(mach::PLDABaseMachine& machine, 
   const std::vector<blitz::Array<double,2> >& v_ar)
 {  
-  // Precomputes useful variables using current estimates of F,G, and sigma
+  // Precomputes useful variables using current estimates of F,G, and sigma,
+  // in particular gamma_a, zeta_a and iota_a for all the numbers of samples
+  // per identity. These are then only read by the threads.
   precomputeFromFGSigma(machine);
+  initIdentityCaches(machine.getDimD());
+
+  // Loops over the identities, split across the threads, and sums the 
+  // partial second order statistics in the order of the threads
+  const size_t n_blocks = bob::core::thread_iloop(boost::bind(
+        &train::PLDABaseTrainer::eStepRange, this, boost::cref(machine),
+        boost::cref(v_ar), _1, _2, _3), v_ar.size(), m_n_threads);
+  m_sum_z_second_order = 0.;
+  for(size_t k=0; k<n_blocks; ++k)
+    m_sum_z_second_order += m_identity_cache[k].sum_z_second_order;
+}
+
+void train::PLDABaseTrainer::eStepRange(const mach::PLDABaseMachine& machine,
+  const std::vector<blitz::Array<double,2> >& v_ar, size_t k, size_t begin,
+  size_t end)
+{
+  IdentityCache& cache = m_identity_cache[k];
   // Gets the mean mu from the machine
   const blitz::Array<double,1>& mu = machine.getMu();
   const blitz::Array<double,2>& alpha = machine.getAlpha();
@@ -508,64 +555,74 @@ void train::PLDABaseTrainer::eStep(mach::PLDABaseMachine& machine,
   // blitz indices
   blitz::firstIndex bi;
   blitz::secondIndex bj;
-  // Initializes sum of z second order statistics to 0
-  m_sum_z_second_order = 0.;
-  for(size_t i=0; i<v_ar.size(); ++i)
+  blitz::Range r1(0, m_nf-1);
+  blitz::Range r2(m_nf, m_nf+m_ng-1);
+  blitz::Array<double,2> z_so_11 = cache.sum_z_second_order(r1,r1);
+  blitz::Array<double,2> z_so_12 = cache.sum_z_second_order(r1,r2);
+  blitz::Array<double,2> z_so_21 = cache.sum_z_second_order(r2,r1);
+  blitz::Array<double,2> z_so_22 = cache.sum_z_second_order(r2,r2);
+  // Initializes the partial sum of z second order statistics to 0
+  cache.sum_z_second_order = 0.;
+  for(size_t i=begin; i<end; ++i)
   {
+    // the samples are views of aliases private to this thread
+    const blitz::Array<double,2> x_i = bob::core::array::alias(v_ar[i]);
+    blitz::Array<double,2> z_i = bob::core::array::alias(m_z_first_order[i]);
+    const size_t n_i = v_ar[i].extent(0);
     // Computes expectation of z_ij = [h_i w_ij]
     // 1/a/ Computes expectation of h_i
     // Loop over the samples
-    m_cache_nf_1 = 0.;
-    for(int j=0; j<v_ar[i].extent(0); ++j)
+    cache.nf_1 = 0.;
+    for(int j=0; j<(int)n_i; ++j)
     {
-      // m_cache_D_1 = x_sj-mu
-      m_cache_D_1 = v_ar[i](j,a) - mu;
+      // cache.D_1 = x_sj-mu
+      cache.D_1 = x_i(j,a) - mu;
 
-      // m_cache_nf_2 = F^T.beta.(x_sj-mu)
-      bob::math::prod(FtBeta, m_cache_D_1, m_cache_nf_2);
-      // m_cache_nf_1 = sum_j F^T.beta.(x_sj-mu)
-      m_cache_nf_1 += m_cache_nf_2;
+      // cache.nf_2 = F^T.beta.(x_sj-mu)
+      bob::math::prod(FtBeta, cache.D_1, cache.nf_2);
+      // cache.nf_1 = sum_j F^T.beta.(x_sj-mu)
+      cache.nf_1 += cache.nf_2;
     }
-    const blitz::Array<double,2>& gamma_a = machine.getAddGamma(v_ar[i].extent(0));
-    blitz::Range r_hi(0, m_nf-1);
-    // m_cache_nf_2 = E(h_i) = gamma_A  sum_j F^T.beta.(x_sj-mu)
-    bob::math::prod(gamma_a, m_cache_nf_1, m_cache_nf_2);
+    const blitz::Array<double,2>& gamma_a = machine.getGamma(n_i);
+    // cache.nf_2 = E(h_i) = gamma_A  sum_j F^T.beta.(x_sj-mu)
+    bob::math::prod(gamma_a, cache.nf_1, cache.nf_2);
 
-    // 1/b/ Precomputes: m_cache_D_2 = F.E{h_i}
-    bob::math::prod(F, m_cache_nf_2, m_cache_D_2);
+    // 1/b/ Precomputes: cache.D_2 = F.E{h_i}
+    bob::math::prod(F, cache.nf_2, cache.D_2);
 
     // 2/ First and second order statistics of z
     // Precomputed values 
-    blitz::Array<double,2>& zeta_a = m_zeta[v_ar[i].extent(0)];
-    blitz::Array<double,2>& iota_a = m_iota[v_ar[i].extent(0)];
-    blitz::Array<double,2> iotat_a = iota_a.transpose(1,0);
+    const blitz::Array<double,2>& zeta_a = m_zeta.find(n_i)->second;
+    const blitz::Array<double,2>& iota_a = m_iota.find(n_i)->second;
 
     // Extracts statistics of z_ij = [h_i w_ij] from y_i = [h_i w_i1 ... w_iJ]
-    blitz::Range r1(0, m_nf-1);
-    blitz::Range r2(m_nf, m_nf+m_ng-1);
-    for(int j=0; j<v_ar[i].extent(0); ++j)
+    // cache.ng_2 = sum_j E{w_ij}
+    cache.ng_2 = 0.;
+    for(int j=0; j<(int)n_i; ++j)
     {
       // 1/ First order statistics of z
-      blitz::Array<double,1> z_first_order_ij_1 = m_z_first_order[i](j,r1);
-      z_first_order_ij_1 = m_cache_nf_2; // E{h_i}
-      // m_cache_D_1 = x_sj - mu - F.E{h_i}
-      m_cache_D_1 = v_ar[i](j,a) - mu - m_cache_D_2;
-      // m_cache_ng_1 = G^T.sigma^-1.(x_sj-mu-fhi)
-      bob::math::prod(GtISigma, m_cache_D_1, m_cache_ng_1);
+      blitz::Array<double,1> z_first_order_ij_1 = z_i(j,r1);
+      z_first_order_ij_1 = cache.nf_2; // E{h_i}
+      // cache.D_1 = x_sj - mu - F.E{h_i}
+      cache.D_1 = x_i(j,a) - mu - cache.D_2;
+      // cache.ng_1 = G^T.sigma^-1.(x_sj-mu-fhi)
+      bob::math::prod(GtISigma, cache.D_1, cache.ng_1);
       // z_first_order_ij_2 = (Id+G^T.sigma^-1.G)^-1.G^T.sigma^-1.(x_sj-mu) = E{w_ij}
-      blitz::Array<double,1> z_first_order_ij_2 = m_z_first_order[i](j,r2);
-      bob::math::prod(alpha, m_cache_ng_1, z_first_order_ij_2); 
-
-      // 2/ Second order statistics of z
-      blitz::Array<double,2> z_so_11 = m_sum_z_second_order(r1,r1);
-      z_so_11 += gamma_a + z_first_order_ij_1(bi) * z_first_order_ij_1(bj);
-      blitz::Array<double,2> z_so_12 = m_sum_z_second_order(r1,r2);
-      z_so_12 += iota_a + z_first_order_ij_1(bi) * z_first_order_ij_2(bj);
-      blitz::Array<double,2> z_so_21 = m_sum_z_second_order(r2,r1);
-      z_so_21 += iotat_a + z_first_order_ij_2(bi) * z_first_order_ij_1(bj);
-      blitz::Array<double,2> z_so_22 = m_sum_z_second_order(r2,r2);
-      z_so_22 += zeta_a + z_first_order_ij_2(bi) * z_first_order_ij_2(bj);
+      blitz::Array<double,1> z_first_order_ij_2 = z_i(j,r2);
+      bob::math::prod(alpha, cache.ng_1, z_first_order_ij_2); 
+      cache.ng_2 += z_first_order_ij_2;
+
+      // 2/ Second order statistics of w_ij
+      z_so_22 += z_first_order_ij_2(bi) * z_first_order_ij_2(bj);
     }
+
+    // 2/ Second order statistics of z: the terms which do not depend on 
+    // w_ij are the same for all the samples of the identity
+    const double n = static_cast<double>(n_i);
+    z_so_11 += n * (gamma_a + cache.nf_2(bi) * cache.nf_2(bj));
+    z_so_12 += n * iota_a + cache.nf_2(bi) * cache.ng_2(bj);
+    z_so_21 += n * iota_a(bj,bi) + cache.ng_2(bi) * cache.nf_2(bj);
+    z_so_22 += n * zeta_a;
   }
 }
 
@@ -655,25 +712,15 @@ void train::PLDABaseTrainer::updateFG(mach::PLDABaseMachine& machine,
   /// Computes the B matrix (B = [F G])
   /// B = (sum_ij (x_ij-mu).E{z_i}^T).(sum_ij E{z_i.z_i^T})^-1
 
-  // 1/ Computes the numerator (sum_ij (x_ij-mu).E{z_i}^T)
-  // Gets the mean mu from the machine
-  const blitz::Array<double,1>& mu = machine.getMu();
-  blitz::Range a = blitz::Range::all();
+  // 1/ Computes the numerator (sum_ij (x_ij-mu).E{z_i}^T), the identities
+  // being split across the threads
+  initIdentityCaches(machine.getDimD());
+  const size_t n_blocks = bob::core::thread_iloop(boost::bind(
+        &train::PLDABaseTrainer::updateFGRange, this, boost::cref(machine),
+        boost::cref(v_ar), _1, _2, _3), v_ar.size(), m_n_threads);
   m_cache_D_nfng_2 = 0.;
-  for(size_t i=0; i<v_ar.size(); ++i)
-  {
-    // Loop over the samples
-    for(int j=0; j<v_ar[i].extent(0); ++j)
-    {
-      // m_cache_D_1 = x_sj-mu
-      m_cache_D_1 = v_ar[i](j,a) - mu;
-      // z_first_order_ij = E{z_ij}
-      blitz::Array<double,1> z_first_order_ij = m_z_first_order[i](j, a);
-      // m_cache_D_nfng_1 = (x_sj-mu).E{z_ij}^T
-      bob::math::prod(m_cache_D_1, z_first_order_ij, m_cache_D_nfng_1);
-      m_cache_D_nfng_2 += m_cache_D_nfng_1;
-    }
-  }
+  for(size_t k=0; k<n_blocks; ++k)
+    m_cache_D_nfng_2 += m_identity_cache[k].sum_xz;
 
   // 2/ Computes the denominator inv(sum_ij E{z_i.z_i^T})
   bob::math::inv(m_sum_z_second_order, m_cache_nfng_nfng);
@@ -690,40 +737,89 @@ void train::PLDABaseTrainer::updateFG(mach::PLDABaseMachine& machine,
   G = m_B(blitz::Range::all(), blitz::Range(m_nf,m_nf+m_ng-1));
 }
 
+void train::PLDABaseTrainer::updateFGRange(const mach::PLDABaseMachine& machine,
+  const std::vector<blitz::Array<double,2> >& v_ar, size_t k, size_t begin,
+  size_t end)
+{
+  IdentityCache& cache = m_identity_cache[k];
+  // Gets the mean mu from the machine
+  const blitz::Array<double,1>& mu = machine.getMu();
+  blitz::Range a = blitz::Range::all();
+  blitz::firstIndex bi;
+  blitz::secondIndex bj;
+  cache.sum_xz = 0.;
+  for(size_t i=begin; i<end; ++i)
+  {
+    // the samples are views of aliases private to this thread
+    const blitz::Array<double,2> x_i = bob::core::array::alias(v_ar[i]);
+    blitz::Array<double,2> z_i = bob::core::array::alias(m_z_first_order[i]);
+    // Loop over the samples
+    for(int j=0; j<v_ar[i].extent(0); ++j)
+    {
+      // cache.D_1 = x_sj-mu
+      cache.D_1 = x_i(j,a) - mu;
+      // z_first_order_ij = E{z_ij}
+      blitz::Array<double,1> z_first_order_ij = z_i(j, a);
+      // cache.sum_xz += (x_sj-mu).E{z_ij}^T
+      cache.sum_xz += cache.D_1(bi) * z_first_order_ij(bj);
+    }
+  }
+}
+
 void train::PLDABaseTrainer::updateSigma(mach::PLDABaseMachine& machine,
   const std::vector<blitz::Array<double,2> >& v_ar)
 {
   /// Computes the Sigma matrix
   /// Sigma = 1/IJ sum_ij Diag{(x_ij-mu).(x_ij-mu)^T - B.E{z_i}.(x_ij-mu)^T}
 
-  // Gets the mean mu and the matrix sigma from the machine
-  blitz::Array<double,1>& sigma = machine.updateSigma();
-  const blitz::Array<double,1>& mu = machine.getMu();
-  blitz::Range a = blitz::Range::all();
+  // Sums over the identities, split across the threads
+  initIdentityCaches(machine.getDimD());
+  const size_t n_blocks = bob::core::thread_iloop(boost::bind(
+        &train::PLDABaseTrainer::updateSigmaRange, this, boost::cref(machine),
+        boost::cref(v_ar), _1, _2, _3), v_ar.size(), m_n_threads);
 
+  // Gets the matrix sigma from the machine
+  blitz::Array<double,1>& sigma = machine.updateSigma();
   sigma = 0.;
+  for(size_t k=0; k<n_blocks; ++k)
+    sigma += m_identity_cache[k].sum_sigma;
+
+  // Normalizes by the number of samples
   size_t n_IJ=0; /// counts the number of samples
-  for(size_t i=0; i<v_ar.size(); ++i)
+  for(size_t i=0; i<v_ar.size(); ++i) n_IJ += v_ar[i].extent(0);
+  sigma /= static_cast<double>(n_IJ);
+}
+
+void train::PLDABaseTrainer::updateSigmaRange(const mach::PLDABaseMachine& machine,
+  const std::vector<blitz::Array<double,2> >& v_ar, size_t k, size_t begin,
+  size_t end)
+{
+  IdentityCache& cache = m_identity_cache[k];
+  // Gets the mean mu from the machine
+  const blitz::Array<double,1>& mu = machine.getMu();
+  blitz::Range a = blitz::Range::all();
+  cache.sum_sigma = 0.;
+  for(size_t i=begin; i<end; ++i)
   {
+    // the samples are views of aliases private to this thread
+    const blitz::Array<double,2> x_i = bob::core::array::alias(v_ar[i]);
+    blitz::Array<double,2> z_i = bob::core::array::alias(m_z_first_order[i]);
     // Loop over the samples
     for(int j=0; j<v_ar[i].extent(0); ++j)
     {
-      // m_cache_D_1 = x_ij-mu
-      m_cache_D_1 = v_ar[i](j,a) - mu;
+      // cache.D_1 = x_ij-mu
+      cache.D_1 = x_i(j,a) - mu;
       // sigma += Diag{(x_ij-mu).(x_ij-mu)^T}
-      sigma += blitz::pow2(m_cache_D_1);
+      cache.sum_sigma += blitz::pow2(cache.D_1);
 
       // z_first_order_ij = E{z_ij}
-      blitz::Array<double,1> z_first_order_ij = m_z_first_order[i](j,a);
-      // m_cache_D_2 = B.E{z_ij}
-      bob::math::prod(m_B, z_first_order_ij, m_cache_D_2);
+      blitz::Array<double,1> z_first_order_ij = z_i(j,a);
+      // cache.D_2 = B.E{z_ij}
+      bob::math::prod(m_B, z_first_order_ij, cache.D_2);
       // sigma -= Diag{B.E{z_ij}.(x_ij-mu)
-      sigma -= (m_cache_D_1 * m_cache_D_2);
-      ++n_IJ;
+      cache.sum_sigma -= (cache.D_1 * cache.D_2);
     }
   }
-  // Normalizes by the number of samples
-  sigma /= static_cast<double>(n_IJ);
 }
 
 double train::PLDABaseTrainer::computeLikelihood(mach::PLDABaseMachine& machine)
@@ -811,3 +907,153 @@ void train::PLDATrainer::enrol(const blitz::Array<double,2>& ar)
   m_plda_machine.setLogLikelihood(m_plda_machine.computeLikelihood(
                                     blitz::Array<double,2>(0,0),true));
 }
+
+namespace {
+
+  /**
+   * Computes the enrolment data of the clients [begin, end): their weighted
+   * sums (one per row of weighted_sum), the sums of their -1/2.x_i^T.beta.x_i
+   * terms and the log likelihoods of their enrolment samples. gamma_a and 
+   * the log likelihood constant terms are only read from the base machine.
+   */
+  struct enrolRange {
+    const mach::PLDABaseMachine& base;
+    const std::vector<blitz::Array<double,2> >& clients;
+    blitz::Array<double,2>& weighted_sum;
+    blitz::Array<double,1>& nh_sum_xit_beta_xi;
+    blitz::Array<double,1>& log_likelihood;
+
+    enrolRange(const mach::PLDABaseMachine& base_, 
+      const std::vector<blitz::Array<double,2> >& clients_,
+      blitz::Array<double,2>& weighted_sum_, 
+      blitz::Array<double,1>& nh_sum_xit_beta_xi_,
+      blitz::Array<double,1>& log_likelihood_):
+      base(base_), clients(clients_), weighted_sum(weighted_sum_),
+      nh_sum_xit_beta_xi(nh_sum_xit_beta_xi_), log_likelihood(log_likelihood_) {}
+
+    void operator()(size_t begin, size_t end) const
+    {
+      const blitz::Array<double,1>& mu = base.getMu();
+      const blitz::Array<double,2>& beta = base.getBeta();
+      const blitz::Array<double,2>& FtBeta = base.getFtBeta();
+      blitz::Array<double,1> tmp_d_1(base.getDimD());
+      blitz::Array<double,1> tmp_d_2(base.getDimD());
+      blitz::Array<double,1> tmp_nf_1(base.getDimF());
+      blitz::Array<double,1> tmp_nf_2(base.getDimF());
+      blitz::Array<double,1> wsum(base.getDimF());
+      blitz::Range a = blitz::Range::all();
+      for(size_t k=begin; k<end; ++k) {
+        const blitz::Array<double,2>& ar = clients[k];
+        double terma = 0.;
+        wsum = 0.;
+        for(int i=0; i<ar.extent(0); ++i) {
+          tmp_d_1 = ar(i,a) - mu;
+          // a/ weighted sum
+          bob::math::prod(FtBeta, tmp_d_1, tmp_nf_1);
+          wsum += tmp_nf_1;
+          // b/ first xi dependent term of the log likelihood
+          bob::math::prod(beta, tmp_d_1, tmp_d_2);
+          terma += -1 / 2. * blitz::sum(tmp_d_1 * tmp_d_2);
+        }
+        // weighted_sum is shared by the threads: it is only written 
+        // element-wise, without creating any view on it
+        for(int j=0; j<wsum.extent(0); ++j) weighted_sum((int)k, j) = wsum(j);
+        nh_sum_xit_beta_xi((int)k) = terma;
+
+        // Log likelihood of the enrolment samples
+        const size_t n_samples = ar.extent(0);
+        double llh = base.getLogLikeConstTerm(n_samples);
+        bob::math::prod(base.getGamma(n_samples), wsum, tmp_nf_2);
+        double termb = 1 / 2. * (blitz::sum(wsum*tmp_nf_2));
+        llh += terma + termb;
+        log_likelihood((int)k) = llh;
+      }
+    }
+  };
+
+  /**
+   * Checks the samples of the clients, adds gamma_a and the log likelihood
+   * constant terms of their numbers of samples a (and a+1, used for 
+   * scoring) to the base machine, and computes their enrolment data
+   */
+  void enrolClients(mach::PLDABaseMachine& base,
+    const std::vector<blitz::Array<double,2> >& clients,
+    blitz::Array<double,2>& weighted_sum, 
+    blitz::Array<double,1>& nh_sum_xit_beta_xi,
+    blitz::Array<double,1>& log_likelihood, const size_t n_threads)
+  {
+    for(size_t k=0; k<clients.size(); ++k) {
+      if(clients[k].extent(1) != (int)base.getDimD())
+        throw bob::trainer::WrongNumberOfFeatures(clients[k].extent(1), 
+          base.getDimD(), k);
+      const size_t n_samples = clients[k].extent(0);
+      base.getAddGamma(n_samples);
+      base.getAddLogLikeConstTerm(n_samples);
+      base.getAddGamma(n_samples+1);
+      base.getAddLogLikeConstTerm(n_samples+1);
+    }
+
+    weighted_sum.resize(clients.size(), base.getDimF());
+    nh_sum_xit_beta_xi.resize(clients.size());
+    log_likelihood.resize(clients.size());
+    // The clients are split across the threads
+    bob::core::thread_loop(enrolRange(base, clients, weighted_sum, 
+        nh_sum_xit_beta_xi, log_likelihood), clients.size(), n_threads);
+  }
+
+}
+
+void bob::trainer::plda::enrol(mach::PLDABaseMachine& base,
+  const std::vector<blitz::Array<double,2> >& clients,
+  const std::vector<boost::shared_ptr<mach::PLDAMachine> >& models,
+  const size_t n_threads)
+{
+  bob::core::array::assertSameDimensionLength(clients.size(), models.size());
+  for(size_t k=0; k<models.size(); ++k) {
+    // The models should be attached to the given PLDABaseMachine
+    if(models[k]->getPLDABase().get() != &base)
+      throw bob::trainer::IncompatibleMachine();
+  }
+
+  blitz::Array<double,2> weighted_sum;
+  blitz::Array<double,1> nh_sum_xit_beta_xi, log_likelihood;
+  enrolClients(base, clients, weighted_sum, nh_sum_xit_beta_xi, 
+    log_likelihood, n_threads);
+
+  for(size_t k=0; k<models.size(); ++k) {
+    mach::PLDAMachine& model = *models[k];
+    model.resize(model.getDimD(), model.getDimF(), model.getDimG());
+    model.setNSamples(clients[k].extent(0));
+    model.updateWeightedSum() = weighted_sum((int)k, blitz::Range::all());
+    model.setWSumXitBetaXi(nh_sum_xit_beta_xi((int)k));
+    model.setLogLikelihood(log_likelihood((int)k));
+  }
+}
+
+void bob::trainer::plda::enrol(mach::PLDABaseMachine& base,
+  const std::vector<blitz::Array<double,2> >& clients,
+  const blitz::Array<int64_t,1>& ids, mach::ModelBank& bank,
+  const size_t n_threads)
+{
+  bob::core::array::assertSameDimensionLength(clients.size(), ids.extent(0));
+
+  blitz::Array<double,2> weighted_sum;
+  blitz::Array<double,1> nh_sum_xit_beta_xi, log_likelihood;
+  enrolClients(base, clients, weighted_sum, nh_sum_xit_beta_xi, 
+    log_likelihood, n_threads);
+
+  // The fields of all the clients are written at once (the scalar fields
+  // as single column arrays)
+  blitz::Array<double,2> n_samples(clients.size(), 1);
+  blitz::Array<double,2> nh_sum_xit_beta_xi_(clients.size(), 1);
+  blitz::Array<double,2> log_likelihood_(clients.size(), 1);
+  for(size_t k=0; k<clients.size(); ++k) {
+    n_samples((int)k, 0) = clients[k].extent(0);
+    nh_sum_xit_beta_xi_((int)k, 0) = nh_sum_xit_beta_xi((int)k);
+    log_likelihood_((int)k, 0) = log_likelihood((int)k);
+  }
+  bank.set(ids, "weighted_sum", weighted_sum);
+  bank.set(ids, "n_samples", n_samples);
+  bank.set(ids, "nh_sum_xit_beta_xi", nh_sum_xit_beta_xi_);
+  bank.set(ids, "log_likelihood", log_likelihood_);
+}
@@ -20,6 +20,9 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <cstring>
+#include <boost/bind.hpp>
 #include <boost/format.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/algorithm/string.hpp>
@@ -27,6 +30,7 @@
 #include "bob/trainer/SVMTrainer.h"
 #include "bob/core/blitz_compat.h"
 #include "bob/core/logging.h"
+#include "bob/core/parallel.h"
 
 namespace trainer = bob::trainer;
 
@@ -70,6 +74,7 @@ trainer::SVMTrainer::SVMTrainer(
   m_param.p = p;
   m_param.shrinking = shrinking;
   m_param.probability = probability;
+  m_n_threads = 1;
 
   //extracted from the data
   m_param.nr_weight = 0;
@@ -89,9 +94,8 @@ trainer::SVMTrainer::~SVMTrainer() { }
  * };
  *
  * At svm-train the nodes for each entry are allocated globally, what is
- * probably more efficient from the allocation perspective. It still requires
- * libsvm to scan the data twice to understand how many nodes need to be
- * allocated globally.
+ * probably more efficient from the allocation perspective. We do the same
+ * (see data2problem()), so x[0] points to the nodes of all the entries.
  */
 static void delete_problem(svm_problem* p) {
   delete[] p->y; //all labels
@@ -122,17 +126,6 @@ static boost::shared_ptr<svm_problem> data2problem
  const blitz::Array<double,1>& sub, const blitz::Array<double,1>& div,
  svm_parameter& param) {
 
-  //counts the number of samples required
-  size_t entries = 0;
-  for (size_t k=0; k<data.size(); ++k)
-    entries += data[k].extent(blitz::firstDim);
-
-  //allocates the container that will represent the problem; at this stage, we
-  //allocate entries for each vector, but not the space in which feature will
-  //be put at. This will come next.
-  boost::shared_ptr<svm_problem> problem(new_problem(entries),
-      std::ptr_fun(delete_problem));
-
   //choose labels.
   if ((data.size() <= 1) | (data.size() > 16)) {
     boost::format m("Only supports SVMs for binary or multi-class classification problems (up to 16 classes). You passed me a list of %d arraysets.");
@@ -151,29 +144,23 @@ static boost::shared_ptr<svm_problem> data2problem
     for (size_t k=0; k<data.size(); ++k) labels.push_back(k+1);
   }
 
-  //just count how many nodes we need; unfortunately we have no other choice
-  //than doing a 2-pass instantiation here as libsvm has a very weird way to
-  //optimize data access in which it requires all nodes to be allocated in a
-  //single shot.
-  size_t nodes = 0; //total number of nodes to be allocated
-  blitz::Range all=blitz::Range::all();
-  int n_features = data[0].extent(blitz::secondDim);
-  blitz::Array<double,1> d(n_features); //for temporary feature manipulation
+  //counts the number of samples required
+  size_t entries = 0;
+  for (size_t k=0; k<data.size(); ++k)
+    entries += data[k].extent(blitz::firstDim);
 
-  for (size_t k=0; k<data.size(); ++k) {
-    for (int i=0; i<data[k].extent(blitz::firstDim); ++i) {
-      d = (data[k](i,all)-sub)/div; //eval and copy in 1 instruction
-      for (int p=0; p<d.extent(blitz::firstDim); ++p) {
-        if (d(p)) {
-          ++nodes;
-        }
-      }
-      ++nodes; //one extra for the termination node "index == -1"
-    }
-  }
+  //allocates the container that will represent the problem; at this stage, we
+  //allocate entries for each vector, but not the space in which feature will
+  //be put at. This will come next.
+  boost::shared_ptr<svm_problem> problem(new_problem(entries),
+      std::ptr_fun(delete_problem));
 
-  //allocates all the nodes, set first entry, a la libsvm
-  svm_node* all_nodes = new svm_node[nodes];
+  //libsvm requires all nodes to be allocated in a single shot. As the input
+  //is dense, a sample never needs more than n_features nodes, plus one for
+  //the termination node "index == -1": the upper bound is allocated, which
+  //avoids a first pass over the data just to count the non-zero features.
+  int n_features = data[0].extent(blitz::secondDim);
+  svm_node* all_nodes = new svm_node[entries * (n_features + 1)];
   
   //iterates over each class data and fills the svm_node's
   int max_index = 0; //data width
@@ -181,14 +168,15 @@ static boost::shared_ptr<svm_problem> data2problem
   size_t node = 0; //node counter
 
   for (size_t k=0; k<data.size(); ++k) {
-    for (int i=0; i<data[k].extent(blitz::firstDim); ++i) {
+    const blitz::Array<double,2>& d = data[k];
+    for (int i=0; i<d.extent(blitz::firstDim); ++i) {
       problem->x[sample] = &all_nodes[node]; //setup current sample base pointer
-      d = (data[k](i,all)-sub)/div; //eval and copy in 1 instruction
-      for (blitz::sizeType p=0; p<d.size(); ++p) {
-        if (d(p)) {
+      for (int p=0; p<n_features; ++p) {
+        const double value = (d(i,p) - sub(p)) / div(p);
+        if (value) {
           int index = p+1; //starts indexing at 1
           all_nodes[node].index = index;
-          all_nodes[node].value = d(p);
+          all_nodes[node].value = value;
           if ( index > max_index ) max_index = index;
           ++node; //index within the current sample
         }
@@ -226,6 +214,148 @@ static void svm_model_free(svm_model*& m) {
 #endif
 }
 
+/**
+ * The solution of the one-vs-one sub-problem of classes i and j: the indices
+ * (in the complete problem) and the coefficients of its support vectors, and
+ * its bias
+ */
+struct svm_pair {
+  size_t i;
+  size_t j;
+  std::vector<std::pair<size_t,double> > coef;
+  double rho;
+};
+
+/**
+ * Solves the one-vs-one sub-problems [begin, end), exactly as svm_train()
+ * does for a multi-class problem: the samples of class i are labelled +1,
+ * the ones of class j -1, and they keep their order. The samples of class k
+ * are the entries [start[k], start[k+1]) of the problem.
+ */
+static void train_pairs(const svm_problem& problem, 
+    const std::vector<size_t>& start, const svm_parameter& param, 
+    std::vector<svm_pair>& pairs, size_t begin, size_t end) {
+  for (size_t p=begin; p<end; ++p) {
+    svm_pair& pair = pairs[p];
+    const size_t n_i = start[pair.i+1] - start[pair.i];
+    const size_t n_j = start[pair.j+1] - start[pair.j];
+    std::vector<double> y(n_i + n_j);
+    std::vector<svm_node*> x(n_i + n_j);
+    for (size_t k=0; k<n_i; ++k) {
+      x[k] = problem.x[start[pair.i]+k];
+      y[k] = +1.;
+    }
+    for (size_t k=0; k<n_j; ++k) {
+      x[n_i+k] = problem.x[start[pair.j]+k];
+      y[n_i+k] = -1.;
+    }
+    svm_problem sub;
+    sub.l = (int)(n_i + n_j);
+    sub.y = &y[0];
+    sub.x = &x[0];
+
+    svm_model* model = svm_train(&sub, &param);
+    pair.rho = model->rho[0];
+    //the support vectors point to the nodes of the complete problem, whose
+    //entries are sorted by address (see data2problem())
+    for (int k=0; k<model->l; ++k) {
+      svm_node** entry = std::lower_bound(problem.x, problem.x + problem.l,
+          model->SV[k]);
+      pair.coef.push_back(std::make_pair((size_t)(entry - problem.x), 
+            model->sv_coef[0][k]));
+    }
+    svm_model_free(model);
+  }
+}
+
+/**
+ * The assembled model only refers to memory owned by its builder
+ */
+static void svm_model_keep(svm_model*) { }
+
+/**
+ * Trains a multi-class (C or nu) classification problem of n_classes 
+ * classes, whose labels are 1, 2, ..., with n_threads threads, and returns
+ * the pickled model. The sub-problems are solved concurrently, each thread
+ * getting its share of the kernel cache, and are then assembled into the 
+ * model that svm_train() would have returned.
+ */
+static blitz::Array<uint8_t,1> train_one_vs_one(const svm_problem& problem,
+    const std::vector<blitz::Array<double,2> >& data, 
+    const svm_parameter& param, size_t n_threads) {
+
+  const size_t n_classes = data.size();
+  std::vector<size_t> start(n_classes+1, 0);
+  for (size_t k=0; k<n_classes; ++k) 
+    start[k+1] = start[k] + data[k].extent(blitz::firstDim);
+
+  std::vector<svm_pair> pairs;
+  for (size_t i=0; i<n_classes; ++i) {
+    for (size_t j=i+1; j<n_classes; ++j) {
+      svm_pair pair;
+      pair.i = i;
+      pair.j = j;
+      pair.rho = 0.;
+      pairs.push_back(pair);
+    }
+  }
+
+  svm_parameter sub_param = param;
+  sub_param.cache_size = param.cache_size / std::min(n_threads, pairs.size());
+  bob::core::thread_loop(boost::bind(&train_pairs, boost::cref(problem),
+        boost::cref(start), boost::cref(sub_param), boost::ref(pairs), _1, _2),
+      pairs.size(), n_threads);
+
+  //a sample is a support vector of the model if it is one of any sub-problem
+  std::vector<int> sv_index(problem.l, -1);
+  for (size_t p=0; p<pairs.size(); ++p)
+    for (size_t k=0; k<pairs[p].coef.size(); ++k) 
+      sv_index[pairs[p].coef[k].first] = 0;
+  std::vector<int> n_sv(n_classes, 0);
+  std::vector<svm_node*> sv;
+  for (size_t c=0; c<n_classes; ++c) {
+    for (size_t k=start[c]; k<start[c+1]; ++k) {
+      if (sv_index[k] < 0) continue;
+      sv_index[k] = (int)sv.size();
+      sv.push_back(problem.x[k]);
+      ++n_sv[c];
+    }
+  }
+
+  //the coefficients of a support vector of class i in the sub-problem (i,j)
+  //are on row j-1, the ones of a support vector of class j on row i
+  const size_t l = sv.size();
+  std::vector<double> coef((n_classes-1) * l, 0.);
+  std::vector<double*> sv_coef(n_classes-1);
+  for (size_t c=0; c<n_classes-1; ++c) sv_coef[c] = &coef[c*l];
+  std::vector<double> rho(pairs.size());
+  for (size_t p=0; p<pairs.size(); ++p) {
+    const svm_pair& pair = pairs[p];
+    for (size_t k=0; k<pair.coef.size(); ++k) {
+      const size_t entry = pair.coef[k].first;
+      const size_t row = (entry < start[pair.i+1]) ? pair.j-1 : pair.i;
+      sv_coef[row][sv_index[entry]] = pair.coef[k].second;
+    }
+    rho[p] = pair.rho;
+  }
+  std::vector<int> labels(n_classes);
+  for (size_t c=0; c<n_classes; ++c) labels[c] = (int)(c+1);
+
+  svm_model model;
+  std::memset(&model, 0, sizeof(svm_model));
+  model.param = param;
+  model.nr_class = (int)n_classes;
+  model.l = (int)l;
+  model.SV = l ? &sv[0] : 0;
+  model.sv_coef = &sv_coef[0];
+  model.rho = &rho[0];
+  model.label = &labels[0];
+  model.nSV = &n_sv[0];
+
+  return bob::machine::svm_pickle(boost::shared_ptr<svm_model>(&model,
+        std::ptr_fun(svm_model_keep)));
+}
+
 boost::shared_ptr<bob::machine::SupportVector> trainer::SVMTrainer::train
 (const std::vector<blitz::Array<double, 2> >& data,
  const blitz::Array<double,1>& input_subtraction,
@@ -241,20 +371,17 @@ boost::shared_ptr<bob::machine::SupportVector> trainer::SVMTrainer::train
   }
 
   //converts the input arraysets into something libsvm can digest
-  double save_gamma = m_param.gamma; ///< the next method may update it!
+  svm_parameter param = m_param; ///< the next method may update gamma
   boost::shared_ptr<svm_problem> problem = 
-    data2problem(data, input_subtraction, input_division, 
-        const_cast<svm_parameter&>(m_param) ///< temporary cast
-        );
+    data2problem(data, input_subtraction, input_division, param);
   
   //checks parametrization to make sure all is alright.
-  const char* error_msg = svm_check_parameter(problem.get(), &m_param);
+  const char* error_msg = svm_check_parameter(problem.get(), &param);
 
   if (error_msg) {
-    const_cast<double&>(m_param.gamma) = save_gamma;
     boost::format m("libsvm-%d reports: %s");
     m % libsvm_version % error_msg;
-    std::runtime_error(m.str());
+    throw bob::core::InvalidArgumentException(m.str());
   }
 
   //do the training, returns the new machine
@@ -265,15 +392,20 @@ boost::shared_ptr<bob::machine::SupportVector> trainer::SVMTrainer::train
   m % libsvm_version;
   debug_libsvm(m.str().c_str());
 #endif
-  boost::shared_ptr<svm_model> model(svm_train(problem.get(), &m_param),
-      std::ptr_fun(svm_model_free));
-
-  const_cast<double&>(m_param.gamma) = save_gamma;
 
   //save newly created machine to file, reload from there to get rid of memory
   //dependencies due to the poorly implemented memory model in libsvm
-  boost::shared_ptr<svm_model> new_model = 
-    bob::machine::svm_unpickle(bob::machine::svm_pickle(model));
+  blitz::Array<uint8_t,1> pickled;
+  if (m_n_threads > 1 && data.size() > 2 && !param.probability &&
+      (param.svm_type == C_SVC || param.svm_type == NU_SVC)) {
+    pickled.reference(train_one_vs_one(*problem, data, param, m_n_threads));
+  }
+  else {
+    boost::shared_ptr<svm_model> model(svm_train(problem.get(), &param),
+        std::ptr_fun(svm_model_free));
+    pickled.reference(bob::machine::svm_pickle(model));
+  }
+  boost::shared_ptr<svm_model> new_model = bob::machine::svm_unpickle(pickled);
 
   boost::shared_ptr<bob::machine::SupportVector> retval =
     boost::make_shared<bob::machine::SupportVector>(new_model);
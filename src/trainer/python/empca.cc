@@ -38,6 +38,11 @@ void bind_trainer_empca() {
     .add_property("max_iterations", &EMTrainerLinearBase::getMaxIterations, &EMTrainerLinearBase::setMaxIterations, "Max iterations")
     .add_property("compute_likelihood_variable", &EMTrainerLinearBase::getComputeLikelihood, &EMTrainerLinearBase::setComputeLikelihood, "Indicates whether the log likelihood should be computed during EM or not")
     .def("train", &EMTrainerLinearBase::train, (arg("machine"), arg("data")), "Trains a machine using data")
+    .def("resume", &EMTrainerLinearBase::resume, (arg("self"), arg("machine"), arg("data"), arg("checkpoint")), "Resumes a training from a checkpoint: the trainer is initialized with the data, the machine and the state of the trainer are loaded from the checkpoint, and the training goes on until convergence or until max_iterations iterations (including those of the checkpoint) are reached")
+    .def("set_observer", &EMTrainerLinearBase::setObserver, (arg("self"), arg("observer")), "Sets the callable, called with an EMIteration after the initial E-step and after each iteration (None disables the notifications)")
+    .def("set_checkpoint", &EMTrainerLinearBase::setCheckpoint, (arg("self"), arg("filename"), arg("every")=1), "Saves the machine and the state of the trainer into the given HDF5 file every 'every' iterations, such that the training may be resumed with resume(). The file is first written to filename.tmp, which is then renamed. An empty filename disables the checkpoints.")
+    .add_property("checkpoint", make_function(&EMTrainerLinearBase::getCheckpoint, return_value_policy<copy_const_reference>()), "The file of the checkpoints")
+    .add_property("checkpoint_every", &EMTrainerLinearBase::getCheckpointEvery, "The number of iterations between two checkpoints")
     .def("initialization", &EMTrainerLinearBase::initialization, (arg("machine"), arg("data")), "This method is called before the EM algorithm")
     .def("finalization", &EMTrainerLinearBase::finalization, (arg("machine"), arg("data")), "This method is called at the end of the EM algorithm")
     .def("e_step", &EMTrainerLinearBase::eStep, (arg("machine"), arg("data")),
@@ -50,8 +55,15 @@ void bind_trainer_empca() {
       "This class implements the EM algorithm for a Linear Machine (Probabilistic PCA).\n"
       "See Section 12.2 of Bishop, \"Pattern recognition and machine learning\", 2006", init<int,optional<double,double,bool> >((arg("dimensionality"), arg("convergence_threshold"), arg("max_iterations"), arg("compute_likelihood"))))
     .def("train", &ppca_train, (arg("self"), arg("data")), "Trains and returns a Linear machine using the provided data")
+    .def("train", &EMTrainerLinearBase::train, (arg("self"), arg("machine"), arg("data")), "Trains a machine using data")
+    .def("train", (void (bob::trainer::EMPCATrainer::*)(bob::machine::LinearMachine&, bob::trainer::BlockSampler&))&bob::trainer::EMPCATrainer::train, (arg("self"), arg("machine"), arg("sampler")), "Trains a machine using the samples streamed by a BlockSampler, with a single pass over the samples per E-step")
+    .def("initialization", (void (bob::trainer::EMPCATrainer::*)(bob::machine::LinearMachine&, const blitz::Array<double,2>&))&bob::trainer::EMPCATrainer::initialization, (arg("self"), arg("machine"), arg("data")), "This method is called before the EM algorithm")
+    .def("initialization", (void (bob::trainer::EMPCATrainer::*)(bob::machine::LinearMachine&, bob::trainer::BlockSampler&))&bob::trainer::EMPCATrainer::initialization, (arg("self"), arg("machine"), arg("sampler")), "This method is called before the EM algorithm, when training with a BlockSampler (with a pass over the samples to compute their mean)")
+    .def("e_step", &EMTrainerLinearBase::eStep, (arg("self"), arg("machine"), arg("data")), "Updates the sufficient statistics given the Machine parameters")
+    .def("e_step", (void (bob::trainer::EMPCATrainer::*)(bob::machine::LinearMachine&, bob::trainer::BlockSampler&))&bob::trainer::EMPCATrainer::eStep, (arg("self"), arg("machine"), arg("sampler")), "Updates the sufficient statistics given the Machine parameters, with a single pass over the samples streamed by a BlockSampler")
     .add_property("seed", &bob::trainer::EMPCATrainer::getSeed, &bob::trainer::EMPCATrainer::setSeed, "The seed for the random initialization of W and sigma2")
     .add_property("sigma2", &bob::trainer::EMPCATrainer::getSigma2, &bob::trainer::EMPCATrainer::setSigma2, "The noise sigma2 of the probabilistic model")
+    .add_property("n_threads", &bob::trainer::EMPCATrainer::getNThreads, &bob::trainer::EMPCATrainer::setNThreads, "The number of threads the E-step is split across. Each thread accumulates the statistics of a contiguous shard of the samples.")
   ;
 
 }
@@ -0,0 +1,79 @@
+/**
+ * @file trainer/python/emtrainer.cc
+ * @date Mon Oct 19 23:12:40 2026 +0200
+ *
+ * @brief Python bindings to the iteration records and observers shared by
+ * all the EM trainers
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/python.hpp>
+#include "bob/trainer/EMTrainer.h"
+
+using namespace boost::python;
+namespace train = bob::trainer;
+
+/**
+ * Calls a python callable with the EMIteration. The EM trainers are called
+ * from python with the GIL held, and the observer is called from the thread
+ * running the training.
+ */
+struct python_observer {
+  object m_callable;
+  python_observer(object callable): m_callable(callable) {}
+  void operator()(const train::EMIteration& it) const { m_callable(it); }
+};
+
+/**
+ * Converts a python callable, or None, to an EMObserver
+ */
+struct python_to_em_observer {
+
+  python_to_em_observer() {
+    converter::registry::push_back(&convertible, &construct,
+        type_id<train::EMObserver>());
+  }
+
+  static void* convertible(PyObject* obj_ptr) {
+    if (obj_ptr == Py_None || PyCallable_Check(obj_ptr)) return obj_ptr;
+    return 0;
+  }
+
+  static void construct(PyObject* obj_ptr,
+      converter::rvalue_from_python_stage1_data* data) {
+    void* storage = ((converter::rvalue_from_python_storage<train::EMObserver>*)data)->storage.bytes;
+    if (obj_ptr == Py_None) new (storage) train::EMObserver();
+    else new (storage) train::EMObserver(python_observer(object(handle<>(borrowed(obj_ptr)))));
+    data->convertible = storage;
+  }
+
+};
+
+void bind_trainer_emtrainer() {
+
+  python_to_em_observer();
+
+  class_<train::EMIteration>("EMIteration", "The measurements of an iteration of an EM training, as given to the observer of an EM trainer (see set_observer()). Times are in seconds, the CPU times being those of the whole process.", no_init)
+    .def_readonly("iteration", &train::EMIteration::iteration, "The number of completed iterations. It is 0 for the initial E-step (or, when resuming, the number of iterations of the checkpoint), whose M-step times are then 0.")
+    .def_readonly("likelihood", &train::EMIteration::likelihood, "The average output of the machine, NaN if it is not computed")
+    .def_readonly("delta", &train::EMIteration::delta, "The relative change of the average output, NaN if it is not computed")
+    .def_readonly("e_step_wall", &train::EMIteration::e_step_wall, "The wall time of the E-step")
+    .def_readonly("e_step_cpu", &train::EMIteration::e_step_cpu, "The CPU time of the E-step")
+    .def_readonly("m_step_wall", &train::EMIteration::m_step_wall, "The wall time of the M-step")
+    .def_readonly("m_step_cpu", &train::EMIteration::m_step_cpu, "The CPU time of the M-step")
+  ;
+
+}
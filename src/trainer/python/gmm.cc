@@ -21,12 +21,42 @@
 #include "bob/trainer/GMMTrainer.h"
 #include "bob/trainer/MAP_GMMTrainer.h"
 #include "bob/trainer/ML_GMMTrainer.h"
+#include "bob/core/python/gil.h"
 
 using namespace boost::python;
 namespace train = bob::trainer;
 namespace mach = bob::machine;
 namespace io = bob::io;
 
+static void extractGMMStats(list stats, 
+  std::vector<boost::shared_ptr<const mach::GMMStats> >& stats_)
+{
+  for(int i=0; i<len(stats); ++i)
+    stats_.push_back(extract<boost::shared_ptr<mach::GMMStats> >(stats[i]));
+}
+
+static void map_enrol(const train::MAP_GMMTrainer& t, list stats, 
+  list models, const size_t n_threads)
+{
+  std::vector<boost::shared_ptr<const mach::GMMStats> > stats_;
+  extractGMMStats(stats, stats_);
+  std::vector<boost::shared_ptr<mach::GMMMachine> > models_;
+  for(int i=0; i<len(models); ++i)
+    models_.push_back(extract<boost::shared_ptr<mach::GMMMachine> >(models[i]));
+  bob::python::no_gil unlock;
+  t.enrol(stats_, models_, n_threads);
+}
+
+static void map_enrol_bank(const train::MAP_GMMTrainer& t, list stats, 
+  const blitz::Array<int64_t,1>& ids, mach::ModelBank& bank, 
+  const size_t n_threads)
+{
+  std::vector<boost::shared_ptr<const mach::GMMStats> > stats_;
+  extractGMMStats(stats, stats_);
+  bob::python::no_gil unlock;
+  t.enrol(stats_, ids, bank, n_threads);
+}
+
 void bind_trainer_gmm() {
 
   typedef train::EMTrainer<mach::GMMMachine, blitz::Array<double,2> > EMTrainerGMMBase; 
@@ -35,6 +65,11 @@ void bind_trainer_gmm() {
     .add_property("convergence_threshold", &EMTrainerGMMBase::getConvergenceThreshold, &EMTrainerGMMBase::setConvergenceThreshold, "Convergence threshold")
     .add_property("max_iterations", &EMTrainerGMMBase::getMaxIterations, &EMTrainerGMMBase::setMaxIterations, "Max iterations")
     .def("train", &EMTrainerGMMBase::train, (arg("machine"), arg("data")), "Train a machine using data")
+    .def("resume", &EMTrainerGMMBase::resume, (arg("self"), arg("machine"), arg("data"), arg("checkpoint")), "Resumes a training from a checkpoint: the trainer is initialized with the data, the machine and the state of the trainer are loaded from the checkpoint, and the training goes on until convergence or until max_iterations iterations (including those of the checkpoint) are reached")
+    .def("set_observer", &EMTrainerGMMBase::setObserver, (arg("self"), arg("observer")), "Sets the callable, called with an EMIteration after the initial E-step and after each iteration (None disables the notifications)")
+    .def("set_checkpoint", &EMTrainerGMMBase::setCheckpoint, (arg("self"), arg("filename"), arg("every")=1), "Saves the machine and the state of the trainer into the given HDF5 file every 'every' iterations, such that the training may be resumed with resume(). The file is first written to filename.tmp, which is then renamed. An empty filename disables the checkpoints.")
+    .add_property("checkpoint", make_function(&EMTrainerGMMBase::getCheckpoint, return_value_policy<copy_const_reference>()), "The file of the checkpoints")
+    .add_property("checkpoint_every", &EMTrainerGMMBase::getCheckpointEvery, "The number of iterations between two checkpoints")
     .def("initialization", &EMTrainerGMMBase::initialization, (arg("machine"), arg("data")), "This method is called before the EM algorithm")
     .def("finalization", &EMTrainerGMMBase::finalization, (arg("machine"), arg("data")), "This method is called after the EM algorithm")
     .def("e_step", &EMTrainerGMMBase::eStep, (arg("machine"), arg("data")),
@@ -51,6 +86,15 @@ void bind_trainer_gmm() {
       "This class implements the E-step of the expectation-maximisation algorithm for a GMM Machine.\n"
       "See Section 9.2.2 of Bishop, \"Pattern recognition and machine learning\", 2006", no_init)
     .add_property("gmm_statistics", &bob::trainer::GMMTrainer::getGMMStats, &bob::trainer::GMMTrainer::setGMMStats, "The internal GMM statistics. Useful to parallelize the E-step.")
+    .def("train", &EMTrainerGMMBase::train, (arg("self"), arg("machine"), arg("data")), "Train a machine using data")
+    .def("train", (void (train::GMMTrainer::*)(mach::GMMMachine&, train::BlockSampler&))&train::GMMTrainer::train, (arg("self"), arg("machine"), arg("sampler")), "Train a machine using the samples streamed by a BlockSampler, with a single pass over the samples per E-step")
+    .def("resume", &EMTrainerGMMBase::resume, (arg("self"), arg("machine"), arg("data"), arg("checkpoint")), "Resumes a training from a checkpoint: the trainer is initialized with the data, the machine and the state of the trainer are loaded from the checkpoint, and the training goes on until convergence or until max_iterations iterations (including those of the checkpoint) are reached")
+    .def("resume", (void (train::GMMTrainer::*)(mach::GMMMachine&, train::BlockSampler&, const std::string&))&train::GMMTrainer::resume, (arg("self"), arg("machine"), arg("sampler"), arg("checkpoint")), "Resumes a training from a checkpoint, using the samples streamed by a BlockSampler")
+    .def("initialization", &EMTrainerGMMBase::initialization, (arg("self"), arg("machine"), arg("data")), "This method is called before the EM algorithm")
+    .def("initialization", (void (train::GMMTrainer::*)(mach::GMMMachine&, train::BlockSampler&))&train::GMMTrainer::initialization, (arg("self"), arg("machine"), arg("sampler")), "This method is called before the EM algorithm, when training with a BlockSampler")
+    .def("e_step", &EMTrainerGMMBase::eStep, (arg("self"), arg("machine"), arg("data")), "Update the sufficient statistics given the Machine parameters")
+    .def("e_step", (void (train::GMMTrainer::*)(mach::GMMMachine&, train::BlockSampler&))&train::GMMTrainer::eStep, (arg("self"), arg("machine"), arg("sampler")), "Update the sufficient statistics given the Machine parameters, with a single pass over the samples streamed by a BlockSampler")
+    .add_property("n_threads", &bob::trainer::GMMTrainer::getNThreads, &bob::trainer::GMMTrainer::setNThreads, "The number of threads the E-step is split across. Each thread accumulates the statistics of a contiguous shard of the samples.")
   ;
 
   class_<train::MAP_GMMTrainer, boost::noncopyable, bases<train::GMMTrainer> >("MAP_GMMTrainer",
@@ -68,6 +112,16 @@ void bind_trainer_gmm() {
       "Use a torch3-like MAP adaptation rule instead of Reynolds'one.")
     .def("unset_t3_map", &train::MAP_GMMTrainer::unsetT3MAP,
       "Use a Reynolds' MAP adaptation (rather than torch3-like).")
+    .def("enrol", &map_enrol, (arg("self"), arg("stats"), arg("models"), arg("n_threads")=1),
+      "Adapts one GMMMachine per client from the prior GMM, given the list "
+      "of the GMMStats of the clients, computed with the prior GMM. This "
+      "corresponds to a single MAP iteration. The clients are split across "
+      "n_threads threads.")
+    .def("enrol", &map_enrol_bank, (arg("self"), arg("stats"), arg("ids"), arg("bank"), arg("n_threads")=1),
+      "Adapts the mean supervectors of the clients from the prior GMM as "
+      "above, and writes them into the 'mean' field of the ModelBank, with "
+      "the given identifiers (a 1D int64 array). Only the means can be "
+      "adapted.")
   ;
  
   class_<train::ML_GMMTrainer, boost::noncopyable, bases<train::GMMTrainer> >("ML_GMMTrainer",
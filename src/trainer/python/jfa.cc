@@ -25,6 +25,7 @@
 #include "bob/trainer/JFATrainer.h"
 #include "bob/machine/JFAMachine.h"
 #include <boost/shared_ptr.hpp>
+#include "bob/core/python/gil.h"
 
 using namespace boost::python;
 namespace train = bob::trainer;
@@ -44,24 +45,24 @@ static void estimate_xandu(tp::const_ndarray F, tp::const_ndarray N,
     tp::const_ndarray d, tp::const_ndarray v,
     tp::const_ndarray u, tp::const_ndarray z,
     tp::const_ndarray y, tp::ndarray x,
-    tp::const_ndarray spk_ids) {
+    tp::const_ndarray spk_ids, const size_t n_threads) {
   blitz::Array<double,2> x_ = x.bz<double,2>();
   train::jfa::estimateXandU(F.bz<double,2>(), N.bz<double,2>(),
       m.bz<double,1>(), E.bz<double,1>(), d.bz<double,1>(), v.bz<double,2>(),
       u.bz<double,2>(), z.bz<double,2>(), y.bz<double,2>(), x_,
-      spk_ids.bz<uint32_t,1>());
+      spk_ids.bz<uint32_t,1>(), n_threads);
 }
 
 static void estimate_yandv(tp::const_ndarray F, tp::const_ndarray N,
   tp::const_ndarray m, tp::const_ndarray E, 
   tp::const_ndarray d, tp::const_ndarray v, 
   tp::const_ndarray u, tp::const_ndarray z, 
-  tp::ndarray y, tp::const_ndarray x, tp::const_ndarray spk_ids) {
+  tp::ndarray y, tp::const_ndarray x, tp::const_ndarray spk_ids, const size_t n_threads) {
   blitz::Array<double,2> y_ = y.bz<double,2>();
   train::jfa::estimateYandV(F.bz<double,2>(), N.bz<double,2>(),
       m.bz<double,1>(), E.bz<double,1>(), d.bz<double,1>(), v.bz<double,2>(),
       u.bz<double,2>(), z.bz<double,2>(), y_, x.bz<double,2>(), 
-      spk_ids.bz<uint32_t,1>());
+      spk_ids.bz<uint32_t,1>(), n_threads);
 }
 
 static void estimate_zandd(tp::const_ndarray F, tp::const_ndarray N,
@@ -69,12 +70,12 @@ static void estimate_zandd(tp::const_ndarray F, tp::const_ndarray N,
   tp::const_ndarray d, tp::const_ndarray v,
   tp::const_ndarray u, tp::ndarray z,
   tp::const_ndarray y, tp::const_ndarray x,
-  tp::const_ndarray spk_ids) {
+  tp::const_ndarray spk_ids, const size_t n_threads) {
   blitz::Array<double,2> z_ = z.bz<double,2>();
   train::jfa::estimateZandD(F.bz<double,2>(), N.bz<double,2>(),
       m.bz<double,1>(), E.bz<double,1>(), d.bz<double,1>(), v.bz<double,2>(),
       u.bz<double,2>(), z_, y.bz<double,2>(), x.bz<double,2>(),
-      spk_ids.bz<uint32_t,1>());
+      spk_ids.bz<uint32_t,1>(), n_threads);
 }
 
 static void extractGMMStatsVectors(list list_stats, 
@@ -94,6 +95,57 @@ static void extractGMMStatsVectors(list list_stats,
   }
 }
 
+static void stats_add_person(train::JFATrainingStats& s, list sessions)
+{
+  const size_t n_sessions = len(sessions);
+  // The sessions are given either as GMMStats or as HDF5 files of GMMStats
+  if(n_sessions > 0 && extract<std::string>(sessions[0]).check()) {
+    std::vector<std::string> filenames;
+    for(size_t h=0; h<n_sessions; ++h)
+      filenames.push_back(extract<std::string>(sessions[h]));
+    s.addPerson(filenames);
+  }
+  else {
+    std::vector<boost::shared_ptr<const mach::GMMStats> > gmm_stats;
+    for(size_t h=0; h<n_sessions; ++h) {
+      boost::shared_ptr<mach::GMMStats> gs = extract<boost::shared_ptr<mach::GMMStats> >(sessions[h]);
+      gmm_stats.push_back(gs);
+    }
+    s.addPerson(gmm_stats);
+  }
+}
+
+static void stats_load(train::JFATrainingStats& s, list persons)
+{
+  const size_t n_persons = len(persons);
+  std::vector<std::vector<std::string> > filenames(n_persons);
+  for(size_t id=0; id<n_persons; ++id) {
+    object sessions = persons[id];
+    const size_t n_sessions = len(sessions);
+    for(size_t h=0; h<n_sessions; ++h)
+      filenames[id].push_back(extract<std::string>(sessions[h]));
+  }
+  s.load(filenames);
+}
+
+static size_t stats_n_sessions(const train::JFATrainingStats& s) {
+  return s.getNSessions();
+}
+
+static tuple stats_offsets(const train::JFATrainingStats& s) {
+  list retval;
+  for(size_t k=0; k<s.getOffsets().size(); ++k) retval.append(s.getOffsets()[k]);
+  return tuple(retval);
+}
+
+static blitz::Array<double,2> stats_n(const train::JFATrainingStats& s) {
+  return ca::ccopy(s.getN());
+}
+
+static blitz::Array<double,2> stats_f(const train::JFATrainingStats& s) {
+  return s.getF();
+}
+
 static void jfa_train(train::JFABaseTrainer& t, list list_stats, const size_t n_iter)
 {
   std::vector<std::vector<boost::shared_ptr<const mach::GMMStats> > > gmm_stats;
@@ -151,6 +203,31 @@ tuple as_tuple (const std::vector<blitz::Array<T,N> >& obj) {
   return tuple(retval);
 }
 
+static void jfa_batch_enrol(train::JFABaseTrainer& t, 
+  const train::JFATrainingStats& stats, const size_t n_iter)
+{
+  bob::python::no_gil unlock;
+  t.enrol(stats, n_iter);
+}
+
+static void jfa_batch_enrol_models(train::JFABaseTrainer& t, 
+  const train::JFATrainingStats& stats, list models, const size_t n_iter)
+{
+  std::vector<boost::shared_ptr<mach::JFAMachine> > models_;
+  for(int i=0; i<len(models); ++i)
+    models_.push_back(extract<boost::shared_ptr<mach::JFAMachine> >(models[i]));
+  bob::python::no_gil unlock;
+  t.enrol(stats, models_, n_iter);
+}
+
+static void jfa_batch_enrol_bank(train::JFABaseTrainer& t, 
+  const train::JFATrainingStats& stats, const blitz::Array<int64_t,1>& ids,
+  mach::ModelBank& bank, const size_t n_iter)
+{
+  bob::python::no_gil unlock;
+  t.enrol(stats, ids, bank, n_iter);
+}
+
 static tuple get_x (const train::JFABaseTrainerBase& obj) {
   return as_tuple(obj.getX());
 }
@@ -220,6 +297,13 @@ static void jfa_precomputeF(train::JFABaseTrainerBase& t, list list_stats)
   t.precomputeSumStatisticsF(gmm_stats);
 }
 
+static void jfa_initializeXYZ(train::JFABaseTrainerBase& t, list list_stats)
+{
+  std::vector<std::vector<boost::shared_ptr<const mach::GMMStats> > > gmm_stats;
+  extractGMMStatsVectors(list_stats, gmm_stats);
+  t.initializeXYZ(gmm_stats);
+}
+
 static void jfa_updateX(train::JFABaseTrainer& t, list list_stats)
 {
   std::vector<std::vector<boost::shared_ptr<const mach::GMMStats> > > gmm_stats;
@@ -268,11 +352,101 @@ static void jfa_updateD(train::JFABaseTrainer& t, list list_stats)
   t.updateD(gmm_stats);
 }
 
+static void jfa_accumulateU(train::JFABaseTrainer& t, list list_stats)
+{
+  std::vector<std::vector<boost::shared_ptr<const mach::GMMStats> > > gmm_stats;
+  extractGMMStatsVectors(list_stats, gmm_stats);
+  t.accumulateU(gmm_stats);
+}
+
+static void jfa_accumulateV(train::JFABaseTrainer& t, list list_stats)
+{
+  std::vector<std::vector<boost::shared_ptr<const mach::GMMStats> > > gmm_stats;
+  extractGMMStatsVectors(list_stats, gmm_stats);
+  t.accumulateV(gmm_stats);
+}
+
+static void jfa_accumulateD(train::JFABaseTrainer& t, list list_stats)
+{
+  std::vector<std::vector<boost::shared_ptr<const mach::GMMStats> > > gmm_stats;
+  extractGMMStatsVectors(list_stats, gmm_stats);
+  t.accumulateD(gmm_stats);
+}
+
+static blitz::Array<double,3> get_acc_u_a1(const train::JFABaseTrainer& t) {
+  return ca::ccopy(t.getAccUA1());
+}
+
+static void set_acc_u_a1(train::JFABaseTrainer& t, tp::const_ndarray acc) {
+  t.setAccUA1(acc.bz<double,3>());
+}
+
+static blitz::Array<double,2> get_acc_u_a2(const train::JFABaseTrainer& t) {
+  return ca::ccopy(t.getAccUA2());
+}
+
+static void set_acc_u_a2(train::JFABaseTrainer& t, tp::const_ndarray acc) {
+  t.setAccUA2(acc.bz<double,2>());
+}
+
+static blitz::Array<double,3> get_acc_v_a1(const train::JFABaseTrainer& t) {
+  return ca::ccopy(t.getAccVA1());
+}
+
+static void set_acc_v_a1(train::JFABaseTrainer& t, tp::const_ndarray acc) {
+  t.setAccVA1(acc.bz<double,3>());
+}
+
+static blitz::Array<double,2> get_acc_v_a2(const train::JFABaseTrainer& t) {
+  return ca::ccopy(t.getAccVA2());
+}
+
+static void set_acc_v_a2(train::JFABaseTrainer& t, tp::const_ndarray acc) {
+  t.setAccVA2(acc.bz<double,2>());
+}
+
+static blitz::Array<double,1> get_acc_d_a1(const train::JFABaseTrainer& t) {
+  return ca::ccopy(t.getAccDA1());
+}
+
+static void set_acc_d_a1(train::JFABaseTrainer& t, tp::const_ndarray acc) {
+  t.setAccDA1(acc.bz<double,1>());
+}
+
+static blitz::Array<double,1> get_acc_d_a2(const train::JFABaseTrainer& t) {
+  return ca::ccopy(t.getAccDA2());
+}
+
+static void set_acc_d_a2(train::JFABaseTrainer& t, tp::const_ndarray acc) {
+  t.setAccDA2(acc.bz<double,1>());
+}
+
+typedef void (train::JFABaseTrainerBase::*base_stats_method)(const train::JFATrainingStats&);
+typedef void (train::JFABaseTrainer::*stats_method)(const train::JFATrainingStats&);
+typedef void (train::JFABaseTrainer::*stats_train_method)(const train::JFATrainingStats&, const size_t);
+typedef void (train::JFABaseTrainer::*stats_train_isv_method)(const train::JFATrainingStats&, const size_t, const double);
+
 void bind_trainer_jfa() {
   def("jfa_update_eigen", &update_eigen, (arg("a"), arg("c"), arg("uv")), "Updates eigenchannels (or eigenvoices) from accumulators a and c.");
-  def("jfa_estimate_x_and_u", &estimate_xandu, (arg("f"), arg("n"), arg("m"), arg("e"), arg("d"), arg("v"), arg("u"), arg("z"), arg("y"), arg("x"), arg("spk_ids")), "Estimates the channel factors.");
-  def("jfa_estimate_y_and_v", &estimate_yandv, (arg("f"), arg("n"), arg("m"), arg("e"), arg("d"), arg("v"), arg("u"), arg("z"), arg("y"), arg("x"), arg("spk_ids")), "Estimates the speaker factors y.");
-  def("jfa_estimate_z_and_d", &estimate_zandd, (arg("f"), arg("n"), arg("m"), arg("e"), arg("d"), arg("v"), arg("u"), arg("z"), arg("y"), arg("x"), arg("spk_ids")), "Estimates the speaker factors z.");
+  def("jfa_estimate_x_and_u", &estimate_xandu, (arg("f"), arg("n"), arg("m"), arg("e"), arg("d"), arg("v"), arg("u"), arg("z"), arg("y"), arg("x"), arg("spk_ids"), arg("n_threads")=1), "Estimates the channel factors. The speakers are split across n_threads threads.");
+  def("jfa_estimate_y_and_v", &estimate_yandv, (arg("f"), arg("n"), arg("m"), arg("e"), arg("d"), arg("v"), arg("u"), arg("z"), arg("y"), arg("x"), arg("spk_ids"), arg("n_threads")=1), "Estimates the speaker factors y. The speakers are split across n_threads threads.");
+  def("jfa_estimate_z_and_d", &estimate_zandd, (arg("f"), arg("n"), arg("m"), arg("e"), arg("d"), arg("v"), arg("u"), arg("z"), arg("y"), arg("x"), arg("spk_ids"), arg("n_threads")=1), "Estimates the speaker factors z. The speakers are split across n_threads threads.");
+
+  class_<train::JFATrainingStats>("JFATrainingStats", "The zeroth and first order statistics of the sessions of several persons, stored contiguously to train a JFABaseMachine. Compared to lists of GMMStats, the second order statistics are not kept, and the first order ones may be stored in single precision (the computations are still carried out in double precision). The trainers accept it wherever they accept lists of lists of GMMStats.", init<const size_t, const size_t, optional<const bool> >((arg("n_gaussians"), arg("n_inputs"), arg("use_float")=false), "Creates an empty set of statistics of GMMs with n_gaussians Gaussians of dimensionality n_inputs. If use_float is set, the first order statistics are stored in single precision."))
+    .def("add_person", &stats_add_person, (arg("self"), arg("sessions")), "Adds a person, given the list of the GMMStats of its sessions, or the list of the HDF5 files of these GMMStats. Only the zeroth and first order statistics are read from the files.")
+    .def("load", &stats_load, (arg("self"), arg("filenames")), "Adds several persons, given the lists of the HDF5 files of the GMMStats of their sessions, in a single pass over the files.")
+    .def("reserve", &train::JFATrainingStats::reserve, (arg("self"), arg("n_sessions")), "Reserves the memory of n_sessions sessions in total.")
+    .def("clear", &train::JFATrainingStats::clear, (arg("self")), "Removes all the persons.")
+    .def("__len__", &train::JFATrainingStats::getNPersons, (arg("self")), "Number of persons")
+    .add_property("n_gaussians", &train::JFATrainingStats::getNGaussians, "Number of Gaussians")
+    .add_property("n_inputs", &train::JFATrainingStats::getNInputs, "Dimensionality of the Gaussians")
+    .add_property("use_float", &train::JFATrainingStats::useFloat, "Tells if the first order statistics are stored in single precision")
+    .add_property("n_persons", &train::JFATrainingStats::getNPersons, "Number of persons")
+    .add_property("n_sessions", &stats_n_sessions, "Total number of sessions")
+    .add_property("offsets", &stats_offsets, "Index of the first session of each person, followed by the total number of sessions")
+    .add_property("n", &stats_n, "The zeroth order statistics of all the sessions (sessions x n_gaussians), as a copy")
+    .add_property("f", &stats_f, "The first order statistics of all the sessions (sessions x n_gaussians*n_inputs), as a copy")
+    ;
 
   class_<train::JFABaseTrainerBase, boost::noncopyable>("JFABaseTrainerBase", "Create a trainer for the JFA.", init<mach::JFABaseMachine&>((arg("jfa_base")),"Initializes a new JFABaseTrainerBase."))
     .add_property("__X__", &get_x, &train::JFABaseTrainerBase::setX)
@@ -285,22 +459,55 @@ void bind_trainer_jfa() {
     .def("__initializeUVD__", &train::JFABaseTrainerBase::initializeUVD, (arg("self")), "Initializes randomly U, V and D.")
     .def("__initNid__", &jfa_initNid, (arg("self"), arg("stats")), "Initializes the number of identities.")
     .def("__precomputeSumStatisticsN__", &jfa_precomputeN, (arg("self"), arg("stats")), "Precomputes zeroth order statistics over sessions.")
+    .def("__precomputeSumStatisticsN__", (base_stats_method)&train::JFABaseTrainerBase::precomputeSumStatisticsN, (arg("self"), arg("stats")), "Precomputes zeroth order statistics over sessions.")
     .def("__precomputeSumStatisticsF__", &jfa_precomputeF, (arg("self"), arg("stats")), "Precomputes first order statistics over sessions.")
+    .def("__precomputeSumStatisticsF__", (base_stats_method)&train::JFABaseTrainerBase::precomputeSumStatisticsF, (arg("self"), arg("stats")), "Precomputes first order statistics over sessions.")
+    .def("__initializeXYZ__", &jfa_initializeXYZ, (arg("self"), arg("stats")), "Initializes the speaker factors x, y and z to zero.")
+    .def("__initializeXYZ__", (base_stats_method)&train::JFABaseTrainerBase::initializeXYZ, (arg("self"), arg("stats")), "Initializes the speaker factors x, y and z to zero.")
   ;
 
 
   class_<train::JFABaseTrainer, boost::noncopyable, bases<train::JFABaseTrainerBase> >("JFABaseTrainer", "Create a trainer for the JFA.", init<mach::JFABaseMachine&>((arg("jfa_base")),"Initializes a new JFABaseTrainer."))
+    .add_property("n_threads", &train::JFABaseTrainer::getNThreads, &train::JFABaseTrainer::setNThreads, "The number of threads the persons (and sessions) are split across, when estimating the speaker factors and computing the accumulators of the U, V and D updates. The speaker factors do not depend on the number of threads, and the accumulators are identical for a given number of threads.")
     .def("train", &jfa_train, (arg("self"), arg("gmm_stats"), arg("n_iter")), "Call the training procedure.")
+    .def("train", (stats_train_method)&train::JFABaseTrainer::train, (arg("self"), arg("stats"), arg("n_iter")), "Call the training procedure.")
     .def("train_no_init", &jfa_train_noinit, (arg("self"), arg("gmm_stats"), arg("n_iter")), "Call the training procedure.")
+    .def("train_no_init", (stats_train_method)&train::JFABaseTrainer::trainNoInit, (arg("self"), arg("stats"), arg("n_iter")), "Call the training procedure.")
     .def("train_isv", &jfa_train_ISV, (arg("self"), arg("gmm_stats"), arg("n_iter"), arg("relevance")), "Call the ISV training procedure.")
+    .def("train_isv", (stats_train_isv_method)&train::JFABaseTrainer::trainISV, (arg("self"), arg("stats"), arg("n_iter"), arg("relevance")), "Call the ISV training procedure.")
     .def("train_isv_no_init", &jfa_train_ISV_noinit, (arg("self"), arg("gmm_stats"), arg("n_iter"), arg("relevance")), "Call the ISV training procedure.")
+    .def("train_isv_no_init", (stats_train_isv_method)&train::JFABaseTrainer::trainISVNoInit, (arg("self"), arg("stats"), arg("n_iter"), arg("relevance")), "Call the ISV training procedure.")
+    .def("enrol", &jfa_batch_enrol, (arg("self"), arg("stats"), arg("n_iter")), "Enrols all the persons of a JFATrainingStats at once, as JFATrainer.enrol() would do for each of them. Their speaker factors are then available as y and z. The terms which only depend on U, V and D are computed once for all the persons, and the persons are split across n_threads threads.")
+    .def("enrol", &jfa_batch_enrol_models, (arg("self"), arg("stats"), arg("models"), arg("n_iter")), "Enrols all the persons of a JFATrainingStats at once, and sets the speaker factors of the given JFAMachines (one per person).")
+    .def("enrol", &jfa_batch_enrol_bank, (arg("self"), arg("stats"), arg("ids"), arg("bank"), arg("n_iter")), "Enrols all the persons of a JFATrainingStats at once, and writes their speaker factors into the 'y' and 'z' fields of the ModelBank, with the given identifiers (a 1D int64 array).")
     .def("__initializeVD_ISV__", &train::JFABaseTrainer::initializeVD_ISV, (arg("self"), arg("relevance factor")), "Initializes V=0 and D=sqrt(var(UBM)/r) (for ISV).")
     .def("__updateY__", &jfa_updateY, (arg("self"), arg("stats")), "Updates Y.")
+    .def("__updateY__", (stats_method)&train::JFABaseTrainer::updateY, (arg("self"), arg("stats")), "Updates Y.")
     .def("__updateV__", &jfa_updateV, (arg("self"), arg("stats")), "Updates V.")
+    .def("__updateV__", (stats_method)&train::JFABaseTrainer::updateV, (arg("self"), arg("stats")), "Updates V.")
     .def("__updateX__", &jfa_updateX, (arg("self"), arg("stats")), "Updates X.")
+    .def("__updateX__", (stats_method)&train::JFABaseTrainer::updateX, (arg("self"), arg("stats")), "Updates X.")
     .def("__updateU__", &jfa_updateU, (arg("self"), arg("stats")), "Updates U.")
+    .def("__updateU__", (stats_method)&train::JFABaseTrainer::updateU, (arg("self"), arg("stats")), "Updates U.")
     .def("__updateZ__", &jfa_updateZ, (arg("self"), arg("stats")), "Updates Z.")
+    .def("__updateZ__", (stats_method)&train::JFABaseTrainer::updateZ, (arg("self"), arg("stats")), "Updates Z.")
     .def("__updateD__", &jfa_updateD, (arg("self"), arg("stats")), "Updates D.")
+    .def("__updateD__", (stats_method)&train::JFABaseTrainer::updateD, (arg("self"), arg("stats")), "Updates D.")
+    .def("__accumulateU__", &jfa_accumulateU, (arg("self"), arg("stats")), "Computes the accumulators of the U update (acc_u_a1 and acc_u_a2) for the given persons.")
+    .def("__accumulateU__", (stats_method)&train::JFABaseTrainer::accumulateU, (arg("self"), arg("stats")), "Computes the accumulators of the U update (acc_u_a1 and acc_u_a2) for the given persons.")
+    .def("__updateUFromAccumulators__", &train::JFABaseTrainer::updateUFromAccumulators, (arg("self")), "Updates U from the accumulators acc_u_a1 and acc_u_a2.")
+    .def("__accumulateV__", &jfa_accumulateV, (arg("self"), arg("stats")), "Computes the accumulators of the V update (acc_v_a1 and acc_v_a2) for the given persons.")
+    .def("__accumulateV__", (stats_method)&train::JFABaseTrainer::accumulateV, (arg("self"), arg("stats")), "Computes the accumulators of the V update (acc_v_a1 and acc_v_a2) for the given persons.")
+    .def("__updateVFromAccumulators__", &train::JFABaseTrainer::updateVFromAccumulators, (arg("self")), "Updates V from the accumulators acc_v_a1 and acc_v_a2.")
+    .def("__accumulateD__", &jfa_accumulateD, (arg("self"), arg("stats")), "Computes the accumulators of the D update (acc_d_a1 and acc_d_a2) for the given persons.")
+    .def("__accumulateD__", (stats_method)&train::JFABaseTrainer::accumulateD, (arg("self"), arg("stats")), "Computes the accumulators of the D update (acc_d_a1 and acc_d_a2) for the given persons.")
+    .def("__updateDFromAccumulators__", &train::JFABaseTrainer::updateDFromAccumulators, (arg("self")), "Updates D from the accumulators acc_d_a1 and acc_d_a2.")
+    .add_property("acc_u_a1", &get_acc_u_a1, &set_acc_u_a1, "The first accumulator of the U update. The accumulators of disjoint sets of persons can be summed.")
+    .add_property("acc_u_a2", &get_acc_u_a2, &set_acc_u_a2, "The second accumulator of the U update. The accumulators of disjoint sets of persons can be summed.")
+    .add_property("acc_v_a1", &get_acc_v_a1, &set_acc_v_a1, "The first accumulator of the V update. The accumulators of disjoint sets of persons can be summed.")
+    .add_property("acc_v_a2", &get_acc_v_a2, &set_acc_v_a2, "The second accumulator of the V update. The accumulators of disjoint sets of persons can be summed.")
+    .add_property("acc_d_a1", &get_acc_d_a1, &set_acc_d_a1, "The first accumulator of the D update. The accumulators of disjoint sets of persons can be summed.")
+    .add_property("acc_d_a2", &get_acc_d_a2, &set_acc_d_a2, "The second accumulator of the D update. The accumulators of disjoint sets of persons can be summed.")
     ;
 
   class_<train::JFATrainer, boost::noncopyable>("JFATrainer", "Create a trainer for the JFA.", init<mach::JFAMachine&, train::JFABaseTrainer&>((arg("jfa"), arg("base_trainer")),"Initializes a new JFATrainer."))
@@ -68,6 +68,11 @@ void bind_trainer_kmeans()
     .def(self == self)
     .def(self != self)
     .def("train", &EMTrainerKMeansBase::train, (arg("machine"), arg("data")), "Train a machine using data")
+    .def("resume", &EMTrainerKMeansBase::resume, (arg("self"), arg("machine"), arg("data"), arg("checkpoint")), "Resumes a training from a checkpoint: the trainer is initialized with the data, the machine and the state of the trainer are loaded from the checkpoint, and the training goes on until convergence or until max_iterations iterations (including those of the checkpoint) are reached")
+    .def("set_observer", &EMTrainerKMeansBase::setObserver, (arg("self"), arg("observer")), "Sets the callable, called with an EMIteration after the initial E-step and after each iteration (None disables the notifications)")
+    .def("set_checkpoint", &EMTrainerKMeansBase::setCheckpoint, (arg("self"), arg("filename"), arg("every")=1), "Saves the machine and the state of the trainer into the given HDF5 file every 'every' iterations, such that the training may be resumed with resume(). The file is first written to filename.tmp, which is then renamed. An empty filename disables the checkpoints.")
+    .add_property("checkpoint", make_function(&EMTrainerKMeansBase::getCheckpoint, return_value_policy<copy_const_reference>()), "The file of the checkpoints")
+    .add_property("checkpoint_every", &EMTrainerKMeansBase::getCheckpointEvery, "The number of iterations between two checkpoints")
     .def("initialization", &EMTrainerKMeansBase::initialization, (arg("machine"), arg("data")), "This method is called before the EM algorithm")
     .def("e_step", &EMTrainerKMeansBase::eStep, (arg("machine"), arg("data")),
        "Update the hidden variable distribution (or the sufficient statistics) given the Machine parameters. "
@@ -94,6 +99,13 @@ void bind_trainer_kmeans()
     .add_property("average_min_distance", &bob::trainer::KMeansTrainer::getAverageMinDistance, &bob::trainer::KMeansTrainer::setAverageMinDistance, "Average min distance. Useful to parallelize the E-step.")
     .add_property("zeroeth_order_statistics", &py_getZeroethOrderStats, &py_setZeroethOrderStats, "The zeroeth order statistics. Useful to parallelize the E-step.")
     .add_property("first_order_statistics", &py_getFirstOrderStats, &py_setFirstOrderStats, "The first order statistics. Useful to parallelize the E-step.")
+    .def("train", &EMTrainerKMeansBase::train, (arg("self"), arg("machine"), arg("data")), "Train a machine using data")
+    .def("train", (void (bob::trainer::KMeansTrainer::*)(bob::machine::KMeansMachine&, bob::trainer::BlockSampler&))&bob::trainer::KMeansTrainer::train, (arg("self"), arg("machine"), arg("sampler")), "Train a machine using the samples streamed by a BlockSampler, with a single pass over the samples per E-step")
+    .def("initialization", (void (bob::trainer::KMeansTrainer::*)(bob::machine::KMeansMachine&, const blitz::Array<double,2>&))&bob::trainer::KMeansTrainer::initialization, (arg("self"), arg("machine"), arg("data")), "This method is called before the EM algorithm")
+    .def("initialization", (void (bob::trainer::KMeansTrainer::*)(bob::machine::KMeansMachine&, bob::trainer::BlockSampler&))&bob::trainer::KMeansTrainer::initialization, (arg("self"), arg("machine"), arg("sampler")), "This method is called before the EM algorithm, when training with a BlockSampler. The initial means are randomly sampled with random accesses to the sampler.")
+    .def("e_step", &EMTrainerKMeansBase::eStep, (arg("self"), arg("machine"), arg("data")), "Update the sufficient statistics given the Machine parameters")
+    .def("e_step", (void (bob::trainer::KMeansTrainer::*)(bob::machine::KMeansMachine&, bob::trainer::BlockSampler&))&bob::trainer::KMeansTrainer::eStep, (arg("self"), arg("machine"), arg("sampler")), "Update the sufficient statistics given the Machine parameters, with a single pass over the samples streamed by a BlockSampler")
+    .add_property("n_threads", &bob::trainer::KMeansTrainer::getNThreads, &bob::trainer::KMeansTrainer::setNThreads, "The number of threads the E-step is split across. Each thread accumulates the statistics of a contiguous shard of the samples.")
   ;
 
 }
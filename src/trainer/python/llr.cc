@@ -50,6 +50,12 @@ void train2(const bob::trainer::LLRTrainer& t, bob::machine::LinearMachine& m,
   t.train(m, data1.bz<double,2>(), data2.bz<double,2>());
 }
 
+void train3(const bob::trainer::LLRTrainer& t, bob::machine::LinearMachine& m, 
+  bob::trainer::BlockSampler& sampler1, bob::trainer::BlockSampler& sampler2)
+{
+  t.train(m, sampler1, sampler2);
+}
+
 void bind_trainer_llr() 
 {
   class_<bob::trainer::LLRTrainer, boost::shared_ptr<bob::trainer::LLRTrainer> >("LLRTrainer", "Trains a linear machine to perform Linear Logistic Regression. References:\n1. A comparison of numerical optimizers for logistic regression, T. Minka, http://research.microsoft.com/en-us/um/people/minka/papers/logreg/\n2. FoCal, http://www.dsp.sun.ac.za/~nbrummer/focal/.", init<optional<const double, const double, const size_t> >((arg("prior")=0.5, arg("convergence_threshold")=1e-5, arg("max_iterations")=10000), "Initializes a new Linear Logistic Regression trainer. The training stage will place the resulting weights (and bias) in a linear machine with a single output dimension."))
@@ -59,7 +65,10 @@ void bind_trainer_llr()
     .add_property("prior", &bob::trainer::LLRTrainer::getPrior, &bob::trainer::LLRTrainer::setPrior, "The synthetic prior (should be in range ]0.,1.[.")
     .add_property("convergence_threshold", &bob::trainer::LLRTrainer::getConvergenceThreshold, &bob::trainer::LLRTrainer::setConvergenceThreshold, "The convergence threshold for the conjugate gradient algorithm")
     .add_property("max_iterations", &bob::trainer::LLRTrainer::getMaxIterations, &bob::trainer::LLRTrainer::setMaxIterations, "The maximum number of iterations for the conjugate gradient algorithm")
+    .add_property("n_threads", &bob::trainer::LLRTrainer::getNThreads, &bob::trainer::LLRTrainer::setNThreads, "The number of threads each block of samples is split across when computing the likelihood and its derivatives. The samples are never copied.")
+    .add_property("use_lbfgs", &bob::trainer::LLRTrainer::getUseLBFGS, &bob::trainer::LLRTrainer::setUseLBFGS, "Uses the L-BFGS optimizer instead of the conjugate gradient one. The optimization then stops when the norm of the gradient of the normalized negative log-likelihood is below convergence_threshold * max(1, norm(w)).")
     .def("train", &train1, (arg("self"), arg("data1"), arg("data2")), "Trains a LinearMachine to perform the Linear Logistic Regression, using two arraysets for training, one for each of the two classes (target vs. non-target). The trained LinearMachine is returned.")
     .def("train", &train2, (arg("self"), arg("machine"), arg("data1"), arg("data2")), "Trains a LinearMachine to perform the Linear Logistic Regression, using two arraysets for training, one for each of the two classes (target vs. non-target).")
+    .def("train", &train3, (arg("self"), arg("machine"), arg("sampler1"), arg("sampler2")), "Trains a LinearMachine to perform the Linear Logistic Regression, with the samples of the two classes (target vs. non-target) streamed by two BlockSamplers. Two passes over the samples are made per conjugate gradient iteration (one per evaluation with L-BFGS).")
     ;
 }
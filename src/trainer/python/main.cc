@@ -23,6 +23,7 @@
 #include "bob/config.h"
 #include "bob/core/python/ndarray.h"
 
+void bind_trainer_emtrainer();
 void bind_trainer_linear();
 void bind_trainer_gmm();
 void bind_trainer_kmeans();
@@ -34,6 +35,7 @@ void bind_trainer_wiener();
 void bind_trainer_empca();
 void bind_trainer_bic();
 void bind_trainer_llr();
+void bind_trainer_sampler();
 
 #if defined(HAVE_LIBSVM)
 void bind_trainer_svm();
@@ -43,6 +45,8 @@ BOOST_PYTHON_MODULE(_trainer) {
 
   bob::python::setup_python("bob classes and sub-classes for trainers");
   
+  bind_trainer_emtrainer();
+  bind_trainer_sampler();
   bind_trainer_linear();
   bind_trainer_gmm();
   bind_trainer_kmeans();
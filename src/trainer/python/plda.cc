@@ -24,6 +24,7 @@
 #include <boost/python.hpp>
 #include "bob/machine/PLDAMachine.h"
 #include "bob/trainer/PLDATrainer.h"
+#include "bob/core/python/gil.h"
 
 using namespace boost::python;
 namespace train = bob::trainer;
@@ -46,6 +47,21 @@ static void plda_train(train::PLDABaseTrainer& t, mach::PLDABaseMachine& m, list
   t.train(m, v_arraysets);
 }
 
+static void plda_resume(train::PLDABaseTrainer& t, mach::PLDABaseMachine& m, list l_arraysets, const std::string& checkpoint)
+{
+  int n_ids = len(l_arraysets);
+  std::vector<blitz::Array<double,2> > v_arraysets;
+
+  // Extracts the vector of Arraysets from the python list of Arraysets
+  for(int id=0; id<n_ids; ++id) {
+    blitz::Array<double,2> ar = extract<blitz::Array<double,2> >(l_arraysets[id]);
+    v_arraysets.push_back(ar);
+  }
+
+  // Calls the resume function
+  t.resume(m, v_arraysets, checkpoint);
+}
+
 static void plda_initialization(train::PLDABaseTrainer& t, mach::PLDABaseMachine& m, list l_arraysets)
 {
   int n_ids = len(l_arraysets);
@@ -106,6 +122,32 @@ static void plda_finalization(train::PLDABaseTrainer& t, mach::PLDABaseMachine&
   t.finalization(m, v_arraysets);
 }
 
+static void plda_batch_enrol(mach::PLDABaseMachine& m, list l_arraysets, 
+  list models, const size_t n_threads)
+{
+  std::vector<blitz::Array<double,2> > v_arraysets;
+  for(int id=0; id<len(l_arraysets); ++id)
+    v_arraysets.push_back(extract<blitz::Array<double,2> >(l_arraysets[id]));
+  std::vector<boost::shared_ptr<mach::PLDAMachine> > v_models;
+  for(int id=0; id<len(models); ++id)
+    v_models.push_back(extract<boost::shared_ptr<mach::PLDAMachine> >(models[id]));
+
+  bob::python::no_gil unlock;
+  train::plda::enrol(m, v_arraysets, v_models, n_threads);
+}
+
+static void plda_batch_enrol_bank(mach::PLDABaseMachine& m, list l_arraysets, 
+  const blitz::Array<int64_t,1>& ids, mach::ModelBank& bank, 
+  const size_t n_threads)
+{
+  std::vector<blitz::Array<double,2> > v_arraysets;
+  for(int id=0; id<len(l_arraysets); ++id)
+    v_arraysets.push_back(extract<blitz::Array<double,2> >(l_arraysets[id]));
+
+  bob::python::no_gil unlock;
+  train::plda::enrol(m, v_arraysets, ids, bank, n_threads);
+}
+
 static object get_z_first_order(train::PLDABaseTrainer& m) {
   const std::vector<blitz::Array<double,2> >& v = m.getZFirstOrder();
   list retval;
@@ -121,6 +163,10 @@ void bind_trainer_plda() {
     .add_property("max_iterations", &EMTrainerPLDABase::getMaxIterations, &EMTrainerPLDABase::setMaxIterations, "Max iterations")
     .add_property("compute_likelihood_variable", &EMTrainerPLDABase::getComputeLikelihood, &EMTrainerPLDABase::setComputeLikelihood, "Indicates whether the log likelihood should be computed during EM or not")
     .def("train", &EMTrainerPLDABase::train, (arg("machine"), arg("data")), "Trains a machine using data")
+    .def("set_observer", &EMTrainerPLDABase::setObserver, (arg("self"), arg("observer")), "Sets the callable, called with an EMIteration after the initial E-step and after each iteration (None disables the notifications)")
+    .def("set_checkpoint", &EMTrainerPLDABase::setCheckpoint, (arg("self"), arg("filename"), arg("every")=1), "Saves the machine and the state of the trainer into the given HDF5 file every 'every' iterations, such that the training may be resumed with resume(). The file is first written to filename.tmp, which is then renamed. An empty filename disables the checkpoints.")
+    .add_property("checkpoint", make_function(&EMTrainerPLDABase::getCheckpoint, return_value_policy<copy_const_reference>()), "The file of the checkpoints")
+    .add_property("checkpoint_every", &EMTrainerPLDABase::getCheckpointEvery, "The number of iterations between two checkpoints")
     .def("initialization", &EMTrainerPLDABase::initialization, (arg("machine"), arg("data")), "This method is called before the EM algorithm")
     .def("finalization", &EMTrainerPLDABase::finalization, (arg("machine"), arg("data")), "This method is called at the end of the EM algorithm")
     .def("e_step", &EMTrainerPLDABase::eStep, (arg("machine"), arg("data")),
@@ -140,7 +186,9 @@ void bind_trainer_plda() {
     .add_property("init_sigma_ratio", &train::PLDABaseTrainer::getInitSigmaRatio, &train::PLDABaseTrainer::setInitSigmaRatio, "The ratio used for the initialization of sigma.")
     .add_property("z_first_order", &get_z_first_order)
     .add_property("z_second_order_sum", make_function(&train::PLDABaseTrainer::getZSecondOrderSum, return_value_policy<copy_const_reference>()))
+    .add_property("n_threads", &train::PLDABaseTrainer::getNThreads, &train::PLDABaseTrainer::setNThreads, "The number of threads the identities are split across, in the E-step and in the updates of F, G and sigma. The latent variables do not depend on the number of threads, and the partial sums are identical for a given number of threads.")
     .def("train", &plda_train, (arg("self"), arg("machine"), arg("list_arraysets")), "Calls the training procedure. This will call initialization(), a loop of e_step() and m_step(), and finalization().")
+    .def("resume", &plda_resume, (arg("self"), arg("machine"), arg("list_arraysets"), arg("checkpoint")), "Resumes the training procedure from a checkpoint (see set_checkpoint()).")
     .def("initialization", &plda_initialization, (arg("self"), arg("machine"), arg("list_arraysets")), "Calls the initialization method of the training procedure.")
     .def("e_step", &plda_eStep, (arg("self"), arg("machine"), arg("list_arraysets")), "Calls the eStep method of the training procedure.")
     .def("m_step", &plda_mStep, (arg("self"), arg("machine"), arg("list_arraysets")), "Calls the mStep method of the training procedure.")
@@ -152,5 +200,8 @@ void bind_trainer_plda() {
     .def("enrol", (void (train::PLDATrainer::*)(const blitz::Array<double,2>&))&train::PLDATrainer::enrol, (arg("self"), arg("arrayset")), "Call the enrollment procedure.")
     ;
 
+  def("plda_enrol", &plda_batch_enrol, (arg("plda_base"), arg("list_arraysets"), arg("models"), arg("n_threads")=1), "Enrols several clients at once, given one 2D array of samples per client, and writes the enrolment data into the given PLDAMachines (which should be attached to plda_base). The terms which only depend on the number of samples are added to plda_base first, and the clients are then split across n_threads threads.");
+  def("plda_enrol", &plda_batch_enrol_bank, (arg("plda_base"), arg("list_arraysets"), arg("ids"), arg("bank"), arg("n_threads")=1), "Enrols several clients at once, and writes the enrolment data into the ModelBank, with the given identifiers (a 1D int64 array).");
+
 
 }
@@ -0,0 +1,100 @@
+/**
+ * @file trainer/python/sampler.cc
+ * @date Mon Oct 19 21:02:47 2026 +0200
+ *
+ * @brief Python bindings to the samplers streaming blocks of samples
+ *
+ * Copyright (C) 2011-2012 Idiap Research Institute, Martigny, Switzerland
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bob/core/python/ndarray.h"
+#include "bob/core/python/gil.h"
+#include <boost/python/stl_iterator.hpp>
+#include "bob/core/array_copy.h"
+#include "bob/trainer/BlockSampler.h"
+
+using namespace boost::python;
+namespace train = bob::trainer;
+
+static std::vector<std::string> to_filenames(object filenames) {
+  std::vector<std::string> res;
+  stl_input_iterator<std::string> it(filenames), end;
+  res.assign(it, end);
+  return res;
+}
+
+static boost::shared_ptr<train::HDF5BlockSampler> hdf5_init(object filenames,
+    const std::string& dataset, const size_t block_size, const bool read_ahead) {
+  return boost::shared_ptr<train::HDF5BlockSampler>(new train::HDF5BlockSampler(to_filenames(filenames), dataset, block_size, read_ahead));
+}
+
+static boost::shared_ptr<train::BinaryBlockSampler> binary_init(object filenames,
+    const size_t n_inputs, const bool single_precision, const size_t block_size,
+    const bool read_ahead) {
+  return boost::shared_ptr<train::BinaryBlockSampler>(new train::BinaryBlockSampler(to_filenames(filenames), n_inputs, single_precision, block_size, read_ahead));
+}
+
+static object next(train::BlockSampler& s) {
+  blitz::Array<double,2> block;
+  bool ok;
+  {
+    bob::python::no_gil unlock;
+    ok = s.next(block);
+  }
+  if (!ok) return object();
+  return object(bob::core::array::ccopy(block));
+}
+
+static blitz::Array<double,1> sample(train::BlockSampler& s, const size_t index) {
+  blitz::Array<double,1> x(s.getNInputs());
+  s.sample(index, x);
+  return x;
+}
+
+static tuple get_filenames(const std::vector<std::string>& filenames) {
+  list res;
+  for (size_t i=0; i<filenames.size(); ++i) res.append(filenames[i]);
+  return tuple(res);
+}
+
+static tuple hdf5_filenames(const train::HDF5BlockSampler& s) {
+  return get_filenames(s.getFilenames());
+}
+
+static tuple binary_filenames(const train::BinaryBlockSampler& s) {
+  return get_filenames(s.getFilenames());
+}
+
+void bind_trainer_sampler() {
+  class_<train::BlockSampler, boost::shared_ptr<train::BlockSampler>, boost::noncopyable>("BlockSampler", "A sampler streams a (possibly very large) set of samples of the same dimensionality, as consecutive blocks of rows, such that EM trainers do not require the whole training set in memory. If read-ahead is enabled, the next block is read by a background thread while the current one is processed.", no_init)
+    .def("__len__", &train::BlockSampler::size, (arg("self")), "Total number of samples")
+    .add_property("n_inputs", &train::BlockSampler::getNInputs, "Dimensionality of the samples")
+    .add_property("block_size", &train::BlockSampler::getBlockSize, "Maximum number of samples of a block")
+    .add_property("read_ahead", &train::BlockSampler::getReadAhead, "Tells if the next block is read in the background")
+    .def("reset", &train::BlockSampler::reset, (arg("self")), "Restarts the stream from the first sample")
+    .def("next", &next, (arg("self")), "Returns (a copy of) the next block of samples, one per row, or None at the end of the stream")
+    .def("sample", &sample, (arg("self"), arg("index")), "Reads the sample with the given index (random access, which is much slower than streaming the samples)")
+    ;
+
+  class_<train::HDF5BlockSampler, boost::shared_ptr<train::HDF5BlockSampler>, boost::noncopyable, bases<train::BlockSampler> >("HDF5BlockSampler", "Streams the rows of a 2D dataset stored in a list of HDF5 files (e.g. one file of features per recording). The dataset may either be a 2D array or a list of 1D arrays (appended one by one), in single or double precision. A single file is opened at a time.", no_init)
+    .def("__init__", make_constructor(&hdf5_init, default_call_policies(), (arg("filenames"), arg("dataset")="array", arg("block_size")=4096, arg("read_ahead")=true)), "Builds a sampler streaming the given dataset of the given files")
+    .add_property("filenames", &hdf5_filenames, "Names of the files")
+    ;
+
+  class_<train::BinaryBlockSampler, boost::shared_ptr<train::BinaryBlockSampler>, boost::noncopyable, bases<train::BlockSampler> >("BinaryBlockSampler", "Streams the samples stored in a list of raw binary files, which are memory-mapped. Each file contains consecutive samples of n_inputs 32-bit (single_precision) or 64-bit floats, in native byte order and without any header. A single file is mapped at a time.", no_init)
+    .def("__init__", make_constructor(&binary_init, default_call_policies(), (arg("filenames"), arg("n_inputs"), arg("single_precision")=false, arg("block_size")=4096, arg("read_ahead")=true)), "Builds a sampler streaming the given files")
+    .add_property("filenames", &binary_filenames, "Names of the files")
+    ;
+}